@@ -0,0 +1,262 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Actuation self-test (components/actuation_test).
+// The tool starts actuation.Start on a gateway whose test output is wired
+// back to the test input, follows the run and prints the distributions the
+// gateway measured: the output write, the input edge after switching on and
+// off (relay operate and release time) and the time until the process image
+// clients read shows the change. With -l it gives bounds in ms for the on
+// and off edges and fails when p99 lies outside them, so a worn relay or a
+// slow input filter shows up in a routine check.
+// The methods need a user with write rights (-u/-p) when authentication is on.
+
+#define POLL_INTERVAL_MS    200
+#define SUMMARY_FIELDS      6
+#define SERIES              4
+#define HISTOGRAM_BINS      64
+
+static const char* series_names[SERIES] = {"write", "on", "off", "visible"};
+static const char* series_nodes[SERIES] = {"actuation.Write", "actuation.On", "actuation.Off", "actuation.Visible"};
+
+static const char* username;
+static const char* password;
+static UA_UInt32 timeout_ms = 2000;
+
+static double now_ms(void) {
+    return (double)UA_DateTime_nowMonotonic() / UA_DATETIME_MSEC;
+}
+
+static void sleep_ms(int ms) {
+    UA_DateTime until = UA_DateTime_nowMonotonic() + (UA_DateTime)ms * UA_DATETIME_MSEC;
+    while (UA_DateTime_nowMonotonic() < until) {
+    }
+}
+
+static int read_uint32(UA_Client* client, const char* id, UA_UInt32* out) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_UINT32]);
+    if (ok) *out = *(UA_UInt32*)value.data;
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static int read_byte(UA_Client* client, const char* id, UA_Byte* out) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_BYTE]);
+    if (ok) *out = *(UA_Byte*)value.data;
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+// Read a UInt32 array of exactly size elements
+static int read_uint32_array(UA_Client* client, const char* id, UA_UInt32* out, size_t size) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasArrayType(&value, &UA_TYPES[UA_TYPES_UINT32]) &&
+             value.arrayLength == size;
+    if (ok) memcpy(out, value.data, size * sizeof(UA_UInt32));
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static int read_string(UA_Client* client, const char* id, char* out, size_t size) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_STRING]);
+    out[0] = '\0';
+    if (ok) {
+        UA_String* s = (UA_String*)value.data;
+        size_t n = s->length < size - 1 ? s->length : size - 1;
+        memcpy(out, s->data, n);
+        out[n] = '\0';
+    }
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static UA_StatusCode call_method(UA_Client* client, const char* id, size_t inputSize, UA_Variant* input) {
+    size_t outputSize = 0;
+    UA_Variant* output = NULL;
+    UA_StatusCode status = UA_Client_call(client, UA_NODEID_STRING(1, "actuation"),
+                                          UA_NODEID_STRING(1, (char*)id), inputSize, input,
+                                          &outputSize, &output);
+    UA_Array_delete(output, outputSize, &UA_TYPES[UA_TYPES_VARIANT]);
+    return status;
+}
+
+static void print_help(const char* program_name) {
+    printf("OPC UA ACTUATION SELF-TEST\n");
+    printf("==========================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("SERVER_URL defaults to opc.tcp://10.0.0.128:4840.\n\n");
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -n, --cycles N         Cycles of the run (default: the gateway's setting)\n");
+    printf("  -l, --limits ON,OFF    Highest p99 in ms of the on and off edges (default: off)\n");
+    printf("  -w, --wait MS          Longest run time (default: 120000)\n");
+    printf("  -t, --timeout MS       Request timeout (default: 2000)\n");
+    printf("  -o, --csv FILE         Also append the results as CSV\n");
+    printf("  -u, --user NAME        Username\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nExamples:\n");
+    printf("  %s -n 200 opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -u admin -p admin789 -l 15,10 -o relay.csv\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_url = "opc.tcp://10.0.0.128:4840";
+    const char* csv_file = NULL;
+    int cycles = 0;
+    double limit_on = 0.0, limit_off = 0.0;
+    int wait_ms = 120000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--cycles") == 0) && i + 1 < argc) {
+            cycles = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--limits") == 0) && i + 1 < argc) {
+            if (sscanf(argv[++i], "%lf,%lf", &limit_on, &limit_off) != 2) {
+                printf("Limits must be given as ON,OFF in ms\n");
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--wait") == 0) && i + 1 < argc) {
+            wait_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = (UA_UInt32)atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (cycles < 0 || cycles > 65535) cycles = 0;
+
+    UA_Client* client = UA_Client_new();
+    UA_Client_getConfig(client)->timeout = timeout_ms;
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, server_url, username, password)
+        : UA_Client_connect(client, server_url);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection to %s failed\n", server_url);
+        UA_Client_delete(client);
+        return 1;
+    }
+
+    UA_Byte output = 0, input = 0;
+    read_byte(client, "actuation.Output", &output);
+    read_byte(client, "actuation.Input", &input);
+    printf("RUN DO%u -> DI%u\n", output, input);
+
+    UA_Variant argument;
+    UA_UInt16 requested = (UA_UInt16)cycles;
+    UA_Variant_setScalar(&argument, &requested, &UA_TYPES[UA_TYPES_UINT16]);
+    status = call_method(client, "actuation.Start", 1, &argument);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("FAIL: Start: %s\n", UA_StatusCode_name(status));
+        UA_Client_disconnect(client);
+        UA_Client_delete(client);
+        return 1;
+    }
+
+    char state[16] = "running";
+    UA_UInt32 total = 0, done = 0, last_done = 0;
+    read_uint32(client, "actuation.CyclesRequested", &total);
+    double start = now_ms();
+    while (now_ms() - start < wait_ms) {
+        sleep_ms(POLL_INTERVAL_MS);
+        read_string(client, "actuation.State", state, sizeof(state));
+        read_uint32(client, "actuation.Cycles", &done);
+        if (done / 20 != last_done / 20) {
+            printf("  %u / %u cycles\n", done, total);
+        }
+        last_done = done;
+        if (strcmp(state, "running") != 0) break;
+    }
+    if (strcmp(state, "running") == 0) {
+        printf("  Still running after %d ms, stopping\n", wait_ms);
+        call_method(client, "actuation.Stop", 0, NULL);
+    }
+
+    UA_UInt32 timeouts = 0, not_visible = 0, bounces = 0, errors = 0;
+    UA_UInt32 summary[SERIES][SUMMARY_FIELDS];
+    UA_UInt32 histogram[HISTOGRAM_BINS];
+    memset(summary, 0, sizeof(summary));
+    memset(histogram, 0, sizeof(histogram));
+    read_uint32(client, "actuation.Cycles", &done);
+    read_uint32(client, "actuation.Timeouts", &timeouts);
+    read_uint32(client, "actuation.NotVisible", &not_visible);
+    read_uint32(client, "actuation.Bounces", &bounces);
+    read_uint32(client, "actuation.Errors", &errors);
+    for (int s = 0; s < SERIES; s++) {
+        read_uint32_array(client, series_nodes[s], summary[s], SUMMARY_FIELDS);
+    }
+    read_uint32_array(client, "actuation.Histogram", histogram, HISTOGRAM_BINS);
+    printf("  State %s after %.0f ms\n", state, now_ms() - start);
+
+    int failed = strcmp(state, "done") != 0 || timeouts > 0 || errors > 0;
+    printf("\n%-10s %7s %9s %9s %9s %9s %9s\n", "interval", "count", "min us", "p50 us", "p90 us",
+           "p99 us", "max us");
+    for (int s = 0; s < SERIES; s++) {
+        printf("%-10s %7u %9u %9u %9u %9u %9u\n", series_names[s], summary[s][0], summary[s][1],
+               summary[s][2], summary[s][3], summary[s][4], summary[s][5]);
+    }
+    printf("\nCycles %u, timeouts %u, not visible %u, bounces %u, errors %u\n", done, timeouts, not_visible,
+           bounces, errors);
+    printf("Command to edge (1 ms bins):");
+    for (int b = 0; b < HISTOGRAM_BINS; b++) {
+        if (histogram[b]) printf(" %d:%u", b, histogram[b]);
+    }
+    printf("\n");
+    if (limit_on > 0.0 && summary[1][4] > limit_on * 1000.0) {
+        printf("FAIL: on edge p99 %.1f ms above %.1f ms\n", summary[1][4] / 1000.0, limit_on);
+        failed = 1;
+    }
+    if (limit_off > 0.0 && summary[2][4] > limit_off * 1000.0) {
+        printf("FAIL: off edge p99 %.1f ms above %.1f ms\n", summary[2][4] / 1000.0, limit_off);
+        failed = 1;
+    }
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+
+    if (csv_file) {
+        FILE* check = fopen(csv_file, "r");
+        int header = check == NULL;
+        if (check) fclose(check);
+        FILE* csv = fopen(csv_file, "a");
+        if (csv) {
+            if (header) {
+                fprintf(csv, "server,output,input,interval,count,min_us,p50_us,p90_us,p99_us,max_us,"
+                             "timeouts,not_visible,bounces,errors,result\n");
+            }
+            for (int s = 0; s < SERIES; s++) {
+                fprintf(csv, "%s,%u,%u,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%s\n", server_url, output, input,
+                        series_names[s], summary[s][0], summary[s][1], summary[s][2], summary[s][3],
+                        summary[s][4], summary[s][5], timeouts, not_visible, bounces, errors,
+                        failed ? "FAILED" : "PASSED");
+            }
+            fclose(csv);
+        }
+    }
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    return failed;
+}
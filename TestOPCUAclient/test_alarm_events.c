@@ -0,0 +1,368 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Limit alarm event check for the Alarms object (ns=1;s=alarms,
+// components/alarm_engine).
+// The tool subscribes to the events of Alarms (LimitAlarmEventType: Time,
+// SourceName, Severity, Message, LimitState, Value, Limit) and to
+// alarms.ActiveCount, runs for -d seconds and reports per channel the
+// transitions into each state and the event latency (arrival minus the
+// acquisition time in the event's Time field; the gateway clock must be
+// synchronized, see the Clock object).
+// The run fails if fewer events arrived than alarms.Transitions counted
+// while subscribed, if alarms.Dropped grew, or if the active alarms rebuilt
+// from alarms.States plus the events differ from alarms.ActiveCount.
+
+#define MAX_EVENTS   100000
+#define NUM_SOURCES  4
+#define NUM_STATES   5
+#define NUM_FIELDS   7
+
+static const char* state_names[NUM_STATES] = {"Normal", "Lo", "Hi", "LoLo", "HiHi"};
+static const char* field_names[NUM_FIELDS] = {"Time", "SourceName", "Severity", "Message",
+                                              "LimitState", "Value", "Limit"};
+
+typedef struct {
+    long count[NUM_STATES];
+    int state;
+} SourceResult;
+
+static SourceResult sources[NUM_SOURCES];
+static double* latency_ms;
+static long events;
+static long bad_events;
+static UA_UInt32 active_notified;
+static int quiet;
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int state_index(const UA_String* s) {
+    for (int i = 0; i < NUM_STATES; i++) {
+        if (s->length == strlen(state_names[i]) && memcmp(s->data, state_names[i], s->length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// "adc_channel_N" -> N-1
+static int source_index(const UA_String* s) {
+    if (s->length != 13 || memcmp(s->data, "adc_channel_", 12) != 0) return -1;
+    int n = s->data[12] - '1';
+    return (n >= 0 && n < NUM_SOURCES) ? n : -1;
+}
+
+static void on_event(UA_Client* client, UA_UInt32 subId, void* subContext, UA_UInt32 monId,
+                     void* monContext, size_t nEventFields, UA_Variant* eventFields) {
+    UA_DateTime now = UA_DateTime_now();
+    if (nEventFields != NUM_FIELDS ||
+        !UA_Variant_hasScalarType(&eventFields[0], &UA_TYPES[UA_TYPES_DATETIME]) ||
+        !UA_Variant_hasScalarType(&eventFields[1], &UA_TYPES[UA_TYPES_STRING]) ||
+        !UA_Variant_hasScalarType(&eventFields[2], &UA_TYPES[UA_TYPES_UINT16]) ||
+        !UA_Variant_hasScalarType(&eventFields[4], &UA_TYPES[UA_TYPES_STRING]) ||
+        !UA_Variant_hasScalarType(&eventFields[5], &UA_TYPES[UA_TYPES_UINT16]) ||
+        !UA_Variant_hasScalarType(&eventFields[6], &UA_TYPES[UA_TYPES_UINT16])) {
+        bad_events++;
+        return;
+    }
+    UA_DateTime time = *(UA_DateTime*)eventFields[0].data;
+    int source = source_index((UA_String*)eventFields[1].data);
+    int state = state_index((UA_String*)eventFields[4].data);
+    if (source < 0 || state < 0) {
+        bad_events++;
+        return;
+    }
+    sources[source].count[state]++;
+    sources[source].state = state;
+    if (events < MAX_EVENTS) {
+        latency_ms[events] = (double)(now - time) / UA_DATETIME_MSEC;
+    }
+    events++;
+
+    if (!quiet) {
+        UA_DateTimeStruct t = UA_DateTime_toStruct(time);
+        UA_String message = UA_STRING_NULL;
+        if (UA_Variant_hasScalarType(&eventFields[3], &UA_TYPES[UA_TYPES_LOCALIZEDTEXT])) {
+            message = ((UA_LocalizedText*)eventFields[3].data)->text;
+        }
+        printf("%02u:%02u:%02u.%03u  sev %3u  %.*s\n", t.hour, t.min, t.sec, t.milliSec,
+               *(UA_UInt16*)eventFields[2].data, (int)message.length, (const char*)message.data);
+    }
+}
+
+static void on_active_count(UA_Client* client, UA_UInt32 subId, void* subContext,
+                            UA_UInt32 monId, void* monContext, UA_DataValue* value) {
+    if (value->hasValue && UA_Variant_hasScalarType(&value->value, &UA_TYPES[UA_TYPES_UINT32])) {
+        active_notified = *(UA_UInt32*)value->value.data;
+    }
+}
+
+static int read_uint32(UA_Client* client, const char* id, UA_UInt32* out) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_UINT32]);
+    if (ok) *out = *(UA_UInt32*)value.data;
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+// Seed the per-channel state from alarms.States
+static int read_states(UA_Client* client) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    if (UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, "alarms.States"), &value) != UA_STATUSCODE_GOOD ||
+        !UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_STRING])) {
+        UA_Variant_clear(&value);
+        return 0;
+    }
+    UA_String* s = (UA_String*)value.data;
+    char json[256];
+    size_t len = s->length < sizeof(json) - 1 ? s->length : sizeof(json) - 1;
+    memcpy(json, s->data, len);
+    json[len] = '\0';
+    UA_Variant_clear(&value);
+
+    for (int i = 0; i < NUM_SOURCES; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "\"adc_channel_%d\":\"", i + 1);
+        const char* p = strstr(json, key);
+        sources[i].state = 0;
+        if (!p) continue;
+        p += strlen(key);
+        for (int k = 0; k < NUM_STATES; k++) {
+            size_t n = strlen(state_names[k]);
+            if (strncmp(p, state_names[k], n) == 0 && p[n] == '"') sources[i].state = k;
+        }
+    }
+    return 1;
+}
+
+static int active_from_events(void) {
+    int active = 0;
+    for (int i = 0; i < NUM_SOURCES; i++) active += sources[i].state != 0;
+    return active;
+}
+
+// Keep the client running for ms milliseconds
+static void run_for(UA_Client* client, int ms) {
+    UA_DateTime end = UA_DateTime_nowMonotonic() + (UA_DateTime)ms * UA_DATETIME_MSEC;
+    while (UA_DateTime_nowMonotonic() < end) {
+        UA_Client_run_iterate(client, 10);
+    }
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA LIMIT ALARM EVENT CHECK\n");
+    printf("==============================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -d, --duration SEC     Run time (default: 30)\n");
+    printf("  -i, --interval MS      Publishing interval of the subscription (default: 50)\n");
+    printf("  -q, --quiet            Do not print the events\n");
+    printf("  -t, --timeout MS       Request timeout (default: 2000)\n");
+    printf("  -o, --csv FILE         Also write the results as CSV\n");
+    printf("  -u, --user NAME        Username\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nExamples:\n");
+    printf("  %s opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -d 300 -q -o alarms.csv opc.tcp://10.0.0.128:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_url = "opc.tcp://10.0.0.128:4840";
+    const char* username = NULL;
+    const char* password = NULL;
+    const char* csv_file = NULL;
+    int duration_s = 30;
+    int interval_ms = 50;
+    UA_UInt32 timeout_ms = 2000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--duration") == 0) && i + 1 < argc) {
+            duration_s = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interval") == 0) && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0) {
+            quiet = 1;
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = (UA_UInt32)atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+
+    UA_Client* client = UA_Client_new();
+    UA_Client_getConfig(client)->timeout = timeout_ms;
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, server_url, username, password)
+        : UA_Client_connect(client, server_url);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection failed: %s\n", UA_StatusCode_name(status));
+        UA_Client_delete(client);
+        return 1;
+    }
+
+    UA_CreateSubscriptionRequest sreq = UA_CreateSubscriptionRequest_default();
+    sreq.requestedPublishingInterval = interval_ms;
+    UA_CreateSubscriptionResponse sresp = UA_Client_Subscriptions_create(client, sreq, NULL, NULL, NULL);
+    if (sresp.responseHeader.serviceResult != UA_STATUSCODE_GOOD) {
+        printf("CreateSubscription failed: %s\n", UA_StatusCode_name(sresp.responseHeader.serviceResult));
+        return 1;
+    }
+
+    // Standard fields from BaseEventType, the limit fields from the alarm event type
+    UA_SimpleAttributeOperand select[NUM_FIELDS];
+    UA_QualifiedName paths[NUM_FIELDS];
+    for (int i = 0; i < NUM_FIELDS; i++) {
+        UA_SimpleAttributeOperand_init(&select[i]);
+        select[i].attributeId = UA_ATTRIBUTEID_VALUE;
+        paths[i] = UA_QUALIFIEDNAME(i < 4 ? 0 : 1, (char*)field_names[i]);
+        select[i].browsePathSize = 1;
+        select[i].browsePath = &paths[i];
+        select[i].typeDefinitionId = i < 4 ? UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE)
+                                           : UA_NODEID_STRING(1, "alarms.LimitAlarmEventType");
+    }
+    UA_EventFilter filter;
+    UA_EventFilter_init(&filter);
+    filter.selectClausesSize = NUM_FIELDS;
+    filter.selectClauses = select;
+
+    UA_MonitoredItemCreateRequest ereq;
+    UA_MonitoredItemCreateRequest_init(&ereq);
+    ereq.itemToMonitor.nodeId = UA_NODEID_STRING(1, "alarms");
+    ereq.itemToMonitor.attributeId = UA_ATTRIBUTEID_EVENTNOTIFIER;
+    ereq.monitoringMode = UA_MONITORINGMODE_REPORTING;
+    ereq.requestedParameters.queueSize = 256;
+    ereq.requestedParameters.filter.encoding = UA_EXTENSIONOBJECT_DECODED;
+    ereq.requestedParameters.filter.content.decoded.type = &UA_TYPES[UA_TYPES_EVENTFILTER];
+    ereq.requestedParameters.filter.content.decoded.data = &filter;
+    UA_MonitoredItemCreateResult eres = UA_Client_MonitoredItems_createEvent(
+        client, sresp.subscriptionId, UA_TIMESTAMPSTORETURN_BOTH, ereq, NULL, on_event, NULL);
+    if (eres.statusCode != UA_STATUSCODE_GOOD) {
+        printf("Event monitored item on ns=1;s=alarms failed: %s\n", UA_StatusCode_name(eres.statusCode));
+        return 1;
+    }
+
+    UA_MonitoredItemCreateRequest areq =
+        UA_MonitoredItemCreateRequest_default(UA_NODEID_STRING(1, "alarms.ActiveCount"));
+    UA_MonitoredItemCreateResult ares = UA_Client_MonitoredItems_createDataChange(
+        client, sresp.subscriptionId, UA_TIMESTAMPSTORETURN_BOTH, areq, NULL, on_active_count, NULL);
+    if (ares.statusCode != UA_STATUSCODE_GOOD) {
+        printf("Monitored item on alarms.ActiveCount failed: %s\n", UA_StatusCode_name(ares.statusCode));
+        return 1;
+    }
+
+    // Counters from after the item exists: every later transition must arrive
+    UA_UInt32 transitions0 = 0, dropped0 = 0;
+    if (!read_uint32(client, "alarms.Transitions", &transitions0) ||
+        !read_uint32(client, "alarms.Dropped", &dropped0) || !read_states(client)) {
+        printf("Cannot read the Alarms object - gateway without the alarm engine?\n");
+        return 1;
+    }
+    latency_ms = malloc(MAX_EVENTS * sizeof(double));
+    printf("Subscription %u, publishing %.0f ms (revised), %d s, %d alarms active at start\n\n",
+           sresp.subscriptionId, sresp.revisedPublishingInterval, duration_s, active_from_events());
+
+    run_for(client, duration_s * 1000);
+
+    // Stop at a quiet moment: the counters must not move while the last
+    // events are delivered
+    UA_UInt32 transitions1 = 0, dropped1 = 0, active = 0, check = 0;
+    int settled = 0;
+    for (int attempt = 0; attempt < 20 && !settled; attempt++) {
+        read_uint32(client, "alarms.Transitions", &transitions1);
+        read_uint32(client, "alarms.ActiveCount", &active);
+        run_for(client, 3 * interval_ms + 100);
+        read_uint32(client, "alarms.Transitions", &check);
+        settled = check == transitions1;
+    }
+    read_uint32(client, "alarms.Dropped", &dropped1);
+
+    long expected = (long)(transitions1 - transitions0);
+    long stored = events < MAX_EVENTS ? events : MAX_EVENTS;
+    qsort(latency_ms, stored, sizeof(double), cmp_double);
+    double p50 = stored ? latency_ms[stored / 2] : 0.0;
+    double p99 = stored ? latency_ms[(stored * 99) / 100] : 0.0;
+    double max = stored ? latency_ms[stored - 1] : 0.0;
+    int rebuilt = active_from_events();
+
+    printf("\n%-14s", "source");
+    for (int k = 0; k < NUM_STATES; k++) printf(" %8s", state_names[k]);
+    printf(" %8s\n", "now");
+    for (int i = 0; i < NUM_SOURCES; i++) {
+        printf("adc_channel_%-2d", i + 1);
+        for (int k = 0; k < NUM_STATES; k++) printf(" %8ld", sources[i].count[k]);
+        printf(" %8s\n", state_names[sources[i].state]);
+    }
+    printf("\nEvents: %ld (expected %ld, malformed %ld), %.1f per minute\n", events, expected,
+           bad_events, duration_s > 0 ? events * 60.0 / duration_s : 0.0);
+    printf("Latency ms: p50 %.1f, p99 %.1f, max %.1f\n", p50, p99, max);
+    printf("ActiveCount: %u (notified %u), from events: %d, dropped: %u\n", active, active_notified,
+           rebuilt, dropped1 - dropped0);
+
+    int failed = 0;
+    if (events < expected) {
+        printf("FAIL: %ld transitions without an event\n", expected - events);
+        failed = 1;
+    }
+    if (bad_events > 0) {
+        printf("FAIL: events without the limit alarm fields\n");
+        failed = 1;
+    }
+    if (dropped1 != dropped0) {
+        printf("FAIL: the gateway dropped transitions\n");
+        failed = 1;
+    }
+    if (!settled) {
+        printf("FAIL: the alarms did not settle for the final check\n");
+        failed = 1;
+    } else if ((UA_UInt32)rebuilt != active) {
+        printf("FAIL: active alarms from the events differ from ActiveCount\n");
+        failed = 1;
+    }
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+
+    if (csv_file) {
+        FILE* csv = fopen(csv_file, "w");
+        if (csv) {
+            fprintf(csv, "source,normal,lo,hi,lolo,hihi,state\n");
+            for (int i = 0; i < NUM_SOURCES; i++) {
+                fprintf(csv, "adc_channel_%d", i + 1);
+                for (int k = 0; k < NUM_STATES; k++) fprintf(csv, ",%ld", sources[i].count[k]);
+                fprintf(csv, ",%s\n", state_names[sources[i].state]);
+            }
+            fprintf(csv, "\nevents,expected,malformed,latency_p50_ms,latency_p99_ms,latency_max_ms,active,dropped\n");
+            fprintf(csv, "%ld,%ld,%ld,%.1f,%.1f,%.1f,%u,%u\n", events, expected, bad_events, p50, p99,
+                    max, active, dropped1 - dropped0);
+            fclose(csv);
+        }
+    }
+
+    free(latency_ms);
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    return failed;
+}
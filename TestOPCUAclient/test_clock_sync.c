@@ -0,0 +1,388 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Disciplined clock check for the Clock object (ns=1;s=clock,
+// components/clock_service).
+// The tool runs its own NTP server (the stand-in) on -p PORT; the gateway has
+// to use it as its only time server. The stand-in's reference time is the
+// local system time plus an offset and a frequency error that the phases
+// change:
+//   unsynced  stand-in silent, the gateway runs on its own time
+//   sync      stand-in answers with offset -O ms (the gateway steps once)
+//   drift     reference runs -r ppm fast (the gateway learns the frequency)
+//   slew      reference jumps by -j ms, below the step threshold
+//   outage    stand-in silent (holdover on the learned frequency)
+//   recovery  stand-in answers again
+// Every -i ms the tool reads the Clock variables with server timestamps and
+// compares each server timestamp with the reference during the round trip
+// (errors within half the round trip count as zero). Per phase it reports the
+// final Clock state, the error over the whole phase and over its second half,
+// the largest backward jump of the server timestamps and the Clock steps. A backward jump outside the sync
+// phase, or a phase that does not end in the expected state, fails the run.
+
+#define NTP_UNIX_OFFSET_S 2208988800ULL
+
+typedef struct {
+    const char* name;
+    const char* expected;
+    char status[16];
+    double err_max_ms, err_settled_ms, err_final_ms;
+    double backward_ms;
+    double offset_ms, drift_ppm, bound_ms;
+    unsigned steps;
+    int samples;
+} PhaseResult;
+
+// Stand-in state, changed by the main thread
+static pthread_mutex_t ref_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile int standin_run = 1;
+static int standin_answer = 0;
+static double ref_offset_us = 0;     // reference - system time at ref_base_us
+static double ref_drift_ppm = 0;
+static double ref_base_us = 0;       // monotonic time the drift counts from
+static long standin_requests;
+
+static UA_UInt32 timeout_ms = 2000;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double system_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Reference time in Unix microseconds
+static double reference_us(void) {
+    pthread_mutex_lock(&ref_lock);
+    double mono = now_us();
+    double ref = system_us() + ref_offset_us + (mono - ref_base_us) * ref_drift_ppm / 1e6;
+    pthread_mutex_unlock(&ref_lock);
+    return ref;
+}
+
+// Change the reference without a jump in time other than add_us
+static void set_reference(double add_us, double drift_ppm) {
+    pthread_mutex_lock(&ref_lock);
+    double mono = now_us();
+    ref_offset_us += (mono - ref_base_us) * ref_drift_ppm / 1e6 + add_us;
+    ref_base_us = mono;
+    ref_drift_ppm = drift_ppm;
+    pthread_mutex_unlock(&ref_lock);
+}
+
+static void set_answer(int answer) {
+    pthread_mutex_lock(&ref_lock);
+    standin_answer = answer;
+    pthread_mutex_unlock(&ref_lock);
+}
+
+static void put_ntp(unsigned char* p, double unix_us) {
+    unsigned long long us = (unsigned long long)unix_us;
+    unsigned int seconds = (unsigned int)(us / 1000000 + NTP_UNIX_OFFSET_S);
+    unsigned int fraction = (unsigned int)(((us % 1000000) << 32) / 1000000);
+    for (int i = 0; i < 4; i++) {
+        p[i] = (unsigned char)(seconds >> (24 - 8 * i));
+        p[4 + i] = (unsigned char)(fraction >> (24 - 8 * i));
+    }
+}
+
+// NTP server (RFC 5905 server mode, stratum 1)
+static void* standin_thread(void* arg) {
+    int sock = *(int*)arg;
+    unsigned char packet[48];
+    while (standin_run) {
+        struct sockaddr_in from;
+        socklen_t fromlen = sizeof(from);
+        ssize_t len = recvfrom(sock, packet, sizeof(packet), 0, (struct sockaddr*)&from, &fromlen);
+        if (len < 48 || (packet[0] & 0x07) != 3) continue;
+        double received = reference_us();
+        pthread_mutex_lock(&ref_lock);
+        int answer = standin_answer;
+        standin_requests++;
+        pthread_mutex_unlock(&ref_lock);
+        if (!answer) continue;
+
+        unsigned char reply[48] = {0};
+        reply[0] = (0 << 6) | (4 << 3) | 4;     // LI 0, version 4, server
+        reply[1] = 1;                           // stratum
+        reply[2] = packet[2];
+        reply[3] = (unsigned char)-20;          // precision ~1 us
+        memcpy(&reply[12], "LOCL", 4);
+        put_ntp(&reply[16], received);          // reference timestamp
+        memcpy(&reply[24], &packet[40], 8);     // origin = client transmit
+        put_ntp(&reply[32], received);
+        put_ntp(&reply[40], reference_us());
+        sendto(sock, reply, sizeof(reply), 0, (struct sockaddr*)&from, fromlen);
+    }
+    return NULL;
+}
+
+static UA_Client* connect_session(const char* url, const char* username, const char* password) {
+    UA_Client* client = UA_Client_new();
+    UA_Client_getConfig(client)->timeout = timeout_ms;
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, url, username, password)
+        : UA_Client_connect(client, url);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection failed: %s\n", UA_StatusCode_name(status));
+        UA_Client_delete(client);
+        return NULL;
+    }
+    return client;
+}
+
+// One read of the Clock variables
+typedef struct {
+    char status[16];
+    double offset_ms, drift_ppm, bound_ms;
+    unsigned steps;
+    double error_us;       // server timestamp - reference beyond half the round trip
+    double server_us;      // server timestamp, Unix microseconds
+} ClockSample;
+
+static int read_clock(UA_Client* client, ClockSample* s) {
+    const char* ids[5] = {"clock.Status", "clock.Offset", "clock.Drift", "clock.ErrorBound", "clock.Steps"};
+    UA_ReadValueId items[5];
+    for (int i = 0; i < 5; i++) {
+        UA_ReadValueId_init(&items[i]);
+        items[i].nodeId = UA_NODEID_STRING(1, (char*)ids[i]);
+        items[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    UA_ReadRequest req;
+    UA_ReadRequest_init(&req);
+    req.nodesToRead = items;
+    req.nodesToReadSize = 5;
+    req.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+
+    double t0 = reference_us();
+    UA_ReadResponse resp = UA_Client_Service_read(client, req);
+    double t1 = reference_us();
+    int ok = resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD && resp.resultsSize == 5;
+    for (int i = 0; ok && i < 5; i++) {
+        ok = resp.results[i].hasValue && resp.results[i].hasServerTimestamp;
+    }
+    if (ok) {
+        UA_DataValue* r = resp.results;
+        UA_String* status = (UA_String*)r[0].value.data;
+        size_t len = status->length < sizeof(s->status) - 1 ? status->length : sizeof(s->status) - 1;
+        memcpy(s->status, status->data, len);
+        s->status[len] = '\0';
+        s->offset_ms = *(UA_Double*)r[1].value.data;
+        s->drift_ppm = *(UA_Double*)r[2].value.data;
+        s->bound_ms = *(UA_Double*)r[3].value.data;
+        s->steps = *(UA_UInt32*)r[4].value.data;
+        s->server_us = (double)(r[0].serverTimestamp - UA_DATETIME_UNIX_EPOCH) / UA_DATETIME_USEC;
+        // The server took its timestamp somewhere within the round trip
+        double error = s->server_us - (t0 + t1) / 2;
+        double margin = (t1 - t0) / 2;
+        s->error_us = error > margin ? error - margin : error < -margin ? error + margin : 0;
+    }
+    UA_ReadResponse_clear(&resp);
+    return ok;
+}
+
+// Sample the Clock for duration_s
+static int measure(UA_Client* client, PhaseResult* r, int duration_s, int interval_ms,
+                   double* last_server_us) {
+    double t0 = now_us();
+    double end = t0 + duration_s * 1e6;
+    double half = t0 + duration_s * 0.5e6;
+    ClockSample s;
+    memset(&s, 0, sizeof(s));
+    while (now_us() < end) {
+        if (!read_clock(client, &s)) {
+            printf("Reading the Clock variables failed - gateway without the Clock object?\n");
+            return 0;
+        }
+        double err = s.error_us < 0 ? -s.error_us : s.error_us;
+        if (err / 1000.0 > r->err_max_ms) r->err_max_ms = err / 1000.0;
+        if (now_us() >= half && err / 1000.0 > r->err_settled_ms) r->err_settled_ms = err / 1000.0;
+        if (*last_server_us > 0 && *last_server_us - s.server_us > r->backward_ms * 1000.0) {
+            r->backward_ms = (*last_server_us - s.server_us) / 1000.0;
+        }
+        *last_server_us = s.server_us;
+        r->samples++;
+        usleep(interval_ms * 1000);
+    }
+    snprintf(r->status, sizeof(r->status), "%s", s.status);
+    r->err_final_ms = (s.error_us < 0 ? -s.error_us : s.error_us) / 1000.0;
+    r->offset_ms = s.offset_ms;
+    r->drift_ppm = s.drift_ppm;
+    r->bound_ms = s.bound_ms;
+    r->steps = s.steps;
+    return 1;
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA DISCIPLINED CLOCK CHECK\n");
+    printf("==============================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -p, --port PORT        UDP port of the NTP stand-in (default: 123)\n");
+    printf("  -O, --offset MS        Reference offset of the sync phase (default: 2000)\n");
+    printf("  -r, --drift PPM        Reference frequency error from the drift phase on (default: 100)\n");
+    printf("  -j, --jump MS          Reference jump of the slew phase (default: 10)\n");
+    printf("  -d, --duration SEC     Length of each phase (default: 20)\n");
+    printf("  -D, --drift-time SEC   Length of the drift phase (default: 60)\n");
+    printf("  -i, --interval MS      Read interval (default: 100)\n");
+    printf("  -t, --timeout MS       Request timeout (default: 2000)\n");
+    printf("  -o, --csv FILE         Also write the results as CSV\n");
+    printf("  -u, --user NAME        Username\n");
+    printf("  -P, --pass PASSWORD    Password\n");
+    printf("\nThe gateway must use this host as its only NTP server (time.ntp_server1,\n");
+    printf("the other two empty) with a short time.sync_interval, e.g. 16 s.\n");
+    printf("Port 123 needs root (or CAP_NET_BIND_SERVICE).\n");
+    printf("\nExamples:\n");
+    printf("  sudo %s opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  sudo %s -r 50 -D 300 -o clock.csv opc.tcp://10.0.0.128:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_url = "opc.tcp://10.0.0.128:4840";
+    const char* username = NULL;
+    const char* password = NULL;
+    const char* csv_file = NULL;
+    int port = 123;
+    double offset_ms = 2000;
+    double drift_ppm = 100;
+    double jump_ms = 10;
+    int duration_s = 20;
+    int drift_s = 60;
+    int interval_ms = 100;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--port") == 0) && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-O") == 0 || strcmp(argv[i], "--offset") == 0) && i + 1 < argc) {
+            offset_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--drift") == 0) && i + 1 < argc) {
+            drift_ppm = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jump") == 0) && i + 1 < argc) {
+            jump_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--duration") == 0) && i + 1 < argc) {
+            duration_s = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-D") == 0 || strcmp(argv[i], "--drift-time") == 0) && i + 1 < argc) {
+            drift_s = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interval") == 0) && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = (UA_UInt32)atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (interval_ms < 1) interval_ms = 1;
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        printf("Cannot bind the NTP stand-in to UDP port %d\n", port);
+        return 1;
+    }
+    struct timeval tv = {0, 200000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ref_base_us = now_us();
+    pthread_t th;
+    pthread_create(&th, NULL, standin_thread, &sock);
+
+    UA_Client* client = connect_session(server_url, username, password);
+    if (!client) return 1;
+
+    printf("NTP stand-in on UDP port %d, %d s per phase, drift phase %d s\n\n", port, duration_s, drift_s);
+
+    PhaseResult results[6];
+    memset(results, 0, sizeof(results));
+    const char* names[6] = {"unsynced", "sync", "drift", "slew", "outage", "recovery"};
+    const char* expected[6] = {"unsynced", "synced", "synced", "synced", "holdover", "synced"};
+    double last_server_us = 0;
+    int failed = 0;
+
+    for (int p = 0; p < 6 && !failed; p++) {
+        PhaseResult* r = &results[p];
+        r->name = names[p];
+        r->expected = expected[p];
+        switch (p) {
+        case 1: set_reference(offset_ms * 1000.0, 0); set_answer(1); break;
+        case 2: set_reference(0, drift_ppm); break;
+        case 3: set_reference(jump_ms * 1000.0, drift_ppm); break;
+        case 4: set_answer(0); break;
+        case 5: set_answer(1); break;
+        }
+        if (!measure(client, r, p == 2 ? drift_s : duration_s, interval_ms, &last_server_us)) {
+            failed = 1;
+        }
+    }
+    int nres = failed ? 0 : 6;
+
+    printf("%-9s %-9s %10s %10s %10s %10s %9s %9s %9s %6s\n", "phase", "state", "err max",
+           "err 2nd", "err end", "backward", "offset", "drift", "bound", "steps");
+    printf("%-9s %-9s %10s %10s %10s %10s %9s %9s %9s %6s\n", "", "", "ms", "half ms", "ms", "ms",
+           "ms", "ppm", "ms", "");
+    for (int i = 0; i < nres; i++) {
+        PhaseResult* r = &results[i];
+        int bad_state = r->expected && strcmp(r->status, r->expected) != 0;
+        // The first sync steps the clock; every later phase must stay monotonic
+        int bad_jump = i != 1 && r->backward_ms > 0;
+        failed |= bad_state || bad_jump;
+        printf("%-9s %-9s %10.3f %10.3f %10.3f %10.3f %9.3f %9.2f %9.3f %6u%s%s\n", r->name, r->status,
+               r->err_max_ms, r->err_settled_ms, r->err_final_ms, r->backward_ms, r->offset_ms,
+               r->drift_ppm, r->bound_ms, r->steps, bad_state ? "  WRONG STATE" : "",
+               bad_jump ? "  BACKWARD" : "");
+    }
+    printf("\nNTP requests seen by the stand-in: %ld\n", standin_requests);
+    if (nres) printf("Result: %s\n", failed ? "FAILED" : "passed");
+
+    if (csv_file && nres) {
+        FILE* csv = fopen(csv_file, "w");
+        if (csv) {
+            fprintf(csv, "phase,state,err_max_ms,err_settled_ms,err_final_ms,backward_ms,"
+                         "offset_ms,drift_ppm,bound_ms,steps,samples\n");
+            for (int i = 0; i < nres; i++) {
+                PhaseResult* r = &results[i];
+                fprintf(csv, "%s,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%.3f,%u,%d\n", r->name, r->status,
+                        r->err_max_ms, r->err_settled_ms, r->err_final_ms, r->backward_ms,
+                        r->offset_ms, r->drift_ppm, r->bound_ms, r->steps, r->samples);
+            }
+            fclose(csv);
+        }
+    }
+
+    standin_run = 0;
+    pthread_join(th, NULL);
+    close(sock);
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    return failed ? 1 : 0;
+}
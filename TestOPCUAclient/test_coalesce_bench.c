@@ -0,0 +1,564 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Packets per response and throughput over a lossy link.
+// The client reaches the gateway through a link emulator built into this
+// tool. Towards the client every TCP segment the gateway sends costs a fixed
+// airtime plus its bytes at the link rate, and is lost with the given
+// probability; a lost segment holds everything behind it for the retransmit
+// delay. The emulator reads the segments the gateway sent from TCP_INFO of
+// its upstream socket and finds the OPC UA chunks by their headers, so the
+// packets per response are exact and need nothing on the gateway side.
+//
+// The session keeps a number of Reads outstanding and has a subscription
+// publishing a few tags, so the gateway answers several requests and a
+// Publish in the same loop iteration. With coalesced sending these leave in
+// fewer segments; every segment saved is one less chance to be lost.
+//
+// Linux only (TCP_INFO, tcpi_data_segs_in). The loss model runs in user
+// space, so no tc/netem is needed.
+
+#define MAX_DEPTH   64
+#define MAX_PHASES  8
+#define RELAY_BUF   65536
+
+// Link model, changed between phases while the session stays connected
+static volatile double link_loss;       // Probability per segment
+static double airtime_us = 200.0;       // Fixed cost per segment
+static double rate_kbps = 2000.0;       // Link rate
+static double retransmit_ms = 200.0;    // Delay added by a lost segment
+
+// Link counters (downstream thread), reset per phase
+static volatile long link_segments;
+static volatile long link_chunks;
+static volatile long link_bytes;
+static volatile long link_lost;
+
+// Emulator sockets
+static int listen_fd = -1;
+static struct sockaddr_in gateway_addr;
+
+// Read workload (main thread)
+static int depth = 8;
+static int inflight;
+static long reads_done;
+static long read_errors;
+static long notifications;
+static double* samples;
+static int sample_count;
+static int sample_capacity;
+static UA_UInt32 timeout_ms = 5000;
+
+typedef struct {
+    int phase;
+    double loss;
+    long reads;
+    long chunks;
+    long segments;
+    double seg_per_chunk;
+    double reads_per_s;
+    double p50, p99;
+    long lost;
+    long errors;
+} PhaseResult;
+
+// Monotonic time in microseconds
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int count, double p) {
+    if (count == 0) return 0.0;
+    int idx = (int)(count * p);
+    if (idx >= count) idx = count - 1;
+    return sorted[idx];
+}
+
+// ========== LINK EMULATOR ==========
+
+typedef struct {
+    int client_fd;
+    int gateway_fd;
+} RelayPair;
+
+static int send_all(int fd, const unsigned char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Client to gateway: requests pass unchanged
+static void* relay_up(void* arg) {
+    RelayPair* p = (RelayPair*)arg;
+    unsigned char* buf = malloc(RELAY_BUF);
+    for (;;) {
+        ssize_t n = recv(p->client_fd, buf, RELAY_BUF, 0);
+        if (n <= 0 || send_all(p->gateway_fd, buf, (size_t)n) < 0) break;
+    }
+    shutdown(p->gateway_fd, SHUT_RDWR);
+    free(buf);
+    return NULL;
+}
+
+// struct tcp_info of glibc ends at tcpi_total_retrans; the kernel (4.6 and
+// later) continues with these fields. <linux/tcp.h> cannot be included next
+// to <netinet/tcp.h>.
+typedef struct {
+    struct tcp_info base;
+    uint64_t pacing_rate;
+    uint64_t max_pacing_rate;
+    uint64_t bytes_acked;
+    uint64_t bytes_received;
+    uint32_t segs_out;
+    uint32_t segs_in;
+    uint32_t notsent_bytes;
+    uint32_t min_rtt;
+    uint32_t data_segs_in;
+    uint32_t data_segs_out;
+} TcpInfoExt;
+
+// Segments with payload received on the socket
+static unsigned data_segs_in(int fd) {
+    TcpInfoExt ti;
+    socklen_t len = sizeof(ti);
+    memset(&ti, 0, sizeof(ti));
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &ti, &len) < 0) return 0;
+    return ti.data_segs_in;
+}
+
+// Gateway to client: every segment crosses the emulated link
+static void* relay_down(void* arg) {
+    RelayPair* p = (RelayPair*)arg;
+    unsigned char* buf = malloc(RELAY_BUF);
+    unsigned char header[8];
+    size_t header_have = 0;
+    size_t chunk_left = 0;
+    unsigned segs_before = data_segs_in(p->gateway_fd);
+    double link_free = now_us();
+
+    for (;;) {
+        ssize_t n = recv(p->gateway_fd, buf, RELAY_BUF, 0);
+        if (n <= 0) break;
+        unsigned segs_now = data_segs_in(p->gateway_fd);
+        long segs = (long)(segs_now - segs_before);
+        segs_before = segs_now;
+        if (segs < 1) segs = 1;
+
+        // Chunk boundaries: messageType(3) + chunkType(1) + messageSize(4)
+        for (ssize_t i = 0; i < n;) {
+            if (chunk_left > 0) {
+                size_t take = chunk_left < (size_t)(n - i) ? chunk_left : (size_t)(n - i);
+                chunk_left -= take;
+                i += (ssize_t)take;
+                continue;
+            }
+            header[header_have++] = buf[i++];
+            if (header_have == 8) {
+                size_t size = (size_t)header[4] | ((size_t)header[5] << 8) |
+                              ((size_t)header[6] << 16) | ((size_t)header[7] << 24);
+                chunk_left = size > 8 ? size - 8 : 0;
+                header_have = 0;
+                link_chunks++;
+            }
+        }
+
+        // Airtime of the segments, then the retransmit delay of every lost one
+        double cost = segs * airtime_us + n * 8000.0 / rate_kbps;
+        for (long s = 0; s < segs; s++) {
+            if ((double)rand() / RAND_MAX < link_loss) {
+                cost += retransmit_ms * 1000.0;
+                link_lost++;
+            }
+        }
+        double t = now_us();
+        if (link_free < t) link_free = t;
+        link_free += cost;
+        double wait = link_free - now_us();
+        if (wait > 0) usleep((useconds_t)wait);
+
+        link_segments += segs;
+        link_bytes += n;
+        if (send_all(p->client_fd, buf, (size_t)n) < 0) break;
+    }
+    shutdown(p->client_fd, SHUT_RDWR);
+    free(buf);
+    return NULL;
+}
+
+static void* relay_accept(void* arg) {
+    (void)arg;
+    for (;;) {
+        int cfd = accept(listen_fd, NULL, NULL);
+        if (cfd < 0) break;
+        int gfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(gfd, (struct sockaddr*)&gateway_addr, sizeof(gateway_addr)) < 0) {
+            printf("Link emulator: cannot reach the gateway: %s\n", strerror(errno));
+            close(gfd);
+            close(cfd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(gfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        RelayPair* p = malloc(sizeof(RelayPair));
+        p->client_fd = cfd;
+        p->gateway_fd = gfd;
+        pthread_t up, down;
+        pthread_create(&up, NULL, relay_up, p);
+        pthread_create(&down, NULL, relay_down, p);
+        pthread_detach(up);
+        pthread_detach(down);
+    }
+    return NULL;
+}
+
+// Start the emulator in front of opc.tcp://host:port, returns the local port
+static int start_link(const char* url) {
+    char host[128];
+    int port = 4840;
+    if (sscanf(url, "opc.tcp://%127[^:/]:%d", host, &port) < 1) {
+        printf("Cannot parse server URL: %s\n", url);
+        return -1;
+    }
+    struct addrinfo hints, *ai;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, NULL, &hints, &ai) != 0) {
+        printf("Cannot resolve %s\n", host);
+        return -1;
+    }
+    memcpy(&gateway_addr, ai->ai_addr, sizeof(gateway_addr));
+    gateway_addr.sin_port = htons((uint16_t)port);
+    freeaddrinfo(ai);
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(local);
+    if (bind(listen_fd, (struct sockaddr*)&local, sizeof(local)) < 0 || listen(listen_fd, 4) < 0 ||
+        getsockname(listen_fd, (struct sockaddr*)&local, &len) < 0) {
+        printf("Link emulator: %s\n", strerror(errno));
+        return -1;
+    }
+    pthread_t th;
+    pthread_create(&th, NULL, relay_accept, NULL);
+    pthread_detach(th);
+    return ntohs(local.sin_port);
+}
+
+// ========== WORKLOAD ==========
+
+static UA_ReadValueId read_id;
+static UA_ReadRequest read_req;
+
+static void on_read_response(UA_Client* client, void* userdata, UA_UInt32 requestId, void* response) {
+    UA_ReadResponse* rr = (UA_ReadResponse*)response;
+    double ms = (now_us() - *(double*)userdata) / 1000.0;
+    free(userdata);
+    inflight--;
+    if (rr->responseHeader.serviceResult != UA_STATUSCODE_GOOD) {
+        read_errors++;
+        return;
+    }
+    reads_done++;
+    if (sample_count == sample_capacity) {
+        sample_capacity = sample_capacity ? sample_capacity * 2 : 4096;
+        samples = realloc(samples, sample_capacity * sizeof(double));
+    }
+    samples[sample_count++] = ms;
+}
+
+static void send_read(UA_Client* client) {
+    double* sent = malloc(sizeof(double));
+    *sent = now_us();
+    if (__UA_Client_AsyncServiceEx(client, &read_req, &UA_TYPES[UA_TYPES_READREQUEST], on_read_response,
+                                   &UA_TYPES[UA_TYPES_READRESPONSE], sent, NULL,
+                                   timeout_ms) == UA_STATUSCODE_GOOD) {
+        inflight++;
+    } else {
+        free(sent);
+        read_errors++;
+    }
+}
+
+static void on_data_change(UA_Client* client, UA_UInt32 subId, void* subContext, UA_UInt32 monId,
+                           void* monContext, UA_DataValue* value) {
+    notifications++;
+}
+
+static void run_phase(UA_Client* client, double duration_s, PhaseResult* r) {
+    link_segments = link_chunks = link_bytes = link_lost = 0;
+    reads_done = read_errors = 0;
+    sample_count = 0;
+    double t0 = now_us();
+    double end = t0 + duration_s * 1e6;
+    while (now_us() < end) {
+        while (inflight < depth) {
+            int before = inflight;
+            send_read(client);
+            if (inflight == before) break;
+        }
+        UA_Client_run_iterate(client, 1);
+    }
+    double span_s = (now_us() - t0) / 1e6;
+
+    // Counted at the end of the span; responses still on the link belong to
+    // the next phase
+    r->reads = reads_done;
+    r->chunks = link_chunks;
+    r->segments = link_segments;
+    r->lost = link_lost;
+    r->errors = read_errors;
+    r->seg_per_chunk = r->chunks ? (double)r->segments / r->chunks : 0.0;
+    r->reads_per_s = span_s > 0 ? reads_done / span_s : 0.0;
+    qsort(samples, sample_count, sizeof(double), cmp_double);
+    r->p50 = percentile(samples, sample_count, 0.50);
+    r->p99 = percentile(samples, sample_count, 0.99);
+}
+
+// Row of a previous -o run whose first column (phase) equals key
+static int baseline_row(const char* path, int key, double* cols, int ncols) {
+    FILE* f = path ? fopen(path, "r") : NULL;
+    if (!f) return 0;
+    char line[256];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), f)) {
+        double v[12];
+        int n = 0;
+        char* p = line;
+        while (n < 12) {
+            char* end;
+            v[n] = strtod(p, &end);
+            if (end == p) break;
+            n++;
+            if (*end != ',') break;
+            p = end + 1;
+        }
+        if (n >= ncols && (int)v[0] == key) {
+            memcpy(cols, v, ncols * sizeof(double));
+            found = 1;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA PACKETS PER RESPONSE OVER A LOSSY LINK\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -q, --depth N          Outstanding Reads (default: 8)\n");
+    printf("  -s, --publish MS       Publishing interval of the subscription, 0 = none (default: 50)\n");
+    printf("  -l, --loss LIST        Segment loss in percent, one phase each (default: 0,1,3)\n");
+    printf("  -a, --airtime US       Fixed cost per segment (default: 200)\n");
+    printf("  -r, --rate KBIT        Link rate (default: 2000)\n");
+    printf("  -R, --retransmit MS    Delay added by a lost segment (default: 200)\n");
+    printf("  -d, --duration SEC     Duration of each phase (default: 10)\n");
+    printf("  -t, --timeout MS       Request timeout (default: 5000)\n");
+    printf("  -o, --csv FILE         Also write the results as CSV\n");
+    printf("  -b, --baseline FILE    Compare with the CSV of a previous run\n");
+    printf("  -u, --user NAME        Username\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nExamples:\n");
+    printf("  %s opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -q 16 -l 0,2,5 -o direct.csv opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -q 16 -l 0,2,5 -b direct.csv opc.tcp://10.0.0.128:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    // Default values
+    char* server_url = "opc.tcp://10.0.0.128:4840";
+    const char* loss_list = "0,1,3";
+    double publish_ms = 50.0;
+    double duration = 10.0;
+    const char* csv_file = NULL;
+    const char* baseline_file = NULL;
+    const char* username = NULL;
+    const char* password = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--depth") == 0) && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--publish") == 0) && i + 1 < argc) {
+            publish_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--loss") == 0) && i + 1 < argc) {
+            loss_list = argv[++i];
+        } else if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--airtime") == 0) && i + 1 < argc) {
+            airtime_us = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rate") == 0) && i + 1 < argc) {
+            rate_kbps = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-R") == 0 || strcmp(argv[i], "--retransmit") == 0) && i + 1 < argc) {
+            retransmit_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--duration") == 0) && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = (UA_UInt32)atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--baseline") == 0) && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (depth < 1) depth = 1;
+    if (depth > MAX_DEPTH) depth = MAX_DEPTH;
+    if (duration < 1.0) duration = 1.0;
+    if (rate_kbps < 1.0) rate_kbps = 1.0;
+    if (timeout_ms < 100) timeout_ms = 100;
+
+    double losses[MAX_PHASES];
+    int nphases = 0;
+    for (const char* p = loss_list; *p && nphases < MAX_PHASES;) {
+        char* end;
+        losses[nphases++] = strtod(p, &end) / 100.0;
+        if (*end != ',') break;
+        p = end + 1;
+    }
+
+    printf("=============================================\n");
+    printf("   PACKETS PER RESPONSE OVER A LOSSY LINK\n");
+    printf("   Server: %s\n", server_url);
+    printf("   %d outstanding Read(s) of diagnostic_counter", depth);
+    if (publish_ms > 0) printf(", subscription every %.0f ms", publish_ms);
+    printf("\n   Link: %.0f us/segment + %.0f kbit/s, %.0f ms per lost segment\n", airtime_us, rate_kbps,
+           retransmit_ms);
+    printf("   %.1f s per phase\n", duration);
+    printf("=============================================\n\n");
+
+    // ========== SESSION ==========
+    int port = start_link(server_url);
+    if (port < 0) return 1;
+    char link_url[64];
+    snprintf(link_url, sizeof(link_url), "opc.tcp://127.0.0.1:%d", port);
+
+    UA_Client* client = UA_Client_new();
+    UA_Client_getConfig(client)->timeout = timeout_ms;
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, link_url, username, password)
+        : UA_Client_connect(client, link_url);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection failed: %s\n", UA_StatusCode_name(status));
+        UA_Client_delete(client);
+        return 1;
+    }
+
+    if (publish_ms > 0) {
+        const char* tags[] = { "adc_channel_1", "adc_channel_2", "adc_channel_3", "adc_channel_4",
+                               "discrete_inputs" };
+        UA_CreateSubscriptionRequest sreq = UA_CreateSubscriptionRequest_default();
+        sreq.requestedPublishingInterval = publish_ms;
+        UA_CreateSubscriptionResponse sresp = UA_Client_Subscriptions_create(client, sreq, NULL, NULL, NULL);
+        for (int i = 0; i < 5 && sresp.responseHeader.serviceResult == UA_STATUSCODE_GOOD; i++) {
+            UA_MonitoredItemCreateRequest item =
+                UA_MonitoredItemCreateRequest_default(UA_NODEID_STRING(1, (char*)tags[i]));
+            item.requestedParameters.samplingInterval = publish_ms;
+            UA_Client_MonitoredItems_createDataChange(client, sresp.subscriptionId, UA_TIMESTAMPSTORETURN_BOTH,
+                                                      item, NULL, on_data_change, NULL);
+        }
+    }
+
+    UA_ReadValueId_init(&read_id);
+    read_id.nodeId = UA_NODEID_STRING(1, "diagnostic_counter");
+    read_id.attributeId = UA_ATTRIBUTEID_VALUE;
+    UA_ReadRequest_init(&read_req);
+    read_req.nodesToRead = &read_id;
+    read_req.nodesToReadSize = 1;
+    read_req.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+
+    // ========== PHASES ==========
+    PhaseResult results[MAX_PHASES];
+    FILE* csv = csv_file ? fopen(csv_file, "w") : NULL;
+    if (csv) fprintf(csv, "phase,loss_pct,reads,chunks,segments,seg_per_chunk,reads_per_s,p50_ms,p99_ms,lost,errors\n");
+
+    printf("%-7s %6s %8s %8s %8s %8s %9s %8s %8s %6s\n", "loss %", "reads", "chunks", "segments", "seg/chunk",
+           "reads/s", "p50 ms", "p99 ms", "lost", "errors");
+    printf("--------------------------------------------------------------------------------------\n");
+    for (int ph = 0; ph < nphases; ph++) {
+        PhaseResult* r = &results[ph];
+        link_loss = losses[ph];
+        r->phase = ph;
+        r->loss = losses[ph] * 100.0;
+        run_phase(client, duration, r);
+        printf("%-7.1f %6ld %8ld %8ld %8.2f %8.1f %9.2f %8.2f %8ld %6ld\n", r->loss, r->reads, r->chunks,
+               r->segments, r->seg_per_chunk, r->reads_per_s, r->p50, r->p99, r->lost, r->errors);
+        double b[9];
+        if (baseline_row(baseline_file, ph, b, 9)) {
+            printf("        vs base  seg/chunk %.2f -> %.2f  reads/s %.1f -> %.1f  p99 %.2f -> %.2f ms\n", b[5],
+                   r->seg_per_chunk, b[6], r->reads_per_s, b[8], r->p99);
+        }
+        fflush(stdout);
+        if (csv) {
+            fprintf(csv, "%d,%.1f,%ld,%ld,%ld,%.3f,%.1f,%.3f,%.3f,%ld,%ld\n", ph, r->loss, r->reads, r->chunks,
+                    r->segments, r->seg_per_chunk, r->reads_per_s, r->p50, r->p99, r->lost, r->errors);
+        }
+    }
+    if (csv) fclose(csv);
+
+    // Let the outstanding Reads finish before the session is closed
+    link_loss = 0.0;
+    double end = now_us() + timeout_ms * 1000.0;
+    while (inflight > 0 && now_us() < end) UA_Client_run_iterate(client, 1);
+
+    // ========== SUMMARY ==========
+    printf("\n=== SUMMARY ===\n");
+    printf("Segments per chunk:   %.2f (1.00 = one send per response)\n", results[0].seg_per_chunk);
+    printf("Notifications:        %ld\n", notifications);
+    printf("The gateway reports the chunks per sendmsg() on /metrics\n");
+    printf("(a16_opcua_tx_chunks_total, a16_opcua_tx_flushes_total).\n");
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    free(samples);
+    printf("\n=== TEST COMPLETED ===\n");
+    return 0;
+}
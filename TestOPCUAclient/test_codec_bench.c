@@ -0,0 +1,1120 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Host micro-benchmark for the open62541 hot paths of the gateway.
+// Measures ns/op, allocations/op and allocated bytes/op for:
+//   - UA_decodeBinary / UA_encodeBinary of the gateway's real messages
+//     (9-node ReadRequest and its response, UInt16 WriteRequest and its
+//     response, PublishResponse with 6 DataChanges)
+//   - the complete server path of a Read and a Write message chunk:
+//     UA_Server_processBinaryMessage -> UA_SecureChannel_processBuffer ->
+//     decode -> Service_Read/Service_Write -> encode -> send
+// The messages come from fixtures captured from a running gateway (-C). A
+// built-in set captured from firmware with the standard model is used when
+// no fixture file is given, so runs before and after a change to the stack
+// compare the same bytes. The server path runs in-process on a fake
+// connection with DataSource nodes that return the captured values, either
+// as a copy or, like the gateway's pre-encoded value cache, as a
+// UA_VARIANT_DATA_NODELETE value the stack must not copy (-A checks that).
+//
+// Link statically against the same open62541 build as the firmware: the
+// binary codec functions are not exported by the shared library.
+
+#define MAX_BENCHES     16
+#define MAX_RUNS        51
+#define ALLOC_OPS       1000
+#define MAX_VALUE_SIZE  512     // Largest decoded service struct used here
+
+// Exported by the open62541 amalgamation, declared only in its internal headers
+UA_StatusCode UA_encodeBinary(const void* src, const UA_DataType* type, UA_Byte** bufPos,
+                              const UA_Byte** bufEnd, void* exchangeCallback, void* exchangeHandle);
+UA_StatusCode UA_decodeBinary(const UA_ByteString* src, size_t* offset, void* dst,
+                              const UA_DataType* type, const UA_DataTypeArray* customTypes);
+size_t UA_calcSizeBinary(const void* p, const UA_DataType* type);
+
+// ========== ALLOCATION COUNTING ==========
+// malloc/calloc/realloc of the whole process are routed through these while
+// 'counting' is set (glibc only).
+static int counting;
+static unsigned long alloc_count, alloc_bytes;
+
+#ifdef __GLIBC__
+#define ALLOC_COUNTING 1
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    if (counting) {
+        alloc_count++;
+        alloc_bytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    if (counting) {
+        alloc_count++;
+        alloc_bytes += n * size;
+    }
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (counting) {
+        alloc_count++;
+        alloc_bytes += size;
+    }
+    return __libc_realloc(ptr, size);
+}
+#else
+#define ALLOC_COUNTING 0
+#endif
+
+// ========== FIXTURES ==========
+// Fixture file: "UAFX", u32 version, then per message u32 kind, u32 length
+// and the binary encoded service body (without the encoding NodeId).
+
+#define FX_MAGIC        0x58464155u  // "UAFX"
+#define FX_VERSION      1
+
+enum { FX_READ_REQ, FX_READ_RESP, FX_WRITE_REQ, FX_WRITE_RESP, FX_PUBLISH_RESP, FX_COUNT };
+
+static const char* fx_names[FX_COUNT] = {
+    "ReadRequest", "ReadResponse", "WriteRequest", "WriteResponse", "PublishResponse"
+};
+static const int fx_types[FX_COUNT] = {
+    UA_TYPES_READREQUEST, UA_TYPES_READRESPONSE, UA_TYPES_WRITEREQUEST,
+    UA_TYPES_WRITERESPONSE, UA_TYPES_PUBLISHRESPONSE
+};
+
+static UA_ByteString fixtures[FX_COUNT];
+
+// Built-in fixtures, captured with -C from the gateway firmware
+static const UA_Byte builtin_read_req[] = {
+    0x04, 0x01, 0x00, 0x8d, 0xa7, 0x2c, 0x15, 0x03, 0x60, 0x7c, 0x02, 0xf3,
+    0xbf, 0xbb, 0x7b, 0xee, 0xfe, 0xef, 0xbe, 0xd2, 0xf8, 0x31, 0xa0, 0xbb,
+    0x5e, 0xdd, 0x01, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+    0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x09, 0x00,
+    0x00, 0x00, 0x03, 0x01, 0x00, 0x12, 0x00, 0x00, 0x00, 0x64, 0x69, 0x61,
+    0x67, 0x6e, 0x6f, 0x73, 0x74, 0x69, 0x63, 0x5f, 0x63, 0x6f, 0x75, 0x6e,
+    0x74, 0x65, 0x72, 0x0d, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00,
+    0x00, 0xff, 0xff, 0xff, 0xff, 0x03, 0x01, 0x00, 0x0e, 0x00, 0x00, 0x00,
+    0x6c, 0x6f, 0x6f, 0x70, 0x62, 0x61, 0x63, 0x6b, 0x5f, 0x69, 0x6e, 0x70,
+    0x75, 0x74, 0x0d, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00,
+    0xff, 0xff, 0xff, 0xff, 0x03, 0x01, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x6c,
+    0x6f, 0x6f, 0x70, 0x62, 0x61, 0x63, 0x6b, 0x5f, 0x6f, 0x75, 0x74, 0x70,
+    0x75, 0x74, 0x0d, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00,
+    0xff, 0xff, 0xff, 0xff, 0x03, 0x01, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x64,
+    0x69, 0x73, 0x63, 0x72, 0x65, 0x74, 0x65, 0x5f, 0x69, 0x6e, 0x70, 0x75,
+    0x74, 0x73, 0x0d, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00,
+    0xff, 0xff, 0xff, 0xff, 0x03, 0x01, 0x00, 0x10, 0x00, 0x00, 0x00, 0x64,
+    0x69, 0x73, 0x63, 0x72, 0x65, 0x74, 0x65, 0x5f, 0x6f, 0x75, 0x74, 0x70,
+    0x75, 0x74, 0x73, 0x0d, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00,
+    0x00, 0xff, 0xff, 0xff, 0xff, 0x03, 0x01, 0x00, 0x0d, 0x00, 0x00, 0x00,
+    0x61, 0x64, 0x63, 0x5f, 0x63, 0x68, 0x61, 0x6e, 0x6e, 0x65, 0x6c, 0x5f,
+    0x31, 0x0d, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0xff,
+    0xff, 0xff, 0xff, 0x03, 0x01, 0x00, 0x0d, 0x00, 0x00, 0x00, 0x61, 0x64,
+    0x63, 0x5f, 0x63, 0x68, 0x61, 0x6e, 0x6e, 0x65, 0x6c, 0x5f, 0x32, 0x0d,
+    0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff, 0xff,
+    0xff, 0x03, 0x01, 0x00, 0x0d, 0x00, 0x00, 0x00, 0x61, 0x64, 0x63, 0x5f,
+    0x63, 0x68, 0x61, 0x6e, 0x6e, 0x65, 0x6c, 0x5f, 0x33, 0x0d, 0x00, 0x00,
+    0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x03,
+    0x01, 0x00, 0x0d, 0x00, 0x00, 0x00, 0x61, 0x64, 0x63, 0x5f, 0x63, 0x68,
+    0x61, 0x6e, 0x6e, 0x65, 0x6c, 0x5f, 0x34, 0x0d, 0x00, 0x00, 0x00, 0xff,
+    0xff, 0xff, 0xff, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff
+};
+static const UA_Byte builtin_read_resp[] = {
+    0x94, 0xfa, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x06, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00,
+    0x09, 0x00, 0x00, 0x00, 0x0d, 0x05, 0x02, 0x51, 0x9a, 0xf9, 0x31, 0xa0,
+    0xbb, 0x5e, 0xdd, 0x01, 0x90, 0xf9, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01,
+    0x0d, 0x05, 0x96, 0x05, 0xa4, 0xf9, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01,
+    0xa4, 0xf9, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x0d, 0x05, 0x96, 0x05,
+    0xae, 0xf9, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0xae, 0xf9, 0x31, 0xa0,
+    0xbb, 0x5e, 0xdd, 0x01, 0x0d, 0x05, 0x20, 0x00, 0xc2, 0xf9, 0x31, 0xa0,
+    0xbb, 0x5e, 0xdd, 0x01, 0xc2, 0xf9, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01,
+    0x0d, 0x05, 0x00, 0x00, 0xcc, 0xf9, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01,
+    0xcc, 0xf9, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x0d, 0x05, 0xfc, 0x03,
+    0xcc, 0xf9, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0xcc, 0xf9, 0x31, 0xa0,
+    0xbb, 0x5e, 0xdd, 0x01, 0x0d, 0x05, 0xf0, 0x03, 0x80, 0xfa, 0x31, 0xa0,
+    0xbb, 0x5e, 0xdd, 0x01, 0x80, 0xfa, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01,
+    0x0d, 0x05, 0x13, 0x04, 0x8a, 0xfa, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01,
+    0x8a, 0xfa, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x0d, 0x05, 0xeb, 0x03,
+    0x94, 0xfa, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x94, 0xfa, 0x31, 0xa0,
+    0xbb, 0x5e, 0xdd, 0x01, 0xff, 0xff, 0xff, 0xff
+};
+static const UA_Byte builtin_write_req[] = {
+    0x04, 0x01, 0x00, 0xe3, 0x77, 0xd7, 0x1c, 0x90, 0x95, 0xe2, 0xa4, 0x6d,
+    0xb6, 0x4b, 0xe4, 0x0e, 0xe0, 0x9e, 0xb9, 0xde, 0xfb, 0x31, 0xa0, 0xbb,
+    0x5e, 0xdd, 0x01, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+    0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+    0x00, 0x00, 0x03, 0x01, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x6c, 0x6f, 0x6f,
+    0x70, 0x62, 0x61, 0x63, 0x6b, 0x5f, 0x69, 0x6e, 0x70, 0x75, 0x74, 0x0d,
+    0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x01, 0x05, 0x96, 0x05
+};
+static const UA_Byte builtin_write_resp[] = {
+    0x88, 0xfc, 0x31, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff
+};
+static const UA_Byte builtin_publish_resp[] = {
+    0xf8, 0x27, 0x41, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x0a, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00,
+    0x02, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0xf8, 0x27, 0x41, 0xa0, 0xbb, 0x5e, 0xdd,
+    0x01, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x2b, 0x03, 0x01, 0x98, 0x00,
+    0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0d, 0x05,
+    0x00, 0x01, 0x94, 0x27, 0x41, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x8a, 0x27,
+    0x41, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x02, 0x00, 0x00, 0x00, 0x0d, 0x05,
+    0x00, 0x00, 0x24, 0x01, 0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x24, 0x01,
+    0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x03, 0x00, 0x00, 0x00, 0x0d, 0x05,
+    0xfc, 0x03, 0x60, 0x01, 0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x60, 0x01,
+    0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x04, 0x00, 0x00, 0x00, 0x0d, 0x05,
+    0xf0, 0x03, 0x92, 0x01, 0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x92, 0x01,
+    0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x05, 0x00, 0x00, 0x00, 0x0d, 0x05,
+    0x13, 0x04, 0xc4, 0x01, 0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0xc4, 0x01,
+    0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0x06, 0x00, 0x00, 0x00, 0x0d, 0x05,
+    0xeb, 0x03, 0xf6, 0x01, 0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0xf6, 0x01,
+    0x32, 0xa0, 0xbb, 0x5e, 0xdd, 0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+static void use_builtin_fixtures(void) {
+    fixtures[FX_READ_REQ] = (UA_ByteString){sizeof(builtin_read_req), (UA_Byte*)builtin_read_req};
+    fixtures[FX_READ_RESP] = (UA_ByteString){sizeof(builtin_read_resp), (UA_Byte*)builtin_read_resp};
+    fixtures[FX_WRITE_REQ] = (UA_ByteString){sizeof(builtin_write_req), (UA_Byte*)builtin_write_req};
+    fixtures[FX_WRITE_RESP] = (UA_ByteString){sizeof(builtin_write_resp), (UA_Byte*)builtin_write_resp};
+    fixtures[FX_PUBLISH_RESP] = (UA_ByteString){sizeof(builtin_publish_resp), (UA_Byte*)builtin_publish_resp};
+}
+
+static int load_fixtures(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        printf("Cannot open %s\n", path);
+        return -1;
+    }
+    UA_UInt32 hdr[2];
+    if (fread(hdr, sizeof(hdr), 1, f) != 1 || hdr[0] != FX_MAGIC || hdr[1] != FX_VERSION) {
+        printf("%s is not a fixture file\n", path);
+        fclose(f);
+        return -1;
+    }
+    UA_UInt32 rec[2];
+    while (fread(rec, sizeof(rec), 1, f) == 1) {
+        if (rec[0] >= FX_COUNT || rec[1] > 1024 * 1024) break;
+        UA_ByteString_clear(&fixtures[rec[0]]);
+        if (UA_ByteString_allocBuffer(&fixtures[rec[0]], rec[1]) != UA_STATUSCODE_GOOD ||
+            fread(fixtures[rec[0]].data, 1, rec[1], f) != rec[1]) {
+            break;
+        }
+    }
+    fclose(f);
+    for (int k = 0; k < FX_COUNT; k++) {
+        if (fixtures[k].length == 0) {
+            printf("%s: %s missing\n", path, fx_names[k]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Encode a value into a new ByteString
+static UA_StatusCode encode_value(const void* value, const UA_DataType* type, UA_ByteString* out) {
+    UA_StatusCode rc = UA_ByteString_allocBuffer(out, UA_calcSizeBinary(value, type));
+    if (rc != UA_STATUSCODE_GOOD) return rc;
+    UA_Byte* pos = out->data;
+    const UA_Byte* end = out->data + out->length;
+    return UA_encodeBinary(value, type, &pos, &end, NULL, NULL);
+}
+
+// ========== CAPTURE ==========
+
+static const char* read_tags[] = {
+    "diagnostic_counter", "loopback_input", "loopback_output", "discrete_inputs",
+    "discrete_outputs", "adc_channel_1", "adc_channel_2", "adc_channel_3", "adc_channel_4"
+};
+#define READ_TAGS (int)(sizeof(read_tags) / sizeof(read_tags[0]))
+
+static const char* monitored_tags[] = {
+    "discrete_inputs", "discrete_outputs", "adc_channel_1", "adc_channel_2", "adc_channel_3",
+    "adc_channel_4"
+};
+#define MONITORED_TAGS (int)(sizeof(monitored_tags) / sizeof(monitored_tags[0]))
+
+// Store a message as fixture; requests get a session token of the server's
+// shape (the client only inserts it on the wire)
+static void capture_store(int kind, void* value) {
+    const UA_DataType* type = &UA_TYPES[fx_types[kind]];
+    if (kind == FX_READ_REQ || kind == FX_WRITE_REQ) {
+        UA_RequestHeader* rh = (UA_RequestHeader*)value;
+        rh->authenticationToken = UA_NODEID_GUID(1, UA_Guid_random());
+    }
+    UA_ByteString_clear(&fixtures[kind]);
+    if (encode_value(value, type, &fixtures[kind]) != UA_STATUSCODE_GOOD) {
+        UA_ByteString_clear(&fixtures[kind]);
+    }
+}
+
+static int capture(const char* url, const char* user, const char* pass, const char* path) {
+    UA_Client* client = UA_Client_new();
+    UA_StatusCode rc = user ? UA_Client_connectUsername(client, url, user, pass)
+                            : UA_Client_connect(client, url);
+    if (rc != UA_STATUSCODE_GOOD) {
+        printf("Connect failed: %s\n", UA_StatusCode_name(rc));
+        UA_Client_delete(client);
+        return -1;
+    }
+
+    // 9-node Read, as test_counter8 and the SCADA poll send it. The raw service
+    // call fills the request header in place, so the fixture holds what was sent.
+    UA_ReadValueId ids[READ_TAGS];
+    for (int i = 0; i < READ_TAGS; i++) {
+        UA_ReadValueId_init(&ids[i]);
+        ids[i].nodeId = UA_NODEID_STRING(1, (char*)read_tags[i]);
+        ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    UA_ReadRequest rreq;
+    UA_ReadRequest_init(&rreq);
+    rreq.nodesToRead = ids;
+    rreq.nodesToReadSize = READ_TAGS;
+    rreq.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    UA_ReadResponse rresp;
+    __UA_Client_Service(client, &rreq, &UA_TYPES[UA_TYPES_READREQUEST], &rresp, &UA_TYPES[UA_TYPES_READRESPONSE]);
+    rc = rresp.responseHeader.serviceResult;
+    if (rc == UA_STATUSCODE_GOOD && rresp.resultsSize == READ_TAGS) {
+        capture_store(FX_READ_RESP, &rresp);
+        capture_store(FX_READ_REQ, &rreq);
+    }
+    printf("Read:    %s\n", UA_StatusCode_name(rc));
+
+    // UInt16 Write of loopback_input (writes back the value just read)
+    UA_UInt16 loop = 0;
+    if (rresp.resultsSize > 1 && UA_Variant_hasScalarType(&rresp.results[1].value, &UA_TYPES[UA_TYPES_UINT16])) {
+        loop = *(UA_UInt16*)rresp.results[1].value.data;
+    }
+    UA_ReadResponse_clear(&rresp);
+    UA_WriteValue wv;
+    UA_WriteValue_init(&wv);
+    wv.nodeId = UA_NODEID_STRING(1, "loopback_input");
+    wv.attributeId = UA_ATTRIBUTEID_VALUE;
+    wv.value.hasValue = true;
+    UA_Variant_setScalar(&wv.value.value, &loop, &UA_TYPES[UA_TYPES_UINT16]);
+    UA_WriteRequest wreq;
+    UA_WriteRequest_init(&wreq);
+    wreq.nodesToWrite = &wv;
+    wreq.nodesToWriteSize = 1;
+    UA_WriteResponse wresp;
+    __UA_Client_Service(client, &wreq, &UA_TYPES[UA_TYPES_WRITEREQUEST], &wresp, &UA_TYPES[UA_TYPES_WRITERESPONSE]);
+    rc = wresp.responseHeader.serviceResult;
+    if (rc == UA_STATUSCODE_GOOD && wresp.resultsSize == 1) rc = wresp.results[0];
+    if (rc == UA_STATUSCODE_GOOD) {
+        capture_store(FX_WRITE_RESP, &wresp);
+        capture_store(FX_WRITE_REQ, &wreq);
+    }
+    printf("Write:   %s\n", UA_StatusCode_name(rc));
+    UA_WriteResponse_clear(&wresp);
+
+    // Subscription with 6 items; the first Publish carries all initial values.
+    // Raw services keep the client from sending Publish requests on its own.
+    UA_CreateSubscriptionRequest sreq;
+    UA_CreateSubscriptionRequest_init(&sreq);
+    sreq.requestedPublishingInterval = 100.0;
+    sreq.requestedLifetimeCount = 100;
+    sreq.requestedMaxKeepAliveCount = 10;
+    sreq.publishingEnabled = true;
+    UA_CreateSubscriptionResponse sresp;
+    __UA_Client_Service(client, &sreq, &UA_TYPES[UA_TYPES_CREATESUBSCRIPTIONREQUEST], &sresp,
+                        &UA_TYPES[UA_TYPES_CREATESUBSCRIPTIONRESPONSE]);
+    UA_UInt32 sub_id = sresp.subscriptionId;
+    rc = sresp.responseHeader.serviceResult;
+    UA_CreateSubscriptionResponse_clear(&sresp);
+
+    UA_MonitoredItemCreateRequest items[MONITORED_TAGS];
+    for (int i = 0; i < MONITORED_TAGS; i++) {
+        items[i] = UA_MonitoredItemCreateRequest_default(UA_NODEID_STRING(1, (char*)monitored_tags[i]));
+        items[i].requestedParameters.clientHandle = (UA_UInt32)(i + 1);
+        items[i].requestedParameters.samplingInterval = 100.0;
+    }
+    UA_CreateMonitoredItemsRequest mreq;
+    UA_CreateMonitoredItemsRequest_init(&mreq);
+    mreq.subscriptionId = sub_id;
+    mreq.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    mreq.itemsToCreate = items;
+    mreq.itemsToCreateSize = MONITORED_TAGS;
+    if (rc == UA_STATUSCODE_GOOD) {
+        UA_CreateMonitoredItemsResponse mresp;
+        __UA_Client_Service(client, &mreq, &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSREQUEST], &mresp,
+                            &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSRESPONSE]);
+        rc = mresp.responseHeader.serviceResult;
+        UA_CreateMonitoredItemsResponse_clear(&mresp);
+    }
+
+    size_t changes = 0;
+    for (int attempt = 0; rc == UA_STATUSCODE_GOOD && attempt < 10 && changes < MONITORED_TAGS; attempt++) {
+        UA_PublishRequest preq;
+        UA_PublishRequest_init(&preq);
+        UA_PublishResponse presp;
+        __UA_Client_Service(client, &preq, &UA_TYPES[UA_TYPES_PUBLISHREQUEST], &presp,
+                            &UA_TYPES[UA_TYPES_PUBLISHRESPONSE]);
+        rc = presp.responseHeader.serviceResult;
+        UA_NotificationMessage* nm = &presp.notificationMessage;
+        for (size_t j = 0; j < nm->notificationDataSize; j++) {
+            UA_ExtensionObject* eo = &nm->notificationData[j];
+            if (eo->encoding == UA_EXTENSIONOBJECT_DECODED &&
+                eo->content.decoded.type == &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION]) {
+                changes = ((UA_DataChangeNotification*)eo->content.decoded.data)->monitoredItemsSize;
+            }
+        }
+        if (changes >= MONITORED_TAGS) capture_store(FX_PUBLISH_RESP, &presp);
+        UA_PublishResponse_clear(&presp);
+    }
+    printf("Publish: %s, %zu data changes\n", UA_StatusCode_name(rc), changes);
+
+    UA_DeleteSubscriptionsRequest dreq;
+    UA_DeleteSubscriptionsRequest_init(&dreq);
+    dreq.subscriptionIds = &sub_id;
+    dreq.subscriptionIdsSize = 1;
+    UA_DeleteSubscriptionsResponse dresp;
+    __UA_Client_Service(client, &dreq, &UA_TYPES[UA_TYPES_DELETESUBSCRIPTIONSREQUEST], &dresp,
+                        &UA_TYPES[UA_TYPES_DELETESUBSCRIPTIONSRESPONSE]);
+    UA_DeleteSubscriptionsResponse_clear(&dresp);
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        printf("Cannot create %s\n", path);
+        return -1;
+    }
+    UA_UInt32 hdr[2] = {FX_MAGIC, FX_VERSION};
+    fwrite(hdr, sizeof(hdr), 1, f);
+    int stored = 0;
+    for (int k = 0; k < FX_COUNT; k++) {
+        if (fixtures[k].length == 0) continue;
+        UA_UInt32 rec[2] = {(UA_UInt32)k, (UA_UInt32)fixtures[k].length};
+        fwrite(rec, sizeof(rec), 1, f);
+        fwrite(fixtures[k].data, 1, fixtures[k].length, f);
+        printf("  %-16s %5zu bytes\n", fx_names[k], fixtures[k].length);
+        stored++;
+    }
+    fclose(f);
+    printf("Saved %d of %d fixtures to %s\n", stored, FX_COUNT, path);
+    return stored == FX_COUNT ? 0 : -1;
+}
+
+// ========== CODEC BENCHMARKS ==========
+
+typedef struct {
+    const UA_ByteString* data;   // Encoded fixture
+    const UA_DataType* type;
+    void* value;                 // Decoded fixture (encode source)
+    UA_ByteString buf;           // Encode target, sized like a send buffer
+    UA_StatusCode status;
+} CodecCtx;
+
+static void op_decode(void* p) {
+    CodecCtx* c = (CodecCtx*)p;
+    UA_UInt64 value[MAX_VALUE_SIZE / 8];
+    size_t offset = 0;
+    c->status |= UA_decodeBinary(c->data, &offset, value, c->type, NULL);
+    UA_clear(value, c->type);
+}
+
+static void op_encode(void* p) {
+    CodecCtx* c = (CodecCtx*)p;
+    UA_Byte* pos = c->buf.data;
+    const UA_Byte* end = c->buf.data + c->buf.length;
+    c->status |= UA_encodeBinary(c->value, c->type, &pos, &end, NULL, NULL);
+}
+
+// ========== SERVER PATH ==========
+
+typedef struct {
+    UA_Server* server;
+    UA_Connection conn;
+    UA_UInt32 channel_id;
+    UA_UInt32 token_id;
+    UA_UInt32 seq;
+    UA_UInt32 request_id;
+    UA_NodeId auth_token;
+    UA_ByteString response;      // Last message sent by the server (setup only)
+    int keep_response;
+    unsigned long sent;
+    UA_ByteString read_msg;      // Prebuilt MSG chunks of the fixtures
+    UA_ByteString write_msg;
+} ServerCtx;
+
+static UA_UInt16 loopback_value;
+static int cached_reads;         // DataSource returns values it keeps (value cache)
+static const UA_String loopback_name = UA_STRING_STATIC("loopback_input");
+
+static void log_none(void* context, UA_LogLevel level, UA_LogCategory category,
+                     const char* msg, va_list args) {
+    (void)context; (void)level; (void)category; (void)msg; (void)args;
+}
+
+// The real TCP layer allocates a fresh send buffer per chunk as well
+static UA_StatusCode conn_get_send_buffer(UA_Connection* conn, size_t length, UA_ByteString* buf) {
+    (void)conn;
+    return UA_ByteString_allocBuffer(buf, length);
+}
+
+static void conn_release_send_buffer(UA_Connection* conn, UA_ByteString* buf) {
+    (void)conn;
+    UA_ByteString_clear(buf);
+}
+
+static UA_StatusCode conn_send(UA_Connection* conn, UA_ByteString* buf) {
+    ServerCtx* s = (ServerCtx*)conn->handle;
+    s->sent++;
+    if (s->keep_response) {
+        UA_ByteString_clear(&s->response);
+        UA_ByteString_copy(buf, &s->response);
+    }
+    UA_ByteString_clear(buf);
+    return UA_STATUSCODE_GOOD;
+}
+
+static void conn_close(UA_Connection* conn) {
+    conn->state = UA_CONNECTIONSTATE_CLOSED;
+}
+
+static void conn_free(UA_Connection* conn) {
+    (void)conn;
+}
+
+// Same shape as the gateway's callbacks: scalar copy of the current value, or
+// with cached_reads a value pointing into storage the callback keeps, as the
+// value cache of the gateway returns it
+static UA_StatusCode ds_read(UA_Server* server, const UA_NodeId* sessionId, void* sessionContext,
+                             const UA_NodeId* nodeId, void* nodeContext, UA_Boolean sourceTimeStamp,
+                             const UA_NumericRange* range, UA_DataValue* dataValue) {
+    (void)server; (void)sessionId; (void)sessionContext; (void)nodeId; (void)range;
+    const UA_Variant* v = (const UA_Variant*)nodeContext;
+    int loopback = v->type == &UA_TYPES[UA_TYPES_UINT16] && nodeId->identifierType == UA_NODEIDTYPE_STRING &&
+                   UA_String_equal(&nodeId->identifier.string, &loopback_name);
+    if (cached_reads) {
+        if (loopback) {
+            UA_Variant_setScalar(&dataValue->value, &loopback_value, v->type);
+        } else {
+            dataValue->value = *v;
+        }
+        dataValue->value.storageType = UA_VARIANT_DATA_NODELETE;
+    } else if (loopback) {
+        UA_Variant_setScalarCopy(&dataValue->value, &loopback_value, v->type);
+    } else {
+        UA_Variant_copy(v, &dataValue->value);
+    }
+    if (sourceTimeStamp) {
+        dataValue->sourceTimestamp = UA_DateTime_now();
+        dataValue->hasSourceTimestamp = true;
+    }
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode ds_write(UA_Server* server, const UA_NodeId* sessionId, void* sessionContext,
+                              const UA_NodeId* nodeId, void* nodeContext, const UA_NumericRange* range,
+                              const UA_DataValue* data) {
+    (void)server; (void)sessionId; (void)sessionContext; (void)nodeId; (void)nodeContext; (void)range;
+    if (!data->hasValue || !UA_Variant_hasScalarType(&data->value, &UA_TYPES[UA_TYPES_UINT16])) {
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+    }
+    loopback_value = *(UA_UInt16*)data->value.data;
+    return UA_STATUSCODE_GOOD;
+}
+
+// Chunk builder
+typedef struct {
+    UA_Byte data[16384];
+    size_t len;
+} Chunk;
+
+static void put_u32(Chunk* c, UA_UInt32 v) {
+    memcpy(c->data + c->len, &v, 4);  // Little-endian host
+    c->len += 4;
+}
+
+static void put_value(Chunk* c, const void* value, const UA_DataType* type) {
+    UA_Byte* pos = c->data + c->len;
+    const UA_Byte* end = c->data + sizeof(c->data);
+    if (UA_encodeBinary(value, type, &pos, &end, NULL, NULL) == UA_STATUSCODE_GOOD) {
+        c->len = (size_t)(pos - c->data);
+    }
+}
+
+static void chunk_begin(Chunk* c, const char* type) {
+    memcpy(c->data, type, 4);
+    c->len = 8;
+}
+
+static void chunk_end(Chunk* c) {
+    UA_UInt32 size = (UA_UInt32)c->len;
+    memcpy(c->data + 4, &size, 4);
+}
+
+static void msg_begin(ServerCtx* s, Chunk* c, const UA_DataType* type) {
+    chunk_begin(c, "MSGF");
+    put_u32(c, s->channel_id);
+    put_u32(c, s->token_id);
+    put_u32(c, ++s->seq);
+    put_u32(c, ++s->request_id);
+    put_value(c, &type->binaryEncodingId, &UA_TYPES[UA_TYPES_NODEID]);
+}
+
+// Feed one chunk, return the response body (after the MSG/OPN headers)
+static UA_StatusCode server_exchange(ServerCtx* s, Chunk* c, size_t skip_strings, void* resp,
+                                     const UA_DataType* resp_type) {
+    chunk_end(c);
+    UA_ByteString msg = {c->len, c->data};
+    s->keep_response = 1;
+    UA_Server_processBinaryMessage(s->server, &s->conn, &msg);
+    s->keep_response = 0;
+    if (s->response.length < 8) return UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    if (!resp) return memcmp(s->response.data, "ACKF", 4) == 0 ? UA_STATUSCODE_GOOD
+                                                                 : UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    if (memcmp(s->response.data, "ERRF", 4) == 0) return UA_STATUSCODE_BADCOMMUNICATIONERROR;
+
+    size_t offset = 12;  // Message header and channel id
+    UA_ByteString skip;
+    for (size_t i = 0; i < skip_strings; i++) {
+        if (UA_decodeBinary(&s->response, &offset, &skip, &UA_TYPES[UA_TYPES_BYTESTRING], NULL) != UA_STATUSCODE_GOOD) {
+            return UA_STATUSCODE_BADDECODINGERROR;
+        }
+        UA_ByteString_clear(&skip);
+    }
+    offset += skip_strings ? 8 : 12;  // Sequence header (MSG: token id as well)
+    UA_NodeId enc;
+    UA_StatusCode rc = UA_decodeBinary(&s->response, &offset, &enc, &UA_TYPES[UA_TYPES_NODEID], NULL);
+    if (rc != UA_STATUSCODE_GOOD) return rc;
+    UA_NodeId_clear(&enc);
+    rc = UA_decodeBinary(&s->response, &offset, resp, resp_type, NULL);
+    if (rc != UA_STATUSCODE_GOOD) return rc;
+    return ((UA_ResponseHeader*)resp)->serviceResult;
+}
+
+// Build the MSG chunk of a request fixture with the benchmark session's token
+static UA_StatusCode build_request_msg(ServerCtx* s, const UA_ByteString* fixture, const UA_DataType* type,
+                                       UA_ByteString* out) {
+    UA_UInt64 req[MAX_VALUE_SIZE / 8];
+    size_t offset = 0;
+    UA_StatusCode rc = UA_decodeBinary(fixture, &offset, req, type, NULL);
+    if (rc != UA_STATUSCODE_GOOD) return rc;
+    UA_RequestHeader* rh = (UA_RequestHeader*)req;
+    UA_NodeId_clear(&rh->authenticationToken);
+    UA_NodeId_copy(&s->auth_token, &rh->authenticationToken);
+    // Sequence number and request id are patched in when the chunk is sent
+    Chunk* c = (Chunk*)malloc(sizeof(Chunk));
+    msg_begin(s, c, type);
+    s->seq--;
+    s->request_id--;
+    put_value(c, req, type);
+    chunk_end(c);
+    UA_clear(req, type);
+    rc = UA_ByteString_allocBuffer(out, c->len);
+    if (rc == UA_STATUSCODE_GOOD) memcpy(out->data, c->data, c->len);
+    free(c);
+    return rc;
+}
+
+// Nodes named in the Read fixture, returning the captured values
+static void add_fixture_nodes(UA_Server* server, UA_Variant* values, size_t* nvalues) {
+    UA_ReadRequest req;
+    UA_ReadResponse resp;
+    size_t o1 = 0, o2 = 0;
+    *nvalues = 0;
+    if (UA_decodeBinary(&fixtures[FX_READ_REQ], &o1, &req, &UA_TYPES[UA_TYPES_READREQUEST], NULL) != UA_STATUSCODE_GOOD) return;
+    if (UA_decodeBinary(&fixtures[FX_READ_RESP], &o2, &resp, &UA_TYPES[UA_TYPES_READRESPONSE], NULL) != UA_STATUSCODE_GOOD) {
+        UA_ReadRequest_clear(&req);
+        return;
+    }
+    for (size_t i = 0; i < req.nodesToReadSize && i < resp.resultsSize && i < 32; i++) {
+        if (!resp.results[i].hasValue || !resp.results[i].value.type) continue;
+        UA_Variant* v = &values[(*nvalues)++];
+        UA_Variant_copy(&resp.results[i].value, v);
+        UA_VariableAttributes attr = UA_VariableAttributes_default;
+        attr.dataType = v->type->typeId;
+        attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+        UA_DataSource ds = {ds_read, ds_write};
+        const UA_NodeId* id = &req.nodesToRead[i].nodeId;
+        UA_QualifiedName name = {1, id->identifierType == UA_NODEIDTYPE_STRING ? id->identifier.string
+                                                                               : UA_STRING("node")};
+        UA_Server_addDataSourceVariableNode(server, *id, UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES), name,
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, ds, v,
+                                            NULL);
+        if (UA_Variant_hasScalarType(v, &UA_TYPES[UA_TYPES_UINT16]) &&
+            UA_String_equal(&name.name, &loopback_name)) {
+            loopback_value = *(UA_UInt16*)v->data;
+        }
+    }
+    UA_ReadRequest_clear(&req);
+    UA_ReadResponse_clear(&resp);
+}
+
+// Server with the fixture nodes and an activated anonymous session on a fake connection
+static UA_StatusCode server_setup(ServerCtx* s, UA_Variant* values, size_t* nvalues) {
+    memset(s, 0, sizeof(*s));
+    s->server = UA_Server_new();
+    UA_ServerConfig* config = UA_Server_getConfig(s->server);
+    config->logger.log = log_none;
+    UA_ServerConfig_setDefault(config);
+    config->logger.log = log_none;
+    add_fixture_nodes(s->server, values, nvalues);
+
+    s->conn.state = UA_CONNECTIONSTATE_OPENING;
+    s->conn.sockfd = 1;
+    s->conn.handle = s;
+    s->conn.getSendBuffer = conn_get_send_buffer;
+    s->conn.releaseSendBuffer = conn_release_send_buffer;
+    s->conn.send = conn_send;
+    s->conn.close = conn_close;
+    s->conn.free = conn_free;
+
+    Chunk* c = (Chunk*)malloc(sizeof(Chunk));
+    const UA_String url = UA_STRING_STATIC("opc.tcp://localhost:4840");
+
+    // HEL
+    chunk_begin(c, "HELF");
+    put_u32(c, 0);
+    put_u32(c, 65535);
+    put_u32(c, 65535);
+    put_u32(c, 0);
+    put_u32(c, 0);
+    put_value(c, &url, &UA_TYPES[UA_TYPES_STRING]);
+    UA_StatusCode rc = server_exchange(s, c, 0, NULL, NULL);
+
+    // OPN with SecurityPolicy None
+    if (rc == UA_STATUSCODE_GOOD) {
+        const UA_String policy = UA_STRING_STATIC("http://opcfoundation.org/UA/SecurityPolicy#None");
+        const UA_ByteString null_bytes = UA_BYTESTRING_NULL;
+        UA_OpenSecureChannelRequest oreq;
+        UA_OpenSecureChannelRequest_init(&oreq);
+        oreq.requestType = UA_SECURITYTOKENREQUESTTYPE_ISSUE;
+        oreq.securityMode = UA_MESSAGESECURITYMODE_NONE;
+        oreq.requestedLifetime = 3600000;
+        oreq.requestHeader.timestamp = UA_DateTime_now();
+        chunk_begin(c, "OPNF");
+        put_u32(c, 0);
+        put_value(c, &policy, &UA_TYPES[UA_TYPES_STRING]);
+        put_value(c, &null_bytes, &UA_TYPES[UA_TYPES_BYTESTRING]);
+        put_value(c, &null_bytes, &UA_TYPES[UA_TYPES_BYTESTRING]);
+        put_u32(c, ++s->seq);
+        put_u32(c, ++s->request_id);
+        put_value(c, &UA_TYPES[UA_TYPES_OPENSECURECHANNELREQUEST].binaryEncodingId, &UA_TYPES[UA_TYPES_NODEID]);
+        put_value(c, &oreq, &UA_TYPES[UA_TYPES_OPENSECURECHANNELREQUEST]);
+        UA_OpenSecureChannelResponse oresp;
+        rc = server_exchange(s, c, 3, &oresp, &UA_TYPES[UA_TYPES_OPENSECURECHANNELRESPONSE]);
+        s->channel_id = oresp.securityToken.channelId;
+        s->token_id = oresp.securityToken.tokenId;
+        UA_OpenSecureChannelResponse_clear(&oresp);
+    }
+
+    // CreateSession + ActivateSession (anonymous)
+    if (rc == UA_STATUSCODE_GOOD) {
+        UA_CreateSessionRequest creq;
+        UA_CreateSessionRequest_init(&creq);
+        creq.endpointUrl = url;
+        creq.sessionName = UA_STRING("bench");
+        creq.requestedSessionTimeout = 3600000;
+        creq.requestHeader.timestamp = UA_DateTime_now();
+        msg_begin(s, c, &UA_TYPES[UA_TYPES_CREATESESSIONREQUEST]);
+        put_value(c, &creq, &UA_TYPES[UA_TYPES_CREATESESSIONREQUEST]);
+        UA_CreateSessionResponse cresp;
+        rc = server_exchange(s, c, 0, &cresp, &UA_TYPES[UA_TYPES_CREATESESSIONRESPONSE]);
+        UA_NodeId_copy(&cresp.authenticationToken, &s->auth_token);
+        UA_CreateSessionResponse_clear(&cresp);
+    }
+    if (rc == UA_STATUSCODE_GOOD) {
+        UA_AnonymousIdentityToken anon;
+        UA_AnonymousIdentityToken_init(&anon);
+        anon.policyId = UA_STRING("open62541-anonymous-policy");
+        UA_ActivateSessionRequest areq;
+        UA_ActivateSessionRequest_init(&areq);
+        areq.requestHeader.authenticationToken = s->auth_token;
+        areq.requestHeader.timestamp = UA_DateTime_now();
+        areq.userIdentityToken.encoding = UA_EXTENSIONOBJECT_DECODED;
+        areq.userIdentityToken.content.decoded.type = &UA_TYPES[UA_TYPES_ANONYMOUSIDENTITYTOKEN];
+        areq.userIdentityToken.content.decoded.data = &anon;
+        msg_begin(s, c, &UA_TYPES[UA_TYPES_ACTIVATESESSIONREQUEST]);
+        put_value(c, &areq, &UA_TYPES[UA_TYPES_ACTIVATESESSIONREQUEST]);
+        UA_ActivateSessionResponse aresp;
+        rc = server_exchange(s, c, 0, &aresp, &UA_TYPES[UA_TYPES_ACTIVATESESSIONRESPONSE]);
+        UA_ActivateSessionResponse_clear(&aresp);
+    }
+    free(c);
+    if (rc != UA_STATUSCODE_GOOD) return rc;
+
+    rc = build_request_msg(s, &fixtures[FX_READ_REQ], &UA_TYPES[UA_TYPES_READREQUEST], &s->read_msg);
+    if (rc == UA_STATUSCODE_GOOD) {
+        rc = build_request_msg(s, &fixtures[FX_WRITE_REQ], &UA_TYPES[UA_TYPES_WRITEREQUEST], &s->write_msg);
+    }
+    return rc;
+}
+
+// Check that the prebuilt chunk gets a good response with all results good
+static UA_StatusCode server_verify(ServerCtx* s, UA_ByteString* msg, const UA_DataType* resp_type) {
+    Chunk* c = (Chunk*)malloc(sizeof(Chunk));
+    memcpy(c->data, msg->data, msg->length);
+    c->len = msg->length;
+    UA_UInt32 seq = ++s->seq, id = ++s->request_id;
+    memcpy(c->data + 16, &seq, 4);
+    memcpy(c->data + 20, &id, 4);
+    UA_UInt64 resp[MAX_VALUE_SIZE / 8];
+    UA_StatusCode rc = server_exchange(s, c, 0, resp, resp_type);
+    if (rc == UA_STATUSCODE_GOOD && resp_type == &UA_TYPES[UA_TYPES_READRESPONSE]) {
+        UA_ReadResponse* r = (UA_ReadResponse*)resp;
+        for (size_t i = 0; i < r->resultsSize; i++) {
+            if (r->results[i].hasStatus && r->results[i].status != UA_STATUSCODE_GOOD) rc = r->results[i].status;
+        }
+    } else if (rc == UA_STATUSCODE_GOOD) {
+        UA_WriteResponse* r = (UA_WriteResponse*)resp;
+        for (size_t i = 0; i < r->resultsSize; i++) {
+            if (r->results[i] != UA_STATUSCODE_GOOD) rc = r->results[i];
+        }
+    }
+    UA_clear(resp, resp_type);
+    free(c);
+    return rc;
+}
+
+static void server_message(ServerCtx* s, UA_ByteString* msg) {
+    UA_UInt32 seq = ++s->seq, id = ++s->request_id;
+    memcpy(msg->data + 16, &seq, 4);
+    memcpy(msg->data + 20, &id, 4);
+    UA_Server_processBinaryMessage(s->server, &s->conn, msg);
+}
+
+static ServerCtx server_ctx;
+
+static void op_server_read(void* p) {
+    (void)p;
+    server_message(&server_ctx, &server_ctx.read_msg);
+}
+
+static void op_server_read_cached(void* p) {
+    (void)p;
+    cached_reads = 1;
+    server_message(&server_ctx, &server_ctx.read_msg);
+    cached_reads = 0;
+}
+
+static void op_server_write(void* p) {
+    (void)p;
+    server_message(&server_ctx, &server_ctx.write_msg);
+}
+
+// ========== RUNNER ==========
+
+typedef struct {
+    char name[48];
+    void (*op)(void* ctx);
+    void* ctx;
+    double ns_median;
+    double ns_min;
+    double allocs;
+    double bytes;
+} Bench;
+
+// Monotonic time in nanoseconds
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double time_ops(Bench* b, long iters) {
+    double start = now_ns();
+    for (long i = 0; i < iters; i++) b->op(b->ctx);
+    return now_ns() - start;
+}
+
+static void run_bench(Bench* b, double run_ms, int runs) {
+    // Warm up and calibrate the iterations of one run
+    long iters = 1;
+    double elapsed;
+    while ((elapsed = time_ops(b, iters)) < run_ms * 1e6 / 10 && iters < (1L << 30)) iters *= 2;
+    iters = (long)(iters * (run_ms * 1e6 / (elapsed > 0 ? elapsed : 1)));
+    if (iters < 1) iters = 1;
+
+    double samples[MAX_RUNS];
+    for (int r = 0; r < runs; r++) samples[r] = time_ops(b, iters) / iters;
+    qsort(samples, runs, sizeof(double), cmp_double);
+    b->ns_median = samples[runs / 2];
+    b->ns_min = samples[0];
+
+    // Allocations in a separate pass (counting costs time)
+    alloc_count = alloc_bytes = 0;
+    counting = 1;
+    for (long i = 0; i < ALLOC_OPS; i++) b->op(b->ctx);
+    counting = 0;
+    b->allocs = (double)alloc_count / ALLOC_OPS;
+    b->bytes = (double)alloc_bytes / ALLOC_OPS;
+}
+
+// Baseline entry of a previous -o run
+static int baseline_lookup(const char* path, const char* name, double* ns) {
+    FILE* f = path ? fopen(path, "r") : NULL;
+    if (!f) return 0;
+    char line[256];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), f)) {
+        char* comma = strchr(line, ',');
+        if (!comma) continue;
+        *comma = '\0';
+        if (strcmp(line, name) == 0) {
+            *ns = atof(comma + 1);
+            found = *ns > 0;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+static void print_help(const char* program_name) {
+    printf("OPC UA STACK MICRO-BENCHMARK (codec and server hot paths)\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help           Show this help message\n");
+    printf("  -f, --fixtures FILE  Fixture file (default: built-in gateway capture)\n");
+    printf("  -C, --capture URL    Capture fixtures from a gateway into FILE (-f) and exit\n");
+    printf("  -t, --time MS        Duration of one run (default: 200)\n");
+    printf("  -n, --runs N         Runs per benchmark, median reported (default: 5)\n");
+    printf("  -m, --match TEXT     Only run benchmarks whose name contains TEXT\n");
+    printf("  -o, --output FILE    Write the results as CSV\n");
+    printf("  -b, --baseline FILE  Compare with the CSV of a previous run\n");
+    printf("  -A, --alloc-check    Fail unless a Read of cached values allocates at least one\n");
+    printf("                       block per node less than a Read of copied values\n");
+    printf("  -u, --user NAME      Username (capture)\n");
+    printf("  -p, --pass PASSWORD  Password (capture)\n");
+    printf("\nExamples:\n");
+    printf("  %s -o before.csv\n", program_name);
+    printf("  %s -b before.csv -o after.csv\n", program_name);
+    printf("  %s -m Read -A\n", program_name);
+    printf("  %s -C opc.tcp://10.0.0.128:4840 -f gateway.fx -u engineer -p readwrite456\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    // Default values
+    const char* fixture_file = NULL;
+    const char* capture_url = NULL;
+    double run_ms = 200.0;
+    int runs = 5;
+    const char* match = NULL;
+    const char* csv_file = NULL;
+    const char* baseline_file = NULL;
+    const char* username = NULL;
+    const char* password = NULL;
+    int alloc_check = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--fixtures") == 0) && i + 1 < argc) {
+            fixture_file = argv[++i];
+        } else if ((strcmp(argv[i], "-C") == 0 || strcmp(argv[i], "--capture") == 0) && i + 1 < argc) {
+            capture_url = argv[++i];
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--time") == 0) && i + 1 < argc) {
+            run_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--runs") == 0) && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--match") == 0) && i + 1 < argc) {
+            match = argv[++i];
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--baseline") == 0) && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if (strcmp(argv[i], "-A") == 0 || strcmp(argv[i], "--alloc-check") == 0) {
+            alloc_check = 1;
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        }
+    }
+    if (runs < 1) runs = 1;
+    if (runs > MAX_RUNS) runs = MAX_RUNS;
+    if (run_ms < 1) run_ms = 1;
+
+    if (capture_url) {
+        if (!fixture_file) {
+            printf("Capture needs a fixture file (-f)\n");
+            return 1;
+        }
+        printf("=== CAPTURE FIXTURES ===\n");
+        return capture(capture_url, username, password, fixture_file) == 0 ? 0 : 1;
+    }
+
+    if (fixture_file) {
+        if (load_fixtures(fixture_file) != 0) return 1;
+    } else {
+        use_builtin_fixtures();
+    }
+
+    printf("=============================================\n");
+    printf("   OPC UA STACK MICRO-BENCHMARK\n");
+    printf("   Fixtures: %s\n", fixture_file ? fixture_file : "built-in gateway capture");
+    printf("   %d runs of %.0f ms per benchmark\n", runs, run_ms);
+    printf("=============================================\n\n");
+
+    // ========== FIXTURES ==========
+    printf("=== FIXTURES ===\n");
+    CodecCtx codec[FX_COUNT];
+    for (int k = 0; k < FX_COUNT; k++) {
+        CodecCtx* c = &codec[k];
+        memset(c, 0, sizeof(*c));
+        c->data = &fixtures[k];
+        c->type = &UA_TYPES[fx_types[k]];
+        if (c->type->memSize > MAX_VALUE_SIZE) return 1;
+        c->value = calloc(1, c->type->memSize);
+        size_t offset = 0;
+        UA_StatusCode rc = UA_decodeBinary(c->data, &offset, c->value, c->type, NULL);
+        if (rc == UA_STATUSCODE_GOOD && offset != c->data->length) rc = UA_STATUSCODE_BADDECODINGERROR;
+        UA_ByteString re = UA_BYTESTRING_NULL;
+        if (rc == UA_STATUSCODE_GOOD) rc = encode_value(c->value, c->type, &re);
+        if (rc == UA_STATUSCODE_GOOD && !UA_ByteString_equal(&re, c->data)) rc = UA_STATUSCODE_BADENCODINGERROR;
+        UA_ByteString_clear(&re);
+        UA_ByteString_allocBuffer(&c->buf, 65535);
+        printf("%-16s %5zu bytes  %s\n", fx_names[k], c->data->length,
+               rc == UA_STATUSCODE_GOOD ? "round trip ok" : UA_StatusCode_name(rc));
+        if (rc != UA_STATUSCODE_GOOD) return 1;
+    }
+
+    UA_Variant values[32];
+    size_t nvalues = 0;
+    UA_StatusCode rc = server_setup(&server_ctx, values, &nvalues);
+    if (rc == UA_STATUSCODE_GOOD) rc = server_verify(&server_ctx, &server_ctx.read_msg, &UA_TYPES[UA_TYPES_READRESPONSE]);
+    if (rc == UA_STATUSCODE_GOOD) rc = server_verify(&server_ctx, &server_ctx.write_msg, &UA_TYPES[UA_TYPES_WRITERESPONSE]);
+    printf("In-process server: %zu nodes, Read/Write chunks of %zu/%zu bytes  %s\n\n", nvalues,
+           server_ctx.read_msg.length, server_ctx.write_msg.length,
+           rc == UA_STATUSCODE_GOOD ? "ok" : UA_StatusCode_name(rc));
+    int server_ok = rc == UA_STATUSCODE_GOOD;
+
+    // ========== BENCHMARKS ==========
+    Bench benches[MAX_BENCHES];
+    memset(benches, 0, sizeof(benches));
+    int nb = 0;
+    for (int k = 0; k < FX_COUNT; k++) {
+        snprintf(benches[nb].name, sizeof(benches[nb].name), "decode %s", fx_names[k]);
+        benches[nb].op = op_decode;
+        benches[nb++].ctx = &codec[k];
+        snprintf(benches[nb].name, sizeof(benches[nb].name), "encode %s", fx_names[k]);
+        benches[nb].op = op_encode;
+        benches[nb++].ctx = &codec[k];
+    }
+    if (server_ok) {
+        snprintf(benches[nb].name, sizeof(benches[nb].name), "server Read message");
+        benches[nb].op = op_server_read;
+        benches[nb++].ctx = NULL;
+        snprintf(benches[nb].name, sizeof(benches[nb].name), "server Read cached values");
+        benches[nb].op = op_server_read_cached;
+        benches[nb++].ctx = NULL;
+        snprintf(benches[nb].name, sizeof(benches[nb].name), "server Write message");
+        benches[nb].op = op_server_write;
+        benches[nb++].ctx = NULL;
+    }
+
+    FILE* csv = csv_file ? fopen(csv_file, "w") : NULL;
+    if (csv) fprintf(csv, "benchmark,ns_op,ns_op_min,allocs_op,bytes_op\n");
+    printf("%-26s %12s %12s %10s %10s %9s\n", "benchmark", "ns/op", "min ns/op", "allocs/op", "bytes/op",
+           baseline_file ? "vs base" : "");
+    printf("-------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < nb; i++) {
+        Bench* b = &benches[i];
+        if (match && !strstr(b->name, match)) {
+            b->ns_median = 0;
+            continue;
+        }
+        run_bench(b, run_ms, runs);
+        char delta[16] = "";
+        double base;
+        if (baseline_lookup(baseline_file, b->name, &base)) {
+            snprintf(delta, sizeof(delta), "%+.1f%%", (b->ns_median / base - 1.0) * 100.0);
+        }
+        if (ALLOC_COUNTING) {
+            printf("%-26s %12.1f %12.1f %10.2f %10.1f %9s\n", b->name, b->ns_median, b->ns_min, b->allocs,
+                   b->bytes, delta);
+        } else {
+            printf("%-26s %12.1f %12.1f %10s %10s %9s\n", b->name, b->ns_median, b->ns_min, "n/a", "n/a", delta);
+        }
+        fflush(stdout);
+        if (csv) {
+            fprintf(csv, "%s,%.1f,%.1f,%.2f,%.1f\n", b->name, b->ns_median, b->ns_min, b->allocs, b->bytes);
+        }
+    }
+    if (csv) fclose(csv);
+
+    // Status of the last benchmark op (all must have succeeded)
+    for (int k = 0; k < FX_COUNT; k++) {
+        if (codec[k].status != UA_STATUSCODE_GOOD) {
+            printf("WARNING: %s codec errors during the run\n", fx_names[k]);
+        }
+    }
+
+    // ========== SUMMARY ==========
+    printf("\n=== SUMMARY ===\n");
+    if (server_ok && benches[2 * FX_COUNT].ns_median > 0 && benches[0].ns_median > 0 && benches[3].ns_median > 0) {
+        // Server Read minus decoding the request and encoding the response
+        double rest = benches[2 * FX_COUNT].ns_median - benches[0].ns_median - benches[3].ns_median;
+        printf("Server Read message:    %.1f ns, of which ~%.1f ns outside the codec\n",
+               benches[2 * FX_COUNT].ns_median, rest);
+        printf("                        (processBuffer, session lookup, Service_Read, DataSource calls)\n");
+    }
+    int failed = 0;
+    Bench* read_copy = &benches[2 * FX_COUNT];
+    Bench* read_cached = &benches[2 * FX_COUNT + 1];
+    if (server_ok && ALLOC_COUNTING && read_copy->ns_median > 0 && read_cached->ns_median > 0) {
+        // The DataSource copy costs one block per scalar node; a stack that
+        // copies values it does not own allocates it again
+        double saved = read_copy->allocs - read_cached->allocs;
+        printf("Read of cached values:  %.2f allocs/op, %.2f less than copied values (%zu nodes)\n",
+               read_cached->allocs, saved, nvalues);
+        if (alloc_check && saved < (double)nvalues - 0.01) {
+            printf("FAIL: the stack still copies DataSource values it does not own\n");
+            failed = 1;
+        }
+    } else if (alloc_check) {
+        printf("FAIL: allocation check needs both server Read benchmarks and glibc\n");
+        failed = 1;
+    }
+    if (alloc_check && !failed) printf("Allocation check PASSED\n");
+    printf("Allocation counts cover the whole process while an op runs%s.\n",
+           ALLOC_COUNTING ? "" : " (not available without glibc)");
+    printf("Compare runs of the same binary flags only; use -b to print the change in ns/op.\n");
+
+    UA_ByteString_clear(&server_ctx.read_msg);
+    UA_ByteString_clear(&server_ctx.write_msg);
+    UA_ByteString_clear(&server_ctx.response);
+    UA_NodeId_clear(&server_ctx.auth_token);
+    if (server_ctx.server) UA_Server_delete(server_ctx.server);
+    for (size_t i = 0; i < nvalues; i++) UA_Variant_clear(&values[i]);
+    for (int k = 0; k < FX_COUNT; k++) {
+        UA_clear(codec[k].value, codec[k].type);
+        free(codec[k].value);
+        UA_ByteString_clear(&codec[k].buf);
+    }
+
+    printf("\n=== TEST COMPLETED ===\n");
+    return failed;
+}
@@ -0,0 +1,450 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Runtime configuration hot-reload check for the Configuration object
+// (ns=1;s=config, components/runtime_config).
+// A monitor session subscribes to diagnostic_counter (a heartbeat that
+// changes on every sample) and adc_channel_1 once and keeps the subscription
+// for the whole run. A second session changes the configuration through the
+// Configuration methods between phases:
+//   base      configuration as found
+//   scan      ADC scan period set to -a MS
+//   filter    adc_channel_1 filter shift -F
+//   deadband  adc_channel_1 deadband -D counts, no filter
+//   hidden    adc_channel_1 hidden (reports BadOutOfService)
+//   restored  configuration as found, restored with one Commit
+//   churn     a commit every -c MS for -d seconds, alternating the ADC scan
+//             period
+// Per phase the tool reports ADC value changes per second, BadOutOfService
+// notifications, the largest gap between heartbeat notifications and the
+// Commit round trip. A dropped subscription or session fails the run.
+
+#define MAX_COMMITS 10000
+
+typedef struct {
+    const char* name;
+    double adc_changes_per_s;
+    long bad_status;
+    double max_gap_ms;
+    double commit_p50, commit_max;
+    int commits;
+} PhaseResult;
+
+// Monitor state, written by the monitor thread
+static volatile int monitor_run = 1;
+static volatile long adc_changes;
+static volatile long adc_bad;
+static volatile long heartbeats;
+static volatile double last_heartbeat_us;
+static volatile double max_gap_us;
+static volatile int subscription_lost;
+static int last_adc = -1;
+
+static UA_UInt32 timeout_ms = 2000;
+
+// Monotonic time in microseconds
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void on_heartbeat(UA_Client* client, UA_UInt32 subId, void* subContext,
+                         UA_UInt32 monId, void* monContext, UA_DataValue* value) {
+    double t = now_us();
+    if (last_heartbeat_us > 0 && t - last_heartbeat_us > max_gap_us) {
+        max_gap_us = t - last_heartbeat_us;
+    }
+    last_heartbeat_us = t;
+    heartbeats++;
+}
+
+static void on_adc(UA_Client* client, UA_UInt32 subId, void* subContext,
+                   UA_UInt32 monId, void* monContext, UA_DataValue* value) {
+    if (value->hasStatus && value->status == UA_STATUSCODE_BADOUTOFSERVICE) {
+        adc_bad++;
+        last_adc = -1;
+        return;
+    }
+    if (!value->hasValue || value->value.type != &UA_TYPES[UA_TYPES_UINT16]) return;
+    int v = *(UA_UInt16*)value->value.data;
+    if (v != last_adc) adc_changes++;
+    last_adc = v;
+}
+
+static void on_subscription_deleted(UA_Client* client, UA_UInt32 subId, void* subContext) {
+    subscription_lost = 1;
+}
+
+static void* monitor_thread(void* arg) {
+    UA_Client* client = (UA_Client*)arg;
+    while (monitor_run) {
+        if (UA_Client_run_iterate(client, 5) != UA_STATUSCODE_GOOD) {
+            subscription_lost = 1;
+            break;
+        }
+    }
+    return NULL;
+}
+
+static UA_Client* connect_session(const char* url, const char* username, const char* password) {
+    UA_Client* client = UA_Client_new();
+    UA_Client_getConfig(client)->timeout = timeout_ms;
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, url, username, password)
+        : UA_Client_connect(client, url);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection failed: %s\n", UA_StatusCode_name(status));
+        UA_Client_delete(client);
+        return NULL;
+    }
+    return client;
+}
+
+// Call a method of the Configuration object
+static UA_StatusCode call_config(UA_Client* client, const char* method, size_t inputSize,
+                                 const UA_Variant* input, UA_UInt32* version) {
+    char id[48];
+    snprintf(id, sizeof(id), "config.%s", method);
+    size_t outputSize = 0;
+    UA_Variant* output = NULL;
+    UA_StatusCode status = UA_Client_call(client, UA_NODEID_STRING(1, "config"),
+                                          UA_NODEID_STRING(1, id), inputSize, input,
+                                          &outputSize, &output);
+    if (status == UA_STATUSCODE_GOOD && version && outputSize == 1 &&
+        output[0].type == &UA_TYPES[UA_TYPES_UINT32]) {
+        *version = *(UA_UInt32*)output[0].data;
+    }
+    UA_Array_delete(output, outputSize, &UA_TYPES[UA_TYPES_VARIANT]);
+    return status;
+}
+
+static UA_StatusCode set_scan_rate(UA_Client* client, const char* scan_class, UA_UInt16 ms) {
+    UA_Variant in[2];
+    UA_String name = UA_STRING((char*)scan_class);
+    UA_Variant_setScalar(&in[0], &name, &UA_TYPES[UA_TYPES_STRING]);
+    UA_Variant_setScalar(&in[1], &ms, &UA_TYPES[UA_TYPES_UINT16]);
+    return call_config(client, "SetScanRate", 2, in, NULL);
+}
+
+static UA_StatusCode set_tag(UA_Client* client, const char* tag, UA_Boolean exposed,
+                             UA_Byte filter, UA_UInt16 deadband) {
+    UA_Variant in[4];
+    UA_String name = UA_STRING((char*)tag);
+    UA_Variant_setScalar(&in[0], &name, &UA_TYPES[UA_TYPES_STRING]);
+    UA_Variant_setScalar(&in[1], &exposed, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    UA_Variant_setScalar(&in[2], &filter, &UA_TYPES[UA_TYPES_BYTE]);
+    UA_Variant_setScalar(&in[3], &deadband, &UA_TYPES[UA_TYPES_UINT16]);
+    return call_config(client, "SetTag", 4, in, NULL);
+}
+
+// Commit and return the round trip in ms (negative on error)
+static double commit(UA_Client* client, UA_UInt32* version) {
+    double t0 = now_us();
+    UA_StatusCode status = call_config(client, "Commit", 0, NULL, version);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Commit failed: %s\n", UA_StatusCode_name(status));
+        return -1.0;
+    }
+    return (now_us() - t0) / 1000.0;
+}
+
+// Current configuration as reported by config.Active
+static int read_active(UA_Client* client, unsigned* adc_ms, unsigned* filter, unsigned* deadband) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    if (UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, "config.Active"), &value) != UA_STATUSCODE_GOOD ||
+        value.type != &UA_TYPES[UA_TYPES_STRING]) {
+        UA_Variant_clear(&value);
+        return 0;
+    }
+    UA_String* s = (UA_String*)value.data;
+    char json[512];
+    size_t len = s->length < sizeof(json) - 1 ? s->length : sizeof(json) - 1;
+    memcpy(json, s->data, len);
+    json[len] = '\0';
+    UA_Variant_clear(&value);
+
+    const char* adc = strstr(json, "\"adc\":");
+    const char* tag = strstr(json, "\"adc_channel_1\":");
+    if (!adc || !tag) return 0;
+    *adc_ms = (unsigned)atoi(adc + 6);
+    const char* f = strstr(tag, "\"filter\":");
+    const char* d = strstr(tag, "\"deadband\":");
+    if (!f || !d) return 0;
+    *filter = (unsigned)atoi(f + 9);
+    *deadband = (unsigned)atoi(d + 11);
+    return 1;
+}
+
+// Phase counters, taken before the phase's Commit
+typedef struct {
+    long changes, bad;
+} PhaseStart;
+
+static PhaseStart phase_begin(void) {
+    PhaseStart p = {adc_changes, adc_bad};
+    max_gap_us = 0;
+    return p;
+}
+
+// Let the configuration settle, then count value changes for duration_s.
+// BadOutOfService notifications and the heartbeat gap count from the Commit.
+static void measure(PhaseResult* r, PhaseStart start, int duration_s) {
+    usleep(500000);
+    long changes0 = adc_changes;
+    double t0 = now_us();
+    usleep(duration_s * 1000000);
+    double span_s = (now_us() - t0) / 1e6;
+    r->adc_changes_per_s = (adc_changes - changes0) / span_s;
+    r->bad_status = adc_bad - start.bad;
+    r->max_gap_ms = max_gap_us / 1000.0;
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA RUNTIME CONFIGURATION HOT-RELOAD CHECK\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -a, --adc-scan MS      ADC scan period of the scan phase (default: 500)\n");
+    printf("  -F, --filter N         ADC filter shift of the filter phase (default: 4)\n");
+    printf("  -D, --deadband N       ADC deadband of the deadband phase (default: 32)\n");
+    printf("  -c, --commit-every MS  Commit interval of the churn phase (default: 10)\n");
+    printf("  -s, --sampling MS      Sampling interval of the monitored items (default: 10)\n");
+    printf("  -d, --duration SEC     Measurement per phase (default: 5)\n");
+    printf("  -t, --timeout MS       Request timeout (default: 2000)\n");
+    printf("  -o, --csv FILE         Also write the results as CSV\n");
+    printf("  -u, --user NAME        Username (needs the config right)\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nThe configuration found at the start is restored at the end.\n");
+    printf("\nExamples:\n");
+    printf("  %s -u admin -p admin789 opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -a 1000 -c 1 -o reload.csv -u admin -p admin789 opc.tcp://10.0.0.128:4840\n",
+           program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_url = "opc.tcp://10.0.0.128:4840";
+    const char* username = NULL;
+    const char* password = NULL;
+    const char* csv_file = NULL;
+    int adc_scan_ms = 500;
+    int filter = 4;
+    int deadband = 32;
+    int commit_every_ms = 10;
+    int sampling_ms = 10;
+    int duration_s = 5;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--adc-scan") == 0) && i + 1 < argc) {
+            adc_scan_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-F") == 0 || strcmp(argv[i], "--filter") == 0) && i + 1 < argc) {
+            filter = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-D") == 0 || strcmp(argv[i], "--deadband") == 0) && i + 1 < argc) {
+            deadband = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--commit-every") == 0) && i + 1 < argc) {
+            commit_every_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sampling") == 0) && i + 1 < argc) {
+            sampling_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--duration") == 0) && i + 1 < argc) {
+            duration_s = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = (UA_UInt32)atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (commit_every_ms < 0) commit_every_ms = 0;
+
+    UA_Client* control = connect_session(server_url, username, password);
+    UA_Client* monitor = connect_session(server_url, username, password);
+    if (!control || !monitor) return 1;
+
+    unsigned orig_adc_ms, orig_filter, orig_deadband;
+    if (!read_active(control, &orig_adc_ms, &orig_filter, &orig_deadband)) {
+        printf("Cannot read ns=1;s=config.Active - gateway without the Configuration object?\n");
+        return 1;
+    }
+
+    UA_CreateSubscriptionRequest sreq = UA_CreateSubscriptionRequest_default();
+    sreq.requestedPublishingInterval = sampling_ms;
+    UA_CreateSubscriptionResponse sresp =
+        UA_Client_Subscriptions_create(monitor, sreq, NULL, NULL, on_subscription_deleted);
+    if (sresp.responseHeader.serviceResult != UA_STATUSCODE_GOOD) {
+        printf("CreateSubscription failed: %s\n", UA_StatusCode_name(sresp.responseHeader.serviceResult));
+        return 1;
+    }
+    const char* ids[2] = {"diagnostic_counter", "adc_channel_1"};
+    UA_Client_DataChangeNotificationCallback callbacks[2] = {on_heartbeat, on_adc};
+    for (int i = 0; i < 2; i++) {
+        UA_MonitoredItemCreateRequest mreq =
+            UA_MonitoredItemCreateRequest_default(UA_NODEID_STRING(1, (char*)ids[i]));
+        mreq.requestedParameters.samplingInterval = sampling_ms;
+        UA_MonitoredItemCreateResult mres = UA_Client_MonitoredItems_createDataChange(
+            monitor, sresp.subscriptionId, UA_TIMESTAMPSTORETURN_BOTH, mreq, NULL, callbacks[i], NULL);
+        if (mres.statusCode != UA_STATUSCODE_GOOD) {
+            printf("CreateMonitoredItem %s failed: %s\n", ids[i], UA_StatusCode_name(mres.statusCode));
+            return 1;
+        }
+    }
+    pthread_t th;
+    pthread_create(&th, NULL, monitor_thread, monitor);
+
+    printf("Configuration as found: ADC scan %u ms, adc_channel_1 filter %u deadband %u\n",
+           orig_adc_ms, orig_filter, orig_deadband);
+    printf("Subscription %u, sampling %d ms, %d s per phase\n\n",
+           sresp.subscriptionId, sampling_ms, duration_s);
+
+    PhaseResult results[7];
+    memset(results, 0, sizeof(results));
+    int nres = 0;
+    UA_UInt32 version = 0;
+    int failed = 0;
+    double ms;
+
+    // base
+    results[nres].name = "base";
+    PhaseStart start = phase_begin();
+    measure(&results[nres++], start, duration_s);
+
+    // scan
+    results[nres].name = "scan";
+    start = phase_begin();
+    set_scan_rate(control, "adc", (UA_UInt16)adc_scan_ms);
+    ms = commit(control, &version);
+    failed |= ms < 0;
+    results[nres].commit_p50 = results[nres].commit_max = ms;
+    results[nres].commits = 1;
+    measure(&results[nres++], start, duration_s);
+
+    // filter
+    results[nres].name = "filter";
+    start = phase_begin();
+    set_scan_rate(control, "adc", (UA_UInt16)orig_adc_ms);
+    set_tag(control, "adc_channel_1", true, (UA_Byte)filter, 0);
+    ms = commit(control, &version);
+    failed |= ms < 0;
+    results[nres].commit_p50 = results[nres].commit_max = ms;
+    results[nres].commits = 1;
+    measure(&results[nres++], start, duration_s);
+
+    // deadband
+    results[nres].name = "deadband";
+    start = phase_begin();
+    set_tag(control, "adc_channel_1", true, 0, (UA_UInt16)deadband);
+    ms = commit(control, &version);
+    failed |= ms < 0;
+    results[nres].commit_p50 = results[nres].commit_max = ms;
+    results[nres].commits = 1;
+    measure(&results[nres++], start, duration_s);
+
+    // hidden
+    results[nres].name = "hidden";
+    start = phase_begin();
+    set_tag(control, "adc_channel_1", false, 0, 0);
+    ms = commit(control, &version);
+    failed |= ms < 0;
+    results[nres].commit_p50 = results[nres].commit_max = ms;
+    results[nres].commits = 1;
+    measure(&results[nres++], start, duration_s);
+
+    // restored: every change above undone in one commit
+    results[nres].name = "restored";
+    start = phase_begin();
+    set_scan_rate(control, "adc", (UA_UInt16)orig_adc_ms);
+    set_tag(control, "adc_channel_1", true, (UA_Byte)orig_filter, (UA_UInt16)orig_deadband);
+    ms = commit(control, &version);
+    failed |= ms < 0;
+    results[nres].commit_p50 = results[nres].commit_max = ms;
+    results[nres].commits = 1;
+    measure(&results[nres++], start, duration_s);
+
+    // churn: commits at a fixed interval while the subscription keeps running
+    results[nres].name = "churn";
+    double* samples = malloc(MAX_COMMITS * sizeof(double));
+    int done = 0;
+    start = phase_begin();
+    double t0 = now_us();
+    double end = t0 + duration_s * 1e6;
+    while (now_us() < end && done < MAX_COMMITS) {
+        set_scan_rate(control, "adc", (UA_UInt16)(done % 2 ? orig_adc_ms : adc_scan_ms));
+        ms = commit(control, &version);
+        if (ms < 0) {
+            failed = 1;
+            break;
+        }
+        samples[done++] = ms;
+        if (commit_every_ms > 0) usleep(commit_every_ms * 1000);
+    }
+    double span_s = (now_us() - t0) / 1e6;
+    set_scan_rate(control, "adc", (UA_UInt16)orig_adc_ms);
+    commit(control, &version);
+    qsort(samples, done, sizeof(double), cmp_double);
+    results[nres].adc_changes_per_s = span_s > 0 ? (adc_changes - start.changes) / span_s : 0.0;
+    results[nres].bad_status = adc_bad - start.bad;
+    results[nres].max_gap_ms = max_gap_us / 1000.0;
+    results[nres].commits = done;
+    results[nres].commit_p50 = done ? samples[done / 2] : 0.0;
+    results[nres].commit_max = done ? samples[done - 1] : 0.0;
+    nres++;
+    free(samples);
+
+    monitor_run = 0;
+    pthread_join(th, NULL);
+    int lost = subscription_lost;
+
+    printf("%-9s %12s %10s %12s %8s %12s %12s\n",
+           "phase", "adc chg/s", "bad stat", "max gap ms", "commits", "commit p50", "commit max");
+    for (int i = 0; i < nres; i++) {
+        PhaseResult* r = &results[i];
+        printf("%-9s %12.1f %10ld %12.1f %8d %12.2f %12.2f\n", r->name, r->adc_changes_per_s,
+               r->bad_status, r->max_gap_ms, r->commits, r->commit_p50, r->commit_max);
+    }
+    printf("\nFinal version: %u, heartbeats: %ld, subscription %s\n", version, heartbeats,
+           lost ? "LOST" : "kept");
+
+    if (csv_file) {
+        FILE* csv = fopen(csv_file, "w");
+        if (csv) {
+            fprintf(csv, "phase,adc_changes_per_s,bad_status,max_gap_ms,commits,commit_p50_ms,commit_max_ms\n");
+            for (int i = 0; i < nres; i++) {
+                PhaseResult* r = &results[i];
+                fprintf(csv, "%s,%.1f,%ld,%.1f,%d,%.2f,%.2f\n", r->name, r->adc_changes_per_s,
+                        r->bad_status, r->max_gap_ms, r->commits, r->commit_p50, r->commit_max);
+            }
+            fclose(csv);
+        }
+    }
+
+    UA_Client_disconnect(monitor);
+    UA_Client_delete(monitor);
+    UA_Client_disconnect(control);
+    UA_Client_delete(control);
+    return (failed || lost) ? 1 : 0;
+}
@@ -0,0 +1,316 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Concentrator fan-out benchmark.
+// Writes discrete_outputs at a fixed rate and measures when the new value
+// arrives at K subscribers on the concentrator and at one reference
+// subscriber connected directly to the gateway. The difference is the
+// latency added by the concentrator; the notification rate over all K
+// subscribers is the fan-out throughput.
+
+#define MAX_SUBSCRIBERS 256
+#define MAX_WRITES      60000
+
+// One subscriber session
+typedef struct {
+    const char* url;             // Endpoint
+    const char* user;            // Credentials (NULL = anonymous)
+    const char* pass;
+    UA_UInt16 ns;                // Namespace of discrete_outputs (resolved by name if uri != NULL)
+    const char* ns_uri;          // Namespace URI to resolve
+    double publish_ms;           // Publishing interval
+    double* latencies;           // Write-to-notification latency samples
+    int count;                   // Samples stored
+    int notifications;           // Notifications received
+    int ready;                   // Subscription created
+    int failed;                  // Connect/subscribe failed
+    pthread_t thread;
+} Subscriber;
+
+static volatile double write_time[65536];  // Write time per value (0 = not written)
+static volatile int stop_flag = 0;
+
+// Monotonic time in milliseconds
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void
+dataChangeHandler(UA_Client* client, UA_UInt32 subId, void* subContext,
+                  UA_UInt32 monId, void* monContext, UA_DataValue* value) {
+    Subscriber* s = (Subscriber*)monContext;
+    double t = now_ms();
+    (void)client; (void)subId; (void)subContext; (void)monId;
+    s->notifications++;
+    if (!value->hasValue || !UA_Variant_hasScalarType(&value->value, &UA_TYPES[UA_TYPES_UINT16])) return;
+    UA_UInt16 v = *(UA_UInt16*)value->value.data;
+    double wt = write_time[v];
+    if (wt > 0.0 && s->count < MAX_WRITES) {
+        s->latencies[s->count++] = t - wt;
+    }
+}
+
+// Subscriber thread: connect, subscribe to discrete_outputs, iterate until stopped
+static void* subscriber_thread(void* arg) {
+    Subscriber* s = (Subscriber*)arg;
+    UA_Client* client = UA_Client_new();
+    UA_StatusCode rc = (s->user && s->pass) ? UA_Client_connectUsername(client, s->url, s->user, s->pass)
+                                            : UA_Client_connect(client, s->url);
+    if (rc != UA_STATUSCODE_GOOD) {
+        s->failed = 1;
+        UA_Client_delete(client);
+        return NULL;
+    }
+
+    if (s->ns_uri) {
+        UA_String uri = UA_STRING((char*)s->ns_uri);
+        if (UA_Client_NamespaceGetIndex(client, &uri, &s->ns) != UA_STATUSCODE_GOOD) {
+            s->failed = 1;
+            UA_Client_disconnect(client);
+            UA_Client_delete(client);
+            return NULL;
+        }
+    }
+
+    UA_CreateSubscriptionRequest sreq = UA_CreateSubscriptionRequest_default();
+    sreq.requestedPublishingInterval = s->publish_ms;
+    UA_CreateSubscriptionResponse sresp = UA_Client_Subscriptions_create(client, sreq, NULL, NULL, NULL);
+    UA_MonitoredItemCreateRequest item =
+        UA_MonitoredItemCreateRequest_default(UA_NODEID_STRING(s->ns, "discrete_outputs"));
+    item.requestedParameters.samplingInterval = 0.0;
+    item.requestedParameters.queueSize = 16;
+    UA_MonitoredItemCreateResult mres =
+        UA_Client_MonitoredItems_createDataChange(client, sresp.subscriptionId, UA_TIMESTAMPSTORETURN_BOTH,
+                                                  item, s, dataChangeHandler, NULL);
+    if (sresp.responseHeader.serviceResult != UA_STATUSCODE_GOOD || mres.statusCode != UA_STATUSCODE_GOOD) {
+        s->failed = 1;
+        UA_Client_disconnect(client);
+        UA_Client_delete(client);
+        return NULL;
+    }
+
+    s->ready = 1;
+    while (!stop_flag) {
+        UA_Client_run_iterate(client, 5);
+    }
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    return NULL;
+}
+
+// Merge, sort and print latency statistics; returns the average
+static double report(const char* name, Subscriber* subs, int n, double duration_ms) {
+    int total = 0, notifications = 0;
+    for (int i = 0; i < n; i++) {
+        total += subs[i].count;
+        notifications += subs[i].notifications;
+    }
+    if (total == 0) {
+        printf("%-22s no samples\n", name);
+        return 0.0;
+    }
+    double* all = malloc(sizeof(double) * total);
+    int k = 0;
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < subs[i].count; j++) {
+            all[k++] = subs[i].latencies[j];
+            sum += subs[i].latencies[j];
+        }
+    }
+    qsort(all, total, sizeof(double), cmp_double);
+    double avg = sum / total;
+    printf("%-22s %8.3f %8.3f %8.3f %8.3f %10.1f\n", name, avg, all[total / 2],
+           all[(int)(total * 0.95)], all[total - 1], notifications * 1000.0 / duration_ms);
+    free(all);
+    return avg;
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("CONCENTRATOR FAN-OUT BENCHMARK\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS] GATEWAY_URL CONCENTRATOR_URL\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help           Show this help message\n");
+    printf("  -N, --name NAME      Gateway name used by the concentrator (default: gw1)\n");
+    printf("  -k, --clients N      Subscribers on the concentrator (default: 16)\n");
+    printf("  -n, --count N        Number of writes (default: 500)\n");
+    printf("  -r, --rate HZ        Write rate (default: 20)\n");
+    printf("  -i, --publish MS     Subscriber publishing interval (default: 20)\n");
+    printf("  -u, --user NAME      Gateway username (writer and reference subscriber)\n");
+    printf("  -p, --pass PASSWORD  Gateway password\n");
+    printf("\nExample:\n");
+    printf("  %s -N line1 -k 32 -u engineer -p readwrite456 opc.tcp://10.0.0.128:4840 opc.tcp://scada1:4840\n",
+           program_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    const char* gateway_url = NULL;
+    const char* concentrator_url = NULL;
+    const char* name = "gw1";
+    int clients = 16;
+    int count = 500;
+    double rate = 20.0;
+    double publish_ms = 20.0;
+    const char* user = NULL;
+    const char* pass = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-N") == 0 || strcmp(argv[i], "--name") == 0) && i + 1 < argc) {
+            name = argv[++i];
+        } else if ((strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--clients") == 0) && i + 1 < argc) {
+            clients = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--count") == 0) && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rate") == 0) && i + 1 < argc) {
+            rate = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--publish") == 0) && i + 1 < argc) {
+            publish_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            user = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            pass = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else if (!gateway_url) {
+            gateway_url = argv[i];
+        } else {
+            concentrator_url = argv[i];
+        }
+    }
+
+    if (!gateway_url || !concentrator_url || clients < 1 || clients > MAX_SUBSCRIBERS ||
+        count < 1 || count > MAX_WRITES || rate <= 0.0) {
+        printf("Error: need GATEWAY_URL CONCENTRATOR_URL, 1..%d clients, 1..%d writes\n",
+               MAX_SUBSCRIBERS, MAX_WRITES);
+        return 1;
+    }
+
+    char ns_uri[96];
+    snprintf(ns_uri, sizeof(ns_uri), "urn:kincony:concentrator:%s", name);
+
+    // ========== SUBSCRIBERS ==========
+
+    Subscriber direct = { gateway_url, user, pass, 1, NULL, publish_ms,
+                          calloc(MAX_WRITES, sizeof(double)), 0, 0, 0, 0, 0 };
+    Subscriber* subs = calloc(clients, sizeof(Subscriber));
+    for (int i = 0; i < clients; i++) {
+        subs[i].url = concentrator_url;
+        subs[i].ns_uri = ns_uri;
+        subs[i].publish_ms = publish_ms;
+        subs[i].latencies = calloc(MAX_WRITES, sizeof(double));
+    }
+
+    printf("Starting 1 direct and %d concentrator subscribers...\n", clients);
+    pthread_create(&direct.thread, NULL, subscriber_thread, &direct);
+    for (int i = 0; i < clients; i++) {
+        pthread_create(&subs[i].thread, NULL, subscriber_thread, &subs[i]);
+    }
+
+    double deadline = now_ms() + 15000.0;
+    int ready = 0;
+    while (now_ms() < deadline) {
+        ready = direct.ready || direct.failed;
+        for (int i = 0; i < clients; i++) ready &= subs[i].ready || subs[i].failed;
+        if (ready) break;
+        usleep(10000);
+    }
+    int failed = 0;
+    for (int i = 0; i < clients; i++) failed += subs[i].failed || !subs[i].ready;
+    if (direct.failed || !direct.ready) {
+        printf("Direct subscriber failed\n");
+    }
+    printf("%d/%d concentrator subscribers ready\n", clients - failed, clients);
+
+    // ========== WRITER ==========
+
+    UA_Client* writer = UA_Client_new();
+    UA_StatusCode rc = (user && pass) ? UA_Client_connectUsername(writer, gateway_url, user, pass)
+                                      : UA_Client_connect(writer, gateway_url);
+    if (rc != UA_STATUSCODE_GOOD) {
+        printf("Writer connection failed: 0x%08X\n", rc);
+        stop_flag = 1;
+        return 1;
+    }
+
+    usleep(500000);  // Let initial notifications pass
+    for (int i = 0; i < clients; i++) subs[i].notifications = 0;
+    direct.notifications = 0;
+
+    printf("=============================================\n");
+    printf("   FAN-OUT: %d writes at %.1f Hz, %d subscribers\n", count, rate, clients);
+    printf("=============================================\n\n");
+
+    UA_NodeId do_node = UA_NODEID_STRING(1, "discrete_outputs");
+    double period = 1000.0 / rate;
+    double start = now_ms();
+    for (int i = 0; i < count; i++) {
+        UA_UInt16 value = (UA_UInt16)(i + 1);
+        UA_Variant v;
+        UA_Variant_setScalar(&v, &value, &UA_TYPES[UA_TYPES_UINT16]);
+        write_time[value] = now_ms();
+        if (UA_Client_writeValueAttribute(writer, do_node, &v) != UA_STATUSCODE_GOOD) {
+            write_time[value] = 0.0;
+        }
+        double next = start + (i + 1) * period;
+        double left = next - now_ms();
+        if (left > 0) usleep((useconds_t)(left * 1000.0));
+    }
+    usleep(1000000);  // Drain
+    double duration = now_ms() - start;
+
+    stop_flag = 1;
+    pthread_join(direct.thread, NULL);
+    for (int i = 0; i < clients; i++) pthread_join(subs[i].thread, NULL);
+
+    UA_UInt16 zero = 0;
+    UA_Variant zv;
+    UA_Variant_setScalar(&zv, &zero, &UA_TYPES[UA_TYPES_UINT16]);
+    UA_Client_writeValueAttribute(writer, do_node, &zv);
+    UA_Client_disconnect(writer);
+    UA_Client_delete(writer);
+
+    // ========== RESULTS ==========
+
+    printf("%-22s %8s %8s %8s %8s %10s\n", "Path", "avg ms", "p50 ms", "p95 ms", "max ms", "notif/s");
+    double direct_avg = report("Gateway (direct)", &direct, 1, duration);
+    double conc_avg = report("Concentrator (all)", subs, clients, duration);
+
+    int delivered = 0;
+    for (int i = 0; i < clients; i++) delivered += subs[i].count;
+    printf("\nValues delivered:      %d of %d expected (%d subscribers x %d writes)\n",
+           delivered, (clients - failed) * count, clients - failed, count);
+    if (direct.count > 0 && delivered > 0) {
+        printf("Added latency (avg):   %.3f ms\n", conc_avg - direct_avg);
+    }
+
+    for (int i = 0; i < clients; i++) free(subs[i].latencies);
+    free(subs);
+    free(direct.latencies);
+    printf("\n=== TEST COMPLETED ===\n");
+    return 0;
+}
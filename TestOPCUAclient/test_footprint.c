@@ -0,0 +1,635 @@
+#define _GNU_SOURCE  // dl_iterate_phdr
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+#include <link.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Footprint report of an open62541 build profile for the gateway.
+// Compares the standard stack profile of the firmware with the "nano"
+// profile (CONFIG_UA_PROFILE_NANO) on the host:
+//   - flash:       code, read-only data and initialized data of this binary
+//   - static RAM:  initialized data and bss of this binary
+//   - heap:        bytes allocated after UA_Server_new, after the gateway's
+//                  nodes were added, after UA_Server_run_startup and with one
+//                  session holding the gateway's subscription
+//   - boot time:   from the start of a run to the first Read response and the first
+//                  data change notification of a client that connects while
+//                  the server starts (forked process, retries every 1 ms)
+// Build this file twice, once against a static open62541 library built with
+// the firmware's feature options and once against one built with the nano
+// options (see README.md), and run the second with -b on the CSV of the first.
+// Static sizes only cover the stack when it is linked statically.
+
+#define MAX_RUNS        21
+#define MAX_METRICS     32
+#define CONNECT_TIMEOUT 10000   // ms until the client gives up
+
+// ========== HEAP ACCOUNTING ==========
+// malloc/calloc/realloc/free of the server process are routed through these
+// while 'tracking' is set (glibc only). Live bytes use the usable block size.
+static int tracking;
+static long heap_live, heap_peak;
+static unsigned long alloc_count;
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#define HEAP_TRACKING 1
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+static void heap_add(void* p) {
+    if (!p) return;
+    alloc_count++;
+    heap_live += (long)malloc_usable_size(p);
+    if (heap_live > heap_peak) heap_peak = heap_live;
+}
+
+void* malloc(size_t size) {
+    void* p = __libc_malloc(size);
+    if (tracking) heap_add(p);
+    return p;
+}
+
+void* calloc(size_t n, size_t size) {
+    void* p = __libc_calloc(n, size);
+    if (tracking) heap_add(p);
+    return p;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (tracking && ptr) heap_live -= (long)malloc_usable_size(ptr);
+    void* p = __libc_realloc(ptr, size);
+    if (tracking) {
+        if (p) {
+            heap_add(p);
+        } else if (ptr && size > 0) {
+            heap_live += (long)malloc_usable_size(ptr);  // Old block kept
+        }
+    }
+    return p;
+}
+
+void free(void* ptr) {
+    if (tracking && ptr) heap_live -= (long)malloc_usable_size(ptr);
+    __libc_free(ptr);
+}
+#else
+#define HEAP_TRACKING 0
+#endif
+
+// ========== GATEWAY NODES ==========
+// Same node set as main/opcua_esp32.c and components/model/model.c: string
+// NodeIds in namespace 1 below the Objects folder, values from DataSources.
+
+typedef struct {
+    const char* id;
+    const char* name;
+    int type;           // UA_TYPES index
+    int writable;
+} GatewayNode;
+
+static const GatewayNode gateway_nodes[] = {
+    {"diagnostic_counter", "Diagnostic Counter", UA_TYPES_UINT16, 0},
+    {"loopback_input", "Loopback Input", UA_TYPES_UINT16, 1},
+    {"loopback_output", "Loopback Output", UA_TYPES_UINT16, 0},
+    {"discrete_inputs", "Discrete Inputs", UA_TYPES_UINT16, 0},
+    {"discrete_outputs", "Discrete Outputs", UA_TYPES_UINT16, 1},
+    {"adc_channel_1", "ADC1", UA_TYPES_UINT16, 0},
+    {"adc_channel_2", "ADC2", UA_TYPES_UINT16, 0},
+    {"adc_channel_3", "ADC3", UA_TYPES_UINT16, 0},
+    {"adc_channel_4", "ADC4", UA_TYPES_UINT16, 0},
+    {"io_trace", "I/O Trace", UA_TYPES_BYTESTRING, 1},
+    {"io_trace_control", "I/O Trace Control", UA_TYPES_UINT16, 1},
+    {"io_trace_speed", "I/O Trace Speed", UA_TYPES_UINT16, 1},
+};
+#define GATEWAY_NODES (int)(sizeof(gateway_nodes) / sizeof(gateway_nodes[0]))
+
+static const char* read_tags[] = {
+    "diagnostic_counter", "loopback_input", "loopback_output", "discrete_inputs",
+    "discrete_outputs", "adc_channel_1", "adc_channel_2", "adc_channel_3", "adc_channel_4"
+};
+#define READ_TAGS (int)(sizeof(read_tags) / sizeof(read_tags[0]))
+
+static const char* monitored_tags[] = {
+    "discrete_inputs", "discrete_outputs", "adc_channel_1", "adc_channel_2", "adc_channel_3",
+    "adc_channel_4"
+};
+#define MONITORED_TAGS (int)(sizeof(monitored_tags) / sizeof(monitored_tags[0]))
+
+static UA_UInt16 node_values[GATEWAY_NODES];
+
+static void log_none(void* context, UA_LogLevel level, UA_LogCategory category, const char* msg,
+                     va_list args) {
+    (void)context; (void)level; (void)category; (void)msg; (void)args;
+}
+
+static UA_StatusCode ds_read(UA_Server* server, const UA_NodeId* sessionId, void* sessionContext,
+                             const UA_NodeId* nodeId, void* nodeContext, UA_Boolean sourceTimeStamp,
+                             const UA_NumericRange* range, UA_DataValue* dataValue) {
+    const GatewayNode* n = (const GatewayNode*)nodeContext;
+    if (n->type == UA_TYPES_BYTESTRING) {
+        UA_Variant_setScalar(&dataValue->value, UA_ByteString_new(), &UA_TYPES[UA_TYPES_BYTESTRING]);
+    } else {
+        UA_Variant_setScalarCopy(&dataValue->value, &node_values[n - gateway_nodes], &UA_TYPES[n->type]);
+    }
+    dataValue->hasValue = true;
+    if (sourceTimeStamp) {
+        dataValue->sourceTimestamp = UA_DateTime_now();
+        dataValue->hasSourceTimestamp = true;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode ds_write(UA_Server* server, const UA_NodeId* sessionId, void* sessionContext,
+                              const UA_NodeId* nodeId, void* nodeContext, const UA_NumericRange* range,
+                              const UA_DataValue* data) {
+    const GatewayNode* n = (const GatewayNode*)nodeContext;
+    if (n->type == UA_TYPES_UINT16 && data->hasValue &&
+        UA_Variant_hasScalarType(&data->value, &UA_TYPES[UA_TYPES_UINT16])) {
+        node_values[n - gateway_nodes] = *(UA_UInt16*)data->value.data;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static int add_gateway_nodes(UA_Server* server) {
+    int added = 0;
+    for (int i = 0; i < GATEWAY_NODES; i++) {
+        const GatewayNode* n = &gateway_nodes[i];
+        UA_VariableAttributes attr = UA_VariableAttributes_default;
+        attr.displayName = UA_LOCALIZEDTEXT("en-US", (char*)n->name);
+        attr.dataType = UA_TYPES[n->type].typeId;
+        attr.accessLevel = UA_ACCESSLEVELMASK_READ | (n->writable ? UA_ACCESSLEVELMASK_WRITE : 0);
+        UA_DataSource ds = {ds_read, n->writable ? ds_write : NULL};
+        UA_StatusCode rc = UA_Server_addDataSourceVariableNode(
+            server, UA_NODEID_STRING(1, (char*)n->id), UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+            UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES), UA_QUALIFIEDNAME(1, (char*)n->name),
+            UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, ds, (void*)n, NULL);
+        if (rc == UA_STATUSCODE_GOOD) added++;
+    }
+    return added;
+}
+
+static void count_node(void* ctx, const UA_Node* node) {
+    (void)node;
+    (*(size_t*)ctx)++;
+}
+
+// ========== STATIC SIZES ==========
+// Allocated sections of this executable, classified like the ESP-IDF size
+// report: code and read-only data live in flash, initialized data in flash
+// and RAM, bss in RAM only.
+
+typedef struct {
+    unsigned long code;
+    unsigned long rodata;
+    unsigned long data;
+    unsigned long bss;
+} StaticSizes;
+
+static int read_static_sizes(StaticSizes* s) {
+    memset(s, 0, sizeof(*s));
+    FILE* f = fopen("/proc/self/exe", "rb");
+    if (!f) return -1;
+    ElfW(Ehdr) eh;
+    int rc = -1;
+    if (fread(&eh, sizeof(eh), 1, f) == 1 && memcmp(eh.e_ident, ELFMAG, SELFMAG) == 0 &&
+        eh.e_shentsize == sizeof(ElfW(Shdr)) && fseek(f, (long)eh.e_shoff, SEEK_SET) == 0) {
+        rc = 0;
+        for (int i = 0; i < eh.e_shnum; i++) {
+            ElfW(Shdr) sh;
+            if (fread(&sh, sizeof(sh), 1, f) != 1) {
+                rc = -1;
+                break;
+            }
+            if (!(sh.sh_flags & SHF_ALLOC)) continue;
+            if (sh.sh_type == SHT_NOBITS) {
+                s->bss += sh.sh_size;
+            } else if (sh.sh_flags & SHF_EXECINSTR) {
+                s->code += sh.sh_size;
+            } else if (sh.sh_flags & SHF_WRITE) {
+                s->data += sh.sh_size;
+            } else {
+                s->rodata += sh.sh_size;
+            }
+        }
+    }
+    fclose(f);
+    return rc;
+}
+
+static int find_shared_stack(struct dl_phdr_info* info, size_t size, void* data) {
+    (void)size; (void)data;
+    return info->dlpi_name && strstr(info->dlpi_name, "libopen62541") != NULL;
+}
+
+// ========== BOOT MEASUREMENT ==========
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+typedef struct {
+    double first_response;      // ms from start to the first good Read response
+    double first_notification;  // ms from start to the first data change
+    int read_ok;                // Good results in the first Read
+    int monitored_ok;           // Monitored items created
+    int connect_attempts;
+} ClientResult;
+
+typedef struct {
+    double t_new, t_nodes, t_startup;
+    long heap_new, heap_nodes, heap_startup, heap_peak_startup, heap_session, heap_closed;
+    unsigned long allocs_startup;
+    size_t nodes;
+    int gateway_nodes;
+    ClientResult client;
+} RunResult;
+
+static int notifications;
+
+static void on_data_change(UA_Client* client, UA_UInt32 subId, void* subContext, UA_UInt32 monId,
+                           void* monContext, UA_DataValue* value) {
+    notifications++;
+}
+
+// Client side of one run (forked): poll the server until it answers, then
+// Read the gateway's tags and subscribe to the changing ones
+static void client_run(const char* url, double t0, int result_fd, int done_fd) {
+    ClientResult r;
+    memset(&r, 0, sizeof(r));
+    UA_Client* client = NULL;
+    UA_StatusCode rc = UA_STATUSCODE_BADCONNECTIONCLOSED;
+    while (now_ms() - t0 < CONNECT_TIMEOUT) {
+        client = UA_Client_new();
+        UA_ClientConfig* cc = UA_Client_getConfig(client);
+        cc->logger.log = log_none;
+        UA_ClientConfig_setDefault(cc);
+        r.connect_attempts++;
+        rc = UA_Client_connect(client, url);
+        if (rc == UA_STATUSCODE_GOOD) break;
+        UA_Client_delete(client);
+        client = NULL;
+        usleep(1000);
+    }
+
+    if (client) {
+        UA_ReadValueId ids[READ_TAGS];
+        for (int i = 0; i < READ_TAGS; i++) {
+            UA_ReadValueId_init(&ids[i]);
+            ids[i].nodeId = UA_NODEID_STRING(1, (char*)read_tags[i]);
+            ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+        }
+        UA_ReadRequest req;
+        UA_ReadRequest_init(&req);
+        req.nodesToRead = ids;
+        req.nodesToReadSize = READ_TAGS;
+        UA_ReadResponse resp = UA_Client_Service_read(client, req);
+        if (resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD) {
+            r.first_response = now_ms() - t0;
+            for (size_t i = 0; i < resp.resultsSize; i++) {
+                if (resp.results[i].hasValue && resp.results[i].status == UA_STATUSCODE_GOOD) r.read_ok++;
+            }
+        }
+        UA_ReadResponse_clear(&resp);
+
+        UA_CreateSubscriptionRequest sreq = UA_CreateSubscriptionRequest_default();
+        sreq.requestedPublishingInterval = 10.0;
+        UA_CreateSubscriptionResponse sresp =
+            UA_Client_Subscriptions_create(client, sreq, NULL, NULL, NULL);
+        if (sresp.responseHeader.serviceResult == UA_STATUSCODE_GOOD) {
+            for (int i = 0; i < MONITORED_TAGS; i++) {
+                UA_MonitoredItemCreateRequest item =
+                    UA_MonitoredItemCreateRequest_default(UA_NODEID_STRING(1, (char*)monitored_tags[i]));
+                UA_MonitoredItemCreateResult mr = UA_Client_MonitoredItems_createDataChange(
+                    client, sresp.subscriptionId, UA_TIMESTAMPSTORETURN_BOTH, item, NULL, on_data_change,
+                    NULL);
+                if (mr.statusCode == UA_STATUSCODE_GOOD) r.monitored_ok++;
+            }
+            while (notifications == 0 && now_ms() - t0 < CONNECT_TIMEOUT) {
+                UA_Client_run_iterate(client, 5);
+            }
+            if (notifications > 0) r.first_notification = now_ms() - t0;
+        }
+    }
+
+    // Hand over the result and keep the session until the server has measured it
+    if (write(result_fd, &r, sizeof(r)) != (ssize_t)sizeof(r)) _exit(1);
+    char done;
+    while (read(done_fd, &done, 1) < 0) {}
+    if (client) {
+        UA_Client_disconnect(client);
+        UA_Client_delete(client);
+    }
+    _exit(0);
+}
+
+// One cold start of the server with a client waiting for it
+static int run_once(UA_UInt16 port, RunResult* out) {
+    memset(out, 0, sizeof(*out));
+    char url[64];
+    snprintf(url, sizeof(url), "opc.tcp://127.0.0.1:%u", port);
+    int to_server[2], to_client[2];
+    if (pipe(to_server) != 0 || pipe(to_client) != 0) return -1;
+
+    fflush(stdout);
+    double t0 = now_ms();
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        tracking = 0;
+        close(to_server[0]);
+        close(to_client[1]);
+        client_run(url, t0, to_server[1], to_client[0]);
+    }
+    close(to_server[1]);
+    close(to_client[0]);
+
+    // Same steps as opcua_task() in main/opcua_esp32.c
+    heap_live = heap_peak = 0;
+    alloc_count = 0;
+    tracking = HEAP_TRACKING;
+    UA_Server* server = UA_Server_new();
+    UA_ServerConfig* config = UA_Server_getConfig(server);
+    config->logger.log = log_none;
+    UA_ServerConfig_setMinimalCustomBuffer(config, port, 0, 16384, 16384);
+    config->logger.log = log_none;
+    UA_ServerConfig_setCustomHostname(config, UA_STRING("opcua-esp32"));
+    out->t_new = now_ms() - t0;
+    out->heap_new = heap_live;
+
+    out->gateway_nodes = add_gateway_nodes(server);
+    out->t_nodes = now_ms() - t0;
+    out->heap_nodes = heap_live;
+
+    UA_StatusCode rc = UA_Server_run_startup(server);
+    out->t_startup = now_ms() - t0;
+    out->heap_startup = heap_live;
+    out->heap_peak_startup = heap_peak;
+    out->allocs_startup = alloc_count;
+    config->nodestore.iterate(config->nodestore.context, count_node, &out->nodes);
+
+    int got_result = 0;
+    int child_done = 0;
+    int status;
+    struct pollfd pfd = {to_server[0], POLLIN, 0};
+    while (rc == UA_STATUSCODE_GOOD && !child_done) {
+        UA_Server_run_iterate(server, false);
+        if (!got_result && poll(&pfd, 1, 0) > 0) {
+            got_result = read(to_server[0], &out->client, sizeof(out->client)) == (ssize_t)sizeof(out->client);
+            out->heap_session = heap_live;
+            if (write(to_client[1], "x", 1) != 1) break;
+        }
+        if (got_result) {
+            child_done = waitpid(pid, &status, WNOHANG) == pid;
+        }
+        usleep(200);
+    }
+    // Let the server drop the closed connection
+    for (int i = 0; i < 50; i++) {
+        UA_Server_run_iterate(server, false);
+        usleep(200);
+    }
+    out->heap_closed = heap_live;
+
+    if (!child_done) {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+    }
+    UA_Server_run_shutdown(server);
+    UA_Server_delete(server);
+    tracking = 0;
+    close(to_server[0]);
+    close(to_client[1]);
+    return rc == UA_STATUSCODE_GOOD && got_result ? 0 : -1;
+}
+
+// ========== REPORT ==========
+
+typedef struct {
+    const char* name;
+    const char* unit;
+    double value;
+} Metric;
+
+static Metric metrics[MAX_METRICS];
+static int nmetrics;
+
+static void add_metric(const char* name, const char* unit, double value) {
+    if (nmetrics < MAX_METRICS) {
+        metrics[nmetrics].name = name;
+        metrics[nmetrics].unit = unit;
+        metrics[nmetrics++].value = value;
+    }
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double* v, int n) {
+    qsort(v, (size_t)n, sizeof(double), compare_double);
+    return v[n / 2];
+}
+
+// Baseline entry of a previous -o run
+static int baseline_lookup(const char* path, const char* name, double* value) {
+    FILE* f = path ? fopen(path, "r") : NULL;
+    if (!f) return 0;
+    char line[256];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), f)) {
+        char* comma = strchr(line, ',');
+        if (!comma) continue;
+        *comma = '\0';
+        if (strcmp(line, name) == 0) {
+            *value = atof(comma + 1);
+            found = 1;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+static void print_profile(void) {
+    printf("Stack features:");
+#ifdef UA_ENABLE_METHODCALLS
+    printf(" methods");
+#endif
+#ifdef UA_ENABLE_NODEMANAGEMENT
+    printf(" nodemanagement");
+#endif
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+    printf(" subscriptions");
+#endif
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    printf(" events");
+#endif
+#ifdef UA_ENABLE_DA
+    printf(" da");
+#endif
+#ifdef UA_ENABLE_PARSING
+    printf(" parsing");
+#endif
+#ifdef UA_ENABLE_STATUSCODE_DESCRIPTIONS
+    printf(" statuscode-names");
+#endif
+#ifdef UA_ENABLE_DISCOVERY
+    printf(" discovery");
+#endif
+#ifdef UA_ENABLE_DISCOVERY_MULTICAST
+    printf(" mdns");
+#endif
+#if defined(UA_GENERATED_NAMESPACE_ZERO_FULL)
+    printf(" ns0-full");
+#elif defined(UA_GENERATED_NAMESPACE_ZERO)
+    printf(" ns0-reduced");
+#else
+    printf(" ns0-minimal");
+#endif
+    printf("\n");
+}
+
+static void print_help(const char* program_name) {
+    printf("OPC UA STACK FOOTPRINT REPORT (build profiles)\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help           Show this help message\n");
+    printf("  -n, --runs N         Server cold starts, median boot times reported (default: 5)\n");
+    printf("  -P, --port N         TCP port of the in-process server (default: 4841)\n");
+    printf("  -o, --output FILE    Write the results as CSV\n");
+    printf("  -b, --baseline FILE  Compare with the CSV of a previous run\n");
+    printf("\nExamples:\n");
+    printf("  ./test_footprint_std -o standard.csv\n");
+    printf("  ./test_footprint_nano -b standard.csv -o nano.csv\n");
+}
+
+int main(int argc, char* argv[]) {
+    // Default values
+    int runs = 5;
+    int port = 4841;
+    const char* csv_file = NULL;
+    const char* baseline_file = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--runs") == 0) && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--port") == 0) && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--baseline") == 0) && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        }
+    }
+    if (runs < 1) runs = 1;
+    if (runs > MAX_RUNS) runs = MAX_RUNS;
+    if (port < 1 || port > 65535) port = 4841;
+
+    printf("=============================================\n");
+    printf("   OPC UA STACK FOOTPRINT REPORT\n");
+    printf("   open62541 %s, %d cold starts on port %d\n", UA_OPEN62541_VER_COMMIT, runs, port);
+    printf("=============================================\n\n");
+    print_profile();
+
+    StaticSizes sz;
+    int static_ok = read_static_sizes(&sz) == 0;
+    if (dl_iterate_phdr(find_shared_stack, NULL)) {
+        printf("WARNING: open62541 is linked as a shared library, static sizes exclude the stack\n");
+    }
+    if (!HEAP_TRACKING) {
+        printf("WARNING: heap accounting needs glibc, heap metrics are 0\n");
+    }
+
+    RunResult first;
+    double t_new[MAX_RUNS], t_startup[MAX_RUNS], t_first[MAX_RUNS], t_notify[MAX_RUNS];
+    int ok = 0;
+    for (int i = 0; i < runs; i++) {
+        RunResult r;
+        if (run_once((UA_UInt16)port, &r) != 0 || r.client.first_response <= 0) {
+            printf("Run %d failed (gateway nodes %d/%d, first Read %d/%d, monitored items %d/%d)\n", i + 1,
+                   r.gateway_nodes, GATEWAY_NODES, r.client.read_ok, READ_TAGS, r.client.monitored_ok,
+                   MONITORED_TAGS);
+            continue;
+        }
+        if (ok == 0) first = r;
+        t_new[ok] = r.t_new;
+        t_startup[ok] = r.t_startup;
+        t_first[ok] = r.client.first_response;
+        t_notify[ok] = r.client.first_notification;
+        ok++;
+    }
+    if (ok == 0) {
+        printf("No successful run\n");
+        return 1;
+    }
+    printf("Gateway nodes: %d/%d added, first Read %d/%d good, %d/%d monitored items\n\n",
+           first.gateway_nodes, GATEWAY_NODES, first.client.read_ok, READ_TAGS, first.client.monitored_ok,
+           MONITORED_TAGS);
+
+    // Heap figures come from the first (cold) run
+    if (static_ok) {
+        add_metric("flash_code", "bytes", sz.code);
+        add_metric("flash_rodata", "bytes", sz.rodata);
+        add_metric("flash_total", "bytes", sz.code + sz.rodata + sz.data);
+        add_metric("static_ram_data", "bytes", sz.data);
+        add_metric("static_ram_bss", "bytes", sz.bss);
+        add_metric("static_ram_total", "bytes", sz.data + sz.bss);
+    }
+    add_metric("nodes", "nodes", first.nodes);
+    add_metric("heap_server_new", "bytes", first.heap_new);
+    add_metric("heap_gateway_nodes", "bytes", first.heap_nodes);
+    add_metric("heap_after_startup", "bytes", first.heap_startup);
+    add_metric("heap_peak_startup", "bytes", first.heap_peak_startup);
+    add_metric("allocs_startup", "allocs", first.allocs_startup);
+    add_metric("heap_one_session", "bytes", first.heap_session);
+    add_metric("heap_session_closed", "bytes", first.heap_closed);
+    add_metric("boot_server_new", "ms", median(t_new, ok));
+    add_metric("boot_startup", "ms", median(t_startup, ok));
+    add_metric("boot_first_response", "ms", median(t_first, ok));
+    add_metric("boot_first_notification", "ms", median(t_notify, ok));
+
+    FILE* csv = csv_file ? fopen(csv_file, "w") : NULL;
+    if (csv) fprintf(csv, "metric,value\n");
+    printf("%-26s %14s %8s %14s %9s\n", "metric", "value", "unit", baseline_file ? "baseline" : "",
+           baseline_file ? "change" : "");
+    printf("-------------------------------------------------------------------------\n");
+    for (int i = 0; i < nmetrics; i++) {
+        Metric* m = &metrics[i];
+        char base_str[24] = "", delta[16] = "";
+        double base;
+        if (baseline_lookup(baseline_file, m->name, &base)) {
+            snprintf(base_str, sizeof(base_str), "%.*f", strcmp(m->unit, "ms") == 0 ? 2 : 0, base);
+            if (base != 0) snprintf(delta, sizeof(delta), "%+.1f%%", (m->value / base - 1.0) * 100.0);
+        }
+        printf("%-26s %14.*f %8s %14s %9s\n", m->name, strcmp(m->unit, "ms") == 0 ? 2 : 0, m->value,
+               m->unit, base_str, delta);
+        if (csv) fprintf(csv, "%s,%.3f\n", m->name, m->value);
+    }
+    if (csv) fclose(csv);
+    printf("\nBoot times: median of %d cold starts, measured from the start of the run (before UA_Server_new)\n", ok);
+    return 0;
+}
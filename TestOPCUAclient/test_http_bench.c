@@ -0,0 +1,313 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// Monitoring scrape benchmark.
+// Compares the cost of one monitoring scrape through the HTTP snapshot
+// endpoint (/metrics) with an equivalent OPC UA Read of all 9 tags:
+//   1. HTTP GET on a keep-alive connection
+//   2. HTTP GET with a new TCP connection per scrape
+//   3. OPC UA Read (9 nodes, one request) on a persistent session
+//   4. OPC UA connect + session + Read + disconnect per scrape
+
+// Latency statistics for one test mode
+typedef struct {
+    const char* name;
+    double* samples;
+    int count;
+    int errors;
+    size_t bytes;
+} BenchResult;
+
+// Monotonic time in milliseconds
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Open a TCP connection to the HTTP endpoint
+static int http_connect(const char* host, int port) {
+    char port_str[8];
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    if (getaddrinfo(host, port_str, &hints, &res) != 0) return -1;
+    int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (sock >= 0 && connect(sock, res->ai_addr, res->ai_addrlen) != 0) {
+        close(sock);
+        sock = -1;
+    }
+    freeaddrinfo(res);
+    if (sock >= 0) {
+        int one = 1;
+        struct timeval tv = { .tv_sec = 2, .tv_usec = 0 };
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    return sock;
+}
+
+// Send one GET and read the complete response (Content-Length based)
+// Returns body length or -1 on error
+static long http_get(int sock, const char* host, const char* path, int keep_alive) {
+    char req[256];
+    static char resp[16384];
+    int len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: %s\r\n%s\r\n",
+                       path, host, keep_alive ? "" : "Connection: close\r\n");
+    if (send(sock, req, len, 0) != len) return -1;
+
+    size_t got = 0;
+    long content_length = -1;
+    char* body = NULL;
+    while (got < sizeof(resp) - 1) {
+        ssize_t n = recv(sock, resp + got, sizeof(resp) - 1 - got, 0);
+        if (n <= 0) return -1;
+        got += (size_t)n;
+        resp[got] = '\0';
+        if (!body) {
+            body = strstr(resp, "\r\n\r\n");
+            if (body) {
+                body += 4;
+                char* cl = strstr(resp, "Content-Length:");
+                if (!cl || strncmp(resp, "HTTP/1.1 200", 12) != 0) return -1;
+                content_length = strtol(cl + 15, NULL, 10);
+            }
+        }
+        if (body && (long)(got - (body - resp)) >= content_length) {
+            return content_length;
+        }
+    }
+    return -1;
+}
+
+// Build a ReadRequest for the 9 gateway tags
+static void build_read_request(UA_ReadRequest* req, UA_ReadValueId* ids) {
+    static const char* tags[] = {
+        "diagnostic_counter", "loopback_input", "loopback_output",
+        "discrete_inputs", "discrete_outputs",
+        "adc_channel_1", "adc_channel_2", "adc_channel_3", "adc_channel_4"
+    };
+    for (int i = 0; i < 9; i++) {
+        UA_ReadValueId_init(&ids[i]);
+        ids[i].nodeId = UA_NODEID_STRING(1, (char*)tags[i]);
+        ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    UA_ReadRequest_init(req);
+    req->nodesToRead = ids;
+    req->nodesToReadSize = 9;
+    req->timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+}
+
+// Execute one read; returns 0 on success
+static int opcua_read_all(UA_Client* client, UA_ReadRequest* req) {
+    UA_ReadResponse resp = UA_Client_Service_read(client, *req);
+    int ok = resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD && resp.resultsSize == 9;
+    UA_ReadResponse_clear(&resp);
+    return ok ? 0 : -1;
+}
+
+// Connect an OPC UA client with optional credentials
+static UA_Client* opcua_connect(const char* url, const char* user, const char* pass) {
+    UA_Client* client = UA_Client_new();
+    UA_StatusCode status = (user && pass) ? UA_Client_connectUsername(client, url, user, pass)
+                                          : UA_Client_connect(client, url);
+    if (status != UA_STATUSCODE_GOOD) {
+        UA_Client_delete(client);
+        return NULL;
+    }
+    return client;
+}
+
+static void print_result(BenchResult* r) {
+    if (r->count == 0) {
+        printf("%-28s no successful samples (%d errors)\n", r->name, r->errors);
+        return;
+    }
+    qsort(r->samples, r->count, sizeof(double), cmp_double);
+    double sum = 0.0;
+    for (int i = 0; i < r->count; i++) sum += r->samples[i];
+    printf("%-28s %8.3f %8.3f %8.3f %8.3f %8.1f %6d",
+           r->name, sum / r->count, r->samples[r->count / 2],
+           r->samples[(int)(r->count * 0.95)], r->samples[r->count - 1],
+           1000.0 * r->count / sum, r->errors);
+    if (r->bytes) printf("  %zu B", r->bytes);
+    printf("\n");
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("MONITORING SCRAPE BENCHMARK (HTTP snapshot vs OPC UA Read)\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help           Show this help message\n");
+    printf("  -H, --http-port N    HTTP snapshot port (default: 8080)\n");
+    printf("  -P, --path PATH      HTTP path (default: /metrics)\n");
+    printf("  -n, --count N        Scrapes per mode (default: 200)\n");
+    printf("  -u, --user NAME      OPC UA username\n");
+    printf("  -p, --pass PASSWORD  OPC UA password\n");
+    printf("\nExample:\n");
+    printf("  %s -n 500 -u operator -p readonly123 opc.tcp://10.0.0.128:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    // Default values
+    char* server_url = "opc.tcp://10.0.0.128:4840";
+    int http_port = 8080;
+    const char* path = "/metrics";
+    int count = 200;
+    const char* username = NULL;
+    const char* password = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-H") == 0 || strcmp(argv[i], "--http-port") == 0) && i + 1 < argc) {
+            http_port = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--path") == 0) && i + 1 < argc) {
+            path = argv[++i];
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--count") == 0) && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (count < 1) count = 1;
+
+    // Host name from opc.tcp://host:port
+    char host[128] = "127.0.0.1";
+    const char* h = strstr(server_url, "://");
+    if (h) {
+        h += 3;
+        size_t n = strcspn(h, ":/");
+        if (n > 0 && n < sizeof(host)) {
+            memcpy(host, h, n);
+            host[n] = '\0';
+        }
+    }
+
+    BenchResult results[4] = {
+        { "HTTP keep-alive", calloc(count, sizeof(double)), 0, 0, 0 },
+        { "HTTP new connection", calloc(count, sizeof(double)), 0, 0, 0 },
+        { "OPC UA Read (session)", calloc(count, sizeof(double)), 0, 0, 0 },
+        { "OPC UA connect+Read", calloc(count, sizeof(double)), 0, 0, 0 },
+    };
+
+    printf("=============================================\n");
+    printf("   MONITORING SCRAPE BENCHMARK\n");
+    printf("   HTTP http://%s:%d%s vs %s\n", host, http_port, path, server_url);
+    printf("   %d scrapes per mode\n", count);
+    printf("=============================================\n\n");
+
+    // ========== 1. HTTP KEEP-ALIVE ==========
+    int sock = http_connect(host, http_port);
+    for (int i = 0; i < count && sock >= 0; i++) {
+        double t0 = now_ms();
+        long len = http_get(sock, host, path, 1);
+        if (len < 0) {
+            results[0].errors++;
+            close(sock);
+            sock = http_connect(host, http_port);
+            continue;
+        }
+        results[0].samples[results[0].count++] = now_ms() - t0;
+        results[0].bytes = (size_t)len;
+    }
+    if (sock >= 0) close(sock);
+    else results[0].errors++;
+
+    // ========== 2. HTTP NEW CONNECTION ==========
+    for (int i = 0; i < count; i++) {
+        double t0 = now_ms();
+        sock = http_connect(host, http_port);
+        long len = sock >= 0 ? http_get(sock, host, path, 0) : -1;
+        if (sock >= 0) close(sock);
+        if (len < 0) {
+            results[1].errors++;
+            continue;
+        }
+        results[1].samples[results[1].count++] = now_ms() - t0;
+        results[1].bytes = (size_t)len;
+    }
+
+    // ========== 3. OPC UA READ ON SESSION ==========
+    UA_ReadRequest req;
+    UA_ReadValueId ids[9];
+    build_read_request(&req, ids);
+
+    UA_Client* client = opcua_connect(server_url, username, password);
+    if (client) {
+        for (int i = 0; i < count; i++) {
+            double t0 = now_ms();
+            if (opcua_read_all(client, &req) != 0) {
+                results[2].errors++;
+                continue;
+            }
+            results[2].samples[results[2].count++] = now_ms() - t0;
+        }
+        UA_Client_disconnect(client);
+        UA_Client_delete(client);
+    } else {
+        printf("OPC UA connection failed\n");
+        results[2].errors = count;
+    }
+
+    // ========== 4. OPC UA SESSION PER SCRAPE ==========
+    for (int i = 0; i < count; i++) {
+        double t0 = now_ms();
+        client = opcua_connect(server_url, username, password);
+        if (!client) {
+            results[3].errors++;
+            continue;
+        }
+        int rc = opcua_read_all(client, &req);
+        UA_Client_disconnect(client);
+        UA_Client_delete(client);
+        if (rc != 0) {
+            results[3].errors++;
+            continue;
+        }
+        results[3].samples[results[3].count++] = now_ms() - t0;
+    }
+
+    // ========== RESULTS ==========
+    printf("%-28s %8s %8s %8s %8s %8s %6s\n", "Mode", "avg ms", "p50 ms", "p95 ms", "max ms",
+           "scr/s", "errors");
+    for (int i = 0; i < 4; i++) {
+        print_result(&results[i]);
+        free(results[i].samples);
+    }
+
+    printf("\n=== TEST COMPLETED ===\n");
+    return 0;
+}
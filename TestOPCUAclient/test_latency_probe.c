@@ -0,0 +1,313 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// End-to-end latency split with the LatencyProbe object (components/latency_probe).
+// Each probe writes [sequence, client send time] to probe.Request. The
+// gateway stamps when the request came off the socket and when the write
+// executed, and stamps Result when it is first read or sampled. Only
+// differences of server stamps are used, so no clock synchronization is
+// needed. The client round trips are split into:
+//   read mode          write network, server queue, read network, read queue
+//   subscription mode  write network, server queue, sampling wait, publish
+//                      and return (notification time less everything else)
+// "Network" is the round trip less the server's own time, so it includes
+// the client stack and the kernels on both sides.
+
+#define REQUEST_FIELDS      2
+#define RESULT_FIELDS       6
+#define F_SEQUENCE          0
+#define F_CLIENT_TIME       1
+#define F_RECEIVED          2
+#define F_EXECUTED          3
+#define F_DELIVERED         4
+#define F_DELIVERY_RECEIVED 5
+
+#define COMPONENTS          5
+
+typedef struct {
+    const char* name;
+    const char* components[COMPONENTS];
+} Mode;
+
+static const Mode modes[] = {
+    {"read", {"total", "write network", "server queue", "read network", "read queue"}},
+    {"sub", {"total", "write network", "server queue", "sampling wait", "publish+return"}},
+};
+
+static const char* username;
+static const char* password;
+static UA_UInt32 timeout_ms = 2000;
+
+// Last notification of the probe subscription
+static UA_Int64 notified[RESULT_FIELDS];
+static UA_Int64 notified_at;
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int count, double p) {
+    if (count == 0) return 0.0;
+    int idx = (int)(count * p);
+    if (idx >= count) idx = count - 1;
+    return sorted[idx];
+}
+
+// Client clock in microseconds
+static UA_Int64 now_us(void) {
+    return UA_DateTime_nowMonotonic() / UA_DATETIME_USEC;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static UA_StatusCode write_request(UA_Client* client, UA_Int64 sequence, UA_Int64 sent) {
+    UA_Int64 request[REQUEST_FIELDS] = {sequence, sent};
+    UA_Variant value;
+    UA_Variant_setArray(&value, request, REQUEST_FIELDS, &UA_TYPES[UA_TYPES_INT64]);
+    return UA_Client_writeValueAttribute(client, UA_NODEID_STRING(1, "probe.Request"), &value);
+}
+
+static int read_result(UA_Client* client, UA_Int64* result) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, "probe.Result"), &value);
+    int ok = status == UA_STATUSCODE_GOOD && value.type == &UA_TYPES[UA_TYPES_INT64] &&
+             value.arrayLength == RESULT_FIELDS;
+    if (ok) memcpy(result, value.data, sizeof(UA_Int64) * RESULT_FIELDS);
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static void on_result(UA_Client* client, UA_UInt32 subId, void* subContext,
+                      UA_UInt32 monId, void* monContext, UA_DataValue* value) {
+    // Stamp first: the notification may arrive while the write still waits for its response
+    UA_Int64 at = now_us();
+    if (!value->hasValue || value->value.type != &UA_TYPES[UA_TYPES_INT64] ||
+        value->value.arrayLength != RESULT_FIELDS) {
+        return;
+    }
+    memcpy(notified, value->value.data, sizeof(notified));
+    notified_at = at;
+}
+
+// One probe in read mode, components in microseconds
+static int probe_read(UA_Client* client, UA_Int64 sequence, double* c) {
+    UA_Int64 result[RESULT_FIELDS];
+    UA_Int64 t0 = now_us();
+    if (write_request(client, sequence, t0) != UA_STATUSCODE_GOOD) return 0;
+    UA_Int64 tw = now_us();
+    if (!read_result(client, result)) return 0;
+    UA_Int64 t1 = now_us();
+    if (result[F_SEQUENCE] != sequence || result[F_CLIENT_TIME] != t0 || result[F_DELIVERY_RECEIVED] == 0) {
+        return 0;
+    }
+    double queue = (double)(result[F_EXECUTED] - result[F_RECEIVED]);
+    double read_queue = (double)(result[F_DELIVERED] - result[F_DELIVERY_RECEIVED]);
+    c[0] = (double)(t1 - t0);
+    c[1] = (double)(tw - t0) - queue;
+    c[2] = queue;
+    c[3] = (double)(t1 - tw) - read_queue;
+    c[4] = read_queue;
+    return 1;
+}
+
+// One probe in subscription mode, components in microseconds
+static int probe_sub(UA_Client* client, UA_Int64 sequence, double* c) {
+    UA_Int64 t0 = now_us();
+    if (write_request(client, sequence, t0) != UA_STATUSCODE_GOOD) return 0;
+    UA_Int64 tw = now_us();
+    UA_Int64 end = tw + (UA_Int64)timeout_ms * 1000;
+    while (notified[F_SEQUENCE] != sequence && now_us() < end) UA_Client_run_iterate(client, 1);
+    if (notified[F_SEQUENCE] != sequence || notified[F_CLIENT_TIME] != t0) return 0;
+    double queue = (double)(notified[F_EXECUTED] - notified[F_RECEIVED]);
+    double network = (double)(tw - t0) - queue;
+    c[0] = (double)(notified_at - t0);
+    c[1] = network;
+    c[2] = queue;
+    c[3] = (double)(notified[F_DELIVERED] - notified[F_EXECUTED]);
+    c[4] = c[0] - (double)(notified[F_DELIVERED] - notified[F_RECEIVED]) - network / 2.0;
+    return 1;
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA END-TO-END LATENCY PROBE\n");
+    printf("===============================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -n, --probes N         Probes per mode (default: 200)\n");
+    printf("  -m, --mode MODE        read, sub or both (default: both)\n");
+    printf("  -i, --publish MS       Publishing interval of the subscription (default: 50)\n");
+    printf("  -s, --sampling MS      Sampling interval of probe.Result (default: 10)\n");
+    printf("  -g, --gap MS           Pause between probes (default: 20)\n");
+    printf("  -t, --timeout MS       Request and notification timeout (default: 2000)\n");
+    printf("  -o, --csv FILE         Also write every probe as CSV\n");
+    printf("  -u, --user NAME        Username\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nExamples:\n");
+    printf("  %s opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -m sub -i 20 -s 0 -n 1000 -o probes.csv opc.tcp://10.0.0.128:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_url = "opc.tcp://10.0.0.128:4840";
+    const char* csv_file = NULL;
+    const char* mode_name = "both";
+    int probes = 200;
+    double publish_ms = 50.0;
+    double sampling_ms = 10.0;
+    int gap_ms = 20;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--probes") == 0) && i + 1 < argc) {
+            probes = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--mode") == 0) && i + 1 < argc) {
+            mode_name = argv[++i];
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--publish") == 0) && i + 1 < argc) {
+            publish_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sampling") == 0) && i + 1 < argc) {
+            sampling_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-g") == 0 || strcmp(argv[i], "--gap") == 0) && i + 1 < argc) {
+            gap_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = (UA_UInt32)atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    int run_read = strcmp(mode_name, "read") == 0 || strcmp(mode_name, "both") == 0;
+    int run_sub = strcmp(mode_name, "sub") == 0 || strcmp(mode_name, "both") == 0;
+    if (!run_read && !run_sub) {
+        printf("Unknown mode: %s\n", mode_name);
+        return 1;
+    }
+    if (probes < 1) probes = 1;
+    if (gap_ms < 0) gap_ms = 0;
+
+    UA_Client* client = UA_Client_new();
+    UA_ClientConfig* config = UA_Client_getConfig(client);
+    UA_ClientConfig_setDefault(config);
+    config->timeout = timeout_ms;
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, server_url, username, password)
+        : UA_Client_connect(client, server_url);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection failed: %s\n", UA_StatusCode_name(status));
+        UA_Client_delete(client);
+        return 1;
+    }
+
+    double* samples[2][COMPONENTS];
+    for (int m = 0; m < 2; m++) {
+        for (int k = 0; k < COMPONENTS; k++) samples[m][k] = calloc((size_t)probes, sizeof(double));
+    }
+    int answered[2] = {0, 0};
+    FILE* csv = csv_file ? fopen(csv_file, "w") : NULL;
+    if (csv) fprintf(csv, "mode,sequence,c0_us,c1_us,c2_us,c3_us,c4_us\n");
+    UA_Int64 sequence = now_us();
+    int failed = 0;
+
+    for (int m = 0; m < 2; m++) {
+        if ((m == 0 && !run_read) || (m == 1 && !run_sub)) continue;
+
+        UA_UInt32 sub_id = 0;
+        if (m == 1) {
+            UA_CreateSubscriptionRequest sreq = UA_CreateSubscriptionRequest_default();
+            sreq.requestedPublishingInterval = publish_ms;
+            UA_CreateSubscriptionResponse sresp = UA_Client_Subscriptions_create(client, sreq, NULL, NULL, NULL);
+            UA_MonitoredItemCreateResult mresult;
+            UA_MonitoredItemCreateResult_init(&mresult);
+            if (sresp.responseHeader.serviceResult == UA_STATUSCODE_GOOD) {
+                sub_id = sresp.subscriptionId;
+                UA_MonitoredItemCreateRequest item =
+                    UA_MonitoredItemCreateRequest_default(UA_NODEID_STRING(1, "probe.Result"));
+                item.requestedParameters.samplingInterval = sampling_ms;
+                mresult = UA_Client_MonitoredItems_createDataChange(client, sub_id, UA_TIMESTAMPSTORETURN_NEITHER,
+                                                                    item, NULL, on_result, NULL);
+                printf("Subscription: publishing %.1f ms, sampling %.1f ms (revised %.1f / %.1f)\n",
+                       publish_ms, sampling_ms, sresp.revisedPublishingInterval, mresult.revisedSamplingInterval);
+            }
+            if (mresult.statusCode != UA_STATUSCODE_GOOD || sub_id == 0) {
+                printf("FAIL: no subscription on probe.Result\n");
+                failed = 1;
+                break;
+            }
+            // The initial value is the previous probe; let it arrive before the first new one
+            UA_Int64 end = now_us() + (UA_Int64)(publish_ms + sampling_ms) * 2000;
+            while (now_us() < end) UA_Client_run_iterate(client, 10);
+        }
+
+        printf("%s: %d probes\n", modes[m].name, probes);
+        for (int i = 0; i < probes; i++) {
+            double c[COMPONENTS];
+            sequence++;
+            int ok = m == 0 ? probe_read(client, sequence, c) : probe_sub(client, sequence, c);
+            if (!ok) {
+                printf("  probe %d: no answer with sequence %lld\n", i, (long long)sequence);
+                continue;
+            }
+            for (int k = 0; k < COMPONENTS; k++) samples[m][k][answered[m]] = c[k];
+            answered[m]++;
+            if (csv) {
+                fprintf(csv, "%s,%lld,%.0f,%.0f,%.0f,%.0f,%.0f\n", modes[m].name, (long long)sequence,
+                        c[0], c[1], c[2], c[3], c[4]);
+            }
+            if (gap_ms > 0) {
+                if (m == 1) {
+                    UA_Int64 end = now_us() + (UA_Int64)gap_ms * 1000;
+                    while (now_us() < end) UA_Client_run_iterate(client, 1);
+                } else {
+                    sleep_ms(gap_ms);
+                }
+            }
+        }
+        if (answered[m] != probes) {
+            printf("FAIL: %s answered %d of %d probes\n", modes[m].name, answered[m], probes);
+            failed = 1;
+        }
+        if (sub_id) UA_Client_Subscriptions_deleteSingle(client, sub_id);
+    }
+    if (csv) fclose(csv);
+
+    printf("\n%-6s %-16s %10s %10s %10s\n", "mode", "component", "p50 us", "p99 us", "max us");
+    for (int m = 0; m < 2; m++) {
+        if (answered[m] == 0) continue;
+        for (int k = 0; k < COMPONENTS; k++) {
+            qsort(samples[m][k], (size_t)answered[m], sizeof(double), cmp_double);
+            printf("%-6s %-16s %10.0f %10.0f %10.0f\n", k == 0 ? modes[m].name : "", modes[m].components[k],
+                   percentile(samples[m][k], answered[m], 0.50), percentile(samples[m][k], answered[m], 0.99),
+                   samples[m][k][answered[m] - 1]);
+        }
+    }
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+
+    for (int m = 0; m < 2; m++) {
+        for (int k = 0; k < COMPONENTS; k++) free(samples[m][k]);
+    }
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    return failed;
+}
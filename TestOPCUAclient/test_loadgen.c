@@ -0,0 +1,1013 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Exported by the open62541 amalgamation, declared only in its internal headers
+size_t UA_calcSizeBinary(const void* p, const UA_DataType* type);
+
+// Open-loop OPC UA load generator.
+// Requests are scheduled at a fixed rate on a fixed timeline (t0 + k / rate),
+// independent of how fast the gateway answers. Latency is measured from the
+// intended send time, not from the moment the request actually left, so a
+// stalled gateway shows up in the percentiles instead of silently slowing the
+// test down (coordinated omission).
+//
+// Requests are sent asynchronously over one or more sessions; a request that
+// cannot be sent on time because every session has its maximum of outstanding
+// requests waits in a backlog and keeps its intended time.
+//
+// The rate is swept step by step (or taken from a list) to find the
+// saturation knee: the highest rate the gateway sustains with its achieved
+// throughput within 5% of the target, less than 1% errors and p99 below the
+// limit. Workloads: Read of K tags, Write of loopback_input, or a mix.
+//
+// Pipeline mode (-P) is closed-loop instead: every session keeps exactly
+// DEPTH requests outstanding and sends the next one as soon as a response
+// arrives. Throughput and latency per depth show how the single-threaded
+// server loop and the TCP buffers cope with pipelined requests.
+//
+// Reconnect mode (-R) measures a reconnect storm instead: every session has a
+// subscription with K data change items, all sessions lose their connection
+// at once (no CloseSession) and come back together, one thread each. The time
+// from the drop to the first data notification is measured per session for
+// three ways back: recreate the session, subscription and items; resume the
+// old session on a new SecureChannel; or, after the old session timed out,
+// take over its subscription with TransferSubscriptions.
+
+#define MAX_CONNECTIONS 16
+#define MAX_RATES 64
+
+typedef enum { WL_READ, WL_WRITE, WL_MIXED } Workload;
+
+// Outstanding request, passed as userdata to the async callback
+typedef struct {
+    double intended_us;          // Scheduled send time
+    int is_write;
+    int used;
+    struct Connection* conn;
+} Slot;
+
+typedef struct Connection {
+    UA_Client* client;
+    Slot* slots;
+    int inflight;
+} Connection;
+
+// Latency samples of one request kind during one step
+typedef struct {
+    double* samples;             // Milliseconds from intended send time to response
+    int count;
+    int capacity;
+    int errors;
+} Samples;
+
+// Result of one rate step
+typedef struct {
+    double target;
+    double achieved;
+    int scheduled;
+    int unsent;                  // Still in the backlog when the drain timed out
+    double max_backlog_ms;       // Largest lag of the scheduler behind the timeline
+    double p50, p90, p99, p999, max;
+    int errors;
+    int saturated;
+} StepResult;
+
+// Result of one pipeline depth
+typedef struct {
+    int depth;
+    double throughput;
+    double mean, p50, p99, max;
+    int errors;
+} DepthResult;
+
+static const char* tag_names[] = {
+    "diagnostic_counter", "loopback_input", "loopback_output", "discrete_inputs",
+    "discrete_outputs", "adc_channel_1", "adc_channel_2", "adc_channel_3", "adc_channel_4"
+};
+
+// Shared state of the running step (the callbacks run inside UA_Client_run_iterate)
+static Samples read_samples, write_samples;
+static int completed;
+static double last_completion_us;
+
+// Monotonic time in microseconds
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void samples_reset(Samples* s, int capacity) {
+    if (capacity > s->capacity) {
+        free(s->samples);
+        s->samples = calloc(capacity, sizeof(double));
+        s->capacity = capacity;
+    }
+    s->count = 0;
+    s->errors = 0;
+}
+
+static void samples_add(Samples* s, double ms) {
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 1024;
+        s->samples = realloc(s->samples, s->capacity * sizeof(double));
+    }
+    s->samples[s->count++] = ms;
+}
+
+static double percentile(const double* sorted, int count, double p) {
+    if (count == 0) return 0.0;
+    int idx = (int)(count * p);
+    if (idx >= count) idx = count - 1;
+    return sorted[idx];
+}
+
+// Async completion for both Read and Write (the response header comes first in both)
+static void on_response(UA_Client* client, void* userdata, UA_UInt32 requestId, void* response) {
+    Slot* slot = (Slot*)userdata;
+    double t = now_us();
+    int ok = 0;
+
+    if (slot->is_write) {
+        UA_WriteResponse* wr = (UA_WriteResponse*)response;
+        ok = wr->responseHeader.serviceResult == UA_STATUSCODE_GOOD && wr->resultsSize == 1 &&
+             wr->results[0] == UA_STATUSCODE_GOOD;
+    } else {
+        UA_ReadResponse* rr = (UA_ReadResponse*)response;
+        ok = rr->responseHeader.serviceResult == UA_STATUSCODE_GOOD && rr->resultsSize > 0;
+        for (size_t i = 0; ok && i < rr->resultsSize; i++) {
+            if (rr->results[i].hasStatus && rr->results[i].status != UA_STATUSCODE_GOOD) ok = 0;
+        }
+    }
+
+    Samples* s = slot->is_write ? &write_samples : &read_samples;
+    if (ok) {
+        samples_add(s, (t - slot->intended_us) / 1000.0);
+        completed++;
+        last_completion_us = t;
+    } else {
+        s->errors++;
+    }
+    slot->used = 0;
+    slot->conn->inflight--;
+}
+
+// Pick the connection with the fewest outstanding requests below the limit
+static Connection* pick_connection(Connection* conns, int nconn, int max_inflight) {
+    Connection* best = NULL;
+    for (int i = 0; i < nconn; i++) {
+        if (conns[i].inflight < max_inflight && (!best || conns[i].inflight < best->inflight)) {
+            best = &conns[i];
+        }
+    }
+    return best;
+}
+
+// Write request on loopback_input, the value is a running counter
+static UA_WriteValue write_value;
+static UA_WriteRequest write_req;
+static UA_UInt16 write_counter;
+
+static void init_write_request(void) {
+    UA_WriteValue_init(&write_value);
+    write_value.nodeId = UA_NODEID_STRING(1, "loopback_input");
+    write_value.attributeId = UA_ATTRIBUTEID_VALUE;
+    write_value.value.hasValue = true;
+    UA_WriteRequest_init(&write_req);
+    write_req.nodesToWrite = &write_value;
+    write_req.nodesToWriteSize = 1;
+}
+
+// Dispatch one request on a connection with a free slot
+static void send_request(Connection* conn, int nslots, int is_write, double intended_us,
+                         UA_ReadRequest* read_req, UA_UInt32 timeout_ms) {
+    Slot* slot = NULL;
+    for (int i = 0; i < nslots; i++) {
+        if (!conn->slots[i].used) { slot = &conn->slots[i]; break; }
+    }
+    slot->used = 1;
+    slot->conn = conn;
+    slot->intended_us = intended_us;
+    slot->is_write = is_write;
+
+    UA_StatusCode status;
+    if (is_write) {
+        write_counter++;
+        UA_Variant_setScalar(&write_value.value.value, &write_counter, &UA_TYPES[UA_TYPES_UINT16]);
+        status = __UA_Client_AsyncServiceEx(conn->client, &write_req, &UA_TYPES[UA_TYPES_WRITEREQUEST],
+                                            on_response, &UA_TYPES[UA_TYPES_WRITERESPONSE],
+                                            slot, NULL, timeout_ms);
+    } else {
+        status = __UA_Client_AsyncServiceEx(conn->client, read_req, &UA_TYPES[UA_TYPES_READREQUEST],
+                                            on_response, &UA_TYPES[UA_TYPES_READRESPONSE],
+                                            slot, NULL, timeout_ms);
+    }
+    conn->inflight++;
+    if (status != UA_STATUSCODE_GOOD) {
+        // Not dispatched, the callback will not run
+        slot->used = 0;
+        conn->inflight--;
+        (is_write ? &write_samples : &read_samples)->errors++;
+    }
+}
+
+// Run one step at a constant rate
+static void run_step(Connection* conns, int nconn, int max_inflight, Workload wl, int write_pct,
+                     UA_ReadRequest* read_req, double rate, double duration_s, double limit_ms,
+                     UA_UInt32 timeout_ms, StepResult* res) {
+    int expected = (int)(rate * duration_s) + 16;
+    samples_reset(&read_samples, expected);
+    samples_reset(&write_samples, expected);
+    completed = 0;
+    last_completion_us = 0.0;
+
+    double interval_us = 1e6 / rate;
+    double t0 = now_us() + 10000.0;
+    double end = t0 + duration_s * 1e6;
+    double drain_end = end + timeout_ms * 1000.0 + 500000.0;
+    long k = 0;
+    long total = (long)(rate * duration_s);
+    unsigned seed = 12345;
+    double max_lag = 0.0;
+
+    res->errors = 0;
+    res->unsent = 0;
+
+    for (;;) {
+        double t = now_us();
+        int inflight = 0;
+        for (int c = 0; c < nconn; c++) inflight += conns[c].inflight;
+        if (k >= total && inflight == 0) break;
+        if (t > drain_end) break;
+
+        // Send everything that is due; a request waiting for a free slot keeps its time
+        while (k < total) {
+            double intended = t0 + k * interval_us;
+            if (intended > t) break;
+            Connection* conn = pick_connection(conns, nconn, max_inflight);
+            if (!conn) break;
+
+            int is_write = wl == WL_WRITE ||
+                           (wl == WL_MIXED && (int)(rand_r(&seed) % 100) < write_pct);
+            if (t - intended > max_lag) max_lag = t - intended;
+            send_request(conn, max_inflight, is_write, intended, read_req, timeout_ms);
+            k++;
+        }
+
+        // Process responses on every session without blocking
+        for (int c = 0; c < nconn; c++) UA_Client_run_iterate(conns[c].client, 0);
+
+        // Idle until the next request is due
+        double next = k < total ? t0 + k * interval_us : t + 200.0;
+        double wait = next - now_us();
+        if (wait > 50.0) usleep(wait > 200.0 ? 200 : (useconds_t)wait);
+    }
+
+    // Requests never sent are reported with the time they waited so far
+    double t_end = now_us();
+    for (; k < total; k++) {
+        double intended = t0 + k * interval_us;
+        samples_add(&read_samples, (t_end - intended) / 1000.0);
+        res->unsent++;
+    }
+    // Requests still outstanding after the drain count as errors
+    for (int c = 0; c < nconn; c++) res->errors += conns[c].inflight;
+
+    // Merge both kinds for the step percentiles
+    int n = read_samples.count + write_samples.count;
+    double* all = malloc((n ? n : 1) * sizeof(double));
+    memcpy(all, read_samples.samples, read_samples.count * sizeof(double));
+    memcpy(all + read_samples.count, write_samples.samples, write_samples.count * sizeof(double));
+    qsort(all, n, sizeof(double), cmp_double);
+
+    double span_s = ((last_completion_us > end ? last_completion_us : end) - t0) / 1e6;
+    res->target = rate;
+    res->scheduled = (int)total;
+    res->achieved = span_s > 0 ? completed / span_s : 0.0;
+    res->max_backlog_ms = max_lag / 1000.0;
+    res->errors += read_samples.errors + write_samples.errors + res->unsent;
+    res->p50 = percentile(all, n, 0.50);
+    res->p90 = percentile(all, n, 0.90);
+    res->p99 = percentile(all, n, 0.99);
+    res->p999 = percentile(all, n, 0.999);
+    res->max = n ? all[n - 1] : 0.0;
+    res->saturated = res->achieved < 0.95 * rate || res->errors > total / 100 || res->p99 > limit_ms;
+    free(all);
+}
+
+// Run one pipeline depth: every session keeps `depth` requests outstanding
+static void run_pipeline(Connection* conns, int nconn, int depth, Workload wl, int write_pct,
+                         UA_ReadRequest* read_req, double duration_s, UA_UInt32 timeout_ms,
+                         DepthResult* res) {
+    samples_reset(&read_samples, 65536);
+    samples_reset(&write_samples, 65536);
+    completed = 0;
+    last_completion_us = 0.0;
+    unsigned seed = 12345;
+
+    double t0 = now_us();
+    double end = t0 + duration_s * 1e6;
+    double drain_end = end + timeout_ms * 1000.0 + 500000.0;
+
+    for (;;) {
+        double t = now_us();
+        int inflight = 0;
+        for (int c = 0; c < nconn; c++) {
+            // Refill the pipeline; the latency is measured from the actual send
+            while (t < end && conns[c].inflight < depth) {
+                int is_write = wl == WL_WRITE ||
+                               (wl == WL_MIXED && (int)(rand_r(&seed) % 100) < write_pct);
+                send_request(&conns[c], depth, is_write, now_us(), read_req, timeout_ms);
+            }
+            inflight += conns[c].inflight;
+        }
+        if (t >= end && inflight == 0) break;
+        if (t > drain_end) break;
+        for (int c = 0; c < nconn; c++) UA_Client_run_iterate(conns[c].client, 0);
+    }
+
+    int n = read_samples.count + write_samples.count;
+    double* all = malloc((n ? n : 1) * sizeof(double));
+    memcpy(all, read_samples.samples, read_samples.count * sizeof(double));
+    memcpy(all + read_samples.count, write_samples.samples, write_samples.count * sizeof(double));
+    qsort(all, n, sizeof(double), cmp_double);
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += all[i];
+
+    double span_s = (last_completion_us - t0) / 1e6;
+    res->depth = depth;
+    res->throughput = span_s > 0 ? completed / span_s : 0.0;
+    res->mean = n ? sum / n : 0.0;
+    res->p50 = percentile(all, n, 0.50);
+    res->p99 = percentile(all, n, 0.99);
+    res->max = n ? all[n - 1] : 0.0;
+    res->errors = read_samples.errors + write_samples.errors;
+    for (int c = 0; c < nconn; c++) res->errors += conns[c].inflight;
+    free(all);
+}
+
+static void print_kind(const char* name, Samples* s) {
+    if (s->count == 0) return;
+    qsort(s->samples, s->count, sizeof(double), cmp_double);
+    printf("        %-6s n=%-7d p50 %8.3f  p99 %8.3f  max %8.3f ms  errors %d\n", name, s->count,
+           percentile(s->samples, s->count, 0.50), percentile(s->samples, s->count, 0.99),
+           s->samples[s->count - 1], s->errors);
+}
+
+// Row of a previous -o run whose first column (depth or target rate) equals key
+static int baseline_row(const char* path, double key, double* cols, int ncols) {
+    FILE* f = path ? fopen(path, "r") : NULL;
+    if (!f) return 0;
+    char line[256];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), f)) {
+        double v[16];
+        int n = 0;
+        char* p = line;
+        while (n < 16) {
+            char* end;
+            v[n] = strtod(p, &end);
+            if (end == p) break;
+            n++;
+            if (*end != ',') break;
+            p = end + 1;
+        }
+        if (n >= ncols && v[0] > key - 0.05 && v[0] < key + 0.05) {
+            memcpy(cols, v, ncols * sizeof(double));
+            found = 1;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+static double change_pct(double value, double base) {
+    return base > 0 ? (value / base - 1.0) * 100.0 : 0.0;
+}
+
+// ========== RECONNECT STORM ==========
+
+typedef enum { RC_RECREATE, RC_RESUME, RC_TRANSFER } ReconnectMode;
+
+// Reconnect parameters shared by all sessions
+typedef struct {
+    ReconnectMode mode;
+    const char* url;
+    const char* username;
+    const char* password;
+    int items;
+    UA_UInt32 timeout_ms;
+    UA_UInt32 session_timeout_ms;
+    double deadline_us;          // Give up waiting for data
+} ReconnectSetup;
+
+// One session that drops and comes back
+typedef struct {
+    const ReconnectSetup* setup;
+    UA_Client* client;
+    UA_UInt32 sub_id;
+    volatile int armed;          // Count data from now on
+    double first_data_us;        // First data notification after the drop
+    UA_UInt32 ack_seq;           // Last sequence number received by the manual Publish
+    UA_StatusCode status;
+    pthread_t thread;
+} Rejoiner;
+
+static pthread_barrier_t storm_barrier;
+static double storm_start_us;
+
+static void on_rejoin_data(UA_Client* client, UA_UInt32 subId, void* subContext, UA_UInt32 monId,
+                           void* monContext, UA_DataValue* value) {
+    Rejoiner* r = (Rejoiner*)monContext;
+    if (r->armed && r->first_data_us == 0.0) r->first_data_us = now_us();
+}
+
+static UA_Client* rejoin_client(const ReconnectSetup* setup) {
+    UA_Client* client = UA_Client_new();
+    UA_ClientConfig* cc = UA_Client_getConfig(client);
+    cc->timeout = setup->timeout_ms;
+    if (setup->session_timeout_ms) cc->requestedSessionTimeout = setup->session_timeout_ms;
+    return client;
+}
+
+static UA_StatusCode rejoin_connect(Rejoiner* r) {
+    const ReconnectSetup* setup = r->setup;
+    return (setup->username && setup->password)
+        ? UA_Client_connectUsername(r->client, setup->url, setup->username, setup->password)
+        : UA_Client_connect(r->client, setup->url);
+}
+
+// Subscription with one data change item per tag, 100 ms publishing and sampling
+static UA_StatusCode rejoin_subscribe(Rejoiner* r) {
+    UA_CreateSubscriptionRequest sreq = UA_CreateSubscriptionRequest_default();
+    sreq.requestedPublishingInterval = 100.0;
+    sreq.requestedLifetimeCount = 6000;
+    UA_CreateSubscriptionResponse sresp = UA_Client_Subscriptions_create(r->client, sreq, NULL, NULL, NULL);
+    if (sresp.responseHeader.serviceResult != UA_STATUSCODE_GOOD) return sresp.responseHeader.serviceResult;
+    r->sub_id = sresp.subscriptionId;
+
+    UA_MonitoredItemCreateRequest items[9];
+    UA_Client_DataChangeNotificationCallback callbacks[9];
+    UA_Client_DeleteMonitoredItemCallback deletes[9];
+    void* contexts[9];
+    for (int i = 0; i < r->setup->items; i++) {
+        items[i] = UA_MonitoredItemCreateRequest_default(UA_NODEID_STRING(1, (char*)tag_names[i]));
+        items[i].requestedParameters.samplingInterval = 100.0;
+        items[i].requestedParameters.queueSize = 4;
+        callbacks[i] = on_rejoin_data;
+        deletes[i] = NULL;
+        contexts[i] = r;
+    }
+    UA_CreateMonitoredItemsRequest mreq;
+    UA_CreateMonitoredItemsRequest_init(&mreq);
+    mreq.subscriptionId = r->sub_id;
+    mreq.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    mreq.itemsToCreate = items;
+    mreq.itemsToCreateSize = (size_t)r->setup->items;
+    UA_CreateMonitoredItemsResponse mresp =
+        UA_Client_MonitoredItems_createDataChanges(r->client, mreq, contexts, callbacks, deletes);
+    UA_StatusCode status = mresp.responseHeader.serviceResult;
+    for (size_t i = 0; status == UA_STATUSCODE_GOOD && i < mresp.resultsSize; i++) {
+        status = mresp.results[i].statusCode;
+    }
+    UA_CreateMonitoredItemsResponse_clear(&mresp);
+    return status;
+}
+
+// Publish by hand: a new client does not know the transferred subscription, and
+// a resumed client still counts the Publish requests lost with the old channel
+static void rejoin_publish_until_data(Rejoiner* r) {
+    while (r->first_data_us == 0.0 && now_us() < r->setup->deadline_us) {
+        UA_PublishRequest req;
+        UA_PublishRequest_init(&req);
+        UA_SubscriptionAcknowledgement ack = {r->sub_id, r->ack_seq};
+        if (r->ack_seq) {
+            req.subscriptionAcknowledgements = &ack;
+            req.subscriptionAcknowledgementsSize = 1;
+        }
+        UA_PublishResponse resp;
+        __UA_Client_Service(r->client, &req, &UA_TYPES[UA_TYPES_PUBLISHREQUEST], &resp,
+                            &UA_TYPES[UA_TYPES_PUBLISHRESPONSE]);
+        UA_StatusCode status = resp.responseHeader.serviceResult;
+        if (status == UA_STATUSCODE_GOOD && resp.subscriptionId == r->sub_id) {
+            r->ack_seq = resp.notificationMessage.sequenceNumber;
+            for (size_t i = 0; i < resp.notificationMessage.notificationDataSize; i++) {
+                if (resp.notificationMessage.notificationData[i].content.decoded.type ==
+                    &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION]) {
+                    r->first_data_us = now_us();
+                }
+            }
+        }
+        UA_PublishResponse_clear(&resp);
+        if (status != UA_STATUSCODE_GOOD) {
+            r->status = status;
+            return;
+        }
+    }
+}
+
+// Drop is done by the main thread; every thread comes back at the same moment
+static void* rejoin_thread(void* arg) {
+    Rejoiner* r = (Rejoiner*)arg;
+    const ReconnectSetup* setup = r->setup;
+    r->status = UA_STATUSCODE_GOOD;
+    pthread_barrier_wait(&storm_barrier);
+
+    if (setup->mode == RC_RESUME) {
+        // Same client: new SecureChannel, ActivateSession of the existing session
+        r->status = rejoin_connect(r);
+        if (r->status == UA_STATUSCODE_GOOD) rejoin_publish_until_data(r);
+        return NULL;
+    } else {
+        // The old client is gone; its session is never closed
+        UA_Client_delete(r->client);
+        r->client = rejoin_client(setup);
+        r->ack_seq = 0;
+        r->status = rejoin_connect(r);
+        if (r->status == UA_STATUSCODE_GOOD && setup->mode == RC_RECREATE) {
+            r->status = rejoin_subscribe(r);
+        } else if (r->status == UA_STATUSCODE_GOOD) {
+            UA_TransferSubscriptionsRequest treq;
+            UA_TransferSubscriptionsRequest_init(&treq);
+            treq.subscriptionIds = &r->sub_id;
+            treq.subscriptionIdsSize = 1;
+            treq.sendInitialValues = true;
+            UA_TransferSubscriptionsResponse tresp;
+            __UA_Client_Service(r->client, &treq, &UA_TYPES[UA_TYPES_TRANSFERSUBSCRIPTIONSREQUEST], &tresp,
+                                &UA_TYPES[UA_TYPES_TRANSFERSUBSCRIPTIONSRESPONSE]);
+            r->status = tresp.responseHeader.serviceResult;
+            if (r->status == UA_STATUSCODE_GOOD) {
+                r->status = tresp.resultsSize == 1 ? tresp.results[0].statusCode : UA_STATUSCODE_BADUNEXPECTEDERROR;
+            }
+            UA_TransferSubscriptionsResponse_clear(&tresp);
+            if (r->status == UA_STATUSCODE_GOOD) rejoin_publish_until_data(r);
+            return NULL;
+        }
+    }
+    while (r->status == UA_STATUSCODE_GOOD && r->first_data_us == 0.0 && now_us() < setup->deadline_us) {
+        UA_Client_run_iterate(r->client, 5);
+    }
+    return NULL;
+}
+
+// Result of one reconnect storm
+typedef struct {
+    int ok;
+    int failed;
+    double p50, p90, max;        // Drop to first data per session
+} StormResult;
+
+static void run_storm(Rejoiner* rj, int n, ReconnectSetup* setup, StormResult* res) {
+    for (int i = 0; i < n; i++) {
+        rj[i].armed = 0;
+        rj[i].first_data_us = 0.0;
+        UA_Client_disconnectSecureChannel(rj[i].client);
+    }
+    if (setup->mode == RC_TRANSFER) {
+        // The server checks session timeouts every 10 s
+        double wait_s = setup->session_timeout_ms / 1000.0 + 10.5;
+        printf("        waiting %.1f s for the sessions to time out\n", wait_s);
+        fflush(stdout);
+        usleep((useconds_t)(wait_s * 1e6));
+    }
+
+    pthread_barrier_init(&storm_barrier, NULL, (unsigned)n + 1);
+    for (int i = 0; i < n; i++) pthread_create(&rj[i].thread, NULL, rejoin_thread, &rj[i]);
+    storm_start_us = now_us();
+    setup->deadline_us = storm_start_us + setup->timeout_ms * 1000.0 + 2e6;
+    for (int i = 0; i < n; i++) rj[i].armed = 1;
+    pthread_barrier_wait(&storm_barrier);
+    for (int i = 0; i < n; i++) pthread_join(rj[i].thread, NULL);
+    pthread_barrier_destroy(&storm_barrier);
+
+    double samples[MAX_CONNECTIONS];
+    res->ok = res->failed = 0;
+    for (int i = 0; i < n; i++) {
+        if (rj[i].status == UA_STATUSCODE_GOOD && rj[i].first_data_us > 0.0) {
+            samples[res->ok++] = (rj[i].first_data_us - storm_start_us) / 1000.0;
+        } else {
+            res->failed++;
+            printf("        session %d: %s\n", i + 1,
+                   rj[i].status != UA_STATUSCODE_GOOD ? UA_StatusCode_name(rj[i].status) : "no data");
+        }
+    }
+    qsort(samples, res->ok, sizeof(double), cmp_double);
+    res->p50 = percentile(samples, res->ok, 0.50);
+    res->p90 = percentile(samples, res->ok, 0.90);
+    res->max = res->ok ? samples[res->ok - 1] : 0.0;
+}
+
+static int run_reconnect(ReconnectSetup* setup, int nconn, int rounds, const char* csv_file) {
+    static const char* mode_names[] = { "recreate", "resume", "transfer" };
+    Rejoiner rj[MAX_CONNECTIONS];
+    memset(rj, 0, sizeof(rj));
+
+    // Sessions with their subscriptions, each with data flowing
+    setup->deadline_us = now_us() + setup->timeout_ms * 1000.0 + 2e6;
+    for (int i = 0; i < nconn; i++) {
+        rj[i].setup = setup;
+        rj[i].client = rejoin_client(setup);
+        UA_StatusCode status = rejoin_connect(&rj[i]);
+        if (status == UA_STATUSCODE_GOOD) status = rejoin_subscribe(&rj[i]);
+        if (status != UA_STATUSCODE_GOOD) {
+            printf("Session %d: setup failed: %s\n", i + 1, UA_StatusCode_name(status));
+            for (int j = 0; j <= i; j++) UA_Client_delete(rj[j].client);
+            return 1;
+        }
+        rj[i].armed = 1;
+        while (rj[i].first_data_us == 0.0 && now_us() < setup->deadline_us) UA_Client_run_iterate(rj[i].client, 5);
+    }
+
+    FILE* csv = csv_file ? fopen(csv_file, "w") : NULL;
+    if (csv) fprintf(csv, "round,mode,sessions,items,ok,failed,p50_ms,p90_ms,max_ms\n");
+
+    printf("%6s %9s %6s %7s %9s %9s %9s\n", "round", "sessions", "ok", "failed", "p50 ms", "p90 ms", "max ms");
+    printf("---------------------------------------------------------------\n");
+    double sum_p50 = 0.0, worst = 0.0;
+    int total_failed = 0;
+    for (int round = 1; round <= rounds; round++) {
+        StormResult r;
+        run_storm(rj, nconn, setup, &r);
+        printf("%6d %9d %6d %7d %9.2f %9.2f %9.2f\n", round, nconn, r.ok, r.failed, r.p50, r.p90, r.max);
+        fflush(stdout);
+        if (csv) {
+            fprintf(csv, "%d,%s,%d,%d,%d,%d,%.3f,%.3f,%.3f\n", round, mode_names[setup->mode], nconn,
+                    setup->items, r.ok, r.failed, r.p50, r.p90, r.max);
+        }
+        sum_p50 += r.p50;
+        if (r.max > worst) worst = r.max;
+        total_failed += r.failed;
+        usleep(500000);
+    }
+    if (csv) fclose(csv);
+
+    printf("\n=== RECONNECT SUMMARY (%s) ===\n", mode_names[setup->mode]);
+    printf("Mean p50 drop to data:  %.2f ms\n", sum_p50 / rounds);
+    printf("Slowest session:        %.2f ms\n", worst);
+    printf("Failed reconnects:      %d of %d\n", total_failed, nconn * rounds);
+    printf("recreate: new session, CreateSubscription and %d MonitoredItems per client\n", setup->items);
+    printf("resume:   new SecureChannel, ActivateSession of the old session\n");
+    printf("transfer: new session after the old one timed out, TransferSubscriptions\n");
+
+    for (int i = 0; i < nconn; i++) {
+        UA_Client_disconnect(rj[i].client);
+        UA_Client_delete(rj[i].client);
+    }
+    return total_failed ? 1 : 0;
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA LOAD GENERATOR (open-loop rate sweep / pipeline depth)\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -r, --rates LIST       Fixed rates in requests/s, e.g. 100,200,500\n");
+    printf("  -s, --sweep A:B:F      Sweep from A to B req/s, multiplying by F (default: 50:20000:1.5)\n");
+    printf("                         The sweep stops after two saturated steps\n");
+    printf("  -d, --duration SEC     Duration of each step (default: 5)\n");
+    printf("  -w, --workload TYPE    read, write or mixed (default: read)\n");
+    printf("  -m, --mix PCT          Percentage of writes for mixed (default: 20)\n");
+    printf("  -k, --tags N           Tags per Read request, 1-9 (default: 1)\n");
+    printf("  -c, --connections N    Sessions to spread the load over (default: 1)\n");
+    printf("  -q, --inflight N       Outstanding requests per session (default: 64)\n");
+    printf("  -l, --limit MS         p99 limit for the knee (default: 50)\n");
+    printf("  -t, --timeout MS       Request timeout (default: 2000)\n");
+    printf("  -o, --csv FILE         Also write the curve as CSV\n");
+    printf("  -b, --baseline FILE    Compare every step with the CSV of a previous run\n");
+    printf("  -P, --pipeline LIST    Pipeline mode: outstanding requests per session,\n");
+    printf("                         e.g. 1,2,4,8,16,32,64 (closed-loop, -d s per depth)\n");
+    printf("  -R, --reconnect MODE   Reconnect storm: recreate, resume or transfer\n");
+    printf("                         (-c sessions with -k data change items each)\n");
+    printf("  -n, --rounds N         Reconnect storms (default: 5)\n");
+    printf("  -T, --session-timeout MS  Session timeout for transfer (default: 2000)\n");
+    printf("  -u, --user NAME        Username\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nWrites go to loopback_input only; relay outputs are never touched.\n");
+    printf("\nExamples:\n");
+    printf("  %s -u operator -p readonly123 opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -w mixed -m 30 -r 100,200,400 -u engineer -p readwrite456 opc.tcp://10.0.0.128:4840\n",
+           program_name);
+    printf("  %s -P 1,2,4,8,16,32,64 -k 9 -u operator -p readonly123 opc.tcp://10.0.0.128:4840\n",
+           program_name);
+    printf("  %s -P 1,8,32 -k 9 -d 10 -b base.csv -o iram.csv opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -R transfer -c 12 -k 9 -u operator -p readonly123 opc.tcp://10.0.0.128:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    // Default values
+    char* server_url = "opc.tcp://10.0.0.128:4840";
+    double rates[MAX_RATES];
+    int nrates = 0;
+    double sweep_from = 50.0, sweep_to = 20000.0, sweep_factor = 1.5;
+    double duration = 5.0;
+    Workload wl = WL_READ;
+    int write_pct = 20;
+    int ntags = 1;
+    int nconn = 1;
+    int max_inflight = 64;
+    double limit_ms = 50.0;
+    int timeout_ms = 2000;
+    const char* csv_file = NULL;
+    const char* baseline_file = NULL;
+    int depths[MAX_RATES];
+    int ndepths = 0;
+    const char* username = NULL;
+    const char* password = NULL;
+    int reconnect = -1;
+    int rounds = 5;
+    int session_timeout_ms = 2000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rates") == 0) && i + 1 < argc) {
+            char* list = argv[++i];
+            for (char* tok = strtok(list, ","); tok && nrates < MAX_RATES; tok = strtok(NULL, ",")) {
+                if (atof(tok) > 0) rates[nrates++] = atof(tok);
+            }
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sweep") == 0) && i + 1 < argc) {
+            if (sscanf(argv[++i], "%lf:%lf:%lf", &sweep_from, &sweep_to, &sweep_factor) != 3 ||
+                sweep_from <= 0 || sweep_factor <= 1.0) {
+                printf("Error: sweep must be FROM:TO:FACTOR with FACTOR > 1\n");
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--duration") == 0) && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workload") == 0) && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "read") == 0) wl = WL_READ;
+            else if (strcmp(argv[i], "write") == 0) wl = WL_WRITE;
+            else if (strcmp(argv[i], "mixed") == 0) wl = WL_MIXED;
+            else {
+                printf("Error: unknown workload %s\n", argv[i]);
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--mix") == 0) && i + 1 < argc) {
+            write_pct = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--tags") == 0) && i + 1 < argc) {
+            ntags = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--connections") == 0) && i + 1 < argc) {
+            nconn = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--inflight") == 0) && i + 1 < argc) {
+            max_inflight = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--limit") == 0) && i + 1 < argc) {
+            limit_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--baseline") == 0) && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--pipeline") == 0) && i + 1 < argc) {
+            char* list = argv[++i];
+            for (char* tok = strtok(list, ","); tok && ndepths < MAX_RATES; tok = strtok(NULL, ",")) {
+                if (atoi(tok) > 0) depths[ndepths++] = atoi(tok);
+            }
+        } else if ((strcmp(argv[i], "-R") == 0 || strcmp(argv[i], "--reconnect") == 0) && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "recreate") == 0) reconnect = RC_RECREATE;
+            else if (strcmp(argv[i], "resume") == 0) reconnect = RC_RESUME;
+            else if (strcmp(argv[i], "transfer") == 0) reconnect = RC_TRANSFER;
+            else {
+                printf("Error: unknown reconnect mode %s\n", argv[i]);
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--rounds") == 0) && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-T") == 0 || strcmp(argv[i], "--session-timeout") == 0) && i + 1 < argc) {
+            session_timeout_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (ntags < 1) ntags = 1;
+    if (ntags > 9) ntags = 9;
+    if (nconn < 1) nconn = 1;
+    if (nconn > MAX_CONNECTIONS) nconn = MAX_CONNECTIONS;
+    if (max_inflight < 1) max_inflight = 1;
+    if (write_pct < 0) write_pct = 0;
+    if (write_pct > 100) write_pct = 100;
+    if (duration < 0.5) duration = 0.5;
+    if (timeout_ms < 100) timeout_ms = 100;
+    if (rounds < 1) rounds = 1;
+    if (session_timeout_ms < 1000) session_timeout_ms = 1000;
+
+    if (reconnect >= 0) {
+        static const char* mode_names[] = { "recreate", "resume", "transfer" };
+        printf("=============================================\n");
+        printf("   RECONNECT STORM\n");
+        printf("   Server: %s\n", server_url);
+        printf("   Mode: %s, %d session(s) x %d item(s), %d round(s)\n", mode_names[reconnect], nconn, ntags,
+               rounds);
+        printf("=============================================\n\n");
+        ReconnectSetup setup = { (ReconnectMode)reconnect, server_url, username, password, ntags,
+                                 (UA_UInt32)timeout_ms,
+                                 reconnect == RC_TRANSFER ? (UA_UInt32)session_timeout_ms : 0, 0.0 };
+        int failed = run_reconnect(&setup, nconn, rounds, csv_file);
+        printf("\n=== TEST COMPLETED ===\n");
+        return failed;
+    }
+    int sweep = nrates == 0;
+    if (sweep) {
+        for (double r = sweep_from; r <= sweep_to * 1.0001 && nrates < MAX_RATES; r *= sweep_factor) {
+            rates[nrates++] = r;
+        }
+    }
+
+    // Every session needs a slot per outstanding request
+    int nslots = max_inflight;
+    for (int d = 0; d < ndepths; d++) {
+        if (depths[d] > nslots) nslots = depths[d];
+    }
+
+    const char* wl_names[] = { "read", "write", "mixed" };
+    printf("=============================================\n");
+    printf(ndepths ? "   PIPELINED LOAD TEST\n" : "   OPEN-LOOP LOAD GENERATOR\n");
+    printf("   Server: %s\n", server_url);
+    printf("   Workload: %s", wl_names[wl]);
+    if (wl != WL_WRITE) printf(", Read of %d tag(s)", ntags);
+    if (wl == WL_MIXED) printf(", %d%% writes", write_pct);
+    if (ndepths) printf("\n   Sessions: %d, %.1f s per depth\n", nconn, duration);
+    else printf("\n   Sessions: %d x %d outstanding, %.1f s per step\n", nconn, max_inflight, duration);
+    printf("=============================================\n\n");
+
+    // ========== SESSIONS ==========
+    Connection conns[MAX_CONNECTIONS];
+    memset(conns, 0, sizeof(conns));
+    for (int c = 0; c < nconn; c++) {
+        conns[c].client = UA_Client_new();
+        UA_Client_getConfig(conns[c].client)->timeout = timeout_ms;
+        UA_StatusCode status = (username && password)
+            ? UA_Client_connectUsername(conns[c].client, server_url, username, password)
+            : UA_Client_connect(conns[c].client, server_url);
+        if (status != UA_STATUSCODE_GOOD) {
+            printf("Session %d: connection failed: %s\n", c + 1, UA_StatusCode_name(status));
+            for (int j = 0; j <= c; j++) UA_Client_delete(conns[j].client);
+            return 1;
+        }
+        conns[c].slots = calloc(nslots, sizeof(Slot));
+    }
+
+    UA_ReadValueId ids[9];
+    for (int i = 0; i < ntags; i++) {
+        UA_ReadValueId_init(&ids[i]);
+        ids[i].nodeId = UA_NODEID_STRING(1, (char*)tag_names[i]);
+        ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    UA_ReadRequest read_req;
+    UA_ReadRequest_init(&read_req);
+    read_req.nodesToRead = ids;
+    read_req.nodesToReadSize = ntags;
+    read_req.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    init_write_request();
+
+    // ========== PIPELINE DEPTHS ==========
+    if (ndepths > 0) {
+        // Encoded request plus the symmetric message headers (SecurityPolicy None)
+        size_t req_bytes = UA_calcSizeBinary(wl == WL_WRITE ? (const void*)&write_req : (const void*)&read_req,
+                                             wl == WL_WRITE ? &UA_TYPES[UA_TYPES_WRITEREQUEST]
+                                                            : &UA_TYPES[UA_TYPES_READREQUEST]) + 28;
+        FILE* csv = csv_file ? fopen(csv_file, "w") : NULL;
+        if (csv) fprintf(csv, "depth,throughput,mean_ms,p50_ms,p99_ms,max_ms,errors\n");
+
+        printf("%6s %11s %7s %9s %9s %9s %9s %9s %12s %7s\n", "depth", "req/s", "gain",
+               "mean ms", "little ms", "p50 ms", "p99 ms", "max ms", "bytes in fl.", "errors");
+        printf("-------------------------------------------------------------------------------------------------\n");
+        double base = 0.0, best = 0.0;
+        int best_depth = 0;
+        for (int d = 0; d < ndepths; d++) {
+            DepthResult r;
+            run_pipeline(conns, nconn, depths[d], wl, write_pct, &read_req, duration,
+                         (UA_UInt32)timeout_ms, &r);
+            if (d == 0) base = r.throughput;
+            if (r.throughput > best * 1.05) {
+                best = r.throughput;
+                best_depth = r.depth;
+            }
+            // Little's law: the mean latency the throughput alone would explain
+            double little = r.throughput > 0 ? 1000.0 * r.depth * nconn / r.throughput : 0.0;
+            printf("%6d %11.1f %6.2fx %9.3f %9.3f %9.3f %9.3f %9.3f %12zu %7d\n", r.depth, r.throughput,
+                   base > 0 ? r.throughput / base : 0.0, r.mean, little, r.p50, r.p99, r.max,
+                   req_bytes * r.depth, r.errors);
+            if (wl == WL_MIXED) {
+                print_kind("read", &read_samples);
+                print_kind("write", &write_samples);
+            }
+            double b[5];
+            if (baseline_row(baseline_file, r.depth, b, 5)) {
+                printf("        vs base  req/s %+.1f%%  mean %+.1f%%  p50 %+.1f%%  p99 %+.1f%%\n",
+                       change_pct(r.throughput, b[1]), change_pct(r.mean, b[2]), change_pct(r.p50, b[3]),
+                       change_pct(r.p99, b[4]));
+            }
+            fflush(stdout);
+            if (csv) {
+                fprintf(csv, "%d,%.1f,%.3f,%.3f,%.3f,%.3f,%d\n", r.depth, r.throughput, r.mean,
+                        r.p50, r.p99, r.max, r.errors);
+            }
+            usleep(500000);
+        }
+        if (csv) fclose(csv);
+
+        printf("\n=== PIPELINE SUMMARY ===\n");
+        printf("Request size:           ~%zu bytes on the wire\n", req_bytes);
+        printf("Best throughput:        %.1f req/s from depth %d (%.2fx depth %d)\n", best, best_depth,
+               base > 0 ? best / base : 0.0, depths[0]);
+        printf("Beyond that depth the gateway processes requests one after another: throughput\n");
+        printf("stays flat and latency grows with depth (requests wait in the server loop or\n");
+        printf("in the TCP buffers). A mean far above 'little ms' points to stalls.\n");
+    } else {
+        // ========== RATE STEPS ==========
+        FILE* csv = csv_file ? fopen(csv_file, "w") : NULL;
+        if (csv) fprintf(csv, "target,achieved,scheduled,errors,unsent,p50_ms,p90_ms,p99_ms,p999_ms,max_ms,lag_ms\n");
+
+        printf("%9s %9s %7s %9s %9s %9s %9s %9s %9s  %s\n", "target/s", "done/s", "errors",
+               "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms", "lag ms", "");
+        printf("------------------------------------------------------------------------------------------------\n");
+
+        StepResult results[MAX_RATES];
+        int nresults = 0, saturated_in_row = 0, seen_saturated = 0;
+        double knee = 0.0;
+        for (int s = 0; s < nrates; s++) {
+            StepResult* r = &results[nresults++];
+            run_step(conns, nconn, max_inflight, wl, write_pct, &read_req, rates[s], duration,
+                     limit_ms, (UA_UInt32)timeout_ms, r);
+            printf("%9.0f %9.1f %7d %9.3f %9.3f %9.3f %9.3f %9.3f %9.1f  %s\n", r->target, r->achieved,
+                   r->errors, r->p50, r->p90, r->p99, r->p999, r->max, r->max_backlog_ms,
+                   r->saturated ? "SATURATED" : "ok");
+            if (wl == WL_MIXED) {
+                print_kind("read", &read_samples);
+                print_kind("write", &write_samples);
+            }
+            double b[8];
+            if (baseline_row(baseline_file, r->target, b, 8)) {
+                printf("        vs base  done/s %+.1f%%  p50 %+.1f%%  p90 %+.1f%%  p99 %+.1f%%\n",
+                       change_pct(r->achieved, b[1]), change_pct(r->p50, b[5]), change_pct(r->p90, b[6]),
+                       change_pct(r->p99, b[7]));
+            }
+            fflush(stdout);
+            if (csv) {
+                fprintf(csv, "%.1f,%.1f,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f\n", r->target, r->achieved,
+                        r->scheduled, r->errors, r->unsent, r->p50, r->p90, r->p99, r->p999, r->max,
+                        r->max_backlog_ms);
+            }
+            if (!r->saturated && !seen_saturated) knee = r->target;
+            seen_saturated |= r->saturated;
+            saturated_in_row = r->saturated ? saturated_in_row + 1 : 0;
+            if (sweep && saturated_in_row >= 2) break;
+
+            // Let the gateway drain before the next step
+            for (int c = 0; c < nconn; c++) UA_Client_run_iterate(conns[c].client, 0);
+            usleep(500000);
+        }
+        if (csv) fclose(csv);
+
+        // ========== SUMMARY ==========
+        printf("\n=== SATURATION ===\n");
+        if (knee > 0) {
+            printf("Highest sustained rate: %.0f req/s (p99 <= %.0f ms, < 1%% errors)\n", knee, limit_ms);
+        } else {
+            printf("Saturated already at the lowest rate (%.0f req/s)\n", rates[0]);
+        }
+        printf("Latency is measured from the scheduled send time (no coordinated omission).\n");
+        printf("'lag ms' is how far the generator fell behind its schedule; large values\n");
+        printf("mean every session had %d requests outstanding.\n", max_inflight);
+    }
+
+    for (int c = 0; c < nconn; c++) {
+        UA_Client_disconnect(conns[c].client);
+        UA_Client_delete(conns[c].client);
+        free(conns[c].slots);
+    }
+    free(read_samples.samples);
+    free(write_samples.samples);
+    printf("\n=== TEST COMPLETED ===\n");
+    return 0;
+}
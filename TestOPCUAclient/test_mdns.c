@@ -0,0 +1,261 @@
+#include <open62541/client.h>
+#include <open62541/client_config_default.h>
+#include <open62541/client_highlevel.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Multicast discovery responsiveness of the gateway (opcua_mdns_enable).
+// Sends DNS-SD queries for the OPC UA service as legacy unicast mDNS
+// queries (from an ephemeral port straight to port 5353 of the gateway, so
+// the answer comes back to this socket) at a fixed rate and measures the
+// time to each answer. The gateway's mDNS socket shares the select() of
+// the OPC UA server, so an answer should take about one network round trip
+// whatever the server is doing; a polled socket answers only on the next
+// pass of the server loop. With -f the tool also asks the gateway for its
+// FindServersOnNetwork list.
+
+#define MDNS_PORT       5353
+#define QTYPE_PTR       12
+#define QCLASS_IN       1
+#define MAX_PACKET      1500
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int count, double p) {
+    if (count == 0) return 0.0;
+    int idx = (int)(count * p);
+    if (idx >= count) idx = count - 1;
+    return sorted[idx];
+}
+
+// DNS query for one PTR name; returns the packet length
+static int build_query(unsigned char* buf, size_t size, unsigned short id, const char* name) {
+    size_t len = 12;
+    memset(buf, 0, 12);
+    buf[0] = (unsigned char)(id >> 8);
+    buf[1] = (unsigned char)id;
+    buf[5] = 1;  // qdcount
+    const char* label = name;
+    while (*label) {
+        const char* dot = strchr(label, '.');
+        size_t n = dot ? (size_t)(dot - label) : strlen(label);
+        if (n == 0 || n > 63 || len + n + 1 + 5 > size) return -1;
+        buf[len++] = (unsigned char)n;
+        memcpy(buf + len, label, n);
+        len += n;
+        label += n;
+        if (*label == '.') label++;
+    }
+    buf[len++] = 0;
+    buf[len++] = 0;
+    buf[len++] = QTYPE_PTR;
+    buf[len++] = 0;
+    buf[len++] = QCLASS_IN;
+    return (int)len;
+}
+
+static void find_servers(const char* url) {
+    UA_Client* client = UA_Client_new();
+    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    size_t count = 0;
+    UA_ServerOnNetwork* servers = NULL;
+    UA_StatusCode status = UA_Client_findServersOnNetwork(client, url, 0, 0, 0, NULL, &count, &servers);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("FindServersOnNetwork on %s failed: %s\n", url, UA_StatusCode_name(status));
+    } else {
+        printf("FindServersOnNetwork on %s: %zu server(s)\n", url, count);
+        for (size_t i = 0; i < count; i++) {
+            printf("  %u  %.*s  %.*s\n", servers[i].recordId, (int)servers[i].serverName.length,
+                   servers[i].serverName.data, (int)servers[i].discoveryUrl.length, servers[i].discoveryUrl.data);
+        }
+    }
+    UA_Array_delete(servers, count, &UA_TYPES[UA_TYPES_SERVERONNETWORK]);
+    UA_Client_delete(client);
+}
+
+static void print_help(const char* program_name) {
+    printf("OPC UA MULTICAST DISCOVERY RESPONSE TEST\n");
+    printf("========================================\n");
+    printf("Usage: %s [OPTIONS] [GATEWAY_IP]\n\n", program_name);
+    printf("GATEWAY_IP defaults to 10.0.0.128.\n\n");
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -n, --count N          Number of queries (default: 100)\n");
+    printf("  -i, --interval MS      Time between queries (default: 100)\n");
+    printf("  -q, --query NAME       PTR name to ask for (default: _opcua-tcp._tcp.local)\n");
+    printf("  -P, --port N           mDNS port of the gateway (default: 5353)\n");
+    printf("  -t, --timeout MS       Answer timeout (default: 1000)\n");
+    printf("  -l, --limit MS         Fail when p99 exceeds this (default: 10)\n");
+    printf("  -f, --find URL         Also call FindServersOnNetwork on this server\n");
+    printf("  -o, --csv FILE         Also append the results as CSV\n");
+    printf("\nExamples:\n");
+    printf("  %s 10.0.0.128\n", program_name);
+    printf("  %s -n 500 -i 20 -f opc.tcp://10.0.0.128:4840 -o mdns.csv 10.0.0.128\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* host = "10.0.0.128";
+    const char* query = "_opcua-tcp._tcp.local";
+    const char* find_url = NULL;
+    const char* csv_file = NULL;
+    int count = 100;
+    int interval_ms = 100;
+    int port = MDNS_PORT;
+    int timeout_ms = 1000;
+    double limit_ms = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--count") == 0) && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interval") == 0) && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--query") == 0) && i + 1 < argc) {
+            query = argv[++i];
+        } else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--port") == 0) && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--limit") == 0) && i + 1 < argc) {
+            limit_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--find") == 0) && i + 1 < argc) {
+            find_url = argv[++i];
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else {
+            host = argv[i];
+        }
+    }
+    if (count < 1) count = 1;
+
+    struct sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, host, &to.sin_addr) != 1) {
+        printf("Invalid gateway address: %s\n", host);
+        return 1;
+    }
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        return 1;
+    }
+
+    double* samples = (double*)malloc(sizeof(double) * count);
+    int answered = 0, lost = 0, empty = 0;
+    unsigned char packet[MAX_PACKET];
+    printf("Querying %s:%d for %s, %d queries every %d ms\n", host, port, query, count, interval_ms);
+
+    for (int q = 0; q < count; q++) {
+        unsigned short id = (unsigned short)(0x4000 + q);
+        int len = build_query(packet, sizeof(packet), id, query);
+        if (len < 0) {
+            printf("Invalid query name: %s\n", query);
+            close(sock);
+            free(samples);
+            return 1;
+        }
+        double sent = now_us();
+        if (sendto(sock, packet, (size_t)len, 0, (struct sockaddr*)&to, sizeof(to)) != len) {
+            perror("sendto");
+            break;
+        }
+
+        int got = 0;
+        double deadline = sent + timeout_ms * 1000.0;
+        while (!got) {
+            double left = deadline - now_us();
+            if (left <= 0) break;
+            fd_set fds;
+            FD_ZERO(&fds);
+            FD_SET(sock, &fds);
+            struct timeval tv = {(time_t)(left / 1e6), (suseconds_t)((long)left % 1000000)};
+            if (select(sock + 1, &fds, NULL, NULL, &tv) <= 0) continue;
+            unsigned char reply[MAX_PACKET];
+            ssize_t n = recv(sock, reply, sizeof(reply), 0);
+            double received = now_us();
+            // Late answers to earlier queries are skipped
+            if (n < 12 || reply[0] != (id >> 8) || reply[1] != (id & 0xff) || !(reply[2] & 0x80)) continue;
+            got = 1;
+            samples[answered++] = (received - sent) / 1000.0;
+            if (reply[6] == 0 && reply[7] == 0) empty++;
+        }
+        if (!got) lost++;
+
+        double next = sent + interval_ms * 1000.0;
+        double wait = next - now_us();
+        if (wait > 0) usleep((useconds_t)wait);
+    }
+    close(sock);
+
+    qsort(samples, answered, sizeof(double), cmp_double);
+    double p50 = percentile(samples, answered, 0.50);
+    double p90 = percentile(samples, answered, 0.90);
+    double p99 = percentile(samples, answered, 0.99);
+    double min = answered ? samples[0] : 0.0;
+    double max = answered ? samples[answered - 1] : 0.0;
+
+    printf("\n%-10s %8s %8s %8s %8s %8s %8s %8s\n", "queries", "answered", "lost", "min ms", "p50 ms",
+           "p90 ms", "p99 ms", "max ms");
+    printf("%-10d %8d %8d %8.2f %8.2f %8.2f %8.2f %8.2f\n", count, answered, lost, min, p50, p90, p99, max);
+    if (empty) printf("%d answer(s) without records: is the service announced?\n", empty);
+
+    int failed = 0;
+    if (answered == 0) {
+        printf("FAIL: no answers (is multicast discovery enabled on the gateway?)\n");
+        failed = 1;
+    } else if (p99 > limit_ms) {
+        printf("FAIL: p99 %.2f ms above the limit of %.2f ms\n", p99, limit_ms);
+        failed = 1;
+    }
+    if (lost > count / 100) {
+        printf("FAIL: %d of %d queries unanswered\n", lost, count);
+        failed = 1;
+    }
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+
+    if (find_url) {
+        printf("\n");
+        find_servers(find_url);
+    }
+
+    if (csv_file) {
+        FILE* check = fopen(csv_file, "r");
+        int header = check == NULL;
+        if (check) fclose(check);
+        FILE* csv = fopen(csv_file, "a");
+        if (csv) {
+            if (header) {
+                fprintf(csv, "gateway,query,count,interval_ms,answered,lost,min_ms,p50_ms,p90_ms,p99_ms,max_ms,"
+                             "result\n");
+            }
+            fprintf(csv, "%s,%s,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%s\n", host, query, count, interval_ms,
+                    answered, lost, min, p50, p90, p99, max, failed ? "FAILED" : "PASSED");
+            fclose(csv);
+        }
+    }
+    free(samples);
+    return failed;
+}
@@ -0,0 +1,380 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "a16_mirror.h"
+
+// Process image mirror benchmark.
+// Compares tag access through the client mirror library (client/a16_mirror.c)
+// with direct OPC UA Reads on a session:
+//   1. Direct Read of one tag
+//   2. Direct Read of all 9 tags (one request)
+//   3. Mirror read of one tag
+//   4. Mirror snapshot of all 9 tags
+//   5. Mirror reads from several threads in parallel (throughput)
+//   6. Write loopback_input through the mirror until loopback_output is seen
+//   7. Burst of writes coalesced into WriteRequests
+// Only loopback_input is written; the relay outputs are not touched.
+
+// Latency statistics for one test mode (microseconds)
+typedef struct {
+    const char* name;
+    double* samples;
+    int count;
+    int errors;
+} BenchResult;
+
+// Parallel reader thread state
+typedef struct {
+    a16_mirror_t* mirror;
+    atomic_int* stop;
+    unsigned long reads;
+} ReaderArgs;
+
+// Monotonic time in microseconds
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_result(BenchResult* r) {
+    if (r->count == 0) {
+        printf("%-30s no successful samples (%d errors)\n", r->name, r->errors);
+        return;
+    }
+    qsort(r->samples, r->count, sizeof(double), cmp_double);
+    double sum = 0.0;
+    for (int i = 0; i < r->count; i++) sum += r->samples[i];
+    printf("%-30s %10.3f %10.3f %10.3f %10.3f %12.0f %6d\n",
+           r->name, sum / r->count, r->samples[r->count / 2],
+           r->samples[(int)(r->count * 0.95)], r->samples[r->count - 1],
+           1e6 * r->count / sum, r->errors);
+}
+
+// Build a ReadRequest for the first n mirror tags
+static void build_read_request(UA_ReadRequest* req, UA_ReadValueId* ids, int n) {
+    for (int i = 0; i < n; i++) {
+        UA_ReadValueId_init(&ids[i]);
+        ids[i].nodeId = UA_NODEID_STRING(1, (char*)a16_tag_name((a16_tag_t)i));
+        ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    UA_ReadRequest_init(req);
+    req->nodesToRead = ids;
+    req->nodesToReadSize = n;
+    req->timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+}
+
+// Run one direct read mode
+static void bench_direct(UA_Client* client, BenchResult* r, int tags, int count) {
+    UA_ReadRequest req;
+    UA_ReadValueId ids[A16_TAG_COUNT];
+    build_read_request(&req, ids, tags);
+    for (int i = 0; i < count; i++) {
+        double t0 = now_us();
+        UA_ReadResponse resp = UA_Client_Service_read(client, req);
+        double dt = now_us() - t0;
+        int ok = resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD &&
+                 resp.resultsSize == (size_t)tags;
+        UA_ReadResponse_clear(&resp);
+        if (!ok) {
+            r->errors++;
+            continue;
+        }
+        r->samples[r->count++] = dt;
+    }
+}
+
+// Spin on mirror reads until stopped
+static void* reader_thread(void* arg) {
+    ReaderArgs* a = (ReaderArgs*)arg;
+    uint16_t v;
+    while (!atomic_load_explicit(a->stop, memory_order_relaxed)) {
+        for (int i = 0; i < 1000; i++) {
+            a16_mirror_get(a->mirror, (a16_tag_t)(i % A16_TAG_COUNT), &v);
+        }
+        a->reads += 1000;
+    }
+    return NULL;
+}
+
+// Change callback: count notifications
+static atomic_uint change_events;
+static void on_change(const a16_image_t* image, uint32_t changed, void* context) {
+    (void)image;
+    (void)context;
+    if (changed) atomic_fetch_add(&change_events, 1);
+}
+
+static void print_stats(a16_mirror_t* mirror) {
+    a16_mirror_stats_t s;
+    a16_mirror_get_stats(mirror, &s);
+    printf("Connects: %u (failed %u)  Transfers: %u (refused %u)  Subscribes: %u\n",
+           s.connects, s.connect_failures, s.transfers, s.transfer_failures, s.subscribes);
+    printf("Updates: %u  Keep-alives: %u  Publish errors: %u  Change callbacks: %u\n",
+           s.updates, s.keepalives, s.publish_errors, atomic_load(&change_events));
+    printf("Writes: %u -> %u values in %u WriteRequests, %u errors\n",
+           s.writes, s.write_nodes, s.write_requests, s.write_errors);
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("PROCESS IMAGE MIRROR BENCHMARK (mirror vs direct Read)\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help           Show this help message\n");
+    printf("  -n, --count N        Direct reads per mode (default: 500)\n");
+    printf("  -m, --mirror N       Mirror reads per mode (default: 1000000)\n");
+    printf("  -t, --threads N      Parallel mirror reader threads (default: 4)\n");
+    printf("  -i, --interval MS    Publishing interval (default: 100)\n");
+    printf("  -b, --burst N        Writes per coalescing burst (default: 100)\n");
+    printf("  -w, --watch SEC      Only run the mirror and print state every second\n");
+    printf("                       (disconnect the gateway to observe reconnects)\n");
+    printf("  -u, --user NAME      Username\n");
+    printf("  -p, --pass PASSWORD  Password\n");
+    printf("\nExample:\n");
+    printf("  %s -u engineer -p readwrite456 opc.tcp://10.0.0.128:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    // Default values
+    char* server_url = "opc.tcp://10.0.0.128:4840";
+    int count = 500;
+    int mirror_count = 1000000;
+    int threads = 4;
+    double interval = 100.0;
+    int burst = 100;
+    int watch = 0;
+    const char* username = NULL;
+    const char* password = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--count") == 0) && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--mirror") == 0) && i + 1 < argc) {
+            mirror_count = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interval") == 0) && i + 1 < argc) {
+            interval = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--burst") == 0) && i + 1 < argc) {
+            burst = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--watch") == 0) && i + 1 < argc) {
+            watch = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (count < 1) count = 1;
+    if (mirror_count < 1) mirror_count = 1;
+    if (threads < 1) threads = 1;
+    if (burst < 1) burst = 1;
+
+    printf("=============================================\n");
+    printf("   PROCESS IMAGE MIRROR BENCHMARK\n");
+    printf("   Server: %s\n", server_url);
+    printf("   Publishing interval: %.0f ms\n", interval);
+    printf("=============================================\n\n");
+
+    a16_mirror_config_t config = {
+        .url = server_url,
+        .username = username,
+        .password = password,
+        .publishing_interval_ms = interval,
+        .on_change = on_change,
+    };
+    a16_mirror_t* mirror = a16_mirror_start(&config);
+    if (!mirror) {
+        printf("Mirror start failed\n");
+        return 1;
+    }
+    double t_start = now_us();
+    if (!a16_mirror_wait_ready(mirror, 10000)) {
+        printf("Mirror not ready after 10 s\n");
+        print_stats(mirror);
+        a16_mirror_stop(mirror);
+        return 1;
+    }
+    printf("Mirror ready after %.1f ms\n\n", (now_us() - t_start) / 1000.0);
+
+    // ========== WATCH MODE ==========
+    if (watch > 0) {
+        for (int s = 0; s < watch; s++) {
+            sleep(1);
+            a16_image_t img;
+            a16_mirror_snapshot(mirror, &img);
+            printf("[%3d s] %-12s updates %6u  valid 0x%03X  counter %5u  DI 0x%04X  DO 0x%04X\n",
+                   s + 1, img.connected ? "connected" : "DISCONNECTED", img.updates, img.valid_mask,
+                   img.value[A16_TAG_DIAGNOSTIC_COUNTER], img.value[A16_TAG_DISCRETE_INPUTS],
+                   img.value[A16_TAG_DISCRETE_OUTPUTS]);
+        }
+        printf("\n");
+        print_stats(mirror);
+        a16_mirror_stop(mirror);
+        printf("\n=== TEST COMPLETED ===\n");
+        return 0;
+    }
+
+    BenchResult results[4] = {
+        { "Direct Read (1 tag)", calloc(count, sizeof(double)), 0, 0 },
+        { "Direct Read (9 tags)", calloc(count, sizeof(double)), 0, 0 },
+        { "Mirror get (1 tag)", calloc(mirror_count, sizeof(double)), 0, 0 },
+        { "Mirror snapshot (9 tags)", calloc(mirror_count, sizeof(double)), 0, 0 },
+    };
+
+    // ========== 1-2. DIRECT READS ==========
+    UA_Client* client = UA_Client_new();
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, server_url, username, password)
+        : UA_Client_connect(client, server_url);
+    if (status == UA_STATUSCODE_GOOD) {
+        bench_direct(client, &results[0], 1, count);
+        bench_direct(client, &results[1], A16_TAG_COUNT, count);
+        UA_Client_disconnect(client);
+    } else {
+        printf("Direct connection failed: %s\n", UA_StatusCode_name(status));
+        results[0].errors = results[1].errors = count;
+    }
+    UA_Client_delete(client);
+
+    // ========== 3-4. MIRROR READS ==========
+    uint16_t v;
+    for (int i = 0; i < mirror_count; i++) {
+        double t0 = now_us();
+        int ok = a16_mirror_get(mirror, A16_TAG_LOOPBACK_OUTPUT, &v);
+        double dt = now_us() - t0;
+        if (!ok) {
+            results[2].errors++;
+            continue;
+        }
+        results[2].samples[results[2].count++] = dt;
+    }
+    a16_image_t img;
+    for (int i = 0; i < mirror_count; i++) {
+        double t0 = now_us();
+        a16_mirror_snapshot(mirror, &img);
+        results[3].samples[results[3].count++] = now_us() - t0;
+    }
+
+    printf("%-30s %10s %10s %10s %10s %12s %6s\n", "Mode", "avg us", "p50 us", "p95 us",
+           "max us", "ops/s", "errors");
+    for (int i = 0; i < 4; i++) {
+        print_result(&results[i]);
+        free(results[i].samples);
+    }
+    printf("(mirror timings include ~2 clock reads per sample)\n");
+
+    // ========== 5. PARALLEL MIRROR READERS ==========
+    atomic_int stop = 0;
+    pthread_t* tids = calloc(threads, sizeof(pthread_t));
+    ReaderArgs* args = calloc(threads, sizeof(ReaderArgs));
+    uint32_t updates_before = (a16_mirror_snapshot(mirror, &img), img.updates);
+    double t0 = now_us();
+    for (int i = 0; i < threads; i++) {
+        args[i].mirror = mirror;
+        args[i].stop = &stop;
+        pthread_create(&tids[i], NULL, reader_thread, &args[i]);
+    }
+    sleep(2);
+    atomic_store(&stop, 1);
+    unsigned long total_reads = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+        total_reads += args[i].reads;
+    }
+    double elapsed = (now_us() - t0) / 1e6;
+    a16_mirror_snapshot(mirror, &img);
+    printf("\n%d reader threads: %.1f M reads/s (%u mirror updates applied meanwhile)\n",
+           threads, total_reads / elapsed / 1e6, img.updates - updates_before);
+    free(tids);
+    free(args);
+
+    // ========== 6. WRITE -> MIRROR ROUND TRIP ==========
+    BenchResult rt = { "Write -> mirror (ms)", calloc(20, sizeof(double)), 0, 0 };
+    uint16_t base = (uint16_t)(now_us());
+    for (int i = 0; i < 20; i++) {
+        uint16_t target = (uint16_t)(base + i + 1);
+        double w0 = now_us();
+        a16_mirror_write(mirror, A16_TAG_LOOPBACK_INPUT, target);
+        int seen = 0;
+        while (now_us() - w0 < 5e6) {
+            if (a16_mirror_get(mirror, A16_TAG_LOOPBACK_OUTPUT, &v) && v == target) {
+                seen = 1;
+                break;
+            }
+            usleep(100);
+        }
+        if (seen) rt.samples[rt.count++] = (now_us() - w0) / 1000.0;
+        else rt.errors++;
+    }
+    printf("\n%-30s %10s %10s %10s %10s\n", "Round trip", "avg ms", "p50 ms", "p95 ms", "max ms");
+    if (rt.count) {
+        qsort(rt.samples, rt.count, sizeof(double), cmp_double);
+        double sum = 0.0;
+        for (int i = 0; i < rt.count; i++) sum += rt.samples[i];
+        printf("%-30s %10.2f %10.2f %10.2f %10.2f  (%d lost)\n", rt.name, sum / rt.count,
+               rt.samples[rt.count / 2], rt.samples[(int)(rt.count * 0.95)],
+               rt.samples[rt.count - 1], rt.errors);
+    } else {
+        printf("%-30s no value came back (%d lost)\n", rt.name, rt.errors);
+    }
+    free(rt.samples);
+
+    // ========== 7. WRITE COALESCING ==========
+    a16_mirror_stats_t before, after;
+    a16_mirror_get_stats(mirror, &before);
+    uint16_t expected = 0;
+    a16_mirror_write(mirror, A16_TAG_LOOPBACK_INPUT, 0);
+    for (int i = 0; i < burst; i++) {
+        uint16_t bit = (uint16_t)(1u << (i % 16));
+        uint16_t bits = (i / 16) % 2 ? 0 : bit;
+        a16_mirror_write_bits(mirror, A16_TAG_LOOPBACK_INPUT, bit, bits);
+        expected = (uint16_t)((expected & ~bit) | bits);
+    }
+    double f0 = now_us();
+    int frc = a16_mirror_flush(mirror, 5000);
+    double flush_ms = (now_us() - f0) / 1000.0;
+    a16_mirror_get_stats(mirror, &after);
+    usleep((useconds_t)(interval * 3000));
+    int match = a16_mirror_get(mirror, A16_TAG_LOOPBACK_OUTPUT, &v) && v == expected;
+    printf("\nCoalescing: %u writes -> %u WriteRequests (%u values), flush %.2f ms, %s\n",
+           after.writes - before.writes, after.write_requests - before.write_requests,
+           after.write_nodes - before.write_nodes, flush_ms,
+           frc == 0 ? "accepted" : frc > 0 ? "REJECTED" : "TIMEOUT");
+    printf("Final loopback_output 0x%04X, expected 0x%04X: %s\n", v, expected,
+           match ? "OK" : "MISMATCH");
+
+    printf("\n");
+    print_stats(mirror);
+    a16_mirror_stop(mirror);
+
+    printf("\n=== TEST COMPLETED ===\n");
+    return 0;
+}
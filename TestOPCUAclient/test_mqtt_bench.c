@@ -0,0 +1,345 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include "mqtt311.h"
+
+// MQTT publisher benchmark.
+// Writes discrete_outputs through OPC UA at a fixed rate and measures how
+// long it takes until the gateway publishes the new value to MQTT.
+// Build together with ../components/mqtt_publisher/mqtt311.c.
+
+#define MAX_SAMPLES 100000
+
+// Benchmark state shared with the MQTT callback
+typedef struct {
+    double write_time[65536];    // Write time per DO value (0 = not written / already seen)
+    double* latencies;           // Write-to-arrival latency per delivered value (ms)
+    int latency_count;           // Number of latency samples
+    int messages;                // Messages received
+    int binary_messages;         // Messages in binary format
+    unsigned long changes;       // Sum of coalesced change counts
+    int max_batch;               // Largest coalesced change count in one message
+    int periodic;                // Periodic messages
+    unsigned int last_seq;       // Last sequence number seen
+    int seq_gaps;                // Sequence numbers going backwards
+    int parse_errors;            // Payloads that could not be decoded
+    double first_msg;            // Arrival time of the first message
+    double last_msg;             // Arrival time of the last message
+    int verbose;
+} BenchState;
+
+static volatile int running = 1;
+
+static void on_sigint(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+// Monotonic time in milliseconds
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Read a little-endian integer from a binary payload
+static unsigned long get_le(const uint8_t* p, int bytes) {
+    unsigned long v = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+// Find "key":<number> in a JSON payload
+static int json_number(const char* json, const char* key, unsigned long* out) {
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char* p = strstr(json, pattern);
+    if (!p) return 0;
+    *out = strtoul(p + strlen(pattern), NULL, 10);
+    return 1;
+}
+
+// MQTT message callback: decode the process image and match it to a write
+static void on_message(void* user, const char* topic, size_t topic_len,
+                       const uint8_t* payload, size_t len) {
+    BenchState* st = (BenchState*)user;
+    double t = now_ms();
+    unsigned long seq, dout, changes, flags;
+    (void)topic; (void)topic_len;
+
+    if (len == 30 && payload[0] == 1) {
+        flags = payload[1];
+        seq = get_le(payload + 4, 4);
+        changes = get_le(payload + 16, 2);
+        dout = get_le(payload + 20, 2);
+        st->binary_messages++;
+    } else {
+        char json[512];
+        size_t n = len < sizeof(json) - 1 ? len : sizeof(json) - 1;
+        memcpy(json, payload, n);
+        json[n] = '\0';
+        if (!json_number(json, "seq", &seq) || !json_number(json, "do", &dout) ||
+            !json_number(json, "changes", &changes) || !json_number(json, "flags", &flags)) {
+            st->parse_errors++;
+            return;
+        }
+    }
+
+    if (st->messages == 0) st->first_msg = t;
+    st->last_msg = t;
+    st->messages++;
+    st->changes += changes;
+    if ((int)changes > st->max_batch) st->max_batch = (int)changes;
+    if (flags & 0x01) st->periodic++;
+    if (st->messages > 1 && (int)(seq - st->last_seq) < 0) st->seq_gaps++;
+    st->last_seq = (unsigned int)seq;
+
+    if (dout < 65536 && st->write_time[dout] > 0.0) {
+        double lat = t - st->write_time[dout];
+        st->write_time[dout] = 0.0;
+        if (st->latency_count < MAX_SAMPLES) {
+            st->latencies[st->latency_count++] = lat;
+        }
+        if (st->verbose) {
+            printf("DO=0x%04lX seq=%lu changes=%lu latency=%.3f ms\n", dout, seq, changes, lat);
+        }
+    }
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int n, double p) {
+    if (n == 0) return 0.0;
+    int idx = (int)(p / 100.0 * (n - 1) + 0.5);
+    return sorted[idx];
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA -> MQTT PUBLISHER BENCHMARK\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help           Show this help message\n");
+    printf("  -v, --verbose        Print every matched message\n");
+    printf("  -b, --broker HOST    MQTT broker host (default: 127.0.0.1)\n");
+    printf("  -P, --port N         MQTT broker port (default: 1883)\n");
+    printf("  -T, --topic TOPIC    Process image topic (default: kincony/a16v3/image)\n");
+    printf("  -n, --count N        Number of discrete_outputs writes (default: 500)\n");
+    printf("  -r, --rate HZ        Write rate in writes per second (default: 50)\n");
+    printf("  -u, --user NAME      OPC UA username\n");
+    printf("  -p, --pass PASSWORD  OPC UA password\n");
+    printf("\nExample:\n");
+    printf("  %s -b 10.0.0.1 -n 1000 -r 100 -u engineer -p readwrite456 opc.tcp://10.0.0.128:4840\n",
+           program_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    // Default values
+    char* server_url = "opc.tcp://10.0.0.128:4840";
+    const char* broker = "127.0.0.1";
+    int broker_port = 1883;
+    const char* topic = "kincony/a16v3/image";
+    int count = 500;
+    double rate = 50.0;
+    const char* username = NULL;
+    const char* password = NULL;
+    int verbose = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+            verbose = 1;
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--broker") == 0) && i + 1 < argc) {
+            broker = argv[++i];
+        } else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--port") == 0) && i + 1 < argc) {
+            broker_port = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-T") == 0 || strcmp(argv[i], "--topic") == 0) && i + 1 < argc) {
+            topic = argv[++i];
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--count") == 0) && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rate") == 0) && i + 1 < argc) {
+            rate = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+
+    if (count < 1 || count > MAX_SAMPLES || rate <= 0.0) {
+        printf("Error: count must be 1..%d and rate > 0\n", MAX_SAMPLES);
+        return 1;
+    }
+
+    signal(SIGINT, on_sigint);
+
+    BenchState* st = calloc(1, sizeof(BenchState));
+    st->latencies = calloc(MAX_SAMPLES, sizeof(double));
+    st->verbose = verbose;
+
+    // ========== MQTT SUBSCRIBER ==========
+
+    static mqtt311_client_t mqtt;
+    char client_id[32];
+    snprintf(client_id, sizeof(client_id), "mqtt-bench-%d", (int)(now_ms()) % 100000);
+    mqtt311_config_t mqtt_cfg = {
+        .host = broker, .port = (uint16_t)broker_port, .client_id = client_id,
+        .keepalive_s = 30, .clean_session = true
+    };
+    mqtt311_init(&mqtt, &mqtt_cfg);
+    mqtt.on_message = on_message;
+    mqtt.user = st;
+
+    printf("Connecting to MQTT broker %s:%d...\n", broker, broker_port);
+    if (!mqtt311_connect(&mqtt, 3000) || !mqtt311_subscribe(&mqtt, topic, 0)) {
+        printf("MQTT connection failed\n");
+        return 1;
+    }
+
+    // ========== OPC UA CLIENT ==========
+
+    UA_Client* client = UA_Client_new();
+    UA_StatusCode status;
+    printf("Connecting to %s...\n", server_url);
+    if (username && password) {
+        status = UA_Client_connectUsername(client, server_url, username, password);
+    } else {
+        status = UA_Client_connect(client, server_url);
+    }
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection failed: 0x%08X\n", status);
+        UA_Client_delete(client);
+        return 1;
+    }
+
+    UA_NodeId do_node = UA_NODEID_STRING_ALLOC(1, "discrete_outputs");
+
+    // Let the initial image and the SUBACK arrive before measuring
+    double settle = now_ms() + 500.0;
+    while (now_ms() < settle) mqtt311_loop(&mqtt, 10);
+    st->messages = 0;
+    st->changes = 0;
+    st->max_batch = 0;
+    st->periodic = 0;
+    st->binary_messages = 0;
+
+    printf("=============================================\n");
+    printf("   MQTT PUBLISHER BENCHMARK\n");
+    printf("   %d writes at %.1f Hz, topic '%s'\n", count, rate, topic);
+    printf("   Press Ctrl+C to stop\n");
+    printf("=============================================\n\n");
+
+    // ========== WRITE LOOP ==========
+
+    double period = 1000.0 / rate;
+    double start = now_ms();
+    int writes = 0;
+    int write_errors = 0;
+    double write_total = 0.0;
+    UA_UInt16 value = 0;
+
+    for (int i = 0; i < count && running; i++) {
+        // Next distinct, non-zero value so every write is a real change
+        value = (UA_UInt16)(value + 1);
+        if (value == 0) value = 1;
+
+        UA_Variant v;
+        UA_Variant_init(&v);
+        UA_Variant_setScalar(&v, &value, &UA_TYPES[UA_TYPES_UINT16]);
+
+        double t0 = now_ms();
+        st->write_time[value] = t0;
+        status = UA_Client_writeValueAttribute(client, do_node, &v);
+        write_total += now_ms() - t0;
+        if (status != UA_STATUSCODE_GOOD) {
+            st->write_time[value] = 0.0;
+            write_errors++;
+        } else {
+            writes++;
+        }
+
+        // Service MQTT until the next write slot
+        double next = start + (i + 1) * period;
+        do {
+            double left = next - now_ms();
+            mqtt311_loop(&mqtt, left > 1.0 ? (uint32_t)left : 0);
+        } while (now_ms() < next && running);
+    }
+
+    // Drain late messages
+    double drain = now_ms() + 2000.0;
+    while (now_ms() < drain && running) mqtt311_loop(&mqtt, 10);
+    double duration = (st->last_msg > start ? st->last_msg : now_ms()) - start;
+
+    // ========== RESULTS ==========
+
+    qsort(st->latencies, st->latency_count, sizeof(double), cmp_double);
+    double sum = 0.0;
+    for (int i = 0; i < st->latency_count; i++) sum += st->latencies[i];
+    int change_messages = st->messages - st->periodic;
+
+    printf("\n=== WRITES ===\n");
+    printf("Writes:              %d (%d errors)\n", writes, write_errors);
+    printf("Avg write time:      %.3f ms\n", writes ? write_total / (writes + write_errors) : 0.0);
+
+    printf("\n=== MQTT MESSAGES ===\n");
+    printf("Messages received:   %d (%s, %d periodic)\n", st->messages,
+           st->binary_messages ? "binary" : "json", st->periodic);
+    printf("Throughput:          %.1f msg/s\n", duration > 0 ? st->messages * 1000.0 / duration : 0.0);
+    printf("Changes coalesced:   %lu (avg %.2f per change message, max %d)\n", st->changes,
+           change_messages > 0 ? (double)st->changes / change_messages : 0.0, st->max_batch);
+    printf("Values delivered:    %d/%d (%.1f%%, others superseded inside a batch window)\n",
+           st->latency_count, writes, writes ? 100.0 * st->latency_count / writes : 0.0);
+    printf("Sequence errors:     %d, parse errors: %d\n", st->seq_gaps, st->parse_errors);
+
+    printf("\n=== WRITE -> MQTT LATENCY ===\n");
+    if (st->latency_count > 0) {
+        printf("Min:                 %.3f ms\n", st->latencies[0]);
+        printf("Avg:                 %.3f ms\n", sum / st->latency_count);
+        printf("P50:                 %.3f ms\n", percentile(st->latencies, st->latency_count, 50));
+        printf("P95:                 %.3f ms\n", percentile(st->latencies, st->latency_count, 95));
+        printf("P99:                 %.3f ms\n", percentile(st->latencies, st->latency_count, 99));
+        printf("Max:                 %.3f ms\n", st->latencies[st->latency_count - 1]);
+    } else {
+        printf("No matching messages received\n");
+    }
+
+    // Reset outputs
+    UA_UInt16 zero = 0;
+    UA_Variant zv;
+    UA_Variant_setScalar(&zv, &zero, &UA_TYPES[UA_TYPES_UINT16]);
+    UA_Client_writeValueAttribute(client, do_node, &zv);
+
+    UA_NodeId_clear(&do_node);
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    mqtt311_disconnect(&mqtt);
+    free(st->latencies);
+    free(st);
+
+    printf("\n=== TEST COMPLETED ===\n");
+    return 0;
+}
@@ -0,0 +1,341 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A/B firmware update check (components/ota_update).
+// The tool starts firmware.Update with a URL of a full image or a delta patch
+// (tools/ota_delta.c) and follows the download while it keeps reading
+// discrete_inputs, so the effect of the update on the running gateway shows
+// up as read latency. It reports the bytes transferred, flash sectors written
+// and skipped and the download time. With -a it then calls
+// firmware.Activate and measures the downtime until the gateway answers
+// again, checks that the new version runs from the other slot pending
+// verification and (with -c) waits for the confirmation.
+// One run measures one update; run it once with the full image and once
+// with the patch and append both to the same CSV (-o) to compare them.
+// The methods are reserved for the admin user (-u/-p) when authentication is on.
+
+#define POLL_INTERVAL_MS    100
+
+static const char* username;
+static const char* password;
+static UA_UInt32 timeout_ms = 2000;
+
+static double now_ms(void) {
+    return (double)UA_DateTime_nowMonotonic() / UA_DATETIME_MSEC;
+}
+
+static void sleep_ms(int ms) {
+    UA_DateTime until = UA_DateTime_nowMonotonic() + (UA_DateTime)ms * UA_DATETIME_MSEC;
+    while (UA_DateTime_nowMonotonic() < until) {
+    }
+}
+
+static UA_Client* connect_gateway(const char* url) {
+    UA_Client* client = UA_Client_new();
+    UA_Client_getConfig(client)->timeout = timeout_ms;
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, url, username, password)
+        : UA_Client_connect(client, url);
+    if (status != UA_STATUSCODE_GOOD) {
+        UA_Client_delete(client);
+        return NULL;
+    }
+    return client;
+}
+
+static void disconnect_gateway(UA_Client* client) {
+    if (!client) return;
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+}
+
+static int read_uint32(UA_Client* client, const char* id, UA_UInt32* out) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_UINT32]);
+    if (ok) *out = *(UA_UInt32*)value.data;
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static int read_boolean(UA_Client* client, const char* id, UA_Boolean* out) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    if (ok) *out = *(UA_Boolean*)value.data;
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static int read_string(UA_Client* client, const char* id, char* out, size_t size) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_STRING]);
+    out[0] = '\0';
+    if (ok) {
+        UA_String* s = (UA_String*)value.data;
+        size_t n = s->length < size - 1 ? s->length : size - 1;
+        memcpy(out, s->data, n);
+        out[n] = '\0';
+    }
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+// Read discrete_inputs once; latency in ms or -1 on failure
+static double probe_inputs(UA_Client* client) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    double start = now_ms();
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, "discrete_inputs"), &value);
+    double latency = now_ms() - start;
+    UA_Variant_clear(&value);
+    return status == UA_STATUSCODE_GOOD ? latency : -1.0;
+}
+
+static UA_StatusCode call_method(UA_Client* client, const char* id, size_t inputSize, UA_Variant* input) {
+    size_t outputSize = 0;
+    UA_Variant* output = NULL;
+    UA_StatusCode status = UA_Client_call(client, UA_NODEID_STRING(1, "firmware"),
+                                          UA_NODEID_STRING(1, (char*)id), inputSize, input,
+                                          &outputSize, &output);
+    UA_Array_delete(output, outputSize, &UA_TYPES[UA_TYPES_VARIANT]);
+    return status;
+}
+
+static void print_help(const char* program_name) {
+    printf("OPC UA A/B FIRMWARE UPDATE CHECK\n");
+    printf("================================\n");
+    printf("Usage: %s [OPTIONS] UPDATE_URL [SERVER_URL]\n\n", program_name);
+    printf("UPDATE_URL is the HTTP URL of a full image (.bin) or a delta patch the gateway\n");
+    printf("downloads; SERVER_URL defaults to opc.tcp://10.0.0.128:4840.\n\n");
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -a, --activate         Activate the new image and measure the downtime\n");
+    printf("  -c, --confirm MS       After -a, wait up to MS for the confirmation (default: off)\n");
+    printf("  -w, --wait MS          Longest download time (default: 300000)\n");
+    printf("  -b, --boot MS          Longest restart time after activation (default: 60000)\n");
+    printf("  -t, --timeout MS       Request timeout (default: 2000)\n");
+    printf("  -o, --csv FILE         Also append the results as CSV\n");
+    printf("  -u, --user NAME        Username (admin)\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nExamples:\n");
+    printf("  %s -o ota.csv http://10.0.0.10:8000/gw.bin\n", program_name);
+    printf("  %s -o ota.csv -a -c 120000 http://10.0.0.10:8000/gw.patch\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_url = "opc.tcp://10.0.0.128:4840";
+    const char* update_url = NULL;
+    const char* csv_file = NULL;
+    int activate = 0;
+    int confirm_ms = 0;
+    int wait_ms = 300000;
+    int boot_ms = 60000;
+    int urls = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--activate") == 0) {
+            activate = 1;
+        } else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--confirm") == 0) && i + 1 < argc) {
+            confirm_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--wait") == 0) && i + 1 < argc) {
+            wait_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--boot") == 0) && i + 1 < argc) {
+            boot_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = (UA_UInt32)atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else if (urls == 0) {
+            update_url = argv[i];
+            urls++;
+        } else if (urls == 1) {
+            server_url = argv[i];
+            urls++;
+        }
+    }
+    if (!update_url) {
+        print_help(argv[0]);
+        return 1;
+    }
+
+    UA_Client* client = connect_gateway(server_url);
+    if (!client) {
+        printf("Connection to %s failed\n", server_url);
+        return 1;
+    }
+    int failed = 0;
+    char version[40], slot[16], state[16], error[64], new_version[40];
+    UA_Boolean pending = false;
+    read_string(client, "firmware.Version", version, sizeof(version));
+    read_string(client, "firmware.Slot", slot, sizeof(slot));
+    read_boolean(client, "firmware.Pending", &pending);
+    printf("RUNNING\n  %s from %s%s\n", version, slot, pending ? " (pending verification)" : "");
+
+    // Download
+    printf("\nDOWNLOAD %s\n", update_url);
+    UA_Variant input[2];
+    UA_String url = UA_STRING((char*)update_url);
+    UA_Boolean no_activate = false;
+    UA_Variant_setScalar(&input[0], &url, &UA_TYPES[UA_TYPES_STRING]);
+    UA_Variant_setScalar(&input[1], &no_activate, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    UA_StatusCode status = call_method(client, "firmware.Update", 2, input);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("FAIL: Update: %s\n", UA_StatusCode_name(status));
+        disconnect_gateway(client);
+        return 1;
+    }
+    double start = now_ms();
+    double probe_max = 0.0, probe_sum = 0.0;
+    int probes = 0, probe_errors = 0;
+    UA_UInt32 received = 0, total = 0, last_received = 0;
+    while (now_ms() - start < wait_ms) {
+        double latency = probe_inputs(client);
+        if (latency < 0.0) {
+            probe_errors++;
+        } else {
+            probe_sum += latency;
+            if (latency > probe_max) probe_max = latency;
+            probes++;
+        }
+        read_string(client, "firmware.State", state, sizeof(state));
+        read_uint32(client, "firmware.Received", &received);
+        read_uint32(client, "firmware.Total", &total);
+        if (received / 65536 != last_received / 65536) {
+            printf("  %u / %u bytes\n", received, total);
+        }
+        last_received = received;
+        if (strcmp(state, "downloading") != 0) break;
+        sleep_ms(POLL_INTERVAL_MS);
+    }
+    double download_ms = now_ms() - start;
+
+    UA_Boolean delta = false;
+    UA_UInt32 image_size = 0, written = 0, skipped = 0, duration = 0;
+    read_boolean(client, "firmware.Delta", &delta);
+    read_uint32(client, "firmware.Received", &received);
+    read_uint32(client, "firmware.ImageSize", &image_size);
+    read_uint32(client, "firmware.SectorsWritten", &written);
+    read_uint32(client, "firmware.SectorsSkipped", &skipped);
+    read_uint32(client, "firmware.DurationMs", &duration);
+    read_string(client, "firmware.NewVersion", new_version, sizeof(new_version));
+    read_string(client, "firmware.Error", error, sizeof(error));
+    printf("  State %s%s%s after %.0f ms (gateway %u ms)\n", state, error[0] ? ": " : "", error,
+           download_ms, duration);
+    printf("  %s: %u bytes for an image of %u bytes (%.1f%%), version %s\n", delta ? "Patch" : "Full image",
+           received, image_size, image_size ? 100.0 * received / image_size : 0.0, new_version);
+    printf("  Sectors written %u, unchanged %u\n", written, skipped);
+    printf("  discrete_inputs during the download: %d reads, mean %.1f ms, max %.1f ms, %d failed\n",
+           probes, probes ? probe_sum / probes : 0.0, probe_max, probe_errors);
+    if (strcmp(state, "ready") != 0) {
+        printf("FAIL: the update did not become ready\n");
+        failed = 1;
+    }
+    if (probe_errors > 0) {
+        printf("FAIL: the gateway did not answer during the download\n");
+        failed = 1;
+    }
+
+    // Activation
+    double downtime = -1.0, confirmed = -1.0;
+    char booted_version[40] = "", booted_slot[16] = "";
+    if (activate && !failed) {
+        printf("\nACTIVATE\n");
+        status = call_method(client, "firmware.Activate", 0, NULL);
+        start = now_ms();
+        disconnect_gateway(client);
+        client = NULL;
+        if (status != UA_STATUSCODE_GOOD) {
+            printf("FAIL: Activate: %s\n", UA_StatusCode_name(status));
+            failed = 1;
+        } else {
+            // The gateway keeps serving for OTA_RESTART_DELAY_MS; wait for it to go away first
+            double last_seen = start;
+            while (now_ms() - start < boot_ms) {
+                if (!client) client = connect_gateway(server_url);
+                if (client && read_string(client, "firmware.Version", booted_version, sizeof(booted_version)) &&
+                    strcmp(booted_version, new_version) == 0) {
+                    downtime = now_ms() - last_seen;
+                    break;
+                }
+                if (client && booted_version[0]) last_seen = now_ms();
+                disconnect_gateway(client);
+                client = NULL;
+                booted_version[0] = '\0';
+                sleep_ms(POLL_INTERVAL_MS);
+            }
+            if (client) {
+                read_string(client, "firmware.Slot", booted_slot, sizeof(booted_slot));
+                read_boolean(client, "firmware.Pending", &pending);
+            }
+            printf("  Back after %.0f ms: %s from %s%s\n", downtime, booted_version, booted_slot,
+                   pending ? " (pending verification)" : "");
+            if (downtime < 0.0) {
+                printf("FAIL: the new version did not answer within %d ms\n", boot_ms);
+                failed = 1;
+            } else if (strcmp(booted_slot, slot) == 0) {
+                printf("FAIL: the gateway still runs from %s\n", slot);
+                failed = 1;
+            }
+        }
+
+        if (client && confirm_ms > 0 && !failed) {
+            start = now_ms();
+            while (now_ms() - start < confirm_ms) {
+                if (read_boolean(client, "firmware.Pending", &pending) && !pending) {
+                    confirmed = now_ms() - start;
+                    break;
+                }
+                sleep_ms(POLL_INTERVAL_MS * 10);
+            }
+            printf("  Confirmed after %.0f ms\n", confirmed);
+            if (confirmed < 0.0) {
+                printf("FAIL: the new image was not confirmed within %d ms\n", confirm_ms);
+                failed = 1;
+            }
+        }
+    }
+
+    printf("\n%-10s %10s %10s %8s %8s %10s %10s\n", "update", "bytes", "image", "written", "skipped",
+           "write ms", "down ms");
+    printf("%-10s %10u %10u %8u %8u %10u %10.0f\n", delta ? "delta" : "full", received, image_size,
+           written, skipped, duration, downtime);
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+
+    if (csv_file) {
+        FILE* check = fopen(csv_file, "r");
+        int header = check == NULL;
+        if (check) fclose(check);
+        FILE* csv = fopen(csv_file, "a");
+        if (csv) {
+            if (header) {
+                fprintf(csv, "url,delta,from_version,to_version,received,image_size,sectors_written,"
+                             "sectors_skipped,write_ms,probe_max_ms,downtime_ms,confirm_ms,result\n");
+            }
+            fprintf(csv, "%s,%d,%s,%s,%u,%u,%u,%u,%u,%.1f,%.0f,%.0f,%s\n", update_url, delta ? 1 : 0,
+                    version, new_version, received, image_size, written, skipped, duration, probe_max,
+                    downtime, confirmed, failed ? "FAILED" : "PASSED");
+            fclose(csv);
+        }
+    }
+
+    disconnect_gateway(client);
+    return failed;
+}
@@ -0,0 +1,444 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Control write latency under monitoring load.
+// An operator session writes loopback_input at a fixed interval (the
+// gateway treats it like a relay output) while flood sessions keep a number
+// of Browse or Read requests outstanding, as a SCADA client polling the
+// address space would. The test runs twice: writes alone (idle) and writes
+// with the flood (loaded). With request scheduling in the gateway the write
+// latency under load should stay close to the idle latency; without it every
+// write waits behind the requests the flood sessions have queued.
+//
+// The flood runs in its own thread so that processing its responses does not
+// delay the operator session on the client side.
+
+#define MAX_FLOOD 16
+#define MAX_DEPTH 64
+
+typedef enum { FL_BROWSE, FL_READ } FloodWorkload;
+
+// Flood session
+typedef struct {
+    UA_Client* client;
+    int inflight;
+} FloodSession;
+
+// Result of one phase
+typedef struct {
+    int writes;
+    int errors;
+    double p50, p99, max;
+    double flood_rps;
+} PhaseResult;
+
+static const char* tag_names[] = {
+    "diagnostic_counter", "loopback_input", "loopback_output", "discrete_inputs",
+    "discrete_outputs", "adc_channel_1", "adc_channel_2", "adc_channel_3", "adc_channel_4"
+};
+
+// Flood state, shared with the flood thread
+static FloodSession flood[MAX_FLOOD];
+static int nflood = 4;
+static int flood_depth = 16;
+static FloodWorkload flood_wl = FL_BROWSE;
+static UA_UInt32 timeout_ms = 2000;
+static volatile int flood_run;
+static volatile long flood_done;
+static volatile long flood_errors;
+
+// Operator write state (main thread)
+static double* write_samples;
+static int write_count;
+static int write_capacity;
+static int write_errors;
+static int write_pending;
+static double write_sent_us;
+
+// Monotonic time in microseconds
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int count, double p) {
+    if (count == 0) return 0.0;
+    int idx = (int)(count * p);
+    if (idx >= count) idx = count - 1;
+    return sorted[idx];
+}
+
+// ========== FLOOD ==========
+
+static void on_flood_response(UA_Client* client, void* userdata, UA_UInt32 requestId, void* response) {
+    FloodSession* s = (FloodSession*)userdata;
+    // Browse and Read responses both start with the response header
+    UA_ResponseHeader* rh = (UA_ResponseHeader*)response;
+    if (rh->serviceResult == UA_STATUSCODE_GOOD) flood_done++;
+    else flood_errors++;
+    s->inflight--;
+}
+
+static UA_BrowseDescription browse_desc[2];
+static UA_BrowseRequest browse_req;
+static UA_ReadValueId read_ids[9];
+static UA_ReadRequest read_req;
+
+static void init_flood_requests(void) {
+    // Objects folder and Server object, all references with every field
+    for (int i = 0; i < 2; i++) {
+        UA_BrowseDescription_init(&browse_desc[i]);
+        browse_desc[i].nodeId = UA_NODEID_NUMERIC(0, i == 0 ? UA_NS0ID_OBJECTSFOLDER : UA_NS0ID_SERVER);
+        browse_desc[i].browseDirection = UA_BROWSEDIRECTION_BOTH;
+        browse_desc[i].includeSubtypes = true;
+        browse_desc[i].resultMask = UA_BROWSERESULTMASK_ALL;
+    }
+    UA_BrowseRequest_init(&browse_req);
+    browse_req.nodesToBrowse = browse_desc;
+    browse_req.nodesToBrowseSize = 2;
+
+    for (int i = 0; i < 9; i++) {
+        UA_ReadValueId_init(&read_ids[i]);
+        read_ids[i].nodeId = UA_NODEID_STRING(1, (char*)tag_names[i]);
+        read_ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    UA_ReadRequest_init(&read_req);
+    read_req.nodesToRead = read_ids;
+    read_req.nodesToReadSize = 9;
+    read_req.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+}
+
+static void flood_send(FloodSession* s) {
+    UA_StatusCode status;
+    if (flood_wl == FL_BROWSE) {
+        status = __UA_Client_AsyncServiceEx(s->client, &browse_req, &UA_TYPES[UA_TYPES_BROWSEREQUEST],
+                                            on_flood_response, &UA_TYPES[UA_TYPES_BROWSERESPONSE],
+                                            s, NULL, timeout_ms);
+    } else {
+        status = __UA_Client_AsyncServiceEx(s->client, &read_req, &UA_TYPES[UA_TYPES_READREQUEST],
+                                            on_flood_response, &UA_TYPES[UA_TYPES_READRESPONSE],
+                                            s, NULL, timeout_ms);
+    }
+    if (status == UA_STATUSCODE_GOOD) s->inflight++;
+    else flood_errors++;
+}
+
+// Keep flood_depth requests outstanding on every flood session
+static void* flood_thread(void* arg) {
+    (void)arg;
+    while (flood_run) {
+        for (int i = 0; i < nflood; i++) {
+            while (flood[i].inflight < flood_depth) {
+                int before = flood[i].inflight;
+                flood_send(&flood[i]);
+                if (flood[i].inflight == before) break;
+            }
+        }
+        for (int i = 0; i < nflood; i++) UA_Client_run_iterate(flood[i].client, 0);
+    }
+    // Collect what is still outstanding
+    double end = now_us() + timeout_ms * 1000.0;
+    for (;;) {
+        int inflight = 0;
+        for (int i = 0; i < nflood; i++) inflight += flood[i].inflight;
+        if (inflight == 0 || now_us() > end) break;
+        for (int i = 0; i < nflood; i++) UA_Client_run_iterate(flood[i].client, 1);
+    }
+    return NULL;
+}
+
+// ========== OPERATOR ==========
+
+static UA_WriteValue write_value;
+static UA_WriteRequest write_req;
+static UA_UInt16 write_counter;
+
+static void on_write_response(UA_Client* client, void* userdata, UA_UInt32 requestId, void* response) {
+    UA_WriteResponse* wr = (UA_WriteResponse*)response;
+    double ms = (now_us() - write_sent_us) / 1000.0;
+    write_pending = 0;
+    if (wr->responseHeader.serviceResult != UA_STATUSCODE_GOOD || wr->resultsSize != 1 ||
+        wr->results[0] != UA_STATUSCODE_GOOD) {
+        write_errors++;
+        return;
+    }
+    if (write_count == write_capacity) {
+        write_capacity = write_capacity ? write_capacity * 2 : 1024;
+        write_samples = realloc(write_samples, write_capacity * sizeof(double));
+    }
+    write_samples[write_count++] = ms;
+}
+
+// Write at a fixed interval for the duration of the phase, one write outstanding
+static void run_writes(UA_Client* op, double interval_ms, double duration_s) {
+    UA_WriteValue_init(&write_value);
+    write_value.nodeId = UA_NODEID_STRING(1, "loopback_input");
+    write_value.attributeId = UA_ATTRIBUTEID_VALUE;
+    write_value.value.hasValue = true;
+    UA_WriteRequest_init(&write_req);
+    write_req.nodesToWrite = &write_value;
+    write_req.nodesToWriteSize = 1;
+
+    write_count = 0;
+    write_errors = 0;
+    double end = now_us() + duration_s * 1e6;
+    double next = now_us();
+    while (now_us() < end || write_pending) {
+        double t = now_us();
+        if (!write_pending && t >= next && t < end) {
+            write_counter++;
+            UA_Variant_setScalar(&write_value.value.value, &write_counter, &UA_TYPES[UA_TYPES_UINT16]);
+            write_sent_us = t;
+            write_pending = 1;
+            if (__UA_Client_AsyncServiceEx(op, &write_req, &UA_TYPES[UA_TYPES_WRITEREQUEST],
+                                           on_write_response, &UA_TYPES[UA_TYPES_WRITERESPONSE],
+                                           NULL, NULL, timeout_ms) != UA_STATUSCODE_GOOD) {
+                write_pending = 0;
+                write_errors++;
+            }
+            next += interval_ms * 1000.0;
+            if (next < t) next = t;
+        }
+        if (write_pending && t - write_sent_us > timeout_ms * 1000.0) {
+            write_pending = 0;
+            write_errors++;
+        }
+        UA_Client_run_iterate(op, 0);
+        usleep(100);
+    }
+}
+
+static void run_phase(UA_Client* op, int loaded, double interval_ms, double duration_s, PhaseResult* r) {
+    pthread_t th;
+    flood_done = 0;
+    flood_errors = 0;
+    if (loaded) {
+        flood_run = 1;
+        pthread_create(&th, NULL, flood_thread, NULL);
+        usleep(500000);  // Let the flood fill the gateway queues
+    }
+    long done0 = flood_done;
+    double t0 = now_us();
+    run_writes(op, interval_ms, duration_s);
+    double span_s = (now_us() - t0) / 1e6;
+    long done = flood_done - done0;
+    if (loaded) {
+        flood_run = 0;
+        pthread_join(th, NULL);
+    }
+
+    qsort(write_samples, write_count, sizeof(double), cmp_double);
+    r->writes = write_count;
+    r->errors = write_errors + (int)flood_errors;
+    r->p50 = percentile(write_samples, write_count, 0.50);
+    r->p99 = percentile(write_samples, write_count, 0.99);
+    r->max = write_count ? write_samples[write_count - 1] : 0.0;
+    r->flood_rps = span_s > 0 ? done / span_s : 0.0;
+}
+
+// Row of a previous -o run whose first column (phase) equals key
+static int baseline_row(const char* path, int key, double* cols, int ncols) {
+    FILE* f = path ? fopen(path, "r") : NULL;
+    if (!f) return 0;
+    char line[256];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), f)) {
+        double v[8];
+        int n = 0;
+        char* p = line;
+        while (n < 8) {
+            char* end;
+            v[n] = strtod(p, &end);
+            if (end == p) break;
+            n++;
+            if (*end != ',') break;
+            p = end + 1;
+        }
+        if (n >= ncols && (int)v[0] == key) {
+            memcpy(cols, v, ncols * sizeof(double));
+            found = 1;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+static UA_Client* connect_session(const char* url, const char* username, const char* password) {
+    UA_Client* client = UA_Client_new();
+    UA_Client_getConfig(client)->timeout = timeout_ms;
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, url, username, password)
+        : UA_Client_connect(client, url);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection failed: %s\n", UA_StatusCode_name(status));
+        UA_Client_delete(client);
+        return NULL;
+    }
+    return client;
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA CONTROL WRITE LATENCY UNDER MONITORING LOAD\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -f, --flood N          Flood sessions (default: 4)\n");
+    printf("  -q, --depth N          Outstanding requests per flood session (default: 16)\n");
+    printf("  -w, --workload TYPE    Flood requests: browse or read (default: browse)\n");
+    printf("  -i, --interval MS      Operator write interval (default: 20)\n");
+    printf("  -d, --duration SEC     Duration of each phase (default: 10)\n");
+    printf("  -t, --timeout MS       Request timeout (default: 2000)\n");
+    printf("  -o, --csv FILE         Also write the results as CSV\n");
+    printf("  -b, --baseline FILE    Compare with the CSV of a previous run\n");
+    printf("  -u, --user NAME        Username (needs write rights)\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nWrites go to loopback_input only; relay outputs are never touched.\n");
+    printf("\nExamples:\n");
+    printf("  %s -u engineer -p readwrite456 opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -f 8 -q 32 -w read -o sched.csv -b fifo.csv -u engineer -p readwrite456 "
+           "opc.tcp://10.0.0.128:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    // Default values
+    char* server_url = "opc.tcp://10.0.0.128:4840";
+    double interval_ms = 20.0;
+    double duration = 10.0;
+    const char* csv_file = NULL;
+    const char* baseline_file = NULL;
+    const char* username = NULL;
+    const char* password = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "--flood") == 0) && i + 1 < argc) {
+            nflood = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--depth") == 0) && i + 1 < argc) {
+            flood_depth = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--workload") == 0) && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "browse") == 0) flood_wl = FL_BROWSE;
+            else if (strcmp(argv[i], "read") == 0) flood_wl = FL_READ;
+            else {
+                printf("Unknown workload: %s\n", argv[i]);
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--interval") == 0) && i + 1 < argc) {
+            interval_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--duration") == 0) && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = (UA_UInt32)atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--baseline") == 0) && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (nflood < 1) nflood = 1;
+    if (nflood > MAX_FLOOD) nflood = MAX_FLOOD;
+    if (flood_depth < 1) flood_depth = 1;
+    if (flood_depth > MAX_DEPTH) flood_depth = MAX_DEPTH;
+    if (interval_ms < 1.0) interval_ms = 1.0;
+    if (duration < 1.0) duration = 1.0;
+    if (timeout_ms < 100) timeout_ms = 100;
+
+    printf("=============================================\n");
+    printf("   CONTROL WRITE LATENCY UNDER LOAD\n");
+    printf("   Server: %s\n", server_url);
+    printf("   Operator: Write of loopback_input every %.0f ms\n", interval_ms);
+    printf("   Flood: %d session(s) x %d outstanding %s\n", nflood, flood_depth,
+           flood_wl == FL_BROWSE ? "Browse (2 nodes, all references)" : "Read (9 tags)");
+    printf("   %.1f s per phase\n", duration);
+    printf("=============================================\n\n");
+
+    // ========== SESSIONS ==========
+    UA_Client* op = connect_session(server_url, username, password);
+    if (!op) return 1;
+    for (int i = 0; i < nflood; i++) {
+        flood[i].client = connect_session(server_url, username, password);
+        if (!flood[i].client) {
+            for (int j = 0; j < i; j++) UA_Client_delete(flood[j].client);
+            UA_Client_delete(op);
+            return 1;
+        }
+    }
+    init_flood_requests();
+
+    // ========== PHASES ==========
+    const char* phase_names[] = { "idle", "loaded" };
+    PhaseResult results[2];
+    FILE* csv = csv_file ? fopen(csv_file, "w") : NULL;
+    if (csv) fprintf(csv, "phase,writes,p50_ms,p99_ms,max_ms,flood_rps,errors\n");
+
+    printf("%-8s %8s %9s %9s %9s %11s %7s\n", "phase", "writes", "p50 ms", "p99 ms", "max ms",
+           "flood req/s", "errors");
+    printf("----------------------------------------------------------------------\n");
+    for (int ph = 0; ph < 2; ph++) {
+        PhaseResult* r = &results[ph];
+        run_phase(op, ph, interval_ms, duration, r);
+        printf("%-8s %8d %9.3f %9.3f %9.3f %11.1f %7d\n", phase_names[ph], r->writes, r->p50, r->p99,
+               r->max, r->flood_rps, r->errors);
+        double b[6];
+        if (baseline_row(baseline_file, ph, b, 6)) {
+            printf("         vs base  p50 %.3f -> %.3f ms  p99 %.3f -> %.3f ms  flood %.1f -> %.1f req/s\n",
+                   b[2], r->p50, b[3], r->p99, b[5], r->flood_rps);
+        }
+        fflush(stdout);
+        if (csv) {
+            fprintf(csv, "%d,%d,%.3f,%.3f,%.3f,%.1f,%d\n", ph, r->writes, r->p50, r->p99, r->max,
+                    r->flood_rps, r->errors);
+        }
+        usleep(500000);
+    }
+    if (csv) fclose(csv);
+
+    // ========== SUMMARY ==========
+    printf("\n=== SUMMARY ===\n");
+    printf("Write p99 under load: %.3f ms (%.1fx idle)\n", results[1].p99,
+           results[0].p99 > 0 ? results[1].p99 / results[0].p99 : 0.0);
+    printf("Flood throughput:     %.1f req/s\n", results[1].flood_rps);
+    printf("The gateway reports queue depths and latency per lane on /metrics\n");
+    printf("(a16_opcua_queued, a16_opcua_latency_seconds).\n");
+
+    for (int i = 0; i < nflood; i++) {
+        UA_Client_disconnect(flood[i].client);
+        UA_Client_delete(flood[i].client);
+    }
+    UA_Client_disconnect(op);
+    UA_Client_delete(op);
+    free(write_samples);
+    printf("\n=== TEST COMPLETED ===\n");
+    return 0;
+}
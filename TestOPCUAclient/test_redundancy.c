@@ -0,0 +1,381 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Hot-standby pair check (components/redundancy).
+// The tool connects to both gateways of a redundant pair and runs four
+// phases:
+//   pair         exactly one server has ServiceLevel 255 (active), the other
+//                200 (standby); RedundancySupport and ServerUriArray are shown
+//   replication  -n writes of discrete_outputs on the active unit; each value
+//                must show up in the standby's replica (latency by polling),
+//                a write on the standby must be refused
+//   failover     the active unit is stopped (-k command, or by hand); the
+//                standby must reach ServiceLevel 255, keep the last output
+//                command and the image sequence, and accept writes
+//   rejoin       the stopped unit is started again (-r command, or by hand);
+//                it must come back as standby without taking over, and
+//                replication must work in the new direction
+// The -k and -r commands get the URL of the unit as their last argument.
+// Without them the tool waits for the operator to power off (unplug) or
+// restart the unit and press Enter.
+
+#define SERVICE_LEVEL_ACTIVE    255
+#define SERVICE_LEVEL_STANDBY   200
+#define REPLICATION_TIMEOUT_MS  1000
+#define TAKEOVER_TIMEOUT_MS     10000
+
+static const char* support_names[] = {"None", "Cold", "Warm", "Hot", "Transparent", "HotAndMirrored"};
+
+typedef struct {
+    const char* url;
+    UA_Client* client;
+} Unit;
+
+static const char* username;
+static const char* password;
+static UA_UInt32 timeout_ms = 2000;
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double now_ms(void) {
+    return (double)UA_DateTime_nowMonotonic() / UA_DATETIME_MSEC;
+}
+
+static int connect_unit(Unit* unit) {
+    unit->client = UA_Client_new();
+    UA_Client_getConfig(unit->client)->timeout = timeout_ms;
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(unit->client, unit->url, username, password)
+        : UA_Client_connect(unit->client, unit->url);
+    if (status != UA_STATUSCODE_GOOD) {
+        UA_Client_delete(unit->client);
+        unit->client = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+static void disconnect_unit(Unit* unit) {
+    if (!unit->client) return;
+    UA_Client_disconnect(unit->client);
+    UA_Client_delete(unit->client);
+    unit->client = NULL;
+}
+
+// Server/ServiceLevel, -1 if it cannot be read
+static int read_service_level(Unit* unit) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(
+        unit->client, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVICELEVEL), &value);
+    int level = -1;
+    if (status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_BYTE])) {
+        level = *(UA_Byte*)value.data;
+    }
+    UA_Variant_clear(&value);
+    return level;
+}
+
+static int read_uint32(Unit* unit, const char* id, UA_UInt32* out) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(unit->client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_UINT32]);
+    if (ok) *out = *(UA_UInt32*)value.data;
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static int read_outputs(Unit* unit, UA_UInt16* out) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(unit->client, UA_NODEID_STRING(1, "discrete_outputs"), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_UINT16]);
+    if (ok) *out = *(UA_UInt16*)value.data;
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static UA_StatusCode write_outputs(Unit* unit, UA_UInt16 outputs) {
+    UA_Variant value;
+    UA_Variant_setScalar(&value, &outputs, &UA_TYPES[UA_TYPES_UINT16]);
+    return UA_Client_writeValueAttribute(unit->client, UA_NODEID_STRING(1, "discrete_outputs"), &value);
+}
+
+// Poll the replica until it shows outputs; latency in ms or -1 on timeout
+static double wait_replicated(Unit* standby, UA_UInt16 outputs, double start) {
+    UA_UInt16 replica = 0;
+    while (now_ms() - start < REPLICATION_TIMEOUT_MS) {
+        if (read_outputs(standby, &replica) && replica == outputs) {
+            return now_ms() - start;
+        }
+    }
+    return -1.0;
+}
+
+static void print_redundancy_info(Unit* unit) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    if (UA_Client_readValueAttribute(unit->client,
+            UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERREDUNDANCY_REDUNDANCYSUPPORT), &value) == UA_STATUSCODE_GOOD &&
+        value.type && value.type->memSize == sizeof(UA_Int32) && UA_Variant_isScalar(&value)) {
+        UA_Int32 support = *(UA_Int32*)value.data;
+        printf("  RedundancySupport: %s\n", support >= 0 && support <= 5 ? support_names[support] : "?");
+    }
+    UA_Variant_clear(&value);
+    if (UA_Client_readValueAttribute(unit->client,
+            UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERREDUNDANCY_SERVERURIARRAY), &value) == UA_STATUSCODE_GOOD &&
+        value.type == &UA_TYPES[UA_TYPES_STRING]) {
+        printf("  ServerUriArray:");
+        for (size_t i = 0; i < value.arrayLength; i++) {
+            UA_String* uri = &((UA_String*)value.data)[i];
+            printf(" %.*s", (int)uri->length, (const char*)uri->data);
+        }
+        printf("\n");
+    }
+    UA_Variant_clear(&value);
+}
+
+// Run "cmd url", or ask the operator to do what manual describes
+static void run_step(const char* cmd, const char* url, const char* manual) {
+    if (cmd) {
+        char line[512];
+        snprintf(line, sizeof(line), "%s %s", cmd, url);
+        printf("  $ %s\n", line);
+        if (system(line) != 0) printf("  (command returned an error)\n");
+    } else {
+        printf("  %s, then press Enter\n", manual);
+        getchar();
+    }
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA HOT-STANDBY PAIR CHECK\n");
+    printf("=============================\n");
+    printf("Usage: %s [OPTIONS] URL_A URL_B\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -n, --writes N         Output writes in the replication phase (default: 200)\n");
+    printf("  -k, --kill CMD         Command that stops the active unit (default: ask)\n");
+    printf("  -r, --restart CMD      Command that starts it again (default: ask)\n");
+    printf("  -w, --rejoin MS        Time for the stopped unit to come back (default: 30000)\n");
+    printf("  -t, --timeout MS       Request timeout (default: 2000)\n");
+    printf("  -o, --csv FILE         Also write the results as CSV\n");
+    printf("  -u, --user NAME        Username\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nExamples:\n");
+    printf("  %s opc.tcp://10.0.0.128:4840 opc.tcp://10.0.0.129:4840\n", program_name);
+    printf("  %s -n 500 -o pair.csv opc.tcp://10.0.0.128:4840 opc.tcp://10.0.0.129:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    Unit units[2] = {{"opc.tcp://10.0.0.128:4840", NULL}, {"opc.tcp://10.0.0.129:4840", NULL}};
+    const char* csv_file = NULL;
+    const char* kill_cmd = NULL;
+    const char* restart_cmd = NULL;
+    int writes = 200;
+    int rejoin_ms = 30000;
+    int urls = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--writes") == 0) && i + 1 < argc) {
+            writes = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-k") == 0 || strcmp(argv[i], "--kill") == 0) && i + 1 < argc) {
+            kill_cmd = argv[++i];
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--restart") == 0) && i + 1 < argc) {
+            restart_cmd = argv[++i];
+        } else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--rejoin") == 0) && i + 1 < argc) {
+            rejoin_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = (UA_UInt32)atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else if (urls < 2) {
+            units[urls++].url = argv[i];
+        }
+    }
+    if (writes < 1) writes = 1;
+
+    int failed = 0;
+
+    // Phase 1: pair
+    printf("PAIR\n");
+    int levels[2];
+    for (int i = 0; i < 2; i++) {
+        if (!connect_unit(&units[i])) {
+            printf("Connection to %s failed\n", units[i].url);
+            return 1;
+        }
+        levels[i] = read_service_level(&units[i]);
+        printf("  %s: ServiceLevel %d\n", units[i].url, levels[i]);
+    }
+    int a = levels[0] == SERVICE_LEVEL_ACTIVE ? 0 : 1;
+    Unit* active = &units[a];
+    Unit* standby = &units[1 - a];
+    if (levels[a] != SERVICE_LEVEL_ACTIVE || levels[1 - a] != SERVICE_LEVEL_STANDBY) {
+        printf("FAIL: expected one active (%d) and one standby (%d) server\n",
+               SERVICE_LEVEL_ACTIVE, SERVICE_LEVEL_STANDBY);
+        return 1;
+    }
+    print_redundancy_info(active);
+
+    // Phase 2: replication
+    printf("\nREPLICATION (%d writes on %s)\n", writes, active->url);
+    double* latency_ms = malloc((size_t)writes * sizeof(double));
+    int replicated = 0;
+    UA_UInt16 last_command = 0;
+    for (int i = 0; i < writes; i++) {
+        UA_UInt16 outputs = (UA_UInt16)((i * 37 + 1) & 0xFF);
+        if (outputs == last_command) outputs ^= 0x80;
+        double start = now_ms();
+        UA_StatusCode status = write_outputs(active, outputs);
+        if (status != UA_STATUSCODE_GOOD) {
+            printf("FAIL: write on the active unit: %s\n", UA_StatusCode_name(status));
+            failed = 1;
+            break;
+        }
+        last_command = outputs;
+        double latency = wait_replicated(standby, outputs, start);
+        if (latency >= 0.0) latency_ms[replicated++] = latency;
+    }
+    qsort(latency_ms, replicated, sizeof(double), cmp_double);
+    double p50 = replicated ? latency_ms[replicated / 2] : 0.0;
+    double p99 = replicated ? latency_ms[(replicated * 99) / 100] : 0.0;
+    double max = replicated ? latency_ms[replicated - 1] : 0.0;
+    free(latency_ms);
+    printf("  Replicated %d of %d, latency ms: p50 %.1f, p99 %.1f, max %.1f\n", replicated, writes, p50, p99, max);
+    if (replicated < writes) {
+        printf("FAIL: %d writes did not reach the standby within %d ms\n", writes - replicated,
+               REPLICATION_TIMEOUT_MS);
+        failed = 1;
+    }
+    UA_StatusCode standby_write = write_outputs(standby, (UA_UInt16)(last_command ^ 0x01));
+    printf("  Write on the standby: %s\n", UA_StatusCode_name(standby_write));
+    if (standby_write == UA_STATUSCODE_GOOD) {
+        printf("FAIL: the standby accepted an output write\n");
+        failed = 1;
+    }
+
+    // Phase 3: failover
+    printf("\nFAILOVER (stopping %s)\n", active->url);
+    UA_UInt32 sequence_before = 0, sequence_after = 0, takeover_ms = 0;
+    read_uint32(active, "redundancy.Sequence", &sequence_before);
+    const char* stopped_url = active->url;
+    int stopped = a;
+    disconnect_unit(active);
+    run_step(kill_cmd, stopped_url, "Stop the active unit");
+    double start = now_ms();
+    double takeover = -1.0;
+    while (now_ms() - start < TAKEOVER_TIMEOUT_MS) {
+        if (read_service_level(standby) == SERVICE_LEVEL_ACTIVE) {
+            takeover = now_ms() - start;
+            break;
+        }
+    }
+    UA_UInt16 outputs_after = 0;
+    read_outputs(standby, &outputs_after);
+    read_uint32(standby, "redundancy.Sequence", &sequence_after);
+    read_uint32(standby, "redundancy.TakeoverTime", &takeover_ms);
+    UA_StatusCode new_write = write_outputs(standby, (UA_UInt16)(last_command ^ 0x01));
+    printf("  Active after %.1f ms (observed), TakeoverTime %u ms (gateway)\n", takeover, takeover_ms);
+    printf("  Outputs 0x%04X (last command 0x%04X), sequence %u -> %u, write: %s\n", outputs_after,
+           last_command, sequence_before, sequence_after, UA_StatusCode_name(new_write));
+    if (takeover < 0.0) {
+        printf("FAIL: the standby did not take over within %d ms\n", TAKEOVER_TIMEOUT_MS);
+        failed = 1;
+    }
+    if (outputs_after != last_command) {
+        printf("FAIL: the outputs differ from the last command\n");
+        failed = 1;
+    }
+    if ((UA_Int32)(sequence_after - sequence_before) < 0) {
+        printf("FAIL: the image sequence went back\n");
+        failed = 1;
+    }
+    if (new_write != UA_STATUSCODE_GOOD) {
+        printf("FAIL: the new active unit refused an output write\n");
+        failed = 1;
+    }
+    last_command = (UA_UInt16)(last_command ^ 0x01);
+
+    // Phase 4: rejoin
+    printf("\nREJOIN (starting %s)\n", stopped_url);
+    active = standby;
+    standby = &units[stopped];
+    run_step(restart_cmd, stopped_url, "Start the stopped unit");
+    start = now_ms();
+    int rejoined_level = -1;
+    double rejoin = -1.0;
+    while (now_ms() - start < rejoin_ms) {
+        if (!standby->client && !connect_unit(standby)) continue;
+        rejoined_level = read_service_level(standby);
+        if (rejoined_level == SERVICE_LEVEL_STANDBY) {
+            rejoin = now_ms() - start;
+            break;
+        }
+        if (rejoined_level < 0) disconnect_unit(standby);
+    }
+    int active_level = read_service_level(active);
+    double rejoin_latency = -1.0;
+    if (rejoin >= 0.0) {
+        UA_UInt16 outputs = (UA_UInt16)(last_command ^ 0x02);
+        double t = now_ms();
+        if (write_outputs(active, outputs) == UA_STATUSCODE_GOOD) {
+            rejoin_latency = wait_replicated(standby, outputs, t);
+        }
+    }
+    printf("  Standby after %.1f ms, ServiceLevel %d / %d, replication %.1f ms\n", rejoin,
+           active_level, rejoined_level, rejoin_latency);
+    if (rejoin < 0.0) {
+        printf("FAIL: the restarted unit did not come back as standby within %d ms\n", rejoin_ms);
+        failed = 1;
+    }
+    if (active_level != SERVICE_LEVEL_ACTIVE) {
+        printf("FAIL: the active unit lost its role to the restarted one\n");
+        failed = 1;
+    }
+    if (rejoin >= 0.0 && rejoin_latency < 0.0) {
+        printf("FAIL: no replication to the restarted unit\n");
+        failed = 1;
+    }
+
+    printf("\n%-12s %10s %10s %10s\n", "phase", "p50 ms", "p99 ms", "max ms");
+    printf("%-12s %10.1f %10.1f %10.1f\n", "replication", p50, p99, max);
+    printf("%-12s %10s %10s %10.1f\n", "failover", "", "", takeover);
+    printf("%-12s %10s %10s %10.1f\n", "rejoin", "", "", rejoin);
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+
+    if (csv_file) {
+        FILE* csv = fopen(csv_file, "w");
+        if (csv) {
+            fprintf(csv, "writes,replicated,replication_p50_ms,replication_p99_ms,replication_max_ms,"
+                         "takeover_ms,gateway_takeover_ms,sequence_before,sequence_after,rejoin_ms,result\n");
+            fprintf(csv, "%d,%d,%.1f,%.1f,%.1f,%.1f,%u,%u,%u,%.1f,%s\n", writes, replicated, p50, p99, max,
+                    takeover, takeover_ms, sequence_before, sequence_after, rejoin,
+                    failed ? "FAILED" : "PASSED");
+            fclose(csv);
+        }
+    }
+
+    disconnect_unit(&units[0]);
+    disconnect_unit(&units[1]);
+    return failed;
+}
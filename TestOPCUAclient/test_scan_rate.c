@@ -0,0 +1,319 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Adaptive input scan check with the ScanPolicy object (io_cache/scan_policy).
+// The tool runs four phases of -d seconds and samples scan.* once a second:
+//   idle      no reader: the scan backs off to the slowest interval
+//   subscribe a monitored item on discrete_inputs sampled every -s ms: the
+//             scan keeps up with half the sampling interval
+//   activity  discrete_outputs bit -b toggles every -w ms; the output must be
+//             wired to an input, as for the actuation self-test: the scan runs
+//             at the fastest interval
+//   back-off  no reader, no activity: time until the slowest interval again
+// Each phase reports the interval, the achieved scan rate and the I2C bus
+// load; the bus load must stay within the budget (-B) throughout. Writing the
+// outputs needs a user with write rights (-u/-p) when authentication is on.
+
+#define PHASES      4
+
+typedef struct {
+    const char* name;
+    double interval_sum;
+    double rate_sum;
+    double load_sum;
+    double load_max;
+    int samples;
+    char reason[16];
+} Phase;
+
+static const char* username;
+static const char* password;
+static int subscribed_values;
+
+static double now_ms(void) {
+    return (double)UA_DateTime_nowMonotonic() / UA_DATETIME_MSEC;
+}
+
+static int read_scalar(UA_Client* client, const char* id, const UA_DataType* type, void* out) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, type);
+    if (ok) memcpy(out, value.data, type->memSize);
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static int read_string(UA_Client* client, const char* id, char* out, size_t size) {
+    UA_Variant value;
+    UA_Variant_init(&value);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)id), &value);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&value, &UA_TYPES[UA_TYPES_STRING]);
+    out[0] = '\0';
+    if (ok) {
+        UA_String* s = (UA_String*)value.data;
+        size_t n = s->length < size - 1 ? s->length : size - 1;
+        memcpy(out, s->data, n);
+        out[n] = '\0';
+    }
+    UA_Variant_clear(&value);
+    return ok;
+}
+
+static int write_outputs(UA_Client* client, UA_UInt16 outputs) {
+    UA_Variant value;
+    UA_Variant_setScalar(&value, &outputs, &UA_TYPES[UA_TYPES_UINT16]);
+    return UA_Client_writeValueAttribute(client, UA_NODEID_STRING(1, "discrete_outputs"), &value) ==
+           UA_STATUSCODE_GOOD;
+}
+
+static void on_inputs(UA_Client* client, UA_UInt32 subId, void* subContext, UA_UInt32 monId,
+                      void* monContext, UA_DataValue* value) {
+    subscribed_values++;
+}
+
+// Sample scan.* once; returns the interval or -1 on failure
+static int sample_phase(UA_Client* client, Phase* phase, double t, int verbose) {
+    UA_UInt16 interval = 0, demand = 0, floor_ms = 0;
+    UA_Double rate = 0.0, load = 0.0;
+    char reason[16];
+    if (!read_scalar(client, "scan.IntervalMs", &UA_TYPES[UA_TYPES_UINT16], &interval)) return -1;
+    read_scalar(client, "scan.DemandMs", &UA_TYPES[UA_TYPES_UINT16], &demand);
+    read_scalar(client, "scan.FloorMs", &UA_TYPES[UA_TYPES_UINT16], &floor_ms);
+    read_scalar(client, "scan.ScanRate", &UA_TYPES[UA_TYPES_DOUBLE], &rate);
+    read_scalar(client, "scan.BusLoad", &UA_TYPES[UA_TYPES_DOUBLE], &load);
+    read_string(client, "scan.Reason", reason, sizeof(reason));
+    if (phase) {
+        phase->interval_sum += interval;
+        phase->rate_sum += rate;
+        phase->load_sum += load;
+        if (load > phase->load_max) phase->load_max = load;
+        phase->samples++;
+        snprintf(phase->reason, sizeof(phase->reason), "%s", reason);
+    }
+    if (verbose) {
+        printf("  %6.1f s  %-9s interval %3u ms  demand %4u ms  floor %3u ms  %6.1f scans/s  bus %5.1f %%\n",
+               t / 1000.0, reason, interval, demand, floor_ms, rate, load);
+    }
+    return interval;
+}
+
+static void print_help(const char* program_name) {
+    printf("OPC UA ADAPTIVE INPUT SCAN CHECK\n");
+    printf("================================\n");
+    printf("Usage: %s [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("SERVER_URL defaults to opc.tcp://10.0.0.128:4840.\n\n");
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -d, --duration S       Seconds per phase (default: 5)\n");
+    printf("  -s, --sampling MS      Sampling interval of the subscriber (default: 50)\n");
+    printf("  -b, --bit N            Output bit toggled in the activity phase (default: 0)\n");
+    printf("  -w, --toggle MS        Toggle period of the output (default: 200)\n");
+    printf("  -B, --budget PCT       I2C bus budget of the gateway to check (default: 20)\n");
+    printf("  -v, --verbose          Print every sample\n");
+    printf("  -o, --csv FILE         Also append the results as CSV\n");
+    printf("  -u, --user NAME        Username\n");
+    printf("  -p, --pass PASSWORD    Password\n");
+    printf("\nExamples:\n");
+    printf("  %s -v opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -u engineer -p readwrite456 -s 100 -b 3 -o scan.csv\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_url = "opc.tcp://10.0.0.128:4840";
+    const char* csv_file = NULL;
+    int duration_s = 5;
+    double sampling_ms = 50.0;
+    int bit = 0;
+    int toggle_ms = 200;
+    double budget = 20.0;
+    int verbose = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--duration") == 0) && i + 1 < argc) {
+            duration_s = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sampling") == 0) && i + 1 < argc) {
+            sampling_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--bit") == 0) && i + 1 < argc) {
+            bit = atoi(argv[++i]) & 15;
+        } else if ((strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--toggle") == 0) && i + 1 < argc) {
+            toggle_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-B") == 0 || strcmp(argv[i], "--budget") == 0) && i + 1 < argc) {
+            budget = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+            verbose = 1;
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (duration_s < 2) duration_s = 2;
+    if (toggle_ms < 10) toggle_ms = 10;
+
+    UA_Client* client = UA_Client_new();
+    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, server_url, username, password)
+        : UA_Client_connect(client, server_url);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection to %s failed\n", server_url);
+        UA_Client_delete(client);
+        return 1;
+    }
+
+    UA_Boolean enabled = false;
+    UA_UInt16 cost = 0;
+    read_scalar(client, "scan.Enabled", &UA_TYPES[UA_TYPES_BOOLEAN], &enabled);
+    if (!enabled) {
+        printf("FAIL: adaptive scanning is disabled on %s\n", server_url);
+        UA_Client_disconnect(client);
+        UA_Client_delete(client);
+        return 1;
+    }
+
+    Phase phases[PHASES] = {{"idle"}, {"subscribe"}, {"activity"}, {"back-off"}};
+    UA_UInt16 outputs = 0;
+    read_scalar(client, "discrete_outputs", &UA_TYPES[UA_TYPES_UINT16], &outputs);
+    UA_UInt16 initial_outputs = outputs;
+    double revised_sampling = 0.0;
+    double backoff_ms = -1.0;
+    int idle_interval = 0, active_interval = 0;
+    int failed = 0;
+
+    for (int p = 0; p < PHASES; p++) {
+        Phase* phase = &phases[p];
+        UA_UInt32 sub_id = 0;
+        if (p == 1) {
+            UA_CreateSubscriptionRequest sreq = UA_CreateSubscriptionRequest_default();
+            sreq.requestedPublishingInterval = sampling_ms * 2;
+            UA_CreateSubscriptionResponse sresp = UA_Client_Subscriptions_create(client, sreq, NULL, NULL, NULL);
+            if (sresp.responseHeader.serviceResult == UA_STATUSCODE_GOOD) {
+                sub_id = sresp.subscriptionId;
+                UA_MonitoredItemCreateRequest item =
+                    UA_MonitoredItemCreateRequest_default(UA_NODEID_STRING(1, "discrete_inputs"));
+                item.requestedParameters.samplingInterval = sampling_ms;
+                UA_MonitoredItemCreateResult mresult = UA_Client_MonitoredItems_createDataChange(
+                    client, sub_id, UA_TIMESTAMPSTORETURN_NEITHER, item, NULL, on_inputs, NULL);
+                revised_sampling = mresult.revisedSamplingInterval;
+                if (mresult.statusCode != UA_STATUSCODE_GOOD) sub_id = 0;
+            }
+            if (sub_id == 0) {
+                printf("FAIL: no subscription on discrete_inputs\n");
+                failed = 1;
+                break;
+            }
+        }
+
+        printf("%s\n", phase->name);
+        double start = now_ms();
+        double next_sample = start + 1000.0;
+        double next_toggle = start;
+        while (now_ms() - start < duration_s * 1000.0) {
+            if (p == 2 && now_ms() >= next_toggle) {
+                outputs ^= (UA_UInt16)(1u << bit);
+                if (!write_outputs(client, outputs)) {
+                    printf("FAIL: write of discrete_outputs refused\n");
+                    failed = 1;
+                    break;
+                }
+                next_toggle += toggle_ms;
+            }
+            if (now_ms() >= next_sample) {
+                int interval = sample_phase(client, phase, now_ms() - start, verbose);
+                if (p == 3 && backoff_ms < 0.0 && interval == idle_interval) {
+                    backoff_ms = now_ms() - start;
+                }
+                next_sample += 1000.0;
+            }
+            UA_Client_run_iterate(client, 5);
+        }
+        if (p == 0) {
+            idle_interval = phase->samples ? (int)(phase->interval_sum / phase->samples + 0.5) : 0;
+        } else if (p == 2) {
+            active_interval = phase->samples ? (int)(phase->interval_sum / phase->samples + 0.5) : 0;
+            if (outputs != initial_outputs) write_outputs(client, initial_outputs);
+        }
+        if (sub_id) UA_Client_Subscriptions_deleteSingle(client, sub_id);
+    }
+    read_scalar(client, "scan.ScanCostUs", &UA_TYPES[UA_TYPES_UINT16], &cost);
+
+    printf("\n%-10s %10s %12s %10s %10s %-9s\n", "phase", "interval", "scans/s", "bus %", "bus max %",
+           "reason");
+    for (int p = 0; p < PHASES; p++) {
+        Phase* phase = &phases[p];
+        int n = phase->samples ? phase->samples : 1;
+        printf("%-10s %8.1f ms %12.1f %10.2f %10.2f %-9s\n", phase->name, phase->interval_sum / n,
+               phase->rate_sum / n, phase->load_sum / n, phase->load_max, phase->reason);
+        if (phase->load_max > budget + 1.0) {
+            printf("FAIL: %s: bus load %.1f %% above the budget of %.0f %%\n", phase->name, phase->load_max, budget);
+            failed = 1;
+        }
+    }
+    printf("\nScan cost %u us; a fixed 20 ms scan would load the bus %.2f %%\n", cost, cost * 50 / 10000.0);
+    printf("Subscriber: sampling %.0f ms (revised), %d notifications\n", revised_sampling, subscribed_values);
+    printf("Back-off to %d ms after %.1f s\n", idle_interval, backoff_ms / 1000.0);
+
+    Phase* sub = &phases[1];
+    Phase* act = &phases[2];
+    if (sub->samples && strcmp(sub->reason, "demand") != 0 && strcmp(sub->reason, "budget") != 0) {
+        printf("FAIL: subscriber phase ended with reason %s\n", sub->reason);
+        failed = 1;
+    }
+    if (sub->samples && sub->interval_sum / sub->samples >= idle_interval) {
+        printf("FAIL: the subscriber did not shorten the interval\n");
+        failed = 1;
+    }
+    if (act->samples && (strcmp(act->reason, "activity") != 0 && strcmp(act->reason, "budget") != 0)) {
+        printf("FAIL: activity phase ended with reason %s (is the output wired to an input?)\n", act->reason);
+        failed = 1;
+    }
+    if (active_interval >= idle_interval) {
+        printf("FAIL: input activity did not shorten the interval\n");
+        failed = 1;
+    }
+    if (backoff_ms < 0.0) {
+        printf("FAIL: no back-off to %d ms within %d s\n", idle_interval, duration_s);
+        failed = 1;
+    }
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+
+    if (csv_file) {
+        FILE* check = fopen(csv_file, "r");
+        int header = check == NULL;
+        if (check) fclose(check);
+        FILE* csv = fopen(csv_file, "a");
+        if (csv) {
+            if (header) {
+                fprintf(csv, "server,phase,interval_ms,scans_per_s,bus_pct,bus_max_pct,reason,scan_cost_us,"
+                             "backoff_ms,result\n");
+            }
+            for (int p = 0; p < PHASES; p++) {
+                Phase* phase = &phases[p];
+                int n = phase->samples ? phase->samples : 1;
+                fprintf(csv, "%s,%s,%.1f,%.1f,%.2f,%.2f,%s,%u,%.0f,%s\n", server_url, phase->name,
+                        phase->interval_sum / n, phase->rate_sum / n, phase->load_sum / n, phase->load_max,
+                        phase->reason, cost, backoff_ms, failed ? "FAILED" : "PASSED");
+            }
+            fclose(csv);
+        }
+    }
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    return failed;
+}
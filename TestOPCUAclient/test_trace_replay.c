@@ -0,0 +1,553 @@
+#include <open62541/client.h>
+#include <open62541/client_highlevel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+// I/O trace tool for the gateway trace recorder (components/io_cache/io_trace.c).
+// Actions:
+//   -r         Clear the trace buffer and start recording on the gateway
+//   -d FILE    Stop recording and download the trace to FILE
+//   -s FILE    Print a summary of a trace file (offline)
+//   -l FILE    Upload FILE and replay its inputs on the gateway; meanwhile
+//              Read all tags in a loop and report latency and seen changes
+//   -c FILE    Replay the client writes of FILE against the gateway with the
+//              recorded timing (relay writes go to loopback_input by default)
+// The trace is transferred in chunks through the ByteString node ns=1;s=io_trace
+// using index ranges.
+
+#define CHUNK_SIZE 4096
+
+// Serialized trace layout, must match components/io_cache/io_trace.h
+#define TRACE_MAGIC 0x54363141u
+#define TRACE_VERSION 1
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t count;
+    uint32_t dropped;
+} TraceHeader;
+
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;
+    uint8_t type;
+    uint8_t channel;
+    uint16_t value;
+} TraceRecord;
+
+enum { T_DI = 1, T_DO = 2, T_ADC = 3, T_WRITE_DO = 4, T_WRITE_LOOPBACK = 5, T_TYPES = 6 };
+
+static const char* type_names[T_TYPES] = {
+    "?", "Discrete inputs", "Discrete outputs", "ADC", "Write outputs", "Write loopback"
+};
+
+// Tags read while the gateway replays
+static const char* read_tags[] = {
+    "discrete_inputs", "adc_channel_1", "adc_channel_2", "adc_channel_3", "adc_channel_4", "io_trace_control"
+};
+#define READ_TAGS (int)(sizeof(read_tags) / sizeof(read_tags[0]))
+
+// Monotonic time in microseconds
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_latency(const char* name, double* samples, int count) {
+    if (count == 0) {
+        printf("%-24s no samples\n", name);
+        return;
+    }
+    qsort(samples, count, sizeof(double), cmp_double);
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += samples[i];
+    printf("%-24s %10.3f %10.3f %10.3f %10.3f %8d\n", name, sum / count,
+           samples[count / 2], samples[(int)(count * 0.95)], samples[count - 1], count);
+}
+
+// Load a trace file and check its header
+static TraceRecord* load_file(const char* path, TraceHeader* hdr, size_t* bytes) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        printf("Cannot open %s\n", path);
+        return NULL;
+    }
+    TraceRecord* records = NULL;
+    if (fread(hdr, sizeof(*hdr), 1, f) != 1 || hdr->magic != TRACE_MAGIC ||
+        hdr->version != TRACE_VERSION || hdr->record_size != sizeof(TraceRecord)) {
+        printf("%s is not an I/O trace (version %d)\n", path, TRACE_VERSION);
+    } else {
+        records = calloc(hdr->count ? hdr->count : 1, sizeof(TraceRecord));
+        if (fread(records, sizeof(TraceRecord), hdr->count, f) != hdr->count) {
+            printf("%s is truncated (%u records expected)\n", path, hdr->count);
+            free(records);
+            records = NULL;
+        }
+    }
+    fclose(f);
+    *bytes = sizeof(*hdr) + (size_t)hdr->count * sizeof(TraceRecord);
+    return records;
+}
+
+static UA_StatusCode write_u16(UA_Client* client, const char* tag, UA_UInt16 value) {
+    UA_Variant v;
+    UA_Variant_setScalar(&v, &value, &UA_TYPES[UA_TYPES_UINT16]);
+    return UA_Client_writeValueAttribute(client, UA_NODEID_STRING(1, (char*)tag), &v);
+}
+
+static int read_u16(UA_Client* client, const char* tag, UA_UInt16* value) {
+    UA_Variant v;
+    UA_Variant_init(&v);
+    UA_StatusCode status = UA_Client_readValueAttribute(client, UA_NODEID_STRING(1, (char*)tag), &v);
+    int ok = status == UA_STATUSCODE_GOOD && UA_Variant_hasScalarType(&v, &UA_TYPES[UA_TYPES_UINT16]);
+    if (ok) *value = *(UA_UInt16*)v.data;
+    UA_Variant_clear(&v);
+    return ok;
+}
+
+// Index range string for bytes [offset, offset + len)
+static void format_range(char* buf, size_t size, size_t offset, size_t len) {
+    if (len == 1) snprintf(buf, size, "%zu", offset);
+    else snprintf(buf, size, "%zu:%zu", offset, offset + len - 1);
+}
+
+// Read one chunk of ns=1;s=io_trace; returns bytes received, -1 on error
+static long read_chunk(UA_Client* client, size_t offset, uint8_t* buf, size_t len) {
+    char range[48];
+    format_range(range, sizeof(range), offset, len);
+    UA_ReadValueId id;
+    UA_ReadValueId_init(&id);
+    id.nodeId = UA_NODEID_STRING(1, "io_trace");
+    id.attributeId = UA_ATTRIBUTEID_VALUE;
+    id.indexRange = UA_STRING(range);
+    UA_ReadRequest req;
+    UA_ReadRequest_init(&req);
+    req.nodesToRead = &id;
+    req.nodesToReadSize = 1;
+    UA_ReadResponse resp = UA_Client_Service_read(client, req);
+    long got = -1;
+    if (resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD && resp.resultsSize == 1) {
+        UA_DataValue* dv = &resp.results[0];
+        if (dv->hasStatus && dv->status == UA_STATUSCODE_BADINDEXRANGENODATA) {
+            got = 0;
+        } else if (dv->hasValue && UA_Variant_hasScalarType(&dv->value, &UA_TYPES[UA_TYPES_BYTESTRING])) {
+            UA_ByteString* bs = (UA_ByteString*)dv->value.data;
+            got = (long)(bs->length < len ? bs->length : len);
+            memcpy(buf, bs->data, (size_t)got);
+        }
+    }
+    UA_ReadResponse_clear(&resp);
+    return got;
+}
+
+// Write one chunk of ns=1;s=io_trace
+static UA_StatusCode write_chunk(UA_Client* client, size_t offset, const uint8_t* data, size_t len) {
+    char range[48];
+    format_range(range, sizeof(range), offset, len);
+    UA_ByteString bs = { len, (UA_Byte*)data };
+    UA_WriteValue wv;
+    UA_WriteValue_init(&wv);
+    wv.nodeId = UA_NODEID_STRING(1, "io_trace");
+    wv.attributeId = UA_ATTRIBUTEID_VALUE;
+    wv.indexRange = UA_STRING(range);
+    wv.value.hasValue = true;
+    UA_Variant_setScalar(&wv.value.value, &bs, &UA_TYPES[UA_TYPES_BYTESTRING]);
+    UA_WriteRequest req;
+    UA_WriteRequest_init(&req);
+    req.nodesToWrite = &wv;
+    req.nodesToWriteSize = 1;
+    UA_WriteResponse resp = UA_Client_Service_write(client, req);
+    UA_StatusCode status = resp.responseHeader.serviceResult;
+    if (status == UA_STATUSCODE_GOOD && resp.resultsSize == 1) status = resp.results[0];
+    UA_WriteResponse_clear(&resp);
+    return status;
+}
+
+// ========== SUMMARY ==========
+static void print_summary(const TraceHeader* hdr, const TraceRecord* rec) {
+    uint32_t per_type[T_TYPES] = {0};
+    uint32_t di_toggles[16] = {0};
+    uint32_t adc_changes[4] = {0};
+    uint16_t adc_min[4], adc_max[4];
+    uint32_t min_gap = UINT32_MAX, burst = 0, max_burst = 0;
+    int have_di = 0;
+    uint16_t di = 0;
+
+    for (int c = 0; c < 4; c++) { adc_min[c] = UINT16_MAX; adc_max[c] = 0; }
+
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        const TraceRecord* r = &rec[i];
+        per_type[r->type < T_TYPES ? r->type : 0]++;
+        if (r->type == T_DI) {
+            if (have_di) {
+                uint16_t diff = di ^ r->value;
+                for (int b = 0; b < 16; b++) if (diff & (1u << b)) di_toggles[b]++;
+            }
+            di = r->value;
+            have_di = 1;
+        } else if (r->type == T_ADC && r->channel < 4) {
+            adc_changes[r->channel]++;
+            if (r->value < adc_min[r->channel]) adc_min[r->channel] = r->value;
+            if (r->value > adc_max[r->channel]) adc_max[r->channel] = r->value;
+        }
+        // Records within the same millisecond form a burst
+        if (i > 0) {
+            uint32_t gap = r->time_ms - rec[i - 1].time_ms;
+            if (gap < min_gap) min_gap = gap;
+            burst = gap == 0 ? burst + 1 : 1;
+        } else {
+            burst = 1;
+        }
+        if (burst > max_burst) max_burst = burst;
+    }
+
+    double span_s = hdr->count > 1 ? (rec[hdr->count - 1].time_ms - rec[0].time_ms) / 1000.0 : 0.0;
+    printf("Records:        %u (%u older records were overwritten)\n", hdr->count, hdr->dropped);
+    if (hdr->count > 0) {
+        printf("Time span:      %.3f s (%u .. %u ms)\n", span_s, rec[0].time_ms, rec[hdr->count - 1].time_ms);
+    }
+    if (span_s > 0) {
+        printf("Average rate:   %.1f records/s, shortest gap %u ms, largest burst %u records/ms\n",
+               hdr->count / span_s, min_gap, max_burst);
+    }
+
+    printf("\n%-20s %10s %12s\n", "Type", "Records", "Per second");
+    for (int t = 1; t < T_TYPES; t++) {
+        printf("%-20s %10u %12.2f\n", type_names[t], per_type[t], span_s > 0 ? per_type[t] / span_s : 0.0);
+    }
+    if (per_type[0]) printf("%-20s %10u\n", "Unknown", per_type[0]);
+
+    printf("\nDiscrete input toggles per bit:\n ");
+    for (int b = 0; b < 16; b++) printf(" %2d:%-5u", b + 1, di_toggles[b]);
+    printf("\n\n%-8s %10s %8s %8s\n", "ADC", "Changes", "Min", "Max");
+    for (int c = 0; c < 4; c++) {
+        if (adc_changes[c]) printf("ADC%-5d %10u %8u %8u\n", c + 1, adc_changes[c], adc_min[c], adc_max[c]);
+        else printf("ADC%-5d %10u %8s %8s\n", c + 1, 0u, "-", "-");
+    }
+}
+
+// ========== DEVICE REPLAY (inputs) ==========
+static int replay_on_gateway(UA_Client* client, const uint8_t* image, size_t bytes,
+                             uint16_t speed, uint32_t span_ms) {
+    // The buffer can only be loaded while the recorder is idle
+    if (write_u16(client, "io_trace_control", 0) != UA_STATUSCODE_GOOD) {
+        printf("Cannot stop the recorder (engineer or admin login required)\n");
+        return 1;
+    }
+
+    double t0 = now_us();
+    for (size_t off = 0; off < bytes; off += CHUNK_SIZE) {
+        size_t len = bytes - off < CHUNK_SIZE ? bytes - off : CHUNK_SIZE;
+        UA_StatusCode status = write_chunk(client, off, image + off, len);
+        if (status != UA_STATUSCODE_GOOD) {
+            printf("Upload failed at byte %zu: %s\n", off, UA_StatusCode_name(status));
+            return 1;
+        }
+    }
+    double upload_ms = (now_us() - t0) / 1000.0;
+    printf("Uploaded %zu bytes in %.2f ms (%.1f KB/s)\n", bytes, upload_ms,
+           upload_ms > 0 ? bytes / upload_ms : 0.0);
+
+    write_u16(client, "io_trace_speed", speed);
+    UA_StatusCode status = write_u16(client, "io_trace_control", 2);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Replay start failed: %s\n", UA_StatusCode_name(status));
+        return 1;
+    }
+    printf("Replay started at %u%% (expected %.1f s)\n\n", speed,
+           speed ? span_ms / 10.0 / speed : 0.0);
+
+    // Read all input tags until the replay has finished
+    UA_ReadValueId ids[READ_TAGS];
+    for (int i = 0; i < READ_TAGS; i++) {
+        UA_ReadValueId_init(&ids[i]);
+        ids[i].nodeId = UA_NODEID_STRING(1, (char*)read_tags[i]);
+        ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    UA_ReadRequest req;
+    UA_ReadRequest_init(&req);
+    req.nodesToRead = ids;
+    req.nodesToReadSize = READ_TAGS;
+
+    int capacity = 100000, count = 0, errors = 0;
+    double* samples = calloc(capacity, sizeof(double));
+    uint32_t changes[READ_TAGS - 1] = {0};
+    uint16_t last[READ_TAGS - 1] = {0};
+    int first = 1;
+    double start = now_us();
+
+    for (;;) {
+        double t = now_us();
+        UA_ReadResponse resp = UA_Client_Service_read(client, req);
+        double dt = now_us() - t;
+        int done = 0;
+        if (resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD && resp.resultsSize == READ_TAGS) {
+            if (count < capacity) samples[count++] = dt / 1000.0;
+            for (int i = 0; i < READ_TAGS; i++) {
+                UA_DataValue* dv = &resp.results[i];
+                if (!dv->hasValue || !UA_Variant_hasScalarType(&dv->value, &UA_TYPES[UA_TYPES_UINT16])) continue;
+                uint16_t v = *(UA_UInt16*)dv->value.data;
+                if (i == READ_TAGS - 1) {
+                    done = v != 2;
+                } else {
+                    if (!first && v != last[i]) changes[i]++;
+                    last[i] = v;
+                }
+            }
+            first = 0;
+        } else {
+            errors++;
+        }
+        UA_ReadResponse_clear(&resp);
+        if (done || errors > 100) break;
+        usleep(5000);
+    }
+    double elapsed_s = (now_us() - start) / 1e6;
+
+    printf("Replay finished after %.2f s\n\n", elapsed_s);
+    printf("%-24s %10s %10s %10s %10s %8s\n", "Read during replay", "avg ms", "p50 ms", "p95 ms", "max ms", "reads");
+    print_latency("6 tags / request", samples, count);
+    printf("Read errors: %d\n\n", errors);
+    printf("Changes seen by polling (every ~5 ms):\n");
+    for (int i = 0; i < READ_TAGS - 1; i++) {
+        printf("  %-18s %8u\n", read_tags[i], changes[i]);
+    }
+    free(samples);
+    return 0;
+}
+
+// ========== CLIENT WRITE REPLAY ==========
+static int replay_client_writes(UA_Client* client, const TraceHeader* hdr, const TraceRecord* rec,
+                                uint16_t speed, int real_outputs) {
+    int total = 0;
+    uint32_t base_ms = 0;
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        if (rec[i].type != T_WRITE_DO && rec[i].type != T_WRITE_LOOPBACK) continue;
+        if (total++ == 0) base_ms = rec[i].time_ms;
+    }
+    if (total == 0) {
+        printf("The trace holds no client writes\n");
+        return 0;
+    }
+    printf("Replaying %d writes at %u%%, relay writes go to %s\n\n", total, speed,
+           real_outputs ? "discrete_outputs (RELAYS SWITCH)" : "loopback_input");
+
+    double* latency = calloc(total, sizeof(double));
+    double max_late_ms = 0.0;
+    int count = 0, errors = 0;
+    double start = now_us();
+
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        const TraceRecord* r = &rec[i];
+        if (r->type != T_WRITE_DO && r->type != T_WRITE_LOOPBACK) continue;
+
+        if (speed > 0) {
+            double due = start + (double)(r->time_ms - base_ms) * 1000.0 * 100.0 / speed;
+            double wait = due - now_us();
+            if (wait > 0) usleep((useconds_t)wait);
+            double late = (now_us() - due) / 1000.0;
+            if (late > max_late_ms) max_late_ms = late;
+        }
+
+        const char* tag = (r->type == T_WRITE_DO && real_outputs) ? "discrete_outputs" : "loopback_input";
+        double t = now_us();
+        UA_StatusCode status = write_u16(client, tag, r->value);
+        if (status == UA_STATUSCODE_GOOD) latency[count++] = (now_us() - t) / 1000.0;
+        else errors++;
+    }
+    double elapsed_s = (now_us() - start) / 1e6;
+
+    printf("%-24s %10s %10s %10s %10s %8s\n", "Write", "avg ms", "p50 ms", "p95 ms", "max ms", "writes");
+    print_latency("Replayed writes", latency, count);
+    printf("\nElapsed %.2f s (%.1f writes/s), %d errors, max %.2f ms behind schedule\n",
+           elapsed_s, elapsed_s > 0 ? count / elapsed_s : 0.0, errors, max_late_ms);
+    free(latency);
+    return errors ? 1 : 0;
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("I/O TRACE RECORD / REPLAY TOOL\n");
+    printf("=============================================\n");
+    printf("Usage: %s ACTION [OPTIONS] [SERVER_URL]\n\n", program_name);
+    printf("Actions:\n");
+    printf("  -r, --record         Clear the gateway trace and start recording\n");
+    printf("  -d, --download FILE  Stop recording and save the trace to FILE\n");
+    printf("  -s, --summary FILE   Print statistics of a trace file (no server needed)\n");
+    printf("  -l, --load FILE      Upload FILE and replay its inputs on the gateway\n");
+    printf("  -c, --clients FILE   Replay the client writes of FILE against the gateway\n");
+    printf("\nOptions:\n");
+    printf("  -h, --help           Show this help message\n");
+    printf("  -x, --speed PERCENT  Replay speed, 100 = recorded timing, 0 = flat out (default: 100)\n");
+    printf("  -o, --outputs        With -c: write relay commands to discrete_outputs\n");
+    printf("                       (default: loopback_input, no relay switches)\n");
+    printf("  -u, --user NAME      Username\n");
+    printf("  -p, --pass PASSWORD  Password\n");
+    printf("\nExample:\n");
+    printf("  %s -d shift.trace -u engineer -p readwrite456 opc.tcp://10.0.0.128:4840\n", program_name);
+    printf("  %s -l shift.trace -x 1000 -u engineer -p readwrite456 opc.tcp://10.0.0.128:4840\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    // Default values
+    char* server_url = "opc.tcp://10.0.0.128:4840";
+    char action = 0;
+    const char* file = NULL;
+    int speed = 100;
+    int real_outputs = 0;
+    const char* username = NULL;
+    const char* password = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--record") == 0) {
+            action = 'r';
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--download") == 0) && i + 1 < argc) {
+            action = 'd';
+            file = argv[++i];
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--summary") == 0) && i + 1 < argc) {
+            action = 's';
+            file = argv[++i];
+        } else if ((strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--load") == 0) && i + 1 < argc) {
+            action = 'l';
+            file = argv[++i];
+        } else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--clients") == 0) && i + 1 < argc) {
+            action = 'c';
+            file = argv[++i];
+        } else if ((strcmp(argv[i], "-x") == 0 || strcmp(argv[i], "--speed") == 0) && i + 1 < argc) {
+            speed = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--outputs") == 0) {
+            real_outputs = 1;
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            password = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        } else {
+            server_url = argv[i];
+        }
+    }
+    if (action == 0) {
+        printf("No action given, use %s -h for help\n", argv[0]);
+        return 1;
+    }
+    if (speed < 0) speed = 0;
+    if (speed > 65535) speed = 65535;
+
+    printf("=============================================\n");
+    printf("   I/O TRACE RECORD / REPLAY\n");
+    if (action != 's') printf("   Server: %s\n", server_url);
+    if (file) printf("   File: %s\n", file);
+    printf("=============================================\n\n");
+
+    // Files are checked before connecting
+    TraceHeader hdr;
+    TraceRecord* records = NULL;
+    size_t bytes = 0;
+    if (action == 's' || action == 'l' || action == 'c') {
+        records = load_file(file, &hdr, &bytes);
+        if (!records) return 1;
+        if (action == 's') {
+            print_summary(&hdr, records);
+            free(records);
+            printf("\n=== TEST COMPLETED ===\n");
+            return 0;
+        }
+    }
+
+    UA_Client* client = UA_Client_new();
+    UA_StatusCode status = (username && password)
+        ? UA_Client_connectUsername(client, server_url, username, password)
+        : UA_Client_connect(client, server_url);
+    if (status != UA_STATUSCODE_GOOD) {
+        printf("Connection failed: %s\n", UA_StatusCode_name(status));
+        UA_Client_delete(client);
+        free(records);
+        return 1;
+    }
+
+    int result = 0;
+    if (action == 'r') {
+        status = write_u16(client, "io_trace_control", 1);
+        printf("Start recording: %s\n", UA_StatusCode_name(status));
+        result = status != UA_STATUSCODE_GOOD;
+    } else if (action == 'd') {
+        // Stop first so the chunks belong to one consistent trace
+        UA_UInt16 state = 0;
+        read_u16(client, "io_trace_control", &state);
+        if (state == 1 && write_u16(client, "io_trace_control", 0) != UA_STATUSCODE_GOOD) {
+            printf("Cannot stop the recorder, the dump may be inconsistent\n");
+        }
+        size_t cap = CHUNK_SIZE, size = 0;
+        uint8_t* image = malloc(cap);
+        double t0 = now_us();
+        for (;;) {
+            if (size + CHUNK_SIZE > cap) image = realloc(image, cap *= 2);
+            long got = read_chunk(client, size, image + size, CHUNK_SIZE);
+            if (got < 0) {
+                printf("Read failed at byte %zu\n", size);
+                result = 1;
+                break;
+            }
+            size += (size_t)got;
+            if (got < CHUNK_SIZE) break;
+        }
+        double ms = (now_us() - t0) / 1000.0;
+        TraceHeader* h = (TraceHeader*)image;
+        if (result == 0 && (size < sizeof(TraceHeader) || h->magic != TRACE_MAGIC ||
+                            size != sizeof(TraceHeader) + (size_t)h->count * sizeof(TraceRecord))) {
+            printf("Invalid trace received (%zu bytes)\n", size);
+            result = 1;
+        }
+        if (result == 0) {
+            FILE* f = fopen(file, "wb");
+            if (!f || fwrite(image, 1, size, f) != size) {
+                printf("Cannot write %s\n", file);
+                result = 1;
+            } else {
+                printf("Downloaded %u records (%zu bytes) in %.2f ms (%.1f KB/s)\n\n",
+                       h->count, size, ms, ms > 0 ? size / ms : 0.0);
+                print_summary(h, (TraceRecord*)(image + sizeof(TraceHeader)));
+            }
+            if (f) fclose(f);
+        }
+        printf("\nRecorder left stopped, use -r to record again\n");
+        free(image);
+    } else if (action == 'l') {
+        uint8_t* image = malloc(bytes);
+        memcpy(image, &hdr, sizeof(hdr));
+        memcpy(image + sizeof(hdr), records, bytes - sizeof(hdr));
+        uint32_t span = hdr.count ? records[hdr.count - 1].time_ms - records[0].time_ms : 0;
+        result = replay_on_gateway(client, image, bytes, (uint16_t)speed, span);
+        free(image);
+    } else if (action == 'c') {
+        result = replay_client_writes(client, &hdr, records, (uint16_t)speed, real_outputs);
+    }
+
+    UA_Client_disconnect(client);
+    UA_Client_delete(client);
+    free(records);
+    printf("\n=== TEST COMPLETED ===\n");
+    return result;
+}
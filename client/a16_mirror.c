@@ -0,0 +1,808 @@
+/* a16_mirror.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "a16_mirror.h"
+
+#include <open62541/client.h>
+#include <open62541/client_config_default.h>
+#include <open62541/client_highlevel.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ============================================================================
+ * CONSTANTS
+ * ============================================================================ */
+
+#define A16_POLL_MS             5       /**< Network wait per loop iteration (write latency bound) */
+#define A16_REQUEST_TIMEOUT_MS  2000    /**< Connect and service timeout */
+#define A16_BACKOFF_MIN_MS      1000    /**< First reconnect delay */
+#define A16_BACKOFF_MAX_MS      30000   /**< Largest reconnect delay */
+#define A16_KEEPALIVE_MS        1000    /**< Target keep-alive period of the subscription */
+#define A16_LIFETIME_MS         60000   /**< Target lifetime of an orphaned subscription */
+#define A16_PUBLISH_REQUESTS    2       /**< Outstanding PublishRequests */
+#define A16_MAX_ACKS            8       /**< Acknowledgements carried by one PublishRequest */
+#define A16_WRITES_IN_FLIGHT    8       /**< WriteRequests awaiting a response */
+
+/* ============================================================================
+ * TYPES
+ * ============================================================================ */
+
+/** @brief One WriteRequest awaiting its response */
+typedef struct {
+    UA_UInt32 request_id;
+    uint32_t mask;                      /**< Tags in the request (0 = slot free) */
+    uint16_t value[A16_TAG_COUNT];
+} write_slot_t;
+
+struct a16_mirror {
+    /* Configuration (strings owned) */
+    a16_mirror_config_t config;
+    char *url;
+    char *username;
+    char *password;
+
+    pthread_t thread;
+    atomic_bool running;
+
+    /* Published image: sequence counter is odd while an update is in progress */
+    atomic_uint seq;
+    _Atomic uint16_t value[A16_TAG_COUNT];
+    _Atomic int64_t source_time[A16_TAG_COUNT];
+    atomic_uint valid_mask;
+    atomic_uint updates;
+    atomic_bool connected;
+
+    /* Working copy, mirror thread only */
+    a16_image_t work;
+
+    /* Pending writes and statistics, protected by lock */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t pending_mask;
+    uint16_t pending_value[A16_TAG_COUNT];
+    double pending_since;
+    write_slot_t in_flight[A16_WRITES_IN_FLIGHT];
+    uint32_t in_flight_count;
+    a16_mirror_stats_t stats;
+
+    /* Session state, mirror thread only */
+    UA_Client *client;
+    bool session_up;
+    UA_UInt32 sub_id;
+    bool resubscribe;
+    double publishing_interval;
+    UA_UInt32 publish_ids[A16_PUBLISH_REQUESTS];
+    UA_SubscriptionAcknowledgement acks[A16_MAX_ACKS];
+    size_t ack_count;
+    double next_connect;
+    double backoff;
+};
+
+static const char *const tag_names[A16_TAG_COUNT] = {
+    "diagnostic_counter", "loopback_input", "loopback_output",
+    "discrete_inputs", "discrete_outputs",
+    "adc_channel_1", "adc_channel_2", "adc_channel_3", "adc_channel_4"
+};
+
+#define ALL_TAGS_MASK   ((1u << A16_TAG_COUNT) - 1)
+
+/* ============================================================================
+ * HELPERS
+ * ============================================================================ */
+
+/**
+ * @brief Monotonic time in milliseconds
+ */
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Absolute CLOCK_REALTIME deadline for pthread_cond_timedwait
+ */
+static struct timespec deadline_after(uint32_t timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static char *dup_string(const char *s) {
+    return s ? strdup(s) : NULL;
+}
+
+/**
+ * @brief Status codes after which a write may be sent again unchanged
+ */
+static bool is_transport_error(UA_StatusCode status) {
+    return status == UA_STATUSCODE_BADTIMEOUT ||
+           status == UA_STATUSCODE_BADCONNECTIONCLOSED ||
+           status == UA_STATUSCODE_BADSERVERNOTCONNECTED ||
+           status == UA_STATUSCODE_BADSECURECHANNELCLOSED ||
+           status == UA_STATUSCODE_BADSECURECHANNELIDINVALID ||
+           status == UA_STATUSCODE_BADSESSIONCLOSED ||
+           status == UA_STATUSCODE_BADSESSIONIDINVALID;
+}
+
+/* ============================================================================
+ * IMAGE
+ * ============================================================================ */
+
+/**
+ * @brief Publish the working copy to readers and run the change callback
+ *
+ * @param changed Bit per tag that changed
+ * @param connection_changed true if only the connected flag changed
+ */
+static void commit_image(a16_mirror_t *m, uint32_t changed, bool connection_changed) {
+    unsigned s = atomic_load_explicit(&m->seq, memory_order_relaxed);
+    atomic_store_explicit(&m->seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (int i = 0; i < A16_TAG_COUNT; i++) {
+        atomic_store_explicit(&m->value[i], m->work.value[i], memory_order_relaxed);
+        atomic_store_explicit(&m->source_time[i], m->work.source_time[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&m->valid_mask, m->work.valid_mask, memory_order_relaxed);
+    atomic_store_explicit(&m->updates, m->work.updates, memory_order_relaxed);
+    atomic_store_explicit(&m->connected, m->work.connected, memory_order_relaxed);
+
+    atomic_store_explicit(&m->seq, s + 2, memory_order_release);
+
+    if ((changed || connection_changed) && m->config.on_change) {
+        m->config.on_change(&m->work, changed, m->config.context);
+    }
+
+    /* Wake a16_mirror_wait_ready() */
+    pthread_mutex_lock(&m->lock);
+    pthread_cond_broadcast(&m->cond);
+    pthread_mutex_unlock(&m->lock);
+}
+
+/**
+ * @brief Apply one received DataValue to the working copy
+ *
+ * @return Bit of the tag if value or validity changed, otherwise 0
+ */
+static uint32_t apply_value(a16_mirror_t *m, UA_UInt32 tag, const UA_DataValue *dv) {
+    if (tag >= A16_TAG_COUNT) return 0;
+    uint32_t bit = 1u << tag;
+    bool good = dv->hasValue && (!dv->hasStatus || dv->status == UA_STATUSCODE_GOOD) &&
+                UA_Variant_hasScalarType(&dv->value, &UA_TYPES[UA_TYPES_UINT16]);
+    uint16_t value = good ? *(const UA_UInt16 *)dv->value.data : m->work.value[tag];
+    bool was_good = (m->work.valid_mask & bit) != 0;
+
+    m->work.source_time[tag] = dv->hasSourceTimestamp ? dv->sourceTimestamp
+                             : dv->hasServerTimestamp ? dv->serverTimestamp : UA_DateTime_now();
+    if (good) m->work.valid_mask |= bit;
+    else m->work.valid_mask &= ~bit;
+
+    if (good == was_good && value == m->work.value[tag]) return 0;
+    m->work.value[tag] = value;
+    return bit;
+}
+
+/**
+ * @brief Update the connected flag of the image
+ */
+static void set_connected(a16_mirror_t *m, bool connected) {
+    if (m->work.connected == connected) return;
+    m->work.connected = connected;
+    commit_image(m, 0, true);
+}
+
+/* ============================================================================
+ * SUBSCRIPTION
+ * ============================================================================ */
+
+static void send_publish(a16_mirror_t *m, int slot);
+
+/**
+ * @brief PublishResponse handler: apply data changes and keep the slot busy
+ */
+static void publish_callback(UA_Client *client, void *userdata, UA_UInt32 request_id,
+                             void *response) {
+    a16_mirror_t *m = (a16_mirror_t *)userdata;
+    UA_PublishResponse *resp = (UA_PublishResponse *)response;
+
+    /* Responses to requests of an earlier connection are ignored */
+    int slot = -1;
+    for (int i = 0; i < A16_PUBLISH_REQUESTS; i++) {
+        if (m->publish_ids[i] == request_id) slot = i;
+    }
+    if (slot < 0) return;
+    m->publish_ids[slot] = 0;
+
+    UA_StatusCode status = resp->responseHeader.serviceResult;
+    if (status != UA_STATUSCODE_GOOD) {
+        pthread_mutex_lock(&m->lock);
+        m->stats.publish_errors++;
+        pthread_mutex_unlock(&m->lock);
+        if (status == UA_STATUSCODE_BADNOSUBSCRIPTION ||
+            status == UA_STATUSCODE_BADSUBSCRIPTIONIDINVALID) {
+            m->resubscribe = true;
+        } else if (status != UA_STATUSCODE_BADTOOMANYPUBLISHREQUESTS &&
+                   m->session_up && !m->resubscribe) {
+            send_publish(m, slot);
+        }
+        return;
+    }
+
+    if (resp->subscriptionId != m->sub_id) return;
+
+    /* Data changes of one response become visible together */
+    UA_NotificationMessage *msg = &resp->notificationMessage;
+    uint32_t changed = 0;
+    bool data = false;
+    for (size_t i = 0; i < msg->notificationDataSize; i++) {
+        UA_ExtensionObject *eo = &msg->notificationData[i];
+        if (eo->encoding < UA_EXTENSIONOBJECT_DECODED ||
+            eo->content.decoded.type != &UA_TYPES[UA_TYPES_DATACHANGENOTIFICATION]) {
+            continue;
+        }
+        UA_DataChangeNotification *dcn = (UA_DataChangeNotification *)eo->content.decoded.data;
+        for (size_t j = 0; j < dcn->monitoredItemsSize; j++) {
+            changed |= apply_value(m, dcn->monitoredItems[j].clientHandle,
+                                   &dcn->monitoredItems[j].value);
+        }
+        data = true;
+    }
+
+    if (msg->notificationDataSize > 0) {
+        if (m->ack_count < A16_MAX_ACKS) {
+            m->acks[m->ack_count].subscriptionId = m->sub_id;
+            m->acks[m->ack_count].sequenceNumber = msg->sequenceNumber;
+            m->ack_count++;
+        }
+    }
+
+    if (data) {
+        m->work.updates++;
+        commit_image(m, changed, false);
+    }
+
+    pthread_mutex_lock(&m->lock);
+    if (data) m->stats.updates++;
+    else m->stats.keepalives++;
+    pthread_mutex_unlock(&m->lock);
+
+    send_publish(m, slot);
+}
+
+/**
+ * @brief Send a PublishRequest for a free slot (carries pending acknowledgements)
+ */
+static void send_publish(a16_mirror_t *m, int slot) {
+    UA_PublishRequest req;
+    UA_PublishRequest_init(&req);
+    req.requestHeader.timeoutHint = (UA_UInt32)(A16_KEEPALIVE_MS * 3);
+    req.subscriptionAcknowledgements = m->acks;
+    req.subscriptionAcknowledgementsSize = m->ack_count;
+
+    UA_UInt32 request_id = 0;
+    UA_StatusCode rc = __UA_Client_AsyncServiceEx(m->client, &req, &UA_TYPES[UA_TYPES_PUBLISHREQUEST],
+                                                  publish_callback, &UA_TYPES[UA_TYPES_PUBLISHRESPONSE],
+                                                  m, &request_id,
+                                                  (UA_UInt32)(A16_KEEPALIVE_MS * 3 + A16_REQUEST_TIMEOUT_MS));
+    if (rc == UA_STATUSCODE_GOOD) {
+        m->publish_ids[slot] = request_id;
+        m->ack_count = 0;
+    }
+}
+
+/**
+ * @brief Keep A16_PUBLISH_REQUESTS requests outstanding
+ */
+static void fill_publish(a16_mirror_t *m) {
+    if (!m->sub_id || m->resubscribe) return;
+    for (int i = 0; i < A16_PUBLISH_REQUESTS; i++) {
+        if (m->publish_ids[i] == 0) send_publish(m, i);
+    }
+}
+
+/**
+ * @brief Create the subscription and one MonitoredItem per tag
+ *
+ * The initial values arrive with the first PublishResponse.
+ */
+static int create_subscription(a16_mirror_t *m) {
+    UA_CreateSubscriptionRequest sreq;
+    UA_CreateSubscriptionRequest_init(&sreq);
+    sreq.requestedPublishingInterval = m->publishing_interval;
+    sreq.requestedMaxKeepAliveCount = (UA_UInt32)(A16_KEEPALIVE_MS / m->publishing_interval);
+    if (sreq.requestedMaxKeepAliveCount < 1) sreq.requestedMaxKeepAliveCount = 1;
+    sreq.requestedLifetimeCount = (UA_UInt32)(A16_LIFETIME_MS / m->publishing_interval);
+    if (sreq.requestedLifetimeCount < 3 * sreq.requestedMaxKeepAliveCount) {
+        sreq.requestedLifetimeCount = 3 * sreq.requestedMaxKeepAliveCount;
+    }
+    sreq.publishingEnabled = true;
+
+    UA_CreateSubscriptionResponse sresp;
+    __UA_Client_Service(m->client, &sreq, &UA_TYPES[UA_TYPES_CREATESUBSCRIPTIONREQUEST],
+                        &sresp, &UA_TYPES[UA_TYPES_CREATESUBSCRIPTIONRESPONSE]);
+    UA_StatusCode rc = sresp.responseHeader.serviceResult;
+    UA_UInt32 sub_id = sresp.subscriptionId;
+    UA_CreateSubscriptionResponse_clear(&sresp);
+    if (rc != UA_STATUSCODE_GOOD) return -1;
+
+    UA_MonitoredItemCreateRequest items[A16_TAG_COUNT];
+    double sampling = m->config.sampling_interval_ms > 0 ? m->config.sampling_interval_ms
+                                                         : m->publishing_interval / 2;
+    for (int i = 0; i < A16_TAG_COUNT; i++) {
+        UA_MonitoredItemCreateRequest_init(&items[i]);
+        items[i].itemToMonitor.nodeId = UA_NODEID_STRING(1, (char *)tag_names[i]);
+        items[i].itemToMonitor.attributeId = UA_ATTRIBUTEID_VALUE;
+        items[i].monitoringMode = UA_MONITORINGMODE_REPORTING;
+        items[i].requestedParameters.clientHandle = (UA_UInt32)i;
+        items[i].requestedParameters.samplingInterval = sampling;
+        items[i].requestedParameters.queueSize = 1;
+        items[i].requestedParameters.discardOldest = true;
+    }
+
+    UA_CreateMonitoredItemsRequest mreq;
+    UA_CreateMonitoredItemsRequest_init(&mreq);
+    mreq.subscriptionId = sub_id;
+    mreq.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    mreq.itemsToCreate = items;
+    mreq.itemsToCreateSize = A16_TAG_COUNT;
+
+    UA_CreateMonitoredItemsResponse mresp;
+    __UA_Client_Service(m->client, &mreq, &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSREQUEST],
+                        &mresp, &UA_TYPES[UA_TYPES_CREATEMONITOREDITEMSRESPONSE]);
+    rc = mresp.responseHeader.serviceResult;
+    UA_CreateMonitoredItemsResponse_clear(&mresp);
+    if (rc != UA_STATUSCODE_GOOD) return -1;
+
+    m->sub_id = sub_id;
+    m->resubscribe = false;
+    m->ack_count = 0;
+    pthread_mutex_lock(&m->lock);
+    m->stats.subscribes++;
+    pthread_mutex_unlock(&m->lock);
+    return 0;
+}
+
+/**
+ * @brief Read all tags once and apply them (resync after a transfer)
+ */
+static void resync_image(a16_mirror_t *m) {
+    UA_ReadValueId ids[A16_TAG_COUNT];
+    for (int i = 0; i < A16_TAG_COUNT; i++) {
+        UA_ReadValueId_init(&ids[i]);
+        ids[i].nodeId = UA_NODEID_STRING(1, (char *)tag_names[i]);
+        ids[i].attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+    UA_ReadRequest req;
+    UA_ReadRequest_init(&req);
+    req.nodesToRead = ids;
+    req.nodesToReadSize = A16_TAG_COUNT;
+    req.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+
+    UA_ReadResponse resp = UA_Client_Service_read(m->client, req);
+    if (resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD &&
+        resp.resultsSize == A16_TAG_COUNT) {
+        uint32_t changed = 0;
+        for (int i = 0; i < A16_TAG_COUNT; i++) {
+            changed |= apply_value(m, (UA_UInt32)i, &resp.results[i]);
+        }
+        m->work.updates++;
+        commit_image(m, changed, false);
+    }
+    UA_ReadResponse_clear(&resp);
+}
+
+/**
+ * @brief Take over the subscription of the previous session
+ *
+ * On the re-activated old session the server confirms without changes;
+ * on a new session the subscription and its MonitoredItems are moved.
+ * Notifications lost with the old connection are covered by one Read.
+ *
+ * @return 0 if the subscription is usable on this session
+ */
+static int transfer_subscription(a16_mirror_t *m) {
+    UA_TransferSubscriptionsRequest req;
+    UA_TransferSubscriptionsRequest_init(&req);
+    req.subscriptionIds = &m->sub_id;
+    req.subscriptionIdsSize = 1;
+    req.sendInitialValues = false;
+
+    UA_TransferSubscriptionsResponse resp;
+    __UA_Client_Service(m->client, &req, &UA_TYPES[UA_TYPES_TRANSFERSUBSCRIPTIONSREQUEST],
+                        &resp, &UA_TYPES[UA_TYPES_TRANSFERSUBSCRIPTIONSRESPONSE]);
+    bool ok = resp.responseHeader.serviceResult == UA_STATUSCODE_GOOD &&
+              resp.resultsSize == 1 && resp.results[0].statusCode == UA_STATUSCODE_GOOD;
+    UA_TransferSubscriptionsResponse_clear(&resp);
+
+    pthread_mutex_lock(&m->lock);
+    if (ok) m->stats.transfers++;
+    else m->stats.transfer_failures++;
+    pthread_mutex_unlock(&m->lock);
+    if (!ok) return -1;
+
+    m->ack_count = 0;
+    resync_image(m);
+    return 0;
+}
+
+/* ============================================================================
+ * WRITES
+ * ============================================================================ */
+
+/**
+ * @brief WriteResponse handler: count results, requeue on transport errors
+ */
+static void write_callback(UA_Client *client, void *userdata, UA_UInt32 request_id,
+                           void *response) {
+    a16_mirror_t *m = (a16_mirror_t *)userdata;
+    UA_WriteResponse *resp = (UA_WriteResponse *)response;
+
+    pthread_mutex_lock(&m->lock);
+    write_slot_t *slot = NULL;
+    for (int i = 0; i < A16_WRITES_IN_FLIGHT; i++) {
+        if (m->in_flight[i].mask && m->in_flight[i].request_id == request_id) {
+            slot = &m->in_flight[i];
+        }
+    }
+    if (slot) {
+        UA_StatusCode status = resp->responseHeader.serviceResult;
+        if (status != UA_STATUSCODE_GOOD && is_transport_error(status)) {
+            /* Send again unless a newer value for the tag is already pending */
+            uint32_t requeue = slot->mask & ~m->pending_mask;
+            for (int i = 0; i < A16_TAG_COUNT; i++) {
+                if (requeue & (1u << i)) m->pending_value[i] = slot->value[i];
+            }
+            if (requeue && !m->pending_mask) m->pending_since = now_ms();
+            m->pending_mask |= requeue;
+        } else if (status != UA_STATUSCODE_GOOD) {
+            m->stats.write_errors += (uint32_t)__builtin_popcount(slot->mask);
+        } else {
+            for (size_t i = 0; i < resp->resultsSize; i++) {
+                if (resp->results[i] != UA_STATUSCODE_GOOD) m->stats.write_errors++;
+            }
+        }
+        slot->mask = 0;
+        m->in_flight_count--;
+        pthread_cond_broadcast(&m->cond);
+    }
+    pthread_mutex_unlock(&m->lock);
+}
+
+/**
+ * @brief Send all pending writes as one WriteRequest
+ */
+static void flush_writes(a16_mirror_t *m, bool force) {
+    write_slot_t batch;
+    int free_slot = -1;
+
+    pthread_mutex_lock(&m->lock);
+    if (!m->pending_mask ||
+        (!force && now_ms() - m->pending_since < m->config.write_window_ms)) {
+        pthread_mutex_unlock(&m->lock);
+        return;
+    }
+    for (int i = 0; i < A16_WRITES_IN_FLIGHT && free_slot < 0; i++) {
+        if (!m->in_flight[i].mask) free_slot = i;
+    }
+    if (free_slot < 0) {
+        pthread_mutex_unlock(&m->lock);
+        return;
+    }
+    batch.mask = m->pending_mask;
+    memcpy(batch.value, m->pending_value, sizeof(batch.value));
+    m->pending_mask = 0;
+    pthread_mutex_unlock(&m->lock);
+
+    UA_WriteValue wv[A16_TAG_COUNT];
+    UA_UInt16 values[A16_TAG_COUNT];
+    size_t count = 0;
+    for (int i = 0; i < A16_TAG_COUNT; i++) {
+        if (!(batch.mask & (1u << i))) continue;
+        values[count] = batch.value[i];
+        UA_WriteValue_init(&wv[count]);
+        wv[count].nodeId = UA_NODEID_STRING(1, (char *)tag_names[i]);
+        wv[count].attributeId = UA_ATTRIBUTEID_VALUE;
+        wv[count].value.hasValue = true;
+        UA_Variant_setScalar(&wv[count].value.value, &values[count], &UA_TYPES[UA_TYPES_UINT16]);
+        count++;
+    }
+
+    UA_WriteRequest req;
+    UA_WriteRequest_init(&req);
+    req.nodesToWrite = wv;
+    req.nodesToWriteSize = count;
+
+    UA_UInt32 request_id = 0;
+    UA_StatusCode rc = __UA_Client_AsyncService(m->client, &req, &UA_TYPES[UA_TYPES_WRITEREQUEST],
+                                                write_callback, &UA_TYPES[UA_TYPES_WRITERESPONSE],
+                                                m, &request_id);
+
+    pthread_mutex_lock(&m->lock);
+    if (rc == UA_STATUSCODE_GOOD) {
+        batch.request_id = request_id;
+        m->in_flight[free_slot] = batch;
+        m->in_flight_count++;
+        m->stats.write_requests++;
+        m->stats.write_nodes += (uint32_t)count;
+    } else {
+        /* Not sent: put back what was not overwritten meanwhile */
+        uint32_t requeue = batch.mask & ~m->pending_mask;
+        for (int i = 0; i < A16_TAG_COUNT; i++) {
+            if (requeue & (1u << i)) m->pending_value[i] = batch.value[i];
+        }
+        m->pending_mask |= requeue;
+    }
+    pthread_mutex_unlock(&m->lock);
+}
+
+/* ============================================================================
+ * CONNECTION
+ * ============================================================================ */
+
+/**
+ * @brief Connect (or re-activate the old session) and restore the subscription
+ */
+static void mirror_connect(a16_mirror_t *m) {
+    UA_StatusCode rc = (m->username && m->password)
+        ? UA_Client_connectUsername(m->client, m->url, m->username, m->password)
+        : UA_Client_connect(m->client, m->url);
+
+    if (rc == UA_STATUSCODE_GOOD) {
+        memset(m->publish_ids, 0, sizeof(m->publish_ids));
+        if (!m->sub_id || m->resubscribe || transfer_subscription(m) != 0) {
+            m->sub_id = 0;
+            if (create_subscription(m) != 0) rc = UA_STATUSCODE_BADINTERNALERROR;
+        }
+    }
+
+    pthread_mutex_lock(&m->lock);
+    if (rc == UA_STATUSCODE_GOOD) m->stats.connects++;
+    else m->stats.connect_failures++;
+    pthread_mutex_unlock(&m->lock);
+
+    if (rc != UA_STATUSCODE_GOOD) {
+        UA_Client_disconnectSecureChannel(m->client);
+        m->next_connect = now_ms() + m->backoff;
+        m->backoff = m->backoff * 2 > A16_BACKOFF_MAX_MS ? A16_BACKOFF_MAX_MS : m->backoff * 2;
+        return;
+    }
+
+    m->session_up = true;
+    m->backoff = A16_BACKOFF_MIN_MS;
+    set_connected(m, true);
+    fill_publish(m);
+}
+
+/**
+ * @brief Drop the SecureChannel but keep the session for re-activation
+ */
+static void mirror_connection_lost(a16_mirror_t *m) {
+    UA_Client_disconnectSecureChannel(m->client);
+    m->session_up = false;
+    memset(m->publish_ids, 0, sizeof(m->publish_ids));
+    m->next_connect = now_ms();
+    set_connected(m, false);
+}
+
+/**
+ * @brief Mirror thread: owns the UA_Client
+ */
+static void *mirror_thread(void *arg) {
+    a16_mirror_t *m = (a16_mirror_t *)arg;
+
+    while (atomic_load(&m->running)) {
+        if (!m->session_up) {
+            if (now_ms() >= m->next_connect) mirror_connect(m);
+            else usleep(A16_POLL_MS * 1000);
+            continue;
+        }
+
+        flush_writes(m, false);
+        UA_StatusCode rc = UA_Client_run_iterate(m->client, A16_POLL_MS);
+
+        UA_SecureChannelState channel_state;
+        UA_SessionState session_state;
+        UA_StatusCode connect_status;
+        UA_Client_getState(m->client, &channel_state, &session_state, &connect_status);
+        if (rc != UA_STATUSCODE_GOOD || session_state != UA_SESSIONSTATE_ACTIVATED ||
+            connect_status != UA_STATUSCODE_GOOD) {
+            mirror_connection_lost(m);
+            continue;
+        }
+
+        if (m->resubscribe) {
+            memset(m->publish_ids, 0, sizeof(m->publish_ids));
+            m->sub_id = 0;
+            if (create_subscription(m) != 0) {
+                mirror_connection_lost(m);
+                continue;
+            }
+        }
+        fill_publish(m);
+    }
+
+    /* Send what is still pending before closing the session */
+    if (m->session_up) {
+        flush_writes(m, true);
+        double end = now_ms() + A16_REQUEST_TIMEOUT_MS;
+        for (;;) {
+            pthread_mutex_lock(&m->lock);
+            bool idle = m->in_flight_count == 0;
+            pthread_mutex_unlock(&m->lock);
+            if (idle || now_ms() > end) break;
+            if (UA_Client_run_iterate(m->client, A16_POLL_MS) != UA_STATUSCODE_GOOD) break;
+        }
+    }
+    m->session_up = false;
+    memset(m->publish_ids, 0, sizeof(m->publish_ids));
+    UA_Client_disconnect(m->client);
+    set_connected(m, false);
+    return NULL;
+}
+
+/* ============================================================================
+ * PUBLIC API
+ * ============================================================================ */
+
+a16_mirror_t *a16_mirror_start(const a16_mirror_config_t *config) {
+    if (!config || !config->url) return NULL;
+
+    a16_mirror_t *m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+    m->config = *config;
+    m->url = dup_string(config->url);
+    m->username = dup_string(config->username);
+    m->password = dup_string(config->password);
+    m->config.url = m->url;
+    m->config.username = m->username;
+    m->config.password = m->password;
+    m->publishing_interval = config->publishing_interval_ms > 0 ? config->publishing_interval_ms : 100.0;
+    m->backoff = A16_BACKOFF_MIN_MS;
+    atomic_init(&m->running, true);
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_cond_init(&m->cond, NULL);
+
+    m->client = UA_Client_new();
+    if (m->client) {
+        UA_ClientConfig *cc = UA_Client_getConfig(m->client);
+        cc->timeout = A16_REQUEST_TIMEOUT_MS;
+    }
+
+    if (!m->url || !m->client || pthread_create(&m->thread, NULL, mirror_thread, m) != 0) {
+        if (m->client) UA_Client_delete(m->client);
+        pthread_cond_destroy(&m->cond);
+        pthread_mutex_destroy(&m->lock);
+        free(m->url);
+        free(m->username);
+        free(m->password);
+        free(m);
+        return NULL;
+    }
+    return m;
+}
+
+void a16_mirror_stop(a16_mirror_t *mirror) {
+    if (!mirror) return;
+    atomic_store(&mirror->running, false);
+    pthread_join(mirror->thread, NULL);
+    UA_Client_delete(mirror->client);
+    pthread_cond_destroy(&mirror->cond);
+    pthread_mutex_destroy(&mirror->lock);
+    free(mirror->url);
+    free(mirror->username);
+    free(mirror->password);
+    free(mirror);
+}
+
+bool a16_mirror_wait_ready(a16_mirror_t *mirror, uint32_t timeout_ms) {
+    struct timespec deadline = deadline_after(timeout_ms);
+    pthread_mutex_lock(&mirror->lock);
+    int rc = 0;
+    while (rc == 0 && !(atomic_load(&mirror->connected) &&
+                        atomic_load(&mirror->valid_mask) == ALL_TAGS_MASK)) {
+        rc = pthread_cond_timedwait(&mirror->cond, &mirror->lock, &deadline);
+    }
+    bool ready = atomic_load(&mirror->connected) && atomic_load(&mirror->valid_mask) == ALL_TAGS_MASK;
+    pthread_mutex_unlock(&mirror->lock);
+    return ready;
+}
+
+bool a16_mirror_get(const a16_mirror_t *mirror, a16_tag_t tag, uint16_t *value) {
+    if ((unsigned)tag >= A16_TAG_COUNT) return false;
+    a16_mirror_t *m = (a16_mirror_t *)mirror;
+    unsigned s1, s2;
+    uint16_t v;
+    uint32_t valid;
+    do {
+        s1 = atomic_load_explicit(&m->seq, memory_order_acquire);
+        v = atomic_load_explicit(&m->value[tag], memory_order_relaxed);
+        valid = atomic_load_explicit(&m->valid_mask, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        s2 = atomic_load_explicit(&m->seq, memory_order_relaxed);
+    } while ((s1 & 1u) || s1 != s2);
+    if (value) *value = v;
+    return (valid & (1u << tag)) != 0;
+}
+
+void a16_mirror_snapshot(const a16_mirror_t *mirror, a16_image_t *image) {
+    a16_mirror_t *m = (a16_mirror_t *)mirror;
+    unsigned s1, s2;
+    do {
+        s1 = atomic_load_explicit(&m->seq, memory_order_acquire);
+        for (int i = 0; i < A16_TAG_COUNT; i++) {
+            image->value[i] = atomic_load_explicit(&m->value[i], memory_order_relaxed);
+            image->source_time[i] = atomic_load_explicit(&m->source_time[i], memory_order_relaxed);
+        }
+        image->valid_mask = atomic_load_explicit(&m->valid_mask, memory_order_relaxed);
+        image->updates = atomic_load_explicit(&m->updates, memory_order_relaxed);
+        image->connected = atomic_load_explicit(&m->connected, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        s2 = atomic_load_explicit(&m->seq, memory_order_relaxed);
+    } while ((s1 & 1u) || s1 != s2);
+}
+
+int a16_mirror_write(a16_mirror_t *mirror, a16_tag_t tag, uint16_t value) {
+    if ((unsigned)tag >= A16_TAG_COUNT) return -1;
+    pthread_mutex_lock(&mirror->lock);
+    if (!mirror->pending_mask) mirror->pending_since = now_ms();
+    mirror->pending_mask |= 1u << tag;
+    mirror->pending_value[tag] = value;
+    mirror->stats.writes++;
+    pthread_mutex_unlock(&mirror->lock);
+    return 0;
+}
+
+int a16_mirror_write_bits(a16_mirror_t *mirror, a16_tag_t tag, uint16_t mask, uint16_t bits) {
+    if ((unsigned)tag >= A16_TAG_COUNT) return -1;
+    uint16_t base;
+    bool mirrored = a16_mirror_get(mirror, tag, &base);
+
+    pthread_mutex_lock(&mirror->lock);
+    if (mirror->pending_mask & (1u << tag)) {
+        base = mirror->pending_value[tag];
+    } else if (!mirrored) {
+        pthread_mutex_unlock(&mirror->lock);
+        return -1;
+    } else {
+        if (!mirror->pending_mask) mirror->pending_since = now_ms();
+        mirror->pending_mask |= 1u << tag;
+    }
+    mirror->pending_value[tag] = (uint16_t)((base & ~mask) | (bits & mask));
+    mirror->stats.writes++;
+    pthread_mutex_unlock(&mirror->lock);
+    return 0;
+}
+
+int a16_mirror_flush(a16_mirror_t *mirror, uint32_t timeout_ms) {
+    struct timespec deadline = deadline_after(timeout_ms);
+    pthread_mutex_lock(&mirror->lock);
+    uint32_t errors_before = mirror->stats.write_errors;
+    int rc = 0;
+    while (rc == 0 && (mirror->pending_mask || mirror->in_flight_count)) {
+        rc = pthread_cond_timedwait(&mirror->cond, &mirror->lock, &deadline);
+    }
+    int result = (mirror->pending_mask || mirror->in_flight_count) ? -1
+               : mirror->stats.write_errors != errors_before ? 1 : 0;
+    pthread_mutex_unlock(&mirror->lock);
+    return result;
+}
+
+void a16_mirror_get_stats(a16_mirror_t *mirror, a16_mirror_stats_t *stats) {
+    pthread_mutex_lock(&mirror->lock);
+    *stats = mirror->stats;
+    pthread_mutex_unlock(&mirror->lock);
+}
+
+const char *a16_tag_name(a16_tag_t tag) {
+    return (unsigned)tag < A16_TAG_COUNT ? tag_names[tag] : "?";
+}
@@ -0,0 +1,185 @@
+/* a16_mirror.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef A16_MIRROR_H
+#define A16_MIRROR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Gateway Process Image Mirror (host client library)
+ * ============================================================================
+ *
+ * Keeps a local copy of the gateway process image up to date through a
+ * single OPC UA subscription with one MonitoredItem per tag. A background
+ * thread owns the UA_Client; application threads never touch it:
+ *
+ *   - a16_mirror_get() / a16_mirror_snapshot() read the local image without
+ *     locks (sequence counter, readers retry if an update was in progress).
+ *     All tags of one Publish response become visible at once.
+ *   - Change callbacks run on the mirror thread after each applied update.
+ *   - a16_mirror_write() / a16_mirror_write_bits() only record the value.
+ *     Writes made within one flush cycle are merged per tag (last value
+ *     wins, bit writes are combined) and sent as one WriteRequest.
+ *
+ * After a connection loss the thread reconnects with backoff. The client
+ * first re-activates the old session; the subscription is then taken over
+ * with TransferSubscriptions and the image is resynchronised with one Read.
+ * Only if the transfer fails is the subscription created again.
+ *
+ * Writes issued while disconnected stay pending and are sent after the
+ * reconnect (coalesced to the latest value per tag).
+ */
+
+/** @brief Process image tags (MonitoredItem client handle = tag index) */
+typedef enum {
+    A16_TAG_DIAGNOSTIC_COUNTER = 0,
+    A16_TAG_LOOPBACK_INPUT,
+    A16_TAG_LOOPBACK_OUTPUT,
+    A16_TAG_DISCRETE_INPUTS,
+    A16_TAG_DISCRETE_OUTPUTS,
+    A16_TAG_ADC1,
+    A16_TAG_ADC2,
+    A16_TAG_ADC3,
+    A16_TAG_ADC4,
+    A16_TAG_COUNT
+} a16_tag_t;
+
+/**
+ * @brief Consistent copy of the mirrored process image
+ */
+typedef struct {
+    uint16_t value[A16_TAG_COUNT];      /**< Last received value per tag */
+    int64_t source_time[A16_TAG_COUNT]; /**< Source timestamp (UA_DateTime, 100 ns since 1601) */
+    uint32_t valid_mask;                /**< Bit per tag: value received with Good status */
+    uint32_t updates;                   /**< Applied Publish responses (increments per update) */
+    bool connected;                     /**< Session active and subscription running */
+} a16_image_t;
+
+/**
+ * @brief Change callback, called on the mirror thread
+ *
+ * Also called with changed = 0 when only image->connected changed.
+ *
+ * @param image   Image after the update
+ * @param changed Bit per tag whose value or validity changed
+ * @param context User context from the configuration
+ */
+typedef void (*a16_change_cb_t)(const a16_image_t *image, uint32_t changed, void *context);
+
+/**
+ * @brief Mirror configuration
+ */
+typedef struct {
+    const char *url;                /**< opc.tcp://host:port */
+    const char *username;           /**< NULL for anonymous */
+    const char *password;
+    double publishing_interval_ms;  /**< Requested publishing interval (0 = 100) */
+    double sampling_interval_ms;    /**< Requested sampling interval (0 = publishing interval / 2) */
+    uint32_t write_window_ms;       /**< Extra time to collect writes before sending (0 = next cycle) */
+    a16_change_cb_t on_change;      /**< Optional change callback */
+    void *context;                  /**< Passed to on_change */
+} a16_mirror_config_t;
+
+/**
+ * @brief Mirror statistics
+ */
+typedef struct {
+    uint32_t connects;          /**< Successful session activations */
+    uint32_t connect_failures;  /**< Failed connect attempts */
+    uint32_t transfers;         /**< Subscriptions taken over after a reconnect */
+    uint32_t transfer_failures; /**< Transfers refused (subscription created again) */
+    uint32_t subscribes;        /**< Subscriptions created */
+    uint32_t updates;           /**< Publish responses with data changes */
+    uint32_t keepalives;        /**< Publish responses without notifications */
+    uint32_t publish_errors;    /**< Publish responses with a bad service result */
+    uint32_t writes;            /**< a16_mirror_write*() calls */
+    uint32_t write_requests;    /**< WriteRequests sent */
+    uint32_t write_nodes;       /**< Values sent in WriteRequests */
+    uint32_t write_errors;      /**< Values rejected by the server or lost */
+} a16_mirror_stats_t;
+
+typedef struct a16_mirror a16_mirror_t;
+
+/**
+ * @brief Create the mirror and start its thread
+ *
+ * Returns immediately; the connection is established in the background.
+ *
+ * @param config Configuration (strings are copied)
+ * @return a16_mirror_t* Handle, or NULL on allocation or thread failure
+ */
+a16_mirror_t *a16_mirror_start(const a16_mirror_config_t *config);
+
+/**
+ * @brief Stop the thread, close the session and free the mirror
+ *
+ * Pending writes are sent first if the session is active.
+ */
+void a16_mirror_stop(a16_mirror_t *mirror);
+
+/**
+ * @brief Wait until the image holds a valid value for every tag
+ *
+ * @return true when ready, false on timeout
+ */
+bool a16_mirror_wait_ready(a16_mirror_t *mirror, uint32_t timeout_ms);
+
+/**
+ * @brief Read one tag from the local image (lock-free)
+ *
+ * @return true if the value is valid
+ */
+bool a16_mirror_get(const a16_mirror_t *mirror, a16_tag_t tag, uint16_t *value);
+
+/**
+ * @brief Copy the whole image consistently (lock-free)
+ */
+void a16_mirror_snapshot(const a16_mirror_t *mirror, a16_image_t *image);
+
+/**
+ * @brief Queue a write of one tag
+ *
+ * @return 0 on success, -1 for an invalid tag
+ */
+int a16_mirror_write(a16_mirror_t *mirror, a16_tag_t tag, uint16_t value);
+
+/**
+ * @brief Queue a write of selected bits of one tag
+ *
+ * Bits outside mask keep the value of an earlier pending write, or the
+ * mirrored value if nothing is pending. Typical use: single relays of
+ * A16_TAG_DISCRETE_OUTPUTS.
+ *
+ * @return 0 on success, -1 for an invalid tag or no known base value
+ */
+int a16_mirror_write_bits(a16_mirror_t *mirror, a16_tag_t tag, uint16_t mask, uint16_t bits);
+
+/**
+ * @brief Wait until no write is pending or awaiting its response
+ *
+ * Writes queued by other threads meanwhile extend the wait.
+ *
+ * @return 0 if all were accepted, 1 if the server rejected some, -1 on timeout
+ */
+int a16_mirror_flush(a16_mirror_t *mirror, uint32_t timeout_ms);
+
+/**
+ * @brief Get mirror statistics
+ */
+void a16_mirror_get_stats(a16_mirror_t *mirror, a16_mirror_stats_t *stats);
+
+/**
+ * @brief NodeId string identifier of a tag (ns=1)
+ */
+const char *a16_tag_name(a16_tag_t tag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* A16_MIRROR_H */
@@ -0,0 +1,158 @@
+/* actuation_meter.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "actuation_meter.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *series_names[ACTUATION_SERIES] = { "write", "on", "off", "visible" };
+
+/**
+ * @brief Keep one sample of an interval
+ */
+static void add_sample(actuation_meter_t *meter, actuation_series_t series, int64_t us) {
+    if (us < 0) {
+        us = 0;
+    }
+    if (meter->count[series] < ACTUATION_MAX_CYCLES) {
+        meter->samples[series][meter->count[series]++] = us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    }
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Clear a meter for a new run
+ *
+ * @param meter Meter to clear
+ */
+void actuation_meter_reset(actuation_meter_t *meter) {
+    memset(meter, 0, sizeof(*meter));
+}
+
+/**
+ * @brief Run one cycle
+ *
+ * @param meter Meter of the run
+ * @param io Output and input under test
+ * @param on Level to switch the output to
+ * @param timeout_us Longest wait for the edge and the process image
+ * @return true if the input followed the output
+ */
+bool actuation_meter_cycle(actuation_meter_t *meter, const actuation_io_t *io, bool on, uint32_t timeout_us) {
+    int level = on ? 1 : 0;
+    meter->cycles++;
+    meter->sorted = false;
+
+    // An input that already has the new level would give an edge of zero
+    if (io->read_input(io->ctx) == level) {
+        meter->errors++;
+        return false;
+    }
+
+    // A process image that already shows the new level cannot show the change
+    bool watch_visible = io->read_visible(io->ctx) == !level;
+
+    int64_t command = io->now_us(io->ctx);
+    if (!io->write_output(io->ctx, on)) {
+        meter->errors++;
+        return false;
+    }
+    int64_t written = io->now_us(io->ctx);
+
+    // The edge is stamped when the read that saw it returns
+    int64_t edge = -1;
+    int64_t visible = -1;
+    int last = !level;
+    for (;;) {
+        int input = io->read_input(io->ctx);
+        int64_t now = io->now_us(io->ctx);
+        if (input < 0) {
+            meter->errors++;
+        } else {
+            if (edge < 0 && input == level) {
+                edge = now;
+            } else if (edge >= 0 && input != level && last == level) {
+                meter->bounces++;
+            }
+            last = input;
+        }
+        if (watch_visible && visible < 0 && io->read_visible(io->ctx) == level) {
+            visible = now;
+        }
+        if ((edge >= 0 && (visible >= 0 || !watch_visible) && now - edge >= ACTUATION_BOUNCE_WINDOW_US) ||
+            now - written >= (int64_t)timeout_us) {
+            break;
+        }
+    }
+
+    add_sample(meter, ACTUATION_WRITE, written - command);
+    if (edge < 0) {
+        meter->timeouts++;
+        return false;
+    }
+    add_sample(meter, on ? ACTUATION_ON : ACTUATION_OFF, edge - written);
+    int64_t bin = (edge - command) / ACTUATION_HISTOGRAM_BIN_US;
+    meter->histogram[bin < ACTUATION_HISTOGRAM_BINS ? bin : ACTUATION_HISTOGRAM_BINS - 1]++;
+    if (visible >= 0) {
+        add_sample(meter, ACTUATION_VISIBLE, visible - command);
+    } else {
+        meter->not_visible++;
+    }
+    return true;
+}
+
+/**
+ * @brief Sort the samples at the end of a run
+ *
+ * @param meter Meter of the run
+ */
+void actuation_meter_finish(actuation_meter_t *meter) {
+    for (int s = 0; s < ACTUATION_SERIES; s++) {
+        qsort(meter->samples[s], meter->count[s], sizeof(uint32_t), cmp_u32);
+    }
+    meter->sorted = true;
+}
+
+/**
+ * @brief Distribution of one interval
+ *
+ * @param meter Meter of the run
+ * @param series Interval
+ * @param summary Pointer to store the distribution
+ */
+void actuation_meter_summary(const actuation_meter_t *meter, actuation_series_t series,
+                             actuation_summary_t *summary) {
+    memset(summary, 0, sizeof(*summary));
+    uint32_t count = meter->count[series];
+    const uint32_t *samples = meter->samples[series];
+    summary->count = count;
+    if (count == 0) {
+        return;
+    }
+    if (!meter->sorted) {
+        summary->min_us = UINT32_MAX;
+        for (uint32_t i = 0; i < count; i++) {
+            if (samples[i] < summary->min_us) summary->min_us = samples[i];
+            if (samples[i] > summary->max_us) summary->max_us = samples[i];
+        }
+        return;
+    }
+    summary->min_us = samples[0];
+    summary->p50_us = samples[count * 50 / 100];
+    summary->p90_us = samples[count * 90 / 100];
+    summary->p99_us = samples[count * 99 / 100];
+    summary->max_us = samples[count - 1];
+}
+
+/**
+ * @brief Name of an interval
+ *
+ * @param series Interval
+ * @return const char* "write", "on", "off" or "visible"
+ */
+const char *actuation_series_name(actuation_series_t series) {
+    return (unsigned)series < ACTUATION_SERIES ? series_names[series] : "unknown";
+}
@@ -0,0 +1,160 @@
+/* actuation_meter.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef ACTUATION_METER_H
+#define ACTUATION_METER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Actuation Latency Meter
+ * ============================================================================
+ *
+ * Measures the way from an output command to the input it is wired back to.
+ * One cycle switches the output, then reads the input back to back until it
+ * follows (the edge) and the process image shows it (visible):
+ *
+ *   command          write          edge                 visible
+ *      |--- WRITE ---|--- ON / OFF ---|                     |
+ *      |------------------ VISIBLE -------------------------|
+ *
+ *   WRITE    command to the end of the output write (I2C transfer)
+ *   ON       end of the write to the input edge, output switched on
+ *            (relay operate time, input filter, one input read)
+ *   OFF      the same for switching off (relay release time)
+ *   VISIBLE  command to the process image clients read (adds the input
+ *            scan and its debounce)
+ *
+ * VISIBLE is only taken when the process image showed the old level before
+ * the command; otherwise, and when it does not follow in time, the cycle
+ * counts as not visible.
+ *
+ * The resolution of the edge is one input read. Changes of the input away
+ * from the commanded level after the edge are counted as bounces; the input
+ * is followed for at least ACTUATION_BOUNCE_WINDOW_US after the edge. The I/O is
+ * reached through callbacks and the file has no ESP-IDF dependencies, so
+ * tools/actuation_sim.c runs the same meter on the host against a simulated
+ * PCF8574 with a relay model.
+ */
+
+/** @brief Cycles kept per run */
+#define ACTUATION_MAX_CYCLES        256
+/** @brief Bins of the command-to-edge histogram */
+#define ACTUATION_HISTOGRAM_BINS    64
+/** @brief Width of a histogram bin in microseconds (the last bin holds the rest) */
+#define ACTUATION_HISTOGRAM_BIN_US  1000
+/** @brief Time the input is still followed after the edge to count bounces */
+#define ACTUATION_BOUNCE_WINDOW_US  2000
+
+/**
+ * @brief Measured intervals
+ */
+typedef enum {
+    ACTUATION_WRITE = 0,        /**< Command to the end of the output write */
+    ACTUATION_ON,               /**< Write to input edge, switching on */
+    ACTUATION_OFF,              /**< Write to input edge, switching off */
+    ACTUATION_VISIBLE,          /**< Command to the change in the process image */
+    ACTUATION_SERIES
+} actuation_series_t;
+
+/**
+ * @brief Access to the output and the input under test
+ */
+typedef struct {
+    /** Switch the output; returns when the write has completed */
+    bool (*write_output)(void *ctx, bool on);
+    /** Read the input from the hardware: 1, 0, or -1 on error */
+    int (*read_input)(void *ctx);
+    /** Input as clients see it (process image): 1, 0, or -1 when unknown */
+    int (*read_visible)(void *ctx);
+    /** Monotonic time in microseconds */
+    int64_t (*now_us)(void *ctx);
+    void *ctx;
+} actuation_io_t;
+
+/**
+ * @brief Distribution of one interval, microseconds
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t p50_us;
+    uint32_t p90_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} actuation_summary_t;
+
+/**
+ * @brief Samples and counters of a run
+ */
+typedef struct {
+    uint32_t samples[ACTUATION_SERIES][ACTUATION_MAX_CYCLES];
+    uint16_t count[ACTUATION_SERIES];
+    uint32_t histogram[ACTUATION_HISTOGRAM_BINS];   /**< Command to edge, both directions */
+    uint16_t cycles;                                /**< Cycles run */
+    uint16_t timeouts;                              /**< Cycles without an input edge */
+    uint16_t not_visible;                           /**< Edges the process image did not show in time */
+    uint16_t bounces;                               /**< Input changes after the edge */
+    uint16_t errors;                                /**< Failed writes or reads, input already at the new level */
+    bool sorted;                                    /**< Samples sorted by actuation_meter_finish() */
+} actuation_meter_t;
+
+/**
+ * @brief Clear a meter for a new run
+ *
+ * @param meter Meter to clear
+ */
+void actuation_meter_reset(actuation_meter_t *meter);
+
+/**
+ * @brief Run one cycle
+ *
+ * Switches the output to on and follows the input for at most timeout_us
+ * after the write, or until the process image also shows the new level and
+ * the bounce window after the edge has passed.
+ * Beyond ACTUATION_MAX_CYCLES the counters go on, the samples are not kept.
+ *
+ * @param meter Meter of the run
+ * @param io Output and input under test
+ * @param on Level to switch the output to
+ * @param timeout_us Longest wait for the edge and the process image
+ * @return true if the input followed the output
+ */
+bool actuation_meter_cycle(actuation_meter_t *meter, const actuation_io_t *io, bool on, uint32_t timeout_us);
+
+/**
+ * @brief Sort the samples at the end of a run
+ *
+ * @param meter Meter of the run
+ */
+void actuation_meter_finish(actuation_meter_t *meter);
+
+/**
+ * @brief Distribution of one interval
+ *
+ * Percentiles need a finished run; before that only count, min and max are set.
+ *
+ * @param meter Meter of the run
+ * @param series Interval
+ * @param summary Pointer to store the distribution
+ */
+void actuation_meter_summary(const actuation_meter_t *meter, actuation_series_t series,
+                             actuation_summary_t *summary);
+
+/**
+ * @brief Name of an interval
+ *
+ * @param series Interval
+ * @return const char* "write", "on", "off" or "visible"
+ */
+const char *actuation_series_name(actuation_series_t series);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ACTUATION_METER_H */
@@ -0,0 +1,252 @@
+/* actuation_test.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "actuation_test.h"
+#include "io_cache.h"
+#include "io_trace.h"
+#include "model.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "actuation_test";
+
+#define ACTUATION_TASK_STACK        3072    /**< Self-test task stack size */
+#define ACTUATION_TASK_PRIORITY     7       /**< Just below the I/O polling task, above the OPC UA task */
+#define ACTUATION_TASK_CORE         1       /**< Core of the I/O polling task */
+#define ACTUATION_BITS              16      /**< Discrete outputs and inputs */
+
+static actuation_test_config_t test_config;
+static bool test_initialized = false;
+static volatile bool stop_requested = false;
+
+static SemaphoreHandle_t status_mutex = NULL;
+static actuation_test_status_t status;
+
+static const char *state_names[] = { "idle", "running", "done", "stopped", "failed" };
+
+static void set_state(actuation_state_t state) {
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    status.state = state;
+    xSemaphoreGive(status_mutex);
+}
+
+/* ==================== I/O of the meter ==================== */
+
+/**
+ * @brief Switch the output under test like an OPC UA write of discrete_outputs
+ */
+static bool write_output(void *ctx, bool on) {
+    uint16_t mask = (uint16_t)(1u << test_config.output);
+    uint16_t outputs = io_cache_get_discrete_outputs(NULL, NULL);
+    outputs = on ? (outputs | mask) : (outputs & ~mask);
+    io_trace_record(IO_TRACE_WRITE_DO, 0, outputs);
+    write_discrete_outputs_slow(outputs);
+    io_cache_update_discrete_outputs(outputs, (uint64_t)(xTaskGetTickCount() * portTICK_PERIOD_MS));
+    return true;
+}
+
+static int read_input(void *ctx) {
+    return (read_discrete_inputs_slow() >> test_config.input) & 1;
+}
+
+static int read_visible(void *ctx) {
+    return (io_cache_get_discrete_inputs(NULL, NULL) >> test_config.input) & 1;
+}
+
+static int64_t now_us(void *ctx) {
+    return esp_timer_get_time();
+}
+
+/* ==================== Run ==================== */
+
+/**
+ * @brief Copy the counters and distributions of the meter into the status
+ */
+static void publish(const actuation_meter_t *meter, actuation_state_t state) {
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    status.state = state;
+    status.cycles = meter->cycles;
+    status.timeouts = meter->timeouts;
+    status.not_visible = meter->not_visible;
+    status.bounces = meter->bounces;
+    status.errors = meter->errors;
+    for (int s = 0; s < ACTUATION_SERIES; s++) {
+        actuation_meter_summary(meter, (actuation_series_t)s, &status.series[s]);
+    }
+    memcpy(status.histogram, meter->histogram, sizeof(status.histogram));
+    xSemaphoreGive(status_mutex);
+}
+
+/**
+ * @brief Self-test task: cycles alternating on and off, then restores the output
+ *
+ * @param pvParameters Meter of the run (freed at the end)
+ */
+static void actuation_task(void *pvParameters) {
+    actuation_meter_t *meter = pvParameters;
+    const actuation_io_t io = { write_output, read_input, read_visible, now_us, NULL };
+    uint16_t mask = (uint16_t)(1u << test_config.output);
+    bool initial = (io_cache_get_discrete_outputs(NULL, NULL) & mask) != 0;
+    uint16_t cycles = status.cycles_requested;
+
+    vTaskDelay(pdMS_TO_TICKS(ACTUATION_SETTLE_MS));
+    bool on = !initial;
+    for (uint16_t i = 0; i < cycles && !stop_requested; i++) {
+        actuation_meter_cycle(meter, &io, on, (uint32_t)test_config.timeout_ms * 1000);
+        on = !on;
+        publish(meter, ACTUATION_RUNNING);
+        vTaskDelay(pdMS_TO_TICKS(test_config.pause_ms));
+    }
+    if (((io_cache_get_discrete_outputs(NULL, NULL) & mask) != 0) != initial) {
+        write_output(NULL, initial);
+    }
+    io_cache_set_outputs_held(false);
+
+    actuation_meter_finish(meter);
+    actuation_state_t state = ACTUATION_DONE;
+    if (stop_requested) {
+        state = ACTUATION_STOPPED;
+    } else if (meter->count[ACTUATION_ON] + meter->count[ACTUATION_OFF] == 0) {
+        state = ACTUATION_FAILED;
+    }
+    publish(meter, state);
+
+    ESP_LOGI(TAG, "DO%u -> DI%u: %u cycles, %u timeouts, %u not visible, %u bounces, %u errors",
+             test_config.output, test_config.input, meter->cycles, meter->timeouts,
+             meter->not_visible, meter->bounces, meter->errors);
+    for (int s = 0; s < ACTUATION_SERIES; s++) {
+        const actuation_summary_t *sum = &status.series[s];
+        ESP_LOGI(TAG, "  %-8s n=%lu p50 %lu us, p99 %lu us, max %lu us",
+                 actuation_series_name((actuation_series_t)s), (unsigned long)sum->count,
+                 (unsigned long)sum->p50_us, (unsigned long)sum->p99_us, (unsigned long)sum->max_us);
+    }
+    free(meter);
+    vTaskDelete(NULL);
+}
+
+/* ==================== Public API ==================== */
+
+/**
+ * @brief Initialize the self-test
+ *
+ * @param config Configuration (copied)
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t actuation_test_init(const actuation_test_config_t *config) {
+    if (config == NULL || config->output >= ACTUATION_BITS || config->input >= ACTUATION_BITS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (status_mutex == NULL) {
+        status_mutex = xSemaphoreCreateMutex();
+        if (status_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    test_config = *config;
+    if (test_config.cycles == 0 || test_config.cycles > ACTUATION_MAX_CYCLES) {
+        test_config.cycles = ACTUATION_MAX_CYCLES;
+    }
+    if (test_config.timeout_ms == 0) {
+        test_config.timeout_ms = 1;
+    }
+    status.output = test_config.output;
+    status.input = test_config.input;
+    test_initialized = true;
+    ESP_LOGI(TAG, "Actuation self-test %s (DO%u -> DI%u)", test_config.enable ? "available" : "disabled",
+             test_config.output, test_config.input);
+    return ESP_OK;
+}
+
+/**
+ * @brief Start a run
+ *
+ * @param cycles Cycles of the run (0 = configured)
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_SUPPORTED, ESP_ERR_INVALID_STATE or ESP_ERR_NO_MEM
+ */
+esp_err_t actuation_test_start(uint16_t cycles) {
+    if (!test_initialized || !test_config.enable) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (io_cache_is_replica() || io_trace_get_state() == IO_TRACE_REPLAYING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (cycles == 0 || cycles > ACTUATION_MAX_CYCLES) {
+        cycles = cycles == 0 ? test_config.cycles : ACTUATION_MAX_CYCLES;
+    }
+
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    bool busy = status.state == ACTUATION_RUNNING;
+    if (!busy) {
+        memset(&status, 0, sizeof(status));
+        status.state = ACTUATION_RUNNING;
+        status.output = test_config.output;
+        status.input = test_config.input;
+        status.cycles_requested = cycles;
+    }
+    xSemaphoreGive(status_mutex);
+    if (busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    actuation_meter_t *meter = malloc(sizeof(actuation_meter_t));
+    if (meter == NULL) {
+        set_state(ACTUATION_IDLE);
+        return ESP_ERR_NO_MEM;
+    }
+    actuation_meter_reset(meter);
+    stop_requested = false;
+    io_cache_set_outputs_held(true);
+    BaseType_t ret = xTaskCreatePinnedToCore(actuation_task, "actuation", ACTUATION_TASK_STACK, meter,
+                                             ACTUATION_TASK_PRIORITY, NULL, ACTUATION_TASK_CORE);
+    if (ret != pdPASS) {
+        io_cache_set_outputs_held(false);
+        free(meter);
+        set_state(ACTUATION_IDLE);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Self-test started: %u cycles on DO%u -> DI%u", cycles, test_config.output,
+             test_config.input);
+    return ESP_OK;
+}
+
+/**
+ * @brief Stop a run after the current cycle
+ *
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_STATE
+ */
+esp_err_t actuation_test_stop(void) {
+    if (!test_initialized || status.state != ACTUATION_RUNNING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    stop_requested = true;
+    return ESP_OK;
+}
+
+/**
+ * @brief Get the progress and results of the last run
+ *
+ * @param out Pointer to store them
+ */
+void actuation_test_get_status(actuation_test_status_t *out) {
+    if (status_mutex == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    *out = status;
+    xSemaphoreGive(status_mutex);
+}
+
+/**
+ * @brief Name of a state
+ *
+ * @param state State
+ * @return const char* State name
+ */
+const char *actuation_test_state_name(actuation_state_t state) {
+    return (unsigned)state < sizeof(state_names) / sizeof(state_names[0]) ? state_names[state] : "unknown";
+}
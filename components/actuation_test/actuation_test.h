@@ -0,0 +1,122 @@
+/* actuation_test.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef ACTUATION_TEST_H
+#define ACTUATION_TEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "actuation_meter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Actuation Self-Test (DO -> DI loopback)
+ * ============================================================================
+ *
+ * A relay output is wired back to a discrete input. On request the test
+ * toggles the output through the same path as an OPC UA write of
+ * discrete_outputs (trace record, PCF8574 write, io_cache update) and
+ * measures with actuation_meter.h how long the write took, when the input
+ * followed and when the process image showed it. Cycles alternate between
+ * on and off with a pause between them, so relay operate and release times
+ * are kept apart.
+ *
+ * While the test runs, writes to discrete_outputs are refused
+ * (io_cache_set_outputs_held), the other outputs keep their value, and the
+ * output under test returns to its previous level at the end. The test does
+ * not start on a standby unit of a redundant pair or during a trace replay.
+ */
+
+/** @brief Pause before the first cycle, lets an output written just before settle */
+#define ACTUATION_SETTLE_MS         100
+
+/**
+ * @brief Self-test configuration
+ */
+typedef struct {
+    bool enable;                /**< Allow the test (the output must be wired to the input) */
+    uint8_t output;             /**< Output bit under test (0-15) */
+    uint8_t input;              /**< Input bit it is wired to (0-15) */
+    uint16_t cycles;            /**< Cycles per run when a request gives none */
+    uint16_t pause_ms;          /**< Pause between cycles */
+    uint16_t timeout_ms;        /**< Longest wait for the input per cycle */
+} actuation_test_config_t;
+
+/**
+ * @brief State of the self-test
+ */
+typedef enum {
+    ACTUATION_IDLE = 0,         /**< No run since boot */
+    ACTUATION_RUNNING,          /**< Cycles in progress */
+    ACTUATION_DONE,             /**< Last run completed, results final */
+    ACTUATION_STOPPED,          /**< Last run stopped on request */
+    ACTUATION_FAILED            /**< Last run found no input edge at all */
+} actuation_state_t;
+
+/**
+ * @brief Progress and results of the last run
+ */
+typedef struct {
+    actuation_state_t state;                                /**< Current state */
+    uint8_t output;                                         /**< Output bit under test */
+    uint8_t input;                                          /**< Input bit it is wired to */
+    uint16_t cycles_requested;                              /**< Cycles of the run */
+    uint16_t cycles;                                        /**< Cycles done */
+    uint16_t timeouts;                                      /**< Cycles without an input edge */
+    uint16_t not_visible;                                   /**< Edges the process image did not show in time */
+    uint16_t bounces;                                       /**< Input changes after the edge */
+    uint16_t errors;                                        /**< Failed cycles (input already at the new level) */
+    actuation_summary_t series[ACTUATION_SERIES];           /**< Distributions; percentiles once done */
+    uint32_t histogram[ACTUATION_HISTOGRAM_BINS];           /**< Command to edge, 1 ms bins */
+} actuation_test_status_t;
+
+/**
+ * @brief Initialize the self-test
+ *
+ * @param config Configuration (copied)
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG for a bit outside 0-15
+ */
+esp_err_t actuation_test_init(const actuation_test_config_t *config);
+
+/**
+ * @brief Start a run
+ *
+ * Returns at once; the cycles run in their own task.
+ *
+ * @param cycles Cycles of the run (0 = configured, at most ACTUATION_MAX_CYCLES)
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_SUPPORTED when disabled,
+ *         ESP_ERR_INVALID_STATE while a run is in progress, on a standby
+ *         unit or during a trace replay, ESP_ERR_NO_MEM
+ */
+esp_err_t actuation_test_start(uint16_t cycles);
+
+/**
+ * @brief Stop a run after the current cycle
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE when no run is in progress
+ */
+esp_err_t actuation_test_stop(void);
+
+/**
+ * @brief Get the progress and results of the last run
+ *
+ * @param status Pointer to store them
+ */
+void actuation_test_get_status(actuation_test_status_t *status);
+
+/**
+ * @brief Name of a state
+ *
+ * @param state State
+ * @return const char* "idle", "running", "done", "stopped" or "failed"
+ */
+const char *actuation_test_state_name(actuation_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ACTUATION_TEST_H */
@@ -0,0 +1,261 @@
+/* actuation_test_ua.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "actuation_test_ua.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "actuation_test";
+
+/**
+ * @brief ActuationTest variables (node context of the shared read callback)
+ */
+typedef enum {
+    ACTUATION_VAR_STATE = 0,
+    ACTUATION_VAR_OUTPUT,
+    ACTUATION_VAR_INPUT,
+    ACTUATION_VAR_CYCLES_REQUESTED,
+    ACTUATION_VAR_CYCLES,
+    ACTUATION_VAR_TIMEOUTS,
+    ACTUATION_VAR_NOT_VISIBLE,
+    ACTUATION_VAR_BOUNCES,
+    ACTUATION_VAR_ERRORS,
+    ACTUATION_VAR_HISTOGRAM,
+    ACTUATION_VAR_SERIES        /* + actuation_series_t */
+} actuation_var_t;
+
+/**
+ * @brief OPC UA read callback for the ActuationTest variables
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Variable (actuation_var_t)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readActuationVariable(UA_Server *server,
+                      const UA_NodeId *sessionId, void *sessionContext,
+                      const UA_NodeId *nodeId, void *nodeContext,
+                      UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                      UA_DataValue *dataValue) {
+    actuation_test_status_t status;
+    actuation_test_get_status(&status);
+
+    UA_StatusCode result = UA_STATUSCODE_GOOD;
+    UA_UInt32 number = 0;
+    UA_Byte bit = 0;
+    unsigned var = (unsigned)(uintptr_t)nodeContext;
+    if (var >= ACTUATION_VAR_SERIES) {
+        const actuation_summary_t *sum = &status.series[var - ACTUATION_VAR_SERIES];
+        UA_UInt32 values[ACTUATION_UA_SUMMARY_FIELDS] = {
+            sum->count, sum->min_us, sum->p50_us, sum->p90_us, sum->p99_us, sum->max_us
+        };
+        result = UA_Variant_setArrayCopy(&dataValue->value, values, ACTUATION_UA_SUMMARY_FIELDS,
+                                         &UA_TYPES[UA_TYPES_UINT32]);
+        dataValue->hasValue = result == UA_STATUSCODE_GOOD;
+        return result;
+    }
+    switch ((actuation_var_t)var) {
+        case ACTUATION_VAR_STATE: {
+            UA_String text = UA_STRING((char *)actuation_test_state_name(status.state));
+            result = UA_Variant_setScalarCopy(&dataValue->value, &text, &UA_TYPES[UA_TYPES_STRING]);
+            break;
+        }
+        case ACTUATION_VAR_OUTPUT:
+        case ACTUATION_VAR_INPUT:
+            bit = var == ACTUATION_VAR_OUTPUT ? status.output : status.input;
+            result = UA_Variant_setScalarCopy(&dataValue->value, &bit, &UA_TYPES[UA_TYPES_BYTE]);
+            break;
+        case ACTUATION_VAR_HISTOGRAM:
+            result = UA_Variant_setArrayCopy(&dataValue->value, status.histogram, ACTUATION_HISTOGRAM_BINS,
+                                             &UA_TYPES[UA_TYPES_UINT32]);
+            break;
+        case ACTUATION_VAR_CYCLES_REQUESTED: number = status.cycles_requested; break;
+        case ACTUATION_VAR_CYCLES:           number = status.cycles; break;
+        case ACTUATION_VAR_TIMEOUTS:         number = status.timeouts; break;
+        case ACTUATION_VAR_NOT_VISIBLE:      number = status.not_visible; break;
+        case ACTUATION_VAR_BOUNCES:          number = status.bounces; break;
+        case ACTUATION_VAR_ERRORS:           number = status.errors; break;
+        default:
+            return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    if (var >= ACTUATION_VAR_CYCLES_REQUESTED && var <= ACTUATION_VAR_ERRORS) {
+        result = UA_Variant_setScalarCopy(&dataValue->value, &number, &UA_TYPES[UA_TYPES_UINT32]);
+    }
+    dataValue->hasValue = result == UA_STATUSCODE_GOOD;
+    return result;
+}
+
+#ifdef UA_ENABLE_METHODCALLS
+
+/**
+ * @brief Map a self-test error to a method result
+ */
+static UA_StatusCode status_from_err(esp_err_t err) {
+    switch (err) {
+        case ESP_OK:                return UA_STATUSCODE_GOOD;
+        case ESP_ERR_INVALID_STATE: return UA_STATUSCODE_BADINVALIDSTATE;
+        case ESP_ERR_NOT_SUPPORTED: return UA_STATUSCODE_BADNOTSUPPORTED;
+        case ESP_ERR_NO_MEM:        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        default:                    return UA_STATUSCODE_BADINTERNALERROR;
+    }
+}
+
+/**
+ * @brief Start(Cycles)
+ */
+static UA_StatusCode
+startMethod(UA_Server *server,
+            const UA_NodeId *sessionId, void *sessionContext,
+            const UA_NodeId *methodId, void *methodContext,
+            const UA_NodeId *objectId, void *objectContext,
+            size_t inputSize, const UA_Variant *input,
+            size_t outputSize, UA_Variant *output) {
+    return status_from_err(actuation_test_start(*(const UA_UInt16 *)input[0].data));
+}
+
+/**
+ * @brief Stop()
+ */
+static UA_StatusCode
+stopMethod(UA_Server *server,
+           const UA_NodeId *sessionId, void *sessionContext,
+           const UA_NodeId *methodId, void *methodContext,
+           const UA_NodeId *objectId, void *objectContext,
+           size_t inputSize, const UA_Variant *input,
+           size_t outputSize, UA_Variant *output) {
+    return status_from_err(actuation_test_stop());
+}
+
+/**
+ * @brief Add one method to the ActuationTest object
+ */
+static void add_method(UA_Server *server, const UA_NodeId *parent, const char *id,
+                       const char *name, const char *description, UA_MethodCallback callback,
+                       size_t inputSize, const UA_Argument *inputs) {
+    UA_MethodAttributes attr = UA_MethodAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.executable = true;
+    attr.userExecutable = true;
+
+    UA_StatusCode status = UA_Server_addMethodNode(server, UA_NODEID_STRING(1, (char *)id), *parent,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                                   UA_QUALIFIEDNAME(1, (char *)name), attr, callback,
+                                                   inputSize, inputs, 0, NULL, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add method %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+#endif /* UA_ENABLE_METHODCALLS */
+
+/**
+ * @brief Add one read-only variable to the ActuationTest object
+ *
+ * @param length 0 for a scalar, otherwise the length of a one-dimensional array
+ */
+static void add_variable(UA_Server *server, const UA_NodeId *parent, const char *id,
+                         const char *name, const char *description, UA_UInt32 typeIndex,
+                         UA_UInt32 length, unsigned var) {
+    UA_UInt32 dimensions[1] = { length };
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.dataType = UA_TYPES[typeIndex].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ;
+    if (length > 0) {
+        attr.valueRank = UA_VALUERANK_ONE_DIMENSION;
+        attr.arrayDimensionsSize = 1;
+        attr.arrayDimensions = dimensions;
+    }
+
+    UA_DataSource source = { readActuationVariable, NULL };
+    UA_StatusCode status = UA_Server_addDataSourceVariableNode(
+        server, UA_NODEID_STRING(1, (char *)id), *parent,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), UA_QUALIFIEDNAME(1, (char *)name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, source,
+        (void *)(uintptr_t)var, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add variable %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Add the ActuationTest object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void actuation_test_add_ua_nodes(UA_Server *server) {
+    UA_NodeId testId = UA_NODEID_STRING(1, "actuation");
+    UA_ObjectAttributes objAttr = UA_ObjectAttributes_default;
+    objAttr.displayName = UA_LOCALIZEDTEXT("en-US", "ActuationTest");
+    objAttr.description = UA_LOCALIZEDTEXT("en-US", "Output to input loopback self-test with "
+                                                    "actuation latency distributions");
+    UA_StatusCode status = UA_Server_addObjectNode(server, testId,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                                   UA_QUALIFIEDNAME(1, "ActuationTest"),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                                   objAttr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add ActuationTest object: 0x%08lX", (unsigned long)status);
+        return;
+    }
+
+    add_variable(server, &testId, "actuation.State", "State",
+                 "Self-test state: idle, running, done, stopped or failed", UA_TYPES_STRING, 0,
+                 ACTUATION_VAR_STATE);
+    add_variable(server, &testId, "actuation.Output", "Output",
+                 "Output bit under test", UA_TYPES_BYTE, 0, ACTUATION_VAR_OUTPUT);
+    add_variable(server, &testId, "actuation.Input", "Input",
+                 "Input bit the output is wired to", UA_TYPES_BYTE, 0, ACTUATION_VAR_INPUT);
+    add_variable(server, &testId, "actuation.CyclesRequested", "CyclesRequested",
+                 "Cycles of the last run", UA_TYPES_UINT32, 0, ACTUATION_VAR_CYCLES_REQUESTED);
+    add_variable(server, &testId, "actuation.Cycles", "Cycles",
+                 "Cycles done", UA_TYPES_UINT32, 0, ACTUATION_VAR_CYCLES);
+    add_variable(server, &testId, "actuation.Timeouts", "Timeouts",
+                 "Cycles without an input edge", UA_TYPES_UINT32, 0, ACTUATION_VAR_TIMEOUTS);
+    add_variable(server, &testId, "actuation.NotVisible", "NotVisible",
+                 "Edges the process image did not show within the timeout", UA_TYPES_UINT32, 0,
+                 ACTUATION_VAR_NOT_VISIBLE);
+    add_variable(server, &testId, "actuation.Bounces", "Bounces",
+                 "Input changes after the edge", UA_TYPES_UINT32, 0, ACTUATION_VAR_BOUNCES);
+    add_variable(server, &testId, "actuation.Errors", "Errors",
+                 "Cycles where the input already had the new level", UA_TYPES_UINT32, 0,
+                 ACTUATION_VAR_ERRORS);
+    add_variable(server, &testId, "actuation.Write", "Write",
+                 "Command to end of the output write (us): count, min, p50, p90, p99, max",
+                 UA_TYPES_UINT32, ACTUATION_UA_SUMMARY_FIELDS, ACTUATION_VAR_SERIES + ACTUATION_WRITE);
+    add_variable(server, &testId, "actuation.On", "On",
+                 "Write to input edge, switching on (us): count, min, p50, p90, p99, max",
+                 UA_TYPES_UINT32, ACTUATION_UA_SUMMARY_FIELDS, ACTUATION_VAR_SERIES + ACTUATION_ON);
+    add_variable(server, &testId, "actuation.Off", "Off",
+                 "Write to input edge, switching off (us): count, min, p50, p90, p99, max",
+                 UA_TYPES_UINT32, ACTUATION_UA_SUMMARY_FIELDS, ACTUATION_VAR_SERIES + ACTUATION_OFF);
+    add_variable(server, &testId, "actuation.Visible", "Visible",
+                 "Command to the change in discrete_inputs (us): count, min, p50, p90, p99, max",
+                 UA_TYPES_UINT32, ACTUATION_UA_SUMMARY_FIELDS, ACTUATION_VAR_SERIES + ACTUATION_VISIBLE);
+    add_variable(server, &testId, "actuation.Histogram", "Histogram",
+                 "Command to input edge, 1 ms bins, the last bin holds the rest", UA_TYPES_UINT32,
+                 ACTUATION_HISTOGRAM_BINS, ACTUATION_VAR_HISTOGRAM);
+
+#ifdef UA_ENABLE_METHODCALLS
+    UA_Argument startArg;
+    UA_Argument_init(&startArg);
+    startArg.name = UA_STRING("Cycles");
+    startArg.description = UA_LOCALIZEDTEXT("en-US", "Cycles of the run (0 = configured)");
+    startArg.dataType = UA_TYPES[UA_TYPES_UINT16].typeId;
+    startArg.valueRank = UA_VALUERANK_SCALAR;
+    add_method(server, &testId, "actuation.Start", "Start",
+               "Toggle the output and measure the input", startMethod, 1, &startArg);
+    add_method(server, &testId, "actuation.Stop", "Stop",
+               "Stop the run after the current cycle", stopMethod, 0, NULL);
+#endif
+
+    ESP_LOGI(TAG, "ActuationTest object added");
+}
@@ -0,0 +1,54 @@
+/* actuation_test_ua.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef ACTUATION_TEST_UA_H
+#define ACTUATION_TEST_UA_H
+
+#include "open62541.h"
+#include "actuation_test.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * OPC UA ActuationTest Object
+ * ============================================================================
+ *
+ * Objects/ActuationTest (ns=1;s=actuation):
+ *
+ *   State                  String     idle, running, done, stopped or failed
+ *   Output, Input          Byte       bits under test
+ *   CyclesRequested        UInt32     cycles of the last run
+ *   Cycles                 UInt32     cycles done
+ *   Timeouts               UInt32     cycles without an input edge
+ *   NotVisible             UInt32     edges the process image did not show in time
+ *   Bounces                UInt32     input changes after the edge
+ *   Errors                 UInt32     input already at the new level
+ *   Write, On, Off,        UInt32[6]  distribution in microseconds:
+ *   Visible                           [count, min, p50, p90, p99, max]
+ *   Histogram              UInt32[64] command to input edge, 1 ms bins
+ *
+ *   Start(Cycles UInt16)   0 = configured number of cycles
+ *   Stop()
+ *
+ * The intervals are described in actuation_meter.h. Percentiles are 0 until
+ * the run is done. The method node ids start with "actuation." and need the
+ * write right, like a write of discrete_outputs. Without
+ * UA_ENABLE_METHODCALLS only the variables are added.
+ */
+
+/** @brief Values of a distribution variable */
+#define ACTUATION_UA_SUMMARY_FIELDS 6
+
+/**
+ * @brief Add the ActuationTest object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void actuation_test_add_ua_nodes(UA_Server *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ACTUATION_TEST_UA_H */
@@ -0,0 +1,226 @@
+/* alarm_engine.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "alarm_engine.h"
+#include "esp_log.h"
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "alarm";
+
+#define ALARM_SEVERITY_CLASS(state)   (((int)(state) + 1) / 2)
+
+/**
+ * @brief Evaluation state of one channel
+ */
+typedef struct {
+    atomic_uchar state;             /**< Current state, read by the summary */
+    uint8_t pending;                /**< State the value is in, waiting for delay_on_ms */
+    uint64_t pending_since_ms;      /**< Acquisition time the value entered pending */
+} channel_state_t;
+
+static alarm_config_t engine_config;
+static bool engine_enabled = false;
+static channel_state_t channels[ALARM_CHANNELS];
+
+/* Transition ring: the I/O polling task writes head, the OPC UA task tail */
+static alarm_transition_t queue[ALARM_QUEUE_DEPTH];
+static atomic_uint queue_head;
+static atomic_uint queue_tail;
+
+static atomic_uint transitions;
+static atomic_uint dropped;
+
+/**
+ * @brief Check the order of the limits in use
+ */
+static bool limits_ordered(const alarm_channel_config_t *c) {
+    int32_t low = -1;
+    const struct { uint8_t bit; uint16_t value; } order[4] = {
+        { ALARM_LIMIT_LOLO, c->lolo }, { ALARM_LIMIT_LO, c->lo },
+        { ALARM_LIMIT_HI, c->hi }, { ALARM_LIMIT_HIHI, c->hihi }
+    };
+    for (int i = 0; i < 4; i++) {
+        if ((c->limits & order[i].bit) == 0) {
+            continue;
+        }
+        // Lo and Hi must not meet, or a value could be in both
+        bool strict = order[i].bit == ALARM_LIMIT_HI &&
+                      (c->limits & (ALARM_LIMIT_LO | ALARM_LIMIT_LOLO)) != 0;
+        if ((int32_t)order[i].value < low || (strict && (int32_t)order[i].value == low)) {
+            return false;
+        }
+        low = order[i].value;
+    }
+    return true;
+}
+
+esp_err_t alarm_engine_init(const alarm_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < ALARM_CHANNELS; i++) {
+        if (!limits_ordered(&config->channels[i])) {
+            ESP_LOGE(TAG, "adc_channel_%d: limits must be ordered LoLo <= Lo < Hi <= HiHi", i + 1);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    engine_config = *config;
+    memset(channels, 0, sizeof(channels));
+    atomic_store(&queue_head, 0);
+    atomic_store(&queue_tail, 0);
+    atomic_store(&transitions, 0);
+    atomic_store(&dropped, 0);
+    engine_enabled = config->enable;
+
+    int monitored = 0;
+    for (int i = 0; i < ALARM_CHANNELS; i++) {
+        monitored += config->channels[i].limits != 0;
+    }
+    ESP_LOGI(TAG, "Limit alarms %s, %d of %d channels monitored",
+             engine_enabled ? "enabled" : "disabled", monitored, ALARM_CHANNELS);
+    return ESP_OK;
+}
+
+/**
+ * @brief State a value belongs to, with hysteresis around the current state
+ *
+ * @param c Channel limits
+ * @param current Current state
+ * @param value Scanned value
+ * @return alarm_state_t Target state
+ */
+static alarm_state_t target_state(const alarm_channel_config_t *c, alarm_state_t current, uint16_t value) {
+    int32_t v = value;
+    int32_t h = c->hysteresis;
+    bool high = current == ALARM_HI || current == ALARM_HIHI;
+    bool low = current == ALARM_LO || current == ALARM_LOLO;
+
+    if ((c->limits & ALARM_LIMIT_HIHI) &&
+        (v >= c->hihi || (current == ALARM_HIHI && v > (int32_t)c->hihi - h))) {
+        return ALARM_HIHI;
+    }
+    if ((c->limits & ALARM_LIMIT_HI) && (v >= c->hi || (high && v > (int32_t)c->hi - h))) {
+        return ALARM_HI;
+    }
+    if ((c->limits & ALARM_LIMIT_LOLO) &&
+        (v <= c->lolo || (current == ALARM_LOLO && v < (int32_t)c->lolo + h))) {
+        return ALARM_LOLO;
+    }
+    if ((c->limits & ALARM_LIMIT_LO) && (v <= c->lo || (low && v < (int32_t)c->lo + h))) {
+        return ALARM_LO;
+    }
+    return ALARM_NORMAL;
+}
+
+/**
+ * @brief Limit that belongs to a state
+ */
+static uint16_t state_limit(const alarm_channel_config_t *c, alarm_state_t state) {
+    switch (state) {
+        case ALARM_LOLO: return c->lolo;
+        case ALARM_LO:   return c->lo;
+        case ALARM_HI:   return c->hi;
+        case ALARM_HIHI: return c->hihi;
+        default:         return 0;
+    }
+}
+
+/**
+ * @brief Queue a transition (producer only)
+ */
+static void queue_push(const alarm_transition_t *transition) {
+    uint32_t head = atomic_load_explicit(&queue_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&queue_tail, memory_order_acquire);
+    if (head - tail >= ALARM_QUEUE_DEPTH) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+    queue[head & (ALARM_QUEUE_DEPTH - 1)] = *transition;
+    atomic_store_explicit(&queue_head, head + 1, memory_order_release);
+}
+
+/**
+ * @brief Evaluate one scanned value
+ *
+ * A transition to a state that is at least as severe as the current one
+ * waits until the value stayed in it for delay_on_ms; every other transition
+ * happens at once.
+ *
+ * @param channel ADC channel (0 to ALARM_CHANNELS-1)
+ * @param value Filtered value in raw counts
+ * @param timestamp_ms Acquisition time (tick milliseconds)
+ */
+void alarm_engine_evaluate(int channel, uint16_t value, uint64_t timestamp_ms) {
+    if (!engine_enabled || channel < 0 || channel >= ALARM_CHANNELS) {
+        return;
+    }
+    const alarm_channel_config_t *c = &engine_config.channels[channel];
+    if (c->limits == 0) {
+        return;
+    }
+
+    channel_state_t *s = &channels[channel];
+    alarm_state_t current = (alarm_state_t)atomic_load_explicit(&s->state, memory_order_relaxed);
+    alarm_state_t target = target_state(c, current, value);
+    if (target == current) {
+        s->pending = (uint8_t)current;
+        return;
+    }
+    if (target != (alarm_state_t)s->pending) {
+        s->pending = (uint8_t)target;
+        s->pending_since_ms = timestamp_ms;
+    }
+    bool escalation = target != ALARM_NORMAL &&
+                      ALARM_SEVERITY_CLASS(target) >= ALARM_SEVERITY_CLASS(current);
+    if (escalation && timestamp_ms - s->pending_since_ms < c->delay_on_ms) {
+        return;
+    }
+
+    atomic_store_explicit(&s->state, (uint8_t)target, memory_order_relaxed);
+    atomic_fetch_add_explicit(&transitions, 1, memory_order_relaxed);
+
+    alarm_transition_t transition = {
+        .channel = (uint8_t)channel,
+        .from = (uint8_t)current,
+        .to = (uint8_t)target,
+        .value = value,
+        .limit = state_limit(c, target != ALARM_NORMAL ? target : current),
+        .timestamp_ms = timestamp_ms
+    };
+    queue_push(&transition);
+}
+
+bool alarm_engine_pop(alarm_transition_t *transition) {
+    uint32_t tail = atomic_load_explicit(&queue_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&queue_head, memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    *transition = queue[tail & (ALARM_QUEUE_DEPTH - 1)];
+    atomic_store_explicit(&queue_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void alarm_engine_get_status(alarm_status_t *status) {
+    if (status == NULL) {
+        return;
+    }
+    status->active = 0;
+    for (int i = 0; i < ALARM_CHANNELS; i++) {
+        status->state[i] = (alarm_state_t)atomic_load_explicit(&channels[i].state, memory_order_relaxed);
+        status->active += status->state[i] != ALARM_NORMAL;
+    }
+    status->transitions = atomic_load_explicit(&transitions, memory_order_relaxed);
+    status->dropped = atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
+const char *alarm_state_name(alarm_state_t state) {
+    switch (state) {
+        case ALARM_LO:   return "Lo";
+        case ALARM_HI:   return "Hi";
+        case ALARM_LOLO: return "LoLo";
+        case ALARM_HIHI: return "HiHi";
+        default:         return "Normal";
+    }
+}
@@ -0,0 +1,155 @@
+/* alarm_engine.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef ALARM_ENGINE_H
+#define ALARM_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Limit Alarm Engine
+ * ============================================================================
+ *
+ * Every ADC scan passes the filtered value of each channel to
+ * alarm_engine_evaluate() (I/O polling task). The engine keeps one limit
+ * state per channel:
+ *
+ *   LoLo <= value <= Lo        Normal        Hi <= value <= HiHi
+ *
+ * A state is entered when the value reaches its limit and left only when the
+ * value is back by more than the hysteresis. A more severe state (or a jump
+ * from Lo to Hi) is entered only after the value stayed there for delay_on_ms;
+ * a return towards Normal is immediate, so a short spike never raises an
+ * alarm and an alarm never lingers.
+ *
+ * Only state transitions leave the engine: they are queued in a lock-free
+ * single-producer/single-consumer ring and drained by the OPC UA task
+ * (alarm_engine_ua.h), which turns each one into an event.
+ */
+
+/** @brief Number of monitored ADC channels (matches NUM_ADC_CHANNELS) */
+#define ALARM_CHANNELS          4
+/** @brief Transitions queued between the I/O task and the OPC UA task (power of two) */
+#define ALARM_QUEUE_DEPTH       32
+
+/** @brief Limit bits of alarm_channel_config_t.limits */
+#define ALARM_LIMIT_LOLO        (1u << 0)
+#define ALARM_LIMIT_LO          (1u << 1)
+#define ALARM_LIMIT_HI          (1u << 2)
+#define ALARM_LIMIT_HIHI        (1u << 3)
+#define ALARM_LIMIT_ALL         (ALARM_LIMIT_LOLO | ALARM_LIMIT_LO | ALARM_LIMIT_HI | ALARM_LIMIT_HIHI)
+
+/**
+ * @brief Limit state of a channel
+ *
+ * Ordered so that (state + 1) / 2 is the severity class: 0 normal, 1 Lo/Hi,
+ * 2 LoLo/HiHi.
+ */
+typedef enum {
+    ALARM_NORMAL = 0,
+    ALARM_LO,
+    ALARM_HI,
+    ALARM_LOLO,
+    ALARM_HIHI
+} alarm_state_t;
+
+/**
+ * @brief Limits of one channel, in raw ADC counts like the deadband
+ */
+typedef struct {
+    uint8_t limits;             /**< Limits in use (ALARM_LIMIT_* bits, 0 = not monitored) */
+    uint16_t lolo;              /**< LoLo limit: value <= lolo */
+    uint16_t lo;                /**< Lo limit: value <= lo */
+    uint16_t hi;                /**< Hi limit: value >= hi */
+    uint16_t hihi;              /**< HiHi limit: value >= hihi */
+    uint16_t hysteresis;        /**< Counts the value must move back to leave a state */
+    uint16_t delay_on_ms;       /**< Time a more severe state must persist before it is entered */
+} alarm_channel_config_t;
+
+/**
+ * @brief Alarm engine configuration
+ */
+typedef struct {
+    bool enable;                                        /**< Evaluate the limits */
+    alarm_channel_config_t channels[ALARM_CHANNELS];    /**< Limits per ADC channel */
+} alarm_config_t;
+
+/**
+ * @brief One state transition
+ */
+typedef struct {
+    uint8_t channel;            /**< ADC channel (0 to ALARM_CHANNELS-1) */
+    uint8_t from;               /**< Previous state (alarm_state_t) */
+    uint8_t to;                 /**< New state (alarm_state_t) */
+    uint16_t value;             /**< Value that caused the transition */
+    uint16_t limit;             /**< Limit of the new state (of the old one for Normal) */
+    uint64_t timestamp_ms;      /**< Acquisition time (tick milliseconds, like io_cache) */
+} alarm_transition_t;
+
+/**
+ * @brief Alarm summary
+ */
+typedef struct {
+    alarm_state_t state[ALARM_CHANNELS];    /**< Current state per channel */
+    uint32_t active;                        /**< Channels not in ALARM_NORMAL */
+    uint32_t transitions;                   /**< Transitions since start */
+    uint32_t dropped;                       /**< Transitions lost because the queue was full */
+} alarm_status_t;
+
+/**
+ * @brief Initialize the engine
+ *
+ * The limits of a channel must be ordered (LoLo <= Lo < Hi <= HiHi, for the
+ * limits in use). Call before the I/O polling task starts.
+ *
+ * @param config Configuration
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG for unordered limits
+ */
+esp_err_t alarm_engine_init(const alarm_config_t *config);
+
+/**
+ * @brief Evaluate one scanned value
+ *
+ * Called from the acquisition path only (single producer).
+ *
+ * @param channel ADC channel (0 to ALARM_CHANNELS-1)
+ * @param value Filtered value in raw counts
+ * @param timestamp_ms Acquisition time (tick milliseconds)
+ */
+void alarm_engine_evaluate(int channel, uint16_t value, uint64_t timestamp_ms);
+
+/**
+ * @brief Take the oldest queued transition
+ *
+ * Called from the OPC UA task only (single consumer).
+ *
+ * @param transition Pointer to store the transition
+ * @return true if a transition was taken
+ */
+bool alarm_engine_pop(alarm_transition_t *transition);
+
+/**
+ * @brief Get the alarm summary
+ *
+ * @param status Pointer to store the summary
+ */
+void alarm_engine_get_status(alarm_status_t *status);
+
+/**
+ * @brief Name of a limit state
+ *
+ * @param state State
+ * @return const char* "Normal", "Lo", "Hi", "LoLo" or "HiHi"
+ */
+const char *alarm_state_name(alarm_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ALARM_ENGINE_H */
@@ -0,0 +1,302 @@
+/* alarm_engine_ua.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "alarm_engine_ua.h"
+#include "clock_service_ua.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "alarm";
+
+#define ALARM_STATES_BUFFER     160     /**< Size of the States string */
+#define ALARM_MESSAGE_BUFFER    80      /**< Size of an event message */
+
+/**
+ * @brief Summary variables (node context of the shared read callback)
+ */
+typedef enum {
+    ALARM_VAR_ACTIVE_COUNT = 0,
+    ALARM_VAR_STATES,
+    ALARM_VAR_TRANSITIONS,
+    ALARM_VAR_DROPPED
+} alarm_var_t;
+
+/**
+ * @brief OPC UA read callback for the summary variables
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Variable (alarm_var_t)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readAlarmVariable(UA_Server *server,
+                  const UA_NodeId *sessionId, void *sessionContext,
+                  const UA_NodeId *nodeId, void *nodeContext,
+                  UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                  UA_DataValue *dataValue) {
+    alarm_status_t status;
+    alarm_engine_get_status(&status);
+
+    switch ((alarm_var_t)(uintptr_t)nodeContext) {
+        case ALARM_VAR_ACTIVE_COUNT:
+            UA_Variant_setScalarCopy(&dataValue->value, &status.active, &UA_TYPES[UA_TYPES_UINT32]);
+            break;
+        case ALARM_VAR_STATES: {
+            char json[ALARM_STATES_BUFFER];
+            int len = snprintf(json, sizeof(json), "{");
+            for (int i = 0; i < ALARM_CHANNELS && len > 0 && len < (int)sizeof(json); i++) {
+                len += snprintf(json + len, sizeof(json) - len, "%s\"adc_channel_%d\":\"%s\"",
+                                i > 0 ? "," : "", i + 1, alarm_state_name(status.state[i]));
+            }
+            if (len > 0 && len < (int)sizeof(json)) {
+                len += snprintf(json + len, sizeof(json) - len, "}");
+            }
+            if (len <= 0 || len >= (int)sizeof(json)) {
+                return UA_STATUSCODE_BADINTERNALERROR;
+            }
+            UA_String value = { (size_t)len, (UA_Byte *)json };
+            UA_Variant_setScalarCopy(&dataValue->value, &value, &UA_TYPES[UA_TYPES_STRING]);
+            break;
+        }
+        case ALARM_VAR_TRANSITIONS:
+            UA_Variant_setScalarCopy(&dataValue->value, &status.transitions, &UA_TYPES[UA_TYPES_UINT32]);
+            break;
+        case ALARM_VAR_DROPPED:
+            UA_Variant_setScalarCopy(&dataValue->value, &status.dropped, &UA_TYPES[UA_TYPES_UINT32]);
+            break;
+        default:
+            return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Describe a transition for the log and the event message
+ */
+static void format_message(const alarm_transition_t *t, char *buf, size_t size) {
+    if (t->to == ALARM_NORMAL) {
+        snprintf(buf, size, "adc_channel_%u %s cleared: %u", t->channel + 1,
+                 alarm_state_name((alarm_state_t)t->from), t->value);
+    } else if (t->to == ALARM_HI || t->to == ALARM_HIHI) {
+        snprintf(buf, size, "adc_channel_%u %s: %u >= %u", t->channel + 1,
+                 alarm_state_name((alarm_state_t)t->to), t->value, t->limit);
+    } else {
+        snprintf(buf, size, "adc_channel_%u %s: %u <= %u", t->channel + 1,
+                 alarm_state_name((alarm_state_t)t->to), t->value, t->limit);
+    }
+}
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+
+#define ALARM_EVENT_TYPE_ID     UA_NODEID_STRING(1, "alarms.LimitAlarmEventType")
+
+/**
+ * @brief Fire the event of one transition
+ *
+ * @param server OPC UA server instance
+ * @param t Transition
+ * @param message Event message
+ */
+static void fire_event(UA_Server *server, const alarm_transition_t *t, const char *message) {
+    UA_NodeId eventId;
+    UA_StatusCode status = UA_Server_createEvent(server, ALARM_EVENT_TYPE_ID, &eventId);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to create event: 0x%08lX", (unsigned long)status);
+        return;
+    }
+
+    char source[16];
+    snprintf(source, sizeof(source), "adc_channel_%u", t->channel + 1);
+    UA_UInt16 severity = t->to == ALARM_NORMAL ? ALARM_SEVERITY_NORMAL :
+                         t->to == ALARM_LOLO || t->to == ALARM_HIHI ? ALARM_SEVERITY_CRITICAL :
+                         ALARM_SEVERITY_WARNING;
+    UA_DateTime time = clock_service_ua_from_tick_ms(t->timestamp_ms);
+    UA_LocalizedText text = UA_LOCALIZEDTEXT("en-US", (char *)message);
+    UA_String sourceName = UA_STRING(source);
+    UA_String state = UA_STRING((char *)alarm_state_name((alarm_state_t)t->to));
+
+    UA_Server_writeObjectProperty_scalar(server, eventId, UA_QUALIFIEDNAME(0, "Severity"),
+                                         &severity, &UA_TYPES[UA_TYPES_UINT16]);
+    UA_Server_writeObjectProperty_scalar(server, eventId, UA_QUALIFIEDNAME(0, "Message"),
+                                         &text, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    UA_Server_writeObjectProperty_scalar(server, eventId, UA_QUALIFIEDNAME(0, "SourceName"),
+                                         &sourceName, &UA_TYPES[UA_TYPES_STRING]);
+    UA_Server_writeObjectProperty_scalar(server, eventId, UA_QUALIFIEDNAME(0, "Time"),
+                                         &time, &UA_TYPES[UA_TYPES_DATETIME]);
+    UA_Server_writeObjectProperty_scalar(server, eventId, UA_QUALIFIEDNAME(1, "LimitState"),
+                                         &state, &UA_TYPES[UA_TYPES_STRING]);
+    UA_Server_writeObjectProperty_scalar(server, eventId, UA_QUALIFIEDNAME(1, "Value"),
+                                         &t->value, &UA_TYPES[UA_TYPES_UINT16]);
+    UA_Server_writeObjectProperty_scalar(server, eventId, UA_QUALIFIEDNAME(1, "Limit"),
+                                         &t->limit, &UA_TYPES[UA_TYPES_UINT16]);
+
+    status = UA_Server_triggerEvent(server, eventId, UA_NODEID_STRING(1, source), NULL, UA_TRUE);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to trigger event: 0x%08lX", (unsigned long)status);
+        UA_Server_deleteNode(server, eventId, UA_TRUE);
+    }
+}
+
+/**
+ * @brief Add a mandatory property to the event type
+ */
+static void add_event_property(UA_Server *server, const char *id, const char *name,
+                               const char *description, UA_UInt32 typeIndex) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.dataType = UA_TYPES[typeIndex].typeId;
+    attr.valueRank = UA_VALUERANK_SCALAR;
+
+    UA_NodeId propertyId = UA_NODEID_STRING(1, (char *)id);
+    UA_StatusCode status = UA_Server_addVariableNode(
+        server, propertyId, ALARM_EVENT_TYPE_ID, UA_NODEID_NUMERIC(0, UA_NS0ID_HASPROPERTY),
+        UA_QUALIFIEDNAME(1, (char *)name), UA_NODEID_NUMERIC(0, UA_NS0ID_PROPERTYTYPE),
+        attr, NULL, NULL);
+    if (status == UA_STATUSCODE_GOOD) {
+        // Mandatory: every event instance gets its own copy
+        status = UA_Server_addReference(server, propertyId,
+                                        UA_NODEID_NUMERIC(0, UA_NS0ID_HASMODELLINGRULE),
+                                        UA_EXPANDEDNODEID_NUMERIC(0, UA_NS0ID_MODELLINGRULE_MANDATORY),
+                                        true);
+    }
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add event property %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Add LimitAlarmEventType below BaseEventType
+ *
+ * @return UA_StatusCode Status of adding the type node
+ */
+static UA_StatusCode add_event_type(UA_Server *server) {
+    UA_ObjectTypeAttributes attr = UA_ObjectTypeAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", "LimitAlarmEventType");
+    attr.description = UA_LOCALIZEDTEXT("en-US", "Limit state transition of an ADC channel");
+    UA_StatusCode status = UA_Server_addObjectTypeNode(server, ALARM_EVENT_TYPE_ID,
+                                                       UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE),
+                                                       UA_NODEID_NUMERIC(0, UA_NS0ID_HASSUBTYPE),
+                                                       UA_QUALIFIEDNAME(1, "LimitAlarmEventType"),
+                                                       attr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        return status;
+    }
+    add_event_property(server, "alarms.LimitAlarmEventType.LimitState", "LimitState",
+                       "New state: Normal, Lo, Hi, LoLo or HiHi", UA_TYPES_STRING);
+    add_event_property(server, "alarms.LimitAlarmEventType.Value", "Value",
+                       "Value in raw counts that caused the transition", UA_TYPES_UINT16);
+    add_event_property(server, "alarms.LimitAlarmEventType.Limit", "Limit",
+                       "Limit of the new state (of the cleared one for Normal)", UA_TYPES_UINT16);
+    return UA_STATUSCODE_GOOD;
+}
+
+#endif /* UA_ENABLE_SUBSCRIPTIONS_EVENTS */
+
+/**
+ * @brief Drain queued transitions (repeated callback in the OPC UA task)
+ *
+ * @param server OPC UA server instance
+ * @param data Not used
+ */
+static void drain_transitions(UA_Server *server, void *data) {
+    alarm_transition_t t;
+    char message[ALARM_MESSAGE_BUFFER];
+    while (alarm_engine_pop(&t)) {
+        format_message(&t, message, sizeof(message));
+        if (t.to == ALARM_NORMAL) {
+            ESP_LOGI(TAG, "%s", message);
+        } else {
+            ESP_LOGW(TAG, "%s", message);
+        }
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+        fire_event(server, &t, message);
+#endif
+    }
+}
+
+/**
+ * @brief Add one read-only summary variable to the Alarms object
+ */
+static void add_variable(UA_Server *server, const UA_NodeId *parent, const char *id,
+                         const char *name, const char *description, UA_UInt32 typeIndex,
+                         alarm_var_t var) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.dataType = UA_TYPES[typeIndex].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ;
+
+    UA_DataSource source = { readAlarmVariable, NULL };
+    UA_StatusCode status = UA_Server_addDataSourceVariableNode(
+        server, UA_NODEID_STRING(1, (char *)id), *parent,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), UA_QUALIFIEDNAME(1, (char *)name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, source,
+        (void *)(uintptr_t)var, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add variable %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Add the Alarms object and start draining transitions
+ *
+ * @param server OPC UA server instance
+ */
+void alarm_engine_add_ua_nodes(UA_Server *server) {
+    UA_NodeId alarmsId = UA_NODEID_STRING(1, "alarms");
+
+    UA_ObjectAttributes objAttr = UA_ObjectAttributes_default;
+    objAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Alarms");
+    objAttr.description = UA_LOCALIZEDTEXT("en-US", "Limit alarms of the ADC channels");
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    objAttr.eventNotifier = 0x01;   // SubscribeToEvents
+#endif
+    UA_StatusCode status = UA_Server_addObjectNode(server, alarmsId,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                                   UA_QUALIFIEDNAME(1, "Alarms"),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                                   objAttr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add Alarms object: 0x%08lX", (unsigned long)status);
+        return;
+    }
+
+    add_variable(server, &alarmsId, "alarms.ActiveCount", "ActiveCount",
+                 "ADC channels in a limit state other than Normal", UA_TYPES_UINT32,
+                 ALARM_VAR_ACTIVE_COUNT);
+    add_variable(server, &alarmsId, "alarms.States", "States",
+                 "Limit state of every ADC channel (JSON)", UA_TYPES_STRING, ALARM_VAR_STATES);
+    add_variable(server, &alarmsId, "alarms.Transitions", "Transitions",
+                 "Limit state transitions since start", UA_TYPES_UINT32, ALARM_VAR_TRANSITIONS);
+    add_variable(server, &alarmsId, "alarms.Dropped", "Dropped",
+                 "Transitions lost because the queue was full", UA_TYPES_UINT32, ALARM_VAR_DROPPED);
+
+#ifdef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+    status = add_event_type(server);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add LimitAlarmEventType: 0x%08lX", (unsigned long)status);
+    }
+    // The ADC variables are the event sources of Alarms
+    for (int i = 0; i < ALARM_CHANNELS; i++) {
+        char source[16];
+        snprintf(source, sizeof(source), "adc_channel_%d", i + 1);
+        UA_Server_addReference(server, alarmsId, UA_NODEID_NUMERIC(0, UA_NS0ID_HASEVENTSOURCE),
+                               UA_EXPANDEDNODEID_STRING(1, source), true);
+    }
+#endif
+
+    status = UA_Server_addRepeatedCallback(server, drain_transitions, NULL,
+                                           ALARM_DRAIN_INTERVAL_MS, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add the alarm drain callback: 0x%08lX", (unsigned long)status);
+    }
+}
@@ -0,0 +1,56 @@
+/* alarm_engine_ua.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef ALARM_ENGINE_UA_H
+#define ALARM_ENGINE_UA_H
+
+#include "open62541.h"
+#include "alarm_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * OPC UA Alarms Object
+ * ============================================================================
+ *
+ * Objects/Alarms (ns=1;s=alarms), event notifier:
+ *
+ *   ActiveCount   UInt32   channels not in Normal
+ *   States        String   state of every monitored channel as JSON
+ *   Transitions   UInt32   transitions since start
+ *   Dropped       UInt32   transitions lost because the queue was full
+ *
+ * Every transition becomes one LimitAlarmEventType event (ns=1;s=alarms.
+ * LimitAlarmEventType, a BaseEventType) with SourceNode adc_channel_N, Time
+ * the acquisition time, Severity by state and the properties LimitState,
+ * Value and Limit. Alarms has HasEventSource references to the ADC
+ * variables, so the events reach subscribers of Alarms and of the Server
+ * object. The queue is drained every ALARM_DRAIN_INTERVAL_MS in the OPC UA
+ * task. Without UA_ENABLE_SUBSCRIPTIONS_EVENTS (nano profile) transitions
+ * are only logged; the summary variables remain.
+ */
+
+/** @brief Interval of the drain callback in the OPC UA task */
+#define ALARM_DRAIN_INTERVAL_MS     10
+/** @brief Event severity of LoLo and HiHi */
+#define ALARM_SEVERITY_CRITICAL     800
+/** @brief Event severity of Lo and Hi */
+#define ALARM_SEVERITY_WARNING      500
+/** @brief Event severity of the return to Normal */
+#define ALARM_SEVERITY_NORMAL       100
+
+/**
+ * @brief Add the Alarms object and start draining transitions
+ *
+ * Call after the ADC variables were added.
+ *
+ * @param server OPC UA server instance
+ */
+void alarm_engine_add_ua_nodes(UA_Server *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ALARM_ENGINE_UA_H */
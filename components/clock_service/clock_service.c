@@ -0,0 +1,601 @@
+/* clock_service.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "clock_service.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+static const char *TAG = "clock";
+
+#define CLOCK_TASK_STACK            4096    /**< NTP task stack size */
+#define CLOCK_TASK_PRIORITY         2       /**< Below OPC UA, MQTT and I/O polling */
+#define CLOCK_SERVER_NAME_LEN       64      /**< Longest server name (time_config_t) */
+#define CLOCK_DELAY_HISTORY         8       /**< Round trips kept for the spike filter */
+#define CLOCK_SPIKE_MIN_US          2000    /**< Round trip excess that is never a spike */
+#define CLOCK_FLL_TIME_CONSTANT_S   64      /**< Weight of an interval: interval / (interval + this) */
+
+#define NTP_PACKET_SIZE             48
+#define NTP_UNIX_OFFSET_S           2208988800ULL   /**< 1900-01-01 to 1970-01-01 */
+
+/**
+ * @brief Mapping from the monotonic clock to UTC
+ */
+typedef struct {
+    int64_t anchor_mono_us;     /**< esp_timer time of the anchor */
+    int64_t anchor_utc_us;      /**< UTC at the anchor */
+    int64_t slew_us;            /**< Offset to remove by slewing from the anchor on */
+    int32_t freq_ppb;           /**< Frequency correction */
+} clock_map_t;
+
+/**
+ * @brief One NTP exchange
+ */
+typedef struct {
+    int64_t mono_us;            /**< esp_timer time halfway through the exchange */
+    int64_t offset_us;          /**< Server minus local time */
+    int64_t delay_us;           /**< Round trip minus server processing */
+    uint8_t stratum;            /**< Server stratum */
+} ntp_sample_t;
+
+/* The mapping is read without a lock: the writer makes the sequence odd while
+ * it changes the mapping, readers retry until they saw an even, unchanged one */
+static clock_map_t clock_map;
+static atomic_uint map_sequence;
+
+static SemaphoreHandle_t state_mutex = NULL;
+static clock_service_status_t state = { .server = -1 };
+static bool synced_ever = false;
+static int64_t last_sample_mono_us = 0;
+static int64_t delay_history[CLOCK_DELAY_HISTORY];
+static int delay_history_next = 0;
+static uint32_t spike_run = 0;
+
+static clock_service_config_t service_config;
+static char server_names[CLOCK_SERVERS][CLOCK_SERVER_NAME_LEN];
+static TaskHandle_t clock_task_handle = NULL;
+static int64_t tick_offset_us = 0;
+
+/**
+ * @brief Read a consistent copy of the mapping
+ */
+static void map_load(clock_map_t *map) {
+    unsigned sequence;
+    do {
+        sequence = atomic_load_explicit(&map_sequence, memory_order_acquire);
+        *map = clock_map;
+        atomic_thread_fence(memory_order_acquire);
+    } while ((sequence & 1u) != 0 ||
+             sequence != atomic_load_explicit(&map_sequence, memory_order_relaxed));
+}
+
+/**
+ * @brief Replace the mapping (single writer, under state_mutex)
+ */
+static void map_store(const clock_map_t *map) {
+    atomic_fetch_add_explicit(&map_sequence, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    clock_map = *map;
+    atomic_fetch_add_explicit(&map_sequence, 1, memory_order_release);
+}
+
+/**
+ * @brief Part of the slew applied at a time
+ */
+static int64_t map_slew_applied(const clock_map_t *map, int64_t mono_us) {
+    int64_t dt = mono_us - map->anchor_mono_us;
+    if (dt <= 0) {
+        return 0;
+    }
+    int64_t limit = dt * CLOCK_SLEW_MAX_PPM / 1000000;
+    if (map->slew_us > limit) {
+        return limit;
+    }
+    if (map->slew_us < -limit) {
+        return -limit;
+    }
+    return map->slew_us;
+}
+
+/**
+ * @brief UTC of a monotonic time under a mapping
+ */
+static int64_t map_utc(const clock_map_t *map, int64_t mono_us) {
+    int64_t dt = mono_us - map->anchor_mono_us;
+    return map->anchor_utc_us + dt + dt * map->freq_ppb / 1000000000 +
+           map_slew_applied(map, mono_us);
+}
+
+int64_t clock_service_utc_us(int64_t mono_us) {
+    if (atomic_load_explicit(&map_sequence, memory_order_acquire) == 0) {
+        // Not started: the system time is all there is
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - (esp_timer_get_time() - mono_us);
+    }
+    clock_map_t map;
+    map_load(&map);
+    return map_utc(&map, mono_us);
+}
+
+int64_t clock_service_now_us(void) {
+    return clock_service_utc_us(esp_timer_get_time());
+}
+
+int64_t clock_service_utc_from_tick_ms(uint64_t tick_ms) {
+    int64_t offset = tick_offset_us;
+    if (offset == 0) {
+        offset = esp_timer_get_time() - (int64_t)xTaskGetTickCount() * portTICK_PERIOD_MS * 1000;
+    }
+    return clock_service_utc_us((int64_t)tick_ms * 1000 + offset);
+}
+
+/**
+ * @brief Current state, the holdover check included (under state_mutex)
+ */
+static clock_sync_status_t current_status(int64_t now_us) {
+    if (!synced_ever) {
+        return CLOCK_UNSYNCED;
+    }
+    int64_t holdover_us = (int64_t)CLOCK_HOLDOVER_POLLS * state.poll_s * 1000000;
+    return now_us - last_sample_mono_us > holdover_us ? CLOCK_HOLDOVER : CLOCK_SYNCED;
+}
+
+clock_sync_status_t clock_service_sync_status(void) {
+    if (state_mutex == NULL) {
+        return CLOCK_UNSYNCED;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    clock_sync_status_t status = current_status(esp_timer_get_time());
+    xSemaphoreGive(state_mutex);
+    return status;
+}
+
+/**
+ * @brief Get the clock state
+ *
+ * The error bound adds half the round trip of the last sample, the part of
+ * its offset not yet slewed away and CLOCK_WANDER_PPM of the time since.
+ *
+ * @param status Pointer to store the state
+ */
+void clock_service_get_status(clock_service_status_t *status) {
+    if (status == NULL) {
+        return;
+    }
+    if (state_mutex == NULL) {
+        memset(status, 0, sizeof(*status));
+        status->server = -1;
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    clock_map_t map;
+    map_load(&map);
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *status = state;
+    status->status = current_status(now);
+    if (synced_ever) {
+        int64_t remaining = map.slew_us - map_slew_applied(&map, now);
+        status->error_us = state.delay_us / 2 + (remaining < 0 ? -remaining : remaining) +
+                           (now - last_sample_mono_us) * CLOCK_WANDER_PPM / 1000000;
+    } else {
+        status->error_us = -1;
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+/**
+ * @brief Apply one offset at the current time
+ *
+ * @param now_us esp_timer time the offset refers to
+ * @param offset_us Reference minus local time
+ * @param delay_us Round trip
+ * @return true if the clock was stepped
+ */
+static bool discipline(int64_t now_us, int64_t offset_us, int64_t delay_us) {
+    clock_map_t old_map, map;
+    map_load(&old_map);
+    bool step = !synced_ever || offset_us > CLOCK_STEP_THRESHOLD_US ||
+                offset_us < -CLOCK_STEP_THRESHOLD_US;
+
+    map.anchor_mono_us = now_us;
+    map.anchor_utc_us = map_utc(&old_map, now_us);
+    map.freq_ppb = old_map.freq_ppb;
+    if (step) {
+        map.anchor_utc_us += offset_us;
+        map.slew_us = 0;
+        state.steps++;
+    } else {
+        // Beyond the rest of the previous slew, the offset grew by the frequency error
+        int64_t unapplied = old_map.slew_us - map_slew_applied(&old_map, now_us);
+        int64_t interval = now_us - last_sample_mono_us;
+        const int64_t freq_max = (int64_t)CLOCK_FREQ_MAX_PPM * 1000;
+        int64_t residual_ppb = interval > 0 ? (offset_us - unapplied) * 1000000000 / interval : 0;
+        // A residual no crystal can explain is a jump of the reference: slewed, not learned
+        if (interval > 0 && residual_ppb <= freq_max && residual_ppb >= -freq_max) {
+            int64_t interval_s = interval / 1000000;
+            int64_t freq = old_map.freq_ppb + residual_ppb * interval_s /
+                           (interval_s + CLOCK_FLL_TIME_CONSTANT_S);
+            map.freq_ppb = (int32_t)(freq > freq_max ? freq_max : freq < -freq_max ? -freq_max : freq);
+        }
+        map.slew_us = offset_us;
+    }
+    map_store(&map);
+
+    synced_ever = true;
+    last_sample_mono_us = now_us;
+    state.offset_us = offset_us;
+    state.delay_us = delay_us;
+    state.freq_ppb = map.freq_ppb;
+    state.last_sync_utc_us = map_utc(&map, now_us);
+    state.samples++;
+    return step;
+}
+
+/**
+ * @brief Feed one offset measurement into the discipline
+ *
+ * The offset is moved from the time of the measurement to now: in between,
+ * the local clock advanced by the slew and the frequency correction as well.
+ *
+ * @param mono_us esp_timer time of the measurement
+ * @param offset_us Reference time minus local time at mono_us
+ * @param delay_us Round trip of the measurement
+ */
+void clock_service_apply_sample(int64_t mono_us, int64_t offset_us, int64_t delay_us) {
+    if (state_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    clock_map_t map;
+    map_load(&map);
+    int64_t local_advance = map_utc(&map, now) - map_utc(&map, mono_us);
+    int64_t true_advance = (now - mono_us) + (now - mono_us) * map.freq_ppb / 1000000000;
+    bool step = discipline(now, offset_us - (local_advance - true_advance), delay_us);
+    xSemaphoreGive(state_mutex);
+
+    if (step) {
+        ESP_LOGI(TAG, "Clock stepped by %lld us", (long long)offset_us);
+    }
+}
+
+/**
+ * @brief Convert an NTP timestamp to Unix microseconds
+ *
+ * Seconds with the top bit clear belong to the era starting 2036 (RFC 4330).
+ */
+static int64_t ntp_to_unix_us(const uint8_t *p) {
+    uint32_t seconds = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    uint32_t fraction = ((uint32_t)p[4] << 24) | ((uint32_t)p[5] << 16) | ((uint32_t)p[6] << 8) | p[7];
+    uint64_t ntp_seconds = seconds;
+    if ((seconds & 0x80000000u) == 0) {
+        ntp_seconds += 0x100000000ULL;
+    }
+    return (int64_t)(ntp_seconds - NTP_UNIX_OFFSET_S) * 1000000 +
+           (int64_t)(((uint64_t)fraction * 1000000) >> 32);
+}
+
+/**
+ * @brief Convert Unix microseconds to an NTP timestamp
+ */
+static void unix_us_to_ntp(int64_t unix_us, uint8_t *p) {
+    uint32_t seconds = (uint32_t)((uint64_t)(unix_us / 1000000) + NTP_UNIX_OFFSET_S);
+    uint32_t fraction = (uint32_t)(((uint64_t)(unix_us % 1000000) << 32) / 1000000);
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(seconds >> (24 - 8 * i));
+        p[4 + i] = (uint8_t)(fraction >> (24 - 8 * i));
+    }
+}
+
+/**
+ * @brief One request/response exchange on a connected UDP socket
+ *
+ * @param sock Socket
+ * @param sample Pointer to store the result
+ * @return true for a valid answer
+ */
+static bool ntp_exchange(int sock, ntp_sample_t *sample) {
+    uint8_t packet[NTP_PACKET_SIZE] = { 0 };
+    packet[0] = (0 << 6) | (4 << 3) | 3;    // LI 0, version 4, client
+
+    int64_t mono1 = esp_timer_get_time();
+    int64_t t1 = clock_service_utc_us(mono1);
+    uint8_t origin[8];
+    unix_us_to_ntp(t1, origin);
+    memcpy(&packet[40], origin, sizeof(origin));
+    if (send(sock, packet, sizeof(packet), 0) != sizeof(packet)) {
+        return false;
+    }
+
+    while (1) {
+        int len = recv(sock, packet, sizeof(packet), 0);
+        int64_t mono4 = esp_timer_get_time();
+        if (len < 0) {
+            return false;   // Timeout
+        }
+        // Answers to an earlier, timed-out request are dropped by the origin check
+        if (len < NTP_PACKET_SIZE || memcmp(&packet[24], origin, sizeof(origin)) != 0) {
+            if (mono4 - mono1 > (int64_t)CLOCK_NTP_TIMEOUT_MS * 1000) {
+                return false;
+            }
+            continue;
+        }
+
+        uint8_t leap = packet[0] >> 6;
+        uint8_t mode = packet[0] & 0x07;
+        uint8_t stratum = packet[1];
+        if (mode != 4 || leap == 3 || stratum == 0 || stratum > 15) {
+            ESP_LOGW(TAG, "Unusable NTP answer (mode %u, leap %u, stratum %u)", mode, leap, stratum);
+            return false;
+        }
+
+        int64_t t2 = ntp_to_unix_us(&packet[32]);
+        int64_t t3 = ntp_to_unix_us(&packet[40]);
+        int64_t t4 = clock_service_utc_us(mono4);
+        sample->mono_us = mono1 + (mono4 - mono1) / 2;
+        sample->offset_us = ((t2 - t1) + (t3 - t4)) / 2;
+        sample->delay_us = (t4 - t1) - (t3 - t2);
+        if (sample->delay_us < 0) {
+            sample->delay_us = 0;
+        }
+        sample->stratum = stratum;
+        return true;
+    }
+}
+
+/**
+ * @brief Take the best of a number of exchanges with one server
+ *
+ * @param server Server index
+ * @param count Exchanges
+ * @param best Pointer to store the sample with the smallest round trip
+ * @return true if at least one exchange succeeded
+ */
+static bool ntp_query(int server, int count, ntp_sample_t *best) {
+    char port_str[6];
+    snprintf(port_str, sizeof(port_str), "%u", service_config.port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(server_names[server], port_str, &hints, &res) != 0 || res == NULL) {
+        ESP_LOGW(TAG, "Cannot resolve NTP server %s", server_names[server]);
+        return false;
+    }
+
+    int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (sock < 0) {
+        freeaddrinfo(res);
+        return false;
+    }
+    struct timeval tv = { .tv_sec = CLOCK_NTP_TIMEOUT_MS / 1000,
+                          .tv_usec = (CLOCK_NTP_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    int ret = connect(sock, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (ret < 0) {
+        close(sock);
+        return false;
+    }
+
+    bool found = false;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            vTaskDelay(pdMS_TO_TICKS(CLOCK_BURST_SPACING_MS));
+        }
+        ntp_sample_t sample;
+        if (ntp_exchange(sock, &sample) && (!found || sample.delay_us < best->delay_us)) {
+            *best = sample;
+            found = true;
+        }
+    }
+    close(sock);
+    return found;
+}
+
+/**
+ * @brief Check a round trip against the recent minimum (under state_mutex)
+ *
+ * @param delay_us Round trip of the new sample
+ * @return true if the sample should be ignored
+ */
+static bool is_spike(int64_t delay_us) {
+    int64_t min_delay = -1;
+    for (int i = 0; i < CLOCK_DELAY_HISTORY; i++) {
+        if (delay_history[i] > 0 && (min_delay < 0 || delay_history[i] < min_delay)) {
+            min_delay = delay_history[i];
+        }
+    }
+    delay_history[delay_history_next] = delay_us > 0 ? delay_us : 1;
+    delay_history_next = (delay_history_next + 1) % CLOCK_DELAY_HISTORY;
+
+    if (min_delay < 0 || delay_us <= min_delay * CLOCK_SPIKE_FACTOR ||
+        delay_us - min_delay <= CLOCK_SPIKE_MIN_US || spike_run >= CLOCK_SPIKE_LIMIT) {
+        spike_run = 0;
+        return false;
+    }
+    spike_run++;
+    return true;
+}
+
+/**
+ * @brief Poll the servers once
+ *
+ * @return true if a server answered; *stepped tells whether the clock was stepped
+ */
+static bool clock_poll(bool *stepped) {
+    *stepped = false;
+    int first = state.server >= 0 ? state.server : 0;
+    for (int n = 0; n < CLOCK_SERVERS; n++) {
+        int server = (first + n) % CLOCK_SERVERS;
+        if (server_names[server][0] == '\0') {
+            continue;
+        }
+
+        ntp_sample_t sample = { 0 };
+        if (!ntp_query(server, synced_ever ? 1 : CLOCK_BURST_SAMPLES, &sample)) {
+            continue;
+        }
+
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        state.server = server;
+        state.stratum = sample.stratum;
+        bool spike = synced_ever && is_spike(sample.delay_us);
+        if (spike) {
+            state.spikes++;
+        }
+        xSemaphoreGive(state_mutex);
+
+        if (spike) {
+            ESP_LOGD(TAG, "Ignoring sample with round trip %lld us", (long long)sample.delay_us);
+            return true;
+        }
+
+        uint32_t steps = state.steps;
+        clock_service_apply_sample(sample.mono_us, sample.offset_us, sample.delay_us);
+        *stepped = state.steps != steps;
+        ESP_LOGD(TAG, "%s: offset %lld us, delay %lld us, freq %ld ppb",
+                 server_names[server], (long long)sample.offset_us,
+                 (long long)sample.delay_us, (long)state.freq_ppb);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Set the system time from the disciplined clock
+ */
+static void set_system_time(void) {
+    int64_t utc = clock_service_now_us();
+    struct timeval tv = { .tv_sec = (time_t)(utc / 1000000), .tv_usec = (suseconds_t)(utc % 1000000) };
+    settimeofday(&tv, NULL);
+}
+
+/**
+ * @brief NTP task: poll, adapt the interval, wait or be triggered
+ */
+static void clock_task(void *arg) {
+    bool was_synced = false;
+    while (1) {
+        bool stepped = false;
+        bool answered = clock_poll(&stepped);
+
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        if (!answered) {
+            state.failures++;
+            state.poll_s = service_config.poll_min_s;
+        } else if (stepped) {
+            state.poll_s = service_config.poll_min_s;
+        } else if (state.poll_s < service_config.poll_max_s) {
+            state.poll_s = state.poll_s * 2 > service_config.poll_max_s ?
+                           service_config.poll_max_s : state.poll_s * 2;
+        }
+        uint32_t poll_s = state.poll_s;
+        xSemaphoreGive(state_mutex);
+
+        if (answered && service_config.set_system_time) {
+            set_system_time();
+        }
+        if (answered && !was_synced && synced_ever) {
+            was_synced = true;
+            ESP_LOGI(TAG, "Clock synchronized with %s (stratum %u)",
+                     server_names[state.server], state.stratum);
+        }
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((uint64_t)poll_s * 1000));
+    }
+}
+
+esp_err_t clock_service_start(const clock_service_config_t *config) {
+    if (config == NULL || config->poll_min_s == 0 || config->poll_max_s < config->poll_min_s) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (clock_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    service_config = *config;
+    bool any_server = false;
+    for (int i = 0; i < CLOCK_SERVERS; i++) {
+        const char *name = config->servers[i] != NULL ? config->servers[i] : "";
+        strncpy(server_names[i], name, CLOCK_SERVER_NAME_LEN - 1);
+        server_names[i][CLOCK_SERVER_NAME_LEN - 1] = '\0';
+        service_config.servers[i] = server_names[i];
+        any_server = any_server || server_names[i][0] != '\0';
+    }
+    if (!any_server) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (service_config.port == 0) {
+        service_config.port = 123;
+    }
+
+    if (state_mutex == NULL) {
+        state_mutex = xSemaphoreCreateMutex();
+        if (state_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Until the first sample the mapping continues the system time (RTC after a reset)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t mono = esp_timer_get_time();
+    tick_offset_us = mono - (int64_t)xTaskGetTickCount() * portTICK_PERIOD_MS * 1000;
+    clock_map_t map = {
+        .anchor_mono_us = mono,
+        .anchor_utc_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec,
+        .slew_us = 0,
+        .freq_ppb = 0
+    };
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    map_store(&map);
+    state.poll_s = service_config.poll_min_s;
+    xSemaphoreGive(state_mutex);
+
+    BaseType_t ret = xTaskCreatePinnedToCore(clock_task, "clock", CLOCK_TASK_STACK, NULL,
+                                             CLOCK_TASK_PRIORITY, &clock_task_handle, 1);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create clock task");
+        clock_task_handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Clock service started: %s, poll %lu..%lu s",
+             server_names[0], (unsigned long)service_config.poll_min_s,
+             (unsigned long)service_config.poll_max_s);
+    return ESP_OK;
+}
+
+void clock_service_trigger(void) {
+    if (clock_task_handle != NULL) {
+        xTaskNotifyGive(clock_task_handle);
+    }
+}
+
+const char *clock_service_server_name(int server) {
+    if (server < 0 || server >= CLOCK_SERVERS) {
+        return "";
+    }
+    return server_names[server];
+}
+
+const char *clock_service_status_name(clock_sync_status_t status) {
+    switch (status) {
+        case CLOCK_SYNCED:   return "synced";
+        case CLOCK_HOLDOVER: return "holdover";
+        default:             return "unsynced";
+    }
+}
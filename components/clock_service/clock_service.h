@@ -0,0 +1,193 @@
+/* clock_service.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef CLOCK_SERVICE_H
+#define CLOCK_SERVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Disciplined Clock Service
+ * ============================================================================
+ *
+ * UTC is derived from the monotonic esp_timer clock through a linear mapping:
+ *
+ *   utc(t) = anchor_utc + (t - anchor_t) * (1 + freq) + slew(t)
+ *
+ * Each NTP sample re-anchors the mapping at the current time without a jump.
+ * The measured offset is removed by slewing: slew(t) grows towards the offset
+ * at no more than CLOCK_SLEW_MAX_PPM, so time never jumps and never runs
+ * backwards. Only the first sample, or an offset larger than
+ * CLOCK_STEP_THRESHOLD_US, steps the clock. The offset that is left after
+ * the previous slew is attributed to a frequency error, and freq is corrected
+ * by the share interval / (interval + 64 s) of it (frequency-locked loop), so
+ * long intervals, which measure the frequency best, weigh most. A residual
+ * above CLOCK_FREQ_MAX_PPM of the interval is a jump of the reference and
+ * is only slewed. After a few polls freq holds the drift of the crystal, and
+ * the clock keeps good time while no server answers (holdover).
+ *
+ * The poll interval starts at poll_min_s and doubles after every good sample
+ * up to poll_max_s. It drops back to poll_min_s after a step or a failed poll.
+ * The first sync takes the best of a burst of CLOCK_BURST_SAMPLES exchanges.
+ * Later samples whose round trip is far above the recent minimum are ignored,
+ * at most CLOCK_SPIKE_LIMIT in a row.
+ *
+ * Readers (UA_DateTime_now(), value timestamps) never block: the mapping is
+ * published under a sequence counter.
+ */
+
+/** @brief Offset above which the clock is stepped instead of slewed */
+#define CLOCK_STEP_THRESHOLD_US     128000
+/** @brief Largest slew rate in parts per million */
+#define CLOCK_SLEW_MAX_PPM          500
+/** @brief Largest frequency correction in parts per million */
+#define CLOCK_FREQ_MAX_PPM          500
+/** @brief Assumed frequency wander for the error bound, parts per million */
+#define CLOCK_WANDER_PPM            15
+/** @brief Exchanges in the burst of the first sync */
+#define CLOCK_BURST_SAMPLES         4
+/** @brief Spacing of the burst exchanges in milliseconds */
+#define CLOCK_BURST_SPACING_MS      500
+/** @brief Ignore samples whose delay is above this multiple of the minimum */
+#define CLOCK_SPIKE_FACTOR          3
+/** @brief Spikes ignored in a row before a sample is taken anyway */
+#define CLOCK_SPIKE_LIMIT           3
+/** @brief Missed poll intervals until the state becomes holdover */
+#define CLOCK_HOLDOVER_POLLS        3
+/** @brief Wait for one NTP answer in milliseconds */
+#define CLOCK_NTP_TIMEOUT_MS        1000
+/** @brief Number of NTP servers */
+#define CLOCK_SERVERS               3
+
+/**
+ * @brief Synchronization state (timestamp quality)
+ */
+typedef enum {
+    CLOCK_UNSYNCED = 0,     /**< Never synchronized: time counts from the Unix epoch at boot */
+    CLOCK_SYNCED,           /**< Last poll succeeded within CLOCK_HOLDOVER_POLLS intervals */
+    CLOCK_HOLDOVER          /**< Was synchronized; running on the learned frequency */
+} clock_sync_status_t;
+
+/**
+ * @brief Clock service configuration
+ */
+typedef struct {
+    const char *servers[CLOCK_SERVERS];     /**< NTP servers, tried in turn (NULL or "" = unused) */
+    uint16_t port;                          /**< NTP port (123) */
+    uint32_t poll_min_s;                    /**< First and fallback poll interval */
+    uint32_t poll_max_s;                    /**< Longest poll interval */
+    bool set_system_time;                   /**< Also set gettimeofday() time after every sample */
+} clock_service_config_t;
+
+/**
+ * @brief Clock state for diagnostics
+ */
+typedef struct {
+    clock_sync_status_t status;     /**< Timestamp quality */
+    int64_t offset_us;              /**< Offset of the last accepted sample (server - local) */
+    int64_t delay_us;               /**< Round trip of the last accepted sample */
+    int32_t freq_ppb;               /**< Frequency correction in parts per billion */
+    int64_t error_us;               /**< Estimated error bound of the current time */
+    int64_t last_sync_utc_us;       /**< UTC of the last accepted sample (0 = never) */
+    uint32_t poll_s;                /**< Current poll interval */
+    uint32_t samples;               /**< Accepted samples */
+    uint32_t steps;                 /**< Clock steps */
+    uint32_t spikes;                /**< Samples ignored for a high round trip */
+    uint32_t failures;              /**< Polls without an answer */
+    int server;                     /**< Index of the server used last (-1 = none) */
+    uint8_t stratum;                /**< Stratum of that server */
+} clock_service_status_t;
+
+/**
+ * @brief Start the NTP task
+ *
+ * The configuration is copied (server names included). Returns at once; the
+ * first sync happens in the background, so startup is not delayed.
+ *
+ * @param config Configuration
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if
+ *         already running, ESP_ERR_NO_MEM
+ */
+esp_err_t clock_service_start(const clock_service_config_t *config);
+
+/**
+ * @brief Poll the servers now (e.g. after an IP address was obtained)
+ */
+void clock_service_trigger(void);
+
+/**
+ * @brief Current UTC in microseconds since the Unix epoch
+ *
+ * @return int64_t UTC
+ */
+int64_t clock_service_now_us(void);
+
+/**
+ * @brief Convert a monotonic esp_timer time to UTC
+ *
+ * @param mono_us esp_timer_get_time() value
+ * @return int64_t UTC in microseconds since the Unix epoch
+ */
+int64_t clock_service_utc_us(int64_t mono_us);
+
+/**
+ * @brief Convert a FreeRTOS tick timestamp in milliseconds to UTC
+ *
+ * For timestamps taken as xTaskGetTickCount() * portTICK_PERIOD_MS (io_cache).
+ *
+ * @param tick_ms Tick time in milliseconds
+ * @return int64_t UTC in microseconds since the Unix epoch
+ */
+int64_t clock_service_utc_from_tick_ms(uint64_t tick_ms);
+
+/**
+ * @brief Current synchronization state
+ *
+ * @return clock_sync_status_t State
+ */
+clock_sync_status_t clock_service_sync_status(void);
+
+/**
+ * @brief Get the clock state
+ *
+ * @param status Pointer to store the state
+ */
+void clock_service_get_status(clock_service_status_t *status);
+
+/**
+ * @brief Feed one offset measurement into the discipline
+ *
+ * Used by the NTP task; exposed for tests and for other time sources.
+ *
+ * @param mono_us esp_timer time of the measurement
+ * @param offset_us Reference time minus local time at mono_us
+ * @param delay_us Round trip of the measurement
+ */
+void clock_service_apply_sample(int64_t mono_us, int64_t offset_us, int64_t delay_us);
+
+/**
+ * @brief Name of a configured NTP server
+ *
+ * @param server Server index (clock_service_status_t.server)
+ * @return const char* Name, "" for an unused or invalid index
+ */
+const char *clock_service_server_name(int server);
+
+/**
+ * @brief Name of a synchronization state
+ *
+ * @param status State
+ * @return const char* "unsynced", "synced" or "holdover"
+ */
+const char *clock_service_status_name(clock_sync_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCK_SERVICE_H */
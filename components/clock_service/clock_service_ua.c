@@ -0,0 +1,151 @@
+/* clock_service_ua.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "clock_service_ua.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "clock";
+
+/**
+ * @brief Clock variables (node context of the shared read callback)
+ */
+typedef enum {
+    CLOCK_VAR_STATUS = 0,
+    CLOCK_VAR_OFFSET,
+    CLOCK_VAR_DRIFT,
+    CLOCK_VAR_ERROR_BOUND,
+    CLOCK_VAR_LAST_SYNC,
+    CLOCK_VAR_SERVER,
+    CLOCK_VAR_STEPS
+} clock_var_t;
+
+UA_DateTime clock_service_ua_now(void) {
+    return UA_DATETIME_UNIX_EPOCH + clock_service_now_us() * UA_DATETIME_USEC;
+}
+
+UA_DateTime clock_service_ua_from_tick_ms(uint64_t tick_ms) {
+    return UA_DATETIME_UNIX_EPOCH + clock_service_utc_from_tick_ms(tick_ms) * UA_DATETIME_USEC;
+}
+
+/**
+ * @brief OPC UA read callback for the Clock variables
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Variable (clock_var_t)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readClockVariable(UA_Server *server,
+                  const UA_NodeId *sessionId, void *sessionContext,
+                  const UA_NodeId *nodeId, void *nodeContext,
+                  UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                  UA_DataValue *dataValue) {
+    clock_service_status_t status;
+    clock_service_get_status(&status);
+
+    UA_Double number;
+    UA_String text;
+    switch ((clock_var_t)(uintptr_t)nodeContext) {
+        case CLOCK_VAR_STATUS:
+            text = UA_STRING((char *)clock_service_status_name(status.status));
+            UA_Variant_setScalarCopy(&dataValue->value, &text, &UA_TYPES[UA_TYPES_STRING]);
+            break;
+        case CLOCK_VAR_OFFSET:
+            number = (UA_Double)status.offset_us / 1000.0;
+            UA_Variant_setScalarCopy(&dataValue->value, &number, &UA_TYPES[UA_TYPES_DOUBLE]);
+            break;
+        case CLOCK_VAR_DRIFT:
+            number = (UA_Double)status.freq_ppb / 1000.0;
+            UA_Variant_setScalarCopy(&dataValue->value, &number, &UA_TYPES[UA_TYPES_DOUBLE]);
+            break;
+        case CLOCK_VAR_ERROR_BOUND:
+            number = status.error_us < 0 ? -1.0 : (UA_Double)status.error_us / 1000.0;
+            UA_Variant_setScalarCopy(&dataValue->value, &number, &UA_TYPES[UA_TYPES_DOUBLE]);
+            break;
+        case CLOCK_VAR_LAST_SYNC: {
+            UA_DateTime last = status.last_sync_utc_us > 0 ?
+                UA_DATETIME_UNIX_EPOCH + status.last_sync_utc_us * UA_DATETIME_USEC : 0;
+            UA_Variant_setScalarCopy(&dataValue->value, &last, &UA_TYPES[UA_TYPES_DATETIME]);
+            break;
+        }
+        case CLOCK_VAR_SERVER:
+            text = UA_STRING((char *)clock_service_server_name(status.server));
+            UA_Variant_setScalarCopy(&dataValue->value, &text, &UA_TYPES[UA_TYPES_STRING]);
+            break;
+        case CLOCK_VAR_STEPS:
+            UA_Variant_setScalarCopy(&dataValue->value, &status.steps, &UA_TYPES[UA_TYPES_UINT32]);
+            break;
+        default:
+            return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Add one read-only variable to the Clock object
+ */
+static void add_variable(UA_Server *server, const UA_NodeId *parent, const char *id,
+                         const char *name, const char *description, UA_UInt32 typeIndex,
+                         clock_var_t var) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.dataType = UA_TYPES[typeIndex].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ;
+
+    UA_DataSource source = { readClockVariable, NULL };
+    UA_StatusCode status = UA_Server_addDataSourceVariableNode(
+        server, UA_NODEID_STRING(1, (char *)id), *parent,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), UA_QUALIFIEDNAME(1, (char *)name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, source,
+        (void *)(uintptr_t)var, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add variable %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Add the Clock object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void clock_service_add_ua_nodes(UA_Server *server) {
+    UA_NodeId clockId = UA_NODEID_STRING(1, "clock");
+
+    UA_ObjectAttributes objAttr = UA_ObjectAttributes_default;
+    objAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Clock");
+    objAttr.description = UA_LOCALIZEDTEXT("en-US", "NTP-disciplined clock of the timestamps");
+    UA_StatusCode status = UA_Server_addObjectNode(server, clockId,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                                   UA_QUALIFIEDNAME(1, "Clock"),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                                   objAttr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add Clock object: 0x%08lX", (unsigned long)status);
+        return;
+    }
+
+    add_variable(server, &clockId, "clock.Status", "Status",
+                 "Timestamp quality: unsynced, synced or holdover", UA_TYPES_STRING, CLOCK_VAR_STATUS);
+    add_variable(server, &clockId, "clock.Offset", "Offset",
+                 "Offset of the last accepted NTP sample in ms", UA_TYPES_DOUBLE, CLOCK_VAR_OFFSET);
+    add_variable(server, &clockId, "clock.Drift", "Drift",
+                 "Learned frequency correction in ppm", UA_TYPES_DOUBLE, CLOCK_VAR_DRIFT);
+    add_variable(server, &clockId, "clock.ErrorBound", "ErrorBound",
+                 "Estimated error of the current time in ms (-1 = unsynced)", UA_TYPES_DOUBLE,
+                 CLOCK_VAR_ERROR_BOUND);
+    add_variable(server, &clockId, "clock.LastSync", "LastSync",
+                 "Time of the last accepted NTP sample", UA_TYPES_DATETIME, CLOCK_VAR_LAST_SYNC);
+    add_variable(server, &clockId, "clock.Server", "Server",
+                 "NTP server used last", UA_TYPES_STRING, CLOCK_VAR_SERVER);
+    add_variable(server, &clockId, "clock.Steps", "Steps",
+                 "Times the clock was stepped instead of slewed", UA_TYPES_UINT32, CLOCK_VAR_STEPS);
+}
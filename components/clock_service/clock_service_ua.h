@@ -0,0 +1,57 @@
+/* clock_service_ua.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef CLOCK_SERVICE_UA_H
+#define CLOCK_SERVICE_UA_H
+
+#include "open62541.h"
+#include "clock_service.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * OPC UA Clock Object
+ * ============================================================================
+ *
+ * Objects/Clock (ns=1;s=clock):
+ *
+ *   Status      String    "unsynced", "synced" or "holdover"
+ *   Offset      Double    offset of the last accepted NTP sample in ms
+ *   Drift       Double    learned frequency correction in ppm
+ *   ErrorBound  Double    estimated error of the current time in ms (-1 = unsynced)
+ *   LastSync    DateTime  time of the last accepted sample
+ *   Server      String    NTP server used last
+ *   Steps       UInt32    times the clock was stepped instead of slewed
+ */
+
+/**
+ * @brief Current time of the disciplined clock
+ *
+ * Installed with UA_DateTime_setSource(), so server timestamps and the source
+ * timestamps the stack fills in come from the clock service.
+ *
+ * @return UA_DateTime Current UTC
+ */
+UA_DateTime clock_service_ua_now(void);
+
+/**
+ * @brief Convert an io_cache tick timestamp to a UA_DateTime
+ *
+ * @param tick_ms Tick time in milliseconds
+ * @return UA_DateTime UTC of that moment
+ */
+UA_DateTime clock_service_ua_from_tick_ms(uint64_t tick_ms);
+
+/**
+ * @brief Add the Clock object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void clock_service_add_ua_nodes(UA_Server *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCK_SERVICE_UA_H */
@@ -0,0 +1,730 @@
+/* http_snapshot.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "http_snapshot.h"
+#include "io_cache.h"
+#include "scan_policy.h"
+#include "mqtt_publisher.h"
+#include "open62541.h"
+#include "ua_accesscontrol_custom.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+static const char *TAG = "http_snap";
+
+#define HTTP_TASK_STACK             4096    /**< HTTP task stack size */
+#define HTTP_TASK_PRIORITY          2       /**< Below OPC UA and MQTT */
+#define HTTP_MAX_CLIENTS            4       /**< Simultaneous keep-alive connections */
+#define HTTP_RX_BUFFER              512     /**< Request header buffer per connection */
+#define HTTP_IDLE_TIMEOUT_MS        10000   /**< Close keep-alive connections after this idle time */
+#define HTTP_HEADER_RESERVE         160     /**< Space in front of a body for the response header */
+#define HTTP_METRICS_BUFFER         10240   /**< Prometheus response buffer */
+#define HTTP_JSON_BUFFER            1024    /**< JSON response buffer */
+
+/**
+ * @brief One client connection
+ */
+typedef struct {
+    int sock;                   /**< Socket descriptor (-1 = free slot) */
+    size_t rx_len;              /**< Bytes in rx */
+    uint32_t last_active_ms;    /**< Time of the last request */
+    char rx[HTTP_RX_BUFFER];    /**< Request header buffer */
+} http_client_t;
+
+/**
+ * @brief Pre-rendered HTTP response
+ */
+typedef struct {
+    char *buf;                  /**< Backing buffer */
+    size_t size;                /**< Backing buffer size */
+    const char *content_type;   /**< Content-Type header value */
+    const char *data;           /**< Start of the response (header + body) */
+    size_t len;                 /**< Response length */
+} cached_response_t;
+
+/**
+ * @brief Append-only text buffer used while rendering
+ */
+typedef struct {
+    char *buf;                  /**< Output buffer */
+    size_t size;                /**< Buffer size */
+    size_t len;                 /**< Bytes written */
+    bool overflow;              /**< Output was truncated */
+} render_buf_t;
+
+static char metrics_buf[HTTP_METRICS_BUFFER];
+static char json_buf[HTTP_JSON_BUFFER];
+static cached_response_t metrics_resp = { metrics_buf, sizeof(metrics_buf),
+                                          "text/plain; version=0.0.4", NULL, 0 };
+static cached_response_t json_resp = { json_buf, sizeof(json_buf), "application/json", NULL, 0 };
+
+static const char resp_not_found[] =
+    "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\n\r\nNot found\n";
+static const char resp_unavailable[] =
+    "HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/plain\r\nContent-Length: 9\r\n"
+    "Connection: close\r\n\r\nDisabled\n";
+static const char resp_bad_method[] =
+    "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static http_client_t clients[HTTP_MAX_CLIENTS];
+static http_snapshot_config_t http_config;
+static http_snapshot_stats_t http_stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t http_task_handle = NULL;
+static volatile bool http_paused = false;
+
+static uint32_t rendered_sequence;
+static uint32_t rendered_at_ms;
+static bool rendered = false;
+
+/**
+ * @brief Get current system time in milliseconds
+ *
+ * @return uint32_t Milliseconds since system start
+ */
+static uint32_t get_time_ms(void) {
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+/* ============================================================================
+ * RENDERING
+ * ============================================================================ */
+
+/**
+ * @brief printf into a render buffer
+ */
+static void rb_printf(render_buf_t *rb, const char *fmt, ...) {
+    if (rb->overflow) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(rb->buf + rb->len, rb->size - rb->len, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= rb->size - rb->len) {
+        rb->overflow = true;
+        return;
+    }
+    rb->len += (size_t)n;
+}
+
+/**
+ * @brief Write HELP and TYPE lines of a Prometheus metric
+ */
+static void prom_header(render_buf_t *rb, const char *name, const char *type, const char *help) {
+    rb_printf(rb, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/**
+ * @brief Render the request scheduler metrics of the OPC UA server
+ */
+static void render_scheduler(render_buf_t *rb, const UA_TcpSchedulerStatistics *sched) {
+    static const char *lanes[UA_TCPSCHEDULER_LANES] = { "priority", "normal" };
+    static const UA_UInt32 bounds[UA_TCPSCHEDULER_BUCKETS - 1] = UA_TCPSCHEDULER_BUCKET_BOUNDS_US;
+
+    prom_header(rb, "a16_opcua_queued", "gauge", "OPC UA chunks waiting in the request queues");
+    for (int l = 0; l < UA_TCPSCHEDULER_LANES; l++) {
+        rb_printf(rb, "a16_opcua_queued{lane=\"%s\"} %lu\n", lanes[l], (unsigned long)sched->lanes[l].queued);
+    }
+    prom_header(rb, "a16_opcua_queued_max", "gauge", "Most OPC UA chunks waiting at once");
+    for (int l = 0; l < UA_TCPSCHEDULER_LANES; l++) {
+        rb_printf(rb, "a16_opcua_queued_max{lane=\"%s\"} %lu\n", lanes[l], (unsigned long)sched->lanes[l].maxQueued);
+    }
+    prom_header(rb, "a16_opcua_latency_max_microseconds", "gauge", "Longest time from receive to processed");
+    for (int l = 0; l < UA_TCPSCHEDULER_LANES; l++) {
+        rb_printf(rb, "a16_opcua_latency_max_microseconds{lane=\"%s\"} %lu\n",
+                  lanes[l], (unsigned long)sched->lanes[l].latencyMaxUs);
+    }
+    prom_header(rb, "a16_opcua_latency_seconds", "histogram", "OPC UA request time from receive to processed");
+    for (int l = 0; l < UA_TCPSCHEDULER_LANES; l++) {
+        const UA_TcpSchedulerLaneStatistics *ls = &sched->lanes[l];
+        unsigned long cumulative = 0;
+        for (int b = 0; b < UA_TCPSCHEDULER_BUCKETS - 1; b++) {
+            cumulative += ls->latencyBuckets[b];
+            rb_printf(rb, "a16_opcua_latency_seconds_bucket{lane=\"%s\",le=\"%lu.%06lu\"} %lu\n", lanes[l],
+                      (unsigned long)(bounds[b] / 1000000), (unsigned long)(bounds[b] % 1000000), cumulative);
+        }
+        rb_printf(rb, "a16_opcua_latency_seconds_bucket{lane=\"%s\",le=\"+Inf\"} %lu\n",
+                  lanes[l], (unsigned long)ls->processed);
+        rb_printf(rb, "a16_opcua_latency_seconds_sum{lane=\"%s\"} %lu.%03lu\n", lanes[l],
+                  (unsigned long)(ls->latencySumMs / 1000), (unsigned long)(ls->latencySumMs % 1000));
+        rb_printf(rb, "a16_opcua_latency_seconds_count{lane=\"%s\"} %lu\n", lanes[l], (unsigned long)ls->processed);
+    }
+    prom_header(rb, "a16_opcua_rate_limited_total", "counter", "Scheduler rounds a session waited for its rate limit");
+    rb_printf(rb, "a16_opcua_rate_limited_total %lu\n", (unsigned long)sched->rateLimited);
+    prom_header(rb, "a16_opcua_reads_deferred_total", "counter", "Scheduler rounds a connection was not read (queue full)");
+    rb_printf(rb, "a16_opcua_reads_deferred_total %lu\n", (unsigned long)sched->readsDeferred);
+}
+
+/**
+ * @brief Render the send coalescing metrics of the OPC UA server
+ */
+static void render_send(render_buf_t *rb, const UA_TcpSendStatistics *tx) {
+    prom_header(rb, "a16_opcua_tx_chunks_total", "counter", "OPC UA chunks sent");
+    rb_printf(rb, "a16_opcua_tx_chunks_total %lu\n", (unsigned long)tx->chunks);
+    prom_header(rb, "a16_opcua_tx_bytes_total", "counter", "OPC UA bytes sent");
+    rb_printf(rb, "a16_opcua_tx_bytes_total %lu\n", (unsigned long)tx->bytes);
+    prom_header(rb, "a16_opcua_tx_flushes_total", "counter", "Socket writes of OPC UA chunks (one sendmsg per batch)");
+    rb_printf(rb, "a16_opcua_tx_flushes_total %lu\n", (unsigned long)tx->flushes);
+    prom_header(rb, "a16_opcua_tx_early_flushes_total", "counter", "Batches written before the end of the server iteration");
+    rb_printf(rb, "a16_opcua_tx_early_flushes_total %lu\n", (unsigned long)tx->earlyFlushes);
+    prom_header(rb, "a16_opcua_tx_batch_max", "gauge", "Most chunks in one socket write");
+    rb_printf(rb, "a16_opcua_tx_batch_max %lu\n", (unsigned long)tx->maxBatch);
+}
+
+/**
+ * @brief Render the session activation and subscription retention metrics
+ */
+static void render_sessions(render_buf_t *rb, const UA_AccessControlCustomStatistics *access,
+                            const UA_SubscriptionRetentionStatistics *retention) {
+    prom_header(rb, "a16_opcua_activations_total", "counter", "Successful session activations");
+    rb_printf(rb, "a16_opcua_activations_total{identity=\"new\"} %lu\n",
+              (unsigned long)(access->activations - access->known));
+    rb_printf(rb, "a16_opcua_activations_total{identity=\"known\"} %lu\n", (unsigned long)access->known);
+    prom_header(rb, "a16_opcua_activations_denied_total", "counter", "Rejected session activations");
+    rb_printf(rb, "a16_opcua_activations_denied_total %lu\n", (unsigned long)access->denied);
+    prom_header(rb, "a16_opcua_sessions_resumed_total", "counter", "Sessions activated again on a new connection");
+    rb_printf(rb, "a16_opcua_sessions_resumed_total %lu\n", (unsigned long)retention->resumed);
+    prom_header(rb, "a16_opcua_subscriptions_detached", "gauge", "Subscriptions kept without a session");
+    rb_printf(rb, "a16_opcua_subscriptions_detached %lu\n", (unsigned long)retention->detached);
+    prom_header(rb, "a16_opcua_subscriptions_detached_total", "counter", "Subscriptions detached from a closed or timed out session");
+    rb_printf(rb, "a16_opcua_subscriptions_detached_total %lu\n", (unsigned long)retention->detachedTotal);
+    prom_header(rb, "a16_opcua_subscriptions_transferred_total", "counter", "Detached subscriptions taken over by a new session");
+    rb_printf(rb, "a16_opcua_subscriptions_transferred_total %lu\n", (unsigned long)retention->transferred);
+    prom_header(rb, "a16_opcua_subscriptions_expired_total", "counter", "Detached subscriptions deleted unclaimed");
+    rb_printf(rb, "a16_opcua_subscriptions_expired_total %lu\n", (unsigned long)retention->expired);
+}
+
+/**
+ * @brief Render the adaptive input scan metrics
+ */
+static void render_scan(render_buf_t *rb, const scan_policy_stats_t *scan) {
+    prom_header(rb, "a16_scan_interval_milliseconds", "gauge", "Current discrete input scan interval");
+    rb_printf(rb, "a16_scan_interval_milliseconds{reason=\"%s\"} %u\n",
+              scan_policy_reason_name(scan->reason), scan->interval_ms);
+    prom_header(rb, "a16_scan_rate_hertz", "gauge", "Discrete input scans per second in the last second");
+    rb_printf(rb, "a16_scan_rate_hertz %u.%u\n", scan->scan_rate_x10 / 10u, scan->scan_rate_x10 % 10u);
+    prom_header(rb, "a16_scan_demand_milliseconds", "gauge", "Average time between OPC UA reads of the inputs (0 = none)");
+    rb_printf(rb, "a16_scan_demand_milliseconds %u\n", scan->demand_ms);
+    prom_header(rb, "a16_scan_floor_milliseconds", "gauge", "Shortest scan interval the I2C bus budget allows");
+    rb_printf(rb, "a16_scan_floor_milliseconds %u\n", scan->floor_ms);
+    prom_header(rb, "a16_i2c_bus_load_ratio", "gauge", "I2C bus busy time in the last second");
+    rb_printf(rb, "a16_i2c_bus_load_ratio %u.%03u\n", scan->bus_load_permille / 1000u, scan->bus_load_permille % 1000u);
+    prom_header(rb, "a16_scan_cost_microseconds", "gauge", "Average I2C time of one input scan");
+    rb_printf(rb, "a16_scan_cost_microseconds %u\n", scan->scan_cost_us);
+    prom_header(rb, "a16_scans_total", "counter", "Discrete input scans");
+    rb_printf(rb, "a16_scans_total %lu\n", (unsigned long)scan->scans);
+    prom_header(rb, "a16_scan_changes_total", "counter", "Input scans that found a change");
+    rb_printf(rb, "a16_scan_changes_total %lu\n", (unsigned long)scan->changes);
+    prom_header(rb, "a16_scan_budget_limited_total", "counter", "Input scans delayed by the I2C bus budget");
+    rb_printf(rb, "a16_scan_budget_limited_total %lu\n", (unsigned long)scan->budget_limited);
+}
+
+/**
+ * @brief Render the Prometheus text body
+ */
+static void render_metrics(render_buf_t *rb, const io_cache_snapshot_t *img,
+                           const mqtt_publisher_stats_t *mqtt, const http_snapshot_stats_t *http,
+                           const UA_TcpSchedulerStatistics *sched, const UA_TcpSendStatistics *tx,
+                           uint32_t uptime_ms) {
+    prom_header(rb, "a16_io_sequence", "counter", "Process image change counter");
+    rb_printf(rb, "a16_io_sequence %lu\n", (unsigned long)img->sequence);
+
+    prom_header(rb, "a16_discrete_inputs", "gauge", "Discrete inputs as 16-bit word");
+    rb_printf(rb, "a16_discrete_inputs %u\n", img->discrete_inputs);
+    prom_header(rb, "a16_discrete_input", "gauge", "Discrete input state");
+    for (int i = 0; i < 16; i++) {
+        rb_printf(rb, "a16_discrete_input{channel=\"%d\"} %u\n", i + 1, (img->discrete_inputs >> i) & 1u);
+    }
+
+    prom_header(rb, "a16_discrete_outputs", "gauge", "Discrete outputs as 16-bit word");
+    rb_printf(rb, "a16_discrete_outputs %u\n", img->discrete_outputs);
+    prom_header(rb, "a16_discrete_output", "gauge", "Discrete output state");
+    for (int i = 0; i < 16; i++) {
+        rb_printf(rb, "a16_discrete_output{channel=\"%d\"} %u\n", i + 1, (img->discrete_outputs >> i) & 1u);
+    }
+
+    prom_header(rb, "a16_adc_raw", "gauge", "ADC channel raw code (0-4095)");
+    for (int i = 0; i < IO_CACHE_ADC_CHANNELS; i++) {
+        if (img->adc_valid[i]) {
+            rb_printf(rb, "a16_adc_raw{channel=\"%d\"} %u\n", i + 1, (unsigned)img->adc[i]);
+        }
+    }
+
+    prom_header(rb, "a16_uptime_seconds", "gauge", "Time since boot");
+    rb_printf(rb, "a16_uptime_seconds %lu.%03lu\n",
+              (unsigned long)(uptime_ms / 1000), (unsigned long)(uptime_ms % 1000));
+    prom_header(rb, "a16_heap_free_bytes", "gauge", "Free heap");
+    rb_printf(rb, "a16_heap_free_bytes %lu\n", (unsigned long)esp_get_free_heap_size());
+    prom_header(rb, "a16_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    rb_printf(rb, "a16_heap_min_free_bytes %lu\n", (unsigned long)esp_get_minimum_free_heap_size());
+
+    prom_header(rb, "a16_http_requests_total", "counter", "HTTP requests answered");
+    rb_printf(rb, "a16_http_requests_total %lu\n", (unsigned long)http->requests);
+    prom_header(rb, "a16_http_renders_total", "counter", "Snapshot regenerations");
+    rb_printf(rb, "a16_http_renders_total %lu\n", (unsigned long)http->renders);
+    prom_header(rb, "a16_http_render_microseconds", "gauge", "Duration of the previous regeneration");
+    rb_printf(rb, "a16_http_render_microseconds %lu\n", (unsigned long)http->last_render_us);
+
+    prom_header(rb, "a16_mqtt_connected", "gauge", "MQTT broker connection state");
+    rb_printf(rb, "a16_mqtt_connected %u\n", mqtt->connected ? 1u : 0u);
+    prom_header(rb, "a16_mqtt_messages_total", "counter", "MQTT messages published");
+    rb_printf(rb, "a16_mqtt_messages_total %lu\n", (unsigned long)mqtt->messages);
+    prom_header(rb, "a16_mqtt_acked_total", "counter", "MQTT QoS 1 messages acknowledged");
+    rb_printf(rb, "a16_mqtt_acked_total %lu\n", (unsigned long)mqtt->acked);
+    prom_header(rb, "a16_mqtt_dropped_total", "counter", "MQTT messages dropped on retry queue overflow");
+    rb_printf(rb, "a16_mqtt_dropped_total %lu\n", (unsigned long)mqtt->dropped);
+    prom_header(rb, "a16_mqtt_pending", "gauge", "MQTT messages waiting for PUBACK");
+    rb_printf(rb, "a16_mqtt_pending %lu\n", (unsigned long)mqtt->pending);
+
+    render_scheduler(rb, sched);
+    render_send(rb, tx);
+
+    UA_AccessControlCustomStatistics access;
+    UA_SubscriptionRetentionStatistics retention;
+    UA_AccessControl_custom_getStatistics(&access);
+    UA_Server_getSubscriptionRetentionStatistics(&retention);
+    render_sessions(rb, &access, &retention);
+
+    scan_policy_stats_t scan;
+    scan_policy_get_stats(&scan);
+    render_scan(rb, &scan);
+}
+
+/**
+ * @brief Render the JSON body
+ */
+static void render_json(render_buf_t *rb, const io_cache_snapshot_t *img,
+                        const mqtt_publisher_stats_t *mqtt, const http_snapshot_stats_t *http,
+                        const UA_TcpSchedulerStatistics *sched, uint32_t uptime_ms) {
+    rb_printf(rb, "{\"seq\":%lu,\"uptime_ms\":%lu,\"di\":%u,\"do\":%u,\"adc\":[",
+              (unsigned long)img->sequence, (unsigned long)uptime_ms,
+              img->discrete_inputs, img->discrete_outputs);
+    for (int i = 0; i < IO_CACHE_ADC_CHANNELS; i++) {
+        if (img->adc_valid[i]) {
+            rb_printf(rb, "%s%u", i ? "," : "", (unsigned)img->adc[i]);
+        } else {
+            rb_printf(rb, "%snull", i ? "," : "");
+        }
+    }
+    rb_printf(rb, "],\"counters\":{\"heap_free\":%lu,\"heap_min_free\":%lu,"
+                  "\"http_requests\":%lu,\"http_renders\":%lu,\"http_render_us\":%lu,"
+                  "\"mqtt_connected\":%s,\"mqtt_messages\":%lu,\"mqtt_acked\":%lu,"
+                  "\"mqtt_dropped\":%lu,\"mqtt_pending\":%lu,"
+                  "\"opcua_priority_queued\":%lu,\"opcua_priority_max_us\":%lu,"
+                  "\"opcua_normal_queued\":%lu,\"opcua_normal_max_us\":%lu}}\n",
+              (unsigned long)esp_get_free_heap_size(), (unsigned long)esp_get_minimum_free_heap_size(),
+              (unsigned long)http->requests, (unsigned long)http->renders,
+              (unsigned long)http->last_render_us, mqtt->connected ? "true" : "false",
+              (unsigned long)mqtt->messages, (unsigned long)mqtt->acked,
+              (unsigned long)mqtt->dropped, (unsigned long)mqtt->pending,
+              (unsigned long)sched->lanes[UA_TCPSCHEDULERLANE_PRIORITY].queued,
+              (unsigned long)sched->lanes[UA_TCPSCHEDULERLANE_PRIORITY].latencyMaxUs,
+              (unsigned long)sched->lanes[UA_TCPSCHEDULERLANE_NORMAL].queued,
+              (unsigned long)sched->lanes[UA_TCPSCHEDULERLANE_NORMAL].latencyMaxUs);
+}
+
+/**
+ * @brief Put the HTTP header in front of an already rendered body
+ *
+ * The body starts at HTTP_HEADER_RESERVE; the header is written right before
+ * it so the complete response is one contiguous block.
+ *
+ * @param resp Response to finish
+ * @param body_len Body length
+ */
+static void finish_response(cached_response_t *resp, size_t body_len) {
+    char header[HTTP_HEADER_RESERVE];
+    int hlen = snprintf(header, sizeof(header),
+                        "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+                        "Cache-Control: no-cache\r\n\r\n",
+                        resp->content_type, (unsigned)body_len);
+    if (hlen <= 0 || hlen > HTTP_HEADER_RESERVE) {
+        resp->data = NULL;
+        resp->len = 0;
+        return;
+    }
+    char *start = resp->buf + HTTP_HEADER_RESERVE - hlen;
+    memcpy(start, header, (size_t)hlen);
+    resp->data = start;
+    resp->len = (size_t)hlen + body_len;
+}
+
+/**
+ * @brief Regenerate both responses if the image changed or counters are stale
+ */
+static void refresh_responses(void) {
+    uint32_t now = get_time_ms();
+    uint32_t sequence = io_cache_get_sequence();
+    if (rendered && sequence == rendered_sequence && (now - rendered_at_ms) < HTTP_SNAPSHOT_REFRESH_MS) {
+        return;
+    }
+
+    io_cache_snapshot_t img;
+    if (!io_cache_get_snapshot(&img)) {
+        return;  /* Keep serving the previous responses */
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    mqtt_publisher_stats_t mqtt;
+    http_snapshot_stats_t http;
+    UA_TcpSchedulerStatistics sched;
+    UA_TcpSendStatistics tx;
+    mqtt_publisher_get_stats(&mqtt);
+    http_snapshot_get_stats(&http);
+    UA_ServerNetworkLayerTCP_getSchedulerStatistics(&sched);
+    UA_ServerNetworkLayerTCP_getSendStatistics(&tx);
+
+    render_buf_t rb = { metrics_buf + HTTP_HEADER_RESERVE, sizeof(metrics_buf) - HTTP_HEADER_RESERVE, 0, false };
+    render_metrics(&rb, &img, &mqtt, &http, &sched, &tx, now);
+    if (rb.overflow) {
+        ESP_LOGW(TAG, "Metrics buffer too small, output truncated");
+    }
+    finish_response(&metrics_resp, rb.len);
+
+    rb = (render_buf_t){ json_buf + HTTP_HEADER_RESERVE, sizeof(json_buf) - HTTP_HEADER_RESERVE, 0, false };
+    render_json(&rb, &img, &mqtt, &http, &sched, now);
+    if (rb.overflow) {
+        ESP_LOGW(TAG, "JSON buffer too small, output truncated");
+    }
+    finish_response(&json_resp, rb.len);
+
+    rendered = true;
+    rendered_sequence = img.sequence;
+    rendered_at_ms = now;
+
+    taskENTER_CRITICAL(&stats_lock);
+    http_stats.renders++;
+    http_stats.last_render_us = (uint32_t)(esp_timer_get_time() - t0);
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+/* ============================================================================
+ * CONNECTION HANDLING
+ * ============================================================================ */
+
+/**
+ * @brief Close a client connection and free its slot
+ */
+static void client_close(http_client_t *c) {
+    if (c->sock >= 0) {
+        close(c->sock);
+    }
+    c->sock = -1;
+    c->rx_len = 0;
+}
+
+/**
+ * @brief Case-insensitive search for a token in the header block
+ */
+static bool header_contains(const char *headers, size_t len, const char *token) {
+    size_t tlen = strlen(token);
+    for (size_t i = 0; i + tlen <= len; i++) {
+        size_t j = 0;
+        while (j < tlen && tolower((unsigned char)headers[i + j]) == token[j]) {
+            j++;
+        }
+        if (j == tlen) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Send a complete response
+ *
+ * @return true if all bytes were sent
+ */
+static bool client_send(http_client_t *c, const char *data, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(c->sock, data + sent, len - sent, 0);
+        if (n <= 0) {
+            return false;
+        }
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * @brief Answer one complete request
+ *
+ * @param c Client connection
+ * @param req Request (request line + headers, terminated by an empty line)
+ * @param len Request length
+ * @return true to keep the connection open
+ */
+static bool handle_request(http_client_t *c, const char *req, size_t len) {
+    bool keep_alive = !header_contains(req, len, "connection: close") &&
+                      !header_contains(req, len, "http/1.0");
+    const char *data;
+    size_t data_len;
+
+    taskENTER_CRITICAL(&stats_lock);
+    http_stats.requests++;
+    taskEXIT_CRITICAL(&stats_lock);
+
+    if (http_paused) {
+        taskENTER_CRITICAL(&stats_lock);
+        http_stats.unavailable++;
+        taskEXIT_CRITICAL(&stats_lock);
+        client_send(c, resp_unavailable, sizeof(resp_unavailable) - 1);
+        return false;
+    }
+
+    if (len < 5 || memcmp(req, "GET ", 4) != 0) {
+        client_send(c, resp_bad_method, sizeof(resp_bad_method) - 1);
+        return false;
+    }
+
+    const char *path = req + 4;
+    size_t path_len = 0;
+    while (4 + path_len < len && path[path_len] != ' ' && path[path_len] != '?' &&
+           path[path_len] != '\r') {
+        path_len++;
+    }
+
+    cached_response_t *resp = NULL;
+    if ((path_len == 8 && memcmp(path, "/metrics", 8) == 0)) {
+        resp = &metrics_resp;
+    } else if ((path_len == 9 && memcmp(path, "/snapshot", 9) == 0) ||
+               (path_len == 14 && memcmp(path, "/snapshot.json", 14) == 0)) {
+        resp = &json_resp;
+    }
+
+    if (resp != NULL) {
+        refresh_responses();
+    }
+
+    if (resp != NULL && resp->data != NULL) {
+        data = resp->data;
+        data_len = resp->len;
+    } else {
+        data = resp_not_found;
+        data_len = sizeof(resp_not_found) - 1;
+        taskENTER_CRITICAL(&stats_lock);
+        http_stats.not_found++;
+        taskEXIT_CRITICAL(&stats_lock);
+    }
+
+    return client_send(c, data, data_len) && keep_alive;
+}
+
+/**
+ * @brief Read from a client and answer all complete requests
+ */
+static void client_receive(http_client_t *c) {
+    ssize_t n = recv(c->sock, c->rx + c->rx_len, sizeof(c->rx) - 1 - c->rx_len, 0);
+    if (n <= 0) {
+        client_close(c);
+        return;
+    }
+    c->rx_len += (size_t)n;
+    c->rx[c->rx_len] = '\0';
+    c->last_active_ms = get_time_ms();
+
+    /* Requests may be pipelined; answer every complete one */
+    char *end;
+    while (c->sock >= 0 && (end = strstr(c->rx, "\r\n\r\n")) != NULL) {
+        size_t req_len = (size_t)(end - c->rx) + 4;
+        bool keep = handle_request(c, c->rx, req_len);
+        if (!keep) {
+            client_close(c);
+            return;
+        }
+        memmove(c->rx, c->rx + req_len, c->rx_len - req_len + 1);
+        c->rx_len -= req_len;
+    }
+
+    if (c->rx_len >= sizeof(c->rx) - 1) {
+        ESP_LOGW(TAG, "Request header too large, closing connection");
+        client_close(c);
+    }
+}
+
+/**
+ * @brief Accept a new connection into a free slot
+ */
+static void accept_client(int listen_sock) {
+    int sock = accept(listen_sock, NULL, NULL);
+    if (sock < 0) {
+        return;
+    }
+
+    http_client_t *slot = NULL;
+    for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+        if (clients[i].sock < 0) {
+            slot = &clients[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        close(sock);
+        taskENTER_CRITICAL(&stats_lock);
+        http_stats.rejected++;
+        taskEXIT_CRITICAL(&stats_lock);
+        return;
+    }
+
+    struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    slot->sock = sock;
+    slot->rx_len = 0;
+    slot->last_active_ms = get_time_ms();
+
+    taskENTER_CRITICAL(&stats_lock);
+    http_stats.connections++;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+/**
+ * @brief HTTP server task
+ *
+ * Single-threaded select() loop over the listen socket and up to
+ * HTTP_MAX_CLIENTS keep-alive connections.
+ *
+ * @param pvParameters Task parameters (not used)
+ */
+static void http_snapshot_task(void *pvParameters) {
+    int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        http_task_handle = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    int reuse = 1;
+    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(http_config.port);
+
+    if (bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_sock, 4) != 0) {
+        ESP_LOGE(TAG, "Failed to listen on port %u: errno %d", http_config.port, errno);
+        close(listen_sock);
+        http_task_handle = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+        clients[i].sock = -1;
+    }
+
+    ESP_LOGI(TAG, "HTTP snapshot endpoint listening on port %u (/metrics, /snapshot)", http_config.port);
+
+    while (1) {
+        fd_set rset;
+        FD_ZERO(&rset);
+        FD_SET(listen_sock, &rset);
+        int max_fd = listen_sock;
+        for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+            if (clients[i].sock >= 0) {
+                FD_SET(clients[i].sock, &rset);
+                if (clients[i].sock > max_fd) {
+                    max_fd = clients[i].sock;
+                }
+            }
+        }
+
+        struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+        int ready = select(max_fd + 1, &rset, NULL, NULL, &tv);
+        if (ready < 0) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+
+        if (ready > 0 && FD_ISSET(listen_sock, &rset)) {
+            accept_client(listen_sock);
+        }
+
+        uint32_t now = get_time_ms();
+        for (int i = 0; i < HTTP_MAX_CLIENTS; i++) {
+            http_client_t *c = &clients[i];
+            if (c->sock < 0) {
+                continue;
+            }
+            if (ready > 0 && FD_ISSET(c->sock, &rset)) {
+                client_receive(c);
+            } else if ((now - c->last_active_ms) > HTTP_IDLE_TIMEOUT_MS) {
+                client_close(c);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Start the HTTP snapshot task
+ *
+ * @param config Endpoint configuration
+ * @return esp_err_t ESP_OK on success or error code
+ */
+esp_err_t http_snapshot_start(const http_snapshot_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!config->enable) {
+        ESP_LOGI(TAG, "HTTP snapshot endpoint disabled");
+        return ESP_OK;
+    }
+    if (http_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config->port == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    http_config = *config;
+    BaseType_t ret = xTaskCreatePinnedToCore(http_snapshot_task, "http_snap", HTTP_TASK_STACK,
+                                             NULL, HTTP_TASK_PRIORITY, &http_task_handle, 1);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create HTTP snapshot task");
+        http_task_handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Pause or resume the endpoint
+ *
+ * @param paused true to pause
+ */
+void http_snapshot_set_paused(bool paused) {
+    http_paused = paused;
+}
+
+/**
+ * @brief Get endpoint statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void http_snapshot_get_stats(http_snapshot_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    taskENTER_CRITICAL(&stats_lock);
+    *stats = http_stats;
+    taskEXIT_CRITICAL(&stats_lock);
+}
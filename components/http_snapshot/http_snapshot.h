@@ -0,0 +1,88 @@
+/* http_snapshot.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef HTTP_SNAPSHOT_H
+#define HTTP_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * HTTP Snapshot Endpoint
+ * ============================================================================
+ *
+ * Minimal HTTP/1.1 server for monitoring systems. It serves two
+ * pre-rendered documents built from one io_cache snapshot:
+ *
+ *   GET /metrics    Prometheus text exposition format
+ *   GET /snapshot   JSON object
+ *
+ * Complete responses (headers included) are rendered into static buffers
+ * only when the process image changes or the counters are older than
+ * HTTP_SNAPSHOT_REFRESH_MS. Serving a request is a single send() of the
+ * cached response; nothing is allocated per request. Keep-alive
+ * connections are supported.
+ */
+
+/** @brief Maximum age of the counters in a cached response */
+#define HTTP_SNAPSHOT_REFRESH_MS    1000
+
+/**
+ * @brief Endpoint configuration
+ */
+typedef struct {
+    bool enable;                /**< Start the HTTP task */
+    uint16_t port;              /**< TCP listen port */
+} http_snapshot_config_t;
+
+/**
+ * @brief Endpoint statistics
+ */
+typedef struct {
+    uint32_t requests;          /**< Requests answered (all status codes) */
+    uint32_t not_found;         /**< Requests answered with 404 */
+    uint32_t unavailable;       /**< Requests answered with 503 while paused */
+    uint32_t renders;           /**< Response regenerations */
+    uint32_t connections;       /**< Accepted connections */
+    uint32_t rejected;          /**< Connections closed because all slots were busy */
+    uint32_t last_render_us;    /**< Duration of the last regeneration */
+} http_snapshot_stats_t;
+
+/**
+ * @brief Start the HTTP snapshot task
+ *
+ * Does nothing and returns ESP_OK when config->enable is false.
+ *
+ * @param config Endpoint configuration (copied)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if already running,
+ *         ESP_ERR_INVALID_ARG for a bad configuration, ESP_ERR_NO_MEM if the task
+ *         could not be created
+ */
+esp_err_t http_snapshot_start(const http_snapshot_config_t *config);
+
+/**
+ * @brief Pause or resume the endpoint
+ *
+ * While paused every request is answered with 503 Service Unavailable and
+ * nothing is rendered. May be called before the task is started.
+ *
+ * @param paused true to pause
+ */
+void http_snapshot_set_paused(bool paused);
+
+/**
+ * @brief Get endpoint statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void http_snapshot_get_stats(http_snapshot_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTP_SNAPSHOT_H */
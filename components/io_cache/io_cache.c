@@ -3,6 +3,7 @@
 #include "io_cache.h"
 #include "esp_log.h"
 #include "model.h" 
+#include "io_trace.h"
 #include <string.h>
 
 
@@ -48,6 +49,12 @@ typedef struct {
 
 static io_cache_t io_cache;               /**< Main I/O cache instance */
 static io_cache_adc_t adc_cache;          /**< ADC cache instance */
+static volatile uint32_t cache_sequence;  /**< Process image change sequence number */
+static volatile bool cache_replica;       /**< Image replicated from the active unit of a pair */
+static volatile bool outputs_held;        /**< Outputs owned by a self-test, client writes refused */
+
+_Static_assert(IO_CACHE_ADC_CHANNELS == NUM_ADC_CHANNELS,
+               "io_cache snapshot size must match the number of ADC channels");
 
 /**
  * @brief Get current system time in milliseconds
@@ -75,6 +82,9 @@ void io_cache_init(void) {
     
     // Initialize ADC cache
     memset(&adc_cache, 0, sizeof(io_cache_adc_t));
+    cache_sequence = 0;
+    cache_replica = false;
+    outputs_held = false;
     
     ESP_LOGI(TAG, "I/O cache initialized");
 }
@@ -129,6 +139,10 @@ uint16_t io_cache_get_discrete_outputs(uint64_t *source_timestamp, uint64_t *ser
  */
 void io_cache_update_discrete_inputs(uint16_t new_val, uint64_t source_timestamp_ms) {
     if (xSemaphoreTake(io_cache.mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+        if (io_cache.discrete_inputs_cache != new_val) {
+            cache_sequence++;
+            io_trace_record(IO_TRACE_DI, 0, new_val);
+        }
         io_cache.discrete_inputs_cache = new_val;
         io_cache.inputs_timestamp_ms = source_timestamp_ms;
         io_cache.inputs_server_timestamp_ms = get_current_time_ms();
@@ -146,6 +160,10 @@ void io_cache_update_discrete_inputs(uint16_t new_val, uint64_t source_timestamp
  */
 void io_cache_update_discrete_outputs(uint16_t new_val, uint64_t source_timestamp_ms) {
     if (xSemaphoreTake(io_cache.mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+        if (io_cache.discrete_outputs_cache != new_val) {
+            cache_sequence++;
+            io_trace_record(IO_TRACE_DO, 0, new_val);
+        }
         io_cache.discrete_outputs_cache = new_val;
         io_cache.outputs_timestamp_ms = source_timestamp_ms;
         io_cache.outputs_server_timestamp_ms = get_current_time_ms();
@@ -205,6 +223,10 @@ void io_cache_update_adc_channel(int channel, float new_value, uint64_t source_t
     if (channel < 0 || channel >= NUM_ADC_CHANNELS) return;
     
     if (xSemaphoreTake(io_cache.mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+        if (!adc_cache.adc_valid[channel] || adc_cache.adc_cache[channel] != new_value) {
+            cache_sequence++;
+            io_trace_record(IO_TRACE_ADC, (uint8_t)channel, (uint16_t)new_value);
+        }
         adc_cache.adc_cache[channel] = new_value;
         adc_cache.adc_timestamps_ms[channel] = source_timestamp_ms;
         adc_cache.adc_server_timestamps_ms[channel] = get_current_time_ms();
@@ -225,12 +247,160 @@ void io_cache_update_all_adc_channels(float* values, uint64_t source_timestamp_m
     if (!values) return;
     
     if (xSemaphoreTake(io_cache.mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+        bool changed = false;
         for (int i = 0; i < NUM_ADC_CHANNELS; i++) {
+            if (!adc_cache.adc_valid[i] || adc_cache.adc_cache[i] != values[i]) {
+                changed = true;
+                io_trace_record(IO_TRACE_ADC, (uint8_t)i, (uint16_t)values[i]);
+            }
             adc_cache.adc_cache[i] = values[i];
             adc_cache.adc_timestamps_ms[i] = source_timestamp_ms;
             adc_cache.adc_server_timestamps_ms[i] = get_current_time_ms();
             adc_cache.adc_valid[i] = true;
         }
+        if (changed) {
+            cache_sequence++;
+        }
+        xSemaphoreGive(io_cache.mutex);
+    }
+}
+
+/**
+ * @brief Get the process image change sequence number
+ * 
+ * The counter is a single 32-bit word, so it is read without taking the
+ * cache mutex.
+ * 
+ * @return uint32_t Current change sequence number
+ */
+uint32_t io_cache_get_sequence(void) {
+    return cache_sequence;
+}
+
+/**
+ * @brief Copy the complete process image
+ * 
+ * Copies discrete I/O, ADC values and their source timestamps under one
+ * mutex hold, together with the matching sequence number.
+ * 
+ * @param snapshot Pointer to store the image
+ * @return true if the snapshot was taken
+ * @return false if the cache lock could not be acquired
+ */
+bool io_cache_get_snapshot(io_cache_snapshot_t *snapshot) {
+    if (!snapshot) return false;
+    
+    if (xSemaphoreTake(io_cache.mutex, pdMS_TO_TICKS(5)) != pdTRUE) {
+        return false;
+    }
+    
+    snapshot->sequence = cache_sequence;
+    snapshot->discrete_inputs = io_cache.discrete_inputs_cache;
+    snapshot->discrete_outputs = io_cache.discrete_outputs_cache;
+    snapshot->inputs_timestamp_ms = io_cache.inputs_timestamp_ms;
+    snapshot->outputs_timestamp_ms = io_cache.outputs_timestamp_ms;
+    for (int i = 0; i < NUM_ADC_CHANNELS; i++) {
+        snapshot->adc[i] = adc_cache.adc_cache[i];
+        snapshot->adc_valid[i] = adc_cache.adc_valid[i];
+        snapshot->adc_timestamps_ms[i] = adc_cache.adc_timestamps_ms[i];
+    }
+    
+    xSemaphoreGive(io_cache.mutex);
+    return true;
+}
+
+/**
+ * @brief Switch the cache between the local I/O and a replicated image
+ * 
+ * @param replica true while this unit is not the active one
+ */
+void io_cache_set_replica(bool replica) {
+    cache_replica = replica;
+}
+
+/**
+ * @brief Check whether the cache holds a replicated image
+ * 
+ * @return true in replica mode
+ */
+bool io_cache_is_replica(void) {
+    return cache_replica;
+}
+
+/**
+ * @brief Reserve the outputs for a self-test
+ * 
+ * @param held true while client writes to the outputs must be refused
+ */
+void io_cache_set_outputs_held(bool held) {
+    outputs_held = held;
+}
+
+/**
+ * @brief Check whether the outputs are reserved
+ * 
+ * @return true while a self-test drives the outputs
+ */
+bool io_cache_outputs_held(void) {
+    return outputs_held;
+}
+
+/**
+ * @brief Replace the process image with a replicated one
+ * 
+ * @param snapshot Image of the active unit, timestamps in local tick milliseconds
+ * @return true if the image was applied
+ * @return false if the cache lock could not be acquired
+ */
+bool io_cache_apply_snapshot(const io_cache_snapshot_t *snapshot) {
+    if (!snapshot) return false;
+    
+    if (xSemaphoreTake(io_cache.mutex, pdMS_TO_TICKS(20)) != pdTRUE) {
+        return false;
+    }
+    
+    bool changed = io_cache.discrete_inputs_cache != snapshot->discrete_inputs ||
+                   io_cache.discrete_outputs_cache != snapshot->discrete_outputs;
+    for (int i = 0; i < NUM_ADC_CHANNELS; i++) {
+        changed |= adc_cache.adc_valid[i] != snapshot->adc_valid[i] ||
+                   adc_cache.adc_cache[i] != snapshot->adc[i];
+    }
+    
+    uint64_t now = get_current_time_ms();
+    io_cache.discrete_inputs_cache = snapshot->discrete_inputs;
+    io_cache.discrete_outputs_cache = snapshot->discrete_outputs;
+    io_cache.inputs_timestamp_ms = snapshot->inputs_timestamp_ms;
+    io_cache.outputs_timestamp_ms = snapshot->outputs_timestamp_ms;
+    io_cache.inputs_server_timestamp_ms = now;
+    io_cache.outputs_server_timestamp_ms = now;
+    for (int i = 0; i < NUM_ADC_CHANNELS; i++) {
+        adc_cache.adc_cache[i] = snapshot->adc[i];
+        adc_cache.adc_valid[i] = snapshot->adc_valid[i];
+        adc_cache.adc_timestamps_ms[i] = snapshot->adc_timestamps_ms[i];
+        adc_cache.adc_server_timestamps_ms[i] = now;
+    }
+    
+    // Follow the active unit, but never backwards (value_cache keys on the number)
+    if ((int32_t)(snapshot->sequence - cache_sequence) > 0) {
+        cache_sequence = snapshot->sequence;
+    } else if (changed) {
+        cache_sequence++;
+    }
+    
+    xSemaphoreGive(io_cache.mutex);
+    return true;
+}
+
+/**
+ * @brief Raise the sequence number to at least a given value
+ * 
+ * @param sequence Lowest sequence number wanted
+ */
+void io_cache_advance_sequence(uint32_t sequence) {
+    if (xSemaphoreTake(io_cache.mutex, pdMS_TO_TICKS(20)) == pdTRUE) {
+        if ((int32_t)(sequence - cache_sequence) > 0) {
+            cache_sequence = sequence;
+        }
         xSemaphoreGive(io_cache.mutex);
     }
-}
\ No newline at end of file
+}
@@ -67,8 +67,118 @@ void io_cache_update_discrete_outputs(uint16_t new_val, uint64_t source_timestam
  * 
  * Starts the background task that periodically polls hardware I/O
  * and updates the cache with current values.
+ *
+ * @param core_id Core the task is pinned to
  */
-void io_polling_task_start(void);
+void io_polling_task_start(int core_id);
+
+/* ============================================================================
+ * Process Image Snapshot Functions
+ * ============================================================================ */
+
+/** @brief Number of ADC channels held in a snapshot (matches NUM_ADC_CHANNELS) */
+#define IO_CACHE_ADC_CHANNELS 4
+
+/**
+ * @brief Consistent copy of the whole process image
+ *
+ * Filled under a single cache lock, so all fields belong to the same
+ * sequence number.
+ */
+typedef struct {
+    uint32_t sequence;                                  /**< Change sequence number of this image */
+    uint16_t discrete_inputs;                           /**< Discrete input values (16 bits) */
+    uint16_t discrete_outputs;                          /**< Discrete output values (16 bits) */
+    float adc[IO_CACHE_ADC_CHANNELS];                   /**< ADC channel values */
+    bool adc_valid[IO_CACHE_ADC_CHANNELS];              /**< Validity flags for ADC channels */
+    uint64_t inputs_timestamp_ms;                       /**< Source timestamp for inputs */
+    uint64_t outputs_timestamp_ms;                      /**< Source timestamp for outputs */
+    uint64_t adc_timestamps_ms[IO_CACHE_ADC_CHANNELS];  /**< Source timestamps for ADC values */
+} io_cache_snapshot_t;
+
+/**
+ * @brief Get the process image change sequence number
+ *
+ * The sequence is incremented every time a cached value actually changes
+ * (updates with an identical value do not count). Consumers compare it with
+ * the last value they processed to detect changes without locking.
+ *
+ * @return uint32_t Current change sequence number
+ */
+uint32_t io_cache_get_sequence(void);
+
+/**
+ * @brief Copy the complete process image
+ *
+ * @param snapshot Pointer to store the image
+ * @return true if the snapshot was taken
+ * @return false if the cache lock could not be acquired
+ */
+bool io_cache_get_snapshot(io_cache_snapshot_t *snapshot);
+
+/* ============================================================================
+ * Replica Functions (hot-standby redundancy)
+ * ============================================================================ */
+
+/**
+ * @brief Switch the cache between the local I/O and a replicated image
+ *
+ * In replica mode the process image is the one of the active unit of a
+ * redundant pair: the polling task leaves the hardware alone and writes to
+ * the outputs are refused. Set by components/redundancy.
+ *
+ * @param replica true while this unit is not the active one
+ */
+void io_cache_set_replica(bool replica);
+
+/**
+ * @brief Check whether the cache holds a replicated image
+ *
+ * @return true in replica mode
+ */
+bool io_cache_is_replica(void);
+
+/**
+ * @brief Reserve the outputs for a self-test
+ *
+ * While held, OPC UA writes to discrete_outputs are refused, so a test that
+ * toggles an output (components/actuation_test) is not disturbed and does
+ * not overwrite a client's command.
+ *
+ * @param held true while client writes to the outputs must be refused
+ */
+void io_cache_set_outputs_held(bool held);
+
+/**
+ * @brief Check whether the outputs are reserved
+ *
+ * @return true while a self-test drives the outputs
+ */
+bool io_cache_outputs_held(void);
+
+/**
+ * @brief Replace the process image with a replicated one
+ *
+ * Values and source timestamps are taken over under one lock. The sequence
+ * number follows the one of the image so that it continues without a jump
+ * after a takeover; it never goes back, so a change still counts if the
+ * image carries an older number. Replicated changes are not traced.
+ *
+ * @param snapshot Image of the active unit, timestamps in local tick milliseconds
+ * @return true if the image was applied
+ * @return false if the cache lock could not be acquired
+ */
+bool io_cache_apply_snapshot(const io_cache_snapshot_t *snapshot);
+
+/**
+ * @brief Raise the sequence number to at least a given value
+ *
+ * Used by the active unit when the standby reports a higher number, so
+ * that both continue from the same one.
+ *
+ * @param sequence Lowest sequence number wanted
+ */
+void io_cache_advance_sequence(uint32_t sequence);
 
 #ifdef __cplusplus
 }
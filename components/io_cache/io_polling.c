@@ -4,12 +4,20 @@
 #include "esp_log.h"
 #include "freertos/task.h"
 #include "model.h"
+#include "io_trace.h"
+#include "runtime_config.h"
+#include "scan_policy.h"
+#include "esp_timer.h"
 #include <stdint.h>
 
 static const char *TAG = "io_polling";
 
-#define POLL_INPUTS_INTERVAL_MS     20    /**< Polling interval for discrete inputs in milliseconds */
-#define POLL_ADC_INTERVAL_MS        100   /**< Polling interval for ADC channels in milliseconds */
+#define DI_HISTORY_LEN      (RUNTIME_DI_FILTER_MAX + 1)   /**< Raw input scans kept for debouncing */
+
+static uint16_t di_history[DI_HISTORY_LEN];
+static uint8_t di_history_pos = 0;
+static uint16_t di_filtered = 0;
+static uint16_t di_last_raw = 0;
 
 /**
  * @brief Get current system time in milliseconds
@@ -20,16 +28,51 @@ static uint64_t get_current_time_ms(void) {
     return (uint64_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
 }
 
+/**
+ * @brief Debounce the discrete inputs
+ *
+ * A bit follows the raw input only after it had the same value in the last
+ * 1 + scans scans; otherwise it keeps its previous value.
+ *
+ * @param raw Inputs read from hardware
+ * @param scans Debounce length in scans (0 = off)
+ * @return uint16_t Debounced inputs
+ */
+static uint16_t debounce_inputs(uint16_t raw, uint8_t scans) {
+    di_history[di_history_pos] = raw;
+    di_history_pos = (di_history_pos + 1) % DI_HISTORY_LEN;
+    if (scans == 0) {
+        di_filtered = raw;
+        return raw;
+    }
+
+    uint16_t all_set = 0xFFFF;
+    uint16_t any_set = 0;
+    for (int k = 1; k <= scans + 1; k++) {
+        uint16_t sample = di_history[(di_history_pos + DI_HISTORY_LEN - k) % DI_HISTORY_LEN];
+        all_set &= sample;
+        any_set |= sample;
+    }
+    di_filtered = all_set | (di_filtered & any_set);
+    return di_filtered;
+}
+
 /**
  * @brief I/O polling task function
  * 
  * This background task periodically polls hardware I/O (discrete inputs and ADC channels)
- * and updates the cache with current values. The task runs on Core 1 at high priority.
+ * and updates the cache with current values. The task runs at high priority on
+ * the core chosen by io_polling_task_start().
+ * Scan periods and the input debounce come from the runtime configuration
+ * snapshot, read once per loop, so a committed change applies on the next loop.
+ * With the adaptive scan policy enabled, the input scan period is chosen by
+ * scan_policy_next_interval() after every scan instead.
  * 
  * @param pvParameters Task parameters (not used)
  */
 static void io_polling_task(void *pvParameters) {
     TickType_t xLastInputsTime = xTaskGetTickCount();
+    uint16_t inputs_next_ms = 0;    // First scan at once
     static TickType_t xLastAdcTime;  // Declared as static for persistence
     
     // Initialize after declaration
@@ -40,16 +83,34 @@ static void io_polling_task(void *pvParameters) {
     while (1) {
         TickType_t xNow = xTaskGetTickCount();
         
+        // While a trace is replayed its records stand in for the hardware,
+        // on a standby unit the image replicated from the active one
+        if (io_trace_get_state() == IO_TRACE_REPLAYING || io_cache_is_replica()) {
+            vTaskDelay(pdMS_TO_TICKS(50));
+            continue;
+        }
+        
+        const runtime_config_t *cfg = runtime_config_acquire();
+        uint16_t inputs_interval_ms = cfg->scan_interval_ms[RUNTIME_SCAN_INPUTS];
+        uint16_t adc_interval_ms = cfg->scan_interval_ms[RUNTIME_SCAN_ADC];
+        uint8_t inputs_filter = cfg->tags[RUNTIME_TAG_DISCRETE_INPUTS].filter;
+        runtime_config_release(cfg);
+        
         // Poll discrete inputs
-        if ((xNow - xLastInputsTime) * portTICK_PERIOD_MS >= POLL_INPUTS_INTERVAL_MS) {
-            uint16_t inputs = read_discrete_inputs_slow();
+        if ((xNow - xLastInputsTime) * portTICK_PERIOD_MS >= inputs_next_ms) {
+            int64_t scan_start = esp_timer_get_time();
+            uint16_t raw = read_discrete_inputs_slow();
+            uint32_t scan_us = (uint32_t)(esp_timer_get_time() - scan_start);
+            uint16_t inputs = debounce_inputs(raw, inputs_filter);
             uint64_t timestamp = get_current_time_ms();
             io_cache_update_discrete_inputs(inputs, timestamp);
+            inputs_next_ms = scan_policy_next_interval(inputs_interval_ms, raw != di_last_raw, scan_us, timestamp);
+            di_last_raw = raw;
             xLastInputsTime = xNow;
         }
         
         // Poll ADC channels
-        if ((xNow - xLastAdcTime) * portTICK_PERIOD_MS >= POLL_ADC_INTERVAL_MS) {
+        if ((xNow - xLastAdcTime) * portTICK_PERIOD_MS >= adc_interval_ms) {
             update_all_adc_channels_slow();
             xLastAdcTime = xNow;
         }
@@ -62,10 +123,15 @@ static void io_polling_task(void *pvParameters) {
  * @brief Start the I/O polling task
  * 
  * Creates and starts the background task that periodically polls hardware I/O.
- * The task is pinned to Core 1 with priority 8 for reliable real-time operation.
+ * The task runs with priority 8 for reliable real-time operation.
+ *
+ * @param core_id Core the task is pinned to (the one without the OPC UA task)
  */
-void io_polling_task_start(void) {
-    xTaskCreatePinnedToCore(io_polling_task, "io_poll", 4096, NULL, 
-                           8, NULL, 1);
-    ESP_LOGI(TAG, "IO polling task created");
+void io_polling_task_start(int core_id) {
+    if (xTaskCreatePinnedToCore(io_polling_task, "io_poll", 4096, NULL,
+                                8, NULL, core_id) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create IO polling task");
+        return;
+    }
+    ESP_LOGI(TAG, "IO polling task created on core %d", core_id);
 }
\ No newline at end of file
@@ -0,0 +1,372 @@
+/* io_trace.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "io_trace.h"
+#include "io_cache.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "io_trace";
+
+#define IO_TRACE_TASK_STACK     3072    /**< Replay task stack size */
+#define IO_TRACE_TASK_PRIORITY  8       /**< Same as the I/O polling task it stands in for */
+
+_Static_assert(sizeof(io_trace_header_t) == 16, "trace header must be 16 bytes");
+_Static_assert(sizeof(io_trace_record_t) == 8, "trace record must be 8 bytes");
+
+static io_trace_record_t *ring = NULL;      /**< Record buffer, allocated on first use */
+static uint32_t ring_capacity = IO_TRACE_DEFAULT_CAPACITY;
+static uint32_t ring_head;                  /**< Index of the oldest record */
+static uint32_t ring_count;                 /**< Records held */
+static uint32_t ring_dropped;               /**< Records overwritten */
+static int64_t record_start_us;             /**< esp_timer time of io_trace_start() */
+static io_trace_header_t load_header;       /**< Header received by io_trace_load() */
+static volatile io_trace_state_t trace_state = IO_TRACE_IDLE;
+static uint32_t replay_speed;
+static uint32_t replayed;
+static uint32_t replay_late_ms;
+static TaskHandle_t replay_task_handle = NULL;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Allocate the record buffer if not done yet
+ *
+ * @return true if the buffer is available
+ */
+static bool ensure_buffer(void) {
+    if (ring != NULL) {
+        return true;
+    }
+    ring = malloc(ring_capacity * sizeof(io_trace_record_t));
+    if (ring == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate %u records", (unsigned)ring_capacity);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Serialized header for the current buffer contents
+ */
+static void build_header(io_trace_header_t *hdr) {
+    hdr->magic = IO_TRACE_MAGIC;
+    hdr->version = IO_TRACE_VERSION;
+    hdr->record_size = sizeof(io_trace_record_t);
+    hdr->count = ring_count;
+    hdr->dropped = ring_dropped;
+}
+
+/**
+ * @brief Initialize the recorder
+ *
+ * @param config Configuration (copied)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if recording could not start
+ */
+esp_err_t io_trace_init(const io_trace_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ring == NULL && config->capacity > 0) {
+        ring_capacity = config->capacity;
+    }
+    if (!config->enable) {
+        return ESP_OK;
+    }
+    esp_err_t err = io_trace_start();
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Recording started (%u records, %u bytes)",
+                 (unsigned)ring_capacity, (unsigned)(ring_capacity * sizeof(io_trace_record_t)));
+    }
+    return err;
+}
+
+/**
+ * @brief Clear the buffer and start recording
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM, or ESP_ERR_INVALID_STATE during replay
+ */
+esp_err_t io_trace_start(void) {
+    if (trace_state == IO_TRACE_REPLAYING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!ensure_buffer()) {
+        return ESP_ERR_NO_MEM;
+    }
+    taskENTER_CRITICAL(&trace_lock);
+    ring_head = 0;
+    ring_count = 0;
+    ring_dropped = 0;
+    record_start_us = esp_timer_get_time();
+    trace_state = IO_TRACE_RECORDING;
+    taskEXIT_CRITICAL(&trace_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief Stop recording or replay; the buffer is kept
+ *
+ * A running replay task notices the state change before its next record.
+ */
+void io_trace_stop(void) {
+    taskENTER_CRITICAL(&trace_lock);
+    trace_state = IO_TRACE_IDLE;
+    taskEXIT_CRITICAL(&trace_lock);
+}
+
+/**
+ * @brief Append a record if recording
+ *
+ * When the buffer is full the oldest record is overwritten.
+ *
+ * @param type Record type
+ * @param channel ADC channel, 0 otherwise
+ * @param value New value
+ */
+void io_trace_record(io_trace_type_t type, uint8_t channel, uint16_t value) {
+    if (trace_state != IO_TRACE_RECORDING) {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&trace_lock);
+    if (trace_state == IO_TRACE_RECORDING) {
+        uint32_t idx = (ring_head + ring_count) % ring_capacity;
+        if (ring_count == ring_capacity) {
+            ring_head = (ring_head + 1) % ring_capacity;
+            ring_dropped++;
+        } else {
+            ring_count++;
+        }
+        ring[idx].time_ms = (uint32_t)((now_us - record_start_us) / 1000);
+        ring[idx].type = (uint8_t)type;
+        ring[idx].channel = channel;
+        ring[idx].value = value;
+    }
+    taskEXIT_CRITICAL(&trace_lock);
+}
+
+/**
+ * @brief Size of the serialized trace in bytes (header included)
+ */
+size_t io_trace_size(void) {
+    return sizeof(io_trace_header_t) + (size_t)ring_count * sizeof(io_trace_record_t);
+}
+
+/**
+ * @brief Copy part of the serialized trace
+ *
+ * @param offset Byte offset into the serialized trace
+ * @param buf Destination
+ * @param len Bytes requested
+ * @return size_t Bytes copied (0 past the end)
+ */
+size_t io_trace_read(size_t offset, uint8_t *buf, size_t len) {
+    if (buf == NULL) {
+        return 0;
+    }
+    size_t copied = 0;
+
+    taskENTER_CRITICAL(&trace_lock);
+    size_t total = io_trace_size();
+    if (offset < total && len > total - offset) {
+        len = total - offset;
+    }
+    if (offset < sizeof(io_trace_header_t) && len > 0) {
+        io_trace_header_t hdr;
+        build_header(&hdr);
+        size_t n = sizeof(hdr) - offset;
+        if (n > len) n = len;
+        memcpy(buf, (const uint8_t *)&hdr + offset, n);
+        copied = n;
+    }
+    /* Records are copied piecewise because the ring may wrap */
+    while (copied < len && offset + copied < total) {
+        size_t pos = offset + copied - sizeof(io_trace_header_t);
+        uint32_t rec = (uint32_t)(pos / sizeof(io_trace_record_t));
+        size_t in_rec = pos % sizeof(io_trace_record_t);
+        const uint8_t *src = (const uint8_t *)&ring[(ring_head + rec) % ring_capacity];
+        size_t n = sizeof(io_trace_record_t) - in_rec;
+        if (n > len - copied) n = len - copied;
+        memcpy(buf + copied, src + in_rec, n);
+        copied += n;
+    }
+    taskEXIT_CRITICAL(&trace_lock);
+    return copied;
+}
+
+/**
+ * @brief Load part of a serialized trace (for replay)
+ *
+ * @param offset Byte offset into the serialized trace
+ * @param data Bytes to store
+ * @param len Number of bytes
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if not idle,
+ *         ESP_ERR_INVALID_SIZE if the data exceeds the buffer, ESP_ERR_NO_MEM
+ */
+esp_err_t io_trace_load(size_t offset, const uint8_t *data, size_t len) {
+    if (data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (trace_state != IO_TRACE_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (offset + len > sizeof(io_trace_header_t) + (size_t)ring_capacity * sizeof(io_trace_record_t)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!ensure_buffer()) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    taskENTER_CRITICAL(&trace_lock);
+    if (offset == 0) {
+        /* A new trace: records are stored linearly from index 0 */
+        ring_head = 0;
+        ring_count = 0;
+        ring_dropped = 0;
+        memset(&load_header, 0, sizeof(load_header));
+    }
+    size_t done = 0;
+    if (offset < sizeof(io_trace_header_t)) {
+        size_t n = sizeof(io_trace_header_t) - offset;
+        if (n > len) n = len;
+        memcpy((uint8_t *)&load_header + offset, data, n);
+        done = n;
+        if (offset + n == sizeof(io_trace_header_t)) {
+            bool valid = load_header.magic == IO_TRACE_MAGIC &&
+                         load_header.version == IO_TRACE_VERSION &&
+                         load_header.record_size == sizeof(io_trace_record_t) &&
+                         load_header.count <= ring_capacity;
+            ring_count = valid ? load_header.count : 0;
+            ring_dropped = valid ? load_header.dropped : 0;
+        }
+    }
+    if (done < len) {
+        size_t pos = offset + done - sizeof(io_trace_header_t);
+        memcpy((uint8_t *)ring + pos, data + done, len - done);
+    }
+    taskEXIT_CRITICAL(&trace_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief Apply one input record to the I/O cache
+ */
+static void replay_apply(const io_trace_record_t *rec) {
+    /* Same time base as the polling task */
+    uint64_t now_ms = (uint64_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+    switch (rec->type) {
+        case IO_TRACE_DI:
+            io_cache_update_discrete_inputs(rec->value, now_ms);
+            break;
+        case IO_TRACE_ADC:
+            io_cache_update_adc_channel(rec->channel, (float)rec->value, now_ms);
+            break;
+        default:
+            /* Outputs and client writes are not replayed on the device */
+            break;
+    }
+}
+
+/**
+ * @brief Replay task: feeds the buffer into the I/O cache on the recorded timeline
+ *
+ * Records closer together than one tick are applied back to back; the
+ * resulting delay is reported as replay_late_ms.
+ *
+ * @param pvParameters Task parameters (not used)
+ */
+static void io_trace_replay_task(void *pvParameters) {
+    int64_t start_us = esp_timer_get_time();
+    uint32_t count = ring_count;
+
+    for (uint32_t i = 0; i < count && trace_state == IO_TRACE_REPLAYING; i++) {
+        io_trace_record_t rec = ring[(ring_head + i) % ring_capacity];
+
+        if (replay_speed > 0) {
+            int64_t due_us = start_us + (int64_t)rec.time_ms * 1000 * 100 / replay_speed;
+            int64_t wait_us = due_us - esp_timer_get_time();
+            if (wait_us >= (int64_t)portTICK_PERIOD_MS * 1000) {
+                vTaskDelay((TickType_t)(wait_us / 1000 / portTICK_PERIOD_MS));
+            }
+            int64_t late_us = esp_timer_get_time() - due_us;
+            if (late_us > (int64_t)replay_late_ms * 1000) {
+                replay_late_ms = (uint32_t)(late_us / 1000);
+            }
+        }
+
+        replay_apply(&rec);
+        replayed = i + 1;
+    }
+
+    ESP_LOGI(TAG, "Replay finished: %u of %u records, max %u ms late",
+             (unsigned)replayed, (unsigned)count, (unsigned)replay_late_ms);
+    taskENTER_CRITICAL(&trace_lock);
+    if (trace_state == IO_TRACE_REPLAYING) {
+        trace_state = IO_TRACE_IDLE;
+    }
+    replay_task_handle = NULL;
+    taskEXIT_CRITICAL(&trace_lock);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Replay the trace held in the buffer
+ *
+ * @param speed_percent 100 = recorded timing, 0 = as fast as possible
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if not idle,
+ *         ESP_ERR_INVALID_ARG for an empty trace, ESP_ERR_NO_MEM
+ */
+esp_err_t io_trace_replay_start(uint16_t speed_percent) {
+    if (trace_state != IO_TRACE_IDLE || replay_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (ring == NULL || ring_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    replay_speed = speed_percent;
+    replayed = 0;
+    replay_late_ms = 0;
+    trace_state = IO_TRACE_REPLAYING;
+
+    BaseType_t ret = xTaskCreatePinnedToCore(io_trace_replay_task, "io_replay",
+                                             IO_TRACE_TASK_STACK, NULL,
+                                             IO_TRACE_TASK_PRIORITY, &replay_task_handle, 1);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create replay task");
+        replay_task_handle = NULL;
+        trace_state = IO_TRACE_IDLE;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Replaying %u records at %u%%", (unsigned)ring_count, (unsigned)speed_percent);
+    return ESP_OK;
+}
+
+/**
+ * @brief Get the recorder state
+ */
+io_trace_state_t io_trace_get_state(void) {
+    return trace_state;
+}
+
+/**
+ * @brief Get recorder statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void io_trace_get_stats(io_trace_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    taskENTER_CRITICAL(&trace_lock);
+    stats->state = trace_state;
+    stats->capacity = ring_capacity;
+    stats->count = ring_count;
+    stats->dropped = ring_dropped;
+    stats->replayed = replayed;
+    stats->replay_late_ms = replay_late_ms;
+    taskEXIT_CRITICAL(&trace_lock);
+}
@@ -0,0 +1,190 @@
+/* io_trace.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef IO_TRACE_H
+#define IO_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * I/O Trace Recorder and Replay
+ * ============================================================================
+ *
+ * Records every process image change (discrete inputs/outputs, ADC) and
+ * every client write command with a millisecond timestamp into a RAM ring
+ * buffer. When the buffer is full the oldest records are overwritten, so
+ * the trace always holds the latest history.
+ *
+ * Serialized trace (little-endian), as read through io_trace_read():
+ *
+ *   io_trace_header_t   16 bytes
+ *   io_trace_record_t   8 bytes x count, oldest first
+ *
+ * A trace loaded with io_trace_load() can be replayed into the I/O cache at
+ * real or scaled speed. Replay drives only the input side (discrete inputs
+ * and ADC channels, as if read from hardware); output and write records
+ * are skipped so no relay is switched. Hardware polling is suspended while
+ * a replay runs.
+ */
+
+/** @brief Trace magic ("A16T") */
+#define IO_TRACE_MAGIC          0x54363141u
+/** @brief Trace format version */
+#define IO_TRACE_VERSION        1
+/** @brief Default ring buffer capacity in records (8 bytes each) */
+#define IO_TRACE_DEFAULT_CAPACITY   2048
+
+/**
+ * @brief Record types
+ */
+typedef enum {
+    IO_TRACE_DI = 1,            /**< Discrete inputs changed (value = 16 bits) */
+    IO_TRACE_DO = 2,            /**< Discrete outputs changed in the cache */
+    IO_TRACE_ADC = 3,           /**< ADC channel changed (channel 0-3, raw value) */
+    IO_TRACE_WRITE_DO = 4,      /**< Client wrote discrete_outputs */
+    IO_TRACE_WRITE_LOOPBACK = 5 /**< Client wrote loopback_input */
+} io_trace_type_t;
+
+/**
+ * @brief Recorder state
+ */
+typedef enum {
+    IO_TRACE_IDLE = 0,
+    IO_TRACE_RECORDING = 1,
+    IO_TRACE_REPLAYING = 2
+} io_trace_state_t;
+
+/**
+ * @brief Serialized trace header
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;             /**< IO_TRACE_MAGIC */
+    uint16_t version;           /**< IO_TRACE_VERSION */
+    uint16_t record_size;       /**< sizeof(io_trace_record_t) */
+    uint32_t count;             /**< Records following the header */
+    uint32_t dropped;           /**< Older records overwritten while recording */
+} io_trace_header_t;
+
+/**
+ * @brief One trace record
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;           /**< Milliseconds since the recording started */
+    uint8_t type;               /**< io_trace_type_t */
+    uint8_t channel;            /**< ADC channel, 0 otherwise */
+    uint16_t value;             /**< New value */
+} io_trace_record_t;
+
+/**
+ * @brief Recorder configuration
+ */
+typedef struct {
+    bool enable;                /**< Start recording at boot */
+    uint32_t capacity;          /**< Ring buffer size in records (0 = default) */
+} io_trace_config_t;
+
+/**
+ * @brief Recorder statistics
+ */
+typedef struct {
+    io_trace_state_t state;     /**< Current state */
+    uint32_t capacity;          /**< Ring buffer size in records */
+    uint32_t count;             /**< Records held */
+    uint32_t dropped;           /**< Records overwritten since the last start */
+    uint32_t replayed;          /**< Records applied by the current/last replay */
+    uint32_t replay_late_ms;    /**< Largest replay delay behind the schedule */
+} io_trace_stats_t;
+
+/**
+ * @brief Initialize the recorder
+ *
+ * The ring buffer is allocated on first use. When config->enable is set,
+ * recording starts immediately.
+ *
+ * @param config Configuration (copied)
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if recording could not start
+ */
+esp_err_t io_trace_init(const io_trace_config_t *config);
+
+/**
+ * @brief Clear the buffer and start recording
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM, or ESP_ERR_INVALID_STATE during replay
+ */
+esp_err_t io_trace_start(void);
+
+/**
+ * @brief Stop recording or replay; the buffer is kept
+ */
+void io_trace_stop(void);
+
+/**
+ * @brief Append a record if recording (cheap no-op otherwise)
+ *
+ * Safe to call from any task.
+ */
+void io_trace_record(io_trace_type_t type, uint8_t channel, uint16_t value);
+
+/**
+ * @brief Size of the serialized trace in bytes (header included)
+ */
+size_t io_trace_size(void);
+
+/**
+ * @brief Copy part of the serialized trace
+ *
+ * Stop recording first for a consistent dump across several calls.
+ *
+ * @param offset Byte offset into the serialized trace
+ * @param buf    Destination
+ * @param len    Bytes requested
+ * @return size_t Bytes copied (0 past the end)
+ */
+size_t io_trace_read(size_t offset, uint8_t *buf, size_t len);
+
+/**
+ * @brief Load part of a serialized trace (for replay)
+ *
+ * The chunk at offset 0 (header) starts a new trace and must come first;
+ * the remaining chunks may follow in any order. A header that does not
+ * describe a trace fitting the buffer leaves it empty. Only allowed while idle.
+ *
+ * @param offset Byte offset into the serialized trace
+ * @param data   Bytes to store
+ * @param len    Number of bytes
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if not idle,
+ *         ESP_ERR_INVALID_SIZE if the data exceeds the buffer, ESP_ERR_NO_MEM
+ */
+esp_err_t io_trace_load(size_t offset, const uint8_t *data, size_t len);
+
+/**
+ * @brief Replay the trace held in the buffer
+ *
+ * @param speed_percent 100 = recorded timing, 1000 = ten times faster,
+ *                      0 = as fast as possible
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE if not idle,
+ *         ESP_ERR_INVALID_ARG for an empty or invalid trace, ESP_ERR_NO_MEM
+ */
+esp_err_t io_trace_replay_start(uint16_t speed_percent);
+
+/**
+ * @brief Get the recorder state
+ */
+io_trace_state_t io_trace_get_state(void);
+
+/**
+ * @brief Get recorder statistics
+ */
+void io_trace_get_stats(io_trace_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IO_TRACE_H */
@@ -0,0 +1,193 @@
+/* scan_policy.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "scan_policy.h"
+#include "esp_log.h"
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "scan_policy";
+
+static scan_policy_config_t policy_config;
+
+/* Counted by the OPC UA task and every I2C user, taken by the polling task */
+static atomic_uint reads;
+static atomic_uint bus_busy_us;
+
+/* Polling task state */
+static uint64_t fast_until_ms;
+static uint64_t window_start_ms;
+static uint32_t window_reads;
+static uint32_t window_bus_us;
+static uint32_t window_scan_us;
+static uint16_t window_scans;
+static uint32_t cost_us;            /**< Average scan bus time, x16 */
+
+/* Written by the polling task only; readers may see fields of consecutive scans */
+static scan_policy_stats_t stats;
+
+static const char *reason_names[] = { "fixed", "activity", "demand", "idle", "budget" };
+
+/**
+ * @brief Close a measurement window: demand, scan rate, bus load and budget floor
+ */
+static void close_window(uint64_t now_ms) {
+    uint32_t elapsed_ms = (uint32_t)(now_ms - window_start_ms);
+    uint32_t read_count = atomic_load(&reads) - window_reads;
+    uint32_t bus_us = atomic_load(&bus_busy_us) - window_bus_us;
+
+    stats.demand_ms = read_count >= 2 ? (uint16_t)(elapsed_ms / read_count) : 0;
+    stats.scan_rate_x10 = (uint16_t)(window_scans * 10000u / elapsed_ms);
+    stats.bus_load_permille = (uint16_t)((uint64_t)bus_us / elapsed_ms);
+    if (stats.bus_load_permille > 1000) {
+        stats.bus_load_permille = 1000;
+    }
+
+    // What the budget leaves for input scans after the other bus traffic
+    uint32_t budget_us = (uint32_t)policy_config.bus_budget_pct * 10u * elapsed_ms;
+    uint32_t other_us = bus_us > window_scan_us ? bus_us - window_scan_us : 0;
+    uint32_t floor_ms = policy_config.max_interval_ms;
+    if (budget_us > other_us) {
+        // One scan of cost_us per floor_ms may use (budget - other) / elapsed of the bus
+        floor_ms = (uint32_t)(((uint64_t)cost_us / 16 * elapsed_ms + (budget_us - other_us) - 1) /
+                              (budget_us - other_us));
+    }
+    stats.floor_ms = (uint16_t)(floor_ms > policy_config.max_interval_ms ? policy_config.max_interval_ms : floor_ms);
+
+    window_start_ms = now_ms;
+    window_reads += read_count;
+    window_bus_us += bus_us;
+    window_scan_us = 0;
+    window_scans = 0;
+}
+
+/**
+ * @brief Initialize the scan policy
+ *
+ * @param config Configuration (copied)
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t scan_policy_init(const scan_policy_config_t *config) {
+    if (config == NULL || config->min_interval_ms == 0 || config->min_interval_ms > config->max_interval_ms ||
+        config->bus_budget_pct == 0 || config->bus_budget_pct > 100) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    policy_config = *config;
+    memset(&stats, 0, sizeof(stats));
+    stats.enabled = config->enable;
+    stats.reason = config->enable ? SCAN_REASON_IDLE : SCAN_REASON_FIXED;
+    stats.interval_ms = config->min_interval_ms;
+    stats.floor_ms = config->min_interval_ms;
+    fast_until_ms = 0;
+    window_start_ms = 0;
+    window_reads = atomic_load(&reads);
+    window_bus_us = atomic_load(&bus_busy_us);
+    window_scan_us = 0;
+    window_scans = 0;
+    cost_us = 0;
+    ESP_LOGI(TAG, "Adaptive input scan %s: %u-%u ms, hold %u ms, bus budget %u%%",
+             config->enable ? "enabled" : "disabled", config->min_interval_ms, config->max_interval_ms,
+             config->hold_ms, config->bus_budget_pct);
+    return ESP_OK;
+}
+
+/**
+ * @brief Count an OPC UA read of discrete_inputs
+ */
+void scan_policy_note_read(void) {
+    atomic_fetch_add_explicit(&reads, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Account I2C bus time
+ *
+ * @param busy_us Time the bus was held
+ */
+void scan_policy_note_bus(uint32_t busy_us) {
+    atomic_fetch_add_explicit(&bus_busy_us, busy_us, memory_order_relaxed);
+}
+
+/**
+ * @brief Interval to the next input scan
+ *
+ * @param fixed_ms Interval of the runtime configuration (used when disabled)
+ * @param changed The scan found a changed input
+ * @param scan_us Bus time of the scan
+ * @param now_ms Current time in milliseconds
+ * @return uint16_t Interval in milliseconds
+ */
+uint16_t scan_policy_next_interval(uint16_t fixed_ms, bool changed, uint32_t scan_us, uint64_t now_ms) {
+    stats.scans++;
+    if (changed) {
+        stats.changes++;
+    }
+    window_scans++;
+    window_scan_us += scan_us;
+    cost_us = cost_us == 0 ? scan_us * 16 : cost_us - cost_us / 16 + scan_us;
+    stats.scan_cost_us = (uint16_t)(cost_us / 16 > UINT16_MAX ? UINT16_MAX : cost_us / 16);
+    if (window_start_ms == 0) {
+        window_start_ms = now_ms;
+    } else if (now_ms - window_start_ms >= SCAN_POLICY_WINDOW_MS) {
+        close_window(now_ms);
+    }
+
+    if (!policy_config.enable) {
+        stats.reason = SCAN_REASON_FIXED;
+        stats.interval_ms = fixed_ms;
+        return fixed_ms;
+    }
+
+    // Activity, then back-off by a quarter per scan
+    uint32_t interval;
+    scan_reason_t reason;
+    if (changed) {
+        fast_until_ms = now_ms + policy_config.hold_ms;
+    }
+    if (now_ms < fast_until_ms) {
+        interval = policy_config.min_interval_ms;
+        reason = SCAN_REASON_ACTIVITY;
+    } else {
+        interval = stats.interval_ms + stats.interval_ms / 4 + 1;
+        reason = SCAN_REASON_IDLE;
+    }
+
+    // Readers: at most half their interval old
+    if (stats.demand_ms > 0 && interval > stats.demand_ms / 2u) {
+        interval = stats.demand_ms / 2u;
+        reason = SCAN_REASON_DEMAND;
+    }
+
+    if (interval < policy_config.min_interval_ms) {
+        interval = policy_config.min_interval_ms;
+    }
+    if (interval < stats.floor_ms) {
+        interval = stats.floor_ms;
+        reason = SCAN_REASON_BUDGET;
+        stats.budget_limited++;
+    }
+    if (interval > policy_config.max_interval_ms) {
+        interval = policy_config.max_interval_ms;
+    }
+
+    stats.reason = reason;
+    stats.interval_ms = (uint16_t)interval;
+    return (uint16_t)interval;
+}
+
+/**
+ * @brief Get the metrics
+ *
+ * @param out Pointer to store them
+ */
+void scan_policy_get_stats(scan_policy_stats_t *out) {
+    *out = stats;
+}
+
+/**
+ * @brief Name of a reason
+ *
+ * @param reason Reason
+ * @return const char* Reason name
+ */
+const char *scan_policy_reason_name(scan_reason_t reason) {
+    return (unsigned)reason < sizeof(reason_names) / sizeof(reason_names[0]) ? reason_names[reason] : "unknown";
+}
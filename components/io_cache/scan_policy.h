@@ -0,0 +1,137 @@
+/* scan_policy.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef SCAN_POLICY_H
+#define SCAN_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Adaptive Discrete Input Scan Rate
+ * ============================================================================
+ *
+ * The polling task asks scan_policy_next_interval() after every input scan
+ * how long to wait for the next one. The interval is chosen from:
+ *
+ *   activity  an input change drops the interval to min_interval_ms and
+ *             keeps it there for hold_ms after the last change
+ *   idle      afterwards it grows by a quarter per scan up to max_interval_ms
+ *   demand    OPC UA reads of discrete_inputs (client reads and monitored
+ *             item sampling) are counted per second; the interval stays at
+ *             or below half the average time between them, so a value read
+ *             is never older than half a read interval
+ *   budget    the I2C bus may be busy at most bus_budget_pct percent of the
+ *             time; the interval is never shorter than the cost of one scan
+ *             divided by what the budget leaves after the other bus traffic
+ *             (output writes), measured over the last second
+ *
+ * The budget wins over activity and demand, and the result always lies in
+ * [min_interval_ms, max_interval_ms]. When the policy is disabled the
+ * runtime configuration's fixed input scan interval applies.
+ */
+
+/** @brief Length of the measurement window for rates and bus load */
+#define SCAN_POLICY_WINDOW_MS       1000
+
+/**
+ * @brief Adaptive scan configuration
+ */
+typedef struct {
+    bool enable;                /**< Adapt the input scan interval */
+    uint16_t min_interval_ms;   /**< Fastest scan (activity, demand) */
+    uint16_t max_interval_ms;   /**< Slowest scan (idle inputs, no fast readers) */
+    uint16_t hold_ms;           /**< Fast scanning kept after the last input change */
+    uint8_t bus_budget_pct;     /**< Highest I2C bus utilisation (1-100 %) */
+} scan_policy_config_t;
+
+/**
+ * @brief What set the current interval
+ */
+typedef enum {
+    SCAN_REASON_FIXED = 0,      /**< Policy disabled, runtime configuration interval */
+    SCAN_REASON_ACTIVITY,       /**< Recent input change */
+    SCAN_REASON_DEMAND,         /**< Fast OPC UA readers */
+    SCAN_REASON_IDLE,           /**< Backing off, or at max_interval_ms */
+    SCAN_REASON_BUDGET          /**< Held back by the bus budget */
+} scan_reason_t;
+
+/**
+ * @brief Scan rate and bus load metrics
+ */
+typedef struct {
+    bool enabled;               /**< Policy active */
+    scan_reason_t reason;       /**< What set the current interval */
+    uint16_t interval_ms;       /**< Current scan interval */
+    uint16_t demand_ms;         /**< Average time between reads in the last window (0 = none) */
+    uint16_t floor_ms;          /**< Shortest interval the bus budget allows */
+    uint16_t scan_rate_x10;     /**< Scans per second in the last window, times 10 */
+    uint16_t bus_load_permille; /**< I2C busy time in the last window, per mille */
+    uint16_t scan_cost_us;      /**< Average bus time of one input scan */
+    uint32_t scans;             /**< Input scans since boot */
+    uint32_t changes;           /**< Scans that found a changed input */
+    uint32_t budget_limited;    /**< Scans whose interval the budget lengthened */
+} scan_policy_stats_t;
+
+/**
+ * @brief Initialize the scan policy
+ *
+ * @param config Configuration (copied)
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_ARG for an empty or
+ *         out-of-range interval range or budget
+ */
+esp_err_t scan_policy_init(const scan_policy_config_t *config);
+
+/**
+ * @brief Count an OPC UA read of discrete_inputs
+ *
+ * Lock-free; called from the read callback.
+ */
+void scan_policy_note_read(void);
+
+/**
+ * @brief Account I2C bus time
+ *
+ * Lock-free; called by every PCF8574 transfer path, input scans included.
+ *
+ * @param busy_us Time the bus was held
+ */
+void scan_policy_note_bus(uint32_t busy_us);
+
+/**
+ * @brief Interval to the next input scan
+ *
+ * Call after each input scan, in the polling task.
+ *
+ * @param fixed_ms Interval of the runtime configuration (used when disabled)
+ * @param changed The scan found a changed input
+ * @param scan_us Bus time of the scan
+ * @param now_ms Current time in milliseconds
+ * @return uint16_t Interval in milliseconds
+ */
+uint16_t scan_policy_next_interval(uint16_t fixed_ms, bool changed, uint32_t scan_us, uint64_t now_ms);
+
+/**
+ * @brief Get the metrics
+ *
+ * @param stats Pointer to store them
+ */
+void scan_policy_get_stats(scan_policy_stats_t *stats);
+
+/**
+ * @brief Name of a reason
+ *
+ * @param reason Reason
+ * @return const char* "fixed", "activity", "demand", "idle" or "budget"
+ */
+const char *scan_policy_reason_name(scan_reason_t reason);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCAN_POLICY_H */
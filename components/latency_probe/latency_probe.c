@@ -0,0 +1,170 @@
+/* latency_probe.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "latency_probe.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "latency_probe";
+
+/* Callbacks run in the OPC UA task only, so the probe needs no lock */
+static UA_Int64 request[LATENCY_PROBE_REQUEST_FIELDS];
+static UA_Int64 result[LATENCY_PROBE_RESULT_FIELDS];
+static UA_Boolean result_valid = false;
+
+/**
+ * @brief OPC UA read callback for Request
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Node context (not used)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readProbeRequest(UA_Server *server,
+                 const UA_NodeId *sessionId, void *sessionContext,
+                 const UA_NodeId *nodeId, void *nodeContext,
+                 UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                 UA_DataValue *dataValue) {
+    UA_StatusCode status = UA_Variant_setArrayCopy(&dataValue->value, request,
+                                                   LATENCY_PROBE_REQUEST_FIELDS,
+                                                   &UA_TYPES[UA_TYPES_INT64]);
+    dataValue->hasValue = status == UA_STATUSCODE_GOOD;
+    return status;
+}
+
+/**
+ * @brief OPC UA write callback for Request
+ *
+ * Stamps the receive and execution times of the write into Result.
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being written
+ * @param nodeContext Node context (not used)
+ * @param range Data range (not used)
+ * @param data Data value to write
+ * @return UA_StatusCode Status of write operation
+ */
+static UA_StatusCode
+writeProbeRequest(UA_Server *server,
+                  const UA_NodeId *sessionId, void *sessionContext,
+                  const UA_NodeId *nodeId, void *nodeContext,
+                  const UA_NumericRange *range, const UA_DataValue *data) {
+    UA_Int64 executed = UA_ServerNetworkLayer_nowUs();
+    if (!data->hasValue || data->value.type != &UA_TYPES[UA_TYPES_INT64] ||
+        UA_Variant_isScalar(&data->value) ||
+        data->value.arrayLength != LATENCY_PROBE_REQUEST_FIELDS) {
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+    }
+    memcpy(request, data->value.data, sizeof(request));
+
+    // Without a network receive time (a local write) the request arrived now
+    UA_Int64 received = UA_ServerNetworkLayer_getReceiveTime();
+    memset(result, 0, sizeof(result));
+    result[LATENCY_PROBE_SEQUENCE] = request[0];
+    result[LATENCY_PROBE_CLIENT_TIME] = request[1];
+    result[LATENCY_PROBE_RECEIVED] = received != 0 ? received : executed;
+    result[LATENCY_PROBE_EXECUTED] = executed;
+    result_valid = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief OPC UA read callback for Result
+ *
+ * The first read after a write, by a client or the sampling of a monitored
+ * item, stamps the delivery; later reads return the same value, so a
+ * subscription reports each probe once.
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Node context (not used)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readProbeResult(UA_Server *server,
+                const UA_NodeId *sessionId, void *sessionContext,
+                const UA_NodeId *nodeId, void *nodeContext,
+                UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                UA_DataValue *dataValue) {
+    if (result_valid && result[LATENCY_PROBE_DELIVERED] == 0) {
+        result[LATENCY_PROBE_DELIVERED] = UA_ServerNetworkLayer_nowUs();
+        result[LATENCY_PROBE_DELIVERY_RECEIVED] = UA_ServerNetworkLayer_getReceiveTime();
+    }
+    UA_StatusCode status = UA_Variant_setArrayCopy(&dataValue->value, result,
+                                                   LATENCY_PROBE_RESULT_FIELDS,
+                                                   &UA_TYPES[UA_TYPES_INT64]);
+    dataValue->hasValue = status == UA_STATUSCODE_GOOD;
+    return status;
+}
+
+/**
+ * @brief Add one Int64 array variable to the LatencyProbe object
+ */
+static void add_variable(UA_Server *server, const UA_NodeId *parent, const char *id,
+                         const char *name, const char *description, UA_UInt32 length,
+                         UA_Byte accessLevel, UA_DataSource source) {
+    UA_UInt32 dimensions[1] = { length };
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.dataType = UA_TYPES[UA_TYPES_INT64].typeId;
+    attr.valueRank = UA_VALUERANK_ONE_DIMENSION;
+    attr.arrayDimensionsSize = 1;
+    attr.arrayDimensions = dimensions;
+    attr.accessLevel = accessLevel;
+
+    UA_StatusCode status = UA_Server_addDataSourceVariableNode(
+        server, UA_NODEID_STRING(1, (char *)id), *parent,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), UA_QUALIFIEDNAME(1, (char *)name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, source, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add variable %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Add the LatencyProbe object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void latency_probe_add_ua_nodes(UA_Server *server) {
+    UA_NodeId probeId = UA_NODEID_STRING(1, "probe");
+    UA_ObjectAttributes objAttr = UA_ObjectAttributes_default;
+    objAttr.displayName = UA_LOCALIZEDTEXT("en-US", "LatencyProbe");
+    objAttr.description = UA_LOCALIZEDTEXT("en-US", "Client timestamp echo with server receive, "
+                                                    "execution and delivery stamps");
+    UA_StatusCode status = UA_Server_addObjectNode(server, probeId,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                                   UA_QUALIFIEDNAME(1, "LatencyProbe"),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                                   objAttr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add LatencyProbe object: 0x%08lX", (unsigned long)status);
+        return;
+    }
+
+    UA_DataSource source = { readProbeRequest, writeProbeRequest };
+    add_variable(server, &probeId, "probe.Request", "Request",
+                 "Write [sequence, client send time] to start a probe", LATENCY_PROBE_REQUEST_FIELDS,
+                 UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE, source);
+    source.read = readProbeResult;
+    source.write = NULL;
+    add_variable(server, &probeId, "probe.Result", "Result",
+                 "[sequence, client time, received, executed, delivered, delivery received] (us)",
+                 LATENCY_PROBE_RESULT_FIELDS, UA_ACCESSLEVELMASK_READ, source);
+
+    ESP_LOGI(TAG, "LatencyProbe object added");
+}
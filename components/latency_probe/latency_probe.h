@@ -0,0 +1,69 @@
+/* latency_probe.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include "open62541.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * End-to-End Latency Probe
+ * ============================================================================
+ *
+ * Objects/LatencyProbe (ns=1;s=probe):
+ *
+ *   Request   Int64[2]  written by the client: sequence number and the
+ *                       client send time (any unit, echoed unchanged)
+ *   Result    Int64[6]  the last request with the server stamps:
+ *
+ *     LATENCY_PROBE_SEQUENCE         sequence number of the request
+ *     LATENCY_PROBE_CLIENT_TIME      client send time, echoed
+ *     LATENCY_PROBE_RECEIVED         recv() of the write request
+ *     LATENCY_PROBE_EXECUTED         write callback
+ *     LATENCY_PROBE_DELIVERED        first read or sample of this Result
+ *     LATENCY_PROBE_DELIVERY_RECEIVED  recv() of the read request that
+ *                                    delivered it (0 for a subscription sample)
+ *
+ * Server stamps are microseconds of UA_ServerNetworkLayer_nowUs(). Only
+ * differences between stamps of the same clock are meaningful, so a client
+ * splits its own round trip without synchronized clocks:
+ *
+ *   queueing in the server   EXECUTED - RECEIVED
+ *   network (write)          write round trip - (EXECUTED - RECEIVED)
+ *   sampling wait            DELIVERED - EXECUTED (subscription)
+ *   publish and return       notification time - send time
+ *                            - (DELIVERED - RECEIVED) - network / 2
+ *
+ * The stamps are taken in the OPC UA task; RECEIVED comes from the network
+ * layer (in the pipeline from the network task on the other core). There is
+ * one probe: a new Request replaces the Result, so concurrent clients tell
+ * their probes apart by the sequence number.
+ */
+
+/** @brief Values in Request */
+#define LATENCY_PROBE_REQUEST_FIELDS        2
+
+/** @brief Fields of Result */
+#define LATENCY_PROBE_SEQUENCE              0
+#define LATENCY_PROBE_CLIENT_TIME           1
+#define LATENCY_PROBE_RECEIVED              2
+#define LATENCY_PROBE_EXECUTED              3
+#define LATENCY_PROBE_DELIVERED             4
+#define LATENCY_PROBE_DELIVERY_RECEIVED     5
+#define LATENCY_PROBE_RESULT_FIELDS         6
+
+/**
+ * @brief Add the LatencyProbe object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void latency_probe_add_ua_nodes(UA_Server *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_PROBE_H */
@@ -137,6 +137,18 @@ writeDiscreteOutputs(UA_Server *server,
                     const UA_NodeId *nodeId, void *nodeContext,
                     const UA_NumericRange *range, const UA_DataValue *data);
 
+/**
+ * @brief Check whether a node drives an output
+ * 
+ * Priority callback of the request scheduler: Write and Call requests on
+ * these nodes bypass monitoring traffic. Besides the relay outputs this is
+ * loopback_input, the stand-in for outputs in latency tests.
+ * 
+ * @param nodeId Node ID of a written variable, called object or method
+ * @return UA_Boolean true for output nodes
+ */
+UA_Boolean isOutputNode(const UA_NodeId *nodeId);
+
 /**
  * @brief Add discrete I/O variables to OPC UA server
  * 
@@ -393,4 +405,33 @@ UA_StatusCode readAdcChannel(UA_Server *server,
  */
 void addAdcVariables(UA_Server *server);
 
+/* ============================================================================
+ * I/O Trace
+ * ============================================================================ */
+
+/**
+ * @brief Add I/O trace variables to OPC UA server
+ * 
+ * Creates the io_trace (ByteString, chunked by index range),
+ * io_trace_control and io_trace_speed nodes.
+ * 
+ * @param server OPC UA server instance
+ */
+void addIoTraceVariables(UA_Server *server);
+
+/* ============================================================================
+ * Adaptive Scan Rate
+ * ============================================================================ */
+
+/**
+ * @brief Add the ScanPolicy object to OPC UA server
+ * 
+ * Creates Objects/ScanPolicy (ns=1;s=scan) with the metrics of the adaptive
+ * input scan: interval, reason, reader demand, bus budget floor, achieved
+ * scan rate and I2C bus load.
+ * 
+ * @param server OPC UA server instance
+ */
+void addScanPolicyVariables(UA_Server *server);
+
 #endif /* MODEL_H */
\ No newline at end of file
@@ -0,0 +1,107 @@
+/* value_cache.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef VALUE_CACHE_H
+#define VALUE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "open62541.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Pre-encoded DataValue Cache
+ * ============================================================================
+ *
+ * Cache-backed nodes only change when the io_cache sequence number changes,
+ * yet every Read and every monitored item sample encodes the same value again
+ * for each client. A slot per node keeps the current scalar together with its
+ * binary encoding: the variant alone and the variant followed by the source
+ * timestamp.
+ *
+ * Read callbacks return DataValues that point into the slot
+ * (UA_VARIANT_DATA_NODELETE), so a read allocates nothing, and the DataValue
+ * encoder of the stack copies the cached bytes (local extension, see
+ * components/open62541lib/README.md). A slot keeps a short ring of entries,
+ * so a returned DataValue stays valid until the server task has encoded the
+ * response even if newer values are stored meanwhile. Within one message
+ * (same receive time) a slot stores at most VALUE_CACHE_RING - 1 new values;
+ * beyond that the store fails and the caller returns a copy.
+ *
+ * Only the server task may use the cache.
+ */
+
+/** @brief Maximum number of cache-backed nodes */
+#define VALUE_CACHE_SLOTS       8
+/** @brief Entries per slot; a DataValue is valid until the response of its message is encoded */
+#define VALUE_CACHE_RING        4
+
+/**
+ * @brief Cache statistics
+ */
+typedef struct {
+    uint32_t hits;              /**< Reads served without fetching the value */
+    uint32_t stores;            /**< New values encoded into a slot */
+    uint32_t copies;            /**< DataValues encoded by copying cached bytes */
+    uint32_t overflows;         /**< Stores refused because the ring was used up within one message */
+} value_cache_stats_t;
+
+/**
+ * @brief Install the encoding lookup in the stack
+ *
+ * Call once before the server starts.
+ */
+void value_cache_init(void);
+
+/**
+ * @brief Reserve a slot for a scalar node
+ *
+ * @param type Scalar type of the node (builtin, fixed size, at most 8 bytes)
+ * @return int Slot index, -1 if no slot is free or the type is not supported
+ */
+int value_cache_register(const UA_DataType *type);
+
+/**
+ * @brief Fill a DataValue from the slot if it holds the given sequence
+ *
+ * Sets the value and the source timestamp; hasSourceTimestamp is set when
+ * the entry has one.
+ *
+ * @param slot      Slot index
+ * @param sequence  io_cache sequence number, read before fetching the value
+ * @param dataValue DataValue to fill
+ * @return true on a hit, false if the caller has to fetch the value and
+ *         call value_cache_store()
+ */
+bool value_cache_get(int slot, uint32_t sequence, UA_DataValue *dataValue);
+
+/**
+ * @brief Store the value fetched for a sequence and fill a DataValue from it
+ *
+ * An unchanged value only updates the sequence of the slot and keeps the
+ * source timestamp of its last change. A source timestamp of 0 means none.
+ *
+ * @param slot            Slot index
+ * @param sequence        io_cache sequence number read before the value was fetched
+ * @param value           Scalar of the slot type
+ * @param sourceTimestamp Source timestamp of the value
+ * @param dataValue       DataValue to fill
+ * @return UA_StatusCode BADINTERNALERROR for an invalid slot,
+ *         BADRESOURCEUNAVAILABLE if the ring is used up by the current
+ *         message; dataValue is left untouched and the caller copies the value
+ */
+UA_StatusCode value_cache_store(int slot, uint32_t sequence, const void *value,
+                                UA_DateTime sourceTimestamp, UA_DataValue *dataValue);
+
+/**
+ * @brief Get cache statistics
+ */
+void value_cache_get_stats(value_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VALUE_CACHE_H */
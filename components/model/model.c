@@ -5,8 +5,16 @@
 #include "driver/gpio.h"
 #include "esp_adc/adc_oneshot.h"
 #include "io_cache.h"
+#include "io_trace.h"
+#include "scan_policy.h"
+#include "value_cache.h"
+#include "runtime_config.h"
+#include "clock_service_ua.h"
+#include "alarm_engine.h"
 #include "pcf8574.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include <stdlib.h>
 
 static const char *TAG = "model";
 
@@ -24,6 +32,10 @@ static SemaphoreHandle_t i2c_mutex = NULL;
 static pcf8574_dev_t dio_in1, dio_in2, dio_out1, dio_out2;
 static bool dio_initialized = false;
 
+/** Pre-encoded value cache slots of the cache-backed nodes (-1 = none) */
+static int inputs_slot = -1;
+static int outputs_slot = -1;
+
 /**
  * @brief Initialize discrete I/O hardware
  * 
@@ -104,8 +116,10 @@ uint16_t read_discrete_inputs_slow(void) {
     
     // Protect I2C bus with mutex
     if (xSemaphoreTake(i2c_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        int64_t start = esp_timer_get_time();
         uint8_t in1 = pcf8574_read(&dio_in1);
         uint8_t in2 = pcf8574_read(&dio_in2);
+        scan_policy_note_bus((uint32_t)(esp_timer_get_time() - start));
         
         // Invert: PCF8574: 0=signal present, 1=no signal -> make 1=signal present
         in1 = ~in1;
@@ -150,6 +164,7 @@ void write_discrete_outputs_slow(uint16_t outputs) {
     
     // Protect I2C bus with mutex and add retry logic
     if (xSemaphoreTake(i2c_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        int64_t start = esp_timer_get_time();
         bool success1 = false;
         bool success2 = false;
         
@@ -168,6 +183,7 @@ void write_discrete_outputs_slow(uint16_t outputs) {
             }
         }
         
+        scan_policy_note_bus((uint32_t)(esp_timer_get_time() - start));
         xSemaphoreGive(i2c_mutex);
         
         if (success1 && success2) {
@@ -184,6 +200,57 @@ void write_discrete_outputs_slow(uint16_t outputs) {
  * OPC UA FUNCTIONS FOR DISCRETE I/O
  * ============================================================================ */
 
+/**
+ * @brief Return a cache-backed UInt16 through the pre-encoded value cache
+ * 
+ * Falls back to a plain copy when the node has no cache slot or its ring
+ * is used up by the current message.
+ * 
+ * @param slot Value cache slot of the node
+ * @param sequence io_cache sequence number read before the value
+ * @param value Current value
+ * @param source_ts Source timestamp in tick milliseconds (0 = none)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+setCachedUInt16(int slot, uint32_t sequence, UA_UInt16 value,
+                uint64_t source_ts, UA_DataValue *dataValue) {
+    // Hardware read time, mapped to UTC by the disciplined clock
+    UA_DateTime ts = source_ts > 0 ? clock_service_ua_from_tick_ms(source_ts) : 0;
+    if (value_cache_store(slot, sequence, &value, ts, dataValue) == UA_STATUSCODE_GOOD) {
+        return UA_STATUSCODE_GOOD;
+    }
+    
+    UA_Variant_setScalarCopy(&dataValue->value, &value, &UA_TYPES[UA_TYPES_UINT16]);
+    dataValue->sourceTimestamp = ts;
+    dataValue->hasSourceTimestamp = source_ts > 0;
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Answer a read of a tag that is hidden by the runtime configuration
+ *
+ * The node and its monitored items stay; the value reports BadOutOfService
+ * until the tag is exposed again.
+ *
+ * @param tag Tag of the node
+ * @param dataValue Pointer to store read data
+ * @return true if the tag is hidden and dataValue was filled
+ */
+static bool readHiddenTag(runtime_tag_t tag, UA_DataValue *dataValue) {
+    const runtime_config_t *cfg = runtime_config_acquire();
+    bool exposed = cfg->tags[tag].exposed;
+    runtime_config_release(cfg);
+    if (exposed) {
+        return false;
+    }
+    dataValue->hasStatus = true;
+    dataValue->status = UA_STATUSCODE_BADOUTOFSERVICE;
+    return true;
+}
+
 /**
  * @brief OPC UA read callback for discrete inputs (uses cache)
  * 
@@ -206,21 +273,25 @@ readDiscreteInputs(UA_Server *server,
                   const UA_NodeId *nodeId, void *nodeContext,
                   UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
                   UA_DataValue *dataValue) {
-    // Use cache instead of direct reading
-    uint64_t source_ts = 0, server_ts = 0;
-    UA_UInt16 inputs = io_cache_get_discrete_inputs(&source_ts, &server_ts);
+    if (readHiddenTag(RUNTIME_TAG_DISCRETE_INPUTS, dataValue)) {
+        return UA_STATUSCODE_GOOD;
+    }
     
-    UA_Variant_setScalarCopy(&dataValue->value, &inputs,
-                           &UA_TYPES[UA_TYPES_UINT16]);
+    // Reads and monitored item sampling set the scan rate the readers need
+    scan_policy_note_read();
     
-    // Set timestamps if requested
-    if (sourceTimeStamp && source_ts > 0) {
-        dataValue->sourceTimestamp = UA_DateTime_fromUnixTime((UA_Int64)(source_ts / 1000));
+    // Unchanged process image: the pre-encoded value is still current
+    uint32_t sequence = io_cache_get_sequence();
+    if (value_cache_get(inputs_slot, sequence, dataValue)) {
+        return UA_STATUSCODE_GOOD;
     }
     
-    dataValue->hasValue = true;
+    // Use cache instead of direct reading
+    uint64_t source_ts = 0, server_ts = 0;
+    UA_UInt16 inputs = io_cache_get_discrete_inputs(&source_ts, &server_ts);
+    
     ESP_LOGD(TAG, "Inputs from cache: 0x%04X (source ts: %llu)", inputs, source_ts);
-    return UA_STATUSCODE_GOOD;
+    return setCachedUInt16(inputs_slot, sequence, inputs, source_ts, dataValue);
 }
 
 /**
@@ -245,21 +316,18 @@ readDiscreteOutputs(UA_Server *server,
                    const UA_NodeId *nodeId, void *nodeContext,
                    UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
                    UA_DataValue *dataValue) {
+    // Unchanged process image: the pre-encoded value is still current
+    uint32_t sequence = io_cache_get_sequence();
+    if (value_cache_get(outputs_slot, sequence, dataValue)) {
+        return UA_STATUSCODE_GOOD;
+    }
+    
     // Use cache instead of direct reading
     uint64_t source_ts = 0, server_ts = 0;
     UA_UInt16 outputs = io_cache_get_discrete_outputs(&source_ts, &server_ts);
     
-    UA_Variant_setScalarCopy(&dataValue->value, &outputs,
-                           &UA_TYPES[UA_TYPES_UINT16]);
-    
-    // Set timestamps if requested
-    if (sourceTimeStamp && source_ts > 0) {
-        dataValue->sourceTimestamp = UA_DateTime_fromUnixTime((UA_Int64)(source_ts / 1000));
-    }
-    
-    dataValue->hasValue = true;
     ESP_LOGD(TAG, "Outputs from cache: 0x%04X (source ts: %llu)", outputs, source_ts);
-    return UA_STATUSCODE_GOOD;
+    return setCachedUInt16(outputs_slot, sequence, outputs, source_ts, dataValue);
 }
 
 /**
@@ -282,9 +350,15 @@ writeDiscreteOutputs(UA_Server *server,
                     const UA_NodeId *sessionId, void *sessionContext,
                     const UA_NodeId *nodeId, void *nodeContext,
                     const UA_NumericRange *range, const UA_DataValue *data) {
+    // A standby unit of a redundant pair does not drive the outputs, nor does
+    // a client while the actuation self-test toggles one
+    if (io_cache_is_replica() || io_cache_outputs_held()) {
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    }
     if (data->hasValue && UA_Variant_isScalar(&data->value) &&
         data->value.type == &UA_TYPES[UA_TYPES_UINT16]) {
         UA_UInt16 outputs = *(UA_UInt16*)data->value.data;
+        io_trace_record(IO_TRACE_WRITE_DO, 0, (uint16_t)outputs);
         
         // 1. Update physical device (slow, with I2C mutex protection)
         write_discrete_outputs_slow((uint16_t)outputs);
@@ -299,6 +373,29 @@ writeDiscreteOutputs(UA_Server *server,
     return UA_STATUSCODE_BADTYPEMISMATCH;
 }
 
+/**
+ * @brief Check whether a node drives an output
+ *
+ * @param nodeId Node ID of a written variable, called object or method
+ * @return UA_Boolean true for discrete_outputs and loopback_input
+ */
+UA_Boolean
+isOutputNode(const UA_NodeId *nodeId) {
+    static const UA_String outputNodes[] = {
+        UA_STRING_STATIC("discrete_outputs"),
+        UA_STRING_STATIC("loopback_input")
+    };
+    if (nodeId->namespaceIndex != 1 || nodeId->identifierType != UA_NODEIDTYPE_STRING) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(outputNodes) / sizeof(outputNodes[0]); i++) {
+        if (UA_String_equal(&nodeId->identifier.string, &outputNodes[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @brief Add discrete I/O variables to OPC UA server
  * 
@@ -310,6 +407,9 @@ writeDiscreteOutputs(UA_Server *server,
  */
 void
 addDiscreteIOVariables(UA_Server *server) {
+    inputs_slot = value_cache_register(&UA_TYPES[UA_TYPES_UINT16]);
+    outputs_slot = value_cache_register(&UA_TYPES[UA_TYPES_UINT16]);
+    
     // 1. Variable for reading inputs (read-only)
     UA_VariableAttributes inputAttr = UA_VariableAttributes_default;
     inputAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Discrete Inputs");
@@ -518,6 +618,7 @@ writeLoopbackInput(UA_Server *server,
     if (data->hasValue && UA_Variant_isScalar(&data->value) &&
         data->value.type == &UA_TYPES[UA_TYPES_UINT16]) {
         UA_UInt16 value = *(UA_UInt16*)data->value.data;
+        io_trace_record(IO_TRACE_WRITE_LOOPBACK, 0, (uint16_t)value);
         loopback_input = (uint16_t)value;
         loopback_output = (uint16_t)value;  /* Instant loopback */
         return UA_STATUSCODE_GOOD;
@@ -561,6 +662,12 @@ static adc_oneshot_unit_handle_t adc1_handle = NULL;
 static bool adc_initialized = false;
 static uint64_t adc_timestamps_ms[NUM_ADC_CHANNELS] = {0};
 static uint64_t adc_server_timestamps_ms[NUM_ADC_CHANNELS] = {0};
+/** Pre-encoded value cache slots of the ADC nodes (-1 = none) */
+static int adc_slots[NUM_ADC_CHANNELS] = {-1, -1, -1, -1};
+/** Filter accumulators in 1/2^RUNTIME_ADC_FILTER_MAX counts (-1 = not primed) */
+static int32_t adc_filter_acc[NUM_ADC_CHANNELS] = {-1, -1, -1, -1};
+/** Last value passed to the caches (-1 = none yet), reference for the deadband */
+static int32_t adc_published[NUM_ADC_CHANNELS] = {-1, -1, -1, -1};
 
 /**
  * @brief Initialize ADC hardware
@@ -624,10 +731,33 @@ uint16_t read_adc_channel_slow(uint8_t channel) {
     return (uint16_t)raw;
 }
 
+/**
+ * @brief Apply the configured filter to a raw ADC reading
+ *
+ * Exponential moving average with alpha = 1 / 2^filter in fixed point; the
+ * first reading primes the filter.
+ *
+ * @param channel ADC channel number (0-3)
+ * @param raw Raw ADC value
+ * @param tag Options of the channel
+ * @return uint16_t Filtered value
+ */
+static uint16_t filter_adc_value(int channel, uint16_t raw, const runtime_tag_config_t *tag) {
+    int32_t sample = (int32_t)raw << RUNTIME_ADC_FILTER_MAX;
+    if (tag->filter == 0 || adc_filter_acc[channel] < 0) {
+        adc_filter_acc[channel] = sample;
+    } else {
+        adc_filter_acc[channel] += (sample - adc_filter_acc[channel]) >> tag->filter;
+    }
+    return (uint16_t)((adc_filter_acc[channel] + (1 << (RUNTIME_ADC_FILTER_MAX - 1)))
+                      >> RUNTIME_ADC_FILTER_MAX);
+}
+
 /**
  * @brief Update all ADC channels from hardware
  * 
- * Reads all ADC channels, updates the local cache and the global I/O cache.
+ * Reads all ADC channels, applies the filter and deadband of the runtime
+ * configuration and updates the local cache and the global I/O cache.
  * Used by the polling task to refresh ADC values.
  */
 void update_all_adc_channels_slow(void) {
@@ -640,8 +770,25 @@ void update_all_adc_channels_slow(void) {
     
     uint64_t timestamp = (uint64_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
     
+    runtime_tag_config_t tags[NUM_ADC_CHANNELS];
+    const runtime_config_t *cfg = runtime_config_acquire();
+    for (int i = 0; i < NUM_ADC_CHANNELS; i++) {
+        tags[i] = cfg->tags[RUNTIME_TAG_ADC_1 + i];
+    }
+    runtime_config_release(cfg);
+    
     for (int i = 0; i < NUM_ADC_CHANNELS; i++) {
-        uint16_t value = read_adc_channel_slow(i);
+        uint16_t value = filter_adc_value(i, read_adc_channel_slow(i), &tags[i]);
+        
+        // Limits see every scan; the deadband only thins out the published values
+        alarm_engine_evaluate(i, value, timestamp);
+        
+        // Inside the deadband the caches keep the previous value and timestamp
+        if (adc_published[i] >= 0 && tags[i].deadband > 0 &&
+            abs((int32_t)value - adc_published[i]) < tags[i].deadband) {
+            continue;
+        }
+        adc_published[i] = value;
         adc_cache[i] = value;
         adc_timestamps_ms[i] = timestamp;
         adc_server_timestamps_ms[i] = timestamp;
@@ -703,16 +850,27 @@ UA_StatusCode readAdcChannel(UA_Server *server,
     if (channel >= NUM_ADC_CHANNELS) {
         return UA_STATUSCODE_BADINTERNALERROR;
     }
+    if (readHiddenTag((runtime_tag_t)(RUNTIME_TAG_ADC_1 + channel), dataValue)) {
+        return UA_STATUSCODE_GOOD;
+    }
+    
+    // Unchanged process image: the pre-encoded value is still current
+    uint32_t sequence = io_cache_get_sequence();
+    if (value_cache_get(adc_slots[channel], sequence, dataValue)) {
+        return UA_STATUSCODE_GOOD;
+    }
     
     uint16_t value = adc_cache[channel];
-    UA_Variant_setScalarCopy(&dataValue->value, &value, &UA_TYPES[UA_TYPES_UINT16]);
+    uint64_t source_ts = adc_timestamps_ms[channel];
     
-    if (sourceTimeStamp && adc_timestamps_ms[channel] > 0) {
-        dataValue->sourceTimestamp = UA_DateTime_fromUnixTime((UA_Int64)(adc_timestamps_ms[channel] / 1000));
+    // The global cache also carries values fed by a trace replay
+    float cached;
+    uint64_t cached_ts = 0;
+    if (io_cache_get_adc_channel(channel, &cached, &cached_ts, NULL)) {
+        value = (uint16_t)cached;
+        source_ts = cached_ts;
     }
-    
-    dataValue->hasValue = true;
-    return UA_STATUSCODE_GOOD;
+    return setCachedUInt16(adc_slots[channel], sequence, value, source_ts, dataValue);
 }
 
 /**
@@ -733,6 +891,8 @@ void addAdcVariables(UA_Server *server) {
     };
     
     for (int i = 0; i < NUM_ADC_CHANNELS; i++) {
+        adc_slots[i] = value_cache_register(&UA_TYPES[UA_TYPES_UINT16]);
+        
         UA_VariableAttributes attr = UA_VariableAttributes_default;
         attr.displayName = UA_LOCALIZEDTEXT("en-US", channel_names[i]);
         attr.description = UA_LOCALIZEDTEXT("en-US", descriptions[i]);
@@ -759,4 +919,488 @@ void addAdcVariables(UA_Server *server) {
     }
     
     ESP_LOGI(TAG, "ADC variables added to OPC UA server (%d channels, raw codes)", NUM_ADC_CHANNELS);
-}
\ No newline at end of file
+}
+
+/* ============================================================================
+ * OPC UA FUNCTIONS FOR I/O TRACE
+ * ============================================================================ */
+
+/** @brief Replay speed in percent of recorded timing (0 = as fast as possible) */
+static uint16_t trace_speed = 100;
+
+/**
+ * @brief Convert an index range on a ByteString into offset and length
+ *
+ * @param range Range from the request (NULL = whole value)
+ * @param size Size of the whole value
+ * @param offset Pointer to store the start offset
+ * @param len Pointer to store the length
+ * @return UA_StatusCode BADINDEXRANGEINVALID for multi-dimensional ranges
+ */
+static UA_StatusCode
+traceRangeToOffset(const UA_NumericRange *range, size_t size,
+                   size_t *offset, size_t *len) {
+    if (range == NULL) {
+        *offset = 0;
+        *len = size;
+        return UA_STATUSCODE_GOOD;
+    }
+    if (range->dimensionsSize != 1 || range->dimensions[0].min > range->dimensions[0].max) {
+        return UA_STATUSCODE_BADINDEXRANGEINVALID;
+    }
+    *offset = range->dimensions[0].min;
+    *len = (size_t)range->dimensions[0].max - range->dimensions[0].min + 1;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief OPC UA read callback for the serialized trace
+ *
+ * Large traces are read in chunks with an index range ("0:4095", ...).
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Node context (not used)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Byte range within the trace
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readIoTrace(UA_Server *server,
+            const UA_NodeId *sessionId, void *sessionContext,
+            const UA_NodeId *nodeId, void *nodeContext,
+            UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+            UA_DataValue *dataValue) {
+    size_t size = io_trace_size();
+    size_t offset, len;
+    UA_StatusCode ret = traceRangeToOffset(range, size, &offset, &len);
+    if (ret != UA_STATUSCODE_GOOD) {
+        return ret;
+    }
+    if (offset >= size) {
+        return UA_STATUSCODE_BADINDEXRANGENODATA;
+    }
+    if (len > size - offset) {
+        len = size - offset;
+    }
+
+    UA_ByteString chunk;
+    if (UA_ByteString_allocBuffer(&chunk, len) != UA_STATUSCODE_GOOD) {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    chunk.length = io_trace_read(offset, chunk.data, len);
+    UA_Variant_setScalar(&dataValue->value, UA_ByteString_new(), &UA_TYPES[UA_TYPES_BYTESTRING]);
+    if (dataValue->value.data == NULL) {
+        UA_ByteString_clear(&chunk);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    *(UA_ByteString *)dataValue->value.data = chunk;
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief OPC UA write callback for the serialized trace (upload for replay)
+ *
+ * The chunk at offset 0 must be written first; it starts a new trace.
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being written
+ * @param nodeContext Node context (not used)
+ * @param range Byte range within the trace
+ * @param data Data value to write
+ * @return UA_StatusCode Status of write operation
+ */
+static UA_StatusCode
+writeIoTrace(UA_Server *server,
+             const UA_NodeId *sessionId, void *sessionContext,
+             const UA_NodeId *nodeId, void *nodeContext,
+             const UA_NumericRange *range, const UA_DataValue *data) {
+    if (!data->hasValue || !UA_Variant_isScalar(&data->value) ||
+        data->value.type != &UA_TYPES[UA_TYPES_BYTESTRING]) {
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+    }
+    const UA_ByteString *chunk = (const UA_ByteString *)data->value.data;
+    size_t offset, len;
+    UA_StatusCode ret = traceRangeToOffset(range, chunk->length, &offset, &len);
+    if (ret != UA_STATUSCODE_GOOD) {
+        return ret;
+    }
+    if (len != chunk->length) {
+        return UA_STATUSCODE_BADINDEXRANGEINVALID;
+    }
+
+    switch (io_trace_load(offset, chunk->data, len)) {
+        case ESP_OK:
+            return UA_STATUSCODE_GOOD;
+        case ESP_ERR_INVALID_STATE:
+            return UA_STATUSCODE_BADINVALIDSTATE;
+        case ESP_ERR_INVALID_SIZE:
+            return UA_STATUSCODE_BADINDEXRANGENODATA;
+        default:
+            return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+}
+
+/**
+ * @brief OPC UA read callback for trace control (returns io_trace_state_t)
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Node context (not used)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readIoTraceControl(UA_Server *server,
+                   const UA_NodeId *sessionId, void *sessionContext,
+                   const UA_NodeId *nodeId, void *nodeContext,
+                   UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                   UA_DataValue *dataValue) {
+    UA_UInt16 state = (UA_UInt16)io_trace_get_state();
+    UA_Variant_setScalarCopy(&dataValue->value, &state, &UA_TYPES[UA_TYPES_UINT16]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief OPC UA write callback for trace control
+ *
+ * 0 = stop, 1 = clear and record, 2 = replay the buffer at io_trace_speed.
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being written
+ * @param nodeContext Node context (not used)
+ * @param range Data range (not used)
+ * @param data Data value to write
+ * @return UA_StatusCode Status of write operation
+ */
+static UA_StatusCode
+writeIoTraceControl(UA_Server *server,
+                    const UA_NodeId *sessionId, void *sessionContext,
+                    const UA_NodeId *nodeId, void *nodeContext,
+                    const UA_NumericRange *range, const UA_DataValue *data) {
+    if (!data->hasValue || !UA_Variant_isScalar(&data->value) ||
+        data->value.type != &UA_TYPES[UA_TYPES_UINT16]) {
+        return UA_STATUSCODE_BADTYPEMISMATCH;
+    }
+    esp_err_t err;
+    switch (*(UA_UInt16 *)data->value.data) {
+        case IO_TRACE_IDLE:
+            io_trace_stop();
+            return UA_STATUSCODE_GOOD;
+        case IO_TRACE_RECORDING:
+            err = io_trace_start();
+            break;
+        case IO_TRACE_REPLAYING:
+            err = io_trace_replay_start(trace_speed);
+            break;
+        default:
+            return UA_STATUSCODE_BADOUTOFRANGE;
+    }
+    if (err == ESP_ERR_INVALID_STATE || err == ESP_ERR_INVALID_ARG) {
+        return UA_STATUSCODE_BADINVALIDSTATE;
+    }
+    return err == ESP_OK ? UA_STATUSCODE_GOOD : UA_STATUSCODE_BADOUTOFMEMORY;
+}
+
+/**
+ * @brief OPC UA read callback for replay speed
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Node context (not used)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readIoTraceSpeed(UA_Server *server,
+                 const UA_NodeId *sessionId, void *sessionContext,
+                 const UA_NodeId *nodeId, void *nodeContext,
+                 UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                 UA_DataValue *dataValue) {
+    UA_UInt16 speed = trace_speed;
+    UA_Variant_setScalarCopy(&dataValue->value, &speed, &UA_TYPES[UA_TYPES_UINT16]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief OPC UA write callback for replay speed
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being written
+ * @param nodeContext Node context (not used)
+ * @param range Data range (not used)
+ * @param data Data value to write
+ * @return UA_StatusCode Status of write operation
+ */
+static UA_StatusCode
+writeIoTraceSpeed(UA_Server *server,
+                  const UA_NodeId *sessionId, void *sessionContext,
+                  const UA_NodeId *nodeId, void *nodeContext,
+                  const UA_NumericRange *range, const UA_DataValue *data) {
+    if (data->hasValue && UA_Variant_isScalar(&data->value) &&
+        data->value.type == &UA_TYPES[UA_TYPES_UINT16]) {
+        trace_speed = *(UA_UInt16 *)data->value.data;
+        return UA_STATUSCODE_GOOD;
+    }
+    return UA_STATUSCODE_BADTYPEMISMATCH;
+}
+
+/**
+ * @brief Add I/O trace variables to OPC UA server
+ *
+ * Creates io_trace (serialized trace, ByteString), io_trace_control
+ * (recorder state / command) and io_trace_speed (replay speed in percent).
+ *
+ * @param server OPC UA server instance
+ */
+void addIoTraceVariables(UA_Server *server) {
+    UA_NodeId parentNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    UA_NodeId parentReferenceNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES);
+    UA_NodeId variableTypeNodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE);
+
+    // 1. Serialized trace (read = download, write = upload for replay)
+    UA_VariableAttributes traceAttr = UA_VariableAttributes_default;
+    traceAttr.displayName = UA_LOCALIZEDTEXT("en-US", "I/O Trace");
+    traceAttr.description = UA_LOCALIZEDTEXT("en-US", "Recorded I/O changes, read/write in chunks with an index range");
+    traceAttr.dataType = UA_TYPES[UA_TYPES_BYTESTRING].typeId;
+    traceAttr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+
+    UA_DataSource traceDataSource;
+    traceDataSource.read = readIoTrace;
+    traceDataSource.write = writeIoTrace;
+
+    UA_Server_addDataSourceVariableNode(server, UA_NODEID_STRING(1, "io_trace"), parentNodeId,
+                                        parentReferenceNodeId, UA_QUALIFIEDNAME(1, "I/O Trace"),
+                                        variableTypeNodeId, traceAttr,
+                                        traceDataSource, NULL, NULL);
+
+    // 2. Recorder control: 0 = stop, 1 = record, 2 = replay
+    UA_VariableAttributes controlAttr = UA_VariableAttributes_default;
+    controlAttr.displayName = UA_LOCALIZEDTEXT("en-US", "I/O Trace Control");
+    controlAttr.description = UA_LOCALIZEDTEXT("en-US", "0 = idle/stop, 1 = recording/start, 2 = replaying/start replay");
+    controlAttr.dataType = UA_TYPES[UA_TYPES_UINT16].typeId;
+    controlAttr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+
+    UA_DataSource controlDataSource;
+    controlDataSource.read = readIoTraceControl;
+    controlDataSource.write = writeIoTraceControl;
+
+    UA_Server_addDataSourceVariableNode(server, UA_NODEID_STRING(1, "io_trace_control"), parentNodeId,
+                                        parentReferenceNodeId, UA_QUALIFIEDNAME(1, "I/O Trace Control"),
+                                        variableTypeNodeId, controlAttr,
+                                        controlDataSource, NULL, NULL);
+
+    // 3. Replay speed in percent
+    UA_VariableAttributes speedAttr = UA_VariableAttributes_default;
+    speedAttr.displayName = UA_LOCALIZEDTEXT("en-US", "I/O Trace Speed");
+    speedAttr.description = UA_LOCALIZEDTEXT("en-US", "Replay speed in percent (100 = recorded timing, 0 = as fast as possible)");
+    speedAttr.dataType = UA_TYPES[UA_TYPES_UINT16].typeId;
+    speedAttr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+
+    UA_DataSource speedDataSource;
+    speedDataSource.read = readIoTraceSpeed;
+    speedDataSource.write = writeIoTraceSpeed;
+
+    UA_Server_addDataSourceVariableNode(server, UA_NODEID_STRING(1, "io_trace_speed"), parentNodeId,
+                                        parentReferenceNodeId, UA_QUALIFIEDNAME(1, "I/O Trace Speed"),
+                                        variableTypeNodeId, speedAttr,
+                                        speedDataSource, NULL, NULL);
+
+    ESP_LOGI(TAG, "I/O trace variables added to OPC UA server");
+}
+
+/* ============================================================================
+ * ADAPTIVE SCAN RATE
+ * ============================================================================ */
+
+/** Variables of the ScanPolicy object (node context) */
+typedef enum {
+    SCAN_VAR_ENABLED = 0,
+    SCAN_VAR_REASON,
+    SCAN_VAR_INTERVAL,
+    SCAN_VAR_DEMAND,
+    SCAN_VAR_FLOOR,
+    SCAN_VAR_RATE,
+    SCAN_VAR_BUS_LOAD,
+    SCAN_VAR_SCAN_COST,
+    SCAN_VAR_SCANS,
+    SCAN_VAR_CHANGES,
+    SCAN_VAR_BUDGET_LIMITED
+} scan_var_t;
+
+/**
+ * @brief OPC UA read callback shared by the ScanPolicy variables
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Variable (scan_var_t)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readScanPolicyVariable(UA_Server *server,
+                       const UA_NodeId *sessionId, void *sessionContext,
+                       const UA_NodeId *nodeId, void *nodeContext,
+                       UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                       UA_DataValue *dataValue) {
+    scan_policy_stats_t stats;
+    scan_policy_get_stats(&stats);
+
+    UA_Boolean enabled = stats.enabled;
+    UA_String reason = UA_STRING((char *)scan_policy_reason_name(stats.reason));
+    UA_UInt16 u16 = 0;
+    UA_UInt32 u32 = 0;
+    UA_Double dbl = 0.0;
+    const void *value = &u16;
+    const UA_DataType *type = &UA_TYPES[UA_TYPES_UINT16];
+    switch ((scan_var_t)(uintptr_t)nodeContext) {
+        case SCAN_VAR_ENABLED:
+            value = &enabled;
+            type = &UA_TYPES[UA_TYPES_BOOLEAN];
+            break;
+        case SCAN_VAR_REASON:
+            value = &reason;
+            type = &UA_TYPES[UA_TYPES_STRING];
+            break;
+        case SCAN_VAR_INTERVAL:
+            u16 = stats.interval_ms;
+            break;
+        case SCAN_VAR_DEMAND:
+            u16 = stats.demand_ms;
+            break;
+        case SCAN_VAR_FLOOR:
+            u16 = stats.floor_ms;
+            break;
+        case SCAN_VAR_SCAN_COST:
+            u16 = stats.scan_cost_us;
+            break;
+        case SCAN_VAR_RATE:
+            dbl = stats.scan_rate_x10 / 10.0;
+            value = &dbl;
+            type = &UA_TYPES[UA_TYPES_DOUBLE];
+            break;
+        case SCAN_VAR_BUS_LOAD:
+            dbl = stats.bus_load_permille / 10.0;
+            value = &dbl;
+            type = &UA_TYPES[UA_TYPES_DOUBLE];
+            break;
+        case SCAN_VAR_SCANS:
+            u32 = stats.scans;
+            value = &u32;
+            type = &UA_TYPES[UA_TYPES_UINT32];
+            break;
+        case SCAN_VAR_CHANGES:
+            u32 = stats.changes;
+            value = &u32;
+            type = &UA_TYPES[UA_TYPES_UINT32];
+            break;
+        case SCAN_VAR_BUDGET_LIMITED:
+            u32 = stats.budget_limited;
+            value = &u32;
+            type = &UA_TYPES[UA_TYPES_UINT32];
+            break;
+        default:
+            return UA_STATUSCODE_BADNODEIDUNKNOWN;
+    }
+    UA_StatusCode ret = UA_Variant_setScalarCopy(&dataValue->value, value, type);
+    dataValue->hasValue = ret == UA_STATUSCODE_GOOD;
+    return ret;
+}
+
+/**
+ * @brief Add one read-only variable to the ScanPolicy object
+ */
+static void addScanPolicyVariable(UA_Server *server, const UA_NodeId *parent, const char *id,
+                                  const char *name, const char *description, UA_UInt32 typeIndex,
+                                  scan_var_t var) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.dataType = UA_TYPES[typeIndex].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ;
+
+    UA_DataSource source = { readScanPolicyVariable, NULL };
+    UA_StatusCode status = UA_Server_addDataSourceVariableNode(
+        server, UA_NODEID_STRING(1, (char *)id), *parent,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), UA_QUALIFIEDNAME(1, (char *)name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, source,
+        (void *)(uintptr_t)var, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add variable %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Add the ScanPolicy object (adaptive input scan metrics)
+ *
+ * @param server OPC UA server instance
+ */
+void addScanPolicyVariables(UA_Server *server) {
+    UA_NodeId scanId = UA_NODEID_STRING(1, "scan");
+    UA_ObjectAttributes objAttr = UA_ObjectAttributes_default;
+    objAttr.displayName = UA_LOCALIZEDTEXT("en-US", "ScanPolicy");
+    objAttr.description = UA_LOCALIZEDTEXT("en-US", "Adaptive discrete input scan rate and I2C bus load");
+    UA_StatusCode status = UA_Server_addObjectNode(server, scanId,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                                   UA_QUALIFIEDNAME(1, "ScanPolicy"),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                                   objAttr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add ScanPolicy object: 0x%08lX", (unsigned long)status);
+        return;
+    }
+
+    addScanPolicyVariable(server, &scanId, "scan.Enabled", "Enabled",
+                          "Input scan interval adapts to activity, readers and bus load",
+                          UA_TYPES_BOOLEAN, SCAN_VAR_ENABLED);
+    addScanPolicyVariable(server, &scanId, "scan.Reason", "Reason",
+                          "What set the interval: fixed, activity, demand, idle or budget",
+                          UA_TYPES_STRING, SCAN_VAR_REASON);
+    addScanPolicyVariable(server, &scanId, "scan.IntervalMs", "IntervalMs",
+                          "Current input scan interval", UA_TYPES_UINT16, SCAN_VAR_INTERVAL);
+    addScanPolicyVariable(server, &scanId, "scan.DemandMs", "DemandMs",
+                          "Average time between reads of discrete_inputs in the last second (0 = none)",
+                          UA_TYPES_UINT16, SCAN_VAR_DEMAND);
+    addScanPolicyVariable(server, &scanId, "scan.FloorMs", "FloorMs",
+                          "Shortest interval the I2C bus budget allows", UA_TYPES_UINT16, SCAN_VAR_FLOOR);
+    addScanPolicyVariable(server, &scanId, "scan.ScanRate", "ScanRate",
+                          "Input scans per second in the last second", UA_TYPES_DOUBLE, SCAN_VAR_RATE);
+    addScanPolicyVariable(server, &scanId, "scan.BusLoad", "BusLoad",
+                          "I2C bus busy time in the last second, percent", UA_TYPES_DOUBLE, SCAN_VAR_BUS_LOAD);
+    addScanPolicyVariable(server, &scanId, "scan.ScanCostUs", "ScanCostUs",
+                          "Average bus time of one input scan", UA_TYPES_UINT16, SCAN_VAR_SCAN_COST);
+    addScanPolicyVariable(server, &scanId, "scan.Scans", "Scans",
+                          "Input scans since boot", UA_TYPES_UINT32, SCAN_VAR_SCANS);
+    addScanPolicyVariable(server, &scanId, "scan.Changes", "Changes",
+                          "Scans that found a changed input", UA_TYPES_UINT32, SCAN_VAR_CHANGES);
+    addScanPolicyVariable(server, &scanId, "scan.BudgetLimited", "BudgetLimited",
+                          "Scans whose interval the bus budget lengthened", UA_TYPES_UINT32,
+                          SCAN_VAR_BUDGET_LIMITED);
+
+    ESP_LOGI(TAG, "ScanPolicy object added");
+}
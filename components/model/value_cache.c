@@ -0,0 +1,171 @@
+/* value_cache.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include <string.h>
+#include "value_cache.h"
+#include "esp_log.h"
+
+static const char *TAG = "value_cache";
+
+/** @brief Encoded variant (type byte + scalar) plus source timestamp */
+#define ENCODED_MAX (1 + 8 + 8)
+
+/**
+ * @brief One value of a slot
+ *
+ * The value must stay the first member: the encoding lookup maps the
+ * variant data pointer back to its entry.
+ */
+typedef struct {
+    uint64_t value;                     /**< Scalar the DataValue points to */
+    UA_DateTime source_ts;              /**< Source timestamp */
+    UA_Byte encoded[ENCODED_MAX];       /**< Variant encoding, then the source timestamp */
+    UA_ByteString plain;                /**< Encoded variant */
+    UA_ByteString with_ts;              /**< Encoded variant and source timestamp */
+} value_entry_t;
+
+/**
+ * @brief Cache slot of one node
+ */
+typedef struct {
+    const UA_DataType *type;            /**< Scalar type (NULL = slot free) */
+    uint32_t sequence;                  /**< io_cache sequence of the current entry */
+    bool valid;                         /**< Current entry holds a value */
+    uint8_t current;                    /**< Index of the current entry */
+    uint8_t advanced;                   /**< Entries stored for the message being processed */
+    UA_Int64 message_us;                /**< Receive time of that message (0 = none) */
+} value_slot_t;
+
+static value_slot_t slots[VALUE_CACHE_SLOTS];
+static value_entry_t entries[VALUE_CACHE_SLOTS][VALUE_CACHE_RING];
+static value_cache_stats_t stats;
+
+/**
+ * @brief Map a DataValue back to its entry and return the cached bytes
+ *
+ * Called by the stack's DataValue encoder for values it does not own.
+ */
+static const UA_ByteString *
+lookupEncoding(const UA_DataValue *dv) {
+    uintptr_t offset = (uintptr_t)dv->value.data - (uintptr_t)entries;
+    if (offset >= sizeof(entries) || offset % sizeof(value_entry_t) != 0) {
+        return NULL;
+    }
+    const value_entry_t *e = (const value_entry_t *)dv->value.data;
+    size_t slot = offset / sizeof(entries[0]);
+    if (dv->value.type != slots[slot].type || dv->value.arrayLength != 0) {
+        return NULL;
+    }
+    if (dv->hasSourceTimestamp && dv->sourceTimestamp != e->source_ts) {
+        return NULL;
+    }
+    stats.copies++;
+    return dv->hasSourceTimestamp ? &e->with_ts : &e->plain;
+}
+
+void value_cache_init(void) {
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+    UA_DataValue_setEncodingLookup(lookupEncoding);
+}
+
+int value_cache_register(const UA_DataType *type) {
+    // Binary encoding must equal the memory layout (builtin, little-endian)
+    if (type == NULL || type->typeKind > UA_DATATYPEKIND_DIAGNOSTICINFO ||
+        !type->overlayable || type->memSize > sizeof(uint64_t) ||
+        !UA_TYPES[UA_TYPES_DATETIME].overlayable) {
+        ESP_LOGW(TAG, "Type not supported by the value cache");
+        return -1;
+    }
+    for (int i = 0; i < VALUE_CACHE_SLOTS; i++) {
+        if (slots[i].type == NULL) {
+            slots[i].type = type;
+            slots[i].valid = false;
+            return i;
+        }
+    }
+    ESP_LOGW(TAG, "No free value cache slot");
+    return -1;
+}
+
+/**
+ * @brief Point a DataValue at an entry without copying
+ */
+static void fillDataValue(const value_slot_t *s, value_entry_t *e, UA_DataValue *dataValue) {
+    UA_Variant_setScalar(&dataValue->value, &e->value, s->type);
+    dataValue->value.storageType = UA_VARIANT_DATA_NODELETE;
+    dataValue->sourceTimestamp = e->source_ts;
+    dataValue->hasSourceTimestamp = e->source_ts != 0;
+    dataValue->hasValue = true;
+}
+
+bool value_cache_get(int slot, uint32_t sequence, UA_DataValue *dataValue) {
+    if (slot < 0 || slot >= VALUE_CACHE_SLOTS || slots[slot].type == NULL) {
+        return false;
+    }
+    value_slot_t *s = &slots[slot];
+    if (!s->valid || s->sequence != sequence) {
+        return false;
+    }
+    fillDataValue(s, &entries[slot][s->current], dataValue);
+    stats.hits++;
+    return true;
+}
+
+UA_StatusCode value_cache_store(int slot, uint32_t sequence, const void *value,
+                                UA_DateTime sourceTimestamp, UA_DataValue *dataValue) {
+    if (slot < 0 || slot >= VALUE_CACHE_SLOTS || slots[slot].type == NULL) {
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    value_slot_t *s = &slots[slot];
+    size_t size = s->type->memSize;
+    value_entry_t *e = &entries[slot][s->current];
+
+    // Another node changed the sequence; this value (and the timestamp of its
+    // last change) is still current
+    if (s->valid && memcmp(&e->value, value, size) == 0) {
+        s->sequence = sequence;
+        fillDataValue(s, e, dataValue);
+        return UA_STATUSCODE_GOOD;
+    }
+
+    // Older entries stay untouched for DataValues still waiting to be encoded.
+    // They all belong to the message being processed: its response is encoded
+    // before the next message, and sampled values are copied by the stack. A
+    // Read that changes the value more often than the ring allows gets a copy.
+    UA_Int64 received = UA_ServerNetworkLayer_getReceiveTime();
+    if (received == 0 || received != s->message_us) {
+        s->message_us = received;
+        s->advanced = 0;
+    }
+    if (s->advanced >= VALUE_CACHE_RING - 1) {
+        stats.overflows++;
+        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+    }
+    s->advanced++;
+    s->current = (uint8_t)((s->current + 1) % VALUE_CACHE_RING);
+    e = &entries[slot][s->current];
+    e->value = 0;
+    memcpy(&e->value, value, size);
+    e->source_ts = sourceTimestamp;
+
+    // Variant: builtin type id, then the scalar in its (overlayable) layout
+    e->encoded[0] = (UA_Byte)(s->type->typeKind + 1u);
+    memcpy(&e->encoded[1], value, size);
+    memcpy(&e->encoded[1 + size], &sourceTimestamp, sizeof(UA_DateTime));
+    e->plain.data = e->encoded;
+    e->plain.length = 1 + size;
+    e->with_ts.data = e->encoded;
+    e->with_ts.length = 1 + size + sizeof(UA_DateTime);
+
+    s->sequence = sequence;
+    s->valid = true;
+    stats.stores++;
+    fillDataValue(s, e, dataValue);
+    return UA_STATUSCODE_GOOD;
+}
+
+void value_cache_get_stats(value_cache_stats_t *out) {
+    if (out) {
+        *out = stats;
+    }
+}
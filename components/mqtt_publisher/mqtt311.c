@@ -0,0 +1,748 @@
+/* mqtt311.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "mqtt311.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <time.h>
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) fprintf(stderr, "I (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) do { } while (0)
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const char *TAG = "mqtt311";
+
+/* MQTT control packet types (upper nibble of the fixed header) */
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_PUBACK      0x40
+#define MQTT_SUBSCRIBE   0x82   /**< SUBSCRIBE with mandatory reserved flags */
+#define MQTT_SUBACK      0x90
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    0xD0
+#define MQTT_DISCONNECT  0xE0
+
+#define MQTT_PUBLISH_DUP 0x08   /**< DUP flag in the PUBLISH fixed header */
+
+/**
+ * @brief Monotonic millisecond clock used by the client
+ *
+ * @return uint32_t Milliseconds since an arbitrary start point
+ */
+uint32_t mqtt311_now_ms(void) {
+#ifdef ESP_PLATFORM
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+#endif
+}
+
+/* ============================================================================
+ * ENCODING HELPERS
+ * ============================================================================ */
+
+/**
+ * @brief Encode the remaining length field of a fixed header
+ *
+ * @param buf Output buffer (at least 4 bytes)
+ * @param length Remaining length
+ * @return size_t Number of bytes written
+ */
+static size_t encode_remaining_length(uint8_t *buf, size_t length) {
+    size_t n = 0;
+    do {
+        uint8_t byte = length % 128;
+        length /= 128;
+        if (length > 0) {
+            byte |= 0x80;
+        }
+        buf[n++] = byte;
+    } while (length > 0 && n < 4);
+    return n;
+}
+
+/**
+ * @brief Write a length-prefixed UTF-8 string
+ *
+ * @param buf Output position
+ * @param str String to write (NULL is written as empty string)
+ * @return size_t Number of bytes written
+ */
+static size_t encode_string(uint8_t *buf, const char *str) {
+    size_t len = str ? strlen(str) : 0;
+    buf[0] = (uint8_t)(len >> 8);
+    buf[1] = (uint8_t)(len & 0xFF);
+    if (len > 0) {
+        memcpy(buf + 2, str, len);
+    }
+    return len + 2;
+}
+
+/**
+ * @brief Build a complete packet from header byte and body
+ *
+ * @param out Output buffer (MQTT311_MAX_PACKET bytes)
+ * @param header Fixed header byte
+ * @param body Variable header and payload
+ * @param body_len Body length
+ * @return size_t Packet length, 0 if it does not fit
+ */
+static size_t build_packet(uint8_t *out, uint8_t header, const uint8_t *body, size_t body_len) {
+    uint8_t len_buf[4];
+    size_t len_size = encode_remaining_length(len_buf, body_len);
+    if (1 + len_size + body_len > MQTT311_MAX_PACKET) {
+        return 0;
+    }
+    out[0] = header;
+    memcpy(out + 1, len_buf, len_size);
+    memcpy(out + 1 + len_size, body, body_len);
+    return 1 + len_size + body_len;
+}
+
+/* ============================================================================
+ * SOCKET HELPERS
+ * ============================================================================ */
+
+/**
+ * @brief Close the socket and mark the client disconnected
+ *
+ * @param client Client instance
+ */
+static void close_socket(mqtt311_client_t *client) {
+    if (client->sock >= 0) {
+        close(client->sock);
+    }
+    client->sock = -1;
+    client->connected = false;
+    client->ping_outstanding = false;
+    client->rx_len = 0;
+}
+
+/**
+ * @brief Send a complete buffer on the non-blocking socket
+ *
+ * @param client Client instance
+ * @param data Data to send
+ * @param len Data length
+ * @return true if all bytes were sent
+ */
+static bool send_all(mqtt311_client_t *client, const uint8_t *data, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(client->sock, data + sent, len - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += (size_t)n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            fd_set wset;
+            FD_ZERO(&wset);
+            FD_SET(client->sock, &wset);
+            struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+            if (select(client->sock + 1, NULL, &wset, NULL, &tv) > 0) {
+                continue;
+            }
+        }
+        ESP_LOGW(TAG, "Send failed (errno %d), closing connection", errno);
+        close_socket(client);
+        return false;
+    }
+    client->last_tx_ms = mqtt311_now_ms();
+    return true;
+}
+
+/**
+ * @brief Open a TCP connection with a connect timeout
+ *
+ * @param client Client instance
+ * @param timeout_ms Connect timeout
+ * @return true if the TCP connection is established
+ */
+static bool open_socket(mqtt311_client_t *client, uint32_t timeout_ms) {
+    char port_str[6];
+    snprintf(port_str, sizeof(port_str), "%u", client->config.port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(client->config.host, port_str, &hints, &res) != 0 || res == NULL) {
+        ESP_LOGW(TAG, "Cannot resolve broker %s", client->config.host);
+        return false;
+    }
+
+    int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (sock < 0) {
+        freeaddrinfo(res);
+        return false;
+    }
+
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    int ret = connect(sock, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+
+    if (ret < 0 && errno != EINPROGRESS) {
+        close(sock);
+        return false;
+    }
+
+    if (ret < 0) {
+        fd_set wset;
+        FD_ZERO(&wset);
+        FD_SET(sock, &wset);
+        struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+        if (select(sock + 1, NULL, &wset, NULL, &tv) <= 0) {
+            close(sock);
+            return false;
+        }
+        int so_error = 0;
+        socklen_t optlen = sizeof(so_error);
+        getsockopt(sock, SOL_SOCKET, SO_ERROR, &so_error, &optlen);
+        if (so_error != 0) {
+            close(sock);
+            return false;
+        }
+    }
+
+    client->sock = sock;
+    client->rx_len = 0;
+    return true;
+}
+
+/* ============================================================================
+ * RETRY QUEUE
+ * ============================================================================ */
+
+/**
+ * @brief Slot index of the n-th queued publish (oldest first)
+ */
+static size_t pending_slot(const mqtt311_client_t *client, size_t n) {
+    return (client->pending_head + n) % MQTT311_RETRY_SLOTS;
+}
+
+/**
+ * @brief Drop acknowledged slots from the head of the queue
+ */
+static void pending_compact(mqtt311_client_t *client) {
+    while (client->pending_count > 0 && !client->pending[client->pending_head].used) {
+        client->pending_head = (uint8_t)((client->pending_head + 1) % MQTT311_RETRY_SLOTS);
+        client->pending_count--;
+    }
+}
+
+/**
+ * @brief Close acknowledged holes so the queue is contiguous again
+ *
+ * Called only when the ring is full; keeps the oldest-first order.
+ */
+static void pending_squeeze(mqtt311_client_t *client) {
+    size_t kept = 0;
+    for (size_t i = 0; i < client->pending_count; i++) {
+        size_t from = pending_slot(client, i);
+        if (!client->pending[from].used) {
+            continue;
+        }
+        size_t to = pending_slot(client, kept++);
+        if (to != from) {
+            client->pending[to] = client->pending[from];
+            client->pending[from].used = false;
+        }
+    }
+    client->pending_count = (uint8_t)kept;
+}
+
+/**
+ * @brief Transmit one queued publish
+ *
+ * @param client Client instance
+ * @param p Pending publish
+ * @return true if the packet was sent
+ */
+static bool pending_transmit(mqtt311_client_t *client, mqtt311_pending_t *p) {
+    if (p->sent_ms != 0) {
+        p->packet[0] |= MQTT_PUBLISH_DUP;
+        client->stats.retransmits++;
+    }
+    if (!send_all(client, p->packet, p->length)) {
+        return false;
+    }
+    p->sent_ms = mqtt311_now_ms();
+    if (p->sent_ms == 0) {
+        p->sent_ms = 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Send queued publishes that were never sent or timed out
+ *
+ * @param client Client instance
+ * @param force Resend everything (used after reconnect)
+ */
+static void pending_flush(mqtt311_client_t *client, bool force) {
+    uint32_t now = mqtt311_now_ms();
+    for (size_t i = 0; i < client->pending_count && client->connected; i++) {
+        mqtt311_pending_t *p = &client->pending[pending_slot(client, i)];
+        if (!p->used) {
+            continue;
+        }
+        if (force || p->sent_ms == 0 || (now - p->sent_ms) >= MQTT311_RETRY_TIMEOUT_MS) {
+            pending_transmit(client, p);
+        }
+    }
+}
+
+/**
+ * @brief Handle a PUBACK for a queued publish
+ *
+ * @param client Client instance
+ * @param packet_id Acknowledged packet identifier
+ */
+static void pending_ack(mqtt311_client_t *client, uint16_t packet_id) {
+    for (size_t i = 0; i < client->pending_count; i++) {
+        mqtt311_pending_t *p = &client->pending[pending_slot(client, i)];
+        if (p->used && p->packet_id == packet_id) {
+            uint32_t latency = mqtt311_now_ms() - p->queued_ms;
+            client->stats.acked++;
+            client->stats.last_ack_ms = latency;
+            if (latency > client->stats.max_ack_ms) {
+                client->stats.max_ack_ms = latency;
+            }
+            p->used = false;
+            break;
+        }
+    }
+    pending_compact(client);
+}
+
+/* ============================================================================
+ * PUBLIC API
+ * ============================================================================ */
+
+/**
+ * @brief Initialize a client instance
+ *
+ * @param client Client instance
+ * @param config Connection parameters (strings must stay valid)
+ */
+void mqtt311_init(mqtt311_client_t *client, const mqtt311_config_t *config) {
+    memset(client, 0, sizeof(*client));
+    client->config = *config;
+    client->sock = -1;
+    client->next_packet_id = 1;
+}
+
+/**
+ * @brief Open the TCP connection and perform CONNECT/CONNACK
+ *
+ * @param client Client instance
+ * @param timeout_ms Time to wait for CONNACK
+ * @return true if the broker accepted the connection
+ */
+bool mqtt311_connect(mqtt311_client_t *client, uint32_t timeout_ms) {
+    close_socket(client);
+    if (!open_socket(client, timeout_ms)) {
+        return false;
+    }
+
+    bool has_user = client->config.username && client->config.username[0];
+    bool has_pass = has_user && client->config.password && client->config.password[0];
+
+    uint8_t body[MQTT311_MAX_PACKET];
+    size_t pos = 0;
+    pos += encode_string(body + pos, "MQTT");
+    body[pos++] = 4;                                  /* Protocol level 3.1.1 */
+    body[pos++] = (has_user ? 0x80 : 0) | (has_pass ? 0x40 : 0) |
+                  (client->config.clean_session ? 0x02 : 0);
+    body[pos++] = (uint8_t)(client->config.keepalive_s >> 8);
+    body[pos++] = (uint8_t)(client->config.keepalive_s & 0xFF);
+
+    size_t needed = pos + 6 + strlen(client->config.client_id ? client->config.client_id : "") +
+                    (has_user ? strlen(client->config.username) : 0) +
+                    (has_pass ? strlen(client->config.password) : 0);
+    if (needed > sizeof(body) - 5) {
+        ESP_LOGE(TAG, "CONNECT packet too large");
+        close_socket(client);
+        return false;
+    }
+    pos += encode_string(body + pos, client->config.client_id);
+    if (has_user) pos += encode_string(body + pos, client->config.username);
+    if (has_pass) pos += encode_string(body + pos, client->config.password);
+
+    uint8_t packet[MQTT311_MAX_PACKET];
+    size_t len = build_packet(packet, MQTT_CONNECT, body, pos);
+    if (len == 0 || !send_all(client, packet, len)) {
+        close_socket(client);
+        return false;
+    }
+
+    /* Wait for the 4-byte CONNACK */
+    uint8_t connack[4];
+    size_t got = 0;
+    uint32_t start = mqtt311_now_ms();
+    while (got < sizeof(connack)) {
+        uint32_t elapsed = mqtt311_now_ms() - start;
+        if (elapsed >= timeout_ms) {
+            ESP_LOGW(TAG, "CONNACK timeout");
+            close_socket(client);
+            return false;
+        }
+        fd_set rset;
+        FD_ZERO(&rset);
+        FD_SET(client->sock, &rset);
+        uint32_t left = timeout_ms - elapsed;
+        struct timeval tv = { .tv_sec = left / 1000, .tv_usec = (left % 1000) * 1000 };
+        if (select(client->sock + 1, &rset, NULL, NULL, &tv) <= 0) {
+            continue;
+        }
+        ssize_t n = recv(client->sock, connack + got, sizeof(connack) - got, 0);
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                continue;
+            }
+            close_socket(client);
+            return false;
+        }
+        got += (size_t)n;
+    }
+
+    if (connack[0] != MQTT_CONNACK || connack[1] != 2 || connack[3] != 0) {
+        ESP_LOGW(TAG, "Broker refused connection (return code %u)", connack[3]);
+        close_socket(client);
+        return false;
+    }
+
+    client->connected = true;
+    client->last_rx_ms = mqtt311_now_ms();
+    client->stats.connects++;
+    ESP_LOGI(TAG, "Connected to %s:%u (session present: %u, %u pending)",
+             client->config.host, client->config.port, connack[2] & 0x01,
+             (unsigned)mqtt311_pending_count(client));
+
+    /* Resend everything that was not acknowledged before the reconnect */
+    pending_flush(client, true);
+    return client->connected;
+}
+
+/**
+ * @brief Send DISCONNECT and close the socket
+ *
+ * @param client Client instance
+ */
+void mqtt311_disconnect(mqtt311_client_t *client) {
+    if (client->connected) {
+        uint8_t packet[2] = { MQTT_DISCONNECT, 0 };
+        send_all(client, packet, sizeof(packet));
+    }
+    close_socket(client);
+}
+
+/**
+ * @brief Publish a message
+ *
+ * @param client Client instance
+ * @param topic Topic name
+ * @param payload Message payload
+ * @param payload_len Payload length in bytes
+ * @param qos Quality of service (0 or 1)
+ * @param retain Set the RETAIN flag
+ * @return true if the message was sent (QoS 0) or queued (QoS 1)
+ */
+bool mqtt311_publish(mqtt311_client_t *client, const char *topic,
+                     const void *payload, size_t payload_len,
+                     uint8_t qos, bool retain) {
+    if (qos > 1) {
+        qos = 1;
+    }
+
+    size_t topic_len = strlen(topic);
+    size_t body_len = 2 + topic_len + (qos ? 2 : 0) + payload_len;
+    if (body_len + 5 > MQTT311_MAX_PACKET) {
+        ESP_LOGW(TAG, "Message for %s too large (%u bytes)", topic, (unsigned)payload_len);
+        return false;
+    }
+
+    uint8_t body[MQTT311_MAX_PACKET];
+    size_t pos = encode_string(body, topic);
+    uint16_t packet_id = 0;
+    if (qos) {
+        packet_id = client->next_packet_id++;
+        if (client->next_packet_id == 0) {
+            client->next_packet_id = 1;
+        }
+        body[pos++] = (uint8_t)(packet_id >> 8);
+        body[pos++] = (uint8_t)(packet_id & 0xFF);
+    }
+    memcpy(body + pos, payload, payload_len);
+    pos += payload_len;
+
+    uint8_t header = MQTT_PUBLISH | (uint8_t)(qos << 1) | (retain ? 0x01 : 0);
+
+    if (qos == 0) {
+        if (!client->connected) {
+            return false;
+        }
+        uint8_t packet[MQTT311_MAX_PACKET];
+        size_t len = build_packet(packet, header, body, pos);
+        if (len == 0 || !send_all(client, packet, len)) {
+            return false;
+        }
+        client->stats.published++;
+        return true;
+    }
+
+    /* QoS 1: make room in the retry queue, dropping the oldest message */
+    if (client->pending_count == MQTT311_RETRY_SLOTS) {
+        pending_squeeze(client);
+    }
+    if (client->pending_count == MQTT311_RETRY_SLOTS) {
+        client->pending[client->pending_head].used = false;
+        client->stats.dropped++;
+        pending_compact(client);
+    }
+
+    mqtt311_pending_t *p = &client->pending[pending_slot(client, client->pending_count)];
+    p->length = (uint16_t)build_packet(p->packet, header, body, pos);
+    if (p->length == 0) {
+        return false;
+    }
+    p->used = true;
+    p->packet_id = packet_id;
+    p->queued_ms = mqtt311_now_ms();
+    p->sent_ms = 0;
+    client->pending_count++;
+    client->stats.published++;
+
+    if (client->connected) {
+        pending_transmit(client, p);
+    }
+    return true;
+}
+
+/**
+ * @brief Subscribe to a topic filter
+ *
+ * @param client Client instance
+ * @param topic_filter Topic filter
+ * @param qos Requested maximum QoS
+ * @return true if the SUBSCRIBE packet was sent
+ */
+bool mqtt311_subscribe(mqtt311_client_t *client, const char *topic_filter, uint8_t qos) {
+    if (!client->connected || strlen(topic_filter) + 8 > MQTT311_MAX_PACKET) {
+        return false;
+    }
+
+    uint8_t body[MQTT311_MAX_PACKET];
+    size_t pos = 0;
+    uint16_t packet_id = client->next_packet_id++;
+    if (client->next_packet_id == 0) {
+        client->next_packet_id = 1;
+    }
+    body[pos++] = (uint8_t)(packet_id >> 8);
+    body[pos++] = (uint8_t)(packet_id & 0xFF);
+    pos += encode_string(body + pos, topic_filter);
+    body[pos++] = qos > 1 ? 1 : qos;
+
+    uint8_t packet[MQTT311_MAX_PACKET];
+    size_t len = build_packet(packet, MQTT_SUBSCRIBE, body, pos);
+    return len != 0 && send_all(client, packet, len);
+}
+
+/**
+ * @brief Handle one complete incoming packet
+ *
+ * @param client Client instance
+ * @param packet Packet bytes (fixed header included)
+ * @param header_len Length of the fixed header
+ * @param body_len Remaining length
+ */
+static void handle_packet(mqtt311_client_t *client, const uint8_t *packet,
+                          size_t header_len, size_t body_len) {
+    const uint8_t *body = packet + header_len;
+
+    switch (packet[0] & 0xF0) {
+        case MQTT_PUBACK:
+            if (body_len >= 2) {
+                pending_ack(client, (uint16_t)((body[0] << 8) | body[1]));
+            }
+            break;
+
+        case MQTT_PINGRESP:
+            client->ping_outstanding = false;
+            break;
+
+        case MQTT_SUBACK:
+            ESP_LOGD(TAG, "SUBACK received");
+            break;
+
+        case MQTT_PUBLISH: {
+            uint8_t qos = (packet[0] >> 1) & 0x03;
+            if (body_len < 2) {
+                break;
+            }
+            size_t topic_len = (size_t)((body[0] << 8) | body[1]);
+            size_t pos = 2 + topic_len;
+            uint16_t packet_id = 0;
+            if (qos > 0) {
+                if (pos + 2 > body_len) {
+                    break;
+                }
+                packet_id = (uint16_t)((body[pos] << 8) | body[pos + 1]);
+                pos += 2;
+            }
+            if (pos > body_len) {
+                break;
+            }
+            client->stats.received++;
+            if (client->on_message) {
+                client->on_message(client->user, (const char *)body + 2, topic_len,
+                                   body + pos, body_len - pos);
+            }
+            if (qos == 1) {
+                uint8_t puback[4] = { MQTT_PUBACK, 2,
+                                      (uint8_t)(packet_id >> 8), (uint8_t)(packet_id & 0xFF) };
+                send_all(client, puback, sizeof(puback));
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Process incoming packets, retransmissions and keep-alive
+ *
+ * @param client Client instance
+ * @param timeout_ms Maximum time to wait for incoming data
+ * @return true while the connection is healthy, false if it was closed
+ */
+bool mqtt311_loop(mqtt311_client_t *client, uint32_t timeout_ms) {
+    if (!client->connected) {
+        return false;
+    }
+
+    fd_set rset;
+    FD_ZERO(&rset);
+    FD_SET(client->sock, &rset);
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    int ready = select(client->sock + 1, &rset, NULL, NULL, &tv);
+
+    if (ready > 0) {
+        ssize_t n = recv(client->sock, client->rx_buf + client->rx_len,
+                         sizeof(client->rx_buf) - client->rx_len, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            ESP_LOGW(TAG, "Connection closed by broker");
+            close_socket(client);
+            return false;
+        }
+        if (n > 0) {
+            client->rx_len += (size_t)n;
+            client->last_rx_ms = mqtt311_now_ms();
+        }
+
+        /* Consume all complete packets in the buffer */
+        while (client->rx_len >= 2) {
+            size_t body_len = 0;
+            size_t mult = 1;
+            size_t i = 1;
+            bool complete_header = false;
+            for (; i < client->rx_len && i <= 4; i++) {
+                body_len += (client->rx_buf[i] & 0x7F) * mult;
+                mult *= 128;
+                if ((client->rx_buf[i] & 0x80) == 0) {
+                    complete_header = true;
+                    break;
+                }
+            }
+            if (!complete_header) {
+                break;
+            }
+            size_t header_len = i + 1;
+            size_t total = header_len + body_len;
+            if (total > sizeof(client->rx_buf)) {
+                ESP_LOGW(TAG, "Incoming packet too large (%u bytes)", (unsigned)total);
+                close_socket(client);
+                return false;
+            }
+            if (client->rx_len < total) {
+                break;
+            }
+            handle_packet(client, client->rx_buf, header_len, body_len);
+            if (!client->connected) {
+                return false;
+            }
+            memmove(client->rx_buf, client->rx_buf + total, client->rx_len - total);
+            client->rx_len -= total;
+        }
+    }
+
+    /* Resend publishes whose PUBACK is overdue */
+    pending_flush(client, false);
+
+    /* Keep-alive handling */
+    if (client->connected && client->config.keepalive_s > 0) {
+        uint32_t now = mqtt311_now_ms();
+        uint32_t keepalive_ms = client->config.keepalive_s * 1000u;
+        if (client->ping_outstanding && (now - client->last_rx_ms) > keepalive_ms + keepalive_ms / 2) {
+            ESP_LOGW(TAG, "Keep-alive timeout, closing connection");
+            close_socket(client);
+            return false;
+        }
+        if (!client->ping_outstanding && (now - client->last_tx_ms) >= keepalive_ms) {
+            uint8_t ping[2] = { MQTT_PINGREQ, 0 };
+            if (send_all(client, ping, sizeof(ping))) {
+                client->ping_outstanding = true;
+            }
+        }
+    }
+
+    return client->connected;
+}
+
+/**
+ * @brief Number of QoS 1 publishes waiting for PUBACK
+ *
+ * @param client Client instance
+ * @return size_t Occupied retry queue slots
+ */
+size_t mqtt311_pending_count(const mqtt311_client_t *client) {
+    size_t count = 0;
+    for (size_t i = 0; i < client->pending_count; i++) {
+        if (client->pending[pending_slot(client, i)].used) {
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,191 @@
+/* mqtt311.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef MQTT311_H
+#define MQTT311_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Minimal MQTT 3.1.1 Client
+ * ============================================================================
+ *
+ * Small blocking-socket MQTT 3.1.1 client (CONNECT, PUBLISH QoS 0/1,
+ * SUBSCRIBE, PINGREQ). It uses only the BSD socket API, so the same file
+ * builds on ESP-IDF (lwIP) and on a Linux host for benchmarks.
+ *
+ * QoS 1 publishes are kept in a fixed in-RAM retry queue until the broker
+ * acknowledges them with PUBACK. Unacknowledged packets are resent with the
+ * DUP flag after MQTT311_RETRY_TIMEOUT_MS and after every reconnect.
+ */
+
+/** @brief Largest packet (fixed header included) the client sends or receives */
+#define MQTT311_MAX_PACKET          512
+/** @brief Number of QoS 1 publishes that may await PUBACK at the same time */
+#define MQTT311_RETRY_SLOTS         8
+/** @brief Time before an unacknowledged QoS 1 publish is resent */
+#define MQTT311_RETRY_TIMEOUT_MS    2000
+
+/**
+ * @brief Connection parameters
+ */
+typedef struct {
+    const char *host;           /**< Broker host name or IPv4 address */
+    uint16_t port;              /**< Broker TCP port (usually 1883) */
+    const char *client_id;      /**< MQTT client identifier */
+    const char *username;       /**< Optional user name (NULL or "" for none) */
+    const char *password;       /**< Optional password (NULL or "" for none) */
+    uint16_t keepalive_s;       /**< Keep-alive interval in seconds (0 = disabled) */
+    bool clean_session;         /**< Request a clean session on CONNECT */
+} mqtt311_config_t;
+
+/**
+ * @brief Client statistics
+ */
+typedef struct {
+    uint32_t connects;          /**< Successful CONNECT/CONNACK exchanges */
+    uint32_t published;         /**< PUBLISH packets accepted for sending */
+    uint32_t acked;             /**< PUBACKs received for queued publishes */
+    uint32_t retransmits;       /**< PUBLISH packets resent with DUP flag */
+    uint32_t dropped;           /**< Publishes dropped because the retry queue was full */
+    uint32_t received;          /**< PUBLISH packets received on subscriptions */
+    uint32_t last_ack_ms;       /**< Send-to-PUBACK time of the last acknowledged publish */
+    uint32_t max_ack_ms;        /**< Largest send-to-PUBACK time seen */
+} mqtt311_stats_t;
+
+/**
+ * @brief QoS 1 publish waiting for PUBACK
+ */
+typedef struct {
+    bool used;                          /**< Slot holds a pending publish */
+    uint16_t packet_id;                 /**< MQTT packet identifier */
+    uint16_t length;                    /**< Encoded packet length */
+    uint32_t queued_ms;                 /**< Time the publish was first queued */
+    uint32_t sent_ms;                   /**< Time of the last transmission (0 = not sent yet) */
+    uint8_t packet[MQTT311_MAX_PACKET]; /**< Encoded PUBLISH packet */
+} mqtt311_pending_t;
+
+/**
+ * @brief Callback for PUBLISH packets received on subscribed topics
+ */
+typedef void (*mqtt311_message_cb_t)(void *user, const char *topic, size_t topic_len,
+                                     const uint8_t *payload, size_t payload_len);
+
+/**
+ * @brief Client instance
+ *
+ * All buffers are part of the structure, so a client can be allocated
+ * statically and never touches the heap.
+ */
+typedef struct {
+    mqtt311_config_t config;                        /**< Connection parameters */
+    int sock;                                       /**< Socket descriptor (-1 when closed) */
+    bool connected;                                 /**< CONNACK accepted */
+    bool ping_outstanding;                          /**< PINGREQ sent, PINGRESP pending */
+    uint16_t next_packet_id;                        /**< Next packet identifier */
+    uint32_t last_tx_ms;                            /**< Time of the last transmitted packet */
+    uint32_t last_rx_ms;                            /**< Time of the last received packet */
+    size_t rx_len;                                  /**< Bytes buffered in rx_buf */
+    uint8_t rx_buf[MQTT311_MAX_PACKET];             /**< Receive reassembly buffer */
+    mqtt311_pending_t pending[MQTT311_RETRY_SLOTS]; /**< QoS 1 retry queue (ring, oldest first) */
+    uint8_t pending_head;                           /**< Ring index of the oldest queued publish */
+    uint8_t pending_count;                          /**< Ring entries in use (including acked holes) */
+    mqtt311_message_cb_t on_message;                /**< Subscription callback (optional) */
+    void *user;                                     /**< User pointer passed to on_message */
+    mqtt311_stats_t stats;                          /**< Statistics */
+} mqtt311_client_t;
+
+/**
+ * @brief Initialize a client instance
+ *
+ * @param client Client instance
+ * @param config Connection parameters (strings must stay valid)
+ */
+void mqtt311_init(mqtt311_client_t *client, const mqtt311_config_t *config);
+
+/**
+ * @brief Open the TCP connection and perform CONNECT/CONNACK
+ *
+ * Pending QoS 1 publishes from a previous connection are resent right
+ * after the broker accepted the session.
+ *
+ * @param client Client instance
+ * @param timeout_ms Time to wait for CONNACK
+ * @return true if the broker accepted the connection
+ */
+bool mqtt311_connect(mqtt311_client_t *client, uint32_t timeout_ms);
+
+/**
+ * @brief Send DISCONNECT and close the socket
+ *
+ * The retry queue is kept, so pending publishes survive a reconnect.
+ *
+ * @param client Client instance
+ */
+void mqtt311_disconnect(mqtt311_client_t *client);
+
+/**
+ * @brief Publish a message
+ *
+ * QoS 0 messages are sent immediately and forgotten. QoS 1 messages are
+ * copied to the retry queue and sent if connected; when the queue is full
+ * the oldest pending message is dropped.
+ *
+ * @param client Client instance
+ * @param topic Topic name
+ * @param payload Message payload
+ * @param payload_len Payload length in bytes
+ * @param qos Quality of service (0 or 1)
+ * @param retain Set the RETAIN flag
+ * @return true if the message was sent (QoS 0) or queued (QoS 1)
+ */
+bool mqtt311_publish(mqtt311_client_t *client, const char *topic,
+                     const void *payload, size_t payload_len,
+                     uint8_t qos, bool retain);
+
+/**
+ * @brief Subscribe to a topic filter
+ *
+ * @param client Client instance
+ * @param topic_filter Topic filter
+ * @param qos Requested maximum QoS
+ * @return true if the SUBSCRIBE packet was sent
+ */
+bool mqtt311_subscribe(mqtt311_client_t *client, const char *topic_filter, uint8_t qos);
+
+/**
+ * @brief Process incoming packets, retransmissions and keep-alive
+ *
+ * Must be called periodically while connected.
+ *
+ * @param client Client instance
+ * @param timeout_ms Maximum time to wait for incoming data
+ * @return true while the connection is healthy, false if it was closed
+ */
+bool mqtt311_loop(mqtt311_client_t *client, uint32_t timeout_ms);
+
+/**
+ * @brief Number of QoS 1 publishes waiting for PUBACK
+ *
+ * @param client Client instance
+ * @return size_t Occupied retry queue slots
+ */
+size_t mqtt311_pending_count(const mqtt311_client_t *client);
+
+/**
+ * @brief Monotonic millisecond clock used by the client
+ *
+ * @return uint32_t Milliseconds since an arbitrary start point
+ */
+uint32_t mqtt311_now_ms(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MQTT311_H */
@@ -0,0 +1,361 @@
+/* mqtt_publisher.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "mqtt_publisher.h"
+#include "mqtt311.h"
+#include "io_cache.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+static const char *TAG = "mqtt_pub";
+
+#define MQTT_PUB_TASK_STACK         6144    /**< Publisher task stack size */
+#define MQTT_PUB_TASK_PRIORITY      3       /**< Below the OPC UA task */
+#define MQTT_PUB_POLL_MS            5       /**< Change detection / socket poll interval */
+#define MQTT_PUB_CONNECT_TIMEOUT_MS 5000    /**< TCP connect + CONNACK timeout */
+#define MQTT_PUB_BACKOFF_MIN_MS     1000    /**< First reconnect delay */
+#define MQTT_PUB_BACKOFF_MAX_MS     30000   /**< Largest reconnect delay */
+#define MQTT_PUB_ADC_INVALID        0xFFFF  /**< ADC value sent for channels without data */
+#define MQTT_PUB_PAUSED_POLL_MS     100     /**< Resume check interval while paused */
+
+static mqtt_publisher_config_t pub_config;
+static mqtt311_client_t client;             /**< Static: the retry queue is ~4 KB */
+static mqtt_publisher_stats_t pub_stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t pub_task_handle = NULL;
+static volatile bool pub_paused = false;
+
+/**
+ * @brief Wall clock time in milliseconds (uptime until SNTP has synced)
+ *
+ * @return uint64_t Milliseconds since the Unix epoch
+ */
+static uint64_t get_timestamp_ms(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000u + (uint64_t)(tv.tv_usec / 1000);
+}
+
+/**
+ * @brief Compare two process images
+ *
+ * @param a Previous image
+ * @param b Current image
+ * @return uint16_t MQTT_PUB_CHANGED_* bit mask
+ */
+static uint16_t image_change_mask(const io_cache_snapshot_t *a, const io_cache_snapshot_t *b) {
+    uint16_t mask = 0;
+    if (a->discrete_inputs != b->discrete_inputs) mask |= MQTT_PUB_CHANGED_DI;
+    if (a->discrete_outputs != b->discrete_outputs) mask |= MQTT_PUB_CHANGED_DO;
+    for (int i = 0; i < IO_CACHE_ADC_CHANNELS; i++) {
+        if (a->adc_valid[i] != b->adc_valid[i] || a->adc[i] != b->adc[i]) {
+            mask |= MQTT_PUB_CHANGED_ADC(i);
+        }
+    }
+    return mask;
+}
+
+/**
+ * @brief Store a 16/32/64-bit value little-endian
+ */
+static void put_le(uint8_t *buf, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        buf[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Encode the process image in the configured format
+ *
+ * Binary layout (little-endian, MQTT_PUB_BINARY_SIZE bytes):
+ *   0 version, 1 flags, 2 change mask (u16), 4 sequence (u32),
+ *   8 timestamp ms (u64), 16 coalesced changes (u16), 18 DI (u16),
+ *   20 DO (u16), 22 ADC1..ADC4 (u16 each, 0xFFFF = no data)
+ *
+ * @param buf Output buffer
+ * @param size Output buffer size
+ * @param image Process image
+ * @param flags MQTT_PUB_FLAG_* bits
+ * @param mask Change mask
+ * @param changes Number of coalesced changes
+ * @return size_t Payload length
+ */
+static size_t encode_image(char *buf, size_t size, const io_cache_snapshot_t *image,
+                           uint8_t flags, uint16_t mask, uint32_t changes) {
+    uint64_t ts = get_timestamp_ms();
+    uint16_t adc[IO_CACHE_ADC_CHANNELS];
+    for (int i = 0; i < IO_CACHE_ADC_CHANNELS; i++) {
+        adc[i] = image->adc_valid[i] ? (uint16_t)image->adc[i] : MQTT_PUB_ADC_INVALID;
+    }
+    if (changes > UINT16_MAX) {
+        changes = UINT16_MAX;
+    }
+
+    if (pub_config.format == MQTT_PUB_FORMAT_BINARY) {
+        uint8_t *p = (uint8_t *)buf;
+        p[0] = MQTT_PUB_BINARY_VERSION;
+        p[1] = flags;
+        put_le(p + 2, mask, 2);
+        put_le(p + 4, image->sequence, 4);
+        put_le(p + 8, ts, 8);
+        put_le(p + 16, changes, 2);
+        put_le(p + 18, image->discrete_inputs, 2);
+        put_le(p + 20, image->discrete_outputs, 2);
+        for (int i = 0; i < IO_CACHE_ADC_CHANNELS; i++) {
+            put_le(p + 22 + 2 * i, adc[i], 2);
+        }
+        return MQTT_PUB_BINARY_SIZE;
+    }
+
+    int len = snprintf(buf, size,
+                       "{\"seq\":%lu,\"ts\":%llu,\"flags\":%u,\"changes\":%lu,\"mask\":%u,"
+                       "\"di\":%u,\"do\":%u,\"adc\":[",
+                       (unsigned long)image->sequence, (unsigned long long)ts, flags,
+                       (unsigned long)changes, mask,
+                       image->discrete_inputs, image->discrete_outputs);
+    for (int i = 0; i < IO_CACHE_ADC_CHANNELS && len > 0 && (size_t)len < size; i++) {
+        if (adc[i] == MQTT_PUB_ADC_INVALID) {
+            len += snprintf(buf + len, size - len, "%snull", i ? "," : "");
+        } else {
+            len += snprintf(buf + len, size - len, "%s%u", i ? "," : "", adc[i]);
+        }
+    }
+    if (len > 0 && (size_t)len < size) {
+        len += snprintf(buf + len, size - len, "]}");
+    }
+    return (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
+
+/**
+ * @brief Copy MQTT client counters into the publisher statistics
+ */
+static void update_stats(void) {
+    taskENTER_CRITICAL(&stats_lock);
+    pub_stats.connected = client.connected;
+    pub_stats.acked = client.stats.acked;
+    pub_stats.retransmits = client.stats.retransmits;
+    pub_stats.dropped = client.stats.dropped;
+    pub_stats.pending = (uint32_t)mqtt311_pending_count(&client);
+    pub_stats.reconnects = client.stats.connects;
+    pub_stats.max_ack_ms = client.stats.max_ack_ms;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+/**
+ * @brief Take a snapshot and publish it
+ *
+ * @param last Last published image, updated on success
+ * @param flags MQTT_PUB_FLAG_* bits
+ * @param force_mask Bits forced into the change mask (initial image)
+ * @return true if the message was sent or queued
+ */
+static bool publish_image(io_cache_snapshot_t *last, uint8_t flags, uint16_t force_mask) {
+    io_cache_snapshot_t image;
+    if (!io_cache_get_snapshot(&image)) {
+        return false;
+    }
+
+    uint16_t mask = image_change_mask(last, &image) | force_mask;
+    uint32_t changes = image.sequence - last->sequence;
+    if (mask != 0) {
+        flags |= MQTT_PUB_FLAG_CHANGE;
+    }
+
+    char payload[192];
+    size_t len = encode_image(payload, sizeof(payload), &image, flags, mask, changes);
+    if (len == 0) {
+        return false;
+    }
+
+    bool sent = mqtt311_publish(&client, pub_config.topic, payload, len,
+                                pub_config.qos, pub_config.retain);
+    *last = image;
+
+    taskENTER_CRITICAL(&stats_lock);
+    if (sent) {
+        pub_stats.messages++;
+        pub_stats.changes += changes;
+        if (changes > 1) {
+            pub_stats.batched++;
+        }
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+
+    ESP_LOGD(TAG, "Published seq %lu (mask 0x%04x, %lu changes)",
+             (unsigned long)image.sequence, mask, (unsigned long)changes);
+    return sent;
+}
+
+/**
+ * @brief Publisher task
+ *
+ * Polls the io_cache change sequence every MQTT_PUB_POLL_MS. The first change
+ * opens a batch window of batch_window_ms; when it closes, one snapshot of
+ * the whole image is published. The task also services the MQTT socket and
+ * reconnects with exponential backoff.
+ *
+ * @param pvParameters Task parameters (not used)
+ */
+static void mqtt_publisher_task(void *pvParameters) {
+    mqtt311_config_t mqtt_cfg = {
+        .host = pub_config.broker_host,
+        .port = pub_config.broker_port,
+        .client_id = pub_config.client_id,
+        .username = pub_config.username,
+        .password = pub_config.password,
+        .keepalive_s = pub_config.keepalive_s,
+        .clean_session = true,
+    };
+    mqtt311_init(&client, &mqtt_cfg);
+
+    io_cache_snapshot_t last_image;
+    memset(&last_image, 0, sizeof(last_image));
+    last_image.sequence = io_cache_get_sequence();
+
+    bool initial_sent = false;
+    bool window_open = false;
+    uint32_t window_start = 0;
+    uint32_t last_periodic = mqtt311_now_ms();
+    uint32_t next_connect = 0;
+    uint32_t backoff = MQTT_PUB_BACKOFF_MIN_MS;
+
+    ESP_LOGI(TAG, "MQTT publisher started: %s:%u topic '%s' (%s, QoS %u, window %u ms, interval %lu ms)",
+             pub_config.broker_host, pub_config.broker_port, pub_config.topic,
+             pub_config.format == MQTT_PUB_FORMAT_BINARY ? "binary" : "json",
+             pub_config.qos, pub_config.batch_window_ms, (unsigned long)pub_config.interval_ms);
+
+    while (1) {
+        uint32_t now = mqtt311_now_ms();
+
+        if (pub_paused) {
+            if (client.connected) {
+                mqtt311_disconnect(&client);
+                ESP_LOGI(TAG, "MQTT publisher paused");
+                update_stats();
+            }
+            initial_sent = false;
+            window_open = false;
+            next_connect = now;
+            backoff = MQTT_PUB_BACKOFF_MIN_MS;
+            vTaskDelay(pdMS_TO_TICKS(MQTT_PUB_PAUSED_POLL_MS));
+            continue;
+        }
+
+        if (!client.connected && (int32_t)(now - next_connect) >= 0) {
+            if (mqtt311_connect(&client, MQTT_PUB_CONNECT_TIMEOUT_MS)) {
+                backoff = MQTT_PUB_BACKOFF_MIN_MS;
+            } else {
+                ESP_LOGW(TAG, "Broker %s:%u unreachable, retry in %lu ms",
+                         pub_config.broker_host, pub_config.broker_port, (unsigned long)backoff);
+                next_connect = mqtt311_now_ms() + backoff;
+                backoff = backoff * 2 > MQTT_PUB_BACKOFF_MAX_MS ? MQTT_PUB_BACKOFF_MAX_MS : backoff * 2;
+            }
+            update_stats();
+            now = mqtt311_now_ms();
+        }
+
+        /* Full image once after the first connection so subscribers have a baseline */
+        if (client.connected && !initial_sent) {
+            uint16_t all = MQTT_PUB_CHANGED_DI | MQTT_PUB_CHANGED_DO;
+            for (int i = 0; i < IO_CACHE_ADC_CHANNELS; i++) {
+                all |= MQTT_PUB_CHANGED_ADC(i);
+            }
+            initial_sent = publish_image(&last_image, 0, all);
+            window_open = false;
+            last_periodic = now;
+        }
+
+        if (pub_config.on_change) {
+            if (!window_open && io_cache_get_sequence() != last_image.sequence) {
+                window_open = true;
+                window_start = now;
+            }
+            if (window_open && (now - window_start) >= pub_config.batch_window_ms) {
+                window_open = false;
+                publish_image(&last_image, 0, 0);
+            }
+        }
+
+        if (pub_config.interval_ms > 0 && (now - last_periodic) >= pub_config.interval_ms) {
+            last_periodic = now;
+            window_open = false;
+            publish_image(&last_image, MQTT_PUB_FLAG_PERIODIC, 0);
+        }
+
+        if (client.connected) {
+            if (!mqtt311_loop(&client, MQTT_PUB_POLL_MS)) {
+                ESP_LOGW(TAG, "Broker connection lost, %u messages pending",
+                         (unsigned)mqtt311_pending_count(&client));
+                next_connect = mqtt311_now_ms() + backoff;
+            }
+            update_stats();
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(MQTT_PUB_POLL_MS));
+        }
+    }
+}
+
+/**
+ * @brief Start the publisher task
+ *
+ * @param config Publisher configuration
+ * @return esp_err_t ESP_OK on success or error code
+ */
+esp_err_t mqtt_publisher_start(const mqtt_publisher_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!config->enable) {
+        ESP_LOGI(TAG, "MQTT publisher disabled");
+        return ESP_OK;
+    }
+    if (pub_task_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config->broker_host[0] == '\0' || config->topic[0] == '\0' ||
+        (!config->on_change && config->interval_ms == 0)) {
+        ESP_LOGE(TAG, "Invalid MQTT publisher configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pub_config = *config;
+    if (pub_config.broker_port == 0) {
+        pub_config.broker_port = 1883;
+    }
+
+    BaseType_t ret = xTaskCreatePinnedToCore(mqtt_publisher_task, "mqtt_pub",
+                                             MQTT_PUB_TASK_STACK, NULL,
+                                             MQTT_PUB_TASK_PRIORITY, &pub_task_handle, 1);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create MQTT publisher task");
+        pub_task_handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Pause or resume publishing
+ *
+ * @param paused true to pause
+ */
+void mqtt_publisher_set_paused(bool paused) {
+    pub_paused = paused;
+}
+
+/**
+ * @brief Get publisher statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void mqtt_publisher_get_stats(mqtt_publisher_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    taskENTER_CRITICAL(&stats_lock);
+    *stats = pub_stats;
+    taskEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,115 @@
+/* mqtt_publisher.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef MQTT_PUBLISHER_H
+#define MQTT_PUBLISHER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Process Image MQTT Publisher
+ * ============================================================================
+ *
+ * Publishes the complete I/O process image (discrete inputs, discrete
+ * outputs, 4 ADC channels) to one MQTT topic. Changes are detected through
+ * the io_cache sequence number; every change opens a batch window and all
+ * further changes inside the window are coalesced into one message.
+ */
+
+/** @brief Payload encoding */
+typedef enum {
+    MQTT_PUB_FORMAT_JSON = 0,   /**< Human readable JSON object */
+    MQTT_PUB_FORMAT_BINARY = 1  /**< Fixed 30-byte little-endian record */
+} mqtt_pub_format_t;
+
+/** @brief Size of a MQTT_PUB_FORMAT_BINARY payload */
+#define MQTT_PUB_BINARY_SIZE        30
+/** @brief Version byte of the binary payload */
+#define MQTT_PUB_BINARY_VERSION     1
+
+/* Binary payload flags (byte 1) */
+#define MQTT_PUB_FLAG_PERIODIC      0x01    /**< Message sent by the periodic timer */
+#define MQTT_PUB_FLAG_CHANGE        0x02    /**< Message sent because of a change */
+
+/* Change mask bits (bytes 2..3) */
+#define MQTT_PUB_CHANGED_DI         0x0001  /**< Discrete inputs changed */
+#define MQTT_PUB_CHANGED_DO         0x0002  /**< Discrete outputs changed */
+#define MQTT_PUB_CHANGED_ADC(ch)    (0x0004u << (ch))  /**< ADC channel ch changed */
+
+/**
+ * @brief Publisher configuration
+ */
+typedef struct {
+    bool enable;                /**< Start the publisher task */
+    char broker_host[64];       /**< Broker host name or IPv4 address */
+    uint16_t broker_port;       /**< Broker TCP port */
+    char client_id[32];         /**< MQTT client identifier */
+    char username[24];          /**< Broker user name (empty for none) */
+    char password[24];          /**< Broker password (empty for none) */
+    char topic[64];             /**< Topic for the process image */
+    uint8_t qos;                /**< 0 or 1 */
+    bool retain;                /**< Publish with RETAIN flag */
+    mqtt_pub_format_t format;   /**< Payload encoding */
+    bool on_change;             /**< Publish when the process image changes */
+    uint16_t batch_window_ms;   /**< Coalescing window after the first change (0 = publish immediately) */
+    uint32_t interval_ms;       /**< Periodic publish interval (0 = disabled) */
+    uint16_t keepalive_s;       /**< MQTT keep-alive interval */
+} mqtt_publisher_config_t;
+
+/**
+ * @brief Publisher statistics
+ */
+typedef struct {
+    bool connected;             /**< Broker connection is up */
+    uint32_t messages;          /**< Messages handed to the MQTT client */
+    uint32_t changes;           /**< Change events (sequence increments) published */
+    uint32_t batched;           /**< Messages that coalesced more than one change */
+    uint32_t acked;             /**< QoS 1 messages acknowledged by the broker */
+    uint32_t retransmits;       /**< QoS 1 messages resent */
+    uint32_t dropped;           /**< QoS 1 messages dropped on retry queue overflow */
+    uint32_t pending;           /**< QoS 1 messages waiting for PUBACK */
+    uint32_t reconnects;        /**< Successful broker connections */
+    uint32_t max_ack_ms;        /**< Largest queue-to-PUBACK time */
+} mqtt_publisher_stats_t;
+
+/**
+ * @brief Start the publisher task
+ *
+ * The configuration is copied. Does nothing and returns ESP_OK when
+ * config->enable is false.
+ *
+ * @param config Publisher configuration
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if already running,
+ *         ESP_ERR_INVALID_ARG for a bad configuration, ESP_ERR_NO_MEM if the task
+ *         could not be created
+ */
+esp_err_t mqtt_publisher_start(const mqtt_publisher_config_t *config);
+
+/**
+ * @brief Pause or resume publishing
+ *
+ * A paused publisher closes the broker connection and stays idle. On resume
+ * it reconnects and publishes the full image first. May be called before
+ * the task is started; a publisher started while paused stays idle.
+ *
+ * @param paused true to pause
+ */
+void mqtt_publisher_set_paused(bool paused);
+
+/**
+ * @brief Get publisher statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void mqtt_publisher_get_stats(mqtt_publisher_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MQTT_PUBLISHER_H */
@@ -0,0 +1,951 @@
+/* opcua_pipeline.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "opcua_pipeline.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_vfs_eventfd.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+static const char *TAG = "opcua_pipe";
+
+#define PIPE_NET_TASK_STACK         4096    /**< Network task stack size */
+#define PIPE_NET_TASK_PRIORITY      6       /**< Above the OPC UA task so responses leave promptly */
+#define PIPE_SELECT_TIMEOUT_MS      100     /**< Idle wakeup for the hello timeout */
+#define PIPE_HELLO_TIMEOUT_MS       120000  /**< Close connections without a complete chunk (as the TCP layer) */
+#define PIPE_LISTEN_BACKLOG         4       /**< Pending connections on the listen socket */
+#define PIPE_CHUNK_HEADER           8       /**< messageType(3) + chunkType(1) + messageSize(4) */
+
+/**
+ * @brief Queue entry type
+ */
+typedef enum {
+    PIPE_MSG_DATA = 0,          /**< rx: complete chunks, tx: encoded buffer */
+    PIPE_MSG_CLOSED,            /**< rx: socket closed, remove the connection */
+    PIPE_MSG_CLOSE,             /**< tx: shut the socket down */
+    PIPE_MSG_RELEASE            /**< tx: the server freed the connection */
+} pipe_msg_type_t;
+
+typedef struct pipe_conn pipe_conn_t;
+
+/**
+ * @brief Queue entry
+ */
+typedef struct {
+    pipe_msg_type_t type;       /**< Entry type */
+    pipe_conn_t *conn;          /**< Connection */
+    UA_ByteString buf;          /**< DATA payload, owned by the queue */
+    int64_t received_us;        /**< rx DATA: recv() time (UA_ServerNetworkLayer_nowUs) */
+} pipe_msg_t;
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring
+ */
+typedef struct {
+    pipe_msg_t *items;          /**< Ring storage */
+    uint32_t mask;              /**< Ring size - 1 */
+    atomic_uint head;           /**< Next slot to write, written by the producer */
+    atomic_uint tail;           /**< Next slot to read, written by the consumer */
+} spsc_queue_t;
+
+/**
+ * @brief Buffer waiting for the socket to become writable
+ */
+typedef struct pipe_tx {
+    struct pipe_tx *next;       /**< Next buffer of the connection */
+    UA_ByteString buf;          /**< Encoded data */
+    size_t sent;                /**< Bytes already sent */
+} pipe_tx_t;
+
+/**
+ * @brief Connection of the pipeline
+ *
+ * The UA_Connection is used by the OPC UA task only; all other members
+ * except 'counted' belong to the network task. Ownership of the whole
+ * structure passes through the queues.
+ */
+struct pipe_conn {
+    UA_Connection connection;   /**< Must stay the first member */
+    pipe_conn_t *next;          /**< Next connection of the network task */
+    int sock;                   /**< Socket descriptor */
+    UA_ByteString partial;      /**< Incomplete chunk carried over to the next recv */
+    pipe_tx_t *tx_head;         /**< Buffers waiting for the socket */
+    pipe_tx_t *tx_tail;         /**< Last waiting buffer */
+    uint32_t opened_ms;         /**< Accept time */
+    bool chunk_seen;            /**< A complete chunk was received */
+    bool shutdown_pending;      /**< Shut down once the waiting buffers are sent */
+    bool closed;                /**< Socket closed, CLOSED not queued yet */
+    bool counted;               /**< Counted in the server statistics (OPC UA task) */
+};
+
+/**
+ * @brief Network layer state
+ */
+typedef struct {
+    opcua_pipeline_config_t cfg;    /**< Configuration */
+    UA_UInt16 port;                 /**< TCP port */
+    size_t recv_buffer;             /**< Largest chunk accepted */
+    size_t send_buffer;             /**< Largest send buffer handed out */
+    UA_Byte *scratch;               /**< recv buffer of the network task */
+    int listen_sock;                /**< Listen socket (-1 = not started) */
+    int event_fd;                   /**< Wakes the network task out of select() */
+    spsc_queue_t rxq;               /**< Network task -> OPC UA task */
+    spsc_queue_t txq;               /**< OPC UA task -> network task */
+    pipe_conn_t *conns;             /**< Connections of the network task */
+    TaskHandle_t net_task;          /**< Network task */
+    TaskHandle_t service_task;      /**< Task running the server */
+    bool running;                   /**< Network task owns the connections (OPC UA task view) */
+    atomic_bool net_waiting;        /**< Network task is about to block in select() */
+    atomic_bool stop;               /**< Stop request for the network task */
+    atomic_bool net_exited;         /**< Network task has left its loop */
+} pipe_layer_t;
+
+static opcua_pipeline_stats_t pipe_stats;
+
+/* UA_Connection callbacks, run by the OPC UA task */
+static UA_StatusCode pipe_get_send_buffer(UA_Connection *connection, size_t length, UA_ByteString *buf);
+static void pipe_release_buffer(UA_Connection *connection, UA_ByteString *buf);
+static UA_StatusCode pipe_send(UA_Connection *connection, UA_ByteString *buf);
+static void pipe_close(UA_Connection *connection);
+static void pipe_free(UA_Connection *connection);
+
+/**
+ * @brief Get current system time in milliseconds
+ *
+ * @return uint32_t Milliseconds since system start
+ */
+static uint32_t get_time_ms(void) {
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+/* ============================================================================
+ * SPSC QUEUE
+ * ============================================================================ */
+
+/**
+ * @brief Allocate a ring of depth entries (power of two)
+ */
+static bool queue_init(spsc_queue_t *q, uint32_t depth) {
+    q->items = (pipe_msg_t *)calloc(depth, sizeof(pipe_msg_t));
+    q->mask = depth - 1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    return q->items != NULL;
+}
+
+/**
+ * @brief Append an entry (producer only)
+ *
+ * @return false if the queue is full
+ */
+static bool queue_push(spsc_queue_t *q, const pipe_msg_t *msg) {
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head - tail > q->mask) {
+        return false;
+    }
+    q->items[head & q->mask] = *msg;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Remove the oldest entry (consumer only)
+ *
+ * @return false if the queue is empty
+ */
+static bool queue_pop(spsc_queue_t *q, pipe_msg_t *msg) {
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    *msg = q->items[tail & q->mask];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Free slots as seen by the producer
+ */
+static uint32_t queue_space(spsc_queue_t *q) {
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    return q->mask + 1 - (head - tail);
+}
+
+/**
+ * @brief Entries waiting as seen by the consumer
+ */
+static bool queue_pending(spsc_queue_t *q) {
+    uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    return head != tail;
+}
+
+/* ============================================================================
+ * NETWORK TASK
+ * ============================================================================ */
+
+/**
+ * @brief Wake the network task out of select()
+ */
+static void signal_net(pipe_layer_t *l) {
+    uint64_t one = 1;
+    if (write(l->event_fd, &one, sizeof(one)) < 0) {
+        ESP_LOGD(TAG, "eventfd write failed: errno %d", errno);
+    }
+}
+
+/**
+ * @brief Wake the network task only if it may be blocked in select()
+ *
+ * Pairs with the fence between setting net_waiting and checking the tx
+ * queue in the network task: either the network task sees the new entry or
+ * this sees net_waiting.
+ */
+static void wake_net(pipe_layer_t *l) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&l->net_waiting, memory_order_relaxed)) {
+        signal_net(l);
+    }
+}
+
+/**
+ * @brief Free the network side of a connection
+ */
+static void conn_release_buffers(pipe_conn_t *c) {
+    UA_ByteString_clear(&c->partial);
+    while (c->tx_head != NULL) {
+        pipe_tx_t *t = c->tx_head;
+        c->tx_head = t->next;
+        UA_ByteString_clear(&t->buf);
+        free(t);
+    }
+    c->tx_tail = NULL;
+}
+
+/**
+ * @brief Close the socket; the connection stays listed until CLOSED is queued
+ */
+static void conn_close_socket(pipe_conn_t *c) {
+    if (c->closed) {
+        return;
+    }
+    close(c->sock);
+    c->closed = true;
+    conn_release_buffers(c);
+}
+
+/**
+ * @brief Send waiting buffers until the socket would block
+ */
+static void conn_flush_tx(pipe_conn_t *c) {
+    while (c->tx_head != NULL) {
+        pipe_tx_t *t = c->tx_head;
+        while (t->sent < t->buf.length) {
+            ssize_t n = send(c->sock, t->buf.data + t->sent, t->buf.length - t->sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    conn_close_socket(c);
+                }
+                return;
+            }
+            t->sent += (size_t)n;
+        }
+        pipe_stats.tx_messages++;
+        pipe_stats.tx_bytes += (uint32_t)t->buf.length;
+        c->tx_head = t->next;
+        UA_ByteString_clear(&t->buf);
+        free(t);
+    }
+    c->tx_tail = NULL;
+    if (c->shutdown_pending) {
+        c->shutdown_pending = false;
+        shutdown(c->sock, SHUT_RDWR);
+    }
+}
+
+/**
+ * @brief Queue a buffer behind the waiting ones and send what the socket takes
+ */
+static void conn_send(pipe_conn_t *c, UA_ByteString *buf) {
+    pipe_tx_t *t = (pipe_tx_t *)malloc(sizeof(pipe_tx_t));
+    if (t == NULL) {
+        UA_ByteString_clear(buf);
+        conn_close_socket(c);
+        return;
+    }
+    t->next = NULL;
+    t->buf = *buf;
+    t->sent = 0;
+    UA_ByteString_init(buf);
+
+    bool waiting = c->tx_head != NULL;
+    if (waiting) {
+        c->tx_tail->next = t;
+    } else {
+        c->tx_head = t;
+    }
+    c->tx_tail = t;
+    if (!waiting) {
+        conn_flush_tx(c);
+        if (c->tx_head == t) {
+            pipe_stats.tx_deferred++;
+        }
+    }
+}
+
+/**
+ * @brief Process everything the OPC UA task queued
+ */
+static void net_drain_tx(pipe_layer_t *l) {
+    pipe_msg_t msg;
+    while (queue_pop(&l->txq, &msg)) {
+        pipe_conn_t *c = msg.conn;
+        switch (msg.type) {
+        case PIPE_MSG_DATA:
+            if (c->closed) {
+                UA_ByteString_clear(&msg.buf);
+            } else {
+                conn_send(c, &msg.buf);
+            }
+            break;
+        case PIPE_MSG_CLOSE:
+            // The socket is closed once recv() reports the shutdown
+            if (!c->closed) {
+                if (c->tx_head != NULL) {
+                    c->shutdown_pending = true;
+                } else {
+                    shutdown(c->sock, SHUT_RDWR);
+                }
+            }
+            break;
+        case PIPE_MSG_RELEASE:
+            // CLOSED was queued before, so the connection is no longer listed
+            conn_release_buffers(c);
+            free(c);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Check the header of a chunk
+ */
+static bool chunk_header_valid(const UA_Byte *h) {
+    static const char types[][3] = {
+        { 'H', 'E', 'L' }, { 'A', 'C', 'K' }, { 'E', 'R', 'R' }, { 'R', 'H', 'E' },
+        { 'O', 'P', 'N' }, { 'C', 'L', 'O' }, { 'M', 'S', 'G' }
+    };
+    if (h[3] != 'F' && h[3] != 'C' && h[3] != 'A') {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (memcmp(h, types[i], 3) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Receive from a connection and queue the complete chunks
+ *
+ * The caller guarantees room for one rx entry.
+ *
+ * @return true if an entry was queued
+ */
+static bool conn_receive(pipe_layer_t *l, pipe_conn_t *c) {
+    // An incomplete chunk from the last call goes in front of the new bytes
+    size_t have = c->partial.length;
+    if (have > 0) {
+        memcpy(l->scratch, c->partial.data, have);
+    }
+    ssize_t n = recv(c->sock, l->scratch + have, l->recv_buffer - have, 0);
+    int64_t received_us = UA_ServerNetworkLayer_nowUs();
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return false;
+    }
+    if (n <= 0) {
+        conn_close_socket(c);
+        return false;
+    }
+    size_t total = have + (size_t)n;
+
+    size_t complete = 0;
+    while (total - complete >= PIPE_CHUNK_HEADER) {
+        const UA_Byte *h = l->scratch + complete;
+        uint32_t size = (uint32_t)h[4] | ((uint32_t)h[5] << 8) |
+                        ((uint32_t)h[6] << 16) | ((uint32_t)h[7] << 24);
+        if (!chunk_header_valid(h) || size < PIPE_CHUNK_HEADER || size > l->recv_buffer) {
+            ESP_LOGW(TAG, "Connection %d | Malformed chunk header, closing", c->sock);
+            pipe_stats.bad_chunks++;
+            conn_close_socket(c);
+            return false;
+        }
+        if (total - complete < size) {
+            break;
+        }
+        complete += size;
+    }
+
+    // Keep the incomplete tail for the next call
+    size_t rest = total - complete;
+    UA_ByteString_clear(&c->partial);
+    if (rest > 0) {
+        if (UA_ByteString_allocBuffer(&c->partial, rest) != UA_STATUSCODE_GOOD) {
+            conn_close_socket(c);
+            return false;
+        }
+        memcpy(c->partial.data, l->scratch + complete, rest);
+    }
+    if (complete == 0) {
+        return false;
+    }
+
+    UA_ByteString data;
+    if (UA_ByteString_allocBuffer(&data, complete) != UA_STATUSCODE_GOOD) {
+        conn_close_socket(c);
+        return false;
+    }
+    memcpy(data.data, l->scratch, complete);
+
+    c->chunk_seen = true;
+    pipe_msg_t msg = { PIPE_MSG_DATA, c, data, received_us };
+    queue_push(&l->rxq, &msg);
+    pipe_stats.rx_messages++;
+    pipe_stats.rx_bytes += (uint32_t)complete;
+    return true;
+}
+
+/**
+ * @brief Accept a new connection
+ */
+static void net_accept(pipe_layer_t *l) {
+    struct sockaddr_storage remote;
+    socklen_t remote_len = sizeof(remote);
+    int sock = accept(l->listen_sock, (struct sockaddr *)&remote, &remote_len);
+    if (sock < 0) {
+        return;
+    }
+
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    int nodelay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    pipe_conn_t *c = (pipe_conn_t *)calloc(1, sizeof(pipe_conn_t));
+    if (c == NULL) {
+        close(sock);
+        return;
+    }
+    c->sock = sock;
+    c->opened_ms = get_time_ms();
+    c->next = l->conns;
+    l->conns = c;
+    pipe_stats.connections++;
+
+    // Published to the OPC UA task by the release store of the first rx entry
+    UA_Connection *uc = &c->connection;
+    uc->state = UA_CONNECTIONSTATE_OPENING;
+    uc->sockfd = sock;
+    uc->handle = l;
+    uc->openingDate = UA_DateTime_nowMonotonic();
+    uc->getSendBuffer = pipe_get_send_buffer;
+    uc->releaseSendBuffer = pipe_release_buffer;
+    uc->send = pipe_send;
+    uc->releaseRecvBuffer = pipe_release_buffer;
+    uc->close = pipe_close;
+    uc->free = pipe_free;
+
+    ESP_LOGI(TAG, "Connection %d | New connection", sock);
+}
+
+/**
+ * @brief Queue CLOSED for closed sockets and forget those connections
+ *
+ * @return true if an entry was queued
+ */
+static bool net_report_closed(pipe_layer_t *l) {
+    bool queued = false;
+    pipe_conn_t **pp = &l->conns;
+    while (*pp != NULL) {
+        pipe_conn_t *c = *pp;
+        if (!c->closed) {
+            pp = &c->next;
+            continue;
+        }
+        pipe_msg_t msg = { PIPE_MSG_CLOSED, c, UA_BYTESTRING_NULL };
+        if (!queue_push(&l->rxq, &msg)) {
+            break;
+        }
+        ESP_LOGI(TAG, "Connection %d | Closed", c->sock);
+        *pp = c->next;
+        queued = true;
+    }
+    return queued;
+}
+
+/**
+ * @brief Network task
+ *
+ * select() over the listen socket, the connections and the eventfd the
+ * OPC UA task signals when it queues data while this task is blocked.
+ *
+ * @param pvParameters Network layer state
+ */
+static void opcua_net_task(void *pvParameters) {
+    pipe_layer_t *l = (pipe_layer_t *)pvParameters;
+
+    ESP_LOGI(TAG, "Network task started on core %d", xPortGetCoreID());
+
+    while (!atomic_load(&l->stop)) {
+        net_drain_tx(l);
+        if (net_report_closed(l)) {
+            xTaskNotifyGive(l->service_task);
+        }
+
+        // Stop reading while the OPC UA task is behind; TCP flow control
+        // pushes back on the clients
+        bool rx_room = queue_space(&l->rxq) > 0;
+        if (!rx_room) {
+            pipe_stats.rx_queue_full++;
+        }
+
+        fd_set rset, wset;
+        FD_ZERO(&rset);
+        FD_ZERO(&wset);
+        FD_SET(l->event_fd, &rset);
+        int max_fd = l->event_fd;
+        if (rx_room) {
+            FD_SET(l->listen_sock, &rset);
+            if (l->listen_sock > max_fd) {
+                max_fd = l->listen_sock;
+            }
+        }
+        for (pipe_conn_t *c = l->conns; c != NULL; c = c->next) {
+            if (c->closed) {
+                continue;
+            }
+            if (rx_room) {
+                FD_SET(c->sock, &rset);
+            }
+            if (c->tx_head != NULL) {
+                FD_SET(c->sock, &wset);
+            }
+            if (c->sock > max_fd) {
+                max_fd = c->sock;
+            }
+        }
+
+        struct timeval tv = { .tv_sec = 0, .tv_usec = (rx_room ? PIPE_SELECT_TIMEOUT_MS : 1) * 1000 };
+        atomic_store(&l->net_waiting, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (queue_pending(&l->txq)) {
+            tv.tv_usec = 0;
+        }
+        int ready = select(max_fd + 1, &rset, &wset, NULL, &tv);
+        atomic_store(&l->net_waiting, false);
+        if (ready < 0) {
+            if (errno != EINTR) {
+                vTaskDelay(pdMS_TO_TICKS(10));
+            }
+            continue;
+        }
+
+        if (ready > 0 && FD_ISSET(l->event_fd, &rset)) {
+            uint64_t count;
+            if (read(l->event_fd, &count, sizeof(count)) < 0) {
+                ESP_LOGD(TAG, "eventfd read failed: errno %d", errno);
+            }
+        }
+        if (ready > 0 && rx_room && FD_ISSET(l->listen_sock, &rset)) {
+            net_accept(l);
+        }
+
+        bool queued = false;
+        uint32_t now = get_time_ms();
+        for (pipe_conn_t *c = l->conns; c != NULL; c = c->next) {
+            if (c->closed) {
+                continue;
+            }
+            if (ready > 0 && FD_ISSET(c->sock, &wset)) {
+                conn_flush_tx(c);
+            }
+            if (ready > 0 && !c->closed && FD_ISSET(c->sock, &rset) && queue_space(&l->rxq) > 0) {
+                queued |= conn_receive(l, c);
+            }
+            if (!c->closed && !c->chunk_seen && (now - c->opened_ms) > PIPE_HELLO_TIMEOUT_MS) {
+                ESP_LOGI(TAG, "Connection %d | Closed by the server (no Hello Message)", c->sock);
+                conn_close_socket(c);
+            }
+        }
+        queued |= net_report_closed(l);
+        if (queued) {
+            xTaskNotifyGive(l->service_task);
+        }
+    }
+
+    atomic_store(&l->net_exited, true);
+    vTaskDelete(NULL);
+}
+
+/* ============================================================================
+ * UA_Connection CALLBACKS (OPC UA task)
+ * ============================================================================ */
+
+/**
+ * @brief Queue an entry for the network task, waiting while the queue is full
+ */
+static void push_tx(pipe_layer_t *l, const pipe_msg_t *msg) {
+    while (!queue_push(&l->txq, msg)) {
+        pipe_stats.tx_queue_full++;
+        signal_net(l);
+        vTaskDelay(1);
+    }
+    wake_net(l);
+}
+
+static UA_StatusCode
+pipe_get_send_buffer(UA_Connection *connection, size_t length, UA_ByteString *buf) {
+    pipe_layer_t *l = (pipe_layer_t *)connection->handle;
+    if (length > l->send_buffer) {
+        return UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    }
+    return UA_ByteString_allocBuffer(buf, length);
+}
+
+static void
+pipe_release_buffer(UA_Connection *connection, UA_ByteString *buf) {
+    UA_ByteString_clear(buf);
+}
+
+static UA_StatusCode
+pipe_send(UA_Connection *connection, UA_ByteString *buf) {
+    pipe_layer_t *l = (pipe_layer_t *)connection->handle;
+    if (connection->state == UA_CONNECTIONSTATE_CLOSED || !l->running) {
+        UA_ByteString_clear(buf);
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+    }
+
+    // The stack allocates the full send buffer; give the unused tail back
+    // before the buffer waits in the queue
+    if (buf->length > 0) {
+        UA_Byte *data = (UA_Byte *)UA_realloc(buf->data, buf->length);
+        if (data != NULL) {
+            buf->data = data;
+        }
+    }
+
+    pipe_msg_t msg = { PIPE_MSG_DATA, (pipe_conn_t *)connection, *buf };
+    UA_ByteString_init(buf);
+    push_tx(l, &msg);
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+pipe_close(UA_Connection *connection) {
+    pipe_layer_t *l = (pipe_layer_t *)connection->handle;
+    if (connection->state == UA_CONNECTIONSTATE_CLOSED) {
+        return;
+    }
+    connection->state = UA_CONNECTIONSTATE_CLOSED;
+    if (l->running) {
+        pipe_msg_t msg = { PIPE_MSG_CLOSE, (pipe_conn_t *)connection, UA_BYTESTRING_NULL };
+        push_tx(l, &msg);
+    }
+}
+
+static void
+pipe_free(UA_Connection *connection) {
+    pipe_layer_t *l = (pipe_layer_t *)connection->handle;
+    pipe_conn_t *c = (pipe_conn_t *)connection;
+    if (l->running) {
+        // Entries for this connection may still wait in the tx queue
+        pipe_msg_t msg = { PIPE_MSG_RELEASE, c, UA_BYTESTRING_NULL };
+        push_tx(l, &msg);
+        return;
+    }
+    conn_release_buffers(c);
+    free(c);
+}
+
+/* ============================================================================
+ * UA_ServerNetworkLayer (OPC UA task)
+ * ============================================================================ */
+
+/**
+ * @brief Hand a closed connection to the server
+ */
+static void service_remove(UA_ServerNetworkLayer *nl, UA_Server *server, pipe_conn_t *c) {
+    c->connection.state = UA_CONNECTIONSTATE_CLOSED;
+    if (c->counted && nl->statistics) {
+        nl->statistics->currentConnectionCount--;
+    }
+    UA_Server_removeConnection(server, &c->connection);
+}
+
+/**
+ * @brief Process the entries queued by the network task
+ *
+ * At most one queue length per call, so timers are not starved.
+ *
+ * @return uint32_t Entries processed
+ */
+static uint32_t service_process_rx(UA_ServerNetworkLayer *nl, UA_Server *server) {
+    pipe_layer_t *l = (pipe_layer_t *)nl->handle;
+    uint32_t processed = 0;
+    pipe_msg_t msg;
+    while (processed <= l->rxq.mask && queue_pop(&l->rxq, &msg)) {
+        pipe_conn_t *c = msg.conn;
+        if (msg.type == PIPE_MSG_DATA) {
+            if (!c->counted) {
+                c->counted = true;
+                if (nl->statistics) {
+                    nl->statistics->currentConnectionCount++;
+                    nl->statistics->cumulatedConnectionCount++;
+                }
+            }
+            if (c->connection.state != UA_CONNECTIONSTATE_CLOSED) {
+                UA_ServerNetworkLayer_setReceiveTime(msg.received_us);
+                UA_Server_processBinaryMessage(server, &c->connection, &msg.buf);
+                UA_ServerNetworkLayer_setReceiveTime(0);
+            }
+            UA_ByteString_clear(&msg.buf);
+        } else if (msg.type == PIPE_MSG_CLOSED) {
+            service_remove(nl, server, c);
+        }
+        processed++;
+    }
+    if (processed > pipe_stats.max_rx_batch) {
+        pipe_stats.max_rx_batch = processed;
+    }
+    return processed;
+}
+
+static UA_StatusCode
+pipe_listen(UA_ServerNetworkLayer *nl, UA_Server *server, UA_UInt16 timeout) {
+    if (service_process_rx(nl, server) == 0 && timeout > 0) {
+        // Round up: with a 10 ms tick a shorter wait would not block at all
+        TickType_t ticks = (timeout + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+        ulTaskNotifyTake(pdTRUE, ticks);
+        service_process_rx(nl, server);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+static UA_StatusCode
+pipe_start(UA_ServerNetworkLayer *nl, const UA_Logger *logger, const UA_String *customHostname) {
+    pipe_layer_t *l = (pipe_layer_t *)nl->handle;
+
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    esp_err_t err = esp_vfs_eventfd_register(&eventfd_config);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "eventfd registration failed: %s", esp_err_to_name(err));
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    l->event_fd = eventfd(0, 0);
+    if (l->event_fd < 0) {
+        ESP_LOGE(TAG, "Failed to create eventfd: errno %d", errno);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    l->listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (l->listen_sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    int reuse = 1;
+    setsockopt(l->listen_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(l->port);
+    if (bind(l->listen_sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(l->listen_sock, PIPE_LISTEN_BACKLOG) != 0) {
+        ESP_LOGE(TAG, "Failed to listen on port %u: errno %d", l->port, errno);
+        close(l->listen_sock);
+        l->listen_sock = -1;
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    int flags = fcntl(l->listen_sock, F_GETFL, 0);
+    fcntl(l->listen_sock, F_SETFL, flags | O_NONBLOCK);
+
+    // Discovery URL as built by the TCP network layer
+    char url[256];
+    int len;
+    if (customHostname->length > 0) {
+        len = snprintf(url, sizeof(url), "opc.tcp://%.*s:%u/",
+                       (int)customHostname->length, (const char *)customHostname->data, l->port);
+    } else {
+        char hostname[128];
+        if (UA_gethostname(hostname, sizeof(hostname)) != 0) {
+            snprintf(hostname, sizeof(hostname), "localhost");
+        }
+        len = snprintf(url, sizeof(url), "opc.tcp://%s:%u/", hostname, l->port);
+    }
+    UA_String du = { (size_t)(len < (int)sizeof(url) ? len : (int)sizeof(url) - 1), (UA_Byte *)url };
+    UA_String_copy(&du, &nl->discoveryUrl);
+
+    l->service_task = xTaskGetCurrentTaskHandle();
+    atomic_store(&l->stop, false);
+    atomic_store(&l->net_exited, false);
+    l->running = true;
+    BaseType_t ret = xTaskCreatePinnedToCore(opcua_net_task, "opcua_net", PIPE_NET_TASK_STACK, l,
+                                             PIPE_NET_TASK_PRIORITY, &l->net_task, l->cfg.net_core);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create network task");
+        l->running = false;
+        l->net_task = NULL;
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    ESP_LOGI(TAG, "Pipeline listening on %.*s (network core %u, service core %u, queue depth %u)",
+             (int)nl->discoveryUrl.length, (const char *)nl->discoveryUrl.data,
+             l->cfg.net_core, l->cfg.service_core, (unsigned)(l->rxq.mask + 1));
+    return UA_STATUSCODE_GOOD;
+}
+
+static void
+pipe_stop(UA_ServerNetworkLayer *nl, UA_Server *server) {
+    pipe_layer_t *l = (pipe_layer_t *)nl->handle;
+    ESP_LOGI(TAG, "Shutting down the pipeline");
+
+    if (l->net_task != NULL) {
+        atomic_store(&l->stop, true);
+        signal_net(l);
+        while (!atomic_load(&l->net_exited)) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        l->net_task = NULL;
+    }
+    // From here on this task owns every connection
+    l->running = false;
+
+    pipe_msg_t msg;
+    while (queue_pop(&l->txq, &msg)) {
+        if (msg.type == PIPE_MSG_DATA) {
+            UA_ByteString_clear(&msg.buf);
+        } else if (msg.type == PIPE_MSG_RELEASE) {
+            conn_release_buffers(msg.conn);
+            free(msg.conn);
+        }
+    }
+    while (queue_pop(&l->rxq, &msg)) {
+        if (msg.type == PIPE_MSG_DATA) {
+            UA_ByteString_clear(&msg.buf);
+        } else if (msg.type == PIPE_MSG_CLOSED) {
+            service_remove(nl, server, msg.conn);
+        }
+    }
+    while (l->conns != NULL) {
+        pipe_conn_t *c = l->conns;
+        l->conns = c->next;
+        conn_close_socket(c);
+        service_remove(nl, server, c);
+    }
+
+    if (l->listen_sock >= 0) {
+        close(l->listen_sock);
+        l->listen_sock = -1;
+    }
+    if (l->event_fd >= 0) {
+        close(l->event_fd);
+        l->event_fd = -1;
+    }
+}
+
+static void
+pipe_clear(UA_ServerNetworkLayer *nl) {
+    pipe_layer_t *l = (pipe_layer_t *)nl->handle;
+    UA_String_clear(&nl->discoveryUrl);
+    if (l == NULL) {
+        return;
+    }
+    free(l->rxq.items);
+    free(l->txq.items);
+    free(l->scratch);
+    free(l);
+    nl->handle = NULL;
+}
+
+/* ============================================================================
+ * PUBLIC API
+ * ============================================================================ */
+
+UA_StatusCode opcua_pipeline_install(UA_ServerConfig *config, UA_UInt16 port,
+                                     const opcua_pipeline_config_t *pipeline) {
+    if (config == NULL || pipeline == NULL || config->networkLayersSize == 0) {
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+    uint32_t depth = pipeline->queue_depth ? pipeline->queue_depth : OPCUA_PIPELINE_QUEUE_DEPTH;
+    if (depth < 4 || (depth & (depth - 1)) != 0 ||
+        pipeline->net_core >= portNUM_PROCESSORS || pipeline->service_core >= portNUM_PROCESSORS) {
+        ESP_LOGE(TAG, "Invalid pipeline configuration");
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+
+    UA_ConnectionConfig cc = config->networkLayers[0].localConnectionConfig;
+    pipe_layer_t *l = (pipe_layer_t *)calloc(1, sizeof(pipe_layer_t));
+    if (l == NULL) {
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+    l->cfg = *pipeline;
+    l->cfg.queue_depth = (uint16_t)depth;
+    l->port = port;
+    l->recv_buffer = cc.recvBufferSize;
+    l->send_buffer = cc.sendBufferSize;
+    l->listen_sock = -1;
+    l->event_fd = -1;
+    l->scratch = (UA_Byte *)malloc(l->recv_buffer);
+    if (l->scratch == NULL || !queue_init(&l->rxq, depth) || !queue_init(&l->txq, depth)) {
+        free(l->rxq.items);
+        free(l->txq.items);
+        free(l->scratch);
+        free(l);
+        return UA_STATUSCODE_BADOUTOFMEMORY;
+    }
+
+    // Replace the TCP layer(s) created by UA_ServerConfig_setMinimal...()
+    for (size_t i = 0; i < config->networkLayersSize; i++) {
+        if (config->networkLayers[i].clear) {
+            config->networkLayers[i].clear(&config->networkLayers[i]);
+        }
+    }
+    UA_ServerNetworkLayer *nl = &config->networkLayers[0];
+    memset(nl, 0, sizeof(UA_ServerNetworkLayer));
+    nl->handle = l;
+    nl->localConnectionConfig = cc;
+    nl->start = pipe_start;
+    nl->listen = pipe_listen;
+    nl->stop = pipe_stop;
+    nl->clear = pipe_clear;
+    config->networkLayersSize = 1;
+
+    memset(&pipe_stats, 0, sizeof(pipe_stats));
+    return UA_STATUSCODE_GOOD;
+}
+
+void opcua_pipeline_get_stats(opcua_pipeline_stats_t *stats) {
+    if (stats != NULL) {
+        *stats = pipe_stats;
+    }
+}
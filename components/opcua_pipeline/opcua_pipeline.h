@@ -0,0 +1,96 @@
+/* opcua_pipeline.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef OPCUA_PIPELINE_H
+#define OPCUA_PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "open62541.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Dual-Core Server Pipeline
+ * ============================================================================
+ *
+ * Optional replacement for the TCP network layer of the stack that splits the
+ * server into two stages on separate cores:
+ *
+ *   network task (net_core)     accept, recv, chunk assembly and header
+ *                               checks, send, socket shutdown
+ *   OPC UA task (service_core)  SecureChannel, sessions, services,
+ *                               subscriptions and timers
+ *
+ * The stages are connected by two lock-free single-producer/single-consumer
+ * queues: complete chunks towards the OPC UA task, encoded responses and
+ * close requests towards the network task. The network task never touches
+ * server state and the OPC UA task never touches a socket, so the server
+ * itself needs no lock (the stack is built with UA_MULTITHREADING 0).
+ *
+ * Only SecurityPolicy#None is enabled, so there is no symmetric crypto to
+ * move into the network stage; signing and encryption would stay with the
+ * SecureChannel in the OPC UA task.
+ */
+
+/** @brief Default number of entries per queue */
+#define OPCUA_PIPELINE_QUEUE_DEPTH  64
+
+/**
+ * @brief Pipeline configuration
+ */
+typedef struct {
+    bool enable;                /**< Use the pipeline instead of the single-task TCP layer */
+    uint8_t net_core;           /**< Core of the network task */
+    uint8_t service_core;       /**< Core of the OPC UA task */
+    uint16_t queue_depth;       /**< Entries per queue, power of two (0 = default) */
+} opcua_pipeline_config_t;
+
+/**
+ * @brief Pipeline statistics
+ *
+ * Every counter is written by one task only.
+ */
+typedef struct {
+    uint32_t connections;       /**< Accepted connections */
+    uint32_t rx_messages;       /**< Queue entries with complete chunks handed to the OPC UA task */
+    uint32_t rx_bytes;          /**< Bytes in those entries */
+    uint32_t tx_messages;       /**< Buffers sent by the network task */
+    uint32_t tx_bytes;          /**< Bytes sent */
+    uint32_t tx_deferred;       /**< Buffers that had to wait for the socket to become writable */
+    uint32_t rx_queue_full;     /**< Network loops that stopped reading because the rx queue was full */
+    uint32_t tx_queue_full;     /**< Sends that waited for space in the tx queue */
+    uint32_t bad_chunks;        /**< Connections closed because of a malformed chunk header */
+    uint32_t max_rx_batch;      /**< Most rx entries processed by one listen() call */
+} opcua_pipeline_stats_t;
+
+/**
+ * @brief Replace the network layer of a server configuration with the pipeline
+ *
+ * Call after UA_ServerConfig_setMinimal...() and before UA_Server_run_startup().
+ * The buffer sizes of the existing layer are kept. The network task is
+ * started by UA_Server_run_startup() and stopped by UA_Server_run_shutdown();
+ * both must be called from the task that runs UA_Server_run_iterate().
+ *
+ * @param config   Server configuration
+ * @param port     TCP port
+ * @param pipeline Pipeline configuration (copied)
+ * @return UA_StatusCode UA_STATUSCODE_GOOD, BADINVALIDARGUMENT for a bad
+ *         configuration or BADOUTOFMEMORY
+ */
+UA_StatusCode opcua_pipeline_install(UA_ServerConfig *config, UA_UInt16 port,
+                                     const opcua_pipeline_config_t *pipeline);
+
+/**
+ * @brief Get pipeline statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void opcua_pipeline_get_stats(opcua_pipeline_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OPCUA_PIPELINE_H */
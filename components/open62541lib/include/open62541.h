@@ -89,6 +89,27 @@
 
 /* #undef UA_PACK_DEBIAN */
 
+/* Local extension: "nano" build profile (CONFIG_UA_PROFILE_NANO, see
+ * README.md). Keeps only what the gateway exposes: Read/Write/Browse,
+ * subscriptions and the minimal namespace 0. */
+#if defined(ESP_PLATFORM) && !defined(UA_PROFILE_NANO)
+# include "sdkconfig.h"
+# ifdef CONFIG_UA_PROFILE_NANO
+#  define UA_PROFILE_NANO
+# endif
+#endif
+#ifdef UA_PROFILE_NANO
+# undef UA_ENABLE_METHODCALLS
+# undef UA_ENABLE_NODEMANAGEMENT
+# undef UA_ENABLE_DA
+# undef UA_ENABLE_PARSING
+# undef UA_ENABLE_SUBSCRIPTIONS_EVENTS
+# undef UA_ENABLE_STATUSCODE_DESCRIPTIONS
+# undef UA_ENABLE_DISCOVERY
+# undef UA_ENABLE_DISCOVERY_MULTICAST
+# undef UA_GENERATED_NAMESPACE_ZERO
+#endif
+
 /* Options for Debugging */
 /* #undef UA_DEBUG */
 /* #undef UA_DEBUG_DUMP_PKGS */
@@ -227,6 +248,7 @@ int esp_getaddrinfo(const char *nodename, const char *servername,
 #define UA_ERR_CONNECTION_PROGRESS EINPROGRESS
 
 #define UA_send lwip_send
+#define UA_sendmsg lwip_sendmsg
 #define UA_recv lwip_recv
 #define UA_sendto lwip_sendto
 #define UA_recvfrom lwip_recvfrom
@@ -12916,6 +12938,10 @@ typedef int64_t UA_DateTime;
 /* The current time in UTC time */
 UA_DateTime UA_EXPORT UA_DateTime_now(void);
 
+/* Replace the system clock behind UA_DateTime_now() (NULL = system clock) */
+typedef UA_DateTime (*UA_DateTimeSource)(void);
+void UA_EXPORT UA_DateTime_setSource(UA_DateTimeSource source);
+
 /* Offset between local time and UTC time */
 UA_Int64 UA_EXPORT UA_DateTime_localTimeUtcOffset(void);
 
@@ -13581,6 +13607,20 @@ typedef struct {
     UA_Boolean    hasServerPicoseconds : 1;
 } UA_DataValue;
 
+/* Local extension: pre-encoded DataValue content (see README.md).
+ *
+ * The binary encoder calls the lookup for every DataValue with a value whose
+ * variant data is not owned (UA_VARIANT_DATA_NODELETE) and that carries no
+ * status or picoseconds. The lookup returns the encoded variant, followed by
+ * the encoded source timestamp if hasSourceTimestamp is set, or NULL to fall
+ * back to the generic encoder. The bytes must be identical to what the
+ * generic encoder would produce. */
+typedef const UA_ByteString *
+(*UA_DataValueEncodingLookup)(const UA_DataValue *value);
+
+void UA_EXPORT
+UA_DataValue_setEncodingLookup(UA_DataValueEncodingLookup lookup);
+
 /**
  * DiagnosticInfo
  * ^^^^^^^^^^^^^^
@@ -30260,6 +30300,158 @@ UA_ServerNetworkLayer UA_EXPORT
 UA_ServerNetworkLayerTCP(UA_ConnectionConfig config, UA_UInt16 port,
                          UA_UInt16 maxConnections);
 
+/* Local extension: request scheduling in the TCP server network layer (see
+ * README.md).
+ *
+ * Without scheduling, listen() processes everything select() reports in
+ * socket order, so one client flooding Browse or large Reads delays the
+ * requests of all others. With scheduling, received bytes are split into
+ * chunks and queued per connection. Every listen() call first processes the
+ * priority lane, then at most one chunk of every connection (round-robin).
+ * The priority lane holds Write and Call requests whose targets the callback
+ * accepts (every Write and Call if it is NULL). A connection with a full
+ * queue is not read, so TCP flow control pushes back on the client. The
+ * order of chunks within a connection never changes.
+ *
+ * The optional rate limit is a token bucket per connection (that is, per
+ * SecureChannel and its session) and applies to the normal lane only.
+ * The configuration is global; set it before UA_Server_run_startup(). */
+typedef UA_Boolean
+(*UA_TcpSchedulerPriorityCallback)(const UA_NodeId *nodeId);
+
+typedef struct {
+    UA_Boolean enabled;
+    UA_UInt16 queueSize;        /* Chunks queued per connection (0 = 8) */
+    UA_UInt16 rateLimit;        /* Normal lane chunks/s per connection (0 = none) */
+    UA_UInt16 rateBurst;        /* Bucket size in chunks (0 = one second of rateLimit) */
+    UA_TcpSchedulerPriorityCallback isPriorityNode; /* NodeId of a written variable,
+                                                     * called object or method */
+} UA_TcpSchedulerConfig;
+
+typedef enum {
+    UA_TCPSCHEDULERLANE_PRIORITY = 0,
+    UA_TCPSCHEDULERLANE_NORMAL = 1
+} UA_TcpSchedulerLane;
+
+#define UA_TCPSCHEDULER_LANES 2
+
+/* Latency histogram: upper bounds of the buckets in microseconds, the last
+ * bucket counts everything above */
+#define UA_TCPSCHEDULER_BUCKETS 10
+#define UA_TCPSCHEDULER_BUCKET_BOUNDS_US \
+    {250, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000}
+
+typedef struct {
+    UA_UInt32 processed;        /* Chunks processed */
+    UA_UInt32 queued;           /* Chunks waiting now */
+    UA_UInt32 maxQueued;        /* Most chunks waiting at once */
+    UA_UInt32 latencyMaxUs;     /* Longest time from receive to processed */
+    UA_UInt32 latencySumMs;     /* Sum of all latencies */
+    UA_UInt32 latencyBuckets[UA_TCPSCHEDULER_BUCKETS];
+} UA_TcpSchedulerLaneStatistics;
+
+typedef struct {
+    UA_TcpSchedulerLaneStatistics lanes[UA_TCPSCHEDULER_LANES];
+    UA_UInt32 rateLimited;      /* Calls in which a connection waited for its rate limit */
+    UA_UInt32 readsDeferred;    /* Calls in which a connection was not read (queue full) */
+} UA_TcpSchedulerStatistics;
+
+void UA_EXPORT
+UA_ServerNetworkLayerTCP_setScheduler(const UA_TcpSchedulerConfig *config);
+
+void UA_EXPORT
+UA_ServerNetworkLayerTCP_getSchedulerStatistics(UA_TcpSchedulerStatistics *stats);
+
+/* Local extension: coalesced sending in the TCP server network layer (see
+ * README.md).
+ *
+ * Without coalescing, every chunk is written with its own send(). With
+ * TCP_NODELAY each send() leaves as a separate segment, so a listen() call
+ * that answers several requests and a Publish emits several small packets.
+ * With coalescing, encoded chunks are kept per connection and written with
+ * one sendmsg() when listen() has processed the received messages and before
+ * it waits in select() (to cover responses sent from timers). A connection
+ * is flushed early when maxChunks or maxBytes is reached and before it is
+ * shut down. The configuration is global; set it before
+ * UA_Server_run_startup(). */
+typedef struct {
+    UA_Boolean enabled;
+    UA_UInt16 maxChunks;        /* Chunks kept per connection (0 = 16, at most 32) */
+    UA_UInt32 maxBytes;         /* Bytes kept per connection (0 = 5760) */
+} UA_TcpSendConfig;
+
+typedef struct {
+    UA_UInt32 chunks;           /* Chunks sent */
+    UA_UInt32 bytes;            /* Bytes sent */
+    UA_UInt32 flushes;          /* sendmsg() batches (send() calls without coalescing) */
+    UA_UInt32 earlyFlushes;     /* Batches written because maxChunks or maxBytes was reached */
+    UA_UInt32 maxBatch;         /* Most chunks in one batch */
+} UA_TcpSendStatistics;
+
+void UA_EXPORT
+UA_ServerNetworkLayerTCP_setSendCoalescing(const UA_TcpSendConfig *config);
+
+void UA_EXPORT
+UA_ServerNetworkLayerTCP_getSendStatistics(UA_TcpSendStatistics *stats);
+
+/* Local extension: receive time of the message being processed (see
+ * README.md).
+ *
+ * The network layer stamps a message when recv() returns it and sets the
+ * stamp while UA_Server_processBinaryMessage() runs, so a service callback
+ * (a write callback or a data source read) can tell the time the request
+ * waited in the server from the time it spent on the network. The TCP layer
+ * and the dual-core pipeline set it; the stamp is 0 outside of a received
+ * message (timers, sampling). The clock is UA_ServerNetworkLayer_nowUs():
+ * microseconds of esp_timer on the ESP32, of the monotonic clock otherwise. */
+void UA_EXPORT
+UA_ServerNetworkLayer_setReceiveTime(UA_Int64 receivedUs);
+
+UA_Int64 UA_EXPORT
+UA_ServerNetworkLayer_getReceiveTime(void);
+
+UA_Int64 UA_EXPORT
+UA_ServerNetworkLayer_nowUs(void);
+
+/* Local extension: subscription retention (see README.md).
+ *
+ * A client that loses its connection leaves its Session behind until the
+ * session timeout. Without retention the Subscriptions are deleted with the
+ * Session, so after a reconnect the client creates them and every
+ * MonitoredItem again. With retention, a Session that times out leaves its
+ * Subscriptions detached: they keep sampling and queueing notifications for
+ * their lifetime (at most maxDetachedMs) and a new Session takes them over
+ * with TransferSubscriptions, including the notifications queued meanwhile.
+ *
+ * A detached Subscription keeps the sessionHandle of its last Session and
+ * passes it to allowTransferSubscription as the old session context. The
+ * AccessControl plugin must therefore keep session contexts valid after
+ * closeSession; the plugin in opcua_access_control/ uses one static identity
+ * per user. Without retention the old context is NULL as upstream. Detached
+ * Subscriptions whose lifetime ends are deleted at once (there is no Session
+ * to send the StatusChangeNotification to). The configuration is global; set
+ * it before UA_Server_run_startup(). */
+typedef struct {
+    UA_Boolean enabled;
+    UA_UInt32 maxDetachedMs;    /* Longest time a Subscription stays detached
+                                 * (0 = until the end of its lifetime) */
+} UA_SubscriptionRetentionConfig;
+
+typedef struct {
+    UA_UInt32 detached;         /* Detached Subscriptions now */
+    UA_UInt32 detachedTotal;    /* Subscriptions detached from a Session */
+    UA_UInt32 transferred;      /* Detached Subscriptions taken over by a Session */
+    UA_UInt32 expired;          /* Detached Subscriptions deleted unclaimed */
+    UA_UInt32 resumed;          /* ActivateSession of an activated Session on a
+                                 * new SecureChannel (nothing to recreate) */
+} UA_SubscriptionRetentionStatistics;
+
+void UA_EXPORT
+UA_Server_setSubscriptionRetention(const UA_SubscriptionRetentionConfig *config);
+
+void UA_EXPORT
+UA_Server_getSubscriptionRetentionStatistics(UA_SubscriptionRetentionStatistics *stats);
+
 /* Open a non-blocking client TCP socket. The connection might not be fully
  * opened yet. Drop into the _poll function withe a timeout to complete the
  * connection. */
@@ -50,6 +50,15 @@ UA_StatusCode UA_AccessControl_custom_init(UA_ServerConfig *config,
                                           UA_Boolean allowAnonymous,
                                           const UA_ByteString *userTokenPolicyUri);
 
+// Счётчики активаций сессий (читаются без блокировки, для /metrics)
+typedef struct {
+    UA_UInt32 activations;      // Успешные ActivateSession
+    UA_UInt32 known;            // Из них повторные входы известного пользователя (короткий путь)
+    UA_UInt32 denied;           // Отказы
+} UA_AccessControlCustomStatistics;
+
+void UA_AccessControl_custom_getStatistics(UA_AccessControlCustomStatistics *stats);
+
 #ifdef __cplusplus
 }
 #endif
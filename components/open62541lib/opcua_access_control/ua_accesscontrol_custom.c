@@ -4,6 +4,7 @@
 
 #include "ua_accesscontrol_custom.h"
 #include "../../../main/config.h"  /* Include your system config */
+#include <string.h>
 
 // Пробуем включить accesscontrol по разным путям
 #ifdef UA_ENABLE_ACCESS_CONTROL
@@ -43,10 +44,42 @@ typedef struct {
     UA_Boolean allowAnonymous;
 } AccessControlContext;
 
+/* Identity of a configured user, shared by all its sessions as the session
+ * context. The table is static: contexts stay valid after closeSession, so a
+ * detached subscription can still name its owner for TransferSubscriptions
+ * (UA_Server_setSubscriptionRetention). */
+typedef struct {
+    uint16_t rights;        /* Rights at the last login */
+    bool known;             /* Logged in successfully since boot */
+} SessionIdentity;
+
+#define IDENTITY_COUNT (sizeof(g_config.opcua_users) / sizeof(g_config.opcua_users[0]))
+
+static SessionIdentity identities[IDENTITY_COUNT];
+static bool anonymous_known;
+static UA_AccessControlCustomStatistics access_stats;
+
+/* Rights of an authenticated session */
+#define SESSION_RIGHTS(ctx) (((const SessionIdentity*)(ctx))->rights)
+
 /************************/
 /* Access Control Logic */
 /************************/
 
+static UA_StatusCode
+grant_anonymous(void) {
+    access_stats.activations++;
+    if(anonymous_known) {
+        access_stats.known++;
+        ESP_LOGD("OPCUA_AUTH", "Anonymous access GRANTED");
+        return UA_STATUSCODE_GOOD;
+    }
+    anonymous_known = true;
+    ESP_LOGI("OPCUA_AUTH", "Anonymous access GRANTED");
+    ESP_LOGI("OPCUA_AUTH", "=========================================");
+    return UA_STATUSCODE_GOOD;
+}
+
 static UA_StatusCode
 activateSession_custom(UA_Server *server, UA_AccessControl *ac,
                        const UA_EndpointDescription *endpointDescription,
@@ -58,34 +91,37 @@ activateSession_custom(UA_Server *server, UA_AccessControl *ac,
 
     /* ===== ИСПРАВЛЕНИЕ: Проверка отключенной авторизации ===== */
     if (!g_config.opcua_auth_enable) {
-        ESP_LOGI("OPCUA_AUTH", "=========================================");
-        ESP_LOGI("OPCUA_AUTH", "Authentication DISABLED - granting access to ALL");
-        ESP_LOGI("OPCUA_AUTH", "=========================================");
+        access_stats.activations++;
+        if (anonymous_known) {
+            access_stats.known++;
+        } else {
+            ESP_LOGI("OPCUA_AUTH", "=========================================");
+            ESP_LOGI("OPCUA_AUTH", "Authentication DISABLED - granting access to ALL");
+            ESP_LOGI("OPCUA_AUTH", "=========================================");
+            anonymous_known = true;
+        }
         *sessionContext = NULL; // Анонимная сессия
         return UA_STATUSCODE_GOOD;
     }
     /* ===== КОНЕЦ ИСПРАВЛЕНИЯ ===== */
 
-    /* Логирование - это разовое действие при подключении клиента */
-    ESP_LOGI("OPCUA_AUTH", "=========================================");
-    ESP_LOGI("OPCUA_AUTH", "Session activation attempt");
-    ESP_LOGI("OPCUA_AUTH", "System auth enabled: %s", g_config.opcua_auth_enable ? "YES" : "NO");
-    ESP_LOGI("OPCUA_AUTH", "Allow anonymous (config): %s", g_config.opcua_anonymous_enable ? "YES" : "NO");
-    ESP_LOGI("OPCUA_AUTH", "Allow anonymous (plugin): %s", context->allowAnonymous ? "YES" : "NO");
+    /* Переподключения идут пачками: подробный журнал только для первого входа
+     * пользователя после загрузки и для отказов, повторные входы - ESP_LOGD */
+    ESP_LOGD("OPCUA_AUTH", "Session activation attempt (anonymous: config %s, plugin %s)",
+             g_config.opcua_anonymous_enable ? "YES" : "NO", context->allowAnonymous ? "YES" : "NO");
 
     /* The empty token is interpreted as anonymous */
     if(userIdentityToken->encoding == UA_EXTENSIONOBJECT_ENCODED_NOBODY) {
-        ESP_LOGI("OPCUA_AUTH", "Anonymous access attempt (empty token)");
+        ESP_LOGD("OPCUA_AUTH", "Anonymous access attempt (empty token)");
         if(!context->allowAnonymous) {
             ESP_LOGW("OPCUA_AUTH", "Anonymous access DENIED - not allowed");
+            access_stats.denied++;
             return UA_STATUSCODE_BADIDENTITYTOKENINVALID;
         }
 
         /* No userdata for anonymous */
         *sessionContext = NULL;
-        ESP_LOGI("OPCUA_AUTH", "Anonymous access GRANTED");
-        ESP_LOGI("OPCUA_AUTH", "=========================================");
-        return UA_STATUSCODE_GOOD;
+        return grant_anonymous();
     }
 
     /* Could the token be decoded? */
@@ -96,11 +132,12 @@ activateSession_custom(UA_Server *server, UA_AccessControl *ac,
 
     /* Anonymous login token */
     if(userIdentityToken->content.decoded.type == &UA_TYPES[UA_TYPES_ANONYMOUSIDENTITYTOKEN]) {
-        ESP_LOGI("OPCUA_AUTH", "Anonymous access attempt (explicit token)");
+        ESP_LOGD("OPCUA_AUTH", "Anonymous access attempt (explicit token)");
         
         /* ===== ИСПРАВЛЕНИЕ: Используем новую переменную ===== */
         if(!context->allowAnonymous) {
             ESP_LOGW("OPCUA_AUTH", "Anonymous access DENIED - not allowed");
+            access_stats.denied++;
             return UA_STATUSCODE_BADIDENTITYTOKENINVALID;
         }
         /* ===== КОНЕЦ ИСПРАВЛЕНИЯ ===== */
@@ -111,14 +148,13 @@ activateSession_custom(UA_Server *server, UA_AccessControl *ac,
         /* Compatibility: empty policyId == ANONYMOUS_POLICY */
         if(token->policyId.data && !UA_String_equal(&token->policyId, &anonymous_policy)) {
             ESP_LOGW("OPCUA_AUTH", "Invalid policy ID for anonymous token");
+            access_stats.denied++;
             return UA_STATUSCODE_BADIDENTITYTOKENINVALID;
         }
 
         /* No userdata for anonymous */
         *sessionContext = NULL;
-        ESP_LOGI("OPCUA_AUTH", "Anonymous access GRANTED");
-        ESP_LOGI("OPCUA_AUTH", "=========================================");
-        return UA_STATUSCODE_GOOD;
+        return grant_anonymous();
     }
 
     /* Username and password token */
@@ -126,16 +162,18 @@ activateSession_custom(UA_Server *server, UA_AccessControl *ac,
         const UA_UserNameIdentityToken *userToken =
             (UA_UserNameIdentityToken*)userIdentityToken->content.decoded.data;
 
-        ESP_LOGI("OPCUA_AUTH", "Username/password access attempt");
+        ESP_LOGD("OPCUA_AUTH", "Username/password access attempt");
 
         if(!UA_String_equal(&userToken->policyId, &username_policy)) {
             ESP_LOGW("OPCUA_AUTH", "Invalid policy ID for username token");
+            access_stats.denied++;
             return UA_STATUSCODE_BADIDENTITYTOKENINVALID;
         }
 
         /* Empty username and password */
         if(userToken->userName.length == 0 && userToken->password.length == 0) {
             ESP_LOGW("OPCUA_AUTH", "Empty username and password");
+            access_stats.denied++;
             return UA_STATUSCODE_BADIDENTITYTOKENINVALID;
         }
 
@@ -149,32 +187,37 @@ activateSession_custom(UA_Server *server, UA_AccessControl *ac,
         if(userToken->password.length > 0 && userToken->password.length < sizeof(password))
             memcpy(password, userToken->password.data, userToken->password.length);
         
-        ESP_LOGI("OPCUA_AUTH", "User '%s' attempting login", username);
+        ESP_LOGD("OPCUA_AUTH", "User '%s' attempting login", username);
         
         /* Check authentication using your config system */
         opcua_user_t *user = config_find_opcua_user(username);
         if(!user || !user->enabled) {
             ESP_LOGW("OPCUA_AUTH", "User '%s' not found or disabled", username);
-            ESP_LOGI("OPCUA_AUTH", "=========================================");
+            access_stats.denied++;
             return UA_STATUSCODE_BADUSERACCESSDENIED;
         }
         
         if(!config_check_opcua_password(user, password)) {
             ESP_LOGW("OPCUA_AUTH", "Invalid password for user '%s'", username);
-            ESP_LOGI("OPCUA_AUTH", "=========================================");
+            access_stats.denied++;
             return UA_STATUSCODE_BADUSERACCESSDENIED;
         }
         
-        /* Store user rights in session context */
-        uint16_t *userRights = (uint16_t*)UA_malloc(sizeof(uint16_t));
-        if(!userRights) {
-            ESP_LOGE("OPCUA_AUTH", "Memory allocation failed for user rights");
-            return UA_STATUSCODE_BADOUTOFMEMORY;
+        /* The session context is the identity of the user: no allocation per
+         * session, and a reconnect of a known user skips the login banner */
+        SessionIdentity *identity = &identities[user - g_config.opcua_users];
+        bool known = identity->known && identity->rights == user->rights;
+        identity->rights = user->rights;
+        identity->known = true;
+        *sessionContext = identity;
+        access_stats.activations++;
+
+        if(known) {
+            access_stats.known++;
+            ESP_LOGD("OPCUA_AUTH", "User '%s' logged in again (known identity)", username);
+            return UA_STATUSCODE_GOOD;
         }
-        
-        *userRights = user->rights;
-        *sessionContext = userRights;
-        
+        ESP_LOGI("OPCUA_AUTH", "=========================================");
         ESP_LOGI("OPCUA_AUTH", "User '%s' logged in SUCCESSFULLY (rights: 0x%04X)", 
                  username, user->rights);
         ESP_LOGI("OPCUA_AUTH", "=========================================");
@@ -185,17 +228,15 @@ activateSession_custom(UA_Server *server, UA_AccessControl *ac,
     /* Unsupported token type */
     ESP_LOGW("OPCUA_AUTH", "Unsupported token type: %p", 
              userIdentityToken->content.decoded.type);
-    ESP_LOGI("OPCUA_AUTH", "=========================================");
+    access_stats.denied++;
     return UA_STATUSCODE_BADIDENTITYTOKENINVALID;
 }
 
 static void
 closeSession_custom(UA_Server *server, UA_AccessControl *ac,
                     const UA_NodeId *sessionId, void *sessionContext) {
-    if(sessionContext) {
-        ESP_LOGI("OPCUA_AUTH", "Closing session, freeing user context");
-        UA_free(sessionContext);
-    }
+    /* Identities are static and stay with detached subscriptions */
+    ESP_LOGD("OPCUA_AUTH", "Closing session");
 }
 
 static UA_UInt32
@@ -214,7 +255,7 @@ getUserRightsMask_custom(UA_Server *server, UA_AccessControl *ac,
     }
     
     /* Map your rights to OPC UA rights mask */
-    uint16_t rights = *(uint16_t*)sessionContext;
+    uint16_t rights = SESSION_RIGHTS(sessionContext);
     UA_UInt32 uaRights = 0;
     
     if((rights & OPCUA_RIGHT_BROWSE) || (rights & OPCUA_RIGHT_ADMIN))
@@ -246,7 +287,7 @@ getUserAccessLevel_custom(UA_Server *server, UA_AccessControl *ac,
         return UA_ACCESSLEVELMASK_BROWSE | UA_ACCESSLEVELMASK_READ;
     
     /* Map your rights to OPC UA access level */
-    uint16_t rights = *(uint16_t*)sessionContext;
+    uint16_t rights = SESSION_RIGHTS(sessionContext);
     UA_Byte accessLevel = 0;
     
     if((rights & OPCUA_RIGHT_BROWSE) || (rights & OPCUA_RIGHT_ADMIN))
@@ -275,8 +316,34 @@ getUserExecutable_custom(UA_Server *server, UA_AccessControl *ac,
         return false;
     
     /* Check if user has CALL right */
-    uint16_t rights = *(uint16_t*)sessionContext;
-    return ((rights & OPCUA_RIGHT_CALL) || (rights & OPCUA_RIGHT_ADMIN));
+    uint16_t rights = SESSION_RIGHTS(sessionContext);
+    if(rights & OPCUA_RIGHT_ADMIN)
+        return true;
+    if(!(rights & OPCUA_RIGHT_CALL))
+        return false;
+
+    /* Методы объекта Configuration (ns=1;s=config.*) меняют конфигурацию */
+    if(methodId && methodId->namespaceIndex == 1 &&
+       methodId->identifierType == UA_NODEIDTYPE_STRING &&
+       methodId->identifier.string.length > 7 &&
+       memcmp(methodId->identifier.string.data, "config.", 7) == 0)
+        return (rights & OPCUA_RIGHT_CONFIG) != 0;
+
+    /* Методы объекта Firmware (ns=1;s=firmware.*) меняют прошивку - только администратор */
+    if(methodId && methodId->namespaceIndex == 1 &&
+       methodId->identifierType == UA_NODEIDTYPE_STRING &&
+       methodId->identifier.string.length > 9 &&
+       memcmp(methodId->identifier.string.data, "firmware.", 9) == 0)
+        return false;
+
+    /* Самопроверка (ns=1;s=actuation.*) переключает выход - нужно право записи */
+    if(methodId && methodId->namespaceIndex == 1 &&
+       methodId->identifierType == UA_NODEIDTYPE_STRING &&
+       methodId->identifier.string.length > 10 &&
+       memcmp(methodId->identifier.string.data, "actuation.", 10) == 0)
+        return (rights & OPCUA_RIGHT_WRITE) != 0;
+
+    return true;
 }
 
 static UA_Boolean
@@ -306,7 +373,7 @@ allowAddNode_custom(UA_Server *server, UA_AccessControl *ac,
     if(!sessionContext)
         return false;
     
-    uint16_t rights = *(uint16_t*)sessionContext;
+    uint16_t rights = SESSION_RIGHTS(sessionContext);
     return ((rights & OPCUA_RIGHT_ADMIN) != 0);
 }
 
@@ -323,7 +390,7 @@ allowAddReference_custom(UA_Server *server, UA_AccessControl *ac,
     if(!sessionContext)
         return false;
     
-    uint16_t rights = *(uint16_t*)sessionContext;
+    uint16_t rights = SESSION_RIGHTS(sessionContext);
     return ((rights & OPCUA_RIGHT_ADMIN) != 0);
 }
 
@@ -340,7 +407,7 @@ allowDeleteNode_custom(UA_Server *server, UA_AccessControl *ac,
     if(!sessionContext)
         return false;
     
-    uint16_t rights = *(uint16_t*)sessionContext;
+    uint16_t rights = SESSION_RIGHTS(sessionContext);
     return ((rights & OPCUA_RIGHT_ADMIN) != 0);
 }
 
@@ -357,7 +424,7 @@ allowDeleteReference_custom(UA_Server *server, UA_AccessControl *ac,
     if(!sessionContext)
         return false;
     
-    uint16_t rights = *(uint16_t*)sessionContext;
+    uint16_t rights = SESSION_RIGHTS(sessionContext);
     return ((rights & OPCUA_RIGHT_ADMIN) != 0);
 }
 
@@ -375,6 +442,16 @@ allowBrowseNode_custom(UA_Server *server, UA_AccessControl *ac,
 }
 
 #ifdef UA_ENABLE_SUBSCRIPTIONS
+/* Index of the configured user a session context belongs to, -1 for an
+ * anonymous session (NULL) or a context that is not one of the identities */
+static int
+identity_index(const void *sessionContext) {
+    const SessionIdentity *identity = (const SessionIdentity*)sessionContext;
+    if(!identity || identity < identities || identity >= identities + IDENTITY_COUNT)
+        return -1;
+    return (int)(identity - identities);
+}
+
 static UA_Boolean
 allowTransferSubscription_custom(UA_Server *server, UA_AccessControl *ac,
                                  const UA_NodeId *oldSessionId, void *oldSessionContext,
@@ -384,17 +461,14 @@ allowTransferSubscription_custom(UA_Server *server, UA_AccessControl *ac,
         return true;
     /* ===== КОНЕЦ ИСПРАВЛЕНИЯ ===== */
     
-    /* Transfer only allowed for same user */
-    if(oldSessionContext == newSessionContext)
-        return true;
-    
-    if(oldSessionContext && newSessionContext) {
-        uint16_t oldRights = *(uint16_t*)oldSessionContext;
-        uint16_t newRights = *(uint16_t*)newSessionContext;
-        return (oldRights == newRights);
-    }
-    
-    return false;
+    /* Transfer only allowed for the same configured user (one identity per
+     * user, also for subscriptions detached from a closed session). Anonymous
+     * sessions have no identity, so their subscriptions cannot be taken over */
+    int oldUser = identity_index(oldSessionContext);
+    int newUser = identity_index(newSessionContext);
+    if(oldUser < 0 || newUser < 0)
+        return false;
+    return oldUser == newUser;
 }
 #endif
 
@@ -414,7 +488,7 @@ allowHistoryUpdateUpdateData_custom(UA_Server *server, UA_AccessControl *ac,
     if(!sessionContext)
         return false;
     
-    uint16_t rights = *(uint16_t*)sessionContext;
+    uint16_t rights = SESSION_RIGHTS(sessionContext);
     return ((rights & OPCUA_RIGHT_ADMIN) != 0);
 }
 
@@ -434,7 +508,7 @@ allowHistoryUpdateDeleteRawModified_custom(UA_Server *server, UA_AccessControl *
     if(!sessionContext)
         return false;
     
-    uint16_t rights = *(uint16_t*)sessionContext;
+    uint16_t rights = SESSION_RIGHTS(sessionContext);
     return ((rights & OPCUA_RIGHT_ADMIN) != 0);
 }
 #endif
@@ -457,6 +531,11 @@ static void clear_custom(UA_AccessControl *ac) {
     }
 }
 
+void UA_AccessControl_custom_getStatistics(UA_AccessControlCustomStatistics *stats) {
+    if(stats)
+        *stats = access_stats;
+}
+
 UA_AccessControl* UA_AccessControl_custom(const UA_AccessControlConfig *config) {
     (void)config;
     return NULL;
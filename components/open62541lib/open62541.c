@@ -5556,6 +5556,11 @@ typedef struct {
     UA_SOCKET mdnsSocket;
     UA_Boolean mdnsMainSrvAdded;
 
+    /* Event-driven daemon (see README.md): timer callback that runs the
+     * output side, and whether a network layer waits on mdnsSocket */
+    UA_UInt64 mdnsCallbackId;
+    UA_Boolean mdnsSocketWatched;
+
     /* Full Domain Name of server itself. Used to detect if received mDNS message was from itself */
     UA_String selfFqdnMdnsRecord;
 
@@ -5623,6 +5628,18 @@ UA_StatusCode
 iterateMulticastDiscoveryServer(UA_Server* server, UA_DateTime *nextRepeat,
                                 UA_Boolean processIn);
 
+/* Local extension: event-driven multicast discovery. A network layer adds the
+ * socket returned by UA_Discovery_multicastSocket() to its wait set and calls
+ * UA_Discovery_multicastReceive() when it is readable. Announcements, probes
+ * and retries run from a server timer callback that follows the daemon's next
+ * deadline. Returns UA_INVALID_SOCKET when multicast discovery is not
+ * running. */
+UA_SOCKET
+UA_Discovery_multicastSocket(UA_Server *server);
+
+void
+UA_Discovery_multicastReceive(UA_Server *server);
+
 typedef enum {
     UA_DISCOVERY_TCP,     /* OPC UA TCP mapping */
     UA_DISCOVERY_TLS     /* OPC UA HTTPS mapping */
@@ -5762,6 +5779,11 @@ void
 UA_Session_detachSubscription(UA_Server *server, UA_Session *session,
                               UA_Subscription *sub);
 
+/* Detach a Subscription that outlives its Session (subscription retention) */
+void
+UA_Session_retainSubscription(UA_Server *server, UA_Session *session,
+                              UA_Subscription *sub);
+
 UA_Subscription *
 UA_Session_getSubscriptionById(UA_Session *session,
                                UA_UInt32 subscriptionId);
@@ -6112,6 +6134,10 @@ struct UA_Subscription {
     UA_Session *session; /* May be NULL if no session is attached. */
     UA_UInt32 subscriptionId;
 
+    /* Subscription retention. Only set while detached. */
+    void *ownerHandle;      /* sessionHandle of the last Session */
+    UA_DateTime detachedAt; /* Monotonic time of the detach */
+
     /* Settings */
     UA_UInt32 lifeTimeCount;
     UA_UInt32 maxKeepAliveCount;
@@ -13743,6 +13769,31 @@ DECODE_BINARY(Variant) {
 }
 
 /* DataValue */
+
+/* Local extension: pre-encoded DataValue content (see README.md) */
+static UA_DataValueEncodingLookup dataValueEncodingLookup = NULL;
+
+void
+UA_DataValue_setEncodingLookup(UA_DataValueEncodingLookup lookup) {
+    dataValueEncodingLookup = lookup;
+}
+
+/* Copy the pre-encoded variant and source timestamp if the lookup has them
+ * and they fit into the current buffer */
+static UA_Boolean
+DataValue_copyPreEncoded(const UA_DataValue *src, Ctx *ctx) {
+    if(!dataValueEncodingLookup || !src->hasValue || src->hasStatus ||
+       src->hasSourcePicoseconds ||
+       src->value.storageType != UA_VARIANT_DATA_NODELETE)
+        return false;
+    const UA_ByteString *encoded = dataValueEncodingLookup(src);
+    if(!encoded || encoded->length > (size_t)(ctx->end - ctx->pos))
+        return false;
+    memcpy(ctx->pos, encoded->data, encoded->length);
+    ctx->pos += encoded->length;
+    return true;
+}
+
 ENCODE_BINARY(DataValue) {
     /* Set up the encoding mask */
     u8 encodingMask = src->hasValue;
@@ -13757,17 +13808,19 @@ ENCODE_BINARY(DataValue) {
     if(ret != UA_STATUSCODE_GOOD)
         return ret;
 
-    /* Encode the variant. */
-    if(src->hasValue) {
-        ret = ENCODE_DIRECT(&src->value, Variant);
-        if(ret != UA_STATUSCODE_GOOD)
-            return ret;
-    }
+    if(!DataValue_copyPreEncoded(src, ctx)) {
+        /* Encode the variant. */
+        if(src->hasValue) {
+            ret = ENCODE_DIRECT(&src->value, Variant);
+            if(ret != UA_STATUSCODE_GOOD)
+                return ret;
+        }
 
-    if(src->hasStatus)
-        ret |= encodeWithExchangeBuffer(&src->status, &UA_TYPES[UA_TYPES_STATUSCODE], ctx);
-    if(src->hasSourceTimestamp)
-        ret |= encodeWithExchangeBuffer(&src->sourceTimestamp, &UA_TYPES[UA_TYPES_DATETIME], ctx);
+        if(src->hasStatus)
+            ret |= encodeWithExchangeBuffer(&src->status, &UA_TYPES[UA_TYPES_STATUSCODE], ctx);
+        if(src->hasSourceTimestamp)
+            ret |= encodeWithExchangeBuffer(&src->sourceTimestamp, &UA_TYPES[UA_TYPES_DATETIME], ctx);
+    }
     if(src->hasSourcePicoseconds)
         ret |= encodeWithExchangeBuffer(&src->sourcePicoseconds, &UA_TYPES[UA_TYPES_UINT16], ctx);
     if(src->hasServerTimestamp)
@@ -25736,6 +25789,27 @@ void UA_Session_updateLifetime(UA_Session *session) {
         (UA_DateTime)(session->timeout * UA_DATETIME_MSEC);
 }
 
+/****************************/
+/* Subscription retention   */
+/****************************/
+
+static UA_SubscriptionRetentionConfig retentionConfig;
+static UA_SubscriptionRetentionStatistics retentionStats;
+
+void
+UA_Server_setSubscriptionRetention(const UA_SubscriptionRetentionConfig *config) {
+    if(config)
+        retentionConfig = *config;
+    else
+        memset(&retentionConfig, 0, sizeof(retentionConfig));
+}
+
+void
+UA_Server_getSubscriptionRetentionStatistics(UA_SubscriptionRetentionStatistics *stats) {
+    if(stats)
+        *stats = retentionStats;
+}
+
 #ifdef UA_ENABLE_SUBSCRIPTIONS
 
 void
@@ -25779,6 +25853,19 @@ UA_Session_detachSubscription(UA_Server *server, UA_Session *session, UA_Subscri
     }
 }
 
+void
+UA_Session_retainSubscription(UA_Server *server, UA_Session *session, UA_Subscription *sub) {
+    /* With retention, remember the owner for the TransferSubscriptions access
+     * check */
+    if(retentionConfig.enabled) {
+        sub->ownerHandle = session->sessionHandle;
+        sub->detachedAt = UA_DateTime_nowMonotonic();
+        retentionStats.detached++;
+        retentionStats.detachedTotal++;
+    }
+    UA_Session_detachSubscription(server, session, sub);
+}
+
 void
 UA_Server_addSubscription(UA_Server *server, UA_Subscription *sub) {
     /* Assign the id */
@@ -25798,6 +25885,8 @@ UA_Server_deleteSubscription(UA_Server *server, UA_Subscription *sub) {
     /* Detach from the session if necessary */
     if(sub->session)
         UA_Session_detachSubscription(server, sub->session, sub);
+    else if(sub->detachedAt != 0)
+        retentionStats.detached--;
 
     /* Remove from the server */
     LIST_REMOVE(sub, serverListEntry);
@@ -27276,18 +27365,14 @@ UA_Server_run_iterate(UA_Server *server, UA_Boolean waitInternal) {
 
     
 
-#if defined(UA_ENABLE_DISCOVERY_MULTICAST) && (UA_MULTITHREADING < 200)
-    if(server->config.mdnsEnabled) {
-        /* TODO multicastNextRepeat does not consider new input data (requests)
-         * on the socket. It will be handled on the next call. if needed, we
-         * need to use select with timeout on the multicast socket
-         * server->mdnsSocket (see example in mdnsd library) on higher level. */
-        UA_DateTime multicastNextRepeat = 0;
-        UA_StatusCode hasNext =
-            iterateMulticastDiscoveryServer(server, &multicastNextRepeat, true);
-        if(hasNext == UA_STATUSCODE_GOOD && multicastNextRepeat < nextRepeated)
-            nextRepeated = multicastNextRepeat;
-    }
+#if defined(UA_ENABLE_DISCOVERY) && defined(UA_ENABLE_DISCOVERY_MULTICAST) && \
+    (UA_MULTITHREADING < 200)
+    /* Local extension: the TCP network layer waits on the mDNS socket and the
+     * output side runs from the timer. Only when no network layer has the
+     * socket in its wait set is it polled here, as before. */
+    if(server->config.mdnsEnabled && server->discoveryManager.mdnsCallbackId != 0 &&
+       !server->discoveryManager.mdnsSocketWatched)
+        UA_Discovery_multicastReceive(server);
 #endif
 
     
@@ -39452,10 +39537,18 @@ UA_Server_removeSession(UA_Server *server, session_list_entry *sentry,
 
     
 
-    /* Remove the Subscriptions */
+    /* Remove the Subscriptions. With retention, the Subscriptions of a Session
+     * that timed out (the client is gone without closing it) stay detached
+     * for a TransferSubscriptions after the reconnect. */
 #ifdef UA_ENABLE_SUBSCRIPTIONS
     UA_Subscription *sub, *tempsub;
     TAILQ_FOREACH_SAFE(sub, &session->subscriptions, sessionListEntry, tempsub) {
+        if(retentionConfig.enabled && event == UA_DIAGNOSTICEVENT_TIMEOUT) {
+            UA_LOG_INFO_SUBSCRIPTION(&server->config.logger, sub,
+                                     "Session timed out, keeping the Subscription detached");
+            UA_Session_retainSubscription(server, session, sub);
+            continue;
+        }
         UA_Server_deleteSubscription(server, sub);
     }
 
@@ -40113,6 +40206,19 @@ Service_ActivateSession(UA_Server *server, UA_SecureChannel *channel,
      * channel than it is attached to. */
     if(!session->header.channel || session->header.channel != channel) {
         /* Attach the new SecureChannel, the old channel will be detached if present */
+        if(session->activated) {
+            retentionStats.resumed++;
+#ifdef UA_ENABLE_SUBSCRIPTIONS
+            /* Publish requests of the previous channel would be answered on
+             * the new one with request ids the client no longer waits for,
+             * taking the pending notifications with them */
+            UA_PublishResponseEntry *entry;
+            while((entry = UA_Session_dequeuePublishReq(session))) {
+                UA_PublishResponse_clear(&entry->response);
+                UA_free(entry);
+            }
+#endif
+        }
         UA_Session_attachToSecureChannel(session, channel);
         UA_LOG_INFO_SESSION(&server->config.logger, session,
                             "ActivateSession: Session attached to new channel");
@@ -40180,7 +40286,7 @@ Service_CloseSession(UA_Server *server, UA_SecureChannel *channel,
         TAILQ_FOREACH_SAFE(sub, &session->subscriptions, sessionListEntry, sub_tmp) {
             UA_LOG_INFO_SUBSCRIPTION(&server->config.logger, sub,
                                      "Detaching the Subscription from the Session");
-            UA_Session_detachSubscription(server, session, sub);
+            UA_Session_retainSubscription(server, session, sub);
         }
     }
 #endif
@@ -40355,8 +40461,14 @@ readValueAttributeFromDataSource(UA_Server *server, UA_Session *session,
              session ? session->sessionHandle : NULL,
              &vn->head.nodeId, vn->head.context,
              sourceTimeStamp, rangeptr, &v2);
-    
-    if(v2.hasValue && v2.value.storageType == UA_VARIANT_DATA_NODELETE) {
+
+    /* Local extension: a value of the pre-encoded value cache (see README.md)
+     * stays valid until the response of the current message is encoded, so
+     * it is passed through for client sessions (Read service, sampling). The
+     * caller's UA_DataValue_clear() does not free it. Local reads through the
+     * admin session get an owned copy. */
+    if(v2.hasValue && v2.value.storageType == UA_VARIANT_DATA_NODELETE &&
+       (!session || session == &server->adminSession)) {
         retval = UA_DataValue_copy(&v2, v);
         UA_DataValue_clear(&v2);
     } else {
@@ -43228,7 +43340,7 @@ Operation_TransferSubscription(UA_Server *server, UA_Session *session,
        !server->config.accessControl.
        allowTransferSubscription(server, &server->config.accessControl,
                                  oldSession ? &oldSession->sessionId : NULL,
-                                 oldSession ? oldSession->sessionHandle : NULL,
+                                 oldSession ? oldSession->sessionHandle : sub->ownerHandle,
                                  &session->sessionId, session->sessionHandle)) {
         result->statusCode = UA_STATUSCODE_BADUSERACCESSDENIED;
         return;
@@ -43263,6 +43375,15 @@ Operation_TransferSubscription(UA_Server *server, UA_Session *session,
      * that all backpointers are set correctly. */
     memcpy(newSub, sub, sizeof(UA_Subscription));
 
+    /* The copy gets its own publish callback, is attached and has just heard
+     * from its client */
+    newSub->publishCallbackId = 0;
+    newSub->ownerHandle = NULL;
+    newSub->detachedAt = 0;
+    newSub->currentLifetimeCount = 0;
+    if(!oldSession)
+        retentionStats.transferred++;
+
     /* Move over the MonitoredItems */
     LIST_INIT(&newSub->monitoredItems);
     UA_MonitoredItem *mon, *mon_tmp;
@@ -43275,8 +43396,8 @@ Operation_TransferSubscription(UA_Server *server, UA_Session *session,
 
     /* Move over the notification queue */
     TAILQ_INIT(&newSub->notificationQueue);
-    UA_Notification *nn;
-    TAILQ_FOREACH(nn, &sub->notificationQueue, globalEntry) {
+    UA_Notification *nn, *nn_tmp;
+    TAILQ_FOREACH_SAFE(nn, &sub->notificationQueue, globalEntry, nn_tmp) {
         TAILQ_REMOVE(&sub->notificationQueue, nn, globalEntry);
         TAILQ_INSERT_TAIL(&newSub->notificationQueue, nn, globalEntry);
     }
@@ -47117,6 +47238,12 @@ multicastListenStop(UA_Server* server) {
 
 # endif /* UA_MULTITHREADING */
 
+static void
+multicastTimerCallback(UA_Server *server, void *data);
+
+static void
+multicastKick(UA_Server *server);
+
 static UA_StatusCode
 addMdnsRecordForNetworkLayer(UA_Server *server, const UA_String *appName,
                              const UA_ServerNetworkLayer* nl) {
@@ -47156,6 +47283,13 @@ void startMulticastDiscoveryServer(UA_Server *server) {
 
 #if UA_MULTITHREADING >= 200
     multicastListenStart(server);
+# else
+    /* Local extension: the first run sends the records queued above */
+    if(server->discoveryManager.mdnsSocket != UA_INVALID_SOCKET)
+        UA_Timer_addRepeatedCallback(&server->timer,
+                                     (UA_ApplicationCallback)multicastTimerCallback,
+                                     server, NULL, 1.0,
+                                     &server->discoveryManager.mdnsCallbackId);
 # endif
 }
 
@@ -47184,6 +47318,10 @@ stopMulticastDiscoveryServer(UA_Server *server) {
 #if UA_MULTITHREADING >= 200
     multicastListenStop(server);
 # else
+    if(server->discoveryManager.mdnsCallbackId != 0) {
+        UA_Timer_removeCallback(&server->timer, server->discoveryManager.mdnsCallbackId);
+        server->discoveryManager.mdnsCallbackId = 0;
+    }
     // send out last package with TTL = 0
     iterateMulticastDiscoveryServer(server, NULL, false);
 # endif
@@ -47423,6 +47561,7 @@ UA_StatusCode
 UA_Discovery_multicastQuery(UA_Server* server) {
     mdnsd_query(server->discoveryManager.mdnsDaemon, "_opcua-tcp._tcp.local.",
                 QTYPE_PTR,discovery_multicastQueryAnswer, server);
+    multicastKick(server);
     return UA_STATUSCODE_GOOD;
 }
 
@@ -47558,6 +47697,7 @@ UA_Discovery_addRecord(UA_Server *server, const UA_String *servername,
                         capabilitiesSize, UA_Discovery_multicastConflict);
     }
 
+    multicastKick(server);
     return UA_STATUSCODE_GOOD;
 }
 
@@ -47623,6 +47763,7 @@ UA_Discovery_removeRecord(UA_Server *server, const UA_String *servername,
         r2 = next;
     }
 
+    multicastKick(server);
     return UA_STATUSCODE_GOOD;
 }
 
@@ -47645,13 +47786,60 @@ iterateMulticastDiscoveryServer(UA_Server* server, UA_DateTime *nextRepeat,
         return UA_STATUSCODE_BADNOCOMMUNICATION;
     }
 
+    /* Local extension: monotonic deadline for multicastStep() */
     if(nextRepeat)
-        *nextRepeat = UA_DateTime_now() +
+        *nextRepeat = UA_DateTime_nowMonotonic() +
             (UA_DateTime)((next_sleep.tv_sec * UA_DATETIME_SEC) +
                           (next_sleep.tv_usec * UA_DATETIME_USEC));
     return UA_STATUSCODE_GOOD;
 }
 
+/* Run the daemon and move the timer callback to its next deadline */
+static void
+multicastStep(UA_Server *server, UA_Boolean processIn) {
+    UA_DiscoveryManager *dm = &server->discoveryManager;
+    UA_DateTime nextRepeat = 0;
+    if(iterateMulticastDiscoveryServer(server, &nextRepeat, processIn) != UA_STATUSCODE_GOOD ||
+       dm->mdnsCallbackId == 0)
+        return;
+
+    /* Nothing due now: at least 1 ms, so the timer does not run it again in
+     * the same pass. Monotonic, so a clock step or slew of the wall clock
+     * does not move the deadline */
+    UA_Double interval_ms = (UA_Double)(nextRepeat - UA_DateTime_nowMonotonic()) / UA_DATETIME_MSEC;
+    if(interval_ms < 1.0)
+        interval_ms = 1.0;
+    UA_Timer_changeRepeatedCallbackInterval(&server->timer, dm->mdnsCallbackId, interval_ms);
+}
+
+static void
+multicastTimerCallback(UA_Server *server, void *data) {
+    multicastStep(server, false);
+}
+
+/* New output queued outside the daemon (records, queries): send it on the
+ * next server iteration instead of at the old deadline */
+static void
+multicastKick(UA_Server *server) {
+    if(server->discoveryManager.mdnsCallbackId != 0)
+        UA_Timer_changeRepeatedCallbackInterval(&server->timer,
+                                                server->discoveryManager.mdnsCallbackId, 1.0);
+}
+
+UA_SOCKET
+UA_Discovery_multicastSocket(UA_Server *server) {
+    UA_DiscoveryManager *dm = &server->discoveryManager;
+    if(!server->config.mdnsEnabled || dm->mdnsCallbackId == 0)
+        return UA_INVALID_SOCKET;
+    dm->mdnsSocketWatched = true;
+    return dm->mdnsSocket;
+}
+
+void
+UA_Discovery_multicastReceive(UA_Server *server) {
+    multicastStep(server, true);
+}
+
 #endif /* defined(UA_ENABLE_DISCOVERY) && defined(UA_ENABLE_DISCOVERY_MULTICAST) */
 
 /*********************************** amalgamated original file "/home/cmb/Workspace/open62541/src/client/ua_client.c" ***********************************/
@@ -60708,6 +60896,8 @@ UA_DiscoveryManager_init(UA_DiscoveryManager *dm, UA_Server *server) {
     dm->mdnsDaemon = NULL;
     dm->mdnsSocket = UA_INVALID_SOCKET;
     dm->mdnsMainSrvAdded = false;
+    dm->mdnsCallbackId = 0;
+    dm->mdnsSocketWatched = false;
     if(server->config.mdnsEnabled)
         initMulticastDiscoveryServer(dm, server);
 
@@ -61111,7 +61301,10 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
         UA_LOG_DEBUG_SUBSCRIPTION(&server->config.logger, sub, "The publish queue is empty");
         ++sub->currentLifetimeCount;
 
-        if(sub->currentLifetimeCount > sub->lifeTimeCount) {
+        if(sub->currentLifetimeCount > sub->lifeTimeCount ||
+           (!sub->session && sub->detachedAt != 0 && retentionConfig.maxDetachedMs != 0 &&
+            UA_DateTime_nowMonotonic() - sub->detachedAt >
+            (UA_DateTime)retentionConfig.maxDetachedMs * UA_DATETIME_MSEC)) {
             UA_LOG_WARNING_SUBSCRIPTION(&server->config.logger, sub, "End of subscription lifetime");
             /* Set the StatusChange to delete the subscription. */
             sub->statusChange = UA_STATUSCODE_BADTIMEOUT;
@@ -61123,6 +61316,15 @@ UA_Subscription_publish(UA_Server *server, UA_Subscription *sub) {
 
     /* Send a StatusChange Notification and delete the Subscription. */
     if(sub->statusChange != UA_STATUSCODE_GOOD) {
+        /* A detached Subscription has no Session to notify (transferred or
+         * end of its lifetime). Delete it right away. */
+        if(!sub->session) {
+            if(sub->statusChange == UA_STATUSCODE_BADTIMEOUT && sub->detachedAt != 0)
+                retentionStats.expired++;
+            UA_Server_deleteSubscription(server, sub);
+            return;
+        }
+
         /* Cannot send out the StatusChange. Keep the "shell" of the
          * subscription to answer with a StatusChangeNotification when a Publish
          * Request is available. */
@@ -62213,6 +62415,14 @@ sampleCallbackWithValue(UA_Server *server, UA_Session *session,
     UA_ByteString_clear(&mon->lastSampledValue);
     mon->lastSampledValue = binValueEncoding;
 
+    /* Local extension: a value pointing into the pre-encoded value cache is
+     * only valid for the current sample. Keep an owned copy. */
+    if(value->hasValue && value->value.storageType == UA_VARIANT_DATA_NODELETE) {
+        UA_Variant owned;
+        if(UA_Variant_copy(&value->value, &owned) == UA_STATUSCODE_GOOD)
+            value->value = owned;
+    }
+
     /* Move/store the value for filter comparison and TransferSubscription */
     UA_DataValue_clear(&mon->lastValue);
     mon->lastValue = *value;
@@ -74394,9 +74604,17 @@ int esp_getaddrinfo(const char *nodename, const char *servername,
 
 #define UA_ARCHITECTURE_FREERTOSLWIP_POSIX_CLOCK
 
+static UA_DateTimeSource UA_dateTimeSource = NULL;
+
+void UA_DateTime_setSource(UA_DateTimeSource source) {
+    UA_dateTimeSource = source;
+}
+
 #ifdef UA_ARCHITECTURE_FREERTOSLWIP_POSIX_CLOCK
 
 UA_DateTime UA_DateTime_now(void) {
+    if(UA_dateTimeSource)
+        return UA_dateTimeSource();
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return (tv.tv_sec * UA_DATETIME_SEC) + (tv.tv_usec * UA_DATETIME_USEC) + UA_DATETIME_UNIX_EPOCH;
@@ -74406,6 +74624,8 @@ UA_DateTime UA_DateTime_now(void) {
 
 /* The current time in UTC time */
 UA_DateTime UA_DateTime_now(void) {
+  if(UA_dateTimeSource)
+    return UA_dateTimeSource();
   UA_DateTime microSeconds = ((UA_DateTime)xTaskGetTickCount()) * (1000000 / configTICK_RATE_HZ);
   return ((microSeconds / 1000000) * UA_DATETIME_SEC) + ((microSeconds % 1000000) * UA_DATETIME_USEC) + UA_DATETIME_UNIX_EPOCH;
 }
@@ -74637,9 +74857,31 @@ connection_recv(UA_Connection *connection, UA_ByteString *response,
 #define NOHELLOTIMEOUT 120000 /* timeout in ms before close the connection
                                * if server does not receive Hello Message */
 
+/* Chunk waiting in the queue of a connection (request scheduling) */
+typedef struct {
+    UA_ByteString chunk;
+    UA_Int64 receivedUs;
+    UA_Byte lane;
+} QueuedChunk;
+
 typedef struct ConnectionEntry {
     UA_Connection connection;
     LIST_ENTRY(ConnectionEntry) pointers;
+
+    /* Request scheduling, queue is NULL if the connection is not scheduled */
+    QueuedChunk *queue;
+    UA_UInt16 queueSize;
+    UA_UInt16 queueHead;
+    UA_UInt16 queueCount;
+    UA_ByteString pending;  /* Received bytes not queued yet */
+    UA_Int64 tokens;        /* Rate limit bucket in 1/1000 chunks */
+    UA_Int64 tokensUpdatedUs;
+
+    /* Coalesced sending, txChunks is NULL if the connection sends directly */
+    UA_ByteString *txChunks;
+    UA_UInt16 txCount;
+    size_t txBytes;
+    UA_Boolean txUrgent;    /* Holds the response to a priority lane chunk */
 } ConnectionEntry;
 
 typedef struct {
@@ -74650,10 +74892,525 @@ typedef struct {
     UA_UInt16 serverSocketsSize;
     LIST_HEAD(, ConnectionEntry) connections;
     UA_UInt16 connectionsSize;
+    UA_ByteString scratch;  /* Receive buffer of the scheduled connections */
 } ServerNetworkLayerTCP;
 
+/****************************/
+/* Request scheduling       */
+/****************************/
+
+/* The monotonic clock of the architecture counts FreeRTOS ticks (10 ms at
+ * 100 Hz), too coarse for request latencies */
+#ifdef ESP_PLATFORM
+# include "esp_timer.h"
+# define SCHEDULER_NOW_US() ((UA_Int64)esp_timer_get_time())
+#else
+# define SCHEDULER_NOW_US() (UA_DateTime_nowMonotonic() / UA_DATETIME_USEC)
+#endif
+
+#define SCHEDULER_DEFAULT_QUEUE 8
+#define SCHEDULER_CHUNK_HEADER  8  /* messageType(3) + chunkType(1) + messageSize(4) */
+#define SCHEDULER_MSG_BODY      24 /* + channelId, tokenId, sequenceNumber, requestId */
+
+static UA_TcpSchedulerConfig schedulerConfig;
+static UA_TcpSchedulerStatistics schedulerStats;
+static UA_UInt32 schedulerSumRestUs[UA_TCPSCHEDULER_LANES]; /* Not yet in latencySumMs */
+static const UA_UInt32 schedulerBucketBounds[UA_TCPSCHEDULER_BUCKETS - 1] =
+    UA_TCPSCHEDULER_BUCKET_BOUNDS_US;
+
+void
+UA_ServerNetworkLayerTCP_setScheduler(const UA_TcpSchedulerConfig *config) {
+    if(config)
+        schedulerConfig = *config;
+    else
+        memset(&schedulerConfig, 0, sizeof(schedulerConfig));
+}
+
+void
+UA_ServerNetworkLayerTCP_getSchedulerStatistics(UA_TcpSchedulerStatistics *stats) {
+    if(stats)
+        *stats = schedulerStats;
+}
+
+/* Receive time of the message being processed, 0 outside of one */
+static UA_Int64 receiveTimeUs;
+
+void
+UA_ServerNetworkLayer_setReceiveTime(UA_Int64 receivedUs) {
+    receiveTimeUs = receivedUs;
+}
+
+UA_Int64
+UA_ServerNetworkLayer_getReceiveTime(void) {
+    return receiveTimeUs;
+}
+
+UA_Int64
+UA_ServerNetworkLayer_nowUs(void) {
+    return SCHEDULER_NOW_US();
+}
+
+static UA_Boolean
+scheduler_isPriorityWrite(const UA_WriteRequest *req) {
+    for(size_t i = 0; i < req->nodesToWriteSize; i++) {
+        if(schedulerConfig.isPriorityNode(&req->nodesToWrite[i].nodeId))
+            return true;
+    }
+    return false;
+}
+
+static UA_Boolean
+scheduler_isPriorityCall(const UA_CallRequest *req) {
+    for(size_t i = 0; i < req->methodsToCallSize; i++) {
+        if(schedulerConfig.isPriorityNode(&req->methodsToCall[i].objectId) ||
+           schedulerConfig.isPriorityNode(&req->methodsToCall[i].methodId))
+            return true;
+    }
+    return false;
+}
+
+/* Only a final MSG chunk carries a complete request. With SecurityPolicy#None
+ * the request follows the symmetric security header and the sequence header
+ * in plain text; anything that does not decode goes to the normal lane. */
+static UA_Byte
+scheduler_classify(const UA_ByteString *chunk) {
+    if(chunk->length <= SCHEDULER_MSG_BODY || memcmp(chunk->data, "MSGF", 4) != 0)
+        return UA_TCPSCHEDULERLANE_NORMAL;
+
+    size_t offset = SCHEDULER_MSG_BODY;
+    UA_NodeId typeId;
+    if(UA_decodeBinary(chunk, &offset, &typeId, &UA_TYPES[UA_TYPES_NODEID], NULL) !=
+       UA_STATUSCODE_GOOD)
+        return UA_TCPSCHEDULERLANE_NORMAL;
+    const UA_DataType *type = NULL;
+    if(UA_NodeId_equal(&typeId, &UA_TYPES[UA_TYPES_WRITEREQUEST].binaryEncodingId))
+        type = &UA_TYPES[UA_TYPES_WRITEREQUEST];
+    else if(UA_NodeId_equal(&typeId, &UA_TYPES[UA_TYPES_CALLREQUEST].binaryEncodingId))
+        type = &UA_TYPES[UA_TYPES_CALLREQUEST];
+    UA_NodeId_clear(&typeId);
+    if(!type)
+        return UA_TCPSCHEDULERLANE_NORMAL;
+    if(!schedulerConfig.isPriorityNode)
+        return UA_TCPSCHEDULERLANE_PRIORITY;
+
+    /* Decode the request to look at its targets. Only Write and Call pay for
+     * this, and both are small. */
+    union {
+        UA_WriteRequest write;
+        UA_CallRequest call;
+    } req;
+    UA_Boolean priority = false;
+    if(UA_decodeBinary(chunk, &offset, &req, type, NULL) == UA_STATUSCODE_GOOD) {
+        if(type == &UA_TYPES[UA_TYPES_WRITEREQUEST])
+            priority = scheduler_isPriorityWrite(&req.write);
+        else
+            priority = scheduler_isPriorityCall(&req.call);
+        UA_clear(&req, type);
+    }
+    return priority ? UA_TCPSCHEDULERLANE_PRIORITY : UA_TCPSCHEDULERLANE_NORMAL;
+}
+
+/* Length of the complete chunk at the start of data, 0 if it is incomplete. A
+ * malformed header returns everything, the server rejects it and closes the
+ * connection. */
+static size_t
+scheduler_chunkLength(const UA_Byte *data, size_t length, size_t maxSize) {
+    if(length < SCHEDULER_CHUNK_HEADER)
+        return 0;
+    size_t size = (size_t)data[4] | ((size_t)data[5] << 8) |
+        ((size_t)data[6] << 16) | ((size_t)data[7] << 24);
+    if(size < SCHEDULER_CHUNK_HEADER || size > maxSize)
+        return length;
+    return size <= length ? size : 0;
+}
+
+/* A connection is read only if its queue has room and no complete chunk is
+ * left over from the last read */
+static UA_Boolean
+scheduler_canRead(const ServerNetworkLayerTCP *layer, const ConnectionEntry *e) {
+    return e->queueCount < e->queueSize &&
+        scheduler_chunkLength(e->pending.data, e->pending.length,
+                              layer->scratch.length) == 0;
+}
+
+static UA_StatusCode
+scheduler_enqueue(ConnectionEntry *e, const UA_Byte *data, size_t length,
+                  UA_Int64 receivedUs) {
+    QueuedChunk *q = &e->queue[(e->queueHead + e->queueCount) % e->queueSize];
+    UA_StatusCode res = UA_ByteString_allocBuffer(&q->chunk, length);
+    if(res != UA_STATUSCODE_GOOD)
+        return res;
+    memcpy(q->chunk.data, data, length);
+    q->receivedUs = receivedUs;
+    q->lane = scheduler_classify(&q->chunk);
+    e->queueCount++;
+
+    UA_TcpSchedulerLaneStatistics *ls = &schedulerStats.lanes[q->lane];
+    ls->queued++;
+    if(ls->queued > ls->maxQueued)
+        ls->maxQueued = ls->queued;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Queue the complete chunks at the start of data while there is room and keep
+ * the rest as pending bytes. data may point into the pending bytes. */
+static UA_StatusCode
+scheduler_split(const ServerNetworkLayerTCP *layer, ConnectionEntry *e,
+                const UA_Byte *data, size_t length, UA_Int64 receivedUs) {
+    size_t done = 0;
+    while(e->queueCount < e->queueSize) {
+        size_t size = scheduler_chunkLength(data + done, length - done,
+                                            layer->scratch.length);
+        if(size == 0)
+            break;
+        UA_StatusCode res = scheduler_enqueue(e, data + done, size, receivedUs);
+        if(res != UA_STATUSCODE_GOOD)
+            return res;
+        done += size;
+    }
+    if(done == 0 && data == e->pending.data)
+        return UA_STATUSCODE_GOOD;
+
+    UA_ByteString rest = UA_BYTESTRING_NULL;
+    if(done < length) {
+        UA_StatusCode res = UA_ByteString_allocBuffer(&rest, length - done);
+        if(res != UA_STATUSCODE_GOOD)
+            return res;
+        memcpy(rest.data, data + done, length - done);
+    }
+    UA_ByteString_clear(&e->pending);
+    e->pending = rest;
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Receive behind the pending bytes and queue the complete chunks */
+static UA_StatusCode
+scheduler_recv(ServerNetworkLayerTCP *layer, ConnectionEntry *e) {
+    UA_Connection *c = &e->connection;
+    if(c->state == UA_CONNECTIONSTATE_CLOSED)
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+    if(!scheduler_canRead(layer, e))
+        return UA_STATUSCODE_GOOD;
+
+    /* The pending bytes are less than one chunk, so they fit */
+    size_t have = e->pending.length;
+    if(have > 0)
+        memcpy(layer->scratch.data, e->pending.data, have);
+    ssize_t ret = UA_recv(c->sockfd, (char*)layer->scratch.data + have,
+                          layer->scratch.length - have, 0);
+    if(ret == 0) {
+        c->close(c);
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+    }
+    if(ret < 0) {
+        if(UA_ERRNO == UA_INTERRUPTED || UA_ERRNO == UA_EAGAIN ||
+           UA_ERRNO == UA_WOULDBLOCK)
+            return UA_STATUSCODE_GOOD;
+        c->close(c);
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+    }
+
+    UA_StatusCode res = scheduler_split(layer, e, layer->scratch.data,
+                                        have + (size_t)ret, SCHEDULER_NOW_US());
+    if(res != UA_STATUSCODE_GOOD) {
+        c->close(c);
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+/* Refill the bucket and take one token */
+static UA_Boolean
+scheduler_takeToken(ConnectionEntry *e, UA_Int64 nowUs) {
+    if(schedulerConfig.rateLimit == 0)
+        return true;
+    UA_Int64 burst = (UA_Int64)(schedulerConfig.rateBurst ?
+                                schedulerConfig.rateBurst : schedulerConfig.rateLimit) * 1000;
+    e->tokens += (nowUs - e->tokensUpdatedUs) * schedulerConfig.rateLimit / 1000;
+    e->tokensUpdatedUs = nowUs;
+    if(e->tokens > burst)
+        e->tokens = burst;
+    if(e->tokens < 1000)
+        return false;
+    e->tokens -= 1000;
+    return true;
+}
+
+static void
+scheduler_process(UA_Server *server, ConnectionEntry *e) {
+    QueuedChunk *q = &e->queue[e->queueHead];
+    e->queueHead = (UA_UInt16)((e->queueHead + 1) % e->queueSize);
+    e->queueCount--;
+    /* A connection closed by the server drops the rest of its queue */
+    if(e->connection.state != UA_CONNECTIONSTATE_CLOSED) {
+        UA_ServerNetworkLayer_setReceiveTime(q->receivedUs);
+        UA_Server_processBinaryMessage(server, &e->connection, &q->chunk);
+        UA_ServerNetworkLayer_setReceiveTime(0);
+    }
+    UA_ByteString_clear(&q->chunk);
+
+    UA_TcpSchedulerLaneStatistics *ls = &schedulerStats.lanes[q->lane];
+    UA_UInt32 us = (UA_UInt32)(SCHEDULER_NOW_US() - q->receivedUs);
+    size_t bucket = 0;
+    while(bucket < UA_TCPSCHEDULER_BUCKETS - 1 && us > schedulerBucketBounds[bucket])
+        bucket++;
+    ls->latencyBuckets[bucket]++;
+    UA_UInt32 sumUs = schedulerSumRestUs[q->lane] + us;
+    ls->latencySumMs += sumUs / 1000;
+    schedulerSumRestUs[q->lane] = sumUs % 1000;
+    if(us > ls->latencyMaxUs)
+        ls->latencyMaxUs = us;
+    ls->processed++;
+    ls->queued--;
+    if(q->lane == UA_TCPSCHEDULERLANE_PRIORITY)
+        e->txUrgent = true;
+}
+
+/* Priority lane of every connection first, then one chunk per connection */
+static void
+scheduler_dispatch(ServerNetworkLayerTCP *layer, UA_Server *server) {
+    ConnectionEntry *e;
+    LIST_FOREACH(e, &layer->connections, pointers) {
+        if(!e->queue)
+            continue;
+        if(e->pending.length > 0 &&
+           scheduler_split(layer, e, e->pending.data, e->pending.length,
+                           SCHEDULER_NOW_US()) != UA_STATUSCODE_GOOD)
+            e->connection.close(&e->connection);
+        while(e->queueCount > 0 &&
+              e->queue[e->queueHead].lane == UA_TCPSCHEDULERLANE_PRIORITY)
+            scheduler_process(server, e);
+    }
+
+    UA_Int64 nowUs = SCHEDULER_NOW_US();
+    LIST_FOREACH(e, &layer->connections, pointers) {
+        if(!e->queue || e->queueCount == 0)
+            continue;
+        if(e->queue[e->queueHead].lane == UA_TCPSCHEDULERLANE_NORMAL &&
+           e->connection.state != UA_CONNECTIONSTATE_CLOSED &&
+           !scheduler_takeToken(e, nowUs)) {
+            schedulerStats.rateLimited++;
+            continue;
+        }
+        scheduler_process(server, e);
+    }
+}
+
+/* Do not block in select while queued chunks can be processed; wait at most
+ * for the next token of a rate limited connection */
+static UA_UInt16
+scheduler_timeout(ServerNetworkLayerTCP *layer, UA_UInt16 timeout) {
+    ConnectionEntry *e;
+    UA_Int64 nowUs = SCHEDULER_NOW_US();
+    LIST_FOREACH(e, &layer->connections, pointers) {
+        if(!e->queue || e->queueCount == 0)
+            continue;
+        if(schedulerConfig.rateLimit == 0 ||
+           e->queue[e->queueHead].lane == UA_TCPSCHEDULERLANE_PRIORITY ||
+           e->connection.state == UA_CONNECTIONSTATE_CLOSED)
+            return 0;
+        UA_Int64 tokens = e->tokens +
+            (nowUs - e->tokensUpdatedUs) * schedulerConfig.rateLimit / 1000;
+        if(tokens >= 1000)
+            return 0;
+        UA_Int64 ms = (1000 - tokens) / schedulerConfig.rateLimit + 1;
+        if(ms < timeout)
+            timeout = (UA_UInt16)ms;
+    }
+    return timeout;
+}
+
+static void
+scheduler_clearConnection(ConnectionEntry *e) {
+    if(!e->queue)
+        return;
+    while(e->queueCount > 0) {
+        QueuedChunk *q = &e->queue[e->queueHead];
+        schedulerStats.lanes[q->lane].queued--;
+        UA_ByteString_clear(&q->chunk);
+        e->queueHead = (UA_UInt16)((e->queueHead + 1) % e->queueSize);
+        e->queueCount--;
+    }
+    UA_ByteString_clear(&e->pending);
+    UA_free(e->queue);
+    e->queue = NULL;
+}
+
+/****************************/
+/* Coalesced sending        */
+/****************************/
+
+#define SEND_DEFAULT_CHUNKS 16
+#define SEND_MAX_CHUNKS     32
+#define SEND_DEFAULT_BYTES  5760 /* CONFIG_LWIP_TCP_SND_BUF_DEFAULT */
+
+static UA_TcpSendConfig sendConfig;
+static UA_TcpSendStatistics sendStats;
+
+void
+UA_ServerNetworkLayerTCP_setSendCoalescing(const UA_TcpSendConfig *config) {
+    if(config)
+        sendConfig = *config;
+    else
+        memset(&sendConfig, 0, sizeof(sendConfig));
+}
+
+void
+UA_ServerNetworkLayerTCP_getSendStatistics(UA_TcpSendStatistics *stats) {
+    if(stats)
+        *stats = sendStats;
+}
+
+static UA_UInt16
+send_maxChunks(void) {
+    if(sendConfig.maxChunks == 0)
+        return SEND_DEFAULT_CHUNKS;
+    if(sendConfig.maxChunks > SEND_MAX_CHUNKS)
+        return SEND_MAX_CHUNKS;
+    return sendConfig.maxChunks;
+}
+
+static void
+send_count(size_t chunks, size_t bytes) {
+    sendStats.chunks += (UA_UInt32)chunks;
+    sendStats.bytes += (UA_UInt32)bytes;
+    sendStats.flushes++;
+    if(chunks > sendStats.maxBatch)
+        sendStats.maxBatch = (UA_UInt32)chunks;
+}
+
+static void
+send_clearConnection(ConnectionEntry *e) {
+    if(!e->txChunks)
+        return;
+    for(UA_UInt16 i = 0; i < e->txCount; i++)
+        UA_ByteString_clear(&e->txChunks[i]);
+    UA_free(e->txChunks);
+    e->txChunks = NULL;
+    e->txCount = 0;
+    e->txBytes = 0;
+}
+
+/* Write all kept chunks with as few sendmsg() calls as the socket allows. The
+ * socket is non-blocking; like connection_write, retry until everything is
+ * written and suppress SIGPIPE for a peer that closed the connection. */
+static UA_StatusCode
+send_flush(ConnectionEntry *e) {
+    if(!e->txChunks || e->txCount == 0)
+        return UA_STATUSCODE_GOOD;
+
+    struct iovec iov[SEND_MAX_CHUNKS];
+    UA_UInt16 count = e->txCount;
+    for(UA_UInt16 i = 0; i < count; i++) {
+        iov[i].iov_base = e->txChunks[i].data;
+        iov[i].iov_len = e->txChunks[i].length;
+    }
+    send_count(count, e->txBytes);
+
+    UA_StatusCode res = UA_STATUSCODE_GOOD;
+    struct iovec *next = iov;
+    int left = (int)count;
+    while(left > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = next;
+        msg.msg_iovlen = left;
+        ssize_t n = UA_sendmsg(e->connection.sockfd, &msg, MSG_NOSIGNAL);
+        if(n < 0) {
+            if(UA_ERRNO == UA_INTERRUPTED || UA_ERRNO == UA_AGAIN)
+                continue;
+            res = UA_STATUSCODE_BADCONNECTIONCLOSED;
+            break;
+        }
+        /* Skip what was written, the last buffer may be partial */
+        size_t written = (size_t)n;
+        while(left > 0 && written >= next->iov_len) {
+            written -= next->iov_len;
+            next++;
+            left--;
+        }
+        if(left > 0) {
+            next->iov_base = (UA_Byte*)next->iov_base + written;
+            next->iov_len -= written;
+        }
+    }
+
+    for(UA_UInt16 i = 0; i < count; i++)
+        UA_ByteString_clear(&e->txChunks[i]);
+    e->txCount = 0;
+    e->txBytes = 0;
+    e->txUrgent = false;
+    return res;
+}
+
+/* With request scheduling, a connection gets one chunk per listen() call.
+ * While more of its chunks are queued and can be processed in the next call
+ * (select() does not wait then), its responses are kept to be sent together.
+ * The response to a priority lane chunk is never held back. */
+static UA_Boolean
+send_canDefer(const ConnectionEntry *e) {
+    if(!e->queue || e->queueCount == 0 || e->txUrgent ||
+       e->connection.state == UA_CONNECTIONSTATE_CLOSED)
+        return false;
+    return schedulerConfig.rateLimit == 0 ||
+        e->queue[e->queueHead].lane == UA_TCPSCHEDULERLANE_PRIORITY ||
+        e->tokens >= 1000;
+}
+
+static void
+send_flushAll(ServerNetworkLayerTCP *layer) {
+    ConnectionEntry *e;
+    LIST_FOREACH(e, &layer->connections, pointers) {
+        if(e->txCount == 0 || send_canDefer(e))
+            continue;
+        if(send_flush(e) != UA_STATUSCODE_GOOD)
+            e->connection.close(&e->connection);
+    }
+}
+
+/* Send function of the server connections. Takes ownership of the buffer. */
+static UA_StatusCode
+ServerNetworkLayerTCP_send(UA_Connection *connection, UA_ByteString *buf) {
+    ConnectionEntry *e = (ConnectionEntry*)connection;
+    if(!e->txChunks) {
+        if(connection->state != UA_CONNECTIONSTATE_CLOSED)
+            send_count(1, buf->length);
+        return connection_write(connection, buf);
+    }
+
+    if(connection->state == UA_CONNECTIONSTATE_CLOSED) {
+        UA_ByteString_clear(buf);
+        return UA_STATUSCODE_BADCONNECTIONCLOSED;
+    }
+
+    /* The send buffer has the size of the negotiated chunk; shrink it to the
+     * encoded length while it waits */
+    if(buf->length > 0) {
+        UA_Byte *data = (UA_Byte*)UA_realloc(buf->data, buf->length);
+        if(data)
+            buf->data = data;
+    }
+
+    e->txChunks[e->txCount++] = *buf;
+    e->txBytes += buf->length;
+    UA_ByteString_init(buf);
+
+    UA_UInt32 maxBytes = sendConfig.maxBytes ?
+        sendConfig.maxBytes : SEND_DEFAULT_BYTES;
+    if(e->txCount < send_maxChunks() && e->txBytes < maxBytes)
+        return UA_STATUSCODE_GOOD;
+
+    sendStats.earlyFlushes++;
+    UA_StatusCode res = send_flush(e);
+    if(res != UA_STATUSCODE_GOOD)
+        connection->close(connection);
+    return res;
+}
+
 static void
 ServerNetworkLayerTCP_freeConnection(UA_Connection *connection) {
+    scheduler_clearConnection((ConnectionEntry*)connection);
+    send_clearConnection((ConnectionEntry*)connection);
     UA_free(connection);
 }
 
@@ -74663,6 +75420,10 @@ static void
 ServerNetworkLayerTCP_close(UA_Connection *connection) {
     if(connection->state == UA_CONNECTIONSTATE_CLOSED)
         return;
+    /* Responses kept for coalescing (e.g. an error message) go out first */
+    ConnectionEntry *e = (ConnectionEntry*)connection;
+    if(e->txCount > 0)
+        send_flush(e);
     UA_shutdown((UA_SOCKET)connection->sockfd, 2);
     connection->state = UA_CONNECTIONSTATE_CLOSED;
 }
@@ -74736,7 +75497,7 @@ ServerNetworkLayerTCP_add(UA_ServerNetworkLayer *nl, ServerNetworkLayerTCP *laye
     memset(c, 0, sizeof(UA_Connection));
     c->sockfd = newsockfd;
     c->handle = layer;
-    c->send = connection_write;
+    c->send = ServerNetworkLayerTCP_send;
     c->close = ServerNetworkLayerTCP_close;
     c->free = ServerNetworkLayerTCP_freeConnection;
     c->getSendBuffer = connection_getsendbuffer;
@@ -74745,6 +75506,30 @@ ServerNetworkLayerTCP_add(UA_ServerNetworkLayer *nl, ServerNetworkLayerTCP *laye
     c->state = UA_CONNECTIONSTATE_OPENING;
     c->openingDate = UA_DateTime_nowMonotonic();
 
+    /* Request scheduling; without the queue the connection is processed
+     * directly as before */
+    e->queue = NULL;
+    UA_ByteString_init(&e->pending);
+    if(schedulerConfig.enabled && layer->scratch.length > 0) {
+        e->queueSize = schedulerConfig.queueSize ?
+            schedulerConfig.queueSize : SCHEDULER_DEFAULT_QUEUE;
+        e->queue = (QueuedChunk*)UA_calloc(e->queueSize, sizeof(QueuedChunk));
+        e->queueHead = 0;
+        e->queueCount = 0;
+        e->tokensUpdatedUs = SCHEDULER_NOW_US();
+        e->tokens = (UA_Int64)(schedulerConfig.rateBurst ?
+                               schedulerConfig.rateBurst : schedulerConfig.rateLimit) * 1000;
+    }
+
+    /* Coalesced sending; without the array every chunk is sent directly */
+    e->txChunks = NULL;
+    e->txCount = 0;
+    e->txBytes = 0;
+    e->txUrgent = false;
+    if(sendConfig.enabled)
+        e->txChunks = (UA_ByteString*)
+            UA_calloc(send_maxChunks(), sizeof(UA_ByteString));
+
     layer->connectionsSize++;
 
     /* Add to the linked list */
@@ -74869,6 +75654,13 @@ ServerNetworkLayerTCP_start(UA_ServerNetworkLayer *nl, const UA_Logger *logger,
     ServerNetworkLayerTCP *layer = (ServerNetworkLayerTCP *)nl->handle;
     layer->logger = logger;
 
+    /* Receive buffer of the scheduled connections */
+    if(schedulerConfig.enabled && layer->scratch.length == 0 &&
+       UA_ByteString_allocBuffer(&layer->scratch,
+                                 nl->localConnectionConfig.recvBufferSize) != UA_STATUSCODE_GOOD)
+        UA_LOG_WARNING(layer->logger, UA_LOGCATEGORY_NETWORK,
+                       "No memory for request scheduling, processing in socket order");
+
     /* Get addrinfo of the server and create server sockets */
     char hostname[512];
     if(customHostname->length) {
@@ -74948,6 +75740,10 @@ setFDSet(ServerNetworkLayerTCP *layer, fd_set *fdset) {
 
     ConnectionEntry *e;
     LIST_FOREACH(e, &layer->connections, pointers) {
+        /* A full queue is not read until the scheduler has made room */
+        if(e->queue && e->connection.state != UA_CONNECTIONSTATE_CLOSED &&
+           !scheduler_canRead(layer, e))
+            continue;
         UA_fd_set(e->connection.sockfd, fdset);
         if((UA_Int32)e->connection.sockfd > highestfd)
             highestfd = (UA_Int32)e->connection.sockfd;
@@ -74965,10 +75761,23 @@ ServerNetworkLayerTCP_listen(UA_ServerNetworkLayer *nl, UA_Server *server,
     if(layer->serverSocketsSize == 0)
         return UA_STATUSCODE_GOOD;
 
+    /* Responses sent from timers since the last call (e.g. Publish) */
+    send_flushAll(layer);
+
     /* Listen on open sockets (including the server) */
     fd_set fdset, errset;
     UA_Int32 highestfd = setFDSet(layer, &fdset);
     setFDSet(layer, &errset);
+#if defined(UA_ENABLE_DISCOVERY) && defined(UA_ENABLE_DISCOVERY_MULTICAST)
+    /* Local extension: mDNS queries wake the same select() */
+    UA_SOCKET mdnsSocket = UA_Discovery_multicastSocket(server);
+    if(mdnsSocket != UA_INVALID_SOCKET) {
+        UA_fd_set(mdnsSocket, &fdset);
+        if((UA_Int32)mdnsSocket > highestfd)
+            highestfd = (UA_Int32)mdnsSocket;
+    }
+#endif
+    timeout = scheduler_timeout(layer, timeout);
     struct timeval tmptv = {0, timeout * 1000};
     if(UA_select(highestfd+1, &fdset, NULL, &errset, &tmptv) < 0) {
         UA_LOG_SOCKET_ERRNO_WRAP(
@@ -75020,19 +75829,30 @@ ServerNetworkLayerTCP_listen(UA_ServerNetworkLayer *nl, UA_Server *server,
         }
 
         if(!UA_fd_isset(e->connection.sockfd, &errset) &&
-           !UA_fd_isset(e->connection.sockfd, &fdset))
-          continue;
+           !UA_fd_isset(e->connection.sockfd, &fdset)) {
+            if(e->queue && !scheduler_canRead(layer, e))
+                schedulerStats.readsDeferred++;
+            continue;
+        }
 
         UA_LOG_TRACE(layer->logger, UA_LOGCATEGORY_NETWORK,
                     "Connection %li | Activity on the socket",
                     (int)(e->connection.sockfd));
 
         UA_ByteString buf = UA_BYTESTRING_NULL;
-        UA_StatusCode retval = connection_recv(&e->connection, &buf, 0);
+        UA_StatusCode retval;
+        if(e->queue) {
+            /* Only queued here, processed by scheduler_dispatch() */
+            retval = scheduler_recv(layer, e);
+        } else {
+            retval = connection_recv(&e->connection, &buf, 0);
+        }
 
-        if(retval == UA_STATUSCODE_GOOD) {
+        if(retval == UA_STATUSCODE_GOOD && !e->queue) {
             /* Process packets */
+            UA_ServerNetworkLayer_setReceiveTime(SCHEDULER_NOW_US());
             UA_Server_processBinaryMessage(server, &e->connection, &buf);
+            UA_ServerNetworkLayer_setReceiveTime(0);
             connection_releaserecvbuffer(&e->connection, &buf);
         } else if(retval == UA_STATUSCODE_BADCONNECTIONCLOSED) {
             /* The socket is shutdown but not closed */
@@ -75048,6 +75868,14 @@ ServerNetworkLayerTCP_listen(UA_ServerNetworkLayer *nl, UA_Server *server,
             }
         }
     }
+
+#if defined(UA_ENABLE_DISCOVERY) && defined(UA_ENABLE_DISCOVERY_MULTICAST)
+    if(mdnsSocket != UA_INVALID_SOCKET && UA_fd_isset(mdnsSocket, &fdset))
+        UA_Discovery_multicastReceive(server);
+#endif
+
+    scheduler_dispatch(layer, server);
+    send_flushAll(layer);
     return UA_STATUSCODE_GOOD;
 }
 
@@ -75089,6 +75917,8 @@ ServerNetworkLayerTCP_clear(UA_ServerNetworkLayer *nl) {
         LIST_REMOVE(e, pointers);
         layer->connectionsSize--;
         UA_close(e->connection.sockfd);
+        scheduler_clearConnection(e);
+        send_clearConnection(e);
         UA_free(e);
         if(nl->statistics) {
             nl->statistics->currentConnectionCount--;
@@ -75096,6 +75926,7 @@ ServerNetworkLayerTCP_clear(UA_ServerNetworkLayer *nl) {
     }
 
     /* Free the layer */
+    UA_ByteString_clear(&layer->scratch);
     UA_free(layer);
 }
 
@@ -0,0 +1,321 @@
+/* delta_patch.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "delta_patch.h"
+#include <string.h>
+
+/** @brief Parser states */
+enum {
+    ST_HEADER = 0,
+    ST_OPCODE,
+    ST_COPY_LENGTH,
+    ST_COPY_OFFSET,
+    ST_INSERT_LENGTH,
+    ST_INSERT_DATA,
+    ST_DONE
+};
+
+/* CRC-32 (reflected 0xEDB88320), one nibble per lookup */
+static const uint32_t crc_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t delta_crc32(uint32_t crc, const void *data, size_t length) {
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+    while (length--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool delta_patch_is_delta(const void *data, size_t length) {
+    return length >= 4 && memcmp(data, "A16D", 4) == 0;
+}
+
+void delta_patch_begin(delta_patch_t *patch, delta_read_fn read_base,
+                       delta_write_fn write_image, void *context) {
+    memset(patch, 0, sizeof(*patch));
+    patch->read_base = read_base;
+    patch->write_image = write_image;
+    patch->context = context;
+    patch->state = ST_HEADER;
+}
+
+const delta_header_t *delta_patch_header(const delta_patch_t *patch) {
+    return patch->header_len == DELTA_HEADER_SIZE ? &patch->header : NULL;
+}
+
+/**
+ * @brief Pass image bytes to the writer
+ */
+static delta_result_t emit(delta_patch_t *patch, const void *data, uint32_t length) {
+    if (length > patch->header.image_size - patch->written) {
+        return DELTA_ERR_RANGE;
+    }
+    if (patch->write_image(patch->context, data, length) != 0) {
+        return DELTA_ERR_IO;
+    }
+    patch->crc = delta_crc32(patch->crc, data, length);
+    patch->written += length;
+    return DELTA_OK;
+}
+
+/**
+ * @brief Parse the header and check the base against it
+ */
+static delta_result_t check_header(delta_patch_t *patch) {
+    const uint8_t *h = patch->header_buf;
+    if (!delta_patch_is_delta(h, DELTA_HEADER_SIZE) || h[4] != DELTA_VERSION) {
+        return DELTA_ERR_FORMAT;
+    }
+    patch->header.base_size = get_le32(h + 8);
+    patch->header.base_crc = get_le32(h + 12);
+    patch->header.image_size = get_le32(h + 16);
+    patch->header.image_crc = get_le32(h + 20);
+
+    // The whole base is read once; the chunk buffer is free until the first copy
+    uint32_t crc = 0;
+    for (uint32_t pos = 0; pos < patch->header.base_size; pos += DELTA_COPY_CHUNK) {
+        uint32_t n = patch->header.base_size - pos;
+        if (n > DELTA_COPY_CHUNK) n = DELTA_COPY_CHUNK;
+        if (patch->read_base(patch->context, pos, patch->chunk, n) != 0) {
+            return DELTA_ERR_BASE;
+        }
+        crc = delta_crc32(crc, patch->chunk, n);
+    }
+    return crc == patch->header.base_crc ? DELTA_OK : DELTA_ERR_BASE;
+}
+
+/**
+ * @brief Copy length bytes of the base at base_pos + offset
+ */
+static delta_result_t copy_base(delta_patch_t *patch, int32_t offset, uint32_t length) {
+    int64_t start = (int64_t)patch->base_pos + offset;
+    if (start < 0 || start + length > patch->header.base_size) {
+        return DELTA_ERR_RANGE;
+    }
+    uint32_t pos = (uint32_t)start;
+    while (length > 0) {
+        uint32_t n = length > DELTA_COPY_CHUNK ? DELTA_COPY_CHUNK : length;
+        if (patch->read_base(patch->context, pos, patch->chunk, n) != 0) {
+            return DELTA_ERR_IO;
+        }
+        delta_result_t r = emit(patch, patch->chunk, n);
+        if (r != DELTA_OK) {
+            return r;
+        }
+        pos += n;
+        length -= n;
+        patch->copied += n;
+    }
+    patch->base_pos = pos;
+    return DELTA_OK;
+}
+
+/**
+ * @brief Feed one byte to the varint decoder
+ *
+ * @return 1 when the varint is complete, 0 when more bytes follow, -1 on overflow
+ */
+static int varint_byte(delta_patch_t *patch, uint8_t byte) {
+    if (patch->shift > 28) {
+        return -1;
+    }
+    patch->varint |= (uint32_t)(byte & 0x7F) << patch->shift;
+    patch->shift += 7;
+    return (byte & 0x80) ? 0 : 1;
+}
+
+static void varint_reset(delta_patch_t *patch) {
+    patch->varint = 0;
+    patch->shift = 0;
+}
+
+delta_result_t delta_patch_feed(delta_patch_t *patch, const void *data, size_t length) {
+    const uint8_t *p = (const uint8_t *)data;
+    const uint8_t *end = p + length;
+
+    while (p < end && patch->error == DELTA_OK) {
+        switch (patch->state) {
+            case ST_HEADER: {
+                size_t n = DELTA_HEADER_SIZE - patch->header_len;
+                if (n > (size_t)(end - p)) n = (size_t)(end - p);
+                memcpy(patch->header_buf + patch->header_len, p, n);
+                patch->header_len += (uint8_t)n;
+                p += n;
+                if (patch->header_len == DELTA_HEADER_SIZE) {
+                    patch->error = check_header(patch);
+                    patch->state = ST_OPCODE;
+                }
+                break;
+            }
+            case ST_OPCODE: {
+                uint8_t op = *p++;
+                varint_reset(patch);
+                if (op == DELTA_OP_COPY) {
+                    patch->state = ST_COPY_LENGTH;
+                } else if (op == DELTA_OP_INSERT) {
+                    patch->state = ST_INSERT_LENGTH;
+                } else if (op == DELTA_OP_END) {
+                    patch->state = ST_DONE;
+                } else {
+                    patch->error = DELTA_ERR_FORMAT;
+                }
+                break;
+            }
+            case ST_COPY_LENGTH:
+            case ST_INSERT_LENGTH: {
+                int done = varint_byte(patch, *p++);
+                if (done < 0) {
+                    patch->error = DELTA_ERR_FORMAT;
+                } else if (done) {
+                    patch->length = patch->varint;
+                    varint_reset(patch);
+                    if (patch->state == ST_COPY_LENGTH) {
+                        patch->state = ST_COPY_OFFSET;
+                    } else {
+                        patch->remaining = patch->length;
+                        patch->operations++;
+                        patch->state = patch->length ? ST_INSERT_DATA : ST_OPCODE;
+                    }
+                }
+                break;
+            }
+            case ST_COPY_OFFSET: {
+                int done = varint_byte(patch, *p++);
+                if (done < 0) {
+                    patch->error = DELTA_ERR_FORMAT;
+                } else if (done) {
+                    int32_t offset = (int32_t)(patch->varint >> 1) ^ -(int32_t)(patch->varint & 1);
+                    patch->operations++;
+                    patch->error = copy_base(patch, offset, patch->length);
+                    patch->state = ST_OPCODE;
+                }
+                break;
+            }
+            case ST_INSERT_DATA: {
+                uint32_t n = patch->remaining;
+                if (n > (uint32_t)(end - p)) n = (uint32_t)(end - p);
+                patch->error = emit(patch, p, n);
+                patch->inserted += n;
+                patch->remaining -= n;
+                p += n;
+                if (patch->remaining == 0) {
+                    patch->state = ST_OPCODE;
+                }
+                break;
+            }
+            case ST_DONE:
+            default:
+                // Nothing may follow the end marker
+                patch->error = DELTA_ERR_FORMAT;
+                break;
+        }
+    }
+    return patch->error;
+}
+
+delta_result_t delta_patch_finish(delta_patch_t *patch) {
+    if (patch->error != DELTA_OK) {
+        return patch->error;
+    }
+    if (patch->state != ST_DONE || patch->written != patch->header.image_size) {
+        return DELTA_ERR_INCOMPLETE;
+    }
+    return patch->crc == patch->header.image_crc ? DELTA_OK : DELTA_ERR_CRC;
+}
+
+const char *delta_result_name(delta_result_t result) {
+    switch (result) {
+        case DELTA_OK:              return "ok";
+        case DELTA_ERR_FORMAT:      return "malformed patch";
+        case DELTA_ERR_BASE:        return "patch is for another base image";
+        case DELTA_ERR_RANGE:       return "operation out of range";
+        case DELTA_ERR_IO:          return "flash access failed";
+        case DELTA_ERR_INCOMPLETE:  return "patch incomplete";
+        case DELTA_ERR_CRC:         return "image CRC mismatch";
+        default:                    return "unknown";
+    }
+}
+
+void delta_flash_writer_begin(delta_flash_writer_t *writer, const delta_flash_ops_t *ops,
+                              uint32_t capacity) {
+    memset(writer, 0, offsetof(delta_flash_writer_t, sector));
+    writer->ops = *ops;
+    writer->capacity = capacity;
+}
+
+/**
+ * @brief Check whether the flash already holds the sector buffer
+ */
+static bool sector_matches(delta_flash_writer_t *writer) {
+    for (uint32_t pos = 0; pos < DELTA_SECTOR_SIZE; pos += DELTA_VERIFY_CHUNK) {
+        if (writer->ops.read(writer->ops.context, writer->offset + pos, writer->verify,
+                             DELTA_VERIFY_CHUNK) != 0 ||
+            memcmp(writer->verify, writer->sector + pos, DELTA_VERIFY_CHUNK) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Store the full sector buffer unless the flash already has it
+ */
+static int flush_sector(delta_flash_writer_t *writer) {
+    if (writer->offset + DELTA_SECTOR_SIZE > writer->capacity) {
+        writer->failed = true;
+        return -1;
+    }
+    if (sector_matches(writer)) {
+        writer->sectors_skipped++;
+    } else if (writer->ops.erase(writer->ops.context, writer->offset, DELTA_SECTOR_SIZE) != 0 ||
+               writer->ops.write(writer->ops.context, writer->offset, writer->sector,
+                                 DELTA_SECTOR_SIZE) != 0) {
+        writer->failed = true;
+        return -1;
+    } else {
+        writer->sectors_written++;
+    }
+    writer->offset += DELTA_SECTOR_SIZE;
+    writer->fill = 0;
+    return 0;
+}
+
+int delta_flash_writer_write(void *context, const void *data, size_t length) {
+    delta_flash_writer_t *writer = (delta_flash_writer_t *)context;
+    const uint8_t *p = (const uint8_t *)data;
+    if (writer->failed) {
+        return -1;
+    }
+    while (length > 0) {
+        size_t n = DELTA_SECTOR_SIZE - writer->fill;
+        if (n > length) n = length;
+        memcpy(writer->sector + writer->fill, p, n);
+        writer->fill += n;
+        p += n;
+        length -= n;
+        if (writer->fill == DELTA_SECTOR_SIZE && flush_sector(writer) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int delta_flash_writer_finish(delta_flash_writer_t *writer) {
+    if (writer->failed) {
+        return -1;
+    }
+    if (writer->fill == 0) {
+        return 0;
+    }
+    memset(writer->sector + writer->fill, 0xFF, DELTA_SECTOR_SIZE - writer->fill);
+    return flush_sector(writer);
+}
@@ -0,0 +1,254 @@
+/* delta_patch.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Streamed Delta Patches
+ * ============================================================================
+ *
+ * A patch rebuilds a new firmware image from the running one (the base). It
+ * is applied in a single pass as it arrives, with a fixed amount of RAM: the
+ * base is read at random offsets through a callback, the new image leaves
+ * strictly in order through another one. This file has no ESP-IDF
+ * dependencies, so tools/ota_delta.c builds the same applier on the host.
+ *
+ * Format (little endian):
+ *
+ *   Header (DELTA_HEADER_SIZE bytes)
+ *     0   magic     "A16D"
+ *     4   version   DELTA_VERSION
+ *     5   flags     0
+ *     6   reserved  0
+ *     8   base_size     bytes of the base the patch was made against
+ *     12  base_crc      CRC-32 of those bytes
+ *     16  image_size    bytes of the new image
+ *     20  image_crc     CRC-32 of the new image
+ *
+ *   Operations, until DELTA_OP_END
+ *     DELTA_OP_COPY    varint length, signed varint offset
+ *                      copy length bytes of the base from base position +
+ *                      offset; the base position then moves past them
+ *     DELTA_OP_INSERT  varint length, length literal bytes
+ *     DELTA_OP_END
+ *
+ * Varints are LEB128, signed varints zigzag encoded. The base position
+ * starts at 0, so an unchanged stretch after a copy costs only its length.
+ * The CRC is the IEEE 802.3 polynomial (zlib crc32, esp_rom_crc32_le).
+ *
+ * delta_flash_writer_t collects the output into whole flash sectors and
+ * leaves a sector alone when the slot already holds the same bytes, so an
+ * A/B slot that still has a similar image is only partly erased.
+ */
+
+/** @brief Header size in bytes */
+#define DELTA_HEADER_SIZE       24
+/** @brief Format version */
+#define DELTA_VERSION           1
+/** @brief Bytes of the base copied per read callback */
+#define DELTA_COPY_CHUNK        512
+/** @brief Flash sector size of the writer */
+#define DELTA_SECTOR_SIZE       4096
+/** @brief Bytes compared per read when checking a sector */
+#define DELTA_VERIFY_CHUNK      256
+
+/** @brief Operation codes */
+#define DELTA_OP_END            0x00
+#define DELTA_OP_COPY           0x01
+#define DELTA_OP_INSERT         0x02
+
+/**
+ * @brief Result of a patch call
+ */
+typedef enum {
+    DELTA_OK = 0,               /**< Success (or more input expected) */
+    DELTA_ERR_FORMAT,           /**< Bad magic, version or operation */
+    DELTA_ERR_BASE,             /**< The base is not the one the patch was made for */
+    DELTA_ERR_RANGE,            /**< Copy outside the base or output beyond image_size */
+    DELTA_ERR_IO,               /**< A callback failed */
+    DELTA_ERR_INCOMPLETE,       /**< Patch ended early */
+    DELTA_ERR_CRC               /**< New image does not match image_crc */
+} delta_result_t;
+
+/**
+ * @brief Read bytes of the base image
+ *
+ * @return 0 on success
+ */
+typedef int (*delta_read_fn)(void *context, uint32_t offset, void *buffer, size_t length);
+
+/**
+ * @brief Take the next bytes of the new image (in order)
+ *
+ * @return 0 on success
+ */
+typedef int (*delta_write_fn)(void *context, const void *data, size_t length);
+
+/**
+ * @brief Patch header
+ */
+typedef struct {
+    uint32_t base_size;         /**< Bytes of the base */
+    uint32_t base_crc;          /**< CRC-32 of the base */
+    uint32_t image_size;        /**< Bytes of the new image */
+    uint32_t image_crc;         /**< CRC-32 of the new image */
+} delta_header_t;
+
+/**
+ * @brief Applier state (no heap, about DELTA_COPY_CHUNK + 100 bytes)
+ */
+typedef struct {
+    delta_read_fn read_base;    /**< Base reader */
+    delta_write_fn write_image; /**< Image writer */
+    void *context;              /**< Passed to both callbacks */
+
+    delta_header_t header;      /**< Parsed header */
+    uint8_t header_buf[DELTA_HEADER_SIZE];
+    uint8_t header_len;         /**< Header bytes received */
+    uint8_t state;              /**< Parser state */
+    uint8_t shift;              /**< Varint bit position */
+    uint32_t varint;            /**< Varint being decoded */
+    uint32_t length;            /**< Length of the current operation */
+    uint32_t remaining;         /**< Literal bytes still to come */
+    uint32_t base_pos;          /**< Base position for the next copy */
+    uint32_t written;           /**< Image bytes produced */
+    uint32_t crc;               /**< Running CRC of the image */
+    delta_result_t error;       /**< First error, sticky */
+
+    uint32_t copied;            /**< Image bytes taken from the base */
+    uint32_t inserted;          /**< Image bytes taken from the patch */
+    uint32_t operations;        /**< Operations applied */
+
+    uint8_t chunk[DELTA_COPY_CHUNK];
+} delta_patch_t;
+
+/**
+ * @brief Flash access of the sector writer
+ */
+typedef struct {
+    int (*read)(void *context, uint32_t offset, void *buffer, size_t length);
+    int (*erase)(void *context, uint32_t offset, size_t length);
+    int (*write)(void *context, uint32_t offset, const void *data, size_t length);
+    void *context;
+} delta_flash_ops_t;
+
+/**
+ * @brief Sector writer state (about DELTA_SECTOR_SIZE + DELTA_VERIFY_CHUNK + 50 bytes)
+ */
+typedef struct {
+    delta_flash_ops_t ops;      /**< Flash access */
+    uint32_t capacity;          /**< Size of the target region */
+    uint32_t offset;            /**< Flash offset of the sector being filled */
+    uint32_t fill;              /**< Bytes in the sector buffer */
+    uint32_t sectors_written;   /**< Sectors erased and programmed */
+    uint32_t sectors_skipped;   /**< Sectors that already held the data */
+    bool failed;                /**< A flash call failed or the region is full */
+    uint8_t sector[DELTA_SECTOR_SIZE];
+    uint8_t verify[DELTA_VERIFY_CHUNK];
+} delta_flash_writer_t;
+
+/**
+ * @brief Update a CRC-32 (start with 0)
+ *
+ * @param crc CRC so far
+ * @param data Bytes
+ * @param length Number of bytes
+ * @return uint32_t Updated CRC
+ */
+uint32_t delta_crc32(uint32_t crc, const void *data, size_t length);
+
+/**
+ * @brief Check whether a stream starts with a delta patch header
+ *
+ * @param data First bytes of the stream
+ * @param length Number of bytes (at least 4 for a positive answer)
+ * @return true for the "A16D" magic
+ */
+bool delta_patch_is_delta(const void *data, size_t length);
+
+/**
+ * @brief Prepare an applier
+ *
+ * @param patch State to initialize
+ * @param read_base Base reader
+ * @param write_image Image writer
+ * @param context Passed to both callbacks
+ */
+void delta_patch_begin(delta_patch_t *patch, delta_read_fn read_base,
+                       delta_write_fn write_image, void *context);
+
+/**
+ * @brief Apply the next bytes of the patch
+ *
+ * When the header is complete, the base is checked against base_size and
+ * base_crc before any output is produced.
+ *
+ * @param patch Applier
+ * @param data Patch bytes
+ * @param length Number of bytes
+ * @return delta_result_t DELTA_OK or the first error
+ */
+delta_result_t delta_patch_feed(delta_patch_t *patch, const void *data, size_t length);
+
+/**
+ * @brief Check that the patch was complete and the image is correct
+ *
+ * @param patch Applier
+ * @return delta_result_t DELTA_OK, DELTA_ERR_INCOMPLETE, DELTA_ERR_CRC or an earlier error
+ */
+delta_result_t delta_patch_finish(delta_patch_t *patch);
+
+/**
+ * @brief Header of the patch (valid once header_len is DELTA_HEADER_SIZE)
+ *
+ * @param patch Applier
+ * @return const delta_header_t* Header or NULL while incomplete
+ */
+const delta_header_t *delta_patch_header(const delta_patch_t *patch);
+
+/**
+ * @brief Name of a result
+ *
+ * @param result Result
+ * @return const char* Short description
+ */
+const char *delta_result_name(delta_result_t result);
+
+/**
+ * @brief Prepare a sector writer for a region starting at offset 0
+ *
+ * @param writer State to initialize
+ * @param ops Flash access (offsets relative to the region)
+ * @param capacity Size of the region in bytes
+ */
+void delta_flash_writer_begin(delta_flash_writer_t *writer, const delta_flash_ops_t *ops,
+                              uint32_t capacity);
+
+/**
+ * @brief Append bytes (delta_write_fn compatible, context is the writer)
+ *
+ * @return 0 on success
+ */
+int delta_flash_writer_write(void *writer, const void *data, size_t length);
+
+/**
+ * @brief Write the last partial sector (padded with 0xFF)
+ *
+ * @param writer Writer
+ * @return int 0 on success
+ */
+int delta_flash_writer_finish(delta_flash_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DELTA_PATCH_H */
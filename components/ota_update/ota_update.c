@@ -0,0 +1,432 @@
+/* ota_update.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "ota_update.h"
+#include "delta_patch.h"
+#include "esp_app_desc.h"
+#include "esp_app_format.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "ota_update";
+
+#define OTA_TASK_STACK          6144    /**< Download task stack size */
+#define OTA_TASK_PRIORITY       3       /**< Below the OPC UA and I/O tasks: updates run in the background */
+#define OTA_CONFIRM_PERIOD_US   1000000 /**< Health check period of a pending image */
+
+/**
+ * @brief Buffers of one download (allocated for its duration)
+ */
+typedef struct {
+    delta_patch_t patch;
+    delta_flash_writer_t writer;
+    uint8_t rx[OTA_RX_CHUNK];
+} ota_work_t;
+
+static ota_update_config_t ota_config;
+static bool ota_initialized = false;
+static ota_health_fn health_check = NULL;
+
+static SemaphoreHandle_t status_mutex = NULL;
+static ota_update_status_t status;
+
+static const esp_partition_t *running_part = NULL;
+static const esp_partition_t *target_part = NULL;
+static char request_url[OTA_URL_MAX];
+static bool request_activate = false;
+
+static esp_timer_handle_t restart_timer = NULL;
+static bool restart_rollback = false;
+static esp_timer_handle_t confirm_timer = NULL;
+static uint32_t healthy_s = 0;
+static uint32_t pending_s = 0;
+
+static void set_state(ota_state_t state) {
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    status.state = state;
+    xSemaphoreGive(status_mutex);
+}
+
+static void fail(const char *reason) {
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    status.state = OTA_FAILED;
+    strlcpy(status.error, reason, sizeof(status.error));
+    xSemaphoreGive(status_mutex);
+    ESP_LOGE(TAG, "Update failed: %s", reason);
+}
+
+/* Flash access: the base is the running slot, the output goes to the other one */
+
+static int read_running(void *context, uint32_t offset, void *buffer, size_t length) {
+    return esp_partition_read(running_part, offset, buffer, length) == ESP_OK ? 0 : -1;
+}
+
+static int slot_read(void *context, uint32_t offset, void *buffer, size_t length) {
+    return esp_partition_read((const esp_partition_t *)context, offset, buffer, length) == ESP_OK ? 0 : -1;
+}
+
+static int slot_erase(void *context, uint32_t offset, size_t length) {
+    return esp_partition_erase_range((const esp_partition_t *)context, offset, length) == ESP_OK ? 0 : -1;
+}
+
+static int slot_write(void *context, uint32_t offset, const void *data, size_t length) {
+    return esp_partition_write((const esp_partition_t *)context, offset, data, length) == ESP_OK ? 0 : -1;
+}
+
+/**
+ * @brief Download the stream at request_url into target_part
+ *
+ * @param work Buffers
+ * @return bool true when the slot holds the complete image
+ */
+static bool download(ota_work_t *work) {
+    esp_http_client_config_t http_config = {
+        .url = request_url,
+        .timeout_ms = OTA_HTTP_TIMEOUT_MS,
+        .buffer_size = OTA_RX_CHUNK,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&http_config);
+    if (client == NULL) {
+        fail("HTTP client init failed");
+        return false;
+    }
+    if (esp_http_client_open(client, 0) != ESP_OK) {
+        esp_http_client_cleanup(client);
+        fail("cannot connect to the update server");
+        return false;
+    }
+    int64_t length = esp_http_client_fetch_headers(client);
+    int http_status = esp_http_client_get_status_code(client);
+    if (http_status != 200) {
+        esp_http_client_close(client);
+        esp_http_client_cleanup(client);
+        fail(http_status == 404 ? "HTTP 404 not found" : "unexpected HTTP status");
+        return false;
+    }
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    status.total = length > 0 ? (uint32_t)length : 0;
+    xSemaphoreGive(status_mutex);
+
+    const delta_flash_ops_t ops = { slot_read, slot_erase, slot_write, (void *)target_part };
+    delta_flash_writer_begin(&work->writer, &ops, target_part->size);
+    delta_patch_begin(&work->patch, read_running, delta_flash_writer_write, &work->writer);
+
+    bool first = true;
+    bool delta = false;
+    const char *error = NULL;
+    uint32_t received = 0;
+    while (error == NULL) {
+        int n = esp_http_client_read(client, (char *)work->rx, OTA_RX_CHUNK);
+        if (n < 0) {
+            error = "connection lost";
+            break;
+        }
+        if (n == 0) {
+            if (!esp_http_client_is_complete_data_received(client)) {
+                error = "stream ended early";
+            }
+            break;
+        }
+        if (first) {
+            // A full image starts with the image header magic, a patch with "A16D"
+            delta = delta_patch_is_delta(work->rx, (size_t)n);
+            if (!delta && work->rx[0] != ESP_IMAGE_HEADER_MAGIC) {
+                error = "neither an image nor a patch";
+                break;
+            }
+            first = false;
+            xSemaphoreTake(status_mutex, portMAX_DELAY);
+            status.delta = delta;
+            xSemaphoreGive(status_mutex);
+        }
+        if (delta) {
+            delta_result_t r = delta_patch_feed(&work->patch, work->rx, (size_t)n);
+            if (r != DELTA_OK) {
+                error = delta_result_name(r);
+            }
+        } else if (delta_flash_writer_write(&work->writer, work->rx, (size_t)n) != 0) {
+            error = "flash write failed or image too large";
+        }
+        received += (uint32_t)n;
+
+        xSemaphoreTake(status_mutex, portMAX_DELAY);
+        status.received = received;
+        status.sectors_written = work->writer.sectors_written;
+        status.sectors_skipped = work->writer.sectors_skipped;
+        xSemaphoreGive(status_mutex);
+    }
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+
+    if (error == NULL && first) {
+        error = "empty stream";
+    }
+    if (error == NULL && delta) {
+        delta_result_t r = delta_patch_finish(&work->patch);
+        if (r != DELTA_OK) {
+            error = delta_result_name(r);
+        }
+    }
+    if (error == NULL && delta_flash_writer_finish(&work->writer) != 0) {
+        error = "flash write failed or image too large";
+    }
+    if (error != NULL) {
+        fail(error);
+        return false;
+    }
+
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    status.image_size = delta ? work->patch.header.image_size : received;
+    status.sectors_written = work->writer.sectors_written;
+    status.sectors_skipped = work->writer.sectors_skipped;
+    xSemaphoreGive(status_mutex);
+    return true;
+}
+
+/**
+ * @brief Download task, one per update
+ */
+static void ota_download_task(void *arg) {
+    int64_t start_us = esp_timer_get_time();
+    ota_work_t *work = (ota_work_t *)arg;
+    bool ok = download(work);
+    free(work);
+
+    esp_app_desc_t desc;
+    if (ok && esp_ota_get_partition_description(target_part, &desc) != ESP_OK) {
+        fail("no application in the new image");
+        ok = false;
+    }
+
+    ota_update_status_t done;
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    status.duration_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    if (ok) {
+        strlcpy(status.version, desc.version, sizeof(status.version));
+        status.state = OTA_READY;
+    }
+    done = status;
+    xSemaphoreGive(status_mutex);
+
+    if (ok) {
+        ESP_LOGI(TAG, "%s %s written to %s in %lu ms: %lu bytes received, %lu sectors written, %lu unchanged",
+                 done.delta ? "Patch to" : "Image", done.version, target_part->label,
+                 (unsigned long)done.duration_ms, (unsigned long)done.received,
+                 (unsigned long)done.sectors_written, (unsigned long)done.sectors_skipped);
+        if (request_activate) {
+            ota_update_activate();
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Restart timer callback
+ */
+static void restart_callback(void *arg) {
+    if (restart_rollback) {
+        // Does not return: the bootloader takes the previous image
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+    esp_restart();
+}
+
+/**
+ * @brief Confirmation timer of a pending image, once per second
+ */
+static void confirm_callback(void *arg) {
+    pending_s++;
+    healthy_s = (health_check == NULL || health_check()) ? healthy_s + 1 : 0;
+
+    if (healthy_s >= ota_config.confirm_after_s) {
+        esp_timer_stop(confirm_timer);
+        if (esp_ota_mark_app_valid_cancel_rollback() == ESP_OK) {
+            xSemaphoreTake(status_mutex, portMAX_DELAY);
+            status.pending = false;
+            xSemaphoreGive(status_mutex);
+            ESP_LOGI(TAG, "Image %s confirmed after %lu s", ota_update_running_version(),
+                     (unsigned long)pending_s);
+        }
+    } else if (ota_config.rollback_after_s > 0 && pending_s >= ota_config.rollback_after_s) {
+        ESP_LOGE(TAG, "Image %s not healthy after %lu s, rolling back", ota_update_running_version(),
+                 (unsigned long)pending_s);
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+}
+
+esp_err_t ota_update_init(const ota_update_config_t *config, ota_health_fn health) {
+    if (config == NULL || config->confirm_after_s == 0 ||
+        (config->rollback_after_s > 0 && config->rollback_after_s <= config->confirm_after_s)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ota_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ota_config = *config;
+    health_check = health;
+
+    running_part = esp_ota_get_running_partition();
+    target_part = esp_ota_get_next_update_partition(NULL);
+    if (running_part == NULL || target_part == NULL) {
+        ESP_LOGE(TAG, "No second application slot, updates disabled");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    status_mutex = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t restart_args = { .callback = restart_callback, .name = "ota_restart" };
+    const esp_timer_create_args_t confirm_args = { .callback = confirm_callback, .name = "ota_confirm" };
+    if (status_mutex == NULL || esp_timer_create(&restart_args, &restart_timer) != ESP_OK ||
+        esp_timer_create(&confirm_args, &confirm_timer) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(&status, 0, sizeof(status));
+
+    esp_ota_img_states_t image_state;
+    if (esp_ota_get_state_partition(running_part, &image_state) == ESP_OK &&
+        image_state == ESP_OTA_IMG_PENDING_VERIFY) {
+        status.pending = true;
+        esp_timer_start_periodic(confirm_timer, OTA_CONFIRM_PERIOD_US);
+        ESP_LOGW(TAG, "Image %s in %s pending verification (confirm after %u s healthy)",
+                 ota_update_running_version(), running_part->label, ota_config.confirm_after_s);
+    }
+    ota_initialized = true;
+    ESP_LOGI(TAG, "Running %s from %s, updates go to %s (%lu KB)%s", ota_update_running_version(),
+             running_part->label, target_part->label, (unsigned long)(target_part->size / 1024),
+             ota_config.enable ? "" : ", updates disabled");
+    return ESP_OK;
+}
+
+esp_err_t ota_update_request(const char *url, bool activate) {
+    if (!ota_initialized || !ota_config.enable) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (url == NULL || url[0] == '\0') {
+        url = ota_config.url;
+    }
+    if (url[0] == '\0' || strlen(url) >= sizeof(request_url)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    // The other slot holds the rollback image until the running one is confirmed
+    bool busy = status.state == OTA_DOWNLOADING || status.state == OTA_ACTIVATING || status.pending;
+    if (!busy) {
+        memset(&status, 0, sizeof(status));
+        status.state = OTA_DOWNLOADING;
+    }
+    xSemaphoreGive(status_mutex);
+    if (busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ota_work_t *work = malloc(sizeof(ota_work_t));
+    if (work == NULL) {
+        fail("out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+    strlcpy(request_url, url, sizeof(request_url));
+    request_activate = activate;
+    BaseType_t ret = xTaskCreatePinnedToCore(ota_download_task, "ota_update", OTA_TASK_STACK, work,
+                                             OTA_TASK_PRIORITY, NULL, 0);
+    if (ret != pdPASS) {
+        free(work);
+        fail("cannot start the download task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Downloading %s into %s", request_url, target_part->label);
+    return ESP_OK;
+}
+
+esp_err_t ota_update_activate(void) {
+    if (!ota_initialized) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    bool ready = status.state == OTA_READY;
+    xSemaphoreGive(status_mutex);
+    if (!ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Checks the whole image (hash, signature with secure boot) before switching
+    esp_err_t err = esp_ota_set_boot_partition(target_part);
+    if (err != ESP_OK) {
+        fail("image check failed");
+        return err;
+    }
+    set_state(OTA_ACTIVATING);
+    ESP_LOGW(TAG, "Booting the image in %s in %d ms", target_part->label, OTA_RESTART_DELAY_MS);
+    restart_rollback = false;
+    esp_timer_start_once(restart_timer, OTA_RESTART_DELAY_MS * 1000);
+    return ESP_OK;
+}
+
+esp_err_t ota_update_rollback(void) {
+    if (!ota_initialized) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    ota_state_t state = status.state;
+    bool pending = status.pending;
+    xSemaphoreGive(status_mutex);
+    // After a download the other slot no longer holds the previous image
+    if (state == OTA_DOWNLOADING || state == OTA_READY || state == OTA_ACTIVATING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (pending) {
+        restart_rollback = true;
+    } else {
+        esp_app_desc_t desc;
+        if (esp_ota_get_partition_description(target_part, &desc) != ESP_OK ||
+            esp_ota_set_boot_partition(target_part) != ESP_OK) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        restart_rollback = false;
+    }
+    esp_timer_stop(confirm_timer);
+    set_state(OTA_ACTIVATING);
+    ESP_LOGW(TAG, "Rolling back to the image in %s in %d ms", target_part->label, OTA_RESTART_DELAY_MS);
+    esp_timer_start_once(restart_timer, OTA_RESTART_DELAY_MS * 1000);
+    return ESP_OK;
+}
+
+void ota_update_get_status(ota_update_status_t *out) {
+    if (out == NULL) {
+        return;
+    }
+    if (!ota_initialized) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(status_mutex, portMAX_DELAY);
+    *out = status;
+    xSemaphoreGive(status_mutex);
+}
+
+const char *ota_update_running_version(void) {
+    return esp_app_get_description()->version;
+}
+
+const char *ota_update_running_slot(void) {
+    const esp_partition_t *part = running_part ? running_part : esp_ota_get_running_partition();
+    return part ? part->label : "";
+}
+
+const char *ota_update_state_name(ota_state_t state) {
+    switch (state) {
+        case OTA_DOWNLOADING: return "downloading";
+        case OTA_READY:       return "ready";
+        case OTA_ACTIVATING:  return "activating";
+        case OTA_FAILED:      return "failed";
+        default:              return "idle";
+    }
+}
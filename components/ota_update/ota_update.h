@@ -0,0 +1,170 @@
+/* ota_update.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * A/B Firmware Update
+ * ============================================================================
+ *
+ * The flash holds two application slots (ota_0, ota_1 in partitions.csv).
+ * An update is downloaded over HTTP into the slot that is not running while
+ * the gateway keeps serving. The stream is either a full image or a delta
+ * patch against the running image (delta_patch.h, made by tools/ota_delta.c);
+ * both are written sector by sector, and sectors the slot already holds are
+ * not erased again. RAM use is fixed: one receive buffer, the patch state and
+ * one sector buffer, allocated for the duration of the download.
+ *
+ * Nothing changes for the next boot until ota_update_activate(): it checks
+ * the new image and switches the boot slot in the otadata partition (one
+ * atomic sector write), then restarts. The new image boots pending
+ * verification (CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE). It is confirmed once
+ * the health check has passed for confirm_after_s; if the gateway resets
+ * before that, or is still not healthy after rollback_after_s, the
+ * bootloader returns to the previous image.
+ */
+
+/** @brief Bytes read from the HTTP stream per call */
+#define OTA_RX_CHUNK                1024
+/** @brief HTTP timeout in milliseconds */
+#define OTA_HTTP_TIMEOUT_MS         10000
+/** @brief Delay between activation and restart (lets the method response out) */
+#define OTA_RESTART_DELAY_MS        500
+/** @brief Longest update URL */
+#define OTA_URL_MAX                 128
+
+/**
+ * @brief Update service configuration
+ */
+typedef struct {
+    bool enable;                    /**< Accept updates */
+    char url[OTA_URL_MAX];          /**< Default URL when an update request gives none */
+    uint16_t confirm_after_s;       /**< Healthy run time before a new image is confirmed */
+    uint16_t rollback_after_s;      /**< Roll back a new image not healthy by then (0 = only on reset) */
+} ota_update_config_t;
+
+/**
+ * @brief State of the update service
+ */
+typedef enum {
+    OTA_IDLE = 0,               /**< No update since boot */
+    OTA_DOWNLOADING,            /**< Receiving and writing the other slot */
+    OTA_READY,                  /**< Other slot holds a checked image, waiting for activation */
+    OTA_ACTIVATING,             /**< Boot slot switched, restarting */
+    OTA_FAILED                  /**< Last update failed (see error) */
+} ota_state_t;
+
+/**
+ * @brief Progress and result of the last update
+ */
+typedef struct {
+    ota_state_t state;          /**< Current state */
+    bool delta;                 /**< The stream is a delta patch */
+    bool pending;               /**< The running image is not confirmed yet */
+    uint32_t received;          /**< Stream bytes received */
+    uint32_t total;             /**< Stream size from Content-Length (0 = unknown) */
+    uint32_t image_size;        /**< Bytes of the new image */
+    uint32_t sectors_written;   /**< Sectors erased and programmed */
+    uint32_t sectors_skipped;   /**< Sectors the slot already held */
+    uint32_t duration_ms;       /**< Download and write time */
+    char version[32];           /**< Version of the new image */
+    char error[48];             /**< Reason of the last failure */
+} ota_update_status_t;
+
+/**
+ * @brief Health check for the confirmation of a new image
+ *
+ * @return true while the gateway does its job (network up, server running)
+ */
+typedef bool (*ota_health_fn)(void);
+
+/**
+ * @brief Initialize the update service
+ *
+ * Call once at boot. When the running image is pending verification, the
+ * confirmation timer starts here.
+ *
+ * @param config Configuration (copied)
+ * @param health Health check for the confirmation (NULL = always healthy)
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NOT_FOUND without a
+ *         second application slot
+ */
+esp_err_t ota_update_init(const ota_update_config_t *config, ota_health_fn health);
+
+/**
+ * @brief Start downloading an update into the other slot
+ *
+ * Returns at once; the download runs in its own task.
+ *
+ * @param url HTTP URL of a full image or a delta patch (NULL or "" = configured URL)
+ * @param activate Activate and restart as soon as the image is written
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_SUPPORTED when disabled,
+ *         ESP_ERR_INVALID_ARG without a URL, ESP_ERR_INVALID_STATE while
+ *         an update runs or the running image is not confirmed yet (the
+ *         other slot still holds the rollback image), ESP_ERR_NO_MEM
+ */
+esp_err_t ota_update_request(const char *url, bool activate);
+
+/**
+ * @brief Boot the downloaded image
+ *
+ * Switches the boot slot and restarts after OTA_RESTART_DELAY_MS.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE unless an image is ready,
+ *         or the error of the image check
+ */
+esp_err_t ota_update_activate(void);
+
+/**
+ * @brief Go back to the image in the other slot
+ *
+ * A running image pending verification is marked invalid; otherwise the
+ * other slot must hold a valid image. Restarts after OTA_RESTART_DELAY_MS.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND without a bootable image in
+ *         the other slot, ESP_ERR_INVALID_STATE while an update runs
+ */
+esp_err_t ota_update_rollback(void);
+
+/**
+ * @brief Get the progress of the last update
+ *
+ * @param status Pointer to store the progress
+ */
+void ota_update_get_status(ota_update_status_t *status);
+
+/**
+ * @brief Version of the running image
+ *
+ * @return const char* Application version (PROJECT_VER)
+ */
+const char *ota_update_running_version(void);
+
+/**
+ * @brief Label of the running slot
+ *
+ * @return const char* "ota_0" or "ota_1"
+ */
+const char *ota_update_running_slot(void);
+
+/**
+ * @brief Name of a state
+ *
+ * @param state State
+ * @return const char* "idle", "downloading", "ready", "activating" or "failed"
+ */
+const char *ota_update_state_name(ota_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OTA_UPDATE_H */
@@ -0,0 +1,275 @@
+/* ota_update_ua.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "ota_update_ua.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "ota_update";
+
+/**
+ * @brief Firmware variables (node context of the shared read callback)
+ */
+typedef enum {
+    FIRMWARE_VAR_VERSION = 0,
+    FIRMWARE_VAR_SLOT,
+    FIRMWARE_VAR_PENDING,
+    FIRMWARE_VAR_STATE,
+    FIRMWARE_VAR_ERROR,
+    FIRMWARE_VAR_DELTA,
+    FIRMWARE_VAR_RECEIVED,
+    FIRMWARE_VAR_TOTAL,
+    FIRMWARE_VAR_IMAGE_SIZE,
+    FIRMWARE_VAR_SECTORS_WRITTEN,
+    FIRMWARE_VAR_SECTORS_SKIPPED,
+    FIRMWARE_VAR_DURATION,
+    FIRMWARE_VAR_NEW_VERSION
+} firmware_var_t;
+
+/**
+ * @brief OPC UA read callback for the Firmware variables
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Variable (firmware_var_t)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readFirmwareVariable(UA_Server *server,
+                     const UA_NodeId *sessionId, void *sessionContext,
+                     const UA_NodeId *nodeId, void *nodeContext,
+                     UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                     UA_DataValue *dataValue) {
+    ota_update_status_t status;
+    ota_update_get_status(&status);
+
+    UA_String text;
+    UA_Boolean flag;
+    const UA_UInt32 *number = NULL;
+    const UA_Boolean *boolean = NULL;
+    switch ((firmware_var_t)(uintptr_t)nodeContext) {
+        case FIRMWARE_VAR_VERSION:     text = UA_STRING((char *)ota_update_running_version()); break;
+        case FIRMWARE_VAR_SLOT:        text = UA_STRING((char *)ota_update_running_slot()); break;
+        case FIRMWARE_VAR_STATE:       text = UA_STRING((char *)ota_update_state_name(status.state)); break;
+        case FIRMWARE_VAR_ERROR:       text = UA_STRING(status.error); break;
+        case FIRMWARE_VAR_NEW_VERSION: text = UA_STRING(status.version); break;
+        case FIRMWARE_VAR_PENDING:     flag = status.pending; boolean = &flag; break;
+        case FIRMWARE_VAR_DELTA:       flag = status.delta; boolean = &flag; break;
+        case FIRMWARE_VAR_RECEIVED:        number = &status.received; break;
+        case FIRMWARE_VAR_TOTAL:           number = &status.total; break;
+        case FIRMWARE_VAR_IMAGE_SIZE:      number = &status.image_size; break;
+        case FIRMWARE_VAR_SECTORS_WRITTEN: number = &status.sectors_written; break;
+        case FIRMWARE_VAR_SECTORS_SKIPPED: number = &status.sectors_skipped; break;
+        case FIRMWARE_VAR_DURATION:        number = &status.duration_ms; break;
+        default:
+            return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    if (number != NULL) {
+        UA_Variant_setScalarCopy(&dataValue->value, number, &UA_TYPES[UA_TYPES_UINT32]);
+    } else if (boolean != NULL) {
+        UA_Variant_setScalarCopy(&dataValue->value, boolean, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    } else {
+        UA_Variant_setScalarCopy(&dataValue->value, &text, &UA_TYPES[UA_TYPES_STRING]);
+    }
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+#ifdef UA_ENABLE_METHODCALLS
+
+/**
+ * @brief Map a service error to a method result
+ */
+static UA_StatusCode status_from_err(esp_err_t err) {
+    switch (err) {
+        case ESP_OK:                return UA_STATUSCODE_GOOD;
+        case ESP_ERR_INVALID_ARG:   return UA_STATUSCODE_BADINVALIDARGUMENT;
+        case ESP_ERR_INVALID_STATE: return UA_STATUSCODE_BADINVALIDSTATE;
+        case ESP_ERR_NOT_SUPPORTED: return UA_STATUSCODE_BADNOTSUPPORTED;
+        case ESP_ERR_NOT_FOUND:     return UA_STATUSCODE_BADNOTFOUND;
+        case ESP_ERR_NO_MEM:        return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        default:                    return UA_STATUSCODE_BADINTERNALERROR;
+    }
+}
+
+/**
+ * @brief Update(Url, Activate)
+ */
+static UA_StatusCode
+updateMethod(UA_Server *server,
+             const UA_NodeId *sessionId, void *sessionContext,
+             const UA_NodeId *methodId, void *methodContext,
+             const UA_NodeId *objectId, void *objectContext,
+             size_t inputSize, const UA_Variant *input,
+             size_t outputSize, UA_Variant *output) {
+    const UA_String *url = (const UA_String *)input[0].data;
+    UA_Boolean activate = *(const UA_Boolean *)input[1].data;
+
+    char buffer[OTA_URL_MAX];
+    if (url->length >= sizeof(buffer)) {
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+    if (url->length > 0) {
+        memcpy(buffer, url->data, url->length);
+    }
+    buffer[url->length] = '\0';
+    return status_from_err(ota_update_request(buffer, activate));
+}
+
+/**
+ * @brief Activate()
+ */
+static UA_StatusCode
+activateMethod(UA_Server *server,
+               const UA_NodeId *sessionId, void *sessionContext,
+               const UA_NodeId *methodId, void *methodContext,
+               const UA_NodeId *objectId, void *objectContext,
+               size_t inputSize, const UA_Variant *input,
+               size_t outputSize, UA_Variant *output) {
+    return status_from_err(ota_update_activate());
+}
+
+/**
+ * @brief Rollback()
+ */
+static UA_StatusCode
+rollbackMethod(UA_Server *server,
+               const UA_NodeId *sessionId, void *sessionContext,
+               const UA_NodeId *methodId, void *methodContext,
+               const UA_NodeId *objectId, void *objectContext,
+               size_t inputSize, const UA_Variant *input,
+               size_t outputSize, UA_Variant *output) {
+    return status_from_err(ota_update_rollback());
+}
+
+/**
+ * @brief Fill a method argument description
+ */
+static UA_Argument make_argument(const char *name, const char *description, UA_UInt32 typeIndex) {
+    UA_Argument arg;
+    UA_Argument_init(&arg);
+    arg.name = UA_STRING((char *)name);
+    arg.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    arg.dataType = UA_TYPES[typeIndex].typeId;
+    arg.valueRank = UA_VALUERANK_SCALAR;
+    return arg;
+}
+
+/**
+ * @brief Add one method to the Firmware object
+ */
+static void add_method(UA_Server *server, const UA_NodeId *parent, const char *id,
+                       const char *name, const char *description, UA_MethodCallback callback,
+                       size_t inputSize, const UA_Argument *inputs) {
+    UA_MethodAttributes attr = UA_MethodAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.executable = true;
+    attr.userExecutable = true;
+
+    UA_StatusCode status = UA_Server_addMethodNode(server, UA_NODEID_STRING(1, (char *)id), *parent,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                                   UA_QUALIFIEDNAME(1, (char *)name), attr, callback,
+                                                   inputSize, inputs, 0, NULL, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add method %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+#endif /* UA_ENABLE_METHODCALLS */
+
+/**
+ * @brief Add one read-only variable to the Firmware object
+ */
+static void add_variable(UA_Server *server, const UA_NodeId *parent, const char *id,
+                         const char *name, const char *description, UA_UInt32 typeIndex,
+                         firmware_var_t var) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.dataType = UA_TYPES[typeIndex].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ;
+
+    UA_DataSource source = { readFirmwareVariable, NULL };
+    UA_StatusCode status = UA_Server_addDataSourceVariableNode(
+        server, UA_NODEID_STRING(1, (char *)id), *parent,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), UA_QUALIFIEDNAME(1, (char *)name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, source,
+        (void *)(uintptr_t)var, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add variable %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Add the Firmware object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void ota_update_add_ua_nodes(UA_Server *server) {
+    UA_NodeId firmwareId = UA_NODEID_STRING(1, "firmware");
+    UA_ObjectAttributes objAttr = UA_ObjectAttributes_default;
+    objAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Firmware");
+    objAttr.description = UA_LOCALIZEDTEXT("en-US", "Running image and A/B firmware update");
+    UA_StatusCode status = UA_Server_addObjectNode(server, firmwareId,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                                   UA_QUALIFIEDNAME(1, "Firmware"),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                                   objAttr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add Firmware object: 0x%08lX", (unsigned long)status);
+        return;
+    }
+
+    add_variable(server, &firmwareId, "firmware.Version", "Version",
+                 "Version of the running image", UA_TYPES_STRING, FIRMWARE_VAR_VERSION);
+    add_variable(server, &firmwareId, "firmware.Slot", "Slot",
+                 "Application slot of the running image", UA_TYPES_STRING, FIRMWARE_VAR_SLOT);
+    add_variable(server, &firmwareId, "firmware.Pending", "Pending",
+                 "Running image boots pending verification, not confirmed yet", UA_TYPES_BOOLEAN,
+                 FIRMWARE_VAR_PENDING);
+    add_variable(server, &firmwareId, "firmware.State", "State",
+                 "Update state: idle, downloading, ready, activating or failed", UA_TYPES_STRING,
+                 FIRMWARE_VAR_STATE);
+    add_variable(server, &firmwareId, "firmware.Error", "Error",
+                 "Reason of the last failed update", UA_TYPES_STRING, FIRMWARE_VAR_ERROR);
+    add_variable(server, &firmwareId, "firmware.Delta", "Delta",
+                 "Last update was a delta patch", UA_TYPES_BOOLEAN, FIRMWARE_VAR_DELTA);
+    add_variable(server, &firmwareId, "firmware.Received", "Received",
+                 "Update bytes received", UA_TYPES_UINT32, FIRMWARE_VAR_RECEIVED);
+    add_variable(server, &firmwareId, "firmware.Total", "Total",
+                 "Update size announced by the server (0 = unknown)", UA_TYPES_UINT32,
+                 FIRMWARE_VAR_TOTAL);
+    add_variable(server, &firmwareId, "firmware.ImageSize", "ImageSize",
+                 "Bytes of the new image", UA_TYPES_UINT32, FIRMWARE_VAR_IMAGE_SIZE);
+    add_variable(server, &firmwareId, "firmware.SectorsWritten", "SectorsWritten",
+                 "Flash sectors erased and programmed", UA_TYPES_UINT32, FIRMWARE_VAR_SECTORS_WRITTEN);
+    add_variable(server, &firmwareId, "firmware.SectorsSkipped", "SectorsSkipped",
+                 "Flash sectors the slot already held", UA_TYPES_UINT32, FIRMWARE_VAR_SECTORS_SKIPPED);
+    add_variable(server, &firmwareId, "firmware.DurationMs", "DurationMs",
+                 "Download and write time of the last update", UA_TYPES_UINT32, FIRMWARE_VAR_DURATION);
+    add_variable(server, &firmwareId, "firmware.NewVersion", "NewVersion",
+                 "Version of the downloaded image", UA_TYPES_STRING, FIRMWARE_VAR_NEW_VERSION);
+
+#ifdef UA_ENABLE_METHODCALLS
+    UA_Argument updateArgs[2] = {
+        make_argument("Url", "HTTP URL of an image or a delta patch (empty = configured URL)",
+                      UA_TYPES_STRING),
+        make_argument("Activate", "Restart into the new image once written", UA_TYPES_BOOLEAN)
+    };
+    add_method(server, &firmwareId, "firmware.Update", "Update",
+               "Download an update into the other slot", updateMethod, 2, updateArgs);
+    add_method(server, &firmwareId, "firmware.Activate", "Activate",
+               "Boot the downloaded image", activateMethod, 0, NULL);
+    add_method(server, &firmwareId, "firmware.Rollback", "Rollback",
+               "Boot the image in the other slot again", rollbackMethod, 0, NULL);
+#endif
+
+    ESP_LOGI(TAG, "Firmware object added (%s in %s)", ota_update_running_version(),
+             ota_update_running_slot());
+}
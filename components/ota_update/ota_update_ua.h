@@ -0,0 +1,51 @@
+/* ota_update_ua.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef OTA_UPDATE_UA_H
+#define OTA_UPDATE_UA_H
+
+#include "open62541.h"
+#include "ota_update.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * OPC UA Firmware Object
+ * ============================================================================
+ *
+ * Objects/Firmware (ns=1;s=firmware):
+ *
+ *   Version, Slot          String   running image and its slot
+ *   Pending                Boolean  running image not confirmed yet
+ *   State, Error           String   update state, reason of the last failure
+ *   Delta                  Boolean  last update was a delta patch
+ *   Received, Total        UInt32   stream bytes received, Content-Length
+ *   ImageSize              UInt32   bytes of the new image
+ *   SectorsWritten         UInt32   sectors erased and programmed
+ *   SectorsSkipped         UInt32   sectors the slot already held
+ *   DurationMs             UInt32   download and write time
+ *   NewVersion             String   version of the downloaded image
+ *
+ *   Update(Url String, Activate Boolean)
+ *   Activate()
+ *   Rollback()
+ *
+ * Update returns at once; State goes from downloading to ready (or failed).
+ * Activate and Rollback restart the gateway OTA_RESTART_DELAY_MS after the
+ * response. The method node ids start with "firmware." and are reserved for
+ * the admin user. Without UA_ENABLE_METHODCALLS only the variables are added.
+ */
+
+/**
+ * @brief Add the Firmware object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void ota_update_add_ua_nodes(UA_Server *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OTA_UPDATE_UA_H */
@@ -0,0 +1,525 @@
+/* redundancy.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "redundancy.h"
+#include "io_cache.h"
+#include "model.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "mbedtls/md.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "redundancy";
+
+#define REDUNDANCY_TASK_STACK       4096    /**< Redundancy task stack size */
+#define REDUNDANCY_TASK_PRIORITY    9       /**< Above I/O polling: a takeover must not wait for a scan */
+#define REDUNDANCY_AGE_NONE         0xFFFFFFFFu /**< Age of a value that was never set */
+
+_Static_assert(REDUNDANCY_ADC_CHANNELS == IO_CACHE_ADC_CHANNELS,
+               "redundancy image must match the io_cache snapshot");
+_Static_assert(sizeof(redundancy_packet_t) == 84, "redundancy datagram layout changed");
+
+static redundancy_config_t red_config;
+static bool red_enabled = false;
+static int red_socket = -1;
+static struct sockaddr_in peer_addr;
+static uint32_t boot_id;
+
+static SemaphoreHandle_t state_mutex = NULL;
+static redundancy_status_t state;
+
+/* Task-only state */
+static int64_t start_ms;
+static int64_t last_send_ms;
+static int64_t last_peer_ms = -1;           /**< Last datagram of the peer (-1 = never) */
+static int64_t last_active_ms = -1;         /**< Last datagram of the peer while it was active */
+static uint32_t peer_boot_id;
+static uint32_t peer_packet;
+static uint32_t peer_epoch;
+static redundancy_role_t peer_role;
+static uint32_t sent_sequence;
+static uint16_t replicated_outputs;
+
+/**
+ * @brief Monotonic time in milliseconds
+ */
+static int64_t now_ms(void) {
+    return esp_timer_get_time() / 1000;
+}
+
+/**
+ * @brief Tick time in milliseconds (io_cache timestamps)
+ */
+static uint64_t tick_ms(void) {
+    return (uint64_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+static uint32_t age_of(uint64_t now, uint64_t timestamp_ms) {
+    if (timestamp_ms == 0) {
+        return REDUNDANCY_AGE_NONE;
+    }
+    return timestamp_ms >= now ? 0 : (uint32_t)(now - timestamp_ms);
+}
+
+static uint64_t timestamp_of(uint64_t now, uint32_t age_ms) {
+    if (age_ms == REDUNDANCY_AGE_NONE) {
+        return 0;
+    }
+    return age_ms < now ? now - age_ms : 1;
+}
+
+/**
+ * @brief HMAC-SHA256 of a datagram with the pairing key, truncated
+ *
+ * @param pkt Datagram; the MAC covers everything before its mac field
+ * @param mac Pointer to store REDUNDANCY_MAC_LEN bytes
+ * @return true on success
+ */
+static bool compute_mac(const redundancy_packet_t *pkt, uint8_t mac[REDUNDANCY_MAC_LEN]) {
+    uint8_t full[32];
+    if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                        (const unsigned char *)red_config.pair_key, strlen(red_config.pair_key),
+                        (const unsigned char *)pkt, offsetof(redundancy_packet_t, mac), full) != 0) {
+        return false;
+    }
+    memcpy(mac, full, REDUNDANCY_MAC_LEN);
+    return true;
+}
+
+/**
+ * @brief Check the MAC of a received datagram in constant time
+ */
+static bool mac_valid(const redundancy_packet_t *pkt) {
+    uint8_t expected[REDUNDANCY_MAC_LEN];
+    if (!compute_mac(pkt, expected)) {
+        return false;
+    }
+    uint8_t diff = 0;
+    for (int i = 0; i < REDUNDANCY_MAC_LEN; i++) {
+        diff |= expected[i] ^ pkt->mac[i];
+    }
+    return diff == 0;
+}
+
+/**
+ * @brief Count a dropped datagram
+ */
+static void reject_packet(const char *reason) {
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    state.rejected++;
+    xSemaphoreGive(state_mutex);
+    ESP_LOGD(TAG, "Datagram rejected: %s", reason);
+}
+
+/**
+ * @brief Change the state (under state_mutex)
+ */
+static void set_state(redundancy_state_t next) {
+    if (state.state != next) {
+        ESP_LOGI(TAG, "%s -> %s (epoch %lu)", redundancy_state_name(state.state),
+                 redundancy_state_name(next), (unsigned long)state.epoch);
+    }
+    state.state = next;
+}
+
+/**
+ * @brief Send the current image
+ */
+static void send_packet(int64_t now) {
+    io_cache_snapshot_t image;
+    if (!io_cache_get_snapshot(&image)) {
+        return;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    redundancy_packet_t pkt = {
+        .magic = REDUNDANCY_MAGIC,
+        .version = REDUNDANCY_VERSION,
+        .state = (uint8_t)state.state,
+        .role = (uint8_t)red_config.role,
+        .boot_id = boot_id,
+        .epoch = state.epoch,
+        .packet = state.sent + 1,
+        .sequence = image.sequence,
+        .discrete_inputs = image.discrete_inputs,
+        .discrete_outputs = image.discrete_outputs
+    };
+    xSemaphoreGive(state_mutex);
+
+    uint64_t ticks = tick_ms();
+    pkt.inputs_age_ms = age_of(ticks, image.inputs_timestamp_ms);
+    pkt.outputs_age_ms = age_of(ticks, image.outputs_timestamp_ms);
+    for (int i = 0; i < REDUNDANCY_ADC_CHANNELS; i++) {
+        pkt.adc[i] = image.adc[i];
+        pkt.adc_valid |= image.adc_valid[i] ? (uint8_t)(1u << i) : 0;
+        pkt.adc_age_ms[i] = age_of(ticks, image.adc_timestamps_ms[i]);
+    }
+    if (!compute_mac(&pkt, pkt.mac)) {
+        return;
+    }
+
+    if (sendto(red_socket, &pkt, sizeof(pkt), 0,
+               (const struct sockaddr *)&peer_addr, sizeof(peer_addr)) == (int)sizeof(pkt)) {
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        state.sent++;
+        if (state.state == REDUNDANCY_ACTIVE) {
+            state.sequence = image.sequence;
+        }
+        xSemaphoreGive(state_mutex);
+    }
+    sent_sequence = image.sequence;
+    last_send_ms = now;
+}
+
+/**
+ * @brief Put the replicated image into the cache
+ */
+static void apply_image(const redundancy_packet_t *pkt) {
+    io_cache_snapshot_t image = {
+        .sequence = pkt->sequence,
+        .discrete_inputs = pkt->discrete_inputs,
+        .discrete_outputs = pkt->discrete_outputs
+    };
+    uint64_t ticks = tick_ms();
+    image.inputs_timestamp_ms = timestamp_of(ticks, pkt->inputs_age_ms);
+    image.outputs_timestamp_ms = timestamp_of(ticks, pkt->outputs_age_ms);
+    for (int i = 0; i < REDUNDANCY_ADC_CHANNELS; i++) {
+        image.adc[i] = pkt->adc[i];
+        image.adc_valid[i] = (pkt->adc_valid & (1u << i)) != 0;
+        image.adc_timestamps_ms[i] = timestamp_of(ticks, pkt->adc_age_ms[i]);
+    }
+    if (io_cache_apply_snapshot(&image)) {
+        replicated_outputs = pkt->discrete_outputs;
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        state.applied++;
+        state.sequence = io_cache_get_sequence();
+        xSemaphoreGive(state_mutex);
+    }
+}
+
+/**
+ * @brief Check whether this unit stays active when the peer is active too
+ */
+static bool wins_against_peer(uint32_t epoch) {
+    if (epoch != peer_epoch) {
+        return epoch > peer_epoch;
+    }
+    if (red_config.role != peer_role) {
+        return red_config.role == REDUNDANCY_PRIMARY;
+    }
+    return boot_id > peer_boot_id;
+}
+
+/**
+ * @brief Become active
+ *
+ * @param takeover true if the active peer went silent (not at startup)
+ */
+static void become_active(int64_t now, bool takeover) {
+    // Outputs and writes first: a client that sees ServiceLevel 255 may write at once
+    if (takeover) {
+        // Outputs continue with the last command of the failed unit
+        write_discrete_outputs_slow(replicated_outputs);
+    }
+    io_cache_set_replica(false);
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    uint32_t epoch = state.epoch > peer_epoch ? state.epoch : peer_epoch;
+    state.epoch = takeover ? epoch + 1 : epoch;
+    uint32_t takeover_ms = 0;
+    if (takeover) {
+        state.takeovers++;
+        state.takeover_ms = last_active_ms >= 0 ? (uint32_t)(now - last_active_ms) : 0;
+        takeover_ms = state.takeover_ms;
+    }
+    set_state(REDUNDANCY_ACTIVE);
+    xSemaphoreGive(state_mutex);
+
+    if (takeover) {
+        ESP_LOGW(TAG, "Took over after %lu ms without the active peer, outputs 0x%04X",
+                 (unsigned long)takeover_ms, replicated_outputs);
+    }
+    send_packet(now);
+}
+
+/**
+ * @brief Become standby: release the outputs and follow the peer
+ */
+static void become_standby(void) {
+    io_cache_set_replica(true);
+    write_discrete_outputs_slow(0);
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    set_state(REDUNDANCY_STANDBY);
+    xSemaphoreGive(state_mutex);
+}
+
+/**
+ * @brief Process one datagram of the peer
+ */
+static void handle_packet(const redundancy_packet_t *pkt, int64_t now) {
+    if (pkt->magic != REDUNDANCY_MAGIC || pkt->version != REDUNDANCY_VERSION) {
+        reject_packet("magic or version");
+        return;
+    }
+    if (!mac_valid(pkt)) {
+        reject_packet("MAC");
+        return;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (pkt->boot_id == peer_boot_id && pkt->packet <= peer_packet) {
+        // Same boot of the peer, counter not ahead: a repeated datagram
+        state.rejected++;
+        xSemaphoreGive(state_mutex);
+        ESP_LOGD(TAG, "Datagram rejected: replayed counter %lu", (unsigned long)pkt->packet);
+        return;
+    }
+    if (pkt->boot_id != peer_boot_id) {
+        peer_boot_id = pkt->boot_id;
+    } else if (pkt->packet > peer_packet + 1) {
+        state.lost += pkt->packet - peer_packet - 1;
+    }
+    peer_packet = pkt->packet;
+    peer_epoch = pkt->epoch;
+    peer_role = (redundancy_role_t)pkt->role;
+    state.peer_state = (redundancy_state_t)pkt->state;
+    state.received++;
+    redundancy_state_t own = state.state;
+    uint32_t epoch = state.epoch;
+    xSemaphoreGive(state_mutex);
+
+    last_peer_ms = now;
+    bool peer_active = pkt->state == REDUNDANCY_ACTIVE;
+    if (peer_active) {
+        last_active_ms = now;
+    }
+
+    switch (own) {
+        case REDUNDANCY_STARTUP:
+            if (peer_active) {
+                become_standby();
+                apply_image(pkt);
+            }
+            break;
+        case REDUNDANCY_ACTIVE:
+            if (peer_active && !wins_against_peer(epoch)) {
+                ESP_LOGW(TAG, "Peer is active too (epoch %lu), dropping to standby",
+                         (unsigned long)pkt->epoch);
+                become_standby();
+                apply_image(pkt);
+            } else if (!peer_active && (int32_t)(pkt->sequence - sent_sequence) > 0) {
+                // Continue from the number the standby has seen
+                io_cache_advance_sequence(pkt->sequence);
+            }
+            break;
+        case REDUNDANCY_STANDBY:
+            if (peer_active) {
+                apply_image(pkt);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Timeouts and sending, once per loop
+ */
+static void step(int64_t now) {
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    redundancy_state_t own = state.state;
+    if (last_peer_ms >= 0 && now - last_peer_ms >= red_config.failover_ms) {
+        state.peer_state = REDUNDANCY_LOST;
+    }
+    xSemaphoreGive(state_mutex);
+
+    bool peer_heard = last_peer_ms >= 0 && now - last_peer_ms < red_config.failover_ms;
+    switch (own) {
+        case REDUNDANCY_STARTUP:
+            if (now - start_ms >= (int64_t)REDUNDANCY_STARTUP_FACTOR * red_config.failover_ms) {
+                // A backup that hears the primary starting lets it decide
+                if (!peer_heard || red_config.role == REDUNDANCY_PRIMARY ||
+                    peer_role == REDUNDANCY_BACKUP) {
+                    become_active(now, false);
+                }
+            }
+            break;
+        case REDUNDANCY_STANDBY:
+            if (last_active_ms < 0 || now - last_active_ms >= red_config.failover_ms) {
+                become_active(now, true);
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (state.state == REDUNDANCY_ACTIVE && io_cache_get_sequence() != sent_sequence) {
+        send_packet(now);
+    } else if (now - last_send_ms >= red_config.heartbeat_ms) {
+        send_packet(now);
+    }
+}
+
+/**
+ * @brief Redundancy task: receive, check timeouts, send
+ */
+static void redundancy_task(void *arg) {
+    start_ms = now_ms();
+    last_send_ms = start_ms - red_config.heartbeat_ms;
+    while (1) {
+        redundancy_packet_t pkt;
+        struct sockaddr_in source;
+        socklen_t source_len = sizeof(source);
+        int len = recvfrom(red_socket, &pkt, sizeof(pkt), 0, (struct sockaddr *)&source, &source_len);
+        int64_t now = now_ms();
+        if (len >= 0) {
+            // Only the configured peer may talk to this unit
+            if (source_len < sizeof(source) || source.sin_family != AF_INET ||
+                source.sin_addr.s_addr != peer_addr.sin_addr.s_addr ||
+                source.sin_port != peer_addr.sin_port) {
+                reject_packet("source");
+            } else if (len != (int)sizeof(pkt)) {
+                reject_packet("length");
+            } else {
+                handle_packet(&pkt, now);
+            }
+        }
+        step(now);
+    }
+}
+
+esp_err_t redundancy_start(const redundancy_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!config->enable) {
+        ESP_LOGI(TAG, "Redundancy disabled");
+        return ESP_OK;
+    }
+    if (red_enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config->heartbeat_ms == 0 || config->failover_ms <= config->heartbeat_ms) {
+        ESP_LOGE(TAG, "failover_ms must be longer than heartbeat_ms");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->pair_key[0] == '\0') {
+        ESP_LOGE(TAG, "pair_key must be set, the same on both units");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    red_config = *config;
+    red_config.pair_key[REDUNDANCY_KEY_MAX] = '\0';
+    if (red_config.local_port == 0) {
+        red_config.local_port = REDUNDANCY_DEFAULT_PORT;
+    }
+    if (red_config.peer_port == 0) {
+        red_config.peer_port = REDUNDANCY_DEFAULT_PORT;
+    }
+    memset(&peer_addr, 0, sizeof(peer_addr));
+    peer_addr.sin_family = AF_INET;
+    peer_addr.sin_port = htons(red_config.peer_port);
+    if (inet_pton(AF_INET, red_config.peer_host, &peer_addr.sin_addr) != 1) {
+        ESP_LOGE(TAG, "Invalid peer address %s", red_config.peer_host);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    state_mutex = xSemaphoreCreateMutex();
+    if (state_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    red_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (red_socket < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_port = htons(red_config.local_port),
+        .sin_addr.s_addr = htonl(INADDR_ANY)
+    };
+    if (bind(red_socket, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        ESP_LOGE(TAG, "Failed to bind UDP port %u: errno %d", red_config.local_port, errno);
+        close(red_socket);
+        red_socket = -1;
+        return ESP_FAIL;
+    }
+    struct timeval tv = { .tv_sec = 0, .tv_usec = REDUNDANCY_TICK_MS * 1000 };
+    setsockopt(red_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    boot_id = esp_random();
+    memset(&state, 0, sizeof(state));
+    state.role = red_config.role;
+    state.state = REDUNDANCY_STARTUP;
+    state.peer_state = REDUNDANCY_LOST;
+    peer_role = red_config.role == REDUNDANCY_PRIMARY ? REDUNDANCY_BACKUP : REDUNDANCY_PRIMARY;
+
+    // Hands off the I/O until the startup decision
+    io_cache_set_replica(true);
+    red_enabled = true;
+
+    BaseType_t ret = xTaskCreatePinnedToCore(redundancy_task, "redundancy", REDUNDANCY_TASK_STACK,
+                                             NULL, REDUNDANCY_TASK_PRIORITY, NULL, 1);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create redundancy task");
+        io_cache_set_replica(false);
+        red_enabled = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Redundancy started as %s, peer %s:%u, heartbeat %u ms, failover %u ms",
+             redundancy_role_name(red_config.role), red_config.peer_host, red_config.peer_port,
+             red_config.heartbeat_ms, red_config.failover_ms);
+    return ESP_OK;
+}
+
+bool redundancy_enabled(void) {
+    return red_enabled;
+}
+
+redundancy_state_t redundancy_get_state(void) {
+    if (!red_enabled) {
+        return REDUNDANCY_ACTIVE;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    redundancy_state_t current = state.state;
+    xSemaphoreGive(state_mutex);
+    return current;
+}
+
+void redundancy_get_status(redundancy_status_t *status) {
+    if (status == NULL) {
+        return;
+    }
+    if (!red_enabled) {
+        memset(status, 0, sizeof(*status));
+        status->state = REDUNDANCY_ACTIVE;
+        status->peer_state = REDUNDANCY_LOST;
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *status = state;
+    xSemaphoreGive(state_mutex);
+}
+
+const redundancy_config_t *redundancy_get_config(void) {
+    return &red_config;
+}
+
+const char *redundancy_state_name(redundancy_state_t state) {
+    switch (state) {
+        case REDUNDANCY_ACTIVE:  return "active";
+        case REDUNDANCY_STANDBY: return "standby";
+        case REDUNDANCY_LOST:    return "lost";
+        default:                 return "startup";
+    }
+}
+
+const char *redundancy_role_name(redundancy_role_t role) {
+    return role == REDUNDANCY_BACKUP ? "backup" : "primary";
+}
@@ -0,0 +1,202 @@
+/* redundancy.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef REDUNDANCY_H
+#define REDUNDANCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Hot-Standby Redundancy
+ * ============================================================================
+ *
+ * Two gateways form a pair. One is active: it scans its I/O, drives its
+ * outputs and sends its process image to the peer. The other is standby: its
+ * io_cache is a replica of the active image (io_cache_set_replica()), its
+ * polling task is idle, its outputs stay off and writes to them are refused.
+ * Clients may read from both; the OPC UA ServiceLevel tells them which one is
+ * active (non-transparent redundancy, redundancy_ua.h).
+ *
+ * Both units send one UDP datagram (redundancy_packet_t) every heartbeat_ms;
+ * the active one sends one at once whenever the io_cache sequence changes.
+ * A datagram is accepted only from peer_host:peer_port, with a valid
+ * HMAC-SHA256 over pair_key (truncated to REDUNDANCY_MAC_LEN bytes) and a
+ * datagram counter above the last one of the same peer boot. Anything else
+ * is counted in rejected and ignored, so a stray or forged datagram can
+ * neither force a unit to standby nor reach its outputs.
+ * Every datagram carries the complete image, so a lost one is repaired by
+ * the next and nothing is acknowledged. Timestamps travel as ages relative
+ * to the send time, so the clocks of the two units need not agree.
+ *
+ * A standby that hears no active peer for failover_ms takes over: it leaves
+ * replica mode, sets its outputs to the last replicated command and
+ * continues the replicated sequence number. Each takeover raises the epoch.
+ * At startup a unit listens for REDUNDANCY_STARTUP_FACTOR * failover_ms; it
+ * becomes standby if the peer is active, otherwise the primary (or a backup
+ * that heard nothing) becomes active. If both are active (after a network
+ * split) the higher epoch stays active, then the primary, then the higher
+ * boot id; the other one drops to standby. A primary that comes back does
+ * not preempt an active backup.
+ */
+
+/** @brief Magic of a redundancy datagram ("RD") */
+#define REDUNDANCY_MAGIC            0x5244
+/** @brief Protocol version */
+#define REDUNDANCY_VERSION          2
+/** @brief Default UDP port (both ends) */
+#define REDUNDANCY_DEFAULT_PORT     4850
+/** @brief Startup listen time in multiples of failover_ms */
+#define REDUNDANCY_STARTUP_FACTOR   3
+/** @brief Period of the redundancy task loop in milliseconds (one tick at CONFIG_FREERTOS_HZ=100) */
+#define REDUNDANCY_TICK_MS          10
+/** @brief Number of ADC channels in the image (matches IO_CACHE_ADC_CHANNELS) */
+#define REDUNDANCY_ADC_CHANNELS     4
+/** @brief Bytes of the HMAC-SHA256 carried in a datagram */
+#define REDUNDANCY_MAC_LEN          16
+/** @brief Longest pairing key (without the terminating zero) */
+#define REDUNDANCY_KEY_MAX          32
+
+/**
+ * @brief Configured role of a unit
+ */
+typedef enum {
+    REDUNDANCY_PRIMARY = 0,     /**< Becomes active when both start together */
+    REDUNDANCY_BACKUP = 1       /**< Becomes active only when the primary is silent */
+} redundancy_role_t;
+
+/**
+ * @brief Runtime state of a unit
+ */
+typedef enum {
+    REDUNDANCY_STARTUP = 0,     /**< Listening for the peer */
+    REDUNDANCY_ACTIVE,          /**< Owns the I/O */
+    REDUNDANCY_STANDBY,         /**< Holds a replica of the active image */
+    REDUNDANCY_LOST             /**< Peer only: nothing heard for failover_ms */
+} redundancy_state_t;
+
+/**
+ * @brief Redundancy configuration
+ */
+typedef struct {
+    bool enable;                /**< Run as one unit of a redundant pair */
+    redundancy_role_t role;     /**< Role of this unit (the peer must have the other) */
+    char peer_host[40];         /**< IPv4 address of the peer */
+    uint16_t local_port;        /**< UDP port of this unit */
+    uint16_t peer_port;         /**< UDP port of the peer */
+    uint16_t heartbeat_ms;      /**< Send interval without changes */
+    uint16_t failover_ms;       /**< Silence of the active peer before a takeover */
+    char server_uri[64];        /**< ApplicationUri of this server */
+    char peer_uri[64];          /**< ApplicationUri of the peer server */
+    char pair_key[REDUNDANCY_KEY_MAX + 1]; /**< Shared key of the pair (same on both units, required) */
+} redundancy_config_t;
+
+/**
+ * @brief Datagram exchanged by the units (little endian, packed)
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t magic;                                 /**< REDUNDANCY_MAGIC */
+    uint8_t version;                                /**< REDUNDANCY_VERSION */
+    uint8_t state;                                  /**< redundancy_state_t of the sender */
+    uint8_t role;                                   /**< redundancy_role_t of the sender */
+    uint8_t adc_valid;                              /**< Validity bit per ADC channel */
+    uint16_t reserved;                              /**< 0 */
+    uint32_t boot_id;                               /**< Random per boot, last tie-break */
+    uint32_t epoch;                                 /**< Takeovers of the pair so far */
+    uint32_t packet;                                /**< Datagram counter of the sender */
+    uint32_t sequence;                              /**< io_cache sequence of the image */
+    uint16_t discrete_inputs;                       /**< Discrete inputs */
+    uint16_t discrete_outputs;                      /**< Commanded discrete outputs */
+    float adc[REDUNDANCY_ADC_CHANNELS];             /**< ADC values */
+    uint32_t inputs_age_ms;                         /**< Age of the inputs at send time */
+    uint32_t outputs_age_ms;                        /**< Age of the outputs at send time */
+    uint32_t adc_age_ms[REDUNDANCY_ADC_CHANNELS];   /**< Age of the ADC values at send time */
+    uint8_t mac[REDUNDANCY_MAC_LEN];                /**< HMAC-SHA256 of the fields above with pair_key */
+} redundancy_packet_t;
+
+/**
+ * @brief Redundancy state for diagnostics
+ */
+typedef struct {
+    redundancy_role_t role;         /**< Configured role */
+    redundancy_state_t state;       /**< State of this unit */
+    redundancy_state_t peer_state;  /**< Last state heard from the peer */
+    uint32_t epoch;                 /**< Current epoch */
+    uint32_t sequence;              /**< io_cache sequence sent or applied last */
+    uint32_t takeovers;             /**< Times this unit became active after a silence */
+    uint32_t takeover_ms;           /**< Last takeover: last datagram of the active peer to active */
+    uint32_t sent;                  /**< Datagrams sent */
+    uint32_t received;              /**< Valid datagrams received */
+    uint32_t lost;                  /**< Gaps in the peer's datagram counter */
+    uint32_t rejected;              /**< Datagrams dropped: other source, bad MAC or replayed */
+    uint32_t applied;               /**< Images applied to the replica */
+} redundancy_status_t;
+
+/**
+ * @brief Start the redundancy task
+ *
+ * Call after io_cache_init() and the network stack initialization, and
+ * before the OPC UA server adds its nodes. Until the startup decision the
+ * cache is in replica mode, so the I/O is left alone. Does nothing and
+ * returns ESP_OK when config->enable is false.
+ *
+ * @param config Configuration (copied)
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG (also without pair_key),
+ *         ESP_ERR_INVALID_STATE if already running, ESP_FAIL if the
+ *         socket cannot be opened, ESP_ERR_NO_MEM
+ */
+esp_err_t redundancy_start(const redundancy_config_t *config);
+
+/**
+ * @brief Check whether redundancy is running
+ *
+ * @return true after a successful redundancy_start() with enable set
+ */
+bool redundancy_enabled(void);
+
+/**
+ * @brief Current state of this unit
+ *
+ * @return redundancy_state_t State (REDUNDANCY_ACTIVE when not enabled)
+ */
+redundancy_state_t redundancy_get_state(void);
+
+/**
+ * @brief Get the redundancy state
+ *
+ * @param status Pointer to store the state
+ */
+void redundancy_get_status(redundancy_status_t *status);
+
+/**
+ * @brief Configuration the task runs with
+ *
+ * @return const redundancy_config_t* Copy made by redundancy_start()
+ */
+const redundancy_config_t *redundancy_get_config(void);
+
+/**
+ * @brief Name of a state
+ *
+ * @param state State
+ * @return const char* "startup", "active", "standby" or "lost"
+ */
+const char *redundancy_state_name(redundancy_state_t state);
+
+/**
+ * @brief Name of a role
+ *
+ * @param role Role
+ * @return const char* "primary" or "backup"
+ */
+const char *redundancy_role_name(redundancy_role_t role);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REDUNDANCY_H */
@@ -0,0 +1,237 @@
+/* redundancy_ua.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "redundancy_ua.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "redundancy";
+
+/**
+ * @brief Redundancy variables (node context of the shared read callback)
+ */
+typedef enum {
+    REDUNDANCY_VAR_ROLE = 0,
+    REDUNDANCY_VAR_STATE,
+    REDUNDANCY_VAR_PEER_STATE,
+    REDUNDANCY_VAR_EPOCH,
+    REDUNDANCY_VAR_SEQUENCE,
+    REDUNDANCY_VAR_TAKEOVERS,
+    REDUNDANCY_VAR_TAKEOVER_TIME,
+    REDUNDANCY_VAR_RECEIVED,
+    REDUNDANCY_VAR_LOST,
+    REDUNDANCY_VAR_REJECTED
+} redundancy_var_t;
+
+/**
+ * @brief OPC UA read callback for Server/ServiceLevel
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Node context (not used)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readServiceLevel(UA_Server *server,
+                 const UA_NodeId *sessionId, void *sessionContext,
+                 const UA_NodeId *nodeId, void *nodeContext,
+                 UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                 UA_DataValue *dataValue) {
+    UA_Byte level;
+    switch (redundancy_get_state()) {
+        case REDUNDANCY_ACTIVE:  level = REDUNDANCY_SERVICE_LEVEL_ACTIVE; break;
+        case REDUNDANCY_STANDBY: level = REDUNDANCY_SERVICE_LEVEL_STANDBY; break;
+        default:                 level = REDUNDANCY_SERVICE_LEVEL_STARTUP; break;
+    }
+    UA_Variant_setScalarCopy(&dataValue->value, &level, &UA_TYPES[UA_TYPES_BYTE]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief OPC UA read callback for the Redundancy variables
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Variable (redundancy_var_t)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readRedundancyVariable(UA_Server *server,
+                       const UA_NodeId *sessionId, void *sessionContext,
+                       const UA_NodeId *nodeId, void *nodeContext,
+                       UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                       UA_DataValue *dataValue) {
+    redundancy_status_t status;
+    redundancy_get_status(&status);
+
+    UA_String text;
+    const UA_UInt32 *number = NULL;
+    switch ((redundancy_var_t)(uintptr_t)nodeContext) {
+        case REDUNDANCY_VAR_ROLE:
+            text = UA_STRING((char *)redundancy_role_name(status.role));
+            break;
+        case REDUNDANCY_VAR_STATE:
+            text = UA_STRING((char *)redundancy_state_name(status.state));
+            break;
+        case REDUNDANCY_VAR_PEER_STATE:
+            text = UA_STRING((char *)redundancy_state_name(status.peer_state));
+            break;
+        case REDUNDANCY_VAR_EPOCH:         number = &status.epoch; break;
+        case REDUNDANCY_VAR_SEQUENCE:      number = &status.sequence; break;
+        case REDUNDANCY_VAR_TAKEOVERS:     number = &status.takeovers; break;
+        case REDUNDANCY_VAR_TAKEOVER_TIME: number = &status.takeover_ms; break;
+        case REDUNDANCY_VAR_RECEIVED:      number = &status.received; break;
+        case REDUNDANCY_VAR_LOST:          number = &status.lost; break;
+        case REDUNDANCY_VAR_REJECTED:      number = &status.rejected; break;
+        default:
+            return UA_STATUSCODE_BADINTERNALERROR;
+    }
+    if (number != NULL) {
+        UA_Variant_setScalarCopy(&dataValue->value, number, &UA_TYPES[UA_TYPES_UINT32]);
+    } else {
+        UA_Variant_setScalarCopy(&dataValue->value, &text, &UA_TYPES[UA_TYPES_STRING]);
+    }
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Add one read-only variable to the Redundancy object
+ */
+static void add_variable(UA_Server *server, const UA_NodeId *parent, const char *id,
+                         const char *name, const char *description, UA_UInt32 typeIndex,
+                         redundancy_var_t var) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.dataType = UA_TYPES[typeIndex].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ;
+
+    UA_DataSource source = { readRedundancyVariable, NULL };
+    UA_StatusCode status = UA_Server_addDataSourceVariableNode(
+        server, UA_NODEID_STRING(1, (char *)id), *parent,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), UA_QUALIFIEDNAME(1, (char *)name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, source,
+        (void *)(uintptr_t)var, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add variable %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Fill Server/ServerRedundancy for non-transparent Hot redundancy
+ *
+ * The stack creates ServerRedundancy as ServerRedundancyType and removes its
+ * optional children; ServerUriArray is added back with its standard NodeId.
+ */
+static void add_server_redundancy(UA_Server *server) {
+    const redundancy_config_t *config = redundancy_get_config();
+    UA_NodeId redundancyId = UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERREDUNDANCY);
+
+    UA_Variant value;
+    UA_RedundancySupport support = UA_REDUNDANCYSUPPORT_HOT;
+    UA_Variant_setScalar(&value, &support, &UA_TYPES[UA_TYPES_REDUNDANCYSUPPORT]);
+    UA_StatusCode status = UA_Server_writeValue(
+        server, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERREDUNDANCY_REDUNDANCYSUPPORT), value);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to set RedundancySupport: 0x%08lX", (unsigned long)status);
+    }
+
+    // Retype to NonTransparentRedundancyType where the namespace has it
+    UA_NodeClass nodeClass;
+    if (UA_Server_readNodeClass(server, UA_NODEID_NUMERIC(0, UA_NS0ID_NONTRANSPARENTREDUNDANCYTYPE),
+                                &nodeClass) == UA_STATUSCODE_GOOD) {
+        UA_Server_deleteReference(server, redundancyId, UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION),
+                                  true, UA_EXPANDEDNODEID_NUMERIC(0, UA_NS0ID_SERVERREDUNDANCYTYPE), true);
+        UA_Server_addReference(server, redundancyId, UA_NODEID_NUMERIC(0, UA_NS0ID_HASTYPEDEFINITION),
+                               UA_EXPANDEDNODEID_NUMERIC(0, UA_NS0ID_NONTRANSPARENTREDUNDANCYTYPE), true);
+    }
+
+    UA_String uris[2] = { UA_STRING((char *)config->server_uri), UA_STRING((char *)config->peer_uri) };
+    UA_UInt32 dimensions[1] = { 2 };
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("", "ServerUriArray");
+    attr.dataType = UA_TYPES[UA_TYPES_STRING].typeId;
+    attr.valueRank = UA_VALUERANK_ONE_DIMENSION;
+    attr.arrayDimensionsSize = 1;
+    attr.arrayDimensions = dimensions;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ;
+    UA_Variant_setArray(&attr.value, uris, 2, &UA_TYPES[UA_TYPES_STRING]);
+    status = UA_Server_addVariableNode(
+        server, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVERREDUNDANCY_SERVERURIARRAY), redundancyId,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASPROPERTY), UA_QUALIFIEDNAME(0, "ServerUriArray"),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_PROPERTYTYPE), attr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add ServerUriArray: 0x%08lX", (unsigned long)status);
+    }
+
+    UA_DataSource serviceLevel = { readServiceLevel, NULL };
+    status = UA_Server_setVariableNode_dataSource(
+        server, UA_NODEID_NUMERIC(0, UA_NS0ID_SERVER_SERVICELEVEL), serviceLevel);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to set the ServiceLevel source: 0x%08lX", (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Add the redundancy information to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void redundancy_add_ua_nodes(UA_Server *server) {
+    if (!redundancy_enabled()) {
+        return;
+    }
+    add_server_redundancy(server);
+
+    UA_NodeId redundancyId = UA_NODEID_STRING(1, "redundancy");
+    UA_ObjectAttributes objAttr = UA_ObjectAttributes_default;
+    objAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Redundancy");
+    objAttr.description = UA_LOCALIZEDTEXT("en-US", "Hot-standby pair: state of this unit and its peer");
+    UA_StatusCode status = UA_Server_addObjectNode(server, redundancyId,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                                   UA_QUALIFIEDNAME(1, "Redundancy"),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                                   objAttr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add Redundancy object: 0x%08lX", (unsigned long)status);
+        return;
+    }
+
+    add_variable(server, &redundancyId, "redundancy.Role", "Role",
+                 "Configured role: primary or backup", UA_TYPES_STRING, REDUNDANCY_VAR_ROLE);
+    add_variable(server, &redundancyId, "redundancy.State", "State",
+                 "State of this unit: startup, active or standby", UA_TYPES_STRING, REDUNDANCY_VAR_STATE);
+    add_variable(server, &redundancyId, "redundancy.PeerState", "PeerState",
+                 "Last state heard from the peer, lost if silent", UA_TYPES_STRING,
+                 REDUNDANCY_VAR_PEER_STATE);
+    add_variable(server, &redundancyId, "redundancy.Epoch", "Epoch",
+                 "Takeovers of the pair so far", UA_TYPES_UINT32, REDUNDANCY_VAR_EPOCH);
+    add_variable(server, &redundancyId, "redundancy.Sequence", "Sequence",
+                 "Process image sequence sent (active) or applied (standby)", UA_TYPES_UINT32,
+                 REDUNDANCY_VAR_SEQUENCE);
+    add_variable(server, &redundancyId, "redundancy.Takeovers", "Takeovers",
+                 "Times this unit took over from a silent peer", UA_TYPES_UINT32,
+                 REDUNDANCY_VAR_TAKEOVERS);
+    add_variable(server, &redundancyId, "redundancy.TakeoverTime", "TakeoverTime",
+                 "Last takeover: ms from the last datagram of the active peer", UA_TYPES_UINT32,
+                 REDUNDANCY_VAR_TAKEOVER_TIME);
+    add_variable(server, &redundancyId, "redundancy.Received", "Received",
+                 "Datagrams received from the peer", UA_TYPES_UINT32, REDUNDANCY_VAR_RECEIVED);
+    add_variable(server, &redundancyId, "redundancy.Lost", "Lost",
+                 "Datagrams of the peer that never arrived", UA_TYPES_UINT32, REDUNDANCY_VAR_LOST);
+    add_variable(server, &redundancyId, "redundancy.Rejected", "Rejected",
+                 "Datagrams dropped: other source, bad MAC or replayed", UA_TYPES_UINT32,
+                 REDUNDANCY_VAR_REJECTED);
+}
@@ -0,0 +1,54 @@
+/* redundancy_ua.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef REDUNDANCY_UA_H
+#define REDUNDANCY_UA_H
+
+#include "open62541.h"
+#include "redundancy.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * OPC UA Redundancy Information
+ * ============================================================================
+ *
+ * Non-transparent redundancy as seen by a client (OPC UA Part 4, 6.6.2):
+ *
+ *   Server/ServiceLevel                     255 active, 200 standby, 1 startup
+ *   Server/ServerRedundancy                 NonTransparentRedundancyType
+ *     RedundancySupport                     Hot
+ *     ServerUriArray                        server_uri and peer_uri
+ *
+ * A client connects to both servers and uses the one with the higher
+ * ServiceLevel; it subscribes to ServiceLevel to notice a takeover. The
+ * object Objects/Redundancy (ns=1;s=redundancy) adds the details:
+ *
+ *   Role, State, PeerState     String
+ *   Epoch, Sequence            UInt32   epoch, image sequence sent or applied
+ *   Takeovers, TakeoverTime    UInt32   takeovers, ms of the last one
+ *   Received, Lost             UInt32   datagrams of the peer, gaps
+ */
+
+/** @brief ServiceLevel of the active unit */
+#define REDUNDANCY_SERVICE_LEVEL_ACTIVE     255
+/** @brief ServiceLevel of the standby unit (healthy, but not the one to use) */
+#define REDUNDANCY_SERVICE_LEVEL_STANDBY    200
+/** @brief ServiceLevel while the startup decision is pending (no data) */
+#define REDUNDANCY_SERVICE_LEVEL_STARTUP    1
+
+/**
+ * @brief Add the redundancy information to the address space
+ *
+ * Does nothing when redundancy is not running.
+ *
+ * @param server OPC UA server instance
+ */
+void redundancy_add_ua_nodes(UA_Server *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REDUNDANCY_UA_H */
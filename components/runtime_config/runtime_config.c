@@ -0,0 +1,244 @@
+/* runtime_config.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "runtime_config.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "runtime_cfg";
+
+#define RUNTIME_PUBLISH_WAIT_MS     50      /**< Longest wait for a slot without readers */
+
+static const char *const tag_names[RUNTIME_TAG_COUNT] = {
+    "discrete_inputs", "adc_channel_1", "adc_channel_2", "adc_channel_3", "adc_channel_4"
+};
+
+static runtime_config_t slots[RUNTIME_CONFIG_SLOTS] = { RUNTIME_CONFIG_DEFAULT };
+static atomic_uint slot_readers[RUNTIME_CONFIG_SLOTS];
+static atomic_int current_slot = 0;
+static SemaphoreHandle_t publish_mutex = NULL;
+static runtime_config_hook_t commit_hook = NULL;
+static void *commit_hook_context = NULL;
+
+/**
+ * @brief Install the initial snapshot
+ *
+ * @param initial Initial configuration
+ * @return esp_err_t ESP_OK on success or error code
+ */
+esp_err_t runtime_config_init(const runtime_config_t *initial) {
+    if (initial == NULL || runtime_config_validate(initial) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (publish_mutex == NULL) {
+        publish_mutex = xSemaphoreCreateMutex();
+        if (publish_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    slots[0] = *initial;
+    slots[0].version = 1;
+    atomic_store(&current_slot, 0);
+
+    ESP_LOGI(TAG, "Runtime configuration v1: inputs %u ms, ADC %u ms, MQTT %s, HTTP %s",
+             initial->scan_interval_ms[RUNTIME_SCAN_INPUTS],
+             initial->scan_interval_ms[RUNTIME_SCAN_ADC],
+             initial->frontends.mqtt ? "on" : "off", initial->frontends.http ? "on" : "off");
+    return ESP_OK;
+}
+
+/**
+ * @brief Take a reference to the current snapshot
+ *
+ * The reader count is raised before the slot is trusted: if the current slot
+ * changed in between, the publisher may already be rewriting it, so the
+ * reference is dropped and taken again on the new slot.
+ *
+ * @return const runtime_config_t* Current snapshot
+ */
+const runtime_config_t *runtime_config_acquire(void) {
+    while (1) {
+        int slot = atomic_load(&current_slot);
+        atomic_fetch_add(&slot_readers[slot], 1);
+        if (atomic_load(&current_slot) == slot) {
+            return &slots[slot];
+        }
+        atomic_fetch_sub(&slot_readers[slot], 1);
+    }
+}
+
+/**
+ * @brief Release a snapshot
+ *
+ * @param config Snapshot from runtime_config_acquire()
+ */
+void runtime_config_release(const runtime_config_t *config) {
+    if (config == NULL) {
+        return;
+    }
+    atomic_fetch_sub(&slot_readers[config - slots], 1);
+}
+
+/**
+ * @brief Check a configuration against the limits
+ *
+ * @param config Configuration
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t runtime_config_validate(const runtime_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < RUNTIME_SCAN_CLASSES; i++) {
+        if (config->scan_interval_ms[i] < RUNTIME_SCAN_INTERVAL_MIN_MS ||
+            config->scan_interval_ms[i] > RUNTIME_SCAN_INTERVAL_MAX_MS) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (config->tags[RUNTIME_TAG_DISCRETE_INPUTS].filter > RUNTIME_DI_FILTER_MAX ||
+        config->tags[RUNTIME_TAG_DISCRETE_INPUTS].deadband != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = RUNTIME_TAG_ADC_1; i <= RUNTIME_TAG_ADC_4; i++) {
+        if (config->tags[i].filter > RUNTIME_ADC_FILTER_MAX ||
+            config->tags[i].deadband > RUNTIME_ADC_DEADBAND_MAX) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Make a configuration the current snapshot
+ *
+ * Publishers are serialized by a mutex. The new snapshot is written to a slot
+ * that is neither current nor referenced and then made current with one
+ * atomic store; readers of the old snapshot finish undisturbed.
+ *
+ * @param config New configuration
+ * @param version Pointer to store the new version (may be NULL)
+ * @return esp_err_t ESP_OK on success or error code
+ */
+esp_err_t runtime_config_publish(const runtime_config_t *config, uint32_t *version) {
+    if (runtime_config_validate(config) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (publish_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(publish_mutex, portMAX_DELAY);
+    int current = atomic_load(&current_slot);
+    int free_slot = -1;
+    TickType_t start = xTaskGetTickCount();
+    while (1) {
+        for (int i = 0; i < RUNTIME_CONFIG_SLOTS; i++) {
+            if (i != current && atomic_load(&slot_readers[i]) == 0) {
+                free_slot = i;
+                break;
+            }
+        }
+        if (free_slot >= 0 ||
+            (xTaskGetTickCount() - start) * portTICK_PERIOD_MS >= RUNTIME_PUBLISH_WAIT_MS) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    if (free_slot < 0) {
+        xSemaphoreGive(publish_mutex);
+        ESP_LOGW(TAG, "No free configuration slot, change not applied");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    /* A reader that raced for this slot sees current_slot != free_slot and retries */
+    slots[free_slot] = *config;
+    slots[free_slot].version = slots[current].version + 1;
+    atomic_store(&current_slot, free_slot);
+
+    const runtime_config_t *published = &slots[free_slot];
+    runtime_config_hook_t hook = commit_hook;
+    void *context = commit_hook_context;
+    xSemaphoreGive(publish_mutex);
+
+    ESP_LOGI(TAG, "Runtime configuration v%lu: inputs %u ms, ADC %u ms, MQTT %s, HTTP %s",
+             (unsigned long)published->version,
+             published->scan_interval_ms[RUNTIME_SCAN_INPUTS],
+             published->scan_interval_ms[RUNTIME_SCAN_ADC],
+             published->frontends.mqtt ? "on" : "off", published->frontends.http ? "on" : "off");
+    if (version != NULL) {
+        *version = published->version;
+    }
+    if (hook != NULL) {
+        const runtime_config_t *snapshot = runtime_config_acquire();
+        hook(snapshot, context);
+        runtime_config_release(snapshot);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Set the callback run after every publish
+ *
+ * @param hook Callback (NULL = none)
+ * @param context Passed to the callback
+ */
+void runtime_config_set_commit_hook(runtime_config_hook_t hook, void *context) {
+    if (publish_mutex != NULL) {
+        xSemaphoreTake(publish_mutex, portMAX_DELAY);
+    }
+    commit_hook = hook;
+    commit_hook_context = context;
+    if (publish_mutex != NULL) {
+        xSemaphoreGive(publish_mutex);
+    }
+}
+
+/**
+ * @brief Get the version of the current snapshot
+ *
+ * @return uint32_t Version
+ */
+uint32_t runtime_config_version(void) {
+    const runtime_config_t *config = runtime_config_acquire();
+    uint32_t version = config->version;
+    runtime_config_release(config);
+    return version;
+}
+
+/**
+ * @brief Look up a tag by its OPC UA node id string
+ *
+ * @param name Name
+ * @param len Name length
+ * @param tag Pointer to store the tag
+ * @return true if the name is known
+ */
+bool runtime_config_find_tag(const char *name, size_t len, runtime_tag_t *tag) {
+    if (name == NULL || tag == NULL) {
+        return false;
+    }
+    for (int i = 0; i < RUNTIME_TAG_COUNT; i++) {
+        if (strlen(tag_names[i]) == len && memcmp(tag_names[i], name, len) == 0) {
+            *tag = (runtime_tag_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Get the OPC UA node id string of a tag
+ *
+ * @param tag Tag
+ * @return const char* Name, "" for an unknown tag
+ */
+const char *runtime_config_tag_name(runtime_tag_t tag) {
+    if ((unsigned)tag >= RUNTIME_TAG_COUNT) {
+        return "";
+    }
+    return tag_names[tag];
+}
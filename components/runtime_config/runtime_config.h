@@ -0,0 +1,214 @@
+/* runtime_config.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * Runtime Configuration Snapshots
+ * ============================================================================
+ *
+ * Scan rates, per-tag options and the optional protocol frontends can be
+ * changed while the gateway runs. The configuration is an immutable snapshot;
+ * a change builds a complete new snapshot, validates it and swaps it in with
+ * one atomic store (read-copy-update). Readers (I/O polling, OPC UA read
+ * callbacks) take a reference with runtime_config_acquire() and always see
+ * one consistent snapshot, never a half-applied change, and never block.
+ *
+ * A snapshot is reused only after the last reader released it. Readers hold
+ * a snapshot for one scan or one read callback, so the small pool of slots
+ * is enough.
+ *
+ * Tag options:
+ *   exposed   false: the node stays in the address space (subscriptions
+ *             survive) but reports BadOutOfService
+ *   filter    discrete inputs: a bit changes only after being stable for
+ *             1 + filter scans; ADC: exponential moving average with
+ *             alpha = 1 / 2^filter
+ *   deadband  ADC only: the cached value is updated only when the filtered
+ *             value moved at least this many raw counts
+ */
+
+/** @brief Number of snapshot slots (current + reused ones) */
+#define RUNTIME_CONFIG_SLOTS            4
+
+/** @brief Scan interval limits in milliseconds (the polling loop ticks every 5 ms) */
+#define RUNTIME_SCAN_INTERVAL_MIN_MS    5
+#define RUNTIME_SCAN_INTERVAL_MAX_MS    60000
+
+/** @brief Largest discrete input debounce in scans */
+#define RUNTIME_DI_FILTER_MAX           7
+/** @brief Largest ADC filter shift */
+#define RUNTIME_ADC_FILTER_MAX          6
+/** @brief Largest ADC deadband in raw counts */
+#define RUNTIME_ADC_DEADBAND_MAX        4095
+
+/**
+ * @brief Scan classes
+ */
+typedef enum {
+    RUNTIME_SCAN_INPUTS = 0,    /**< Discrete inputs (PCF8574 over I2C) */
+    RUNTIME_SCAN_ADC,           /**< ADC channels */
+    RUNTIME_SCAN_CLASSES
+} runtime_scan_class_t;
+
+/**
+ * @brief Configurable tags (named as their OPC UA node ids)
+ */
+typedef enum {
+    RUNTIME_TAG_DISCRETE_INPUTS = 0,    /**< "discrete_inputs" */
+    RUNTIME_TAG_ADC_1,                  /**< "adc_channel_1" */
+    RUNTIME_TAG_ADC_2,                  /**< "adc_channel_2" */
+    RUNTIME_TAG_ADC_3,                  /**< "adc_channel_3" */
+    RUNTIME_TAG_ADC_4,                  /**< "adc_channel_4" */
+    RUNTIME_TAG_COUNT
+} runtime_tag_t;
+
+/**
+ * @brief Options of one tag
+ */
+typedef struct {
+    bool exposed;               /**< Value is served (false = BadOutOfService) */
+    uint8_t filter;             /**< DI debounce scans or ADC filter shift (0 = off) */
+    uint16_t deadband;          /**< ADC deadband in raw counts (0 = off, DI: unused) */
+} runtime_tag_config_t;
+
+/**
+ * @brief Optional protocol frontends (OPC UA itself is always on)
+ */
+typedef struct {
+    bool mqtt;                  /**< MQTT process image publisher */
+    bool http;                  /**< HTTP /metrics and /snapshot endpoint */
+} runtime_frontends_t;
+
+/**
+ * @brief Configuration snapshot
+ */
+typedef struct {
+    uint32_t version;                                   /**< Incremented by every publish */
+    uint16_t scan_interval_ms[RUNTIME_SCAN_CLASSES];    /**< Scan period per class */
+    runtime_tag_config_t tags[RUNTIME_TAG_COUNT];       /**< Per-tag options */
+    runtime_frontends_t frontends;                      /**< Frontend switches */
+} runtime_config_t;
+
+/**
+ * @brief Built-in configuration, current until runtime_config_init()
+ *
+ * Inputs every 20 ms, ADC every 100 ms, all tags exposed and unfiltered,
+ * frontends off.
+ */
+#define RUNTIME_CONFIG_DEFAULT {                                        \
+    .version = 1,                                                       \
+    .scan_interval_ms = { 20, 100 },                                    \
+    .tags = { [0 ... RUNTIME_TAG_COUNT - 1] = { true, 0, 0 } },         \
+    .frontends = { false, false }                                       \
+}
+
+/**
+ * @brief Callback after a new snapshot became current
+ *
+ * Called in the context of the publishing task (the OPC UA task for changes
+ * made through the Configuration object).
+ *
+ * @param config The new snapshot
+ * @param context Context given to runtime_config_set_commit_hook()
+ */
+typedef void (*runtime_config_hook_t)(const runtime_config_t *config, void *context);
+
+/**
+ * @brief Install the initial snapshot
+ *
+ * Call once, before the tasks that read the configuration are started; until
+ * then RUNTIME_CONFIG_DEFAULT is current. The version of the initial
+ * snapshot is 1.
+ *
+ * @param initial Initial configuration (copied)
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG if it does not validate,
+ *         ESP_ERR_NO_MEM
+ */
+esp_err_t runtime_config_init(const runtime_config_t *initial);
+
+/**
+ * @brief Take a reference to the current snapshot
+ *
+ * Lock-free and safe from any task. The snapshot stays unchanged until it is
+ * released; hold it only for one scan or one callback.
+ *
+ * @return const runtime_config_t* Current snapshot
+ */
+const runtime_config_t *runtime_config_acquire(void);
+
+/**
+ * @brief Release a snapshot taken with runtime_config_acquire()
+ *
+ * @param config Snapshot
+ */
+void runtime_config_release(const runtime_config_t *config);
+
+/**
+ * @brief Check a configuration against the limits above
+ *
+ * @param config Configuration
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t runtime_config_validate(const runtime_config_t *config);
+
+/**
+ * @brief Make a configuration the current snapshot
+ *
+ * The version field of config is ignored; the new snapshot gets the next
+ * version. The commit hook is called before returning.
+ *
+ * @param config New configuration (copied)
+ * @param version Pointer to store the new version (may be NULL)
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG if it does not validate,
+ *         ESP_ERR_TIMEOUT if readers held every free slot for too long
+ */
+esp_err_t runtime_config_publish(const runtime_config_t *config, uint32_t *version);
+
+/**
+ * @brief Set the callback run after every publish
+ *
+ * @param hook Callback (NULL = none)
+ * @param context Passed to the callback
+ */
+void runtime_config_set_commit_hook(runtime_config_hook_t hook, void *context);
+
+/**
+ * @brief Get the version of the current snapshot
+ *
+ * @return uint32_t Version
+ */
+uint32_t runtime_config_version(void);
+
+/**
+ * @brief Look up a tag by its OPC UA node id string
+ *
+ * @param name Name ("discrete_inputs", "adc_channel_1", ...)
+ * @param len Name length
+ * @param tag Pointer to store the tag
+ * @return true if the name is known
+ */
+bool runtime_config_find_tag(const char *name, size_t len, runtime_tag_t *tag);
+
+/**
+ * @brief Get the OPC UA node id string of a tag
+ *
+ * @param tag Tag
+ * @return const char* Name, "" for an unknown tag
+ */
+const char *runtime_config_tag_name(runtime_tag_t tag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RUNTIME_CONFIG_H */
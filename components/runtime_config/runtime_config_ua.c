@@ -0,0 +1,395 @@
+/* runtime_config_ua.c - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#include "runtime_config_ua.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "runtime_cfg";
+
+#define CONFIG_JSON_BUFFER  512     /**< Size of the Active string */
+
+static const char *const scan_names[RUNTIME_SCAN_CLASSES] = { "inputs", "adc" };
+
+/* Methods run in the OPC UA task only, so the draft needs no lock */
+static runtime_config_t draft;
+static bool draft_pending = false;
+
+/**
+ * @brief OPC UA read callback for the current snapshot version
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Node context (not used)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readConfigVersion(UA_Server *server,
+                  const UA_NodeId *sessionId, void *sessionContext,
+                  const UA_NodeId *nodeId, void *nodeContext,
+                  UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                  UA_DataValue *dataValue) {
+    UA_UInt32 version = runtime_config_version();
+    UA_Variant_setScalarCopy(&dataValue->value, &version, &UA_TYPES[UA_TYPES_UINT32]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief OPC UA read callback for the current snapshot as JSON
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Node context (not used)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readConfigActive(UA_Server *server,
+                 const UA_NodeId *sessionId, void *sessionContext,
+                 const UA_NodeId *nodeId, void *nodeContext,
+                 UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                 UA_DataValue *dataValue) {
+    char json[CONFIG_JSON_BUFFER];
+    const runtime_config_t *cfg = runtime_config_acquire();
+    int len = snprintf(json, sizeof(json),
+                       "{\"version\":%lu,\"scan_ms\":{\"inputs\":%u,\"adc\":%u},"
+                       "\"frontends\":{\"mqtt\":%s,\"http\":%s},\"tags\":{",
+                       (unsigned long)cfg->version,
+                       cfg->scan_interval_ms[RUNTIME_SCAN_INPUTS],
+                       cfg->scan_interval_ms[RUNTIME_SCAN_ADC],
+                       cfg->frontends.mqtt ? "true" : "false",
+                       cfg->frontends.http ? "true" : "false");
+    for (int i = 0; i < RUNTIME_TAG_COUNT && len > 0 && len < (int)sizeof(json); i++) {
+        len += snprintf(json + len, sizeof(json) - len,
+                        "%s\"%s\":{\"exposed\":%s,\"filter\":%u,\"deadband\":%u}",
+                        i > 0 ? "," : "", runtime_config_tag_name((runtime_tag_t)i),
+                        cfg->tags[i].exposed ? "true" : "false",
+                        cfg->tags[i].filter, cfg->tags[i].deadband);
+    }
+    runtime_config_release(cfg);
+    if (len > 0 && len < (int)sizeof(json)) {
+        len += snprintf(json + len, sizeof(json) - len, "}}");
+    }
+    if (len <= 0 || len >= (int)sizeof(json)) {
+        return UA_STATUSCODE_BADINTERNALERROR;
+    }
+
+    UA_String value = { (size_t)len, (UA_Byte *)json };
+    UA_Variant_setScalarCopy(&dataValue->value, &value, &UA_TYPES[UA_TYPES_STRING]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief OPC UA read callback for the staged-changes flag
+ *
+ * @param server OPC UA server instance
+ * @param sessionId Client session ID
+ * @param sessionContext Session context (not used)
+ * @param nodeId Node ID being read
+ * @param nodeContext Node context (not used)
+ * @param sourceTimeStamp Whether to include source timestamp
+ * @param range Data range (not used)
+ * @param dataValue Pointer to store read data
+ * @return UA_StatusCode Status of read operation
+ */
+static UA_StatusCode
+readConfigPending(UA_Server *server,
+                  const UA_NodeId *sessionId, void *sessionContext,
+                  const UA_NodeId *nodeId, void *nodeContext,
+                  UA_Boolean sourceTimeStamp, const UA_NumericRange *range,
+                  UA_DataValue *dataValue) {
+    UA_Boolean pending = draft_pending;
+    UA_Variant_setScalarCopy(&dataValue->value, &pending, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+#ifdef UA_ENABLE_METHODCALLS
+
+/**
+ * @brief Start a draft from the current snapshot unless one is pending
+ *
+ * @return runtime_config_t* The draft
+ */
+static runtime_config_t *draft_begin(void) {
+    if (!draft_pending) {
+        const runtime_config_t *cfg = runtime_config_acquire();
+        draft = *cfg;
+        runtime_config_release(cfg);
+        draft_pending = true;
+    }
+    return &draft;
+}
+
+/**
+ * @brief Apply a change to the draft if the result still validates
+ *
+ * @param candidate Draft copy with the change applied
+ * @return UA_StatusCode GOOD or BADOUTOFRANGE
+ */
+static UA_StatusCode draft_apply(const runtime_config_t *candidate) {
+    if (runtime_config_validate(candidate) != ESP_OK) {
+        return UA_STATUSCODE_BADOUTOFRANGE;
+    }
+    draft = *candidate;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Compare an OPC UA string with a C string
+ */
+static bool string_equals(const UA_String *s, const char *name) {
+    size_t len = strlen(name);
+    return s->length == len && memcmp(s->data, name, len) == 0;
+}
+
+/**
+ * @brief SetScanRate(ScanClass, IntervalMs)
+ */
+static UA_StatusCode
+setScanRateMethod(UA_Server *server,
+                  const UA_NodeId *sessionId, void *sessionContext,
+                  const UA_NodeId *methodId, void *methodContext,
+                  const UA_NodeId *objectId, void *objectContext,
+                  size_t inputSize, const UA_Variant *input,
+                  size_t outputSize, UA_Variant *output) {
+    const UA_String *name = (const UA_String *)input[0].data;
+    UA_UInt16 interval = *(const UA_UInt16 *)input[1].data;
+
+    for (int i = 0; i < RUNTIME_SCAN_CLASSES; i++) {
+        if (string_equals(name, scan_names[i])) {
+            runtime_config_t candidate = *draft_begin();
+            candidate.scan_interval_ms[i] = interval;
+            return draft_apply(&candidate);
+        }
+    }
+    return UA_STATUSCODE_BADINVALIDARGUMENT;
+}
+
+/**
+ * @brief SetTag(Tag, Exposed, Filter, Deadband)
+ */
+static UA_StatusCode
+setTagMethod(UA_Server *server,
+             const UA_NodeId *sessionId, void *sessionContext,
+             const UA_NodeId *methodId, void *methodContext,
+             const UA_NodeId *objectId, void *objectContext,
+             size_t inputSize, const UA_Variant *input,
+             size_t outputSize, UA_Variant *output) {
+    const UA_String *name = (const UA_String *)input[0].data;
+    runtime_tag_t tag;
+    if (!runtime_config_find_tag((const char *)name->data, name->length, &tag)) {
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+
+    runtime_config_t candidate = *draft_begin();
+    candidate.tags[tag].exposed = *(const UA_Boolean *)input[1].data;
+    candidate.tags[tag].filter = *(const UA_Byte *)input[2].data;
+    candidate.tags[tag].deadband = *(const UA_UInt16 *)input[3].data;
+    return draft_apply(&candidate);
+}
+
+/**
+ * @brief SetFrontend(Frontend, Enabled)
+ */
+static UA_StatusCode
+setFrontendMethod(UA_Server *server,
+                  const UA_NodeId *sessionId, void *sessionContext,
+                  const UA_NodeId *methodId, void *methodContext,
+                  const UA_NodeId *objectId, void *objectContext,
+                  size_t inputSize, const UA_Variant *input,
+                  size_t outputSize, UA_Variant *output) {
+    const UA_String *name = (const UA_String *)input[0].data;
+    UA_Boolean enabled = *(const UA_Boolean *)input[1].data;
+
+    runtime_config_t candidate = *draft_begin();
+    if (string_equals(name, "mqtt")) {
+        candidate.frontends.mqtt = enabled;
+    } else if (string_equals(name, "http")) {
+        candidate.frontends.http = enabled;
+    } else {
+        return UA_STATUSCODE_BADINVALIDARGUMENT;
+    }
+    return draft_apply(&candidate);
+}
+
+/**
+ * @brief Commit() -> Version
+ *
+ * Without staged changes the current version is returned unchanged.
+ */
+static UA_StatusCode
+commitMethod(UA_Server *server,
+             const UA_NodeId *sessionId, void *sessionContext,
+             const UA_NodeId *methodId, void *methodContext,
+             const UA_NodeId *objectId, void *objectContext,
+             size_t inputSize, const UA_Variant *input,
+             size_t outputSize, UA_Variant *output) {
+    UA_UInt32 version = runtime_config_version();
+    if (draft_pending) {
+        uint32_t published = 0;
+        esp_err_t err = runtime_config_publish(&draft, &published);
+        if (err == ESP_ERR_INVALID_ARG) {
+            return UA_STATUSCODE_BADOUTOFRANGE;
+        }
+        if (err != ESP_OK) {
+            return UA_STATUSCODE_BADRESOURCEUNAVAILABLE;
+        }
+        draft_pending = false;
+        version = published;
+    }
+    return UA_Variant_setScalarCopy(output, &version, &UA_TYPES[UA_TYPES_UINT32]);
+}
+
+/**
+ * @brief Discard()
+ */
+static UA_StatusCode
+discardMethod(UA_Server *server,
+              const UA_NodeId *sessionId, void *sessionContext,
+              const UA_NodeId *methodId, void *methodContext,
+              const UA_NodeId *objectId, void *objectContext,
+              size_t inputSize, const UA_Variant *input,
+              size_t outputSize, UA_Variant *output) {
+    draft_pending = false;
+    return UA_STATUSCODE_GOOD;
+}
+
+/**
+ * @brief Fill a method argument description
+ */
+static UA_Argument make_argument(const char *name, const char *description, UA_UInt32 typeIndex) {
+    UA_Argument arg;
+    UA_Argument_init(&arg);
+    arg.name = UA_STRING((char *)name);
+    arg.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    arg.dataType = UA_TYPES[typeIndex].typeId;
+    arg.valueRank = UA_VALUERANK_SCALAR;
+    return arg;
+}
+
+/**
+ * @brief Add one method to the Configuration object
+ */
+static void add_method(UA_Server *server, const UA_NodeId *parent, const char *id,
+                       const char *name, const char *description, UA_MethodCallback callback,
+                       size_t inputSize, const UA_Argument *inputs,
+                       size_t outputSize, const UA_Argument *outputs) {
+    UA_MethodAttributes attr = UA_MethodAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.executable = true;
+    attr.userExecutable = true;
+
+    UA_StatusCode status = UA_Server_addMethodNode(server, UA_NODEID_STRING(1, (char *)id), *parent,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                                   UA_QUALIFIEDNAME(1, (char *)name), attr, callback,
+                                                   inputSize, inputs, outputSize, outputs,
+                                                   NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add method %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+#endif /* UA_ENABLE_METHODCALLS */
+
+/**
+ * @brief Add one read-only data source variable to the Configuration object
+ */
+static void add_variable(UA_Server *server, const UA_NodeId *parent, const char *id,
+                         const char *name, const char *description, UA_UInt32 typeIndex,
+                         UA_DataSource source) {
+    UA_VariableAttributes attr = UA_VariableAttributes_default;
+    attr.displayName = UA_LOCALIZEDTEXT("en-US", (char *)name);
+    attr.description = UA_LOCALIZEDTEXT("en-US", (char *)description);
+    attr.dataType = UA_TYPES[typeIndex].typeId;
+    attr.accessLevel = UA_ACCESSLEVELMASK_READ;
+
+    UA_StatusCode status = UA_Server_addDataSourceVariableNode(
+        server, UA_NODEID_STRING(1, (char *)id), *parent,
+        UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), UA_QUALIFIEDNAME(1, (char *)name),
+        UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, source, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add variable %s: 0x%08lX", name, (unsigned long)status);
+    }
+}
+
+/**
+ * @brief Add the Configuration object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void runtime_config_add_ua_nodes(UA_Server *server) {
+    UA_NodeId configId = UA_NODEID_STRING(1, "config");
+
+    UA_ObjectAttributes objAttr = UA_ObjectAttributes_default;
+    objAttr.displayName = UA_LOCALIZEDTEXT("en-US", "Configuration");
+    objAttr.description = UA_LOCALIZEDTEXT("en-US", "Runtime configuration (scan rates, tags, frontends)");
+    UA_StatusCode status = UA_Server_addObjectNode(server, configId,
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                                   UA_QUALIFIEDNAME(1, "Configuration"),
+                                                   UA_NODEID_NUMERIC(0, UA_NS0ID_BASEOBJECTTYPE),
+                                                   objAttr, NULL, NULL);
+    if (status != UA_STATUSCODE_GOOD) {
+        ESP_LOGE(TAG, "Failed to add Configuration object: 0x%08lX", (unsigned long)status);
+        return;
+    }
+
+    UA_DataSource source = { readConfigVersion, NULL };
+    add_variable(server, &configId, "config.Version", "Version",
+                 "Version of the current configuration snapshot", UA_TYPES_UINT32, source);
+    source.read = readConfigActive;
+    add_variable(server, &configId, "config.Active", "Active",
+                 "Current configuration snapshot (JSON)", UA_TYPES_STRING, source);
+    source.read = readConfigPending;
+    add_variable(server, &configId, "config.Pending", "Pending",
+                 "Changes are staged but not committed", UA_TYPES_BOOLEAN, source);
+
+#ifdef UA_ENABLE_METHODCALLS
+    UA_Argument scanArgs[2] = {
+        make_argument("ScanClass", "\"inputs\" or \"adc\"", UA_TYPES_STRING),
+        make_argument("IntervalMs", "Scan period in milliseconds", UA_TYPES_UINT16)
+    };
+    add_method(server, &configId, "config.SetScanRate", "SetScanRate",
+               "Stage a new scan period for a scan class", setScanRateMethod,
+               2, scanArgs, 0, NULL);
+
+    UA_Argument tagArgs[4] = {
+        make_argument("Tag", "Node id string of the tag (discrete_inputs, adc_channel_1..4)",
+                      UA_TYPES_STRING),
+        make_argument("Exposed", "false: the node reports BadOutOfService", UA_TYPES_BOOLEAN),
+        make_argument("Filter", "DI debounce scans or ADC filter shift (0 = off)", UA_TYPES_BYTE),
+        make_argument("Deadband", "ADC deadband in raw counts (0 = off)", UA_TYPES_UINT16)
+    };
+    add_method(server, &configId, "config.SetTag", "SetTag",
+               "Stage new options for a tag", setTagMethod, 4, tagArgs, 0, NULL);
+
+    UA_Argument frontendArgs[2] = {
+        make_argument("Frontend", "\"mqtt\" or \"http\"", UA_TYPES_STRING),
+        make_argument("Enabled", "Run the frontend", UA_TYPES_BOOLEAN)
+    };
+    add_method(server, &configId, "config.SetFrontend", "SetFrontend",
+               "Stage enabling or disabling a protocol frontend", setFrontendMethod,
+               2, frontendArgs, 0, NULL);
+
+    UA_Argument versionArg = make_argument("Version", "Version of the new snapshot", UA_TYPES_UINT32);
+    add_method(server, &configId, "config.Commit", "Commit",
+               "Apply all staged changes at once", commitMethod, 0, NULL, 1, &versionArg);
+    add_method(server, &configId, "config.Discard", "Discard",
+               "Drop all staged changes", discardMethod, 0, NULL, 0, NULL);
+#endif
+
+    ESP_LOGI(TAG, "Configuration object added (version %lu)", (unsigned long)runtime_config_version());
+}
@@ -0,0 +1,47 @@
+/* runtime_config_ua.h - See the project LICENSE file and main/opcua_esp32.c for licensing and attribution. */
+
+#ifndef RUNTIME_CONFIG_UA_H
+#define RUNTIME_CONFIG_UA_H
+
+#include "open62541.h"
+#include "runtime_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================
+ * OPC UA Configuration Object
+ * ============================================================================
+ *
+ * Objects/Configuration (ns=1;s=config):
+ *
+ *   Version   UInt32   version of the current snapshot
+ *   Active    String   current snapshot as JSON
+ *   Pending   Boolean  changes are staged but not committed
+ *
+ *   SetScanRate(ScanClass String "inputs"|"adc", IntervalMs UInt16)
+ *   SetTag(Tag String, Exposed Boolean, Filter Byte, Deadband UInt16)
+ *   SetFrontend(Frontend String "mqtt"|"http", Enabled Boolean)
+ *   Commit() -> Version UInt32
+ *   Discard()
+ *
+ * The Set methods edit one staged copy of the current snapshot (shared by all
+ * sessions, checked against the limits on every call); Commit publishes it as
+ * a whole, so several changes take effect together. The method node ids start
+ * with "config." and need the OPCUA_RIGHT_CONFIG right. Without
+ * UA_ENABLE_METHODCALLS (nano profile) only the variables are added.
+ */
+
+/**
+ * @brief Add the Configuration object to the address space
+ *
+ * @param server OPC UA server instance
+ */
+void runtime_config_add_ua_nodes(UA_Server *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RUNTIME_CONFIG_UA_H */
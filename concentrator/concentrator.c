@@ -0,0 +1,561 @@
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+#include <open62541/client.h>
+#include <open62541/client_config_default.h>
+#include <open62541/client_highlevel.h>
+#include <open62541/client_subscriptions.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+// OPC UA concentrator for many Kincony A16V3 gateways.
+//
+// Holds one client session with one subscription per gateway and mirrors
+// every gateway variable into its own namespace (urn:kincony:concentrator:<name>)
+// under Objects/<name>. Node identifiers are kept, so ns=1;s=discrete_inputs
+// on a gateway becomes ns=<N>;s=discrete_inputs here. Downstream clients are
+// served from the local cache; writes are forwarded to the gateway.
+
+#define MAX_GATEWAYS        64      // Gateways per concentrator
+#define MAX_TAGS            32      // Mirrored variables per gateway
+#define CONNECT_TIMEOUT_MS  2000    // Upstream connect/request timeout
+#define BACKOFF_MIN_MS      1000    // First reconnect delay
+#define BACKOFF_MAX_MS      30000   // Largest reconnect delay
+#define LOOP_SLEEP_US       500     // Idle time per main loop iteration
+#define STATS_INTERVAL_MS   10000   // Console statistics interval
+#define MIN_INTERVAL_MS     5.0     // Smallest downstream publishing/sampling interval
+
+struct Gateway;
+
+// One mirrored variable
+typedef struct {
+    struct Gateway* gw;          // Owning gateway
+    UA_NodeId remote_id;         // Node id on the gateway
+    UA_NodeId local_id;          // Node id in the concentrator
+    UA_DataValue value;          // Last value received from the gateway
+    UA_Byte access_level;        // Gateway access level
+    unsigned long updates;       // Data change notifications received
+} MirrorTag;
+
+// Status variables published per gateway
+typedef enum {
+    STATUS_CONNECTED = 0,
+    STATUS_UPDATES,
+    STATUS_RECONNECTS,
+    STATUS_COUNT
+} StatusField;
+
+typedef struct {
+    struct Gateway* gw;
+    StatusField field;
+} StatusNode;
+
+// One upstream gateway
+typedef struct Gateway {
+    char name[32];               // Device name (browse name of its folder)
+    char url[128];               // Gateway endpoint URL
+    UA_UInt16 ns;                // Namespace index in the concentrator
+    UA_Client* client;           // Upstream client (NULL while disconnected)
+    int connected;               // Subscription is running
+    int nodes_created;           // Mirror nodes exist in the concentrator
+    UA_UInt32 sub_id;            // Subscription id on the gateway
+    MirrorTag tags[MAX_TAGS];
+    size_t tag_count;
+    StatusNode status[STATUS_COUNT];
+    double next_connect;         // Time of the next connection attempt
+    double backoff;              // Current reconnect delay
+    unsigned long updates;       // Data change notifications received
+    unsigned long reconnects;    // Successful connections
+} Gateway;
+
+// Global settings
+typedef struct {
+    const char* username;        // Upstream user (NULL = anonymous)
+    const char* password;        // Upstream password
+    double publish_ms;           // Upstream publishing interval
+    double sample_ms;            // Upstream sampling interval
+    int read_only;               // Reject downstream writes
+    int max_clients;             // Downstream sessions/SecureChannels
+    int verbose;
+} Settings;
+
+static Gateway gateways[MAX_GATEWAYS];
+static size_t gateway_count = 0;
+static Settings settings = { NULL, NULL, 20.0, 10.0, 0, 1000, 0 };
+static UA_Server* server = NULL;
+static volatile int running = 1;
+
+static void on_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+// Monotonic time in milliseconds
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// ========== DOWNSTREAM DATA SOURCES ==========
+
+// Serve a mirrored variable from the cache
+static UA_StatusCode
+readMirror(UA_Server* srv, const UA_NodeId* sessionId, void* sessionContext,
+           const UA_NodeId* nodeId, void* nodeContext, UA_Boolean includeSourceTimeStamp,
+           const UA_NumericRange* range, UA_DataValue* dataValue) {
+    MirrorTag* tag = (MirrorTag*)nodeContext;
+    (void)srv; (void)sessionId; (void)sessionContext; (void)nodeId;
+    if (range) {
+        dataValue->hasStatus = true;
+        dataValue->status = UA_STATUSCODE_BADINDEXRANGEINVALID;
+        return UA_STATUSCODE_GOOD;
+    }
+    UA_StatusCode rc = UA_DataValue_copy(&tag->value, dataValue);
+    if (rc == UA_STATUSCODE_GOOD && !includeSourceTimeStamp) {
+        dataValue->hasSourceTimestamp = false;
+    }
+    return rc;
+}
+
+// Forward a downstream write to the gateway
+static UA_StatusCode
+writeMirror(UA_Server* srv, const UA_NodeId* sessionId, void* sessionContext,
+            const UA_NodeId* nodeId, void* nodeContext,
+            const UA_NumericRange* range, const UA_DataValue* dataValue) {
+    MirrorTag* tag = (MirrorTag*)nodeContext;
+    (void)srv; (void)sessionId; (void)sessionContext; (void)nodeId;
+    if (settings.read_only || !(tag->access_level & UA_ACCESSLEVELMASK_WRITE)) {
+        return UA_STATUSCODE_BADNOTWRITABLE;
+    }
+    if (range || !dataValue->hasValue) {
+        return UA_STATUSCODE_BADWRITENOTSUPPORTED;
+    }
+    if (!tag->gw->connected) {
+        return UA_STATUSCODE_BADNOTCONNECTED;
+    }
+    // Synchronous: the downstream client gets the gateway's status code
+    return UA_Client_writeValueAttribute(tag->gw->client, tag->remote_id, &dataValue->value);
+}
+
+// Serve the per-gateway status variables
+static UA_StatusCode
+readStatus(UA_Server* srv, const UA_NodeId* sessionId, void* sessionContext,
+           const UA_NodeId* nodeId, void* nodeContext, UA_Boolean includeSourceTimeStamp,
+           const UA_NumericRange* range, UA_DataValue* dataValue) {
+    StatusNode* st = (StatusNode*)nodeContext;
+    (void)srv; (void)sessionId; (void)sessionContext; (void)nodeId;
+    (void)includeSourceTimeStamp; (void)range;
+    if (st->field == STATUS_CONNECTED) {
+        UA_Boolean v = st->gw->connected ? true : false;
+        UA_Variant_setScalarCopy(&dataValue->value, &v, &UA_TYPES[UA_TYPES_BOOLEAN]);
+    } else {
+        UA_UInt32 v = (UA_UInt32)(st->field == STATUS_UPDATES ? st->gw->updates : st->gw->reconnects);
+        UA_Variant_setScalarCopy(&dataValue->value, &v, &UA_TYPES[UA_TYPES_UINT32]);
+    }
+    dataValue->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+// ========== MIRROR CONSTRUCTION ==========
+
+// Add the Objects/<name> folder and the status variables of a gateway
+static UA_StatusCode add_gateway_folder(Gateway* gw, UA_NodeId* folder) {
+    char uri[96];
+    snprintf(uri, sizeof(uri), "urn:kincony:concentrator:%s", gw->name);
+    gw->ns = UA_Server_addNamespace(server, uri);
+
+    UA_ObjectAttributes oattr = UA_ObjectAttributes_default;
+    oattr.displayName = UA_LOCALIZEDTEXT("en-US", gw->name);
+    UA_StatusCode rc = UA_Server_addObjectNode(server, UA_NODEID_STRING(gw->ns, gw->name),
+                                               UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                               UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                               UA_QUALIFIEDNAME(gw->ns, gw->name),
+                                               UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE),
+                                               oattr, NULL, folder);
+    if (rc != UA_STATUSCODE_GOOD) return rc;
+
+    static const char* status_names[STATUS_COUNT] = { "_connected", "_updates", "_reconnects" };
+    for (int i = 0; i < STATUS_COUNT; i++) {
+        gw->status[i].gw = gw;
+        gw->status[i].field = (StatusField)i;
+
+        UA_VariableAttributes vattr = UA_VariableAttributes_default;
+        vattr.displayName = UA_LOCALIZEDTEXT("en-US", (char*)status_names[i]);
+        vattr.dataType = i == STATUS_CONNECTED ? UA_TYPES[UA_TYPES_BOOLEAN].typeId
+                                               : UA_TYPES[UA_TYPES_UINT32].typeId;
+        vattr.accessLevel = UA_ACCESSLEVELMASK_READ;
+
+        UA_DataSource ds = { .read = readStatus, .write = NULL };
+        UA_Server_addDataSourceVariableNode(server, UA_NODEID_STRING(gw->ns, (char*)status_names[i]),
+                                            *folder, UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT),
+                                            UA_QUALIFIEDNAME(gw->ns, (char*)status_names[i]),
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                            vattr, ds, &gw->status[i], NULL);
+    }
+    return UA_STATUSCODE_GOOD;
+}
+
+// Browse the gateway's Objects folder and create a mirror node per variable
+static int create_mirror_nodes(Gateway* gw) {
+    UA_NodeId folder;
+    if (add_gateway_folder(gw, &folder) != UA_STATUSCODE_GOOD) {
+        printf("[%s] Failed to create folder\n", gw->name);
+        return -1;
+    }
+
+    UA_BrowseRequest breq;
+    UA_BrowseRequest_init(&breq);
+    UA_BrowseDescription bd;
+    UA_BrowseDescription_init(&bd);
+    bd.nodeId = UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER);
+    bd.browseDirection = UA_BROWSEDIRECTION_FORWARD;
+    bd.referenceTypeId = UA_NODEID_NUMERIC(0, UA_NS0ID_HIERARCHICALREFERENCES);
+    bd.includeSubtypes = true;
+    bd.nodeClassMask = UA_NODECLASS_VARIABLE;
+    bd.resultMask = UA_BROWSERESULTMASK_ALL;
+    breq.nodesToBrowse = &bd;
+    breq.nodesToBrowseSize = 1;
+    breq.requestedMaxReferencesPerNode = MAX_TAGS;
+
+    UA_BrowseResponse bresp = UA_Client_Service_browse(gw->client, breq);
+    if (bresp.responseHeader.serviceResult != UA_STATUSCODE_GOOD || bresp.resultsSize != 1) {
+        printf("[%s] Browse failed: 0x%08X\n", gw->name, bresp.responseHeader.serviceResult);
+        UA_BrowseResponse_clear(&bresp);
+        UA_NodeId_clear(&folder);
+        return -1;
+    }
+
+    for (size_t i = 0; i < bresp.results[0].referencesSize && gw->tag_count < MAX_TAGS; i++) {
+        UA_ReferenceDescription* ref = &bresp.results[0].references[i];
+        if (ref->nodeId.nodeId.namespaceIndex == 0) continue;  // Skip standard nodes (e.g. Server)
+
+        MirrorTag* tag = &gw->tags[gw->tag_count];
+        memset(tag, 0, sizeof(*tag));
+        tag->gw = gw;
+        UA_NodeId_copy(&ref->nodeId.nodeId, &tag->remote_id);
+        UA_NodeId_copy(&ref->nodeId.nodeId, &tag->local_id);
+        tag->local_id.namespaceIndex = gw->ns;
+        // Seed the cache so the node is never empty (the server would write a default)
+        UA_DataValue_init(&tag->value);
+        if (UA_Client_readValueAttribute(gw->client, tag->remote_id, &tag->value.value) == UA_STATUSCODE_GOOD) {
+            tag->value.hasValue = true;
+        } else {
+            tag->value.hasStatus = true;
+            tag->value.status = UA_STATUSCODE_BADWAITINGFORINITIALDATA;
+        }
+
+        UA_VariableAttributes vattr = UA_VariableAttributes_default;
+        vattr.displayName = ref->displayName;
+        UA_Client_readDataTypeAttribute(gw->client, tag->remote_id, &vattr.dataType);
+        UA_Client_readAccessLevelAttribute(gw->client, tag->remote_id, &tag->access_level);
+        vattr.accessLevel = tag->access_level;
+        if (settings.read_only) vattr.accessLevel &= (UA_Byte)~UA_ACCESSLEVELMASK_WRITE;
+
+        UA_QualifiedName qname = ref->browseName;
+        qname.namespaceIndex = gw->ns;
+        UA_DataSource ds = { .read = readMirror, .write = writeMirror };
+        UA_StatusCode rc = UA_Server_addDataSourceVariableNode(server, tag->local_id, folder,
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), qname,
+                                            UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE),
+                                            vattr, ds, tag, NULL);
+        UA_NodeId_clear(&vattr.dataType);
+        if (rc != UA_STATUSCODE_GOOD) {
+            printf("[%s] Cannot mirror variable: 0x%08X\n", gw->name, rc);
+            UA_NodeId_clear(&tag->remote_id);
+            UA_NodeId_clear(&tag->local_id);
+            UA_DataValue_clear(&tag->value);
+            continue;
+        }
+        gw->tag_count++;
+    }
+
+    UA_BrowseResponse_clear(&bresp);
+    UA_NodeId_clear(&folder);
+    printf("[%s] Mirrored %zu variables into ns=%u\n", gw->name, gw->tag_count, gw->ns);
+    gw->nodes_created = 1;
+    return 0;
+}
+
+// ========== UPSTREAM SUBSCRIPTION ==========
+
+static void
+dataChangeHandler(UA_Client* client, UA_UInt32 subId, void* subContext,
+                  UA_UInt32 monId, void* monContext, UA_DataValue* value) {
+    MirrorTag* tag = (MirrorTag*)monContext;
+    (void)client; (void)subId; (void)subContext; (void)monId;
+    UA_DataValue_clear(&tag->value);
+    UA_DataValue_copy(value, &tag->value);
+    tag->updates++;
+    tag->gw->updates++;
+}
+
+// Create the subscription with one monitored item per mirrored variable
+static int create_subscription(Gateway* gw) {
+    UA_CreateSubscriptionRequest sreq = UA_CreateSubscriptionRequest_default();
+    sreq.requestedPublishingInterval = settings.publish_ms;
+    sreq.maxNotificationsPerPublish = 0;
+    UA_CreateSubscriptionResponse sresp =
+        UA_Client_Subscriptions_create(gw->client, sreq, NULL, NULL, NULL);
+    if (sresp.responseHeader.serviceResult != UA_STATUSCODE_GOOD) {
+        printf("[%s] CreateSubscription failed: 0x%08X\n", gw->name, sresp.responseHeader.serviceResult);
+        return -1;
+    }
+    gw->sub_id = sresp.subscriptionId;
+
+    UA_MonitoredItemCreateRequest items[MAX_TAGS];
+    void* contexts[MAX_TAGS];
+    UA_Client_DataChangeNotificationCallback callbacks[MAX_TAGS];
+    UA_Client_DeleteMonitoredItemCallback deletes[MAX_TAGS];
+    for (size_t i = 0; i < gw->tag_count; i++) {
+        items[i] = UA_MonitoredItemCreateRequest_default(gw->tags[i].remote_id);
+        items[i].requestedParameters.samplingInterval = settings.sample_ms;
+        items[i].requestedParameters.queueSize = 1;
+        contexts[i] = &gw->tags[i];
+        callbacks[i] = dataChangeHandler;
+        deletes[i] = NULL;
+    }
+
+    UA_CreateMonitoredItemsRequest mreq;
+    UA_CreateMonitoredItemsRequest_init(&mreq);
+    mreq.subscriptionId = gw->sub_id;
+    mreq.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+    mreq.itemsToCreate = items;
+    mreq.itemsToCreateSize = gw->tag_count;
+
+    UA_CreateMonitoredItemsResponse mresp =
+        UA_Client_MonitoredItems_createDataChanges(gw->client, mreq, contexts, callbacks, deletes);
+    int ok = mresp.responseHeader.serviceResult == UA_STATUSCODE_GOOD;
+    size_t created = 0;
+    for (size_t i = 0; i < mresp.resultsSize; i++) {
+        if (mresp.results[i].statusCode == UA_STATUSCODE_GOOD) created++;
+    }
+    UA_CreateMonitoredItemsResponse_clear(&mresp);
+    if (!ok) {
+        printf("[%s] CreateMonitoredItems failed\n", gw->name);
+        return -1;
+    }
+    if (settings.verbose) {
+        printf("[%s] Subscription %u: %zu/%zu items\n", gw->name, gw->sub_id, created, gw->tag_count);
+    }
+    return 0;
+}
+
+// Mark all cached values of a gateway as stale
+static void mark_stale(Gateway* gw) {
+    for (size_t i = 0; i < gw->tag_count; i++) {
+        gw->tags[i].value.hasStatus = true;
+        gw->tags[i].value.status = UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    }
+}
+
+// Drop the upstream connection and schedule a reconnect
+static void gateway_disconnect(Gateway* gw, double now) {
+    if (gw->client) {
+        UA_Client_disconnect(gw->client);
+        UA_Client_delete(gw->client);
+        gw->client = NULL;
+    }
+    if (gw->connected) {
+        printf("[%s] Connection lost, retry in %.0f ms\n", gw->name, gw->backoff);
+    }
+    gw->connected = 0;
+    mark_stale(gw);
+    gw->next_connect = now + gw->backoff;
+    gw->backoff = gw->backoff * 2 > BACKOFF_MAX_MS ? BACKOFF_MAX_MS : gw->backoff * 2;
+}
+
+// Connect, build the mirror on first contact and start the subscription
+static void gateway_connect(Gateway* gw, double now) {
+    gw->client = UA_Client_new();
+    UA_ClientConfig* cc = UA_Client_getConfig(gw->client);
+    cc->timeout = CONNECT_TIMEOUT_MS;
+
+    UA_StatusCode rc = (settings.username && settings.password)
+        ? UA_Client_connectUsername(gw->client, gw->url, settings.username, settings.password)
+        : UA_Client_connect(gw->client, gw->url);
+    if (rc != UA_STATUSCODE_GOOD) {
+        if (settings.verbose) printf("[%s] Connect to %s failed: 0x%08X\n", gw->name, gw->url, rc);
+        gateway_disconnect(gw, now);
+        return;
+    }
+
+    if (!gw->nodes_created && create_mirror_nodes(gw) != 0) {
+        gateway_disconnect(gw, now);
+        return;
+    }
+    if (create_subscription(gw) != 0) {
+        gateway_disconnect(gw, now);
+        return;
+    }
+
+    gw->connected = 1;
+    gw->reconnects++;
+    gw->backoff = BACKOFF_MIN_MS;
+    printf("[%s] Connected to %s\n", gw->name, gw->url);
+}
+
+// Service one gateway: process notifications or retry the connection
+static void gateway_service(Gateway* gw, double now) {
+    if (!gw->connected) {
+        if (now >= gw->next_connect) gateway_connect(gw, now);
+        return;
+    }
+
+    UA_Client_run_iterate(gw->client, 0);
+
+    UA_SecureChannelState channel_state;
+    UA_SessionState session_state;
+    UA_StatusCode connect_status;
+    UA_Client_getState(gw->client, &channel_state, &session_state, &connect_status);
+    if (session_state != UA_SESSIONSTATE_ACTIVATED || connect_status != UA_STATUSCODE_GOOD) {
+        gateway_disconnect(gw, now);
+    }
+}
+
+// ========== MAIN ==========
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OPC UA MULTI-GATEWAY CONCENTRATOR\n");
+    printf("=============================================\n");
+    printf("Usage: %s [OPTIONS] NAME=URL [NAME=URL ...]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help           Show this help message\n");
+    printf("  -v, --verbose        Verbose output\n");
+    printf("  -P, --port N         Downstream server port (default: 4840)\n");
+    printf("  -u, --user NAME      Gateway username\n");
+    printf("  -p, --pass PASSWORD  Gateway password\n");
+    printf("  -i, --publish MS     Upstream publishing interval (default: 20)\n");
+    printf("  -s, --sample MS      Upstream sampling interval (default: 10)\n");
+    printf("  -c, --clients N      Maximum downstream sessions (default: 1000)\n");
+    printf("  -R, --read-only      Do not forward writes\n");
+    printf("\nExample:\n");
+    printf("  %s -u engineer -p readwrite456 line1=opc.tcp://10.0.0.128:4840 line2=opc.tcp://10.0.0.129:4840\n",
+           program_name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 1) {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    int port = 4840;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
+            settings.verbose = 1;
+        } else if (strcmp(argv[i], "-R") == 0 || strcmp(argv[i], "--read-only") == 0) {
+            settings.read_only = 1;
+        } else if ((strcmp(argv[i], "-P") == 0 || strcmp(argv[i], "--port") == 0) && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-u") == 0 || strcmp(argv[i], "--user") == 0) && i + 1 < argc) {
+            settings.username = argv[++i];
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pass") == 0) && i + 1 < argc) {
+            settings.password = argv[++i];
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--publish") == 0) && i + 1 < argc) {
+            settings.publish_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--clients") == 0) && i + 1 < argc) {
+            settings.max_clients = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sample") == 0) && i + 1 < argc) {
+            settings.sample_ms = atof(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        } else {
+            const char* eq = strchr(argv[i], '=');
+            size_t name_len = eq ? (size_t)(eq - argv[i]) : 0;
+            if (!eq || name_len == 0 || name_len >= sizeof(gateways[0].name) ||
+                strlen(eq + 1) >= sizeof(gateways[0].url) || gateway_count >= MAX_GATEWAYS) {
+                printf("Invalid gateway '%s' (expected NAME=opc.tcp://host:port)\n", argv[i]);
+                return 1;
+            }
+            Gateway* gw = &gateways[gateway_count++];
+            memcpy(gw->name, argv[i], name_len);
+            gw->name[name_len] = '\0';
+            strcpy(gw->url, eq + 1);
+            gw->backoff = BACKOFF_MIN_MS;
+        }
+    }
+
+    if (gateway_count == 0) {
+        printf("Error: no gateways given\n");
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    server = UA_Server_new();
+    UA_ServerConfig* sc = UA_Server_getConfig(server);
+    UA_ServerConfig_setMinimal(sc, (UA_UInt16)port, NULL);
+    // Serving from RAM is cheap; do not force the library's 100/50 ms minimums on SCADA clients
+    sc->publishingIntervalLimits.min = MIN_INTERVAL_MS;
+    sc->samplingIntervalLimits.min = MIN_INTERVAL_MS;
+    sc->maxSecureChannels = (UA_UInt16)(settings.max_clients > 65535 ? 65535 : settings.max_clients);
+    sc->maxSessions = (UA_UInt16)sc->maxSecureChannels;
+    UA_StatusCode rc = UA_Server_run_startup(server);
+    if (rc != UA_STATUSCODE_GOOD) {
+        printf("Server startup failed: 0x%08X\n", rc);
+        UA_Server_delete(server);
+        return 1;
+    }
+
+    printf("=============================================\n");
+    printf("   OPC UA CONCENTRATOR on port %d\n", port);
+    printf("   %zu gateways, publishing %.0f ms, sampling %.0f ms%s\n", gateway_count,
+           settings.publish_ms, settings.sample_ms, settings.read_only ? ", read-only" : "");
+    printf("=============================================\n\n");
+
+    double next_stats = now_ms() + STATS_INTERVAL_MS;
+    unsigned long last_updates[MAX_GATEWAYS] = { 0 };
+
+    while (running) {
+        double now = now_ms();
+        for (size_t i = 0; i < gateway_count; i++) {
+            gateway_service(&gateways[i], now);
+        }
+        UA_Server_run_iterate(server, false);
+
+        if (now >= next_stats) {
+            for (size_t i = 0; i < gateway_count; i++) {
+                Gateway* gw = &gateways[i];
+                printf("[%s] %s, %zu tags, %.1f updates/s, %lu connects\n", gw->name,
+                       gw->connected ? "online" : "offline", gw->tag_count,
+                       (gw->updates - last_updates[i]) * 1000.0 / STATS_INTERVAL_MS, gw->reconnects);
+                last_updates[i] = gw->updates;
+            }
+            next_stats = now + STATS_INTERVAL_MS;
+        }
+
+        usleep(LOOP_SLEEP_US);
+    }
+
+    // ========== CLEANUP ==========
+
+    for (size_t i = 0; i < gateway_count; i++) {
+        Gateway* gw = &gateways[i];
+        if (gw->client) {
+            UA_Client_disconnect(gw->client);
+            UA_Client_delete(gw->client);
+        }
+    }
+    UA_Server_run_shutdown(server);
+    UA_Server_delete(server);
+    for (size_t i = 0; i < gateway_count; i++) {
+        for (size_t t = 0; t < gateways[i].tag_count; t++) {
+            UA_NodeId_clear(&gateways[i].tags[t].remote_id);
+            UA_NodeId_clear(&gateways[i].tags[t].local_id);
+            UA_DataValue_clear(&gateways[i].tags[t].value);
+        }
+    }
+    printf("Concentrator stopped\n");
+    return 0;
+}
@@ -76,45 +76,179 @@ system_config_t g_config = {
     // НОВЫЕ поля OPC UA
     .opcua_auth_enable = true,           // Авторизация включена по умолчанию
     .opcua_anonymous_enable = false,      // Анонимный доступ разрешен по умолчанию
-    .opcua_user_count = 0                // Будет установлено в config_init_defaults
+    .opcua_users = {
+        // Пользователь 0: operator (только чтение и просмотр)
+        [0] = { .username = "operator", .password = "readonly123", .rights = OPCUA_ROLE_VIEWER, .enabled = true },
+        // Пользователь 1: engineer (чтение/запись)
+        [1] = { .username = "engineer", .password = "readwrite456", .rights = OPCUA_ROLE_OPERATOR, .enabled = true },
+        // Пользователь 2: admin (все права)
+        [2] = { .username = "admin", .password = "admin789", .rights = OPCUA_ROLE_ADMIN, .enabled = true }
+        // Остальные пользователи отключены
+    },
+    .opcua_user_count = 3,
+    .opcua_mdns_enable = false,          // Обнаружение через mDNS (FindServersOnNetwork)
+
+    // MQTT публикация образа процесса (выключена по умолчанию)
+    .mqtt = {
+        .enable = false,
+        .broker_host = "10.0.0.1",
+        .broker_port = 1883,
+        .client_id = "kincony-a16v3",
+        .username = "",
+        .password = "",
+        .topic = "kincony/a16v3/image",
+        .qos = 1,
+        .retain = false,
+        .format = MQTT_PUB_FORMAT_JSON,
+        .on_change = true,
+        .batch_window_ms = 20,           // Изменения за 20 мс объединяются в одно сообщение
+        .interval_ms = 10000,            // Полный образ каждые 10 с
+        .keepalive_s = 30
+    },
+
+    // HTTP endpoint для Prometheus/Grafana (без авторизации, выключен по умолчанию)
+    .http = {
+        .enable = false,
+        .port = 8080
+    },
+
+    // Трасса I/O в RAM (2048 записей = 16 КБ), запись с загрузки выключена
+    .trace = {
+        .enable = false,
+        .capacity = IO_TRACE_DEFAULT_CAPACITY
+    },
+
+    // Конвейер сервера: сеть на ядре 0, сервисы на ядре 1 (выключен по умолчанию)
+    .pipeline = {
+        .enable = false,
+        .net_core = 0,
+        .service_core = 1,
+        .queue_depth = OPCUA_PIPELINE_QUEUE_DEPTH
+    },
+
+    // Планировщик запросов: очередь на соединение, Write/Call на выходы вне очереди
+    .scheduler = {
+        .enabled = true,
+        .queueSize = 8,
+        .rateLimit = 0,                  // Без ограничения частоты запросов сессии
+        .rateBurst = 0,
+        .isPriorityNode = NULL           // Устанавливается в opcua_esp32.c (isOutputNode)
+    },
+
+    // Объединение отправки: ответы итерации уходят одним sendmsg
+    .send_coalescing = {
+        .enabled = true,
+        .maxChunks = 16,
+        .maxBytes = 5760                 // CONFIG_LWIP_TCP_SND_BUF_DEFAULT
+    },
+
+    // Сохранение подписок после тайм-аута сессии для TransferSubscriptions
+    .subscription_retention = {
+        .enabled = false,                // Отсоединенные подписки держат память; включать по месту
+        .maxDetachedMs = 600000          // Не дольше 10 минут без сессии
+    },
+
+    // Конфигурация времени выполнения: меняется методами объекта Configuration
+    .runtime = {
+        .version = 1,
+        .scan_interval_ms = {
+            [RUNTIME_SCAN_INPUTS] = 20,  // Дискретные входы каждые 20 мс
+            [RUNTIME_SCAN_ADC] = 100     // АЦП каждые 100 мс
+        },
+        .tags = {
+            [RUNTIME_TAG_DISCRETE_INPUTS] = { .exposed = true, .filter = 0, .deadband = 0 },
+            [RUNTIME_TAG_ADC_1] = { .exposed = true, .filter = 0, .deadband = 0 },
+            [RUNTIME_TAG_ADC_2] = { .exposed = true, .filter = 0, .deadband = 0 },
+            [RUNTIME_TAG_ADC_3] = { .exposed = true, .filter = 0, .deadband = 0 },
+            [RUNTIME_TAG_ADC_4] = { .exposed = true, .filter = 0, .deadband = 0 }
+        },
+        .frontends = { .mqtt = false, .http = false }  // Берутся из mqtt.enable и http.enable при загрузке
+    },
+
+    // Выключено: входы опрашиваются с периодом runtime.scan_interval_ms. Включенная политика
+    // опрашивает раз в тик (10 мс) секунду после изменения или при частом чтении клиентами,
+    // в покое период растет до 100 мс. Опрос входов и запись выходов занимают шину I2C
+    // не более чем на 20% времени
+    .scan_policy = {
+        .enable = false,
+        .min_interval_ms = 10,
+        .max_interval_ms = 100,
+        .hold_ms = 1000,
+        .bus_budget_pct = 20
+    },
+
+    // Выключено: пределы задаются под датчики объекта. Пределы в отсчетах АЦП (0..4095),
+    // возврат на hysteresis отсчетов, переход в более тяжелое состояние через delay_on_ms.
+    // Нижние пределы выключены: неподключенный вход читает 0
+    .alarms = {
+        .enable = false,
+        .channels = {
+            { .limits = ALARM_LIMIT_HI | ALARM_LIMIT_HIHI, .lolo = 100, .lo = 300, .hi = 3600, .hihi = 3900,
+              .hysteresis = 40, .delay_on_ms = 200 },
+            { .limits = ALARM_LIMIT_HI | ALARM_LIMIT_HIHI, .lolo = 100, .lo = 300, .hi = 3600, .hihi = 3900,
+              .hysteresis = 40, .delay_on_ms = 200 },
+            { .limits = ALARM_LIMIT_HI | ALARM_LIMIT_HIHI, .lolo = 100, .lo = 300, .hi = 3600, .hihi = 3900,
+              .hysteresis = 40, .delay_on_ms = 200 },
+            { .limits = ALARM_LIMIT_HI | ALARM_LIMIT_HIHI, .lolo = 100, .lo = 300, .hi = 3600, .hihi = 3900,
+              .hysteresis = 40, .delay_on_ms = 200 }
+        }
+    },
+
+    // Пара выключена: одиночный шлюз. Для пары второму блоку задать role = REDUNDANCY_BACKUP,
+    // peer_host и поменять местами server_uri и peer_uri; pair_key одинаковый на обоих блоках,
+    // без него пара не запускается. Переход на резерв через failover_ms тишины активного блока
+    // (5 интервалов heartbeat, 5 опросов входов)
+    .redundancy = {
+        .enable = false,
+        .role = REDUNDANCY_PRIMARY,
+        .peer_host = "10.0.0.129",
+        .local_port = REDUNDANCY_DEFAULT_PORT,
+        .peer_port = REDUNDANCY_DEFAULT_PORT,
+        .heartbeat_ms = 20,
+        .failover_ms = 100,
+        .server_uri = "open62541.esp32.server.a",
+        .peer_uri = "open62541.esp32.server.b",
+        .pair_key = ""
+    },
+
+    // Обновление по сети выключено: firmware.Update отвечает BadNotSupported. Подтверждение
+    // и откат образа работают и без него. Адрес задается в вызове firmware.Update. Новый
+    // образ подтверждается после минуты исправной работы; не подтвержденный за 10 минут
+    // откатывается
+    .ota = {
+        .enable = false,
+        .url = "",
+        .confirm_after_s = 60,
+        .rollback_after_s = 600
+    },
+
+    // Выключено: включать только когда реле DO1 заведено на вход DI1. Реле срабатывает
+    // за 5-15 мс, таймаут с запасом на опрос входов (20 мс) и их фильтр
+    .actuation = {
+        .enable = false,
+        .output = 0,
+        .input = 0,
+        .cycles = 100,
+        .pause_ms = 200,
+        .timeout_ms = 200
+    }
 };
 
 /* ==================== Существующие функции ==================== */
 
 void config_init_defaults(void)
 {
-    // Инициализация новых полей OPC UA
-    g_config.opcua_user_count = 3;
-    
-    // Пользователь 0: operator (только чтение и просмотр)
-    strcpy(g_config.opcua_users[0].username, "operator");
-    strcpy(g_config.opcua_users[0].password, "readonly123");
-    g_config.opcua_users[0].rights = OPCUA_ROLE_VIEWER;
-    g_config.opcua_users[0].enabled = true;
-    
-    // Пользователь 1: engineer (чтение/запись)
-    strcpy(g_config.opcua_users[1].username, "engineer");
-    strcpy(g_config.opcua_users[1].password, "readwrite456");
-    g_config.opcua_users[1].rights = OPCUA_ROLE_OPERATOR;
-    g_config.opcua_users[1].enabled = true;
-    
-    // Пользователь 2: admin (все права)
-    strcpy(g_config.opcua_users[2].username, "admin");
-    strcpy(g_config.opcua_users[2].password, "admin789");
-    g_config.opcua_users[2].rights = OPCUA_ROLE_ADMIN;
-    g_config.opcua_users[2].enabled = true;
-    
-    // Остальные пользователи отключены
-    for (int i = 3; i < 10; i++) {
-        g_config.opcua_users[i].username[0] = '\0';
-        g_config.opcua_users[i].password[0] = '\0';
-        g_config.opcua_users[i].rights = OPCUA_RIGHT_NONE;
-        g_config.opcua_users[i].enabled = false;
-    }
+    // Сохраненный образ заменяет встроенные значения целиком, иначе они остаются как есть
+    esp_err_t err = config_load();
     
     g_config.init_complete = true;
-    ESP_LOGI(TAG, "System configuration initialized with defaults");
-    ESP_LOGI(TAG, "OPC UA users: operator, engineer, admin");
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "System configuration loaded from NVS (generation %lu)",
+                 (unsigned long)config_generation());
+    } else {
+        ESP_LOGI(TAG, "System configuration initialized with defaults");
+    }
+    ESP_LOGI(TAG, "OPC UA users: %u", g_config.opcua_user_count);
     ESP_LOGI(TAG, "OPC UA auth: %s", g_config.opcua_auth_enable ? "enabled" : "disabled");
     ESP_LOGI(TAG, "OPC UA anonymous: %s", g_config.opcua_anonymous_enable ? "enabled" : "disabled");
 }
@@ -123,11 +257,13 @@ void config_wifi_set_static_ip(const char *ip, const char *netmask, const char *
 {
     if (!g_config.init_complete) return;
     
+    config_lock();
     g_config.wifi.ip_config.mode = NET_STATIC;
     g_config.wifi.ip_config.ip_info.ip.addr = config_ip_to_int(ip);
     g_config.wifi.ip_config.ip_info.netmask.addr = config_ip_to_int(netmask);
     g_config.wifi.ip_config.ip_info.gw.addr = config_ip_to_int(gateway);
-    g_config.config_changed = true;
+    config_mark_changed();
+    config_unlock();
     
     ESP_LOGI(TAG, "Wi-Fi static IP set: %s/%s gw:%s", ip, netmask, gateway);
 }
@@ -136,11 +272,13 @@ void config_eth_set_static_ip(const char *ip, const char *netmask, const char *g
 {
     if (!g_config.init_complete) return;
     
+    config_lock();
     g_config.eth.ip_config.mode = NET_STATIC;
     g_config.eth.ip_config.ip_info.ip.addr = config_ip_to_int(ip);
     g_config.eth.ip_config.ip_info.netmask.addr = config_ip_to_int(netmask);
     g_config.eth.ip_config.ip_info.gw.addr = config_ip_to_int(gateway);
-    g_config.config_changed = true;
+    config_mark_changed();
+    config_unlock();
     
     ESP_LOGI(TAG, "Ethernet static IP set: %s/%s gw:%s", ip, netmask, gateway);
 }
@@ -149,8 +287,10 @@ void config_wifi_set_dhcp(void)
 {
     if (!g_config.init_complete) return;
     
+    config_lock();
     g_config.wifi.ip_config.mode = NET_DHCP;
-    g_config.config_changed = true;
+    config_mark_changed();
+    config_unlock();
     ESP_LOGI(TAG, "Wi-Fi set to DHCP mode");
 }
 
@@ -158,8 +298,10 @@ void config_eth_set_dhcp(void)
 {
     if (!g_config.init_complete) return;
     
+    config_lock();
     g_config.eth.ip_config.mode = NET_DHCP;
-    g_config.config_changed = true;
+    config_mark_changed();
+    config_unlock();
     ESP_LOGI(TAG, "Ethernet set to DHCP mode");
 }
 
@@ -167,13 +309,15 @@ void config_set_dns_servers(const char *primary, const char *secondary)
 {
     if (!g_config.init_complete) return;
     
+    config_lock();
     g_config.wifi.ip_config.dns_primary = config_ip_to_int(primary);
     g_config.wifi.ip_config.dns_secondary = config_ip_to_int(secondary);
     
     g_config.eth.ip_config.dns_primary = g_config.wifi.ip_config.dns_primary;
     g_config.eth.ip_config.dns_secondary = g_config.wifi.ip_config.dns_secondary;
     
-    g_config.config_changed = true;
+    config_mark_changed();
+    config_unlock();
     ESP_LOGI(TAG, "DNS servers set: %s, %s", primary, secondary);
 }
 
@@ -181,6 +325,7 @@ void config_set_ntp_servers(const char *server1, const char *server2, const char
 {
     if (!g_config.init_complete) return;
     
+    config_lock();
     strncpy(g_config.time.ntp_server1, server1, sizeof(g_config.time.ntp_server1) - 1);
     g_config.time.ntp_server1[sizeof(g_config.time.ntp_server1) - 1] = '\0';
     
@@ -194,7 +339,8 @@ void config_set_ntp_servers(const char *server1, const char *server2, const char
         g_config.time.ntp_server3[sizeof(g_config.time.ntp_server3) - 1] = '\0';
     }
     
-    g_config.config_changed = true;
+    config_mark_changed();
+    config_unlock();
     ESP_LOGI(TAG, "NTP servers set: %s, %s, %s", 
              server1, server2 ? server2 : "none", server3 ? server3 : "none");
 }
@@ -260,8 +406,10 @@ bool config_is_opcua_auth_enabled(void) {
 }
 
 void config_set_opcua_auth_enabled(bool enabled) {
+    config_lock();
     g_config.opcua_auth_enable = enabled;
-    g_config.config_changed = true;
+    config_mark_changed();
+    config_unlock();
     ESP_LOGI(TAG, "OPC UA authentication %s", enabled ? "enabled" : "disabled");
 }
 
@@ -274,7 +422,9 @@ bool config_is_opcua_anonymous_enabled(void) {
 }
 
 void config_set_opcua_anonymous_enabled(bool enabled) {
+    config_lock();
     g_config.opcua_anonymous_enable = enabled;
-    g_config.config_changed = true;
+    config_mark_changed();
+    config_unlock();
     ESP_LOGI(TAG, "OPC UA anonymous access %s", enabled ? "enabled" : "disabled");
 }
\ No newline at end of file
@@ -4,6 +4,16 @@
 #include "esp_netif.h"
 //#include "driver/spi_master.h"
 #include "esp_eth.h"
+#include "mqtt_publisher.h"
+#include "http_snapshot.h"
+#include "io_trace.h"
+#include "scan_policy.h"
+#include "opcua_pipeline.h"
+#include "runtime_config.h"
+#include "alarm_engine.h"
+#include "redundancy.h"
+#include "ota_update.h"
+#include "actuation_test.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -112,6 +122,46 @@ typedef struct {
     bool opcua_anonymous_enable;     // Разрешен ли анонимный доступ при включенной авторизации
     opcua_user_t opcua_users[10];
     uint8_t opcua_user_count;
+    bool opcua_mdns_enable;          // Объявление сервера через mDNS (_opcua-tcp._tcp.local)
+
+    // Публикация образа процесса в MQTT
+    mqtt_publisher_config_t mqtt;
+
+    // HTTP endpoint для мониторинга (/metrics, /snapshot)
+    http_snapshot_config_t http;
+
+    // Запись трассы изменений I/O для последующего воспроизведения
+    io_trace_config_t trace;
+
+    // Разделение сервера: сетевая задача и задача сервисов на разных ядрах
+    opcua_pipeline_config_t pipeline;
+
+    // Справедливая обработка запросов разных соединений (только без конвейера)
+    UA_TcpSchedulerConfig scheduler;
+
+    // Отправка ответов одним sendmsg за итерацию сервера (только без конвейера)
+    UA_TcpSendConfig send_coalescing;
+
+    // Подписки клиента, пропавшего без CloseSession, ждут TransferSubscriptions
+    UA_SubscriptionRetentionConfig subscription_retention;
+
+    // Начальный снимок конфигурации, меняемой на ходу (опрос, теги, фронтенды)
+    runtime_config_t runtime;
+
+    // Адаптивный опрос входов: пределы периода, удержание после изменения, бюджет шины I2C
+    scan_policy_config_t scan_policy;
+
+    // Пределы аналоговых каналов (HiHi/Hi/Lo/LoLo) и события OPC UA при их пересечении
+    alarm_config_t alarms;
+
+    // Пара горячего резерва: роль, адрес соседа, репликация образа процесса по UDP
+    redundancy_config_t redundancy;
+
+    // Обновление прошивки A/B: адрес образа или патча, сроки подтверждения нового образа
+    ota_update_config_t ota;
+
+    // Самопроверка выход -> вход: какой выход заведен на какой вход, число циклов
+    actuation_test_config_t actuation;
 } system_config_t;
 
 extern system_config_t g_config;
@@ -138,6 +188,32 @@ void config_set_opcua_auth_enabled(bool enabled);
 bool config_is_opcua_anonymous_enabled(void);
 void config_set_opcua_anonymous_enabled(bool enabled);
 
+/* ==================== Хранение конфигурации в NVS ==================== */
+
+#define CONFIG_IMAGE_MAGIC         0x47464341u  // "ACFG"
+#define CONFIG_IMAGE_LAYOUT        1            // Записи по полям system_config_t
+#define CONFIG_PERSIST_DELAY_MS    2000         // Задержка записи после изменения на ходу
+
+// Заголовок образа: за ним в том же блобе NVS лежат записи полей system_config_t
+typedef struct {
+    uint32_t magic;
+    uint16_t layout;                 // CONFIG_IMAGE_LAYOUT
+    uint16_t header_size;            // sizeof(config_image_header_t)
+    uint32_t payload_size;           // Размер записей за заголовком
+    uint32_t layout_hash;            // Отпечаток тегов и раскладки полей
+    uint32_t generation;             // Номер записи, растет с каждым config_commit()
+    uint32_t crc32;                  // CRC32 полезной нагрузки
+} config_image_header_t;
+
+esp_err_t config_load(void);
+esp_err_t config_commit(void);
+esp_err_t config_erase_stored(void);
+uint32_t config_generation(void);
+void config_lock(void);
+void config_unlock(void);
+void config_mark_changed(void);
+void config_set_runtime(const runtime_config_t *runtime);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,422 @@
+#include "config.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "config_store";
+
+#define CONFIG_NVS_NAMESPACE  "sysconfig"
+#define CONFIG_NVS_KEY        "image"
+
+// Образ - один блоб: заголовок, затем записи по полям system_config_t.
+// Запись несет тег поля, размер и отпечаток его вложенной раскладки, так что
+// после обновления прошивки поле, которое не изменилось, читается как есть,
+// а измененное или новое остается со значением по умолчанию.
+typedef struct {
+    uint16_t tag;                    // Тег поля из config_fields
+    uint16_t reserved;
+    uint32_t size;                   // Размер данных записи
+    uint32_t layout_hash;            // Отпечаток раскладки поля
+} config_record_t;
+
+typedef struct {
+    uint16_t tag;
+    uint16_t layout_count;
+    uint32_t offset;
+    uint32_t size;
+    const uint32_t *layout;
+} config_field_t;
+
+// Смещения и размеры полей: любое перемещение поля меняет отпечаток
+#define LAYOUT_FIELD(type, field) offsetof(type, field), sizeof(((type *)0)->field)
+
+// Поле образа: тег и смещения вложенных полей, которые входят в его отпечаток
+#define CONFIG_FIELD(tag, field, ...) {                                        \
+    tag, sizeof((const uint32_t[]){ 0, ##__VA_ARGS__ }) / sizeof(uint32_t),   \
+    offsetof(system_config_t, field), sizeof(((system_config_t *)0)->field),  \
+    (const uint32_t[]){ 0, ##__VA_ARGS__ } }
+
+// Теги не переиспользуются: поле, сменившее смысл, получает новый тег.
+// Поля текущего запуска (init_complete, config_changed) не хранятся.
+static const config_field_t config_fields[] = {
+    CONFIG_FIELD(1, wifi, LAYOUT_FIELD(app_wifi_config_t, ip_config)),
+    CONFIG_FIELD(2, eth, LAYOUT_FIELD(eth_config_t, ip_config)),
+    CONFIG_FIELD(3, time),
+    CONFIG_FIELD(4, ip_forwarding),
+    CONFIG_FIELD(5, prefer_wifi),
+    CONFIG_FIELD(6, opcua_auth_enable),
+    CONFIG_FIELD(7, opcua_anonymous_enable),
+    CONFIG_FIELD(8, opcua_users, LAYOUT_FIELD(opcua_user_t, rights)),
+    CONFIG_FIELD(9, opcua_user_count),
+    CONFIG_FIELD(10, opcua_mdns_enable),
+    CONFIG_FIELD(11, mqtt, LAYOUT_FIELD(mqtt_publisher_config_t, topic)),
+    CONFIG_FIELD(12, http),
+    CONFIG_FIELD(13, trace),
+    CONFIG_FIELD(14, pipeline),
+    CONFIG_FIELD(15, scheduler),
+    CONFIG_FIELD(16, send_coalescing),
+    CONFIG_FIELD(17, subscription_retention),
+    CONFIG_FIELD(18, runtime, LAYOUT_FIELD(runtime_config_t, tags)),
+    CONFIG_FIELD(19, scan_policy),
+    CONFIG_FIELD(20, alarms, LAYOUT_FIELD(alarm_config_t, channels)),
+    CONFIG_FIELD(21, redundancy, LAYOUT_FIELD(redundancy_config_t, server_uri)),
+    CONFIG_FIELD(22, ota, LAYOUT_FIELD(ota_update_config_t, url)),
+    CONFIG_FIELD(23, actuation),
+};
+
+#define CONFIG_FIELD_COUNT (sizeof(config_fields) / sizeof(config_fields[0]))
+
+static SemaphoreHandle_t store_mutex = NULL;
+static esp_timer_handle_t persist_timer = NULL;
+static uint32_t stored_generation = 0;
+
+// FNV-1a
+static uint32_t config_hash(uint32_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t config_field_hash(const config_field_t *field)
+{
+    uint32_t hash = config_hash(2166136261u, &field->size, sizeof(field->size));
+    return config_hash(hash, field->layout, field->layout_count * sizeof(uint32_t));
+}
+
+// Отпечаток всех полей: совпадает, если образ записан этой же раскладкой
+static uint32_t config_layout_hash(void)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        uint32_t field_hash = config_field_hash(&config_fields[i]);
+        hash = config_hash(hash, &config_fields[i].tag, sizeof(config_fields[i].tag));
+        hash = config_hash(hash, &field_hash, sizeof(field_hash));
+    }
+    return hash;
+}
+
+static const config_field_t *config_find_field(uint16_t tag)
+{
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (config_fields[i].tag == tag) {
+            return &config_fields[i];
+        }
+    }
+    return NULL;
+}
+
+static size_t config_image_size(void)
+{
+    size_t size = sizeof(config_image_header_t);
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        size += sizeof(config_record_t) + config_fields[i].size;
+    }
+    return size;
+}
+
+// Указатель на функцию из образа не имеет смысла в этом запуске
+static void config_clear_volatile(system_config_t *config)
+{
+    config->scheduler.isPriorityNode = NULL;
+}
+
+static void config_persist_cb(void *arg)
+{
+    esp_err_t err = config_commit();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Deferred configuration save failed: %s", esp_err_to_name(err));
+    }
+}
+
+static void config_schedule_persist(void)
+{
+    // Серия изменений записывается один раз, чтобы не изнашивать flash
+    if (persist_timer != NULL) {
+        esp_timer_stop(persist_timer);
+        esp_timer_start_once(persist_timer, (uint64_t)CONFIG_PERSIST_DELAY_MS * 1000);
+    }
+}
+
+static esp_err_t config_store_init(void)
+{
+    if (store_mutex == NULL) {
+        store_mutex = xSemaphoreCreateMutex();
+        if (store_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (persist_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = config_persist_cb,
+            .name = "config_persist"
+        };
+        esp_err_t err = esp_timer_create(&args, &persist_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t config_load_records(const uint8_t *payload, uint32_t size, uint32_t layout_hash)
+{
+    // Сначала проверяется вся цепочка записей, чтобы не применить образ наполовину
+    uint32_t offset = 0;
+    while (offset < size) {
+        config_record_t record;
+        if (size - offset < sizeof(record)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(&record, payload + offset, sizeof(record));
+        offset += sizeof(record);
+        if (record.size > size - offset) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        offset += record.size;
+    }
+
+    unsigned restored = 0;
+    unsigned skipped = 0;
+    offset = 0;
+    while (offset < size) {
+        config_record_t record;
+        memcpy(&record, payload + offset, sizeof(record));
+        offset += sizeof(record);
+        const config_field_t *field = config_find_field(record.tag);
+        if (field != NULL && field->size == record.size &&
+            config_field_hash(field) == record.layout_hash) {
+            memcpy((uint8_t *)&g_config + field->offset, payload + offset, record.size);
+            restored++;
+        } else {
+            ESP_LOGW(TAG, "Stored field %u (%lu bytes) does not match this firmware, keeping default",
+                     record.tag, (unsigned long)record.size);
+            skipped++;
+        }
+        offset += record.size;
+    }
+
+    if (layout_hash != config_layout_hash()) {
+        ESP_LOGW(TAG, "Image written by another layout: %u fields restored, %u dropped, %u new",
+                 restored, skipped, (unsigned)(CONFIG_FIELD_COUNT - restored));
+    }
+    return ESP_OK;
+}
+
+esp_err_t config_load(void)
+{
+    esp_err_t err = config_store_init();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    nvs_handle_t nvs;
+    err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err != ESP_OK) {
+        // Пространства имен нет до первого config_commit()
+        return err == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : err;
+    }
+
+    int64_t start = esp_timer_get_time();
+    size_t size = 0;
+    err = nvs_get_blob(nvs, CONFIG_NVS_KEY, NULL, &size);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        nvs_close(nvs);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (err == ESP_OK && size < sizeof(config_image_header_t)) {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t *image = NULL;
+    if (err == ESP_OK) {
+        image = malloc(size);
+        err = image == NULL ? ESP_ERR_NO_MEM : nvs_get_blob(nvs, CONFIG_NVS_KEY, image, &size);
+    }
+    nvs_close(nvs);
+    if (err != ESP_OK) {
+        free(image);
+        ESP_LOGE(TAG, "Failed to read configuration image: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    config_image_header_t header;
+    memcpy(&header, image, sizeof(header));
+    if (header.magic != CONFIG_IMAGE_MAGIC ||
+        header.header_size != sizeof(config_image_header_t) ||
+        header.payload_size != size - sizeof(config_image_header_t)) {
+        free(image);
+        ESP_LOGW(TAG, "Stored image has no valid header, using defaults");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    // Следующая запись продолжает нумерацию даже поверх несовместимого образа
+    stored_generation = header.generation;
+
+    const uint8_t *payload = image + sizeof(config_image_header_t);
+    if (esp_rom_crc32_le(0, payload, header.payload_size) != header.crc32) {
+        free(image);
+        ESP_LOGW(TAG, "Stored image CRC mismatch, using defaults");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    if (header.layout == CONFIG_IMAGE_LAYOUT) {
+        err = config_load_records(payload, header.payload_size, header.layout_hash);
+    } else {
+        ESP_LOGW(TAG, "Stored image layout %u is not supported by firmware layout %u, using defaults",
+                 header.layout, CONFIG_IMAGE_LAYOUT);
+        err = ESP_ERR_INVALID_VERSION;
+    }
+    free(image);
+    if (err != ESP_OK) {
+        return err;
+    }
+    config_clear_volatile(&g_config);
+
+    ESP_LOGI(TAG, "Configuration image generation %lu loaded (%u bytes, %lld us)",
+             (unsigned long)stored_generation, (unsigned)size,
+             (long long)(esp_timer_get_time() - start));
+    if (header.layout_hash != config_layout_hash()) {
+        // Образ переписывается в раскладке этой прошивки
+        config_schedule_persist();
+    }
+    return ESP_OK;
+}
+
+esp_err_t config_commit(void)
+{
+    if (store_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t size = config_image_size();
+    uint8_t *image = malloc(size);
+    if (image == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    uint8_t *payload = image + sizeof(config_image_header_t);
+    size_t offset = 0;
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const config_field_t *field = &config_fields[i];
+        const config_record_t record = {
+            .tag = field->tag,
+            .size = field->size,
+            .layout_hash = config_field_hash(field)
+        };
+        memcpy(payload + offset, &record, sizeof(record));
+        offset += sizeof(record);
+        memcpy(payload + offset, (const uint8_t *)&g_config + field->offset, field->size);
+        if (field->offset == offsetof(system_config_t, scheduler)) {
+            // Указатель на функцию не переживает перезагрузку
+            memset(payload + offset + offsetof(UA_TcpSchedulerConfig, isPriorityNode), 0,
+                   sizeof(g_config.scheduler.isPriorityNode));
+        }
+        offset += field->size;
+    }
+
+    const config_image_header_t header = {
+        .magic = CONFIG_IMAGE_MAGIC,
+        .layout = CONFIG_IMAGE_LAYOUT,
+        .header_size = sizeof(config_image_header_t),
+        .payload_size = offset,
+        .layout_hash = config_layout_hash(),
+        .generation = stored_generation + 1,
+        .crc32 = esp_rom_crc32_le(0, payload, offset)
+    };
+    memcpy(image, &header, sizeof(header));
+
+    // NVS заменяет блоб атомарно: после сбоя питания остается либо старый, либо новый образ
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, CONFIG_NVS_KEY, image, size);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+
+    if (err == ESP_OK) {
+        stored_generation = header.generation;
+        g_config.config_changed = false;
+    }
+    xSemaphoreGive(store_mutex);
+    free(image);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store configuration image: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Configuration image generation %lu stored (%u bytes)",
+             (unsigned long)stored_generation, (unsigned)size);
+    return ESP_OK;
+}
+
+esp_err_t config_erase_stored(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_erase_key(nvs, CONFIG_NVS_KEY);
+    if (err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Stored configuration erased, defaults apply after reboot");
+    }
+    return err;
+}
+
+uint32_t config_generation(void)
+{
+    return stored_generation;
+}
+
+// Сеттеры меняют g_config под тем же мьютексом, под которым config_commit() его читает
+void config_lock(void)
+{
+    if (store_mutex != NULL) {
+        xSemaphoreTake(store_mutex, portMAX_DELAY);
+    }
+}
+
+void config_unlock(void)
+{
+    if (store_mutex != NULL) {
+        xSemaphoreGive(store_mutex);
+    }
+}
+
+void config_mark_changed(void)
+{
+    g_config.config_changed = true;
+    config_schedule_persist();
+}
+
+void config_set_runtime(const runtime_config_t *runtime)
+{
+    if (runtime == NULL || store_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    g_config.runtime = *runtime;
+    g_config.mqtt.enable = runtime->frontends.mqtt;
+    g_config.http.enable = runtime->frontends.http;
+    g_config.config_changed = true;
+    xSemaphoreGive(store_mutex);
+
+    config_schedule_persist();
+}
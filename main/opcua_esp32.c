@@ -11,7 +11,8 @@
 #include "io_cache.h"        // Кэш ввода/вывода
 #include "network_manager.h" // Менеджер сети
 #include "esp_task_wdt.h"    // Watchdog
-#include "esp_sntp.h"        // SNTP
+#include "esp_timer.h"       // Время с момента загрузки
+#include "esp_system.h"      // Свободная куча
 #include "nvs_flash.h"       // NVS
 #include "esp_err.h"         // Ошибки ESP
 #include "esp_flash.h"       // Flash
@@ -20,8 +21,19 @@
 #include "esp_eth.h"         // Ethernet
 #include "config.h"          // Конфигурация
 #include "ua_accesscontrol_custom.h"  // Кастомная аутентификация OPC UA
+#include "mqtt_publisher.h"   // MQTT публикация образа процесса
+#include "http_snapshot.h"    // HTTP endpoint для мониторинга
+#include "value_cache.h"      // Кэш закодированных значений
+#include "runtime_config_ua.h" // Конфигурация, меняемая на ходу
+#include "clock_service_ua.h"  // Дисциплинированные часы (NTP)
+#include "alarm_engine_ua.h"   // Пределы аналоговых каналов и события
+#include "redundancy_ua.h"     // Пара горячего резерва
+#include "ota_update_ua.h"     // Обновление прошивки A/B
+#include "latency_probe.h"     // Зонд сквозной задержки
+#include "actuation_test_ua.h" // Самопроверка задержки срабатывания выход -> вход
 
 #define EXAMPLE_ESP_MAXIMUM_RETRY 10
+#define NTP_POLL_MIN_S 16          // Начальный интервал опроса NTP, растет до time.sync_interval
 
 #define TAG "OPCUA_ESP32"
 #define SNTP_TAG "SNTP"
@@ -30,19 +42,16 @@
 
 // Объявление функций
 static void opcua_task(void *arg);
-static bool obtain_time(void);
-static void initialize_sntp(void);
+static void start_clock_service(void);
 static void opc_network_state_callback(bool connected, esp_netif_t *netif);
 static void start_opcua_fallback(void *arg);
 static void check_and_start_opcua(void);
+static void apply_runtime_config(const runtime_config_t *cfg, void *context);
 
 UA_ServerConfig *config;
-static UA_Boolean esp_sntp_initialized = false;
 static UA_Boolean running = true;
 static UA_Boolean isServerCreated = false;
 RTC_DATA_ATTR static int boot_count = 0;
-static struct tm timeinfo;
-static time_t now = 0;
 static bool network_initialized = false;
 
 // Флаг для принудительного запуска OPC UA через таймер
@@ -56,6 +65,10 @@ static void opc_network_state_callback(bool connected, esp_netif_t *netif) {
         ESP_LOGI(TAG, "Network is now connected!");
         network_initialized = true;
         
+        if (g_config.time.sync_on_ip_obtained) {
+            clock_service_trigger();
+        }
+        
         // Даем сети немного времени на стабилизацию
         vTaskDelay(pdMS_TO_TICKS(1000));
         
@@ -113,14 +126,15 @@ static void check_and_start_opcua(void) {
         ESP_LOGI(TAG, "Active interface IP: " IPSTR, IP2STR(&ip_info.ip));
     }
     
-    // Запускаем OPC UA сервер
+    // Запускаем OPC UA сервер; в режиме конвейера сервисы выполняются на своем ядре
+    BaseType_t opcua_core = g_config.pipeline.enable ? g_config.pipeline.service_core : 0;
     BaseType_t task_created = xTaskCreatePinnedToCore(opcua_task, "opcua_task", 
-                                                      24336, NULL, 5, NULL, 0);
+                                                      24336, NULL, 5, NULL, opcua_core);
     if (task_created != pdPASS) {
         ESP_LOGE(TAG, "Failed to create OPC UA task!");
         // Попробуем еще раз с меньшим стеком
         task_created = xTaskCreatePinnedToCore(opcua_task, "opcua_task", 
-                                               16384, NULL, 5, NULL, 0);
+                                               16384, NULL, 5, NULL, opcua_core);
         if (task_created != pdPASS) {
             ESP_LOGE(TAG, "Failed to create OPC UA task even with smaller stack!");
         } else {
@@ -160,6 +174,40 @@ UA_ServerConfig_setUriName(UA_ServerConfig *uaServerConfig, const char *uri, con
     return UA_STATUSCODE_GOOD;
 }
 
+#ifdef UA_ENABLE_DISCOVERY_MULTICAST
+// Объявление сервера через mDNS (_opcua-tcp._tcp.local) с адресом активного интерфейса.
+// Сокет mDNS ждет в общем select() сервера, объявления идут по таймеру сервера.
+static void configure_mdns(UA_ServerConfig *uaServerConfig, const char *serverName)
+{
+    esp_netif_t *netif = network_manager_get_active_netif();
+    if (netif == NULL) {
+        netif = network_manager_get_eth_netif();
+    }
+    if (netif == NULL) {
+        netif = network_manager_get_wifi_netif();
+    }
+    esp_netif_ip_info_t ip_info;
+    if (netif == NULL || esp_netif_get_ip_info(netif, &ip_info) != ESP_OK || ip_info.ip.addr == 0) {
+        ESP_LOGW(TAG, "mDNS discovery not started: no IP address");
+        return;
+    }
+
+#if !defined(UA_HAS_GETIFADDR)
+    // Без getifaddrs() адреса для A-записей берутся из конфигурации
+    uaServerConfig->mdnsIpAddressList = (UA_UInt32 *)UA_malloc(sizeof(UA_UInt32));
+    if (uaServerConfig->mdnsIpAddressList == NULL) {
+        return;
+    }
+    uaServerConfig->mdnsIpAddressList[0] = ip_info.ip.addr;
+    uaServerConfig->mdnsIpAddressListSize = 1;
+#endif
+    UA_MdnsDiscoveryConfiguration_clear(&uaServerConfig->mdnsConfig);
+    uaServerConfig->mdnsConfig.mdnsServerName = UA_String_fromChars(serverName);
+    uaServerConfig->mdnsEnabled = true;
+    ESP_LOGI(TAG, "mDNS discovery: %s at " IPSTR, serverName, IP2STR(&ip_info.ip));
+}
+#endif
+
 static void opcua_task(void *arg)
 {
     ESP_LOGI(TAG, "OPC UA Server task starting on core %d", xPortGetCoreID());
@@ -192,6 +240,25 @@ static void opcua_task(void *arg)
     UA_ServerConfig *config = UA_Server_getConfig(server);
     UA_ServerConfig_setMinimalCustomBuffer(config, 4840, 0, sendBufferSize, recvBufferSize);
 
+    // Очереди запросов по соединениям: запись выходов не ждёт за Browse/Read
+    UA_TcpSchedulerConfig scheduler = g_config.scheduler;
+    scheduler.isPriorityNode = isOutputNode;
+    UA_ServerNetworkLayerTCP_setScheduler(&scheduler);
+
+    // Ответы одной итерации (Read, Publish) отправляются одним sendmsg
+    UA_ServerNetworkLayerTCP_setSendCoalescing(&g_config.send_coalescing);
+
+    // Подписки сессии, истёкшей после обрыва связи, остаются для TransferSubscriptions
+    UA_Server_setSubscriptionRetention(&g_config.subscription_retention);
+
+    // Сетевой ввод/вывод и сборка чанков в отдельной задаче на другом ядре
+    if (g_config.pipeline.enable) {
+        UA_StatusCode pipe_status = opcua_pipeline_install(config, 4840, &g_config.pipeline);
+        if (pipe_status != UA_STATUSCODE_GOOD) {
+            ESP_LOGW(TAG, "Server pipeline not installed: 0x%08X, using single-task server", pipe_status);
+        }
+    }
+
     // ============ НАСТРОЙКА КАСТОМНОЙ АУТЕНТИФИКАЦИИ ============
     ESP_LOGI(TAG, "Configuring custom authentication plugin...");
     
@@ -214,12 +281,20 @@ static void opcua_task(void *arg)
     }
     // ============ КОНЕЦ НАСТРОЙКИ АУТЕНТИФИКАЦИИ ============
 
-    const char *appUri = "open62541.esp32.server";
+    // У блоков пары разные URI: клиент различает их по ServerUriArray
+    const char *appUri = redundancy_enabled() ? g_config.redundancy.server_uri : "open62541.esp32.server";
     UA_String hostName = UA_STRING("opcua-esp32");
     
     UA_ServerConfig_setUriName(config, appUri, "OPC_UA_Server_ESP32");
     UA_ServerConfig_setCustomHostname(config, hostName);
 
+#ifdef UA_ENABLE_DISCOVERY_MULTICAST
+    // Имена mDNS блоков пары различаются так же, как их URI
+    if (g_config.opcua_mdns_enable) {
+        configure_mdns(config, redundancy_enabled() ? g_config.redundancy.server_uri : "OPC_UA_Server_ESP32");
+    }
+#endif
+
     ESP_LOGI(TAG, "Server configured, adding variables...");
 
     // Define Node IDs for all variables
@@ -301,6 +376,12 @@ static void opcua_task(void *arg)
         ESP_LOGI(TAG, "Loopback output added");
     }
 
+    // 4. Зонд задержки: метки приема, выполнения и доставки запроса клиента
+    latency_probe_add_ua_nodes(server);
+
+    /* Узлы из io_cache отдают заранее закодированные значения */
+    value_cache_init();
+
     /* Add Information Model Objects Here */
     ESP_LOGI(TAG, "Adding discrete I/O variables...");
     addDiscreteIOVariables(server);
@@ -308,6 +389,20 @@ static void opcua_task(void *arg)
     ESP_LOGI(TAG, "Adding ADC variables...");
     addAdcVariables(server);
     
+    ESP_LOGI(TAG, "Adding I/O trace variables...");
+    addIoTraceVariables(server);
+    addScanPolicyVariables(server);
+    
+    ESP_LOGI(TAG, "Adding runtime configuration object...");
+    runtime_config_add_ua_nodes(server);
+    clock_service_add_ua_nodes(server);
+    
+    // После узлов АЦП: они источники событий объекта Alarms
+    alarm_engine_add_ua_nodes(server);
+    redundancy_add_ua_nodes(server);
+    ota_update_add_ua_nodes(server);
+    actuation_test_add_ua_nodes(server);
+    
     ESP_LOGI(TAG, "All variables added, starting server...");
     
     UA_StatusCode retval = UA_Server_run_startup(server);
@@ -321,6 +416,15 @@ static void opcua_task(void *arg)
     }
     
     ESP_LOGI(TAG, "OPC UA server running on port 4840");
+    // Профиль стека, время старта и куча после запуска (сравнение профилей сборки)
+#ifdef UA_PROFILE_NANO
+    const char *stackProfile = "nano";
+#else
+    const char *stackProfile = "standard";
+#endif
+    ESP_LOGI(TAG, "Stack profile: %s, server up %lld ms after boot, free heap %lu bytes",
+             stackProfile, (long long)(esp_timer_get_time() / 1000),
+             (unsigned long)esp_get_free_heap_size());
     ESP_LOGI(TAG, "Server URI: opc.tcp://[IP]:4840");
     
     // Получаем и выводим IP адрес для удобства
@@ -376,79 +480,69 @@ static void opcua_task(void *arg)
     vTaskDelete(NULL);
 }
 
-void time_sync_notification_cb(struct timeval *tv)
+// Часы: монотонное время esp_timer, приведенное к UTC по NTP плавной подстройкой
+static void start_clock_service(void)
 {
-    ESP_LOGI(SNTP_TAG, "Time synchronized");
+    if (g_config.time.mode != TIME_SYNC_SNTP) {
+        ESP_LOGI(SNTP_TAG, "Time synchronization disabled");
+        return;
+    }
+    
+    clock_service_config_t clock_config = {
+        .servers = { g_config.time.ntp_server1, g_config.time.ntp_server2, g_config.time.ntp_server3 },
+        .port = 123,
+        .poll_min_s = NTP_POLL_MIN_S,
+        .poll_max_s = g_config.time.sync_interval > NTP_POLL_MIN_S ? g_config.time.sync_interval : NTP_POLL_MIN_S,
+        .set_system_time = true
+    };
+    esp_err_t err = clock_service_start(&clock_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(SNTP_TAG, "Failed to start clock service: %s", esp_err_to_name(err));
+        return;
+    }
+    
+    // Метки времени сервера OPC UA берутся из дисциплинированных часов
+    UA_DateTime_setSource(clock_service_ua_now);
 }
 
-static void initialize_sntp(void)
+// Новый образ считается исправным, пока есть сеть и работает сервер OPC UA
+static bool firmware_healthy(void)
 {
-    ESP_LOGI(SNTP_TAG, "Initializing SNTP");
-    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
-    esp_sntp_setservername(0, "pool.ntp.org");
-    esp_sntp_setservername(1, "time.google.com");
-    esp_sntp_set_time_sync_notification_cb(time_sync_notification_cb);
-    
-    esp_sntp_init();
-    esp_sntp_initialized = true;
+    return network_initialized && isServerCreated;
 }
 
-static bool obtain_time(void)
+// Включение и выключение MQTT/HTTP после применения нового снимка конфигурации
+static void apply_runtime_config(const runtime_config_t *cfg, void *context)
 {
-    initialize_sntp();
-    
-    esp_err_t wdt_err = esp_task_wdt_add(NULL);
-    if (wdt_err != ESP_OK) {
-        ESP_LOGE(WDT_TAG, "Failed to add SNTP task to WDT: %s", esp_err_to_name(wdt_err));
-    }
-    
-    memset(&timeinfo, 0, sizeof(struct tm));
-    int retry = 0;
-    const int retry_count = 10;
-    
-    ESP_LOGI(SNTP_TAG, "Getting time from NTP...");
-    
-    while (esp_sntp_get_sync_status() == SNTP_SYNC_STATUS_RESET && ++retry <= retry_count)
-    {
-        if (retry % 3 == 0) {
-            ESP_LOGW(SNTP_TAG, "Waiting for NTP response... (%d/%d)", retry, retry_count);
-        }
-        
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
-        
-        esp_err_t reset_err = esp_task_wdt_reset();
-        if (reset_err != ESP_OK) {
-            ESP_LOGE(WDT_TAG, "SNTP WDT reset failed: %s", esp_err_to_name(reset_err));
+    // Принятая конфигурация переживает перезагрузку (запись в NVS отложена)
+    config_set_runtime(cfg);
+
+    mqtt_publisher_set_paused(!cfg->frontends.mqtt);
+    if (cfg->frontends.mqtt) {
+        // Не запущенный при загрузке публикатор запускается с настройками g_config.mqtt
+        mqtt_publisher_config_t mqtt = g_config.mqtt;
+        mqtt.enable = true;
+        esp_err_t err = mqtt_publisher_start(&mqtt);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+            ESP_LOGE(TAG, "Failed to start MQTT publisher: %s", esp_err_to_name(err));
         }
     }
-    
-    time(&now);
-    localtime_r(&now, &timeinfo);
-    
-    esp_err_t delete_err = esp_task_wdt_delete(NULL);
-    if (delete_err != ESP_OK) {
-        ESP_LOGE(WDT_TAG, "Failed to delete SNTP task from WDT: %s", esp_err_to_name(delete_err));
-    }
-    
-    if (timeinfo.tm_year <= (2016 - 1900)) {
-        ESP_LOGE(SNTP_TAG, "Failed to get valid time from NTP");
-        return false;
+
+    http_snapshot_set_paused(!cfg->frontends.http);
+    if (cfg->frontends.http) {
+        http_snapshot_config_t http = g_config.http;
+        http.enable = true;
+        esp_err_t err = http_snapshot_start(&http);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+            ESP_LOGE(TAG, "Failed to start HTTP snapshot endpoint: %s", esp_err_to_name(err));
+        }
     }
-    
-    ESP_LOGI(SNTP_TAG, "Time obtained: %04d-%02d-%02d %02d:%02d:%02d", 
-             timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-             timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
-    
-    return true;
 }
 
 static void connection_scan(void)
 {
     ESP_LOGI(NET_TAG, "Initializing network manager with both Ethernet and Wi-Fi...");
     
-    config_init_defaults();
-    ESP_LOGI(NET_TAG, "Configuration system initialized");
-    
     // Initialize network manager
     esp_err_t nm_err = network_manager_init();
     if (nm_err != ESP_OK) {
@@ -456,6 +550,12 @@ static void connection_scan(void)
         return;
     }
     
+    // Сокет нужен lwip, поэтому после инициализации сети; до сервера OPC UA,
+    // который добавляет узлы резервирования только у работающей пары
+    if (redundancy_start(&g_config.redundancy) != ESP_OK) {
+        ESP_LOGE(NET_TAG, "Redundancy not started, running as a single gateway");
+    }
+    
     // Устанавливаем callback для уведомления о состоянии сети
     network_manager_set_state_callback(opc_network_state_callback);
     ESP_LOGI(NET_TAG, "Network callback registered");
@@ -470,6 +570,20 @@ static void connection_scan(void)
         ESP_LOGW(NET_TAG, "Some network connections failed, continuing...");
     }
     
+    // Первая синхронизация идет в фоне и не задерживает запуск
+    start_clock_service();
+    
+    // MQTT публикатор сам переподключается, поэтому запускается сразу
+    esp_err_t mqtt_err = mqtt_publisher_start(&g_config.mqtt);
+    if (mqtt_err != ESP_OK) {
+        ESP_LOGE(NET_TAG, "Failed to start MQTT publisher: %s", esp_err_to_name(mqtt_err));
+    }
+    
+    esp_err_t http_err = http_snapshot_start(&g_config.http);
+    if (http_err != ESP_OK) {
+        ESP_LOGE(NET_TAG, "Failed to start HTTP snapshot endpoint: %s", esp_err_to_name(http_err));
+    }
+    
     ESP_LOGI(NET_TAG, "Network initialization complete");
     ESP_LOGI(NET_TAG, "Ethernet interface: %s", network_manager_get_eth_netif() ? "available" : "not available");
     ESP_LOGI(NET_TAG, "Wi-Fi interface: %s", network_manager_get_wifi_netif() ? "available" : "not available");
@@ -491,12 +605,6 @@ void app_main(void)
     esp_log_level_set("eth", ESP_LOG_INFO);
     esp_log_level_set("wifi", ESP_LOG_INFO);
     
-    ESP_LOGI(TAG, "Initializing IO cache system...");
-    io_cache_init();
-    adc_init();
-    // io_polling_task_start(); // ← ЗАКОММЕНТИРОВАТЬ ЭТУ СТРОЧКУ!
-    vTaskDelay(pdMS_TO_TICKS(100));
-    
     // Workaround for CVE-2019-15894
     nvs_flash_init();
     if (esp_flash_encryption_enabled())
@@ -516,6 +624,39 @@ void app_main(void)
         ESP_LOGI(TAG, "NVS initialized");
     }
     
+    // Сохраненная конфигурация читается до запуска подсистем, которые ее используют
+    config_init_defaults();
+    ESP_LOGI(TAG, "Configuration system initialized");
+    
+    ESP_LOGI(TAG, "Initializing IO cache system...");
+    io_cache_init();
+    io_trace_init(&g_config.trace);
+    
+    // Фронтенды, включённые в конфигурации, работают с загрузки
+    g_config.runtime.frontends.mqtt = g_config.mqtt.enable;
+    g_config.runtime.frontends.http = g_config.http.enable;
+    if (runtime_config_init(&g_config.runtime) != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid runtime configuration, using built-in defaults");
+    }
+    runtime_config_set_commit_hook(apply_runtime_config, NULL);
+    if (scan_policy_init(&g_config.scan_policy) != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid adaptive scan configuration, fixed input scan interval");
+    }
+    if (alarm_engine_init(&g_config.alarms) != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid alarm limits, limit alarms disabled");
+    }
+    // Рано: не подтвержденный образ начинает отсчет до отката с загрузки
+    if (ota_update_init(&g_config.ota, firmware_healthy) != ESP_OK) {
+        ESP_LOGE(TAG, "Firmware update service not started");
+    }
+    if (actuation_test_init(&g_config.actuation) != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid actuation self-test bits, self-test disabled");
+    }
+    adc_init();
+    // Опрос I/O на ядре без задачи OPC UA: кэш, фильтры, сигнализации
+    io_polling_task_start(g_config.pipeline.enable ? 1 - g_config.pipeline.service_core : 1);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    
     ESP_LOGI(TAG, "Starting network scan...");
     connection_scan();
     
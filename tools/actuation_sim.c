@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "actuation_meter.h"
+
+// Host run of the actuation self-test (components/actuation_test) against a
+// simulated PCF8574 output expander, relay and input expander. The meter is
+// the firmware's own actuation_meter.c.
+//
+// Every PCF8574 transfer takes -i microseconds (I2C at 400 kHz plus driver
+// overhead). A write of the output register switches the relay coil; the
+// contact follows after the operate time (on) or the release time (off),
+// each with a uniform jitter of -j ms, and chatters -b times after it
+// closes, each open and close lasting three transfers so the reads see them. The input expander reads the contact. The polling task
+// is a scan every -s ms at a random phase, so the process image shows the
+// contact as it was at the last scan.
+//
+// The run passes when the meter reproduces the model: the on and off
+// intervals lie between the relay delay and the delay plus jitter plus two
+// transfers (the edge is seen by the next input read), the process image
+// changes within one scan after that (two with bounces, a scan can fall on
+// one), and the bounces are counted. The host is not a real-time system, so
+// up to 2% of the samples may fall outside the model and 2% of the bounces
+// may be lost to a preempted read.
+
+#define MAX_EVENTS      64          // Contact changes kept by the relay model
+#define SLACK_US        200         // Scheduling allowance of the host
+
+typedef struct {
+    int64_t t;
+    int level;
+} Event;
+
+// Relay model
+static double operate_ms = 10.0;
+static double release_ms = 5.0;
+static double jitter_ms = 2.0;
+static int bounces = 0;
+static int transfer_us = 150;
+static double scan_ms = 20.0;
+
+static Event events[MAX_EVENTS];
+static int event_count;
+static int coil;
+static int64_t scan_phase_us;
+
+static int64_t now_us(void* ctx) {
+    (void)ctx;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// An I2C transfer: busy, like the firmware task waiting for the driver
+static void transfer(void) {
+    int64_t end = now_us(NULL) + transfer_us;
+    while (now_us(NULL) < end) {
+    }
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static void add_event(int64_t t, int level) {
+    if (event_count == MAX_EVENTS) {
+        memmove(events, events + 1, sizeof(Event) * (MAX_EVENTS - 1));
+        event_count--;
+    }
+    events[event_count++] = (Event){t, level};
+}
+
+static int contact_at(int64_t t) {
+    for (int i = event_count - 1; i >= 0; i--) {
+        if (events[i].t <= t) return events[i].level;
+    }
+    return 0;
+}
+
+static bool sim_write_output(void* ctx, bool on) {
+    (void)ctx;
+    transfer();
+    int64_t t = now_us(NULL);
+    if (on == coil) return true;
+    coil = on;
+    double delay_ms = (on ? operate_ms : release_ms) + jitter_ms * rand() / RAND_MAX;
+    int64_t edge = t + (int64_t)(delay_ms * 1000.0);
+    add_event(edge, on);
+    if (on) {
+        int64_t step = 3 * transfer_us;
+        for (int k = 1; k <= bounces; k++) {
+            add_event(edge + (2 * k - 1) * step, 0);
+            add_event(edge + 2 * k * step, 1);
+        }
+    }
+    return true;
+}
+
+static int sim_read_input(void* ctx) {
+    (void)ctx;
+    transfer();
+    return contact_at(now_us(NULL));
+}
+
+static int sim_read_visible(void* ctx) {
+    (void)ctx;
+    int64_t scan_us = (int64_t)(scan_ms * 1000.0);
+    int64_t t = now_us(NULL);
+    int64_t last_scan = t - (t - scan_phase_us) % scan_us;
+    return contact_at(last_scan);
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("ACTUATION SELF-TEST ON A SIMULATED RELAY\n");
+    printf("========================================\n");
+    printf("Usage: %s [OPTIONS]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help             Show this help message\n");
+    printf("  -n, --cycles N         Cycles, alternating on and off (default: 100)\n");
+    printf("  -r, --operate MS       Relay operate time (default: 10)\n");
+    printf("  -R, --release MS       Relay release time (default: 5)\n");
+    printf("  -j, --jitter MS        Uniform jitter added to both (default: 2)\n");
+    printf("  -b, --bounce N         Contact bounces after closing (default: 0, end within 2 ms)\n");
+    printf("  -i, --transfer US      Time of one PCF8574 transfer (default: 150)\n");
+    printf("  -s, --scan MS          Input scan interval of the polling task (default: 20)\n");
+    printf("  -p, --pause MS         Pause between cycles (default: 50)\n");
+    printf("  -t, --timeout MS       Longest wait per cycle (default: 200)\n");
+    printf("  -o, --csv FILE         Also write the results as CSV\n");
+    printf("\nExamples:\n");
+    printf("  %s\n", program_name);
+    printf("  %s -n 200 -r 8 -R 4 -j 1 -b 2 -o relay.csv\n", program_name);
+}
+
+int main(int argc, char* argv[]) {
+    const char* csv_file = NULL;
+    int cycles = 100;
+    int pause_ms = 50;
+    int timeout_ms = 200;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_help(argv[0]);
+            return 0;
+        } else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--cycles") == 0) && i + 1 < argc) {
+            cycles = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--operate") == 0) && i + 1 < argc) {
+            operate_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-R") == 0 || strcmp(argv[i], "--release") == 0) && i + 1 < argc) {
+            release_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jitter") == 0) && i + 1 < argc) {
+            jitter_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--bounce") == 0) && i + 1 < argc) {
+            bounces = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-i") == 0 || strcmp(argv[i], "--transfer") == 0) && i + 1 < argc) {
+            transfer_us = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--scan") == 0) && i + 1 < argc) {
+            scan_ms = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pause") == 0) && i + 1 < argc) {
+            pause_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timeout") == 0) && i + 1 < argc) {
+            timeout_ms = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            printf("Use %s -h for help\n", argv[0]);
+            return 1;
+        }
+    }
+    if (cycles < 1) cycles = 1;
+    if (cycles > ACTUATION_MAX_CYCLES) cycles = ACTUATION_MAX_CYCLES;
+    if (bounces < 0) bounces = 0;
+    if (transfer_us < 1) transfer_us = 1;
+    if (bounces * 6 * transfer_us > ACTUATION_BOUNCE_WINDOW_US) {
+        bounces = ACTUATION_BOUNCE_WINDOW_US / (6 * transfer_us);
+        printf("Bounces limited to %d to end within the bounce window\n", bounces);
+    }
+    if (scan_ms < 1.0) scan_ms = 1.0;
+
+    srand((unsigned)time(NULL));
+    scan_phase_us = now_us(NULL) - rand() % (int64_t)(scan_ms * 1000.0);
+
+    static actuation_meter_t meter;
+    actuation_meter_reset(&meter);
+    const actuation_io_t io = {sim_write_output, sim_read_input, sim_read_visible, now_us, NULL};
+    int on = 1;
+    for (int i = 0; i < cycles; i++) {
+        actuation_meter_cycle(&meter, &io, on, (uint32_t)timeout_ms * 1000);
+        on = !on;
+        sleep_ms(pause_ms);
+    }
+    actuation_meter_finish(&meter);
+
+    // Bounds of the model
+    uint32_t edge_slack = (uint32_t)(jitter_ms * 1000.0) + 2 * transfer_us + SLACK_US;
+    uint32_t lower[ACTUATION_SERIES] = {0, (uint32_t)(operate_ms * 1000.0), (uint32_t)(release_ms * 1000.0), 0};
+    uint32_t upper[ACTUATION_SERIES] = {
+        (uint32_t)transfer_us + SLACK_US,
+        lower[ACTUATION_ON] + edge_slack,
+        lower[ACTUATION_OFF] + edge_slack,
+        (uint32_t)((operate_ms > release_ms ? operate_ms : release_ms) * 1000.0 + scan_ms * 1000.0) +
+            edge_slack + (uint32_t)transfer_us
+    };
+    // A scan that falls on a bounce sees the contact open, the next one shows it
+    if (bounces > 0) upper[ACTUATION_VISIBLE] += (uint32_t)(scan_ms * 1000.0);
+    lower[ACTUATION_VISIBLE] = (uint32_t)((operate_ms < release_ms ? operate_ms : release_ms) * 1000.0);
+
+    int failed = 0;
+    actuation_summary_t sum[ACTUATION_SERIES];
+    printf("Relay %.1f / %.1f ms (+%.1f ms jitter), %d bounces, %d us transfers, %.0f ms scan\n\n",
+           operate_ms, release_ms, jitter_ms, bounces, transfer_us, scan_ms);
+    printf("%-10s %7s %9s %9s %9s %9s %9s %17s %8s\n", "interval", "count", "min us", "p50 us", "p90 us",
+           "p99 us", "max us", "model us", "outside");
+    for (int s = 0; s < ACTUATION_SERIES; s++) {
+        actuation_meter_summary(&meter, (actuation_series_t)s, &sum[s]);
+        uint32_t outside = 0;
+        for (uint32_t k = 0; k < meter.count[s]; k++) {
+            if (meter.samples[s][k] < lower[s] || meter.samples[s][k] > upper[s]) outside++;
+        }
+        printf("%-10s %7u %9u %9u %9u %9u %9u %8u-%-8u %8u\n", actuation_series_name((actuation_series_t)s),
+               sum[s].count, sum[s].min_us, sum[s].p50_us, sum[s].p90_us, sum[s].p99_us, sum[s].max_us,
+               lower[s], upper[s], outside);
+        if (outside > sum[s].count / 50) failed = 1;
+    }
+    int on_cycles = (cycles + 1) / 2;
+    printf("\nCycles %u, timeouts %u, not visible %u, bounces %u (expected %d), errors %u\n", meter.cycles,
+           meter.timeouts, meter.not_visible, meter.bounces, bounces * on_cycles, meter.errors);
+    printf("Command to edge (1 ms bins):");
+    for (int b = 0; b < ACTUATION_HISTOGRAM_BINS; b++) {
+        if (meter.histogram[b]) printf(" %d:%u", b, meter.histogram[b]);
+    }
+    printf("\n");
+    int expected = bounces * on_cycles;
+    if (meter.timeouts || meter.not_visible || meter.errors || (int)meter.bounces > expected ||
+        (int)meter.bounces < expected - expected / 50) {
+        failed = 1;
+    }
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+
+    if (csv_file) {
+        FILE* csv = fopen(csv_file, "w");
+        if (csv) {
+            fprintf(csv, "interval,count,min_us,p50_us,p90_us,p99_us,max_us,model_min_us,model_max_us\n");
+            for (int s = 0; s < ACTUATION_SERIES; s++) {
+                fprintf(csv, "%s,%u,%u,%u,%u,%u,%u,%u,%u\n", actuation_series_name((actuation_series_t)s),
+                        sum[s].count, sum[s].min_us, sum[s].p50_us, sum[s].p90_us, sum[s].p99_us,
+                        sum[s].max_us, lower[s], upper[s]);
+            }
+            fclose(csv);
+        }
+    }
+    return failed;
+}
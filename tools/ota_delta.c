@@ -0,0 +1,457 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "delta_patch.h"
+
+// Delta patch generator, applier and benchmark for the A/B OTA update
+// (components/ota_update). The applier is the firmware's own delta_patch.c.
+//
+//   ota_delta diff BASE NEW PATCH     make a patch that turns BASE into NEW
+//   ota_delta apply BASE PATCH OUT    apply it like the gateway does
+//   ota_delta bench BASE NEW          compare delta and full-image updates
+//
+// The generator matches every position of NEW against an index of 8-byte
+// hashes of BASE and keeps the longest match (preferring the continuation
+// of the previous copy, which costs two bytes); everything else is inserted
+// literally. bench also checks that a corrupted, truncated or mismatched
+// patch is rejected.
+
+#define HASH_KEY        8           // Bytes per index entry
+#define HASH_BITS       22          // Index size 4M heads
+#define MAX_CHAIN       64          // Candidates tried per position
+#define MIN_MATCH       12          // Shorter matches elsewhere cost more than literals
+#define MIN_CONTINUE    4           // Shortest match at the expected base position
+#define FEED_CHUNK      1436        // Patch bytes per feed call (one TCP segment)
+#define SLOT_SIZE       0x300000    // OTA slot size (partitions.csv)
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static void buf_put(Buffer* b, const void* data, size_t len) {
+    if (b->size + len > b->capacity) {
+        b->capacity = (b->size + len) * 2 + 4096;
+        b->data = realloc(b->data, b->capacity);
+    }
+    memcpy(b->data + b->size, data, len);
+    b->size += len;
+}
+
+static void buf_byte(Buffer* b, uint8_t v) {
+    buf_put(b, &v, 1);
+}
+
+static void buf_varint(Buffer* b, uint32_t v) {
+    while (v >= 0x80) {
+        buf_byte(b, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    buf_byte(b, (uint8_t)v);
+}
+
+static void buf_le32(Buffer* b, uint32_t v) {
+    uint8_t p[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+    buf_put(b, p, 4);
+}
+
+static int load_file(const char* path, Buffer* b) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        printf("Cannot open %s\n", path);
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    b->data = malloc(size > 0 ? (size_t)size : 1);
+    b->size = b->capacity = (size_t)size;
+    int ok = fread(b->data, 1, b->size, f) == b->size;
+    fclose(f);
+    if (!ok) printf("Cannot read %s\n", path);
+    return ok;
+}
+
+static int save_file(const char* path, const Buffer* b) {
+    FILE* f = fopen(path, "wb");
+    int ok = f && fwrite(b->data, 1, b->size, f) == b->size;
+    if (f) fclose(f);
+    if (!ok) printf("Cannot write %s\n", path);
+    return ok;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint32_t hash_at(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ull) >> (64 - HASH_BITS));
+}
+
+static size_t match_length(const Buffer* base, size_t j, const Buffer* image, size_t i) {
+    size_t n = 0;
+    while (j + n < base->size && i + n < image->size && base->data[j + n] == image->data[i + n]) n++;
+    return n;
+}
+
+static void put_insert(Buffer* patch, const uint8_t* data, size_t len) {
+    if (len == 0) return;
+    buf_byte(patch, DELTA_OP_INSERT);
+    buf_varint(patch, (uint32_t)len);
+    buf_put(patch, data, len);
+}
+
+// Build the patch that turns base into image
+static void make_patch(const Buffer* base, const Buffer* image, Buffer* patch) {
+    int32_t* head = malloc(sizeof(int32_t) << HASH_BITS);
+    int32_t* prev = malloc(sizeof(int32_t) * (base->size + 1));
+    memset(head, 0xFF, sizeof(int32_t) << HASH_BITS);
+    for (size_t j = 0; j + HASH_KEY <= base->size; j++) {
+        uint32_t h = hash_at(base->data + j);
+        prev[j] = head[h];
+        head[h] = (int32_t)j;
+    }
+
+    buf_put(patch, "A16D", 4);
+    buf_byte(patch, DELTA_VERSION);
+    buf_byte(patch, 0);
+    buf_byte(patch, 0);
+    buf_byte(patch, 0);
+    buf_le32(patch, (uint32_t)base->size);
+    buf_le32(patch, delta_crc32(0, base->data, base->size));
+    buf_le32(patch, (uint32_t)image->size);
+    buf_le32(patch, delta_crc32(0, image->data, image->size));
+
+    size_t i = 0, literal = 0, base_pos = 0;
+    while (i + HASH_KEY <= image->size) {
+        size_t best_len = 0, best_j = 0;
+        if (base_pos < base->size) {
+            best_len = match_length(base, base_pos, image, i);
+            best_j = base_pos;
+            if (best_len < MIN_CONTINUE) best_len = 0;
+        }
+        int chain = 0;
+        for (int32_t j = head[hash_at(image->data + i)]; j >= 0 && chain < MAX_CHAIN; j = prev[j], chain++) {
+            size_t len = match_length(base, (size_t)j, image, i);
+            // A jump costs up to four offset bytes more than the continuation
+            if (len >= MIN_MATCH && len > best_len + 4) {
+                best_len = len;
+                best_j = (size_t)j;
+            }
+        }
+        if (best_len == 0) {
+            i++;
+            continue;
+        }
+        // Take back the literal bytes that match in front of the copy
+        while (i > literal && best_j > 0 && image->data[i - 1] == base->data[best_j - 1]) {
+            i--;
+            best_j--;
+            best_len++;
+        }
+        put_insert(patch, image->data + literal, i - literal);
+        int64_t offset = (int64_t)best_j - (int64_t)base_pos;
+        buf_byte(patch, DELTA_OP_COPY);
+        buf_varint(patch, (uint32_t)best_len);
+        buf_varint(patch, (uint32_t)((offset << 1) ^ (offset >> 63)));
+        base_pos = best_j + best_len;
+        i += best_len;
+        literal = i;
+    }
+    put_insert(patch, image->data + literal, image->size - literal);
+    buf_byte(patch, DELTA_OP_END);
+    free(head);
+    free(prev);
+}
+
+// Simulated flash of the target slot with counters
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t erased;
+    size_t programmed;
+} Flash;
+
+typedef struct {
+    const Buffer* base;
+    size_t base_read;
+} BaseReader;
+
+static int read_base(void* context, uint32_t offset, void* buffer, size_t length) {
+    BaseReader* r = (BaseReader*)context;
+    if (offset + length > r->base->size) return -1;
+    memcpy(buffer, r->base->data + offset, length);
+    r->base_read += length;
+    return 0;
+}
+
+static int flash_read(void* context, uint32_t offset, void* buffer, size_t length) {
+    Flash* f = (Flash*)context;
+    if (offset + length > f->size) return -1;
+    memcpy(buffer, f->data + offset, length);
+    return 0;
+}
+
+static int flash_erase(void* context, uint32_t offset, size_t length) {
+    Flash* f = (Flash*)context;
+    if (offset + length > f->size) return -1;
+    memset(f->data + offset, 0xFF, length);
+    f->erased += length;
+    return 0;
+}
+
+static int flash_write(void* context, uint32_t offset, const void* data, size_t length) {
+    Flash* f = (Flash*)context;
+    if (offset + length > f->size) return -1;
+    memcpy(f->data + offset, data, length);
+    f->programmed += length;
+    return 0;
+}
+
+// The applier writes through the sector writer; both share one callback context
+typedef struct {
+    BaseReader reader;
+    delta_flash_writer_t* writer;
+} ApplyContext;
+
+static int apply_read(void* context, uint32_t offset, void* buffer, size_t length) {
+    return read_base(&((ApplyContext*)context)->reader, offset, buffer, length);
+}
+
+static int apply_write(void* context, const void* data, size_t length) {
+    return delta_flash_writer_write(((ApplyContext*)context)->writer, data, length);
+}
+
+typedef struct {
+    delta_result_t result;
+    size_t base_read;
+    uint32_t sectors_written;
+    uint32_t sectors_skipped;
+    uint32_t copied;
+    uint32_t inserted;
+    uint32_t operations;
+    double ms;
+} ApplyResult;
+
+// Apply patch (or write a full image when it is not a patch) into flash
+static ApplyResult apply_stream(const Buffer* base, const uint8_t* stream, size_t size, Flash* flash) {
+    static delta_patch_t patch;
+    static delta_flash_writer_t writer;
+    ApplyResult res = {DELTA_OK, 0, 0, 0, 0, 0, 0, 0.0};
+    delta_flash_ops_t ops = {flash_read, flash_erase, flash_write, flash};
+    delta_flash_writer_begin(&writer, &ops, (uint32_t)flash->size);
+    ApplyContext ctx = {{base, 0}, &writer};
+    int is_delta = delta_patch_is_delta(stream, size);
+    delta_patch_begin(&patch, apply_read, apply_write, &ctx);
+
+    double start = now_ms();
+    for (size_t pos = 0; pos < size && res.result == DELTA_OK; pos += FEED_CHUNK) {
+        size_t n = size - pos < FEED_CHUNK ? size - pos : FEED_CHUNK;
+        if (is_delta) {
+            res.result = delta_patch_feed(&patch, stream + pos, n);
+        } else if (delta_flash_writer_write(&writer, stream + pos, n) != 0) {
+            res.result = DELTA_ERR_IO;
+        }
+    }
+    if (res.result == DELTA_OK && is_delta) res.result = delta_patch_finish(&patch);
+    if (res.result == DELTA_OK && delta_flash_writer_finish(&writer) != 0) res.result = DELTA_ERR_IO;
+    res.ms = now_ms() - start;
+    res.base_read = ctx.reader.base_read;
+    res.sectors_written = writer.sectors_written;
+    res.sectors_skipped = writer.sectors_skipped;
+    res.copied = patch.copied;
+    res.inserted = patch.inserted;
+    res.operations = patch.operations;
+    return res;
+}
+
+static void flash_init(Flash* flash, const Buffer* slot, size_t size) {
+    flash->size = size;
+    flash->data = malloc(size);
+    memset(flash->data, 0xFF, size);
+    if (slot) memcpy(flash->data, slot->data, slot->size < size ? slot->size : size);
+    flash->erased = flash->programmed = 0;
+}
+
+static int cmd_diff(const char* base_path, const char* image_path, const char* patch_path) {
+    Buffer base = {0}, image = {0}, patch = {0};
+    if (!load_file(base_path, &base) || !load_file(image_path, &image)) return 1;
+    double start = now_ms();
+    make_patch(&base, &image, &patch);
+    printf("%s: %zu bytes (%.1f%% of %zu), %.0f ms\n", patch_path, patch.size,
+           100.0 * patch.size / image.size, image.size, now_ms() - start);
+    return save_file(patch_path, &patch) ? 0 : 1;
+}
+
+static int cmd_apply(const char* base_path, const char* patch_path, const char* out_path) {
+    Buffer base = {0}, patch = {0};
+    if (!load_file(base_path, &base) || !load_file(patch_path, &patch)) return 1;
+    if (!delta_patch_is_delta(patch.data, patch.size) || patch.size < DELTA_HEADER_SIZE) {
+        printf("%s is not a delta patch\n", patch_path);
+        return 1;
+    }
+    uint32_t image_size = (uint32_t)patch.data[16] | ((uint32_t)patch.data[17] << 8) |
+                          ((uint32_t)patch.data[18] << 16) | ((uint32_t)patch.data[19] << 24);
+    Flash flash;
+    flash_init(&flash, NULL, ((size_t)image_size + DELTA_SECTOR_SIZE - 1) / DELTA_SECTOR_SIZE * DELTA_SECTOR_SIZE);
+    ApplyResult res = apply_stream(&base, patch.data, patch.size, &flash);
+    if (res.result != DELTA_OK) {
+        printf("Apply failed: %s\n", delta_result_name(res.result));
+        return 1;
+    }
+    Buffer out = {flash.data, image_size, image_size};
+    printf("%s: %u bytes, %u operations, %.0f ms\n", out_path, image_size, res.operations, res.ms);
+    return save_file(out_path, &out) ? 0 : 1;
+}
+
+static int expect_failure(const char* name, const Buffer* base, const uint8_t* stream, size_t size,
+                          delta_result_t expected) {
+    Flash flash;
+    flash_init(&flash, NULL, SLOT_SIZE);
+    ApplyResult res = apply_stream(base, stream, size, &flash);
+    free(flash.data);
+    int ok = expected == DELTA_OK ? res.result != DELTA_OK : res.result == expected;
+    printf("  %-22s %-34s %s\n", name, delta_result_name(res.result), ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Display help message
+static void print_help(const char* program_name) {
+    printf("OTA DELTA PATCH TOOL\n");
+    printf("====================\n");
+    printf("Usage: %s diff BASE NEW PATCH\n", program_name);
+    printf("       %s apply BASE PATCH OUT\n", program_name);
+    printf("       %s bench [OPTIONS] BASE NEW\n\n", program_name);
+    printf("Bench options:\n");
+    printf("  -s, --slot FILE        Image already in the target slot (default: erased)\n");
+    printf("  -r, --rate KBIT        Link rate for the transfer time (default: 2000)\n");
+    printf("  -o, --csv FILE         Also write the results as CSV\n");
+    printf("\nExamples:\n");
+    printf("  %s diff build-1.2/opcua_esp32.bin build/opcua_esp32.bin update.a16d\n", program_name);
+    printf("  %s bench -s build-1.1/opcua_esp32.bin build-1.2/opcua_esp32.bin build/opcua_esp32.bin\n",
+           program_name);
+}
+
+static int cmd_bench(int argc, char* argv[]) {
+    const char* slot_path = NULL;
+    const char* csv_file = NULL;
+    const char* paths[2] = {NULL, NULL};
+    int npaths = 0;
+    double rate_kbit = 2000.0;
+
+    for (int i = 2; i < argc; i++) {
+        if ((strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--slot") == 0) && i + 1 < argc) {
+            slot_path = argv[++i];
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--rate") == 0) && i + 1 < argc) {
+            rate_kbit = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--csv") == 0) && i + 1 < argc) {
+            csv_file = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option or missing value: %s\n", argv[i]);
+            return 1;
+        } else if (npaths < 2) {
+            paths[npaths++] = argv[i];
+        }
+    }
+    if (npaths < 2) {
+        print_help(argv[0]);
+        return 1;
+    }
+
+    Buffer base = {0}, image = {0}, slot = {0}, patch = {0};
+    if (!load_file(paths[0], &base) || !load_file(paths[1], &image)) return 1;
+    if (slot_path && !load_file(slot_path, &slot)) return 1;
+    if (image.size > SLOT_SIZE) {
+        printf("%s does not fit an OTA slot (%zu > %u bytes)\n", paths[1], image.size, SLOT_SIZE);
+        return 1;
+    }
+
+    double start = now_ms();
+    make_patch(&base, &image, &patch);
+    double diff_ms = now_ms() - start;
+
+    // Delta and full image into the same starting slot
+    Flash flash;
+    flash_init(&flash, slot_path ? &slot : NULL, SLOT_SIZE);
+    ApplyResult delta = apply_stream(&base, patch.data, patch.size, &flash);
+    int delta_ok = delta.result == DELTA_OK && memcmp(flash.data, image.data, image.size) == 0;
+    size_t delta_erased = flash.erased, delta_programmed = flash.programmed;
+    free(flash.data);
+
+    flash_init(&flash, slot_path ? &slot : NULL, SLOT_SIZE);
+    ApplyResult full = apply_stream(&base, image.data, image.size, &flash);
+    int full_ok = full.result == DELTA_OK && memcmp(flash.data, image.data, image.size) == 0;
+    size_t full_erased = flash.erased, full_programmed = flash.programmed;
+    free(flash.data);
+
+    double delta_s = patch.size * 8.0 / (rate_kbit * 1000.0);
+    double full_s = image.size * 8.0 / (rate_kbit * 1000.0);
+    printf("Base %zu bytes, new image %zu bytes, slot %s\n", base.size, image.size,
+           slot_path ? slot_path : "erased");
+    printf("Patch: %u operations, %u bytes copied from the base, %u inserted, made in %.0f ms\n\n",
+           delta.operations, delta.copied, delta.inserted, diff_ms);
+    printf("%-8s %12s %10s %14s %14s %10s %12s %10s\n", "method", "transfer B", "ratio",
+           "transfer s", "erased B", "skipped", "base read B", "apply ms");
+    printf("%-8s %12zu %9.1f%% %14.1f %14zu %10u %12zu %10.1f\n", "full", image.size, 100.0,
+           full_s, full_erased, full.sectors_skipped, full.base_read, full.ms);
+    printf("%-8s %12zu %9.1f%% %14.1f %14zu %10u %12zu %10.1f\n", "delta", patch.size,
+           100.0 * patch.size / image.size, delta_s, delta_erased, delta.sectors_skipped,
+           delta.base_read, delta.ms);
+    printf("\nTransfer time at %.0f kbit/s. Programmed: full %zu B, delta %zu B.\n", rate_kbit,
+           full_programmed, delta_programmed);
+    printf("Applier RAM: %zu B (patch state) + %zu B (sector writer)\n\n", sizeof(delta_patch_t),
+           sizeof(delta_flash_writer_t));
+
+    printf("Checks:\n");
+    int failed = 0;
+    printf("  %-22s %-34s %s\n", "delta image", delta_result_name(delta.result), delta_ok ? "ok" : "FAIL");
+    printf("  %-22s %-34s %s\n", "full image", delta_result_name(full.result), full_ok ? "ok" : "FAIL");
+    failed |= !delta_ok || !full_ok;
+
+    Buffer corrupt = {0};
+    buf_put(&corrupt, patch.data, patch.size);
+    corrupt.data[DELTA_HEADER_SIZE + (patch.size - DELTA_HEADER_SIZE) / 2] ^= 0x5A;
+    failed |= !expect_failure("corrupted patch", &base, corrupt.data, corrupt.size, DELTA_OK);
+    failed |= !expect_failure("truncated patch", &base, patch.data, patch.size - 1, DELTA_ERR_INCOMPLETE);
+    failed |= !expect_failure("other base", &image, patch.data, patch.size, DELTA_ERR_BASE);
+    corrupt.size = 0;
+    buf_put(&corrupt, patch.data, patch.size);
+    buf_byte(&corrupt, DELTA_OP_END);
+    failed |= !expect_failure("data after the end", &base, corrupt.data, corrupt.size, DELTA_ERR_FORMAT);
+    printf("%s\n", failed ? "FAILED" : "PASSED");
+
+    if (csv_file) {
+        FILE* csv = fopen(csv_file, "w");
+        if (csv) {
+            fprintf(csv, "method,transfer_bytes,transfer_s,erased_bytes,programmed_bytes,skipped_sectors,"
+                         "base_read_bytes,apply_ms\n");
+            fprintf(csv, "full,%zu,%.2f,%zu,%zu,%u,%zu,%.1f\n", image.size, full_s, full_erased,
+                    full_programmed, full.sectors_skipped, full.base_read, full.ms);
+            fprintf(csv, "delta,%zu,%.2f,%zu,%zu,%u,%zu,%.1f\n", patch.size, delta_s, delta_erased,
+                    delta_programmed, delta.sectors_skipped, delta.base_read, delta.ms);
+            fclose(csv);
+        }
+    }
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 5 && strcmp(argv[1], "diff") == 0) {
+        return cmd_diff(argv[2], argv[3], argv[4]);
+    }
+    if (argc >= 5 && strcmp(argv[1], "apply") == 0) {
+        return cmd_apply(argv[2], argv[3], argv[4]);
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        return cmd_bench(argc, argv);
+    }
+    print_help(argv[0]);
+    return argc >= 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) ? 0 : 1;
+}